@@ -50,6 +50,8 @@
 #include "BootManager.h"
 
 #include "ApplicationProcessManager.h"
+#include "ApplicationZygote.h"
+#include "MimeSystem.h"
 
 #include <ProcessKiller.h>
 
@@ -103,6 +105,7 @@ static gchar* s_debugTrapStr = NULL;
 static gboolean s_forceSoftwareRendering = false;
 static gchar* s_mallocStatsFileStr = NULL;
 static int s_mallocStatsInterval = -1;
+static gboolean s_useZygote = false;
 
 /**
  * Whether or not to debug crashes
@@ -590,6 +593,7 @@ static void parseCommandlineOptions(int argc, char** argv)
 		{ "force-software-rendering", 'S', 0, G_OPTION_ARG_NONE, &s_forceSoftwareRendering, "Force Software rendering", NULL},
 		{ "malloc-stats-file", 'm', 0, G_OPTION_ARG_STRING,  &s_mallocStatsFileStr, "File for logging malloc stats", "file" },
 		{ "malloc-stats-interval", 'i', 0, G_OPTION_ARG_INT,  &s_mallocStatsInterval, "Interval at which to log malloc stats", "seconds" },
+		{ "zygote", 'z', 0, G_OPTION_ARG_NONE, &s_useZygote, "Launch apps through a pre-forked helper process", NULL },
 		{ NULL }
 	};
 
@@ -705,6 +709,10 @@ int main( int argc, char** argv)
 
 	sysmgrPid = getpid();
 
+	// Fork the app launch helper while we're still small and have no threads
+	if (s_useZygote && !ApplicationZygote::start())
+		g_warning("Failed to start the launch zygote, launching apps directly");
+
 	// Load Settings (first!)
 	Settings* settings = Settings::LunaSettings();
 
@@ -789,7 +797,7 @@ int main( int argc, char** argv)
 	EventReporter::init(host->mainLoop());
 
 	// Initialize the SysMgr MemoryMonitor
-	MemoryMonitor::instance();
+	MemoryMonitor::instance()->start();
 
 	// load all set policies
 	EASPolicyManager::instance()->load();
@@ -802,5 +810,10 @@ int main( int argc, char** argv)
 
 	app.exec();
 
+	// handler changes are in the active mime table's log already; put them on the disk before going
+	std::string mimeTableErr;
+	if (!MimeSystem::instance()->flushScheduledSave(mimeTableErr))
+		g_warning("Failed to save the active mime table: %s", mimeTableErr.c_str());
+
 	return 0;
 }
@@ -0,0 +1,226 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "AdaptiveBrightness.h"
+
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <QtGlobal>
+
+AdaptiveBrightness::AdaptiveBrightness()
+    : m_points(1)
+    , m_smoothingPercent(DefaultSmoothingPercent)
+    , m_rampPerSecond(DefaultRampPerSecond)
+    , m_thresholdPercent(DefaultThresholdPercent)
+    , m_lux(-1)
+    , m_position(100)
+    , m_scale(100)
+    , m_target(100)
+    , m_stepTarget(100)
+    , m_rampFrom(100)
+    , m_ramping(false)
+    , m_lastStepMs(0)
+    , m_samples(0)
+    , m_changes(0)
+{
+    // flat until told otherwise: the maximum brightness whatever the light
+    m_curve[0].lux = 0;
+    m_curve[0].scale = 100;
+}
+
+bool AdaptiveBrightness::setCurve(const Point* points, int count)
+{
+    if (count < 1 || count > MaxPoints) {
+        g_warning("%s: %d points, expecting 1 to %d", __PRETTY_FUNCTION__, count, (int) MaxPoints);
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (points[i].scale < 0 || (i > 0 && points[i].lux <= points[i - 1].lux)) {
+            g_warning("%s: point %d (%d lux, %d%%) is out of order", __PRETTY_FUNCTION__, i,
+                      points[i].lux, points[i].scale);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        m_curve[i] = points[i];
+    m_points = count;
+    return true;
+}
+
+void AdaptiveBrightness::setRegionScales(int darkScale, int dimScale, int outdoorScale)
+{
+    // dark up to the dark/dim border, full from the dim/indoor border to the indoor/outdoor one, and the
+    // outdoor scale by daylight
+    const Point points[] = {
+        { 0, darkScale },
+        { 6, darkScale },
+        { 50, dimScale },
+        { 100, 100 },
+        { 1000, 100 },
+        { 5000, outdoorScale }
+    };
+
+    setCurve(points, sizeof(points) / sizeof(points[0]));
+}
+
+int AdaptiveBrightness::curveScale(int32_t lux) const
+{
+    if (lux <= m_curve[0].lux)
+        return m_curve[0].scale;
+
+    for (int i = 1; i < m_points; i++) {
+        if (lux > m_curve[i].lux)
+            continue;
+
+        const Point& from = m_curve[i - 1];
+        const Point& to = m_curve[i];
+        return from.scale + (int) ((int64_t) (to.scale - from.scale) * (lux - from.lux) / (to.lux - from.lux));
+    }
+
+    return m_curve[m_points - 1].scale;
+}
+
+void AdaptiveBrightness::setSmoothing(int percent)
+{
+    m_smoothingPercent = qBound(1, percent, 100);
+}
+
+void AdaptiveBrightness::setRamp(int scalePerSecond)
+{
+    m_rampPerSecond = qMax(scalePerSecond, 1);
+}
+
+void AdaptiveBrightness::setThreshold(int percent)
+{
+    m_thresholdPercent = qMax(percent, 0);
+}
+
+int32_t AdaptiveBrightness::smoothedLux() const
+{
+    return m_lux < 0 ? 0 : (int32_t) (m_lux + 0.5f);
+}
+
+int AdaptiveBrightness::threshold() const
+{
+    return qMax(m_scale * m_thresholdPercent / 100, 1);
+}
+
+int AdaptiveBrightness::stepSize() const
+{
+    return qMax(threshold(), (abs(m_target - m_rampFrom) + RampSteps - 1) / RampSteps);
+}
+
+bool AdaptiveBrightness::addSample(int32_t lux, uint32_t nowMs)
+{
+    if (lux < 0)
+        return m_ramping;
+
+    m_samples++;
+
+    // the first reading since a restart is taken as it is
+    if (m_lux < 0)
+        m_lux = lux;
+    else
+        m_lux += (lux - m_lux) * m_smoothingPercent / 100;
+
+    m_target = curveScale(smoothedLux());
+
+    if (!m_ramping) {
+        if (abs(m_target - m_scale) < threshold())
+            return false;
+
+        m_ramping = true;
+        m_position = m_scale;
+        m_stepTarget = m_scale;
+        m_rampFrom = m_scale;
+        m_lastStepMs = nowMs;
+    }
+
+    return true;
+}
+
+bool AdaptiveBrightness::step(uint32_t nowMs)
+{
+    if (!m_ramping)
+        return false;
+
+    float delta = (float) m_rampPerSecond * (uint32_t) (nowMs - m_lastStepMs) / 1000;
+    m_lastStepMs = nowMs;
+
+    int previousTarget = m_stepTarget;
+    m_stepTarget = m_target;
+
+    if (fabsf(m_target - m_position) > delta) {
+        m_position += m_target > m_position ? delta : -delta;
+    }
+    else {
+        m_position = m_target;
+
+        // the end waits while the light is still moving the target on
+        if ((m_target - previousTarget) * (m_target - m_scale) <= 0) {
+            m_ramping = false;
+            if (m_scale == m_target)
+                return false;
+
+            m_scale = m_target;
+            m_changes++;
+            return true;
+        }
+    }
+
+    // on the way, a step goes out each time the ramp has moved a step size on
+    int scale = (int) lroundf(m_position);
+    if (abs(scale - m_scale) < stepSize())
+        return false;
+
+    m_scale = scale;
+    m_changes++;
+    return true;
+}
+
+bool AdaptiveBrightness::settle()
+{
+    if (!m_ramping)
+        return false;
+
+    m_ramping = false;
+    m_position = m_target;
+    if (m_scale == m_target)
+        return false;
+
+    m_scale = m_target;
+    m_changes++;
+    return true;
+}
+
+void AdaptiveBrightness::restart()
+{
+    m_lux = -1;
+    m_ramping = false;
+    m_position = m_scale;
+    m_target = m_scale;
+}
@@ -0,0 +1,116 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef ADAPTIVEBRIGHTNESS_H
+#define ADAPTIVEBRIGHTNESS_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+/*
+ * The display brightness for the ambient light, as a scale (percent) of the user's maximum brightness.
+ *
+ * Lux readings are smoothed exponentially and looked up on a piecewise linear curve, which gives the
+ * target scale. The scale in use only follows once the target is a noticeable step away (a share of the
+ * scale in use, as eyes go by ratios), and then ramps there at a limited rate. step() reports the ramp in
+ * about RampSteps steps, none smaller than the noticeable one, and holds the last one back while the
+ * smoothed light is still moving the target on, so a change of light costs a few backlight calls rather
+ * than one per reading or per tick.
+ *
+ * Times are in ms, from any clock that only moves forward (Time::curTimeMs()).
+ */
+class AdaptiveBrightness
+{
+public:
+    struct Point {
+        int32_t lux;
+        int scale;
+    };
+
+    enum {
+        MaxPoints = 8,
+        DefaultSmoothingPercent = 20,   // the weight of a new reading
+        DefaultRampPerSecond = 40,      // scale points
+        DefaultThresholdPercent = 8,    // of the scale in use, at least 1 point
+        RampSteps = 4                   // a ramp goes out in about this many steps
+    };
+
+    AdaptiveBrightness();
+
+    // at most MaxPoints, in increasing lux; false (and the curve is kept) otherwise. Below the first point
+    // and above the last the scale stays flat.
+    bool setCurve(const Point* points, int count);
+    // a curve through the scales of the dark, dim, indoor (100) and outdoor light regions
+    void setRegionScales(int darkScale, int dimScale, int outdoorScale);
+    int curveScale(int32_t lux) const;
+
+    void setSmoothing(int percent);
+    void setRamp(int scalePerSecond);
+    void setThreshold(int percent);
+
+    // a reading at nowMs; true if a ramp is under way, which step() then has to drive
+    bool addSample(int32_t lux, uint32_t nowMs);
+    // moves the ramp on to nowMs; true if scale() changed, on the way or at the end
+    bool step(uint32_t nowMs);
+    // ends a ramp at its target right away; true if scale() changed
+    bool settle();
+    // forgets the readings (the sensor stopped), keeping the scale in use
+    void restart();
+
+    bool ramping() const { return m_ramping; }
+    int scale() const { return m_scale; }
+    int target() const { return m_target; }
+    int32_t smoothedLux() const;
+
+    // readings taken, and the scale changes that came of them
+    uint32_t samples() const { return m_samples; }
+    uint32_t changes() const { return m_changes; }
+
+private:
+    int threshold() const;
+    int stepSize() const;
+
+    Point m_curve[MaxPoints];
+    int m_points;
+
+    int m_smoothingPercent;
+    int m_rampPerSecond;
+    int m_thresholdPercent;
+
+    float m_lux;
+    float m_position;
+    int m_scale;
+    int m_target;
+    int m_stepTarget;   // the target at the last step
+    int m_rampFrom;     // the scale in use when the ramp started
+    bool m_ramping;
+    uint32_t m_lastStepMs;
+
+    uint32_t m_samples;
+    uint32_t m_changes;
+
+private:
+    AdaptiveBrightness(const AdaptiveBrightness&);
+    AdaptiveBrightness& operator=(const AdaptiveBrightness&);
+};
+
+#endif /* ADAPTIVEBRIGHTNESS_H */
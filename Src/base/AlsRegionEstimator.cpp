@@ -0,0 +1,126 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "AlsRegionEstimator.h"
+
+#include <limits.h>
+
+// the top of each region, in lux
+const int32_t AlsRegionEstimator::s_border[ALS_REGION_COUNT] = { -1, 6, 100, 1000, INT_MAX };
+
+// margins are higher at lower lux values
+const int32_t AlsRegionEstimator::s_margin[ALS_REGION_COUNT] = { 0, 4, 10, 100, 0 };
+
+AlsRegionEstimator::AlsRegionEstimator()
+    : m_samples(ALS_SAMPLE_SIZE)
+    , m_sum(0)
+    , m_min(0)
+    , m_max(0)
+    , m_region(ALS_REGION_INDOOR)
+{
+}
+
+void AlsRegionEstimator::reset(int region)
+{
+    m_samples.Reset();
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+    m_region = region;
+}
+
+int32_t AlsRegionEstimator::lowerBound(int region) const
+{
+    return s_border[region - 1] - s_margin[region - 1];
+}
+
+int32_t AlsRegionEstimator::upperBound(int region) const
+{
+    return s_border[region] + s_margin[region];
+}
+
+bool AlsRegionEstimator::inRegion(int32_t lux) const
+{
+    return lux >= lowerBound(m_region) && lux <= upperBound(m_region);
+}
+
+int32_t AlsRegionEstimator::last() const
+{
+    return count() ? m_samples.SampleAt(0) : 0;
+}
+
+int32_t AlsRegionEstimator::average() const
+{
+    return count() ? m_sum / count() : 0;
+}
+
+void AlsRegionEstimator::rescanMinMax()
+{
+    m_min = m_max = m_samples.SampleAt(0);
+    for (int age = 1; age < count(); age++) {
+        int32_t lux = m_samples.SampleAt(age);
+        if (lux < m_min)
+            m_min = lux;
+        if (lux > m_max)
+            m_max = lux;
+    }
+}
+
+bool AlsRegionEstimator::addSample(int32_t lux)
+{
+    int current = m_region;
+
+    // only from outside (a reset to undefined); there are no borders to move from
+    if (m_region <= ALS_REGION_UNDEFINED || m_region > ALS_REGION_OUTDOOR)
+        m_region = ALS_REGION_INDOOR;
+
+    bool evicting = m_samples.Full();
+    int32_t evicted = evicting ? m_samples.SampleAt(ALS_SAMPLE_SIZE - 1) : 0;
+    if (evicting)
+        m_sum -= evicted;
+
+    m_samples.AddSample(lux, 0);
+    m_sum += lux;
+
+    // the window only has to be walked when its minimum or maximum leaves it
+    if (count() == 1 || (evicting && (evicted == m_min || evicted == m_max))) {
+        rescanMinMax();
+    }
+    else {
+        if (lux < m_min)
+            m_min = lux;
+        if (lux > m_max)
+            m_max = lux;
+    }
+
+    if (!m_samples.Full())
+        return m_region != current;
+
+    int32_t average = m_sum / ALS_SAMPLE_SIZE;
+    while (m_region > ALS_REGION_DARK && average < lowerBound(m_region))
+        --m_region;
+    while (m_region < ALS_REGION_OUTDOOR && average > upperBound(m_region))
+        ++m_region;
+
+    return m_region != current;
+}
@@ -0,0 +1,92 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef ALSREGIONESTIMATOR_H
+#define ALSREGIONESTIMATOR_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+#include "CircularBuffer.h"
+
+#define ALS_INIT_SAMPLE_SIZE   10
+#define ALS_SAMPLE_SIZE 	   10
+#define ALS_REGION_COUNT       5
+
+#define ALS_REGION_UNDEFINED  0
+#define ALS_REGION_DARK       1
+#define ALS_REGION_DIM        2
+#define ALS_REGION_INDOOR     3
+#define ALS_REGION_OUTDOOR    4
+
+/*
+ * The light region from a moving window of the last ALS_SAMPLE_SIZE lux readings.
+ *
+ * The window is a fixed CircularBuffer, allocated once; a sample updates the running sum, minimum and
+ * maximum in place. Once the window is full, its average moves the region. The region has to be left by a
+ * margin before it changes (more of one at low lux, where the steps are small), and the average can cross
+ * several regions at once.
+ */
+class AlsRegionEstimator
+{
+public:
+    AlsRegionEstimator();
+
+    // empties the window and starts over from region
+    void reset(int region = ALS_REGION_INDOOR);
+
+    // true if the region changed
+    bool addSample(int32_t lux);
+
+    int region() const { return m_region; }
+
+    // is lux within the current region, margins included?
+    bool inRegion(int32_t lux) const;
+
+    // of the samples in the window; 0 while it is empty
+    int count() const { return m_samples.Count(); }
+    bool full() const { return m_samples.Full(); }
+    int32_t last() const;
+    int32_t average() const;
+    int32_t minimum() const { return m_min; }
+    int32_t maximum() const { return m_max; }
+
+private:
+    int32_t lowerBound(int region) const;
+    int32_t upperBound(int region) const;
+    void rescanMinMax();
+
+    CircularBuffer<int32_t> m_samples;
+    int32_t m_sum;
+    int32_t m_min;
+    int32_t m_max;
+    int m_region;
+
+    static const int32_t s_border[ALS_REGION_COUNT];
+    static const int32_t s_margin[ALS_REGION_COUNT];
+
+private:
+    AlsRegionEstimator(const AlsRegionEstimator&);
+    AlsRegionEstimator& operator=(const AlsRegionEstimator&);
+};
+
+#endif /* ALSREGIONESTIMATOR_H */
@@ -22,14 +22,18 @@
 #include "AmbientLightSensor.h"
 
 #include "Common.h"
+#include "DisplayManager.h"
 #include "HostBase.h"
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
+#include "LunaConf.h"
 #include "Settings.h"
 #include "SystemService.h"
 #include "Time.h"
 
 #include <cjson/json.h>
 #include <glib.h>
+#include <stdio.h>
 #if defined(HAS_LUNA_PREF)
 #include <lunaprefs.h>
 #endif
@@ -43,8 +47,25 @@
 
 #define ALS_CALIBRATION_TOKEN   "com.palm.properties.ALSCal"
 
+#define ALS_REPLY_INTERVAL_MS   1000
+
+#define ALS_REPLY_INTERVAL_MAX_MS   60000
+
 AmbientLightSensor* AmbientLightSensor::m_instance = NULL;
 
+// [Display] AlsReplyIntervalMs in luna.conf
+static uint32_t readReplyIntervalMs()
+{
+    int value = ALS_REPLY_INTERVAL_MS;
+    readLunaConfInteger("Display", "AlsReplyIntervalMs", value);
+
+    if (value < 0 || value > ALS_REPLY_INTERVAL_MAX_MS) {
+        g_warning("%s: AlsReplyIntervalMs %d is out of range, clamping to [0,%d]", __FUNCTION__, value, ALS_REPLY_INTERVAL_MAX_MS);
+        value = CLAMP(value, 0, ALS_REPLY_INTERVAL_MAX_MS);
+    }
+    return (uint32_t) value;
+}
+
 /*! \page com_palm_ambient_light_sensor_control Service API com.palm.ambientLightSensor/control/
  *  Public methods:
  *  - \ref com_palm_ambient_light_sensor_control_status
@@ -58,19 +79,17 @@ AmbientLightSensor::AmbientLightSensor ()
     : m_service(NULL)
     , m_alsEnabled(false)
     , m_alsIsOn(false)
-    , m_alsPointer(0)
     , m_alsRegion(ALS_REGION_UNDEFINED)
-    , m_alsSum(0)
     , m_alsLastOff(0)
     , m_alsDisplayOn(false)
     , m_alsSubscriptions(0)
     , m_alsDisabled(0)
     , m_alsHiddOnline(false)
     , m_alsFastRate(false)
-    , m_alsSampleCount(0)
     , m_alsCountInRegion(0)
-    , m_alsSamplesNeeded (ALS_INIT_SAMPLE_SIZE)
-    , m_alsLastSampleTs (0)
+    , m_alsReplyIntervalMs (ALS_REPLY_INTERVAL_MS)
+    , m_alsLastReplyMs (0)
+    , m_alsLastReplyRegion (ALS_REGION_UNDEFINED)
 {
     LSError lserror;
     LSErrorInit(&lserror);
@@ -124,27 +143,14 @@ AmbientLightSensor::AmbientLightSensor ()
 	m_alsEnabled = true; 
 
 	g_warning ("ALSCal token found, expecting lux values in light events");
-
-
-	m_alsBorder[ALS_REGION_UNDEFINED] = -1;
-	m_alsBorder[ALS_REGION_DARK] = 6;
-	m_alsBorder[ALS_REGION_DIM] = 100;
-	m_alsBorder[ALS_REGION_INDOOR] = 1000;
-	m_alsBorder[ALS_REGION_OUTDOOR] = INT_MAX;
-
-	// margins are higher at lower lux values
-	m_alsMargin[ALS_REGION_UNDEFINED] = 0;
-	m_alsMargin[ALS_REGION_DARK] = 4;
-	m_alsMargin[ALS_REGION_DIM] = 10;
-	m_alsMargin[ALS_REGION_INDOOR] = 100;
-	m_alsMargin[ALS_REGION_OUTDOOR] = 0;
-
     }
     else {
         g_warning ("%s: ALS is not enabled", __PRETTY_FUNCTION__); 
 
     }
 
+    setReplyIntervalMs(readReplyIntervalMs());
+
     m_instance = this;
 
     g_debug ("%s started", __PRETTY_FUNCTION__);
@@ -186,6 +192,11 @@ bool AmbientLightSensor::stop ()
     return off ();
 }
 
+void AmbientLightSensor::setReplyIntervalMs (uint32_t intervalMs)
+{
+    m_alsReplyIntervalMs = intervalMs;
+}
+
 bool AmbientLightSensor::on ()
 {
 #if defined(TARGET_DEVICE)
@@ -211,10 +222,8 @@ bool AmbientLightSensor::on ()
 
     int timeSinceLastReading = Time::curTimeMs() - m_alsLastOff;
 
-    m_alsSampleCount = 0;
     m_alsCountInRegion = 0;
-    m_alsSamplesNeeded = ALS_INIT_SAMPLE_SIZE;
-    m_alsSampleList.clear();
+    m_alsEstimator.reset(ALS_REGION_INDOOR);
     m_alsRegion = ALS_REGION_INDOOR;
 
     /* fine-tuning support for NYX */
@@ -273,15 +282,8 @@ bool AmbientLightSensor::update (int intensity)
         return false;
 }
 
-bool sortIncr (int32_t alsVal1, int32_t alsVal2) 
-{
-    if (alsVal1 > alsVal2)
-	return false;
-    return true;
-}
-
 // this is the als region estimation for the newer sensors
-// the als region is estimated from  a fixed number of samples (m_alsSamplesNeeded).
+// the als region is estimated from  a fixed number of samples (ALS_SAMPLE_SIZE, see AlsRegionEstimator).
 // once the als region is determined, all incoming values that fall in the current region are discarded
 // if an incoming value is outside the current region, we collect the samples again and re-estimate the region
 // this allows the als region to move directly to the current light condition.
@@ -289,10 +291,6 @@ bool sortIncr (int32_t alsVal1, int32_t alsVal2)
 bool AmbientLightSensor::updateAls(int intensity)
 {
 #if defined(TARGET_DEVICE)
-    LSError lserror;
-    LSErrorInit(&lserror);
-    bool result = true;
-
     int current = m_alsRegion;
 
     if (m_alsDisabled > 0) {
@@ -317,34 +315,8 @@ bool AmbientLightSensor::updateAls(int intensity)
         return false;
     }
 
-    if (m_alsRegion < ALS_REGION_UNDEFINED || m_alsRegion > ALS_REGION_OUTDOOR) {
-        g_warning("%s: current region is invalid, resetting to indoor",
-                __PRETTY_FUNCTION__);
-        m_alsRegion = ALS_REGION_INDOOR;
-    }
-
-    if (m_alsSampleCount == 0)
-    {
-        m_alsSum = 0;
-    }
-
-    if (m_alsSampleCount == m_alsSamplesNeeded) {
-        m_alsSum -= m_alsSampleList.front();
-        m_alsSampleList.pop_front();
-        m_alsSampleCount--;
-    }
-
-    // start collecting samples
-    if (m_alsSampleCount < m_alsSamplesNeeded) {
-        // g_debug("%s: received sample %d", __PRETTY_FUNCTION__, intensity);
-        // maintaining a running sum of the last m_alsSamplesNeeded number of samples
-        // also maintaining the last m_alsSamplesNeeded values in an array
-        m_alsSampleList.push_back(intensity);
-        m_alsSum += intensity;
-        m_alsSampleCount++;
-    }
-
-    if (intensity < m_alsBorder[m_alsRegion - 1] - m_alsMargin[m_alsRegion - 1] || intensity > m_alsBorder[m_alsRegion] + m_alsMargin[m_alsRegion])
+    // the region before this sample moves it, which is what the sampling rate goes by
+    if (!m_alsEstimator.inRegion(intensity))
     {
         if (!m_alsFastRate)
         {
@@ -378,35 +350,16 @@ bool AmbientLightSensor::updateAls(int intensity)
             m_alsCountInRegion++;
     }
 
-    if (m_alsSampleCount == m_alsSamplesNeeded) {
-        // sample count is now the required sample size, estimate ALS region
-        while (m_alsRegion > ALS_REGION_DARK && (m_alsSum / ALS_SAMPLE_SIZE)
-                < (m_alsBorder[m_alsRegion - 1] - m_alsMargin[m_alsRegion - 1])) {
-            --m_alsRegion;
-        }
+    m_alsEstimator.addSample(intensity);
+    m_alsRegion = m_alsEstimator.region();
 
-        while (m_alsRegion < ALS_REGION_OUTDOOR && (m_alsSum / ALS_SAMPLE_SIZE)
-                > (m_alsBorder[m_alsRegion] + m_alsMargin[m_alsRegion])) {
-            ++m_alsRegion;
-        }
-    }
+    // the brightness follows every reading, not just the region
+    DisplayManager::instance()->handleAlsSample(intensity);
 
 end:
 
-    if (m_alsSubscriptions > 0) {
-        gchar *status = g_strdup_printf(
-                "{\"returnValue\":true,\"current\":%i,\"region\":%i}",
-                intensity, m_alsRegion);
-
-        if (NULL != status)
-            result = LSSubscriptionReply(m_service, "/control/status", status,
-                    &lserror);
-        if (!result) {
-            LSErrorPrint(&lserror, stderr);
-            LSErrorFree(&lserror);
-        }
-        g_free(status);
-    }
+    if (m_alsSubscriptions > 0)
+        postStatus(intensity);
 
     // if there was no change return false, no need to update anything
     return (m_alsRegion != current);
@@ -415,6 +368,29 @@ end:
 #endif
 }
 
+void AmbientLightSensor::postStatus (int intensity)
+{
+    // every region change, and in between a reading now and then; not one for every sample
+    uint32_t now = Time::curTimeMs();
+    if (m_alsRegion == m_alsLastReplyRegion && m_alsLastReplyMs != 0
+        && now - m_alsLastReplyMs < m_alsReplyIntervalMs)
+        return;
+
+    m_alsLastReplyMs = now ? now : 1;
+    m_alsLastReplyRegion = m_alsRegion;
+
+    char status[64];
+    snprintf(status, sizeof(status), "{\"returnValue\":true,\"current\":%i,\"region\":%i}",
+             intensity, m_alsRegion);
+
+    LSError lserror;
+    LSErrorInit(&lserror);
+    if (!LSSubscriptionReply(m_service, "/control/status", status, &lserror)) {
+        LSErrorPrint(&lserror, stderr);
+        LSErrorFree(&lserror);
+    }
+}
+
 /*!
 \page com_palm_ambient_light_sensor_control
 \n
@@ -443,6 +419,8 @@ Get status and optionally enable or disable the ambient light sensor.
     "returnValue": boolean,
     "current": int,
     "average": int,
+    "minimum": int,
+    "maximum": int,
     "disabled": boolean,
     "subscribed": boolean
 }
@@ -450,7 +428,9 @@ Get status and optionally enable or disable the ambient light sensor.
 
 \param returnValue Indicates if the call was succesful.
 \param current Current value of the ambient light sensor.
-\param average Average value of the ambient light sensor.
+\param average Average value of the ambient light sensor, over the last 10 readings.
+\param minimum Lowest of the last 10 readings.
+\param maximum Highest of the last 10 readings.
 \param disabled True if ambient light sensor is disabled.
 \param subscribed True if subscribed to receive status updates.
 
@@ -472,6 +452,8 @@ Get status and optionally enable or disable the ambient light sensor.
 \li 3: Indoor
 \li 4: Outdoor
 
+An update is sent when the region changes, and otherwise at most once a second.
+
 \subsection com_palm_ambient_light_sensor_control_status_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.ambientLightSensor/control/status '{ "subscribe": true, "disableALS": false }'
@@ -483,6 +465,8 @@ Example response for a succesful call:
     "returnValue": true,
     "current": 6,
     "average": 187,
+    "minimum": 6,
+    "maximum": 412,
     "disabled": true,
     "subscribed": true
 }
@@ -558,10 +542,10 @@ bool AmbientLightSensor::controlStatus(LSHandle *sh, LSMessage *message, void *c
             als->m_alsDisabled++;
     }
 
-    int ptr = (als->m_alsPointer + als->m_alsSamplesNeeded - 1) % als->m_alsSamplesNeeded;
-    gchar *status = g_strdup_printf ("{\"returnValue\":true,\"current\":%i,\"average\":%i,\"disabled\":%s,\"subscribed\":%s}",
-            als->m_alsValue[ptr], als->m_alsSum / als->m_alsSamplesNeeded, als->m_alsDisabled > 0 ? "true" : "false", 
-            subscribed ? "true" : "false");
+    const AlsRegionEstimator& window = als->m_alsEstimator;
+    gchar *status = g_strdup_printf ("{\"returnValue\":true,\"current\":%i,\"average\":%i,\"minimum\":%i,\"maximum\":%i,\"disabled\":%s,\"subscribed\":%s}",
+            window.last(), window.average(), window.minimum(), window.maximum(),
+            als->m_alsDisabled > 0 ? "true" : "false", subscribed ? "true" : "false");
 
     if (NULL != status)
         result = LSMessageReply(sh, message, status, &lserror);
@@ -25,17 +25,8 @@
 #include "Common.h"
 
 #include "lunaservice.h"
-#include <list>
 
-#define ALS_INIT_SAMPLE_SIZE   10
-#define ALS_SAMPLE_SIZE 	   10
-#define ALS_REGION_COUNT       5
-
-#define ALS_REGION_UNDEFINED  0
-#define ALS_REGION_DARK       1
-#define ALS_REGION_DIM        2
-#define ALS_REGION_INDOOR     3
-#define ALS_REGION_OUTDOOR    4
+#include "AlsRegionEstimator.h"
 
 
 class AmbientLightSensor
@@ -53,6 +44,9 @@ public:
     bool start ();
     bool stop ();
 
+    // status subscribers get every region change, and otherwise a reading at most this often (0: every one)
+    void setReplyIntervalMs (uint32_t intervalMs);
+
     static bool controlStatus(LSHandle *sh, LSMessage *message, void *ctx);
     static bool cancelSubscription(LSHandle *sh, LSMessage *message, void *ctx);
     static bool hiddServiceNotification(LSHandle *sh, const char *serviceName, bool connected, void *ctx);
@@ -62,23 +56,18 @@ private:
     LSHandle*              m_service;
     bool                   m_alsEnabled;
     bool                   m_alsIsOn;
-    int32_t                m_alsValue[ALS_SAMPLE_SIZE];
-    int32_t                m_alsBorder[ALS_REGION_COUNT];
-    int32_t                m_alsMargin[ALS_REGION_COUNT];
-    int32_t                m_alsPointer;
+    AlsRegionEstimator     m_alsEstimator;
     int32_t                m_alsRegion;
-    int32_t                m_alsSum;
     uint32_t               m_alsLastOff;
     bool                   m_alsDisplayOn;
     int32_t                m_alsSubscriptions;
     int32_t                m_alsDisabled;
     bool                   m_alsHiddOnline;
     bool                   m_alsFastRate;
-    int32_t                m_alsSampleCount;
     int32_t                m_alsCountInRegion;
-    int32_t                m_alsSamplesNeeded;
-    uint32_t               m_alsLastSampleTs;
-    std::list<int32_t>	   m_alsSampleList;
+    uint32_t               m_alsReplyIntervalMs;
+    uint32_t               m_alsLastReplyMs;
+    int32_t                m_alsLastReplyRegion;
 
     static AmbientLightSensor * m_instance;
 
@@ -86,6 +75,7 @@ private:
     bool off ();
 
     bool updateAls (int intensity);
+    void postStatus (int intensity);
 };
 
 #endif /* AMBIENTLIGHTSENSOR_H */
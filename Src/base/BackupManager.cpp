@@ -26,6 +26,7 @@
 #include "Settings.h"
 #include "HostBase.h"
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
 #include "Logging.h"
 #include <cjson/json.h>
 
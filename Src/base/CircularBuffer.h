@@ -22,6 +22,8 @@
 #ifndef CIRCULARBUFFER_H_
 #define CIRCULARBUFFER_H_
 
+#include <stddef.h>
+
 
 template<typename T>
 struct CircularBuffer
@@ -72,6 +74,30 @@ struct CircularBuffer
 	}
     }
     
+    // samples held, at most the buffer size
+    int Count() const
+    {
+        if (!Buffer)
+            return 0;
+        return SampleCount < BufferSize ? SampleCount : BufferSize;
+    }
+
+    bool Full() const
+    {
+        return Buffer && SampleCount >= BufferSize;
+    }
+
+    // Age 0 is the newest sample, Count() - 1 the oldest
+    const T& SampleAt(int Age) const
+    {
+        return Buffer[(CurrentIndex - Age + BufferSize) % BufferSize].Data;
+    }
+
+    T& SampleAt(int Age)
+    {
+        return Buffer[(CurrentIndex - Age + BufferSize) % BufferSize].Data;
+    }
+
     const T& LastSample()
     {
         if (!Buffer)
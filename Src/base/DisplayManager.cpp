@@ -25,11 +25,14 @@
 #include "DisplayStates.h"
 #include "HostBase.h"
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
 #include "Preferences.h"
+#include "LunaConf.h"
 #include "Settings.h"
 #include "SystemService.h"
 #include "Time.h"
 #include "BootManager.h"
+#include "UserActivityTracker.h"
 
 #ifdef HAS_NYX
 #include <nyx/nyx_client.h>
@@ -96,6 +99,8 @@
 #define POWER_KEY_BLOCK_SUBSCRIPTION_KEY "PKBSK"
 #define PROXIMITY_SUBSCRIPTION_KEY "PESK"
 
+#define BRIGHTNESS_RAMP_INTERVAL_MS 100
+
 #define SLIDER_TIMEOUT 1500
 #define SLIDER_MINTIME 200
 #define ALERT_TIMEOUT  6000
@@ -105,6 +110,67 @@
 
 DisplayManager* DisplayManager::m_instance = NULL;
 
+struct AdaptiveBrightnessConf {
+    int smoothing;
+    int ramp;
+    int threshold;
+    AdaptiveBrightness::Point curve[AdaptiveBrightness::MaxPoints];
+    int points;
+};
+
+static void readAdaptiveBrightnessKeys(GKeyFile* keyfile, const char* path, void* data)
+{
+    AdaptiveBrightnessConf* conf = static_cast<AdaptiveBrightnessConf*>(data);
+
+    lunaConfInteger(keyfile, "Display", "BrightnessSmoothingPercent", conf->smoothing);
+    lunaConfInteger(keyfile, "Display", "BrightnessRampPerSecond", conf->ramp);
+    lunaConfInteger(keyfile, "Display", "BrightnessThresholdPercent", conf->threshold);
+
+    // the two lists go together, so a file has to have both to replace the curve
+    gsize luxCount = 0;
+    gsize scaleCount = 0;
+    gint* lux = g_key_file_get_integer_list(keyfile, "Display", "BrightnessCurveLux", &luxCount, NULL);
+    gint* scale = g_key_file_get_integer_list(keyfile, "Display", "BrightnessCurveScale", &scaleCount, NULL);
+    if (lux && scale) {
+        if (luxCount != scaleCount || luxCount > AdaptiveBrightness::MaxPoints) {
+            g_warning("%s: %s has %u lux and %u scale points, expecting the same number, at most %d",
+                      __FUNCTION__, path, (unsigned int) luxCount, (unsigned int) scaleCount,
+                      (int) AdaptiveBrightness::MaxPoints);
+        }
+        else {
+            for (gsize j = 0; j < luxCount; j++) {
+                conf->curve[j].lux = lux[j];
+                conf->curve[j].scale = scale[j];
+            }
+            conf->points = (int) luxCount;
+        }
+    }
+    g_free(lux);
+    g_free(scale);
+}
+
+// [Display] Brightness* of the adaptive brightness in luna.conf. Without a BrightnessCurveLux/BrightnessCurveScale
+// pair, the curve goes through the region scales.
+static void readAdaptiveBrightness(AdaptiveBrightness& brightness)
+{
+    AdaptiveBrightnessConf conf;
+    conf.smoothing = AdaptiveBrightness::DefaultSmoothingPercent;
+    conf.ramp = AdaptiveBrightness::DefaultRampPerSecond;
+    conf.threshold = AdaptiveBrightness::DefaultThresholdPercent;
+    conf.points = 0;
+    readLunaConf(readAdaptiveBrightnessKeys, &conf);
+
+    brightness.setSmoothing(conf.smoothing);
+    brightness.setRamp(conf.ramp);
+    brightness.setThreshold(conf.threshold);
+
+    // setCurve() says what is wrong with a curve it refuses
+    if (conf.points == 0 || !brightness.setCurve(conf.curve, conf.points))
+        brightness.setRegionScales(Settings::LunaSettings()->backlightDarkScale,
+                                   Settings::LunaSettings()->backlightDimScale,
+                                   Settings::LunaSettings()->backlightOutdoorScale);
+}
+
 double DisplayManager::s_currentLatitude = 0.0;
 double DisplayManager::s_currentLongitude = 0.0;
 
@@ -136,12 +202,14 @@ static LSMethod publicDisplayMethods[] = {
  * - \ref com_palm_display_control_set_property
  * - \ref com_palm_display_control_get_property
  * - \ref com_palm_display_control_status
+ * - \ref com_palm_display_control_transitions
  */
 static LSMethod privateDisplayMethods[] = {
     {"setState", DisplayManager::controlSetState},
     {"setProperty", DisplayManager::controlSetProperty},
     {"getProperty", DisplayManager::controlGetProperty},
     {"status", DisplayManager::controlStatus},
+    {"transitions", DisplayManager::controlTransitions},
 //    {"setCallStatus", DisplayManager::controlCallStatus},
     {},
 };
@@ -199,6 +267,7 @@ DisplayManager::DisplayManager()
     , m_power(new Timer<DisplayManager>(HostBase::instance()->masterTimer(), this, &DisplayManager::power))
     , m_slider(new Timer<DisplayManager>(HostBase::instance()->masterTimer(), this, &DisplayManager::slider))
     , m_alertTimer(new Timer<DisplayManager>(HostBase::instance()->masterTimer(), this, &DisplayManager::alertTimerCallback))
+    , m_brightnessRamp(new Timer<DisplayManager>(HostBase::instance()->masterTimer(), this, &DisplayManager::brightnessRampStep))
     , m_maxBrightness(DEFAULT_BRIGHTNESS)
     , m_currentState (NULL)
     , m_displayStates (NULL)
@@ -206,6 +275,8 @@ DisplayManager::DisplayManager()
     , m_homeKeyDown(false)
     , m_suspendBlocker(HostBase::instance()->mainLoop(),
                        this, &DisplayManager::allowSuspend, &DisplayManager::setSuspended)
+    , m_pendingDisplayBrightness(0)
+    , m_pendingKeyBrightness(0)
     , m_powerKeyPressEventScheduled(false)
 {
     GMainLoop* mainLoop = HostBase::instance()->mainLoop();
@@ -363,6 +434,7 @@ DisplayManager::DisplayManager()
 
     // initialize als
     m_als = new AmbientLightSensor ();
+    readAdaptiveBrightness (m_adaptiveBrightness);
 
 #if defined(HAS_LUNA_PREF)
     char *build = NULL;
@@ -2018,25 +2090,9 @@ int32_t DisplayManager::getDisplayBrightness()
 	    b -= 10;
     }
 
-    if (Preferences::instance()->isAlsEnabled()) {
-		int region = m_als->getCurrentRegion ();
-
-		switch (region)
-		{
-		case ALS_REGION_OUTDOOR:
-			b = Settings::LunaSettings()->backlightOutdoorScale * b / 100;
-			break;
-		case ALS_REGION_DIM:
-			b = Settings::LunaSettings()->backlightDimScale * b / 100;
-			break;
-		case ALS_REGION_DARK:
-			b = Settings::LunaSettings()->backlightDarkScale * b / 100;
-			break;
-		default:
-			// for all other cases, we use b directly
-			break;
-		}
-    }
+    // the scale follows the light along the curve, see handleAlsSample()
+    if (Preferences::instance()->isAlsEnabled())
+		b = m_adaptiveBrightness.scale() * b / 100;
 
     if (b < MINIMUM_ON_BRIGHTNESS)
 	b = MINIMUM_ON_BRIGHTNESS;
@@ -2096,6 +2152,24 @@ int32_t DisplayManager::getKeypadBrightness()
     return b;
 }
 
+void DisplayManager::handleAlsSample (int32_t lux)
+{
+    if (!Preferences::instance()->isAlsEnabled())
+        return;
+
+    if (m_adaptiveBrightness.addSample (lux, Time::curTimeMs()) && !m_brightnessRamp->running())
+        m_brightnessRamp->start (BRIGHTNESS_RAMP_INTERVAL_MS);
+}
+
+bool DisplayManager::brightnessRampStep ()
+{
+    // goes to the states as an ALS change, which the ones with the display on apply
+    if (m_adaptiveBrightness.step (Time::curTimeMs()))
+        updateState (DISPLAY_EVENT_ALS_REGION_CHANGED);
+
+    return m_adaptiveBrightness.ramping();
+}
+
 bool DisplayManager::updateBrightness ()
 {
     m_currentState->handleEvent (DisplayEventUpdateBrightness);
@@ -2116,6 +2190,8 @@ bool DisplayManager::setMaximumBrightness (int maxBrightness, bool save)
 			|| currentState() == DisplayStateDockMode) {
 		// set the new max brightness
 		m_maxBrightness = maxBrightness;
+		// the user's change goes out as is, not half way through a ramp
+		m_adaptiveBrightness.settle();
 		// update the brightness directly
 		backlightOn (getDisplayBrightness(), getKeypadBrightness(), false);
 		// update navi brightness
@@ -2311,6 +2387,124 @@ bool DisplayManager::controlStatus(LSHandle *sh, LSMessage *message, void *ctx)
     return true;
 }
 
+/*!
+\page com_palm_display_control
+\n
+\section com_palm_display_control_transitions transitions
+
+\e Private.
+
+com.palm.display/control/transitions
+
+Get the last display state changes, oldest first, for debugging.
+
+\subsection com_palm_display_control_transitions_syntax Syntax:
+\code
+{
+}
+\endcode
+
+\subsection com_palm_display_control_transitions_returns Returns:
+\code
+{
+    "returnValue": boolean,
+    "recorded": int,
+    "transitions": [
+        {
+            "time": int,
+            "event": string,
+            "from": string,
+            "to": string,
+            "guards": int,
+            "latency": int
+        }
+    ]
+}
+\endcode
+
+\param returnValue Indicates if the call was succesful.
+\param recorded Number of state changes since sysmgr started. Only the last 64 are kept.
+\param time When the state changed, in ms.
+\param event The event that changed it.
+\param from State before the change.
+\param to State after the change.
+\param guards What held when the state changed: 1 on a call, 2 on the puck, 4 unlocked, 8 backlight on.
+\param latency Time in ms from the change to the backlight following it: coming on (or dimming) for the
+on, dim and dock states, going off for the off ones. Left out if it did not, or another change came first.
+
+\subsection com_palm_display_control_transitions_examples Examples:
+\code
+luna-send -n 1 -f luna://com.palm.display/control/transitions '{}'
+\endcode
+
+Example response for a succesful call:
+\code
+{
+    "returnValue": true,
+    "recorded": 2,
+    "transitions": [
+        {
+            "time": 61250,
+            "event": "powerKeyPress",
+            "from": "off",
+            "to": "onLocked",
+            "guards": 0,
+            "latency": 38
+        },
+        {
+            "time": 90312,
+            "event": "timeout",
+            "from": "onLocked",
+            "to": "off",
+            "guards": 8,
+            "latency": 104
+        }
+    ]
+}
+\endcode
+*/
+bool DisplayManager::controlTransitions(LSHandle *sh, LSMessage *message, void *ctx)
+{
+    EMPTY_SCHEMA_RETURN(sh, message);
+
+    LSError lserror;
+    LSErrorInit(&lserror);
+
+    DisplayManager *dm = ((DisplayCallbackCtx_t *)ctx)->ctx;
+    const DisplayTransitionTracer& tracer = dm->m_transitions;
+
+    json_object* reply = json_object_new_object();
+    json_object* transitions = json_object_new_array();
+
+    for (int age = tracer.count() - 1; age >= 0; age--) {
+        const DisplayTransitionTracer::Transition& transition = tracer.at(age);
+
+        json_object* entry = json_object_new_object();
+        json_object_object_add(entry, "time", json_object_new_int(transition.timeMs));
+        json_object_object_add(entry, "event", json_object_new_string(DisplayTransitions::eventName(transition.event)));
+        json_object_object_add(entry, "from", json_object_new_string(DisplayTransitions::stateName(transition.from)));
+        json_object_object_add(entry, "to", json_object_new_string(DisplayTransitions::stateName(transition.to)));
+        json_object_object_add(entry, "guards", json_object_new_int(transition.guards));
+        if (transition.latencyMs >= 0)
+            json_object_object_add(entry, "latency", json_object_new_int(transition.latencyMs));
+        json_object_array_add(transitions, entry);
+    }
+
+    json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
+    json_object_object_add(reply, "recorded", json_object_new_int(tracer.recorded()));
+    json_object_object_add(reply, "transitions", transitions);
+
+    if (!LSMessageReply(sh, message, json_object_to_json_string(reply), &lserror))
+    {
+        LSErrorPrint (&lserror, stderr);
+        LSErrorFree (&lserror);
+    }
+
+    json_object_put(reply);
+
+    return true;
+}
+
 DisplayManager::~DisplayManager()
 {
     LSError lserror;
@@ -2606,6 +2800,11 @@ void DisplayManager::backlightOn (int displayBrightness, int keyBrightness, bool
 {
     LSError lserror;
 
+    // light changes that end up at the brightness already set need no calls
+    if (als && m_backlightIsOn && displayBrightness == m_pendingDisplayBrightness
+        && keyBrightness == m_pendingKeyBrightness)
+        return;
+
     m_pendingDisplayBrightness = displayBrightness;
     m_pendingKeyBrightness = keyBrightness;
 
@@ -2636,6 +2835,8 @@ bool DisplayManager::displayBlankedCallback(LSHandle *service, LSMessage *messag
                 dm->m_pendingDisplayBrightness, NULL, NULL);
     }
 
+    dm->m_transitions.backlightChanged (Time::curTimeMs(), true);
+
     return true;
 }
 
@@ -2758,6 +2959,7 @@ void DisplayManager::backlightOffCallback (void *ctx)
     g_message("%s setting m_backlightIsOn to false", __PRETTY_FUNCTION__);
     DisplayManager *dm = (DisplayManager *)ctx;
     dm->m_backlightIsOn = false;
+    dm->m_transitions.backlightChanged (Time::curTimeMs(), false);
 
     LSError lserror;
     LSErrorInit(&lserror);
@@ -3115,9 +3317,10 @@ bool DisplayManager::isOn() const
 }
 
 
-void DisplayManager::changeDisplayState (DisplayState newState, DisplayState oldState, DisplayEvent displayEvent, sptr<Event> event)
+void DisplayManager::changeDisplayState (DisplayState newState, DisplayState oldState, DisplayEvent displayEvent, sptr<Event> event, uint32_t guards)
 {
     m_lastEvent = Time::curTimeMs();
+    m_transitions.record (m_lastEvent, displayEvent, oldState, newState, guards);
     m_currentState = m_displayStates[newState];
 
     switch (newState) {
@@ -3198,6 +3401,10 @@ void DisplayManager::displayOn(bool als)
 {
     m_displayOn = true;
 
+    // coming on, there is nothing to ramp from
+    if (!als)
+        m_adaptiveBrightness.settle();
+
 	if (!als) {
 		// If display is "turned on" due to ALS/brightness
 		// change, we shouldn't notify the subscribers
@@ -3236,6 +3443,8 @@ void DisplayManager::displayDim()
     notifySubscribers (DISPLAY_EVENT_DIMMED);
 
     m_als->stop();
+    m_brightnessRamp->stop();
+    m_adaptiveBrightness.restart();
 }
 
 
@@ -3255,18 +3464,32 @@ void DisplayManager::displayOff()
     // CoreNaviManager::instance()->updateBrightness (0);
 
     m_als->stop();
+    m_brightnessRamp->stop();
+    m_adaptiveBrightness.restart();
 
 }
 
-void DisplayManager::handleTouchEvent()
+void DisplayManager::handleTouchEvent(uint32_t eventTimeMs)
 {
-    m_lastEvent = Time::curTimeMs();
-    if (currentState() == DisplayStateDim) {
+    m_lastEvent = eventTimeMs;
+
+    DisplayState state = currentState();
+    UserActivityTracker::TouchEdge edge = UserActivityTracker::touchEdge(state == DisplayStateDim,
+            state == DisplayStateOn || state == DisplayStateOnPuck, m_activity->running());
+    if (edge == UserActivityTracker::TouchEdgeNone)
+        return;
+
+    if (edge == UserActivityTracker::TouchEdgeWake) {
         g_message("%s: sending user activity event", __PRETTY_FUNCTION__);
         m_currentState->handleEvent(DisplayEventUserActivity);
+
+        // woken once per touch at most, whatever state that left
+        state = currentState();
+        edge = UserActivityTracker::touchEdge(false,
+                state == DisplayStateOn || state == DisplayStateOnPuck, m_activity->running());
     }
 
-    if ((currentState() == DisplayStateOn || currentState() == DisplayStateOnPuck) && !m_activity->running()) {
+    if (edge == UserActivityTracker::TouchEdgeStartActivity) {
         m_activity->start(m_activityTimeout);
         notifySubscribers(DISPLAY_EVENT_ACTIVE);
     }
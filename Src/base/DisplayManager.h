@@ -28,8 +28,10 @@
 #include "Mutex.h"
 #include "Event.h"
 #include "sptr.h"
+#include "AdaptiveBrightness.h"
 #include "AmbientLightSensor.h"
 #include "DisplayStates.h"
+#include "DisplayTransitions.h"
 #include "SuspendBlocker.h"
 
 #include <QEvent>
@@ -110,7 +112,10 @@ public:
     void handlePowerKey(bool pressed);
 
     void handleDisplayEvent(DisplayEvent event);
-    void handleTouchEvent();
+    // user activity on the touchpanel, at eventTimeMs (Time::curTimeMs())
+    void handleTouchEvent(uint32_t eventTimeMs);
+    // a light reading from the ALS, in lux
+    void handleAlsSample(int32_t lux);
 
     bool alert (int state);
     uint32_t getCoreNaviBrightness();
@@ -129,6 +134,7 @@ public:
     static bool controlGetProperty(LSHandle *sh, LSMessage *message, void *ctx);
     static bool controlSetProperty(LSHandle *sh, LSMessage *message, void *ctx);
     static bool controlCallStatus(LSHandle *sh, LSMessage *message, void *ctx);
+    static bool controlTransitions(LSHandle *sh, LSMessage *message, void *ctx);
 
     // service callbacks
     static bool timeoutCallback(LSHandle *sh, LSMessage *message, void *ctx);
@@ -258,13 +264,16 @@ private:
     Timer<DisplayManager>* m_power;
     Timer<DisplayManager>* m_slider;
     Timer<DisplayManager>* m_alertTimer;
+    Timer<DisplayManager>* m_brightnessRamp;
     int32_t                m_maxBrightness;
+    AdaptiveBrightness     m_adaptiveBrightness;
 
     std::string 	   m_puckId;
 
     DisplayStateBase* m_currentState;
     DisplayStateBase** m_displayStates;
     DisplayLockState  m_lockState;
+    DisplayTransitionTracer m_transitions;
 
     SuspendBlocker<DisplayManager> m_suspendBlocker;
 
@@ -282,6 +291,7 @@ private:
     bool power();
     bool slider();
     bool alertTimerCallback();
+    bool brightnessRampStep();
     bool updateTimeout(int timeoutInMs);
     bool setTimeout (int timeout);
     bool notifySubscribers(int type, sptr<Event> event = 0);
@@ -293,7 +303,7 @@ private:
 
     friend class DisplayStateBase;
 
-    void	changeDisplayState (DisplayState newDisplayState, DisplayState oldDisplayState, DisplayEvent displayEvent, sptr<Event> event);
+    void	changeDisplayState (DisplayState newDisplayState, DisplayState oldDisplayState, DisplayEvent displayEvent, sptr<Event> event, uint32_t guards);
     void	updateLockState (DisplayLockState lockState, DisplayState state, DisplayEvent displayEvent);
     // used by DisplayStateBase class to change current state
 
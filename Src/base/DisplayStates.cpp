@@ -24,6 +24,7 @@
 #include "HostBase.h"
 #include "DisplayStates.h"
 #include "DisplayManager.h"
+#include "DisplayTransitions.h"
 #include "SystemService.h"
 #include "Preferences.h"
 #include "Time.h"
@@ -269,12 +270,57 @@ void DisplayStateBase::changeDisplayState (DisplayState displayState, DisplayEve
     if (displayState >= DisplayStateMax)
 	return;
 
+    // the guards as they were when the move was decided, whichever path decided it
+    uint32_t currentGuards = guards();
+
     leave (displayState, displayEvent, event);
 
-    dm->changeDisplayState (displayState, currentState, displayEvent, event);
+    dm->changeDisplayState (displayState, currentState, displayEvent, event, currentGuards);
     return;
 }
 
+uint32_t DisplayStateBase::guards()
+{
+    uint32_t guards = 0;
+
+    if (isOnCall())
+        guards |= DisplayGuardOnCall;
+    if (isOnPuck())
+        guards |= DisplayGuardOnPuck;
+    if (isDisplayUnlocked())
+        guards |= DisplayGuardUnlocked;
+    if (isBacklightOn())
+        guards |= DisplayGuardBacklightOn;
+
+    return guards;
+}
+
+bool DisplayStateBase::applyTransition (DisplayEvent displayEvent, sptr<Event> event)
+{
+    DisplayState currentState = state();
+    if (!DisplayTransitions::handles (currentState, displayEvent))
+        return false;
+
+    // the predicates are asked once per event, not once per branch
+    uint32_t currentGuards = guards();
+    DisplayState newState;
+    if (!DisplayTransitions::lookup (currentState, displayEvent, currentGuards, newState))
+        return false;
+
+    if (newState == currentState) {
+        g_message ("%s: %s in %s (guards 0x%x), staying", __PRETTY_FUNCTION__,
+                   DisplayTransitions::eventName (displayEvent), DisplayTransitions::stateName (currentState),
+                   currentGuards);
+        return true;
+    }
+
+    g_debug ("%s: %s in %s (guards 0x%x), moving to %s", __PRETTY_FUNCTION__,
+             DisplayTransitions::eventName (displayEvent), DisplayTransitions::stateName (currentState),
+             currentGuards, DisplayTransitions::stateName (newState));
+    changeDisplayState (newState, displayEvent, event);
+    return true;
+}
+
 void DisplayStateBase::updateLockState (DisplayLockState lockState, DisplayEvent displayEvent) 
 {
     if (!dm)
@@ -307,141 +353,23 @@ void DisplayOff::enter (DisplayState state, DisplayEvent displayEvent, sptr<Even
 
 void DisplayOff::handleEvent (DisplayEvent displayEvent, sptr<Event> event) 
 {
-    switch (displayEvent) {
-	case DisplayEventPowerKeyPress:
-	    if (isBacklightOn()) {
-		g_warning ("backlight not off yet, debouncing power key");
-		break;
-	    }
-	    if (isOnPuck()) {
-		if (isDisplayUnlocked() || isOnCall()) {
-		    g_message ("%s: power key press while display %s (usb %s slider %s disable locking %s) and phonecall %s, moving to OnPuck", __PRETTY_FUNCTION__,
-			    (isDisplayUnlocked()) ? "unlocked" : "locked", 
-			    (isUSBCharging()) ? "connected" : "disconnected",
-			    (isSliderOpen()) ? "open" : "closed",
-			    (Settings::LunaSettings()->disableLocking) ? "set" : "unset",
-			    (isOnCall()) ? "on" : "off");
-		    changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-		}
-		else {
-		    g_debug ("%s: power key press when on puck, move to dock mode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-		}
-	    }
-	    else if (isDisplayUnlocked() || isOnCall()) {
-		g_message ("%s: power key press while display %s (usb %s slider %s disable locking %s) and phonecall %s, moving to on", __PRETTY_FUNCTION__,
-			(isDisplayUnlocked()) ? "unlocked" : "locked", 
-			(isUSBCharging()) ? "connected" : "disconnected",
-			(isSliderOpen()) ? "open" : "closed",
-			(Settings::LunaSettings()->disableLocking) ? "set" : "unset",
-			(isOnCall()) ? "on" : "off");
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    else  {
-		g_debug ("%s: power key press, moving to OnLocked", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventPowerKeyHold:
-	    if (isOnPuck()) {
-		g_debug ("%s: power key hold on puck, moving to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else if (isDisplayUnlocked()) {
-		g_debug ("%s: power key hold, moving to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    else  {
-		g_debug ("%s: power key hold, moving to OnLocked", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventOnPuck:
-	    if (isOnCall() || isDisplayUnlocked()) {
-		g_debug ("%s: on puck on a call, moving to onpuck", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: on puck, moving to dock mode", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateDockMode, displayEvent, event);
-	    }
-	    break;
+    // the moves out of Off are all rows of the transition table
+    if (applyTransition (displayEvent, event))
+        return;
 
+    switch (displayEvent) {
 	case DisplayEventOffPuck:
 	    g_debug ("%s: off puck received in Off state, staying off", __PRETTY_FUNCTION__);
 	    break;
 
-	case DisplayEventUsbIn:
-	    if (isOnPuck()) {
-		g_debug ("%s: usb in when on puck, move to on puck", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: usb in, moving to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventUsbOut:
-	    break;
-
-	case DisplayEventIncomingCall:
-	    if (isOnPuck()) {
-		g_debug ("%s: incoming call when on puck, move to OnPuck", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: incoming call, moving to on / onlocked", __PRETTY_FUNCTION__);
-		if (isDisplayUnlocked())
-		    changeDisplayState (DisplayStateOn, displayEvent, event);
-		else 
-		    changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-
-	    break;
-
 	case DisplayEventIncomingCallDone:
 	    g_warning ("%s: incoming call done, should never happen", __PRETTY_FUNCTION__);
 	    break;
 
-	case DisplayEventOnCall:
-	    if (isOnPuck()) {
-		g_debug ("%s: on call on puck, move to OnPuck", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else if (isDisplayUnlocked()) {
-		g_debug ("%s: on call, moving to On", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: on call, moving to OnLocked", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-	    break;
-
 	case DisplayEventOffCall:
 	    g_warning ("%s: off call - invalid event, should be OffOnCall", __PRETTY_FUNCTION__);
 	    break;
 
-	case DisplayEventSliderOpen:
-	    if (isOnPuck()) {
-		g_debug ("%s: slider open when on puck, move to OnPuck", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: slider open, moving to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventSliderClose:
-	    break;
-
-	case DisplayEventAlsChange:
-	    break;
-
 	case DisplayEventProximityOn:
 	    g_warning ("%s: proximity on event received in off state - invalid event, should be OffOnCall", __PRETTY_FUNCTION__);
 	    break;
@@ -450,110 +378,6 @@ void DisplayOff::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
 	    g_warning ("%s: proximity off event received in off state - invalid event, should be OffOnCall", __PRETTY_FUNCTION__);
 	    break;
 
-	case DisplayEventApiOn:
-	    if (isOnPuck()) {
-		    if (isOnCall()) {
-			    g_debug ("%s: public api on called when on puck on call, move to on puck", __PRETTY_FUNCTION__);
-			    changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-		    }
-		    else {
-			    g_debug ("%s: public api on called when on puck, move to dock mode", __PRETTY_FUNCTION__);
-			    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-		    }
-	    }
-	    else if (isDisplayUnlocked()) {
-		g_debug ("%s: public api on called, move to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: public api on called, move to onLocked", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventApiDim:
-	    break;
-
-	case DisplayEventApiOff:
-	    break;
-
-	case DisplayEventUserActivity:
-	    if (isOnPuck()) {
-		g_debug ("%s: user activity when on puck, move to on puck", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else if (isDisplayUnlocked()) {
-		g_debug ("%s: received user activity when display is off and unlocked, moving to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    else {
-		g_debug ("%s: received user activity when display is off and locked, moving to onlocked", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventUserActivityExternalInput:
-	    if (isOnPuck()) {
-			g_debug ("%s: external input user activity when on puck, move to on puck", __PRETTY_FUNCTION__);
-			changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    }
-	    else  {
-			g_debug ("%s: external input user activity, moving to on", __PRETTY_FUNCTION__);
-			changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    break;		
-
-	case DisplayEventHomeKeyPress:
-	    if (isOnPuck()) {
-		if (isDisplayUnlocked() || isOnCall()) {
-		    g_message ("%s: home key press while display %s (usb %s slider %s disable locking %s) and phonecall %s, moving to OnPuck", __PRETTY_FUNCTION__,
-			    (isDisplayUnlocked()) ? "unlocked" : "locked", 
-			    (isUSBCharging()) ? "connected" : "disconnected",
-			    (isSliderOpen()) ? "open" : "closed",
-			    (Settings::LunaSettings()->disableLocking) ? "set" : "unset",
-			    (isOnCall()) ? "on" : "off");
-		    changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-		}
-		else {
-		    g_debug ("%s: home key press when on puck, move to dock mode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-		}
-	    }
-	    else if (isDisplayUnlocked() || isOnCall()) {
-		g_message ("%s: home key press while display %s (usb %s slider %s disable locking %s) and phonecall %s, moving to on", __PRETTY_FUNCTION__,
-			(isDisplayUnlocked()) ? "unlocked" : "locked", 
-			(isUSBCharging()) ? "connected" : "disconnected",
-			(isSliderOpen()) ? "open" : "closed",
-			(Settings::LunaSettings()->disableLocking) ? "set" : "unset",
-			(isOnCall()) ? "on" : "off");
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-	    }
-	    else  {
-		g_debug ("%s: home key press, moving to OnLocked", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-	    break;
-
-	case DisplayEventUpdateBrightness:
-	    break;
-	case DisplayEventLockScreen:
-	    break;
-	case DisplayEventUnlockScreen:
-	    break;
-	case DisplayEventPowerdSuspend:
-	    g_debug ("%s: received suspend event, going to off suspended", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOffSuspended, displayEvent, event);
-	    break;
-	case DisplayEventPowerdResume:
-	    break;
-	case DisplayEventApiDock:
-	    if (!isOnCall()) {
-		    g_debug ("%s: received dock event, going to dock mode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-	    }
-	    break;
-	case DisplayEventApiUndock:
-	    break;
 	default:
 	    break;
     }
@@ -965,30 +789,14 @@ void DisplayOn::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
     if (displayEvent != DisplayEventAlsChange && displayEvent != DisplayEventUpdateBrightness)
 	startUserInactivityTimer();
 
-    switch (displayEvent) {
-	case DisplayEventPowerKeyPress:
-	    if (!isBacklightOn()) {
-		g_warning ("backlight not on yet, debouncing power key");
-		break;
-	    }
-	    g_debug ("%s: power key down", __PRETTY_FUNCTION__);
-            if (isOnCall())
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            else if (isOnPuck()) 
-                changeDisplayState (DisplayStateDockMode, displayEvent, event);
-            else
-                changeDisplayState (DisplayStateOff, displayEvent, event);
-
-	    break;
+    // the moves out of On are rows of the transition table
+    if (applyTransition (displayEvent, event))
+        return;
 
+    switch (displayEvent) {
 	case DisplayEventPowerKeyHold:
 	    break;
 
-	case DisplayEventOnPuck:
-	    g_debug ("%s: on puck, moving to onpuck", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    break;
-
 	case DisplayEventOffPuck:
 	    g_warning ("%s: off puck received - invalid event", __PRETTY_FUNCTION__);
 	    break;
@@ -1014,31 +822,6 @@ void DisplayOn::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
             displayOn(true);
             break;
 
-	case DisplayEventProximityOn:
-	    g_debug ("%s: proximity on event, moving to OffOnCall", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-	    break;
-
-	case DisplayEventApiDim:
-	    g_debug ("%s: public api dim called, going to dim", __PRETTY_FUNCTION__);
-            changeDisplayState (DisplayStateDim, displayEvent, event);
-	    break;
-
-	case DisplayEventApiOff:
-            if (isOnCall()) {
-                g_debug ("%s: public api off called, going to OffOnCall", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            }
-            else if (isOnPuck()) {
-                g_debug ("%s: public api off called, going to dockmode", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateDockMode, displayEvent, event);
-            }
-            else {
-                g_debug ("%s: public api off called, going to off", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOff, displayEvent, event);
-            }
-	    break;
-
 	case DisplayEventUserActivity:
 	case DisplayEventUserActivityExternalInput:
             break;
@@ -1046,16 +829,6 @@ void DisplayOn::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
             g_debug ("%s: received update brightness event", __PRETTY_FUNCTION__);
             displayOn(false);
             break;
-        case DisplayEventLockScreen:
-	    if (isOnPuck() && !isOnCall()) {
-		    g_debug ("%s: received lock event, going to OnLocked", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-	    }
-	    else {
-		    g_debug ("%s: received lock event, going to Dockmode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-	    }
-            break;
         case DisplayEventUnlockScreen:
             break;
 	case DisplayEventPowerdSuspend:
@@ -1063,12 +836,6 @@ void DisplayOn::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
 	    break;
 	case DisplayEventPowerdResume:
 	    break;
-	case DisplayEventApiDock:
-	    if (!isOnCall()) {
-		    g_debug ("%s: received dock event, going to dock mode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-	    }
-	    break;
 	case DisplayEventApiUndock:
 	    break;
 	case DisplayEventHomeKeyPress:
@@ -1177,38 +944,18 @@ bool DisplayOnLocked::timeout()
 
 void DisplayOnLocked::handleEvent (DisplayEvent displayEvent, sptr<Event> event) 
 {
-    switch (displayEvent) {
-	case DisplayEventPowerKeyPress:
-	    if (!isBacklightOn()) {
-		g_warning ("backlight not on yet, debouncing power key");
-		break;
-	    }
-
-            g_debug ("%s: power key up, moving to off", __PRETTY_FUNCTION__);
-            // if power key timer has not fired, turn display off
-            if (isOnCall())
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            else 
-                changeDisplayState (DisplayStateOff, displayEvent, event);
-            break;
+    // the moves out of OnLocked are rows of the transition table
+    if (applyTransition (displayEvent, event))
+        return;
 
+    switch (displayEvent) {
 	case DisplayEventPowerKeyHold:
 	    break;
 
-	case DisplayEventOnPuck:
-	    g_debug ("%s: on puck, moving to OnPuck", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    break;
-
 	case DisplayEventOffPuck:
 	    g_warning ("%s: off puck received - invalid event", __PRETTY_FUNCTION__);
 	    break;
 
-        case DisplayEventUsbIn:
-	    g_debug ("%s: usb in, restarting activity timer", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOn, displayEvent, event);
-	    break;
-
         case DisplayEventUsbOut:
 	    break;
 
@@ -1224,11 +971,6 @@ void DisplayOnLocked::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
 	case DisplayEventOffCall:
 	    break;
 
-        case DisplayEventSliderOpen:
-	    g_debug ("%s: slider open, going to on", __PRETTY_FUNCTION__);
-            changeDisplayState (DisplayStateOn, displayEvent, event);
-	    break;
-
         case DisplayEventSliderClose:
 	    break;
 
@@ -1237,11 +979,6 @@ void DisplayOnLocked::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
             displayOn(true);
 	    break;
 
-	case DisplayEventProximityOn:
-	    g_debug ("%s: proximity on event, changing to OffOnCall", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-	    break;
-
 	case DisplayEventProximityOff:
 	    g_warning ("%s: proximity off event - invalid event", __PRETTY_FUNCTION__);
 	    break;
@@ -1249,20 +986,8 @@ void DisplayOnLocked::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
 	case DisplayEventApiOn:
 	    break;
 
-	case DisplayEventApiOff:
-	    g_debug ("%s: public api off called, going to Off / OffOnCall", __PRETTY_FUNCTION__);
-	    if (isOnCall())
-		changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-	    else
-                changeDisplayState (DisplayStateOff, displayEvent, event);
-	    break;
-
 	case DisplayEventUserActivity:
 	    break;
-	case DisplayEventUserActivityExternalInput:
-		g_debug ("%s: external input user activity, moving to on", __PRETTY_FUNCTION__);
-		changeDisplayState (DisplayStateOn, displayEvent, event);
-		break;
 
         case DisplayEventUpdateBrightness:
             displayOn(true);
@@ -1270,20 +995,9 @@ void DisplayOnLocked::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
 
         case DisplayEventLockScreen:
             break;
-	case DisplayEventApiDock:
-	    if (!isOnCall()) {
-		    g_debug ("%s: received dock event, going to dock mode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-	    }
-	    break;
 	case DisplayEventApiUndock:
 	    break;
 
-        case DisplayEventUnlockScreen:
-            g_debug ("%s: received unlock event, going to on", __PRETTY_FUNCTION__);
-            changeDisplayState (DisplayStateOn, displayEvent, event);
-            break;
-
 	case DisplayEventPowerdSuspend:
 	    g_warning ("%s: got powerd suspend, invalid event in current state", __PRETTY_FUNCTION__);
 	    break;
@@ -1399,59 +1113,14 @@ void DisplayDim::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
     if (isOnCall() && isOnPuck())
         g_warning ("%s: in dim when on call and on puck, bug!", __PRETTY_FUNCTION__);
 
-    switch (displayEvent) {
-	case DisplayEventPowerKeyPress:
-	    g_debug ("%s: power key press, moving to off/dockmode", __PRETTY_FUNCTION__);
-
-            if (isOnCall()) {
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            }
-            else  {
-                if (isOnPuck())
-                    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-                else
-                    changeDisplayState (DisplayStateOff, displayEvent, event);
-            }
-	    break;
-
-	case DisplayEventPowerKeyHold:
-	    g_debug ("%s: power key hold, moving to on/onpuck", __PRETTY_FUNCTION__);
-            if (isOnPuck())
-                changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-            else
-                changeDisplayState (DisplayStateOn, displayEvent, event);
-	    break;
-
-	case DisplayEventOnPuck:
-	    g_debug ("%s: on puck, moving to on puck", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-	    break;
-
-	case DisplayEventOffPuck:
-	    g_debug ("%s: lifted off puck, moving to on", __PRETTY_FUNCTION__);
-	    changeDisplayState (DisplayStateOn, displayEvent, event);
-	    break;
-
-        case DisplayEventUsbIn:
-	    g_debug ("%s: usb in, going to on / onpuck", __PRETTY_FUNCTION__);
-            if (isOnPuck())
-                changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-            else 
-                changeDisplayState (DisplayStateOn, displayEvent, event);
-
-	    break;
+    // the moves out of Dim are rows of the transition table
+    if (applyTransition (displayEvent, event))
+        return;
 
+    switch (displayEvent) {
         case DisplayEventUsbOut:
 	    break;
 
-        case DisplayEventIncomingCall:
-            g_debug ("%s: incoming call when dim, moving to on/on locked", __PRETTY_FUNCTION__);
-            if (isOnPuck())
-                changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-            else 
-                changeDisplayState (DisplayStateOn, displayEvent, event);
-            break;
-
         case DisplayEventIncomingCallDone:
             break;
 
@@ -1464,76 +1133,16 @@ void DisplayDim::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
         case DisplayEventSliderOpen:
 	    break;
 
-        case DisplayEventSliderClose:
-	    g_debug ("%s: slider close, going to DockMode/OffOnCall/Off", __PRETTY_FUNCTION__);
-            if (isOnCall())
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            else if (isOnPuck())
-                changeDisplayState (DisplayStateDockMode, displayEvent, event);
-            else
-                changeDisplayState (DisplayStateOff, displayEvent, event);
-	    break;
-
 	case DisplayEventAlsChange:
 	    break;
 
-	case DisplayEventProximityOn:
-            if (isOnCall()) {
-                g_debug ("%s: proximity on event, moving to off on call", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            }
-	    break;
-
 	case DisplayEventProximityOff:
 	    g_warning ("%s: proximity off event - invalid event", __PRETTY_FUNCTION__);
 	    break;
 
-	case DisplayEventApiOn:
-            if (isOnPuck()) {
-                g_debug ("%s: public api on called, going to onpuck", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-            }
-            else {
-                g_debug ("%s: public api on called, going to on", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOn, displayEvent, event);
-            }
-	    break;
-
 	case DisplayEventApiDim:
 	    break;
 
-	case DisplayEventApiOff:
-            if (isOnCall()) {
-                g_debug ("%s: public api off called while on call, going to OffOnCall", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOffOnCall, displayEvent, event);
-            }
-            else if (isOnPuck()) {
-                g_debug ("%s: public api off called, going to dockmode", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateDockMode, displayEvent, event);
-            }
-            else {
-                g_debug ("%s: public api off called, going to off", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOff, displayEvent, event);
-            }
-	    break;
-
-	case DisplayEventHomeKeyPress:
-	case DisplayEventUserActivity:
-	case DisplayEventUserActivityExternalInput:
-            if (isOnPuck()) {
-                g_debug ("%s: received key/pen/gesture event, going to onpuck", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOnPuck, displayEvent, event);
-            }
-            else {
-                g_debug ("%s: received key/pen/gesture event, going to on", __PRETTY_FUNCTION__);
-                changeDisplayState (DisplayStateOn, displayEvent, event);
-            }
-            break;
-
-        case DisplayEventLockScreen:
-            g_debug ("%s: lock event received, going to on locked", __PRETTY_FUNCTION__);
-            changeDisplayState (DisplayStateOnLocked, displayEvent, event);
-            break;
         case DisplayEventUnlockScreen:
             break;
 	case DisplayEventPowerdSuspend:
@@ -1541,12 +1150,6 @@ void DisplayDim::handleEvent (DisplayEvent displayEvent, sptr<Event> event)
 	    break;
 	case DisplayEventPowerdResume:
 	    break;
-	case DisplayEventApiDock:
-	    if (!isOnCall()) {
-		    g_debug ("%s: received dock event, going to dock mode", __PRETTY_FUNCTION__);
-		    changeDisplayState (DisplayStateDockMode, displayEvent, event);
-	    }
-	    break;
 	case DisplayEventApiUndock:
 	    break;
 	default:
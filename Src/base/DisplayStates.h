@@ -106,6 +106,11 @@ class DisplayStateBase {
 	void changeDisplayState (DisplayState state, DisplayEvent displayEvent, sptr<Event> event = NULL);
 	void updateLockState (DisplayLockState, DisplayEvent displayEvent);
 
+	// moves as DisplayTransitions has it; false if it has no rows for displayEvent in this state
+	bool applyTransition (DisplayEvent displayEvent, sptr<Event> event = NULL);
+	// the DisplayGuard bits that hold now
+	uint32_t guards();
+
         bool isDisplayUnlocked();
         bool isUSBCharging();
         bool isOnCall();
@@ -0,0 +1,367 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "DisplayTransitions.h"
+
+#include <glib.h>
+
+#define CALL     DisplayGuardOnCall
+#define PUCK     DisplayGuardOnPuck
+#define UNLOCKED DisplayGuardUnlocked
+#define BACKLIGHT DisplayGuardBacklightOn
+
+struct TransitionRule {
+    DisplayState from;
+    DisplayEvent event;
+    uint32_t mask;      // the guards the row looks at
+    uint32_t value;     // ... and how they have to be
+    DisplayState to;
+};
+
+static const TransitionRule sRules[] = {
+
+    // ---------------------- DisplayOff -------------------------------------
+
+    // the backlight still going off: debounce
+    { DisplayStateOff, DisplayEventPowerKeyPress, BACKLIGHT, BACKLIGHT, DisplayStateOff },
+    { DisplayStateOff, DisplayEventPowerKeyPress, PUCK | UNLOCKED, PUCK | UNLOCKED, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventPowerKeyPress, PUCK | CALL, PUCK | CALL, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventPowerKeyPress, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateOff, DisplayEventPowerKeyPress, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventPowerKeyPress, CALL, CALL, DisplayStateOn },
+    { DisplayStateOff, DisplayEventPowerKeyPress, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventHomeKeyPress, PUCK | UNLOCKED, PUCK | UNLOCKED, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventHomeKeyPress, PUCK | CALL, PUCK | CALL, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventHomeKeyPress, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateOff, DisplayEventHomeKeyPress, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventHomeKeyPress, CALL, CALL, DisplayStateOn },
+    { DisplayStateOff, DisplayEventHomeKeyPress, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventPowerKeyHold, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventPowerKeyHold, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventPowerKeyHold, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventOnPuck, CALL, CALL, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventOnPuck, UNLOCKED, UNLOCKED, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventOnPuck, 0, 0, DisplayStateDockMode },
+
+    { DisplayStateOff, DisplayEventUsbIn, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventUsbIn, 0, 0, DisplayStateOn },
+
+    { DisplayStateOff, DisplayEventIncomingCall, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventIncomingCall, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventIncomingCall, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventOnCall, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventOnCall, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventOnCall, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventSliderOpen, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventSliderOpen, 0, 0, DisplayStateOn },
+
+    { DisplayStateOff, DisplayEventApiOn, PUCK | CALL, PUCK | CALL, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventApiOn, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateOff, DisplayEventApiOn, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventApiOn, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventUserActivity, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventUserActivity, UNLOCKED, UNLOCKED, DisplayStateOn },
+    { DisplayStateOff, DisplayEventUserActivity, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOff, DisplayEventUserActivityExternalInput, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateOff, DisplayEventUserActivityExternalInput, 0, 0, DisplayStateOn },
+
+    { DisplayStateOff, DisplayEventPowerdSuspend, 0, 0, DisplayStateOffSuspended },
+
+    { DisplayStateOff, DisplayEventApiDock, CALL, CALL, DisplayStateOff },
+    { DisplayStateOff, DisplayEventApiDock, 0, 0, DisplayStateDockMode },
+
+    // ---------------------- DisplayOn --------------------------------------
+
+    // the backlight still coming on: debounce
+    { DisplayStateOn, DisplayEventPowerKeyPress, BACKLIGHT, 0, DisplayStateOn },
+    { DisplayStateOn, DisplayEventPowerKeyPress, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateOn, DisplayEventPowerKeyPress, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateOn, DisplayEventPowerKeyPress, 0, 0, DisplayStateOff },
+
+    { DisplayStateOn, DisplayEventOnPuck, 0, 0, DisplayStateOnPuck },
+
+    { DisplayStateOn, DisplayEventProximityOn, 0, 0, DisplayStateOffOnCall },
+
+    { DisplayStateOn, DisplayEventApiDim, 0, 0, DisplayStateDim },
+
+    { DisplayStateOn, DisplayEventApiOff, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateOn, DisplayEventApiOff, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateOn, DisplayEventApiOff, 0, 0, DisplayStateOff },
+
+    { DisplayStateOn, DisplayEventLockScreen, PUCK | CALL, PUCK, DisplayStateDockMode },
+    { DisplayStateOn, DisplayEventLockScreen, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateOn, DisplayEventApiDock, CALL, CALL, DisplayStateOn },
+    { DisplayStateOn, DisplayEventApiDock, 0, 0, DisplayStateDockMode },
+
+    // ---------------------- DisplayOnLocked --------------------------------
+
+    // the backlight still coming on: debounce
+    { DisplayStateOnLocked, DisplayEventPowerKeyPress, BACKLIGHT, 0, DisplayStateOnLocked },
+    { DisplayStateOnLocked, DisplayEventPowerKeyPress, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateOnLocked, DisplayEventPowerKeyPress, 0, 0, DisplayStateOff },
+
+    { DisplayStateOnLocked, DisplayEventOnPuck, 0, 0, DisplayStateOnPuck },
+
+    { DisplayStateOnLocked, DisplayEventUsbIn, 0, 0, DisplayStateOn },
+
+    { DisplayStateOnLocked, DisplayEventSliderOpen, 0, 0, DisplayStateOn },
+
+    { DisplayStateOnLocked, DisplayEventProximityOn, 0, 0, DisplayStateOffOnCall },
+
+    { DisplayStateOnLocked, DisplayEventApiOff, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateOnLocked, DisplayEventApiOff, 0, 0, DisplayStateOff },
+
+    { DisplayStateOnLocked, DisplayEventUserActivityExternalInput, 0, 0, DisplayStateOn },
+
+    { DisplayStateOnLocked, DisplayEventUnlockScreen, 0, 0, DisplayStateOn },
+
+    { DisplayStateOnLocked, DisplayEventApiDock, CALL, CALL, DisplayStateOnLocked },
+    { DisplayStateOnLocked, DisplayEventApiDock, 0, 0, DisplayStateDockMode },
+
+    // ---------------------- DisplayDim -------------------------------------
+
+    { DisplayStateDim, DisplayEventPowerKeyPress, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateDim, DisplayEventPowerKeyPress, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateDim, DisplayEventPowerKeyPress, 0, 0, DisplayStateOff },
+
+    { DisplayStateDim, DisplayEventPowerKeyHold, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventPowerKeyHold, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventOnPuck, 0, 0, DisplayStateOnPuck },
+
+    { DisplayStateDim, DisplayEventOffPuck, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventUsbIn, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventUsbIn, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventIncomingCall, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventIncomingCall, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventSliderClose, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateDim, DisplayEventSliderClose, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateDim, DisplayEventSliderClose, 0, 0, DisplayStateOff },
+
+    { DisplayStateDim, DisplayEventProximityOn, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateDim, DisplayEventProximityOn, 0, 0, DisplayStateDim },
+
+    { DisplayStateDim, DisplayEventApiOn, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventApiOn, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventApiOff, CALL, CALL, DisplayStateOffOnCall },
+    { DisplayStateDim, DisplayEventApiOff, PUCK, PUCK, DisplayStateDockMode },
+    { DisplayStateDim, DisplayEventApiOff, 0, 0, DisplayStateOff },
+
+    { DisplayStateDim, DisplayEventHomeKeyPress, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventHomeKeyPress, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventUserActivity, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventUserActivity, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventUserActivityExternalInput, PUCK, PUCK, DisplayStateOnPuck },
+    { DisplayStateDim, DisplayEventUserActivityExternalInput, 0, 0, DisplayStateOn },
+
+    { DisplayStateDim, DisplayEventLockScreen, 0, 0, DisplayStateOnLocked },
+
+    { DisplayStateDim, DisplayEventApiDock, CALL, CALL, DisplayStateDim },
+    { DisplayStateDim, DisplayEventApiDock, 0, 0, DisplayStateDockMode },
+};
+
+#undef CALL
+#undef PUCK
+#undef UNLOCKED
+#undef BACKLIGHT
+
+static const int sRuleCount = sizeof(sRules) / sizeof(sRules[0]);
+
+// the rows of a state and event are sOrder[sFirst[state][event]] up to sOrder[sFirst[state][event + 1]]
+static unsigned short sFirst[DisplayStateMax][DisplayEventMax + 1];
+static unsigned short sOrder[sRuleCount];
+static bool sCompiled = false;
+
+static const char* const sStateNames[DisplayStateMax] = {
+    "off",
+    "offOnCall",
+    "on",
+    "onLocked",
+    "dim",
+    "onPuck",
+    "dockMode",
+    "offSuspended"
+};
+
+static const char* const sEventNames[DisplayEventMax] = {
+    "powerKeyPress",
+    "powerKeyHold",
+    "onPuck",
+    "offPuck",
+    "usbIn",
+    "usbOut",
+    "incomingCall",
+    "incomingCallDone",
+    "onCall",
+    "offCall",
+    "sliderOpen",
+    "sliderClose",
+    "alsChange",
+    "proximityOn",
+    "proximityOff",
+    "apiOn",
+    "apiDim",
+    "apiOff",
+    "userActivity",
+    "updateBrightness",
+    "lockScreen",
+    "unlockScreen",
+    "timeout",
+    "apiDock",
+    "apiUndock",
+    "powerdSuspend",
+    "powerdResume",
+    "userActivityExternalInput",
+    "homeKeyPress"
+};
+
+void DisplayTransitions::compile()
+{
+    // a counting sort on (state, event) that keeps the order of the rows within each
+    unsigned short counts[DisplayStateMax][DisplayEventMax] = {{ 0 }};
+    for (int i = 0; i < sRuleCount; i++)
+        counts[sRules[i].from][sRules[i].event]++;
+
+    unsigned short next = 0;
+    for (int s = 0; s < DisplayStateMax; s++) {
+        for (int e = 0; e < DisplayEventMax; e++) {
+            sFirst[s][e] = next;
+            next += counts[s][e];
+        }
+        sFirst[s][DisplayEventMax] = next;
+    }
+
+    unsigned short fill[DisplayStateMax][DisplayEventMax];
+    for (int s = 0; s < DisplayStateMax; s++) {
+        for (int e = 0; e < DisplayEventMax; e++)
+            fill[s][e] = sFirst[s][e];
+    }
+    for (int i = 0; i < sRuleCount; i++)
+        sOrder[fill[sRules[i].from][sRules[i].event]++] = i;
+
+    sCompiled = true;
+}
+
+bool DisplayTransitions::handles(DisplayState state, DisplayEvent event)
+{
+    if (state >= DisplayStateMax || event >= DisplayEventMax)
+        return false;
+
+    if (!sCompiled)
+        compile();
+
+    return sFirst[state][event] != sFirst[state][event + 1];
+}
+
+bool DisplayTransitions::lookup(DisplayState state, DisplayEvent event, uint32_t guards, DisplayState& r_to)
+{
+    if (!handles(state, event))
+        return false;
+
+    for (int i = sFirst[state][event]; i < sFirst[state][event + 1]; i++) {
+        const TransitionRule& rule = sRules[sOrder[i]];
+        if ((guards & rule.mask) == rule.value) {
+            r_to = rule.to;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool DisplayTransitions::backlightOn(DisplayState state)
+{
+    switch (state) {
+        case DisplayStateOn:
+        case DisplayStateOnLocked:
+        case DisplayStateDim:
+        case DisplayStateOnPuck:
+        case DisplayStateDockMode:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const char* DisplayTransitions::stateName(DisplayState state)
+{
+    if (state < 0 || state >= DisplayStateMax || !sStateNames[state])
+        return "unknown";
+
+    return sStateNames[state];
+}
+
+const char* DisplayTransitions::eventName(DisplayEvent event)
+{
+    if (event < 0 || event >= DisplayEventMax || !sEventNames[event])
+        return "unknown";
+
+    return sEventNames[event];
+}
+
+DisplayTransitionTracer::DisplayTransitionTracer()
+    : m_transitions(Capacity)
+    , m_recorded(0)
+{
+}
+
+void DisplayTransitionTracer::record(uint32_t timeMs, DisplayEvent event, DisplayState from, DisplayState to,
+                                     uint32_t guards)
+{
+    Transition transition;
+    transition.timeMs = timeMs;
+    transition.event = event;
+    transition.from = from;
+    transition.to = to;
+    transition.guards = guards;
+    transition.latencyMs = -1;
+
+    m_transitions.AddSample(transition, timeMs);
+    m_recorded++;
+}
+
+void DisplayTransitionTracer::backlightChanged(uint32_t timeMs, bool on)
+{
+    if (!count())
+        return;
+
+    // a brightness change while the display goes off, or the tail of turning off on the way back on, is not
+    // the backlight following this change
+    Transition& newest = m_transitions.SampleAt(0);
+    if (newest.latencyMs < 0 && DisplayTransitions::backlightOn(newest.to) == on)
+        newest.latencyMs = timeMs - newest.timeMs;
+}
@@ -0,0 +1,106 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef DISPLAYTRANSITIONS_H
+#define DISPLAYTRANSITIONS_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+#include "CircularBuffer.h"
+#include "DisplayStates.h"
+
+// DisplayGuard: what the moves out of a state depend on, as bits
+enum DisplayGuard {
+    DisplayGuardOnCall      = 1 << 0,
+    DisplayGuardOnPuck      = 1 << 1,
+    DisplayGuardUnlocked    = 1 << 2,   // DisplayStateBase::isDisplayUnlocked()
+    DisplayGuardBacklightOn = 1 << 3
+};
+
+/*
+ * The display state machine as a table: for a state, an event and the guards that hold, the state to move
+ * to. The rows for a state and event are tried in order and the first one whose guards match wins; a row
+ * back to the same state keeps it. A state delegates to the table with DisplayStateBase::applyTransition()
+ * and handles in its own switch what the table has no rows for (anything with more to it than a move).
+ *
+ * The rows are indexed by state and event once, on the first lookup.
+ */
+class DisplayTransitions
+{
+public:
+    // does the table have rows for event in state?
+    static bool handles(DisplayState state, DisplayEvent event);
+    // false if no row matches
+    static bool lookup(DisplayState state, DisplayEvent event, uint32_t guards, DisplayState& r_to);
+
+    // is the backlight meant to be on in state (dimmed counts)?
+    static bool backlightOn(DisplayState state);
+
+    static const char* stateName(DisplayState state);
+    static const char* eventName(DisplayEvent event);
+
+private:
+    static void compile();
+};
+
+/*
+ * The last Capacity display state changes, each with the time the backlight caught up with it (the display
+ * service call of a move to an on state returning, or the backlight going off for a move to an off state).
+ */
+class DisplayTransitionTracer
+{
+public:
+    enum { Capacity = 64 };
+
+    struct Transition {
+        uint32_t timeMs;
+        DisplayEvent event;
+        DisplayState from;
+        DisplayState to;
+        uint32_t guards;
+        int32_t latencyMs;      // -1 until the backlight follows, or if another change came first
+    };
+
+    DisplayTransitionTracer();
+
+    void record(uint32_t timeMs, DisplayEvent event, DisplayState from, DisplayState to, uint32_t guards);
+    // the backlight was set (on) or went off at timeMs: for the newest change, if it is still waiting and
+    // its state expects that
+    void backlightChanged(uint32_t timeMs, bool on);
+
+    int count() const { return m_transitions.Count(); }
+    // age 0 is the newest
+    const Transition& at(int age) const { return m_transitions.SampleAt(age); }
+    // all there ever were, including those the buffer dropped
+    uint32_t recorded() const { return m_recorded; }
+
+private:
+    CircularBuffer<Transition> m_transitions;
+    uint32_t m_recorded;
+
+private:
+    DisplayTransitionTracer(const DisplayTransitionTracer&);
+    DisplayTransitionTracer& operator=(const DisplayTransitionTracer&);
+};
+
+#endif /* DISPLAYTRANSITIONS_H */
@@ -23,6 +23,7 @@
 #include "HapticsController.h"
 #include "HostBase.h"
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
 #include "Time.h"
 #include "cjson/json.h"
 
@@ -23,6 +23,7 @@
 #include "InputControl.h"
 #include "DisplayManager.h"
 #include "CustomEvents.h"
+#include "Time.h"
 
 InputEventMonitor::InputEventMonitor(QObject *parent) :
     QObject(parent)
@@ -132,19 +133,25 @@ void InputEventMonitor::readTouchpanelData()
         if (error != NYX_ERROR_NONE)
         {
             qWarning() << __PRETTY_FUNCTION__ << "Unable to obtain touchpanel event touches";
-            return;
+            nyx_device_release_event(mTouchpanelHandle, event_handle);
+            break;
         }
 
-        if (count > 0)
-             DisplayManager::instance()->handleTouchEvent();
+        mTouchActivity.addEvent(count);
 
-        nyx_device_release_event(mTouchpanelHandle, event_handle);
+        error = nyx_device_release_event(mTouchpanelHandle, event_handle);
         if (error != NYX_ERROR_NONE)
         {
             qWarning() << __PRETTY_FUNCTION__ << "Unable to release touchpanel event_handle event";
-            return;
+            break;
         }
 
         event_handle = NULL;
     }
+
+    // everything read on this wakeup is one user activity to the display
+    if (mTouchActivity.pendingEvents() > 0) {
+        mTouchActivity.endBatch(Time::curTimeMs());
+        DisplayManager::instance()->handleTouchEvent(mTouchActivity.lastActivityMs());
+    }
 }
@@ -24,6 +24,8 @@
 
 #include <nyx/nyx_client.h>
 
+#include "UserActivityTracker.h"
+
 class InputControl;
 
 class InputEventMonitor : public QObject
@@ -44,6 +46,7 @@ private:
 
     QSocketNotifier *mTouchpanelNotifier;
     nyx_device_handle_t mTouchpanelHandle;
+    UserActivityTracker mTouchActivity;
 
 
     void setupEventSources();
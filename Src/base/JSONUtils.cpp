@@ -20,17 +20,20 @@
 
 
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
 
 #include "Logging.h"
 #include "Utils.h"
+#include "MutexLocker.h"
+
+#include <time.h>
 
 bool JsonMessageParser::parse(const char * callerFunction)
 {
 	if (!mParser.parse(mJson, mSchema))
 	{
 		const char * errorText = "Could not validate json message against schema";
-		pbnjson::JSchemaFragment	genericSchema(SCHEMA_ANY);
-		if (!mParser.parse(mJson, genericSchema))
+		if (!mParser.parse(mJson, JsonSchemaCache::schema(SCHEMA_ANY)))
 			errorText = "Invalid json message";
 		g_critical("%s: %s '%s'", callerFunction, errorText, mJson);
 		return false;
@@ -72,8 +75,7 @@ std::string	jsonToString(pbnjson::JValue & reply, const char * schema)
 {
 	pbnjson::JGenerator serializer(NULL);   // our schema that we will be using does not have any external references
 	std::string serialized;
-	pbnjson::JSchemaFragment responseSchema(schema);
-	if (!serializer.toString(reply, responseSchema, serialized)) {
+	if (!serializer.toString(reply, JsonSchemaCache::schema(schema), serialized)) {
 		g_critical("serializeJsonReply: failed to generate json reply");
 		return "{\"returnValue\":false,\"errorText\":\"error: Failed to generate a valid json reply...\"}";
 	}
@@ -117,9 +119,10 @@ bool LSMessageJsonParser::parse(const char * callerFunction, LSHandle * lssender
     if (EIgnore == validationOption) return true;
 
     const char * payload = getPayload();
+    uint64_t start = JsonParseStats::nowUs();
 
     // Parse the message with given schema.
-    if (!mParser.parse(payload, mSchema))
+    if (!mParser.parse(payload, JsonSchemaCache::schema(mSchemaText)))
     {
         // Unable to parse the message with given schema
 
@@ -127,11 +130,13 @@ bool LSMessageJsonParser::parse(const char * callerFunction, LSHandle * lssender
         bool            notJson = true; // we know that, it's not a valid json message
 
         // Try parsing the message with empty schema, just to verify that it is a valid json message
+        unsigned int parses = 1;
         if (strcmp(mSchemaText, SCHEMA_ANY) != 0)
         {
-            pbnjson::JSchemaFragment    genericSchema(SCHEMA_ANY);
-            notJson = !mParser.parse(payload, genericSchema);
+            notJson = !mParser.parse(payload, JsonSchemaCache::schema(SCHEMA_ANY));
+            parses++;
         }
+        JsonParseStats::record(callerFunction, 1, parses, true, JsonParseStats::nowUs() - start);
 
         if (notJson)
         {
@@ -157,10 +162,282 @@ bool LSMessageJsonParser::parse(const char * callerFunction, LSHandle * lssender
         }
     }
 
+    else
+    {
+        JsonParseStats::record(callerFunction, 1, 1, false, JsonParseStats::nowUs() - start);
+    }
+
     // Message successfully parsed with given schema
     return true;
 }
 
+// -------------------------------------------------------------------------
+
+static std::string messageCategoryMethod(LSMessage* message)
+{
+	if (!message)
+		return "";
+
+	const char* category = LSMessageGetCategory(message);
+	const char* method = LSMessageGetMethod(message);
+	return std::string("Category: ") + (category ? category : "") + " Method: " + (method ? method : "");
+}
+
+static std::string messageSender(LSMessage* message)
+{
+	if (!message)
+		return "";
+
+	const char* sender = LSMessageGetSender(message);
+	return sender ? sender : "";
+}
+
+ValidatedJsonMessage::ValidatedJsonMessage(LSMessage* message, const char* schema)
+	: m_message(message)
+	, m_payload(message ? LSMessageGetPayload(message) : 0)
+	, m_schemaText(schema)
+	, m_callerFunction("")
+	, m_parsed(false)
+	, m_valid(false)
+{
+}
+
+ValidatedJsonMessage::ValidatedJsonMessage(const char* payload, const char* schema)
+	: m_message(0)
+	, m_payload(payload)
+	, m_schemaText(schema)
+	, m_callerFunction("")
+	, m_parsed(false)
+	, m_valid(false)
+{
+}
+
+void ValidatedJsonMessage::parseDom(const pbnjson::JSchema& schema) const
+{
+	m_parsed = true;
+	m_valid = m_payload && m_parser.parse(m_payload, schema);
+	m_root = m_valid ? m_parser.getDom() : pbnjson::JValue();
+}
+
+bool ValidatedJsonMessage::parse(const char* callerFunction, LSHandle* lssender, ESchemaErrorOptions validationOption)
+{
+	m_callerFunction = callerFunction;
+
+	// not validating: the payload is parsed when the handler first reads from it, if it ever does
+	if (EIgnore == validationOption) {
+		JsonParseStats::record(m_callerFunction, 1, 0, false, 0);
+		return true;
+	}
+
+	uint64_t start = JsonParseStats::nowUs();
+	parseDom(JsonSchemaCache::schema(m_schemaText));
+	if (m_valid) {
+		JsonParseStats::record(m_callerFunction, 1, 1, false, JsonParseStats::nowUs() - start);
+		return true;
+	}
+
+	// tell a payload that isn't json from one that doesn't fit the schema. If the handler goes on
+	// anyway, this is the DOM it reads from
+	const char* errorText = "Could not validate json message against schema";
+	unsigned int parses = 1;
+	bool notJson = true;
+	if (strcmp(m_schemaText, SCHEMA_ANY) != 0) {
+		parseDom(JsonSchemaCache::schema(SCHEMA_ANY));
+		notJson = !m_valid;
+		parses++;
+	}
+	JsonParseStats::record(m_callerFunction, 1, parses, true, JsonParseStats::nowUs() - start);
+
+	std::string sender = messageSender(m_message);
+	if (notJson) {
+		g_critical("[Schema Error] : [%s : %s]: The message '%s' sent by '%s' is not a valid json message against schema '%s'",
+				   callerFunction, messageCategoryMethod(m_message).c_str(), m_payload ? m_payload : "", sender.c_str(), m_schemaText);
+		errorText = "Not a valid json message";
+	}
+	else {
+		g_critical("[Schema Error] : [%s :%s]: Could not validate json message '%s' sent by '%s' against schema '%s'.",
+				   callerFunction, messageCategoryMethod(m_message).c_str(), m_payload, sender.c_str(), m_schemaText);
+	}
+
+	if (EValidateAndError == validationOption) {
+		if (lssender && m_message && !sender.empty()) {
+			std::string reply = createJsonReplyString(false, 1, errorText);
+			CLSError lserror;
+			if (!LSMessageReply(lssender, m_message, reply.c_str(), &lserror))
+				lserror.Print(callerFunction, 0);
+		}
+		return false;
+	}
+
+	return true;
+}
+
+bool ValidatedJsonMessage::isValid() const
+{
+	if (!m_parsed) {
+		uint64_t start = JsonParseStats::nowUs();
+		parseDom(JsonSchemaCache::schema(SCHEMA_ANY));
+		JsonParseStats::record(m_callerFunction, 0, 1, !m_valid, JsonParseStats::nowUs() - start);
+	}
+	return m_valid;
+}
+
+const pbnjson::JValue& ValidatedJsonMessage::root() const
+{
+	isValid();
+	return m_root;
+}
+
+bool ValidatedJsonMessage::has(const std::string& key) const
+{
+	if (!isValid() || !m_root.isObject() || !m_root.hasKey(key))
+		return false;
+	return !m_root[key].isNull();
+}
+
+pbnjson::JValue ValidatedJsonMessage::value(const std::string& key) const
+{
+	if (!has(key))
+		return pbnjson::JValue();
+	return m_root[key];
+}
+
+bool ValidatedJsonMessage::getString(const std::string& key, std::string& r_value) const
+{
+	if (!has(key))
+		return false;
+
+	pbnjson::JValue value = m_root[key];
+	if (value.isString())
+		return value.asString(r_value) == CONV_OK;
+
+	r_value = toString(value);
+	return true;
+}
+
+bool ValidatedJsonMessage::getInteger(const std::string& key, int64_t& r_value) const
+{
+	if (!has(key) || !m_root[key].isNumber())
+		return false;
+
+	int64_t value = 0;
+	if (m_root[key].asNumber(value) != CONV_OK)
+		return false;
+
+	r_value = value;
+	return true;
+}
+
+//static
+std::string ValidatedJsonMessage::toString(const pbnjson::JValue& value)
+{
+	pbnjson::JGenerator generator(NULL);
+	std::string result;
+	if (!generator.toString(value, JsonSchemaCache::schema(SCHEMA_ANY), result))
+		return "";
+	return result;
+}
+
+// -------------------------------------------------------------------------
+
+static Mutex s_parseStatsMutex;
+static JsonParseStats::CounterMap s_parseStats;
+
+//static
+void JsonParseStats::record(const char* method, unsigned int calls, unsigned int parses, bool failed, uint64_t us)
+{
+	MutexLocker locker(&s_parseStatsMutex);
+
+	Counter& counter = s_parseStats[method ? method : ""];
+	counter.calls += calls;
+	counter.parses += parses;
+	if (failed)
+		counter.failures++;
+	counter.totalUs += us;
+	if (us > counter.maxUs)
+		counter.maxUs = us;
+}
+
+//static
+JsonParseStats::CounterMap JsonParseStats::counters()
+{
+	MutexLocker locker(&s_parseStatsMutex);
+	return s_parseStats;
+}
+
+//static
+void JsonParseStats::reset()
+{
+	MutexLocker locker(&s_parseStatsMutex);
+	s_parseStats.clear();
+}
+
+//static
+uint64_t JsonParseStats::nowUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// -------------------------------------------------------------------------
+
+struct CachedSchema {
+	CachedSchema(const char* text) : text(text), schema(this->text) {}
+
+	std::string text;
+	pbnjson::JSchemaFragment schema;
+};
+
+static const unsigned int kMaxSchemaAddresses = 1024;
+
+static Mutex s_schemaCacheMutex;
+static std::map<const char*, CachedSchema*> s_schemasByAddress;
+static std::map<std::string, CachedSchema*> s_schemasByText;
+static JsonSchemaCache::Counters s_schemaCacheCounters;
+
+//static
+const pbnjson::JSchema& JsonSchemaCache::schema(const char* text)
+{
+	if (!text)
+		text = SCHEMA_ANY;
+
+	MutexLocker locker(&s_schemaCacheMutex);
+
+	std::map<const char*, CachedSchema*>::const_iterator byAddress = s_schemasByAddress.find(text);
+	if (byAddress != s_schemasByAddress.end() && byAddress->second->text == text) {
+		s_schemaCacheCounters.hits++;
+		return byAddress->second->schema;
+	}
+
+	CachedSchema* cached;
+	std::map<std::string, CachedSchema*>::const_iterator byText = s_schemasByText.find(text);
+	if (byText != s_schemasByText.end()) {
+		s_schemaCacheCounters.hits++;
+		cached = byText->second;
+	}
+	else {
+		s_schemaCacheCounters.misses++;
+		s_schemaCacheCounters.schemas++;
+		cached = new CachedSchema(text);
+		s_schemasByText[cached->text] = cached;
+	}
+
+	// addresses that aren't literals come and go; forget them rather than grow without bound
+	if (s_schemasByAddress.size() >= kMaxSchemaAddresses)
+		s_schemasByAddress.clear();
+
+	s_schemasByAddress[text] = cached;
+	return cached->schema;
+}
+
+//static
+JsonSchemaCache::Counters JsonSchemaCache::counters()
+{
+	MutexLocker locker(&s_schemaCacheMutex);
+	return s_schemaCacheCounters;
+}
+
 void CLSError::Print(const char * where, int line, GLogLevelFlags logLevel)
 {
     if (LSErrorIsSet(this))
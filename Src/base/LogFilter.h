@@ -0,0 +1,94 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef LOGFILTER_H
+#define LOGFILTER_H
+
+#include "Common.h"
+
+#include <glib.h>
+#include <map>
+#include <string>
+
+/*
+ * Checks to make before formatting a log line nobody will see.
+ *
+ * g_message() and friends format the whole message before logFilter() gets to drop it for its level.
+ * Code that logs in loops (every scanned app, every search match) should test logLevelEnabled() first.
+ *
+ * Levels more verbose than LOG_COMPILED_LEVEL can never be enabled and the check folds away at compile time.
+ */
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL G_LOG_LEVEL_DEBUG
+#endif
+
+// the logger_level logFilter() lets through, set by logInit()
+extern volatile gint gLogLevelGate;
+
+static inline bool logLevelEnabled(GLogLevelFlags level)
+{
+	int l = level & G_LOG_LEVEL_MASK;
+	return l <= LOG_COMPILED_LEVEL && l <= g_atomic_int_get(&gLogLevelGate);
+}
+
+/*
+ * Log channels: tracing a component turns on independently of the log level.
+ *
+ * A module resolves its channel once, to a handle that lives as long as the process:
+ *
+ *     static LogChannel* sAppMgrChnl = logChannel("ApplicationManager");
+ *     channel_log(sAppMgrChnl, "scanning apps from %s", folder);
+ *
+ * A disabled channel costs one plain load of its flag; nothing is formatted. Channels start out enabled
+ * when named in LUNA_LOGGING (comma separated) and can be switched at runtime with logSetChannelEnabled(),
+ * which com.palm.systemmanager/logChannels exposes.
+ */
+struct LogChannel {
+	const char* name;
+	volatile gint enabled;
+};
+
+// creates the channel the first time a name is seen; never returns 0 for a non-null name
+LogChannel* logChannel(const char* name);
+
+// also creates the channel, so it can be enabled before the module using it is loaded
+void logSetChannelEnabled(const char* name, bool enabled);
+
+// every channel known so far and whether it's enabled
+std::map<std::string, bool> logChannels();
+
+static inline bool logChannelEnabled(const LogChannel* channel)
+{
+	// no barrier needed: a toggle may take a moment to be seen by other threads
+	return G_UNLIKELY(channel->enabled != 0);
+}
+
+#define channel_log(channel, ...) \
+	do { if (logChannelEnabled(channel)) g_message(__VA_ARGS__); } while (0)
+
+#define channel_warn(channel, ...) \
+	do { if (logChannelEnabled(channel)) g_warning(__VA_ARGS__); } while (0)
+
+// criticals go out whether or not the channel is enabled
+#define channel_critical(channel, ...) \
+	g_critical(__VA_ARGS__)
+
+#endif /* LOGFILTER_H */
@@ -0,0 +1,122 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "LogRingBuffer.h"
+
+#include <string.h>
+
+// the bounded queue of D. Vyukov: each slot carries the position it is ready for, so producers only
+// contend on m_enqueuePos and never on the slots, and the consumer needs no atomic read-modify-write at all
+
+LogRingBuffer::LogRingBuffer(unsigned int capacity)
+	: m_enqueuePos(0)
+	, m_dequeuePos(0)
+	, m_dropped(0)
+{
+	unsigned int size = 2;
+	while (size < capacity)
+		size <<= 1;
+
+	m_mask = size - 1;
+	m_slots = new Slot[size];
+	for (unsigned int i = 0; i < size; i++)
+		g_atomic_int_set(&m_slots[i].sequence, (gint) i);
+}
+
+LogRingBuffer::~LogRingBuffer()
+{
+	delete [] m_slots;
+}
+
+bool LogRingBuffer::push(GLogLevelFlags level, uint64_t timeNs, const char* indent, const char* message)
+{
+	Slot* slot;
+	guint pos = (guint) g_atomic_int_get(&m_enqueuePos);
+	while (true) {
+		slot = &m_slots[pos & m_mask];
+		gint diff = (gint) ((guint) g_atomic_int_get(&slot->sequence) - pos);
+		if (diff == 0) {
+			if (g_atomic_int_compare_and_exchange(&m_enqueuePos, (gint) pos, (gint) (pos + 1)))
+				break;
+			pos = (guint) g_atomic_int_get(&m_enqueuePos);
+		}
+		else if (diff < 0) {
+			// the consumer hasn't freed this slot from the previous round yet: full
+			g_atomic_int_inc(&m_dropped);
+			return false;
+		}
+		else {
+			pos = (guint) g_atomic_int_get(&m_enqueuePos);
+		}
+	}
+
+	Record& record = slot->record;
+	record.level = level;
+	record.timeNs = timeNs;
+
+	size_t indentLength = indent ? strlen(indent) : 0;
+	if (indentLength > MaxTextLength / 4)
+		indentLength = MaxTextLength / 4;
+	if (indentLength)
+		memcpy(record.text, indent, indentLength);
+	record.indentLength = indentLength;
+
+	size_t messageLength = strlen(message);
+	if (messageLength > MaxTextLength - 1 - indentLength)
+		messageLength = MaxTextLength - 1 - indentLength;
+	memcpy(record.text + indentLength, message, messageLength);
+	record.text[indentLength + messageLength] = 0;
+
+	// publish
+	g_atomic_int_set(&slot->sequence, (gint) (pos + 1));
+	return true;
+}
+
+unsigned int LogRingBuffer::pop(Record* r_records, unsigned int max)
+{
+	unsigned int count = 0;
+	while (count < max) {
+		Slot* slot = &m_slots[m_dequeuePos & m_mask];
+		if ((guint) g_atomic_int_get(&slot->sequence) != (guint) (m_dequeuePos + 1))
+			break;
+
+		// only the part that was written
+		const Record& record = slot->record;
+		Record& out = r_records[count++];
+		out.level = record.level;
+		out.timeNs = record.timeNs;
+		out.indentLength = record.indentLength;
+		strcpy(out.text, record.text);
+
+		// free for the producer one round later
+		g_atomic_int_set(&slot->sequence, (gint) (m_dequeuePos + m_mask + 1));
+		m_dequeuePos++;
+	}
+	return count;
+}
+
+bool LogRingBuffer::empty() const
+{
+	const Slot* slot = &m_slots[m_dequeuePos & m_mask];
+	return (guint) g_atomic_int_get(&slot->sequence) != (guint) (m_dequeuePos + 1);
+}
@@ -0,0 +1,85 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef LOGRINGBUFFER_H
+#define LOGRINGBUFFER_H
+
+#include "Common.h"
+
+#include <glib.h>
+#include <stdint.h>
+
+/*
+ * The queue between the threads that log and the thread that writes the log out.
+ *
+ * A fixed number of fixed size records, allocated once. Any number of threads may push() at the same time
+ * without taking a lock or allocating; a message that doesn't fit in a record is cut. When every record
+ * is taken, push() drops the message and counts it rather than wait, so logging never blocks the caller.
+ *
+ * One thread at a time pops, copying out as many records as it wants to write in one go.
+ */
+class LogRingBuffer
+{
+public:
+
+	enum { MaxTextLength = 1000 };
+
+	struct Record {
+		GLogLevelFlags level;
+		uint64_t timeNs;				// CLOCK_MONOTONIC, when it was logged
+		unsigned int indentLength;		// text starts with this many characters of indent (see LogIndent)
+		char text[MaxTextLength];		// indent and message, nul terminated
+	};
+
+	// capacity is rounded up to a power of 2
+	explicit LogRingBuffer(unsigned int capacity);
+	~LogRingBuffer();
+
+	unsigned int capacity() const { return m_mask + 1; }
+
+	// any thread; false if there was no room and the message was dropped
+	bool push(GLogLevelFlags level, uint64_t timeNs, const char* indent, const char* message);
+
+	// the consumer only: copies out up to max of the oldest records and frees them, returns how many
+	unsigned int pop(Record* r_records, unsigned int max);
+	bool empty() const;
+
+	// messages dropped since the buffer was created
+	unsigned int dropped() const { return (unsigned int) g_atomic_int_get(&m_dropped); }
+
+private:
+
+	struct Slot {
+		volatile gint sequence;		// position the slot is free (== position) or filled (== position + 1) for
+		Record record;
+	};
+
+	Slot* m_slots;
+	unsigned int m_mask;
+
+	volatile gint m_enqueuePos;
+	char m_padding[64];				// keeps producers and the consumer off each other's cache line
+	unsigned int m_dequeuePos;
+
+	volatile gint m_dropped;
+};
+
+#endif /* LOGRINGBUFFER_H */
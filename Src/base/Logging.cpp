@@ -30,8 +30,12 @@
 #include <errno.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
+#include <semaphore.h>
+#include <string>
 
 #include "Logging.h"
+#include "LogFilter.h"
+#include "LogRingBuffer.h"
 #include "MutexLocker.h"
 #include "Settings.h"
 
@@ -58,48 +62,96 @@ SysMgrTracer::~SysMgrTracer()
 }
 #endif
 
-bool LunaChannelEnabled(const char* channel)
+// call with s_mutex held
+static void PrvInitChannels()
 {
-	if (!channel)
-		return false;
+	if (s_initialized)
+		return;
 
-	bool ret = false;
-	
-	g_static_mutex_lock(&s_mutex);
-		
-	if (!s_initialized) {
-
-		s_initialized = true;
-		int index = 0;
-
-		s_channelHash = ::g_hash_table_new(g_str_hash, g_str_equal);
-		
-		const char* env = ::getenv("LUNA_LOGGING");
-		if (!env)
-			goto Done;
-		
-		gchar** splitStr = ::g_strsplit(env, ",", 0);
-		if (!splitStr)
-			goto Done;
-
-		while (splitStr[index]) {
-			char* key = ::g_strdup(splitStr[index]);
-			key = g_strstrip(key);
-			g_hash_table_insert(s_channelHash, key, (gpointer)0x1);
-			index++;
+	s_initialized = true;
+	s_channelHash = ::g_hash_table_new(g_str_hash, g_str_equal);
+
+	const char* env = ::getenv("LUNA_LOGGING");
+	gchar** splitStr = env ? ::g_strsplit(env, ",", 0) : 0;
+	for (int index = 0; splitStr && splitStr[index]; index++) {
+		char* key = g_strstrip(::g_strdup(splitStr[index]));
+		if (!*key || g_hash_table_lookup(s_channelHash, key)) {
+			g_free(key);
+			continue;
 		}
 
-		::g_strfreev(splitStr);
+		LogChannel* channel = new LogChannel;
+		channel->name = key;
+		channel->enabled = 1;
+		g_hash_table_insert(s_channelHash, key, channel);
 	}
+	::g_strfreev(splitStr);
+}
+
+// call with s_mutex held
+static LogChannel* PrvFindChannel(const char* name)
+{
+	PrvInitChannels();
+
+	LogChannel* channel = (LogChannel*) g_hash_table_lookup(s_channelHash, name);
+	if (!channel) {
+		// never freed: handles are kept in statics
+		channel = new LogChannel;
+		channel->name = ::g_strdup(name);
+		channel->enabled = 0;
+		g_hash_table_insert(s_channelHash, (gpointer) channel->name, channel);
+	}
+	return channel;
+}
+
+LogChannel* logChannel(const char* name)
+{
+	if (!name)
+		return 0;
+
+	g_static_mutex_lock(&s_mutex);
+	LogChannel* channel = PrvFindChannel(name);
+	g_static_mutex_unlock(&s_mutex);
+
+	return channel;
+}
+
+void logSetChannelEnabled(const char* name, bool enabled)
+{
+	if (!name)
+		return;
+
+	g_static_mutex_lock(&s_mutex);
+	LogChannel* channel = PrvFindChannel(name);
+	g_atomic_int_set(&channel->enabled, enabled ? 1 : 0);
+	g_static_mutex_unlock(&s_mutex);
 
-	if (g_hash_table_lookup(s_channelHash, channel))
-		ret = true;
+	g_message("Logging: channel %s %s", name, enabled ? "enabled" : "disabled");
+}
 
- Done:	
+std::map<std::string, bool> logChannels()
+{
+	std::map<std::string, bool> channels;
 
+	g_static_mutex_lock(&s_mutex);
+	PrvInitChannels();
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init(&iter, s_channelHash);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		const LogChannel* channel = (const LogChannel*) value;
+		channels[channel->name] = logChannelEnabled(channel);
+	}
 	g_static_mutex_unlock(&s_mutex);
 
-	return ret;
+	return channels;
+}
+
+// callers passing a channel by name; resolve a LogChannel once instead where it matters
+bool LunaChannelEnabled(const char* channel)
+{
+	LogChannel* handle = logChannel(channel);
+	return handle && logChannelEnabled(handle);
 }
 
 LunaLogContext syslogContextGlobal()
@@ -160,19 +212,30 @@ PmLogLevel GLogToPmLogLevel(GLogLevelFlags flags)
 
 static Mutex slogFilter_mutex;
 static std::string sLogIndent;
-static GAsyncQueue* sLogAsyncQueue = 0;
+static volatile gint sLogIndentLength = 0;		// so loggers only take slogFilter_mutex when there is an indent
+
+// records between the threads that log and the one that writes them out; preallocated in logInit()
+static const unsigned int sLogRingCapacity = 256;
+static const unsigned int sLogBatchSize = 32;
+static LogRingBuffer* sLogRing = 0;
 static GThread* sLogThread = 0;
+static sem_t sLogWakeup;
+static volatile gint sLogThreadSleeping = 0;
+
+volatile gint gLogLevelGate = G_LOG_LEVEL_DEBUG;
 
 LogIndent::LogIndent(const char * indent) : mIndent(indent)
 {
 	MutexLocker		lock(&slogFilter_mutex);
 	sLogIndent += indent;
+	g_atomic_int_set(&sLogIndentLength, sLogIndent.size());
 }
 
 LogIndent::~LogIndent()
 {
 	MutexLocker		lock(&slogFilter_mutex);
 	sLogIndent.resize(sLogIndent.size() - ::strlen(mIndent));
+	g_atomic_int_set(&sLogIndentLength, sLogIndent.size());
 }
 
 static const char * logLevelName(GLogLevelFlags logLevel)
@@ -202,32 +265,219 @@ static const char * logLevelName(GLogLevelFlags logLevel)
 	return name;
 }
 
+static uint64_t logTimeNs()
+{
+	struct timespec now;
+	::clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static volatile gint		sLogStarted = 0;
+static uint64_t				sLogStartNs = 0;
+static struct tm			sLogStartTime = { 0 };
+
+// the wall clock time terminal time stamps count from, taken (and announced) with the first terminal line
+static void logStart()
+{
+	if (G_LIKELY(g_atomic_int_get(&sLogStarted)))
+		return;
+
+	MutexLocker lock(&slogFilter_mutex);
+	if (g_atomic_int_get(&sLogStarted))
+		return;
+
+	time_t now = ::time(0);
+	sLogStartNs = logTimeNs();
+	::localtime_r(&now, &sLogStartTime);
+	char startTime[64];
+	::asctime_r(&sLogStartTime, startTime);
+	::fprintf(stdout, "Sysmgr starting at %s", startTime);
+	g_atomic_int_set(&sLogStarted, 1);
+}
+
+//	#define BLACK 		0
+//	#define RED			1
+//	#define GREEN		2
+//	#define YELLOW		3
+//	#define BLUE		4
+//	#define MAGENTA		5
+//	#define CYAN		6
+//	#define	WHITE		7
+
+//	foreground			30 + color
+//	background			40 + color
+
+//	#define RESET		0
+//	#define BRIGHT 		1
+//	#define DIM			2
+//	#define UNDERLINE 	3
+//	#define BLINK		4
+//	#define REVERSE		7
+//	#define HIDDEN		8
+
+#define COLORESCAPE		"\033["
+
+#define RESETCOLOR		COLORESCAPE "0m"
+
+#define BOLDCOLOR		COLORESCAPE "1m"
+#define REDOVERBLACK	COLORESCAPE "1;31m"
+#define BLUEOVERBLACK	COLORESCAPE "1;34m"
+#define YELLOWOVERBLACK	COLORESCAPE "1;33m"
+
+// one terminal line; true if it goes to stderr. logStart() must have been called
+static bool formatTerminalLine(std::string& r_line, GLogLevelFlags logLevel, uint64_t timeNs,
+							   const char * indent, int indentLength, const char * message)
+{
+	uint64_t sinceStartMs = timeNs > sLogStartNs ? (timeNs - sLogStartNs) / 1000000 : 0;
+	int ms = (int) (sinceStartMs % 1000);
+	int sec = sLogStartTime.tm_sec + (int) (sinceStartMs / 1000);
+	int min = sLogStartTime.tm_min + sec / 60;
+	int hr = sLogStartTime.tm_hour + min / 60;
+	min = min % 60;
+	sec = sec % 60;
+	char timeStamp[128];
+	char levelName = *logLevelName(logLevel);	// just use one letter
+	const char * format = g_ascii_isupper(levelName) ? "%02d:%02d:%02d.%03d*%c*%.*s(%d) %.*s" : "%02d:%02d:%02d.%03d %c %.*s(%d) %.*s";
+	size_t len = ::snprintf(timeStamp, 128, format, hr, min, sec, ms, levelName, indentLength, indent, getpid(), indentLength, indent);
+	if (len >= G_N_ELEMENTS(timeStamp))
+	{
+		len = G_N_ELEMENTS(timeStamp) - 1;
+		timeStamp[len] = 0;
+	}
+
+	const char * color = 0;
+	if (levelName ==  'd' || !Settings::LunaSettings()->logger_useColor)
+		color = 0;
+	else if (levelName ==  'w')
+		color = YELLOWOVERBLACK;
+	else if (levelName ==  'm')
+		color = BLUEOVERBLACK;
+	else if (g_ascii_isupper(levelName))
+		color = REDOVERBLACK;
+	else
+		color = BOLDCOLOR;
+
+	if (color)
+		r_line += color;
+	r_line += timeStamp;
+	r_line += message;
+	if (color)
+		r_line += RESETCOLOR;
+
+	size_t messageLength = ::strlen(message);
+	if (messageLength < 1 || message[messageLength - 1] != '\n')
+		r_line += '\n';
+
+	return g_ascii_isupper(levelName);
+}
+
+// straight to the terminal, for when there is no log thread (yet, or in a forked child) and for fatal errors
+static void writeTerminalLine(GLogLevelFlags logLevel, const char * message)
+{
+	std::string line;
+	logStart();
+	MutexLocker					lock(&slogFilter_mutex);	// race protection only needed for terminal and file logging
+
+	bool toStderr = formatTerminalLine(line, logLevel, logTimeNs(), sLogIndent.c_str(), sLogIndent.size(), message);
+	::fputs(line.c_str(), toStderr ? stderr : stdout);
+	::fflush(stdout);
+}
+
+static void writeSyslogLine(GLogLevelFlags logLevel, const char * message)
+{
+	luna_syslog(syslogContextGlobal(), logLevel, message);
+}
+
+// writes out one batch of records: one write and one flush for all the stdout lines of the batch
+static void PrvWriteBatch(const LogRingBuffer::Record* records, unsigned int count, std::string& out)
+{
+	bool terminal = Settings::LunaSettings()->logger_useTerminal;
+	if (terminal)
+		logStart();
+	out.clear();
+
+	std::string line;
+	for (unsigned int i = 0; i < count; i++) {
+		const LogRingBuffer::Record& record = records[i];
+		const char * message = record.text + record.indentLength;
+
+		if (!terminal) {
+			writeSyslogLine(record.level, message);
+			continue;
+		}
+
+		line.clear();
+		if (formatTerminalLine(line, record.level, record.timeNs, record.text, record.indentLength, message)) {
+			// keep stdout and stderr lines in order
+			if (!out.empty()) {
+				::fwrite(out.data(), 1, out.size(), stdout);
+				::fflush(stdout);
+				out.clear();
+			}
+			::fputs(line.c_str(), stderr);
+		}
+		else {
+			out += line;
+		}
+	}
+
+	if (!out.empty()) {
+		::fwrite(out.data(), 1, out.size(), stdout);
+		::fflush(stdout);
+	}
+}
+
+static void PrvReportDrops(unsigned int& r_reported)
+{
+	unsigned int dropped = sLogRing->dropped();
+	if (dropped == r_reported)
+		return;
+
+	char message[128];
+	::snprintf(message, sizeof(message), "Logging: %u messages dropped, the log queue was full", dropped - r_reported);
+	r_reported = dropped;
+
+	if (Settings::LunaSettings()->logger_useTerminal)
+		writeTerminalLine(G_LOG_LEVEL_WARNING, message);
+	else
+		writeSyslogLine(G_LOG_LEVEL_WARNING, message);
+}
 
 static gpointer PrvLogThread(gpointer arg)
 {
 	::prctl(PR_SET_NAME, "Logging", 0, 0, 0);
 	::setpriority(PRIO_PROCESS, ::getpid(), 5);
 
-	while (true) {
-		char* buf = (char*) g_async_queue_pop(sLogAsyncQueue);
-
-		GLogLevelFlags logLevel;
-		gchar* message;
+	LogRingBuffer::Record* batch = new LogRingBuffer::Record[sLogBatchSize];
+	std::string out;
+	out.reserve(sLogBatchSize * 160);
+	unsigned int reportedDrops = 0;
 
-		logLevel = *((GLogLevelFlags*)buf);
-		message = buf + sizeof(logLevel);
+	while (true) {
+		unsigned int count = sLogRing->pop(batch, sLogBatchSize);
+		if (count) {
+			PrvWriteBatch(batch, count, out);
+			continue;
+		}
 
-		luna_syslog(syslogContextGlobal(), logLevel, message);
+		PrvReportDrops(reportedDrops);
 
-		free(buf);
+		// sleep until a logger finds us sleeping; whatever came in before the flag was set is seen by empty()
+		g_atomic_int_set(&sLogThreadSleeping, 1);
+		if (!sLogRing->empty() && g_atomic_int_compare_and_exchange(&sLogThreadSleeping, 1, 0))
+			continue;
+		while (::sem_wait(&sLogWakeup) == -1 && errno == EINTR)
+			;
 	}
 
+	delete [] batch;
 	return 0;
 }
 
 static void PrvCreateLogThread()
 {
-	sLogAsyncQueue = g_async_queue_new();
+	sLogRing = new LogRingBuffer(sLogRingCapacity);
+	::sem_init(&sLogWakeup, 0, 0);
 	sLogThread = g_thread_create(PrvLogThread, 0, false, NULL);
 }
 
@@ -241,16 +491,19 @@ static void PrvLogAtForkParent()
 
 static void PrvLogAtForkChild()
 {
-	// At fork, reset the global variables, so that a new thread and async queue
-	// is created for every process context
-	sLogAsyncQueue = 0;
+	// The log thread isn't forked along: a child logs straight to its output
 	sLogThread = 0;
 }
 
 void logInit()
 {
 	Settings* settings = Settings::LunaSettings();
-	if (!settings->logger_useTerminal && settings->logger_useSyslog) {
+	g_atomic_int_set(&gLogLevelGate, settings->logger_level);
+
+	if (settings->logger_useTerminal)
+		logStart();
+
+	if (settings->logger_useTerminal || settings->logger_useSyslog) {
 		pthread_atfork(PrvLogAtForkPrepare, PrvLogAtForkParent, PrvLogAtForkChild);
 		PrvCreateLogThread();
 	}
@@ -262,138 +515,32 @@ void logFilter(const gchar *log_domain, GLogLevelFlags logLevel, const gchar *me
 	if (logLevel > settings->logger_level || message == 0 || *message == 0)
 		return;
 
-	if (!settings->logger_useTerminal)
-	{
-		if (settings->logger_useSyslog) {
-
-			if (G_LIKELY(sLogThread)) {
-
-				int msgSize = strlen(message) + 1;
-				int bufSize = sizeof(logLevel) + msgSize;
-				char* buffer = (char*) malloc(bufSize);
-				*((GLogLevelFlags*)buffer) = logLevel;
-				memcpy(buffer + sizeof(logLevel), message, msgSize);
-
-				g_async_queue_push(sLogAsyncQueue, buffer);
-			}
-			else {
-
-				luna_syslog(syslogContextGlobal(), logLevel, message);
-			}
-		}
-		else
-			g_log_default_handler(log_domain, logLevel, message, unused_data);
+	if (!settings->logger_useTerminal && !settings->logger_useSyslog) {
+		g_log_default_handler(log_domain, logLevel, message, unused_data);
+		return;
 	}
-	else
-	{
-		MutexLocker					lock(&slogFilter_mutex);	// race protection only needed for terminal and file logging
 
-		static struct timespec		sLogStartSeconds = { 0 };
-		static struct tm			sLogStartTime = { 0 };
-		const char *				indent = sLogIndent.c_str();	// we own slogFilter_mutex, so we're ok cache this value while we do
-		if (sLogStartSeconds.tv_sec == 0 && sLogStartSeconds.tv_nsec == 0)
-		{
-			time_t now = ::time(0);
-			::clock_gettime(CLOCK_MONOTONIC, &sLogStartSeconds);
-			::localtime_r(&now, &sLogStartTime);
-			char startTime[64];
-			::asctime_r(&sLogStartTime, startTime);
-			::fprintf(stdout, "Sysmgr starting at %s", startTime);
-		}
-		struct timespec now;
-		::clock_gettime(CLOCK_MONOTONIC, &now);
-		int ms = (now.tv_nsec - sLogStartSeconds.tv_nsec) / 1000000;
-		int sec = sLogStartTime.tm_sec + int (now.tv_sec - sLogStartSeconds.tv_sec);
-		if (ms < 0)
-		{
-			ms += 1000;
-			--sec;
-		}
-		int min = sLogStartTime.tm_min + sec / 60;
-		int hr = sLogStartTime.tm_hour + min / 60;
-		min = min % 60;
-		sec = sec % 60;
-		char timeStamp[128];
-		char levelName = *logLevelName(logLevel);	// just use one letter
-		const char * format = g_ascii_isupper(levelName) ? "%02d:%02d:%02d.%03d*%c*" : "%02d:%02d:%02d.%03d %c ";
-		size_t len = ::snprintf(timeStamp, 128, format, hr, min, sec, ms, levelName);
-		if (len >= G_N_ELEMENTS(timeStamp))
-		{
-			len = G_N_ELEMENTS(timeStamp) - 1;
-			timeStamp[len] = 0;
-		}
-		len = ::strlen(message);
-		bool	needLF = false;
-		if (len < 1 || message[len - 1] != '\n')
-			needLF = true;
-
-//	#define BLACK 		0
-//	#define RED			1
-//	#define GREEN		2
-//	#define YELLOW		3
-//	#define BLUE		4
-//	#define MAGENTA		5
-//	#define CYAN		6
-//	#define	WHITE		7
-
-//	foreground			30 + color
-//	background			40 + color
+	// fatal ones are written before the process goes down, not queued behind the others
+	if (G_LIKELY(sLogThread) && !(logLevel & (G_LOG_FLAG_FATAL | G_LOG_LEVEL_ERROR))) {
 
-//	#define RESET		0
-//	#define BRIGHT 		1
-//	#define DIM			2
-//	#define UNDERLINE 	3
-//	#define BLINK		4
-//	#define REVERSE		7
-//	#define HIDDEN		8
-
-#define COLORESCAPE		"\033["
-
-#define RESETCOLOR		COLORESCAPE "0m"
-
-#define BOLDCOLOR		COLORESCAPE "1m"
-#define REDOVERBLACK	COLORESCAPE "1;31m"
-#define BLUEOVERBLACK	COLORESCAPE "1;34m"
-#define YELLOWOVERBLACK	COLORESCAPE "1;33m"
-
-		FILE * output = g_ascii_isupper(levelName) ? stderr : stdout;
-		if (levelName ==  'd' || !settings->logger_useColor)
-		{
-			if (needLF)
-				::fprintf(output, "%s%s(%d) %s%s\n", timeStamp, indent, getpid(), indent, message);
-			else
-				::fprintf(output, "%s%s(%d) %s%s", timeStamp, indent, getpid(), indent, message);
-		}
-		else if (levelName ==  'w')
-		{
-			if (needLF)
-				::fprintf(output, YELLOWOVERBLACK "%s%s(%d) %s%s" RESETCOLOR "\n", timeStamp, indent, getpid(), indent, message);
-			else
-				::fprintf(output, YELLOWOVERBLACK "%s%s(%d) %s%s" RESETCOLOR, timeStamp, indent, getpid(), indent, message);
+		char indent[64];
+		indent[0] = 0;
+		if (settings->logger_useTerminal && G_UNLIKELY(g_atomic_int_get(&sLogIndentLength))) {
+			MutexLocker lock(&slogFilter_mutex);
+			g_strlcpy(indent, sLogIndent.c_str(), sizeof(indent));
 		}
-		else if (levelName ==  'm')
-		{
-			if (needLF)
-				::fprintf(output, BLUEOVERBLACK "%s%s(%d) %s%s" RESETCOLOR "\n", timeStamp, indent, getpid(), indent, message);
-			else
-				::fprintf(output, BLUEOVERBLACK "%s%s(%d) %s%s" RESETCOLOR, timeStamp, indent, getpid(), indent, message);
-		}
-		else if (g_ascii_isupper(levelName))
-		{
-			if (needLF)
-				::fprintf(output, REDOVERBLACK "%s%s(%d) %s%s" RESETCOLOR "\n", timeStamp, indent, getpid(), indent, message);
-			else
-				::fprintf(stderr, REDOVERBLACK "%s%s(%d) %s%s" RESETCOLOR, timeStamp, indent, getpid(), indent, message);
-		}
-		else
-		{
-			if (needLF)
-				::fprintf(output, BOLDCOLOR "%s%s(%d) %s%s" RESETCOLOR "\n", timeStamp, indent, getpid(), indent, message);
-			else
-				::fprintf(output, BOLDCOLOR "%s%s(%d) %s%s" RESETCOLOR, timeStamp, indent, getpid(), indent, message);
+
+		if (sLogRing->push(logLevel, logTimeNs(), indent, message)) {
+			if (g_atomic_int_get(&sLogThreadSleeping) && g_atomic_int_compare_and_exchange(&sLogThreadSleeping, 1, 0))
+				::sem_post(&sLogWakeup);
 		}
-		::fflush(stdout);
+		return;
 	}
+
+	if (settings->logger_useTerminal)
+		writeTerminalLine(logLevel, message);
+	else
+		writeSyslogLine(logLevel, message);
 }
 
 // In case a VERIFY fails repeatedly, we do not want to fill-up the log files...
@@ -24,7 +24,6 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fstream>
 #include <strings.h>
 
 
@@ -36,21 +35,28 @@
 #include "Settings.h"
 #include "Time.h"
 #include "HostBase.h"
+#include "ApplicationManager.h"
+#include "ApplicationDescription.h"
+#include "ApplicationProcessManager.h"
 
 static const int kTimerMs = 5000;
 static const int kLowMemExpensiveTimeoutMultiplier = 2;
 static const int kNativeMaxMemoryViolationThreshold = 1;
 
+// pressure stall figures (avg10, in percent) that raise the pressure before memchute does
+static const float kPsiSomeMedium = 10.0f;
+static const float kPsiSomeLow = 25.0f;
+static const float kPsiFullCritical = 10.0f;
+
+// time for what was freed to show before terminating more; the PSI averages run 10s behind
+static const uint32_t kReclaimSettleMs = 10000;
+static const unsigned int kRecentReclaims = 16;
+
 static const std::string sMemTotal("MemTotal");
 static const std::string sMemFree("MemFree");
 static const std::string sSwapTotal("SwapTotal");
 static const std::string sSwapFree("SwapFree");
 static const std::string sMemchuteFree("MemchuteFree");
-static const std::string sKBLabel("kb");
-static const std::string sMBLabel("mb");
-
-static const std::string sProcRSS("VmRSS");
-static const std::string sProcSwap("VmSwap");
 
 #define OOM_ADJ_PATH			"/proc/%d/oom_adj"
 #define OOM_SCORE_ADJ_PATH		"/proc/%d/oom_score_adj"
@@ -70,11 +76,10 @@ MemoryMonitor* MemoryMonitor::instance()
 MemoryMonitor::MemoryMonitor()
 	: m_timer(HostBase::instance()->masterTimer(), this, &MemoryMonitor::timerTicked)
 	, m_currRssUsage(0)
+	, m_pressureWatcher(MemoryMonitor::pressureWatcherCallback, this)
 	, m_state(MemoryMonitor::Normal)
+	, m_lastReclaimMs(0)
 {
-	m_fileName[kFileNameLen - 1] = 0;
-	snprintf(m_fileName, kFileNameLen - 1, "/proc/%d/statm", getpid());
-
 	/* Adjust OOM killer so we're never killed for memory reasons */
 	adjustOomScore();
 }
@@ -114,10 +119,12 @@ void MemoryMonitor::adjustOomScore()
 
 void MemoryMonitor::start()
 {
-	if (m_timer.running())
+	if (m_timer.running() || m_pressureWatcher.watching())
 		return;
-	
-	m_timer.start(kTimerMs);
+
+	// the kernel wakes us when the pressure rises; without that, sample it every kTimerMs
+	m_pressureWatcher.start(g_main_loop_get_context(HostBase::instance()->mainLoop()));
+	pollIfNeeded();
 
 #if defined(HAS_MEMCHUTE)
 	m_memWatch = MemchuteWatcherNew(MemoryMonitor::memchuteCallback);
@@ -153,8 +160,12 @@ bool MemoryMonitor::timerTicked()
 		checkMonitoredProcesses();
 #endif
 
+	ReclaimPolicy::Pressure pressure = currentPressure();
+	if (pressure != ReclaimPolicy::PressureNormal)
+		reclaimApplications(pressure);
+
 	if (m_state == Normal)	{
-		return true;
+		return needsPolling();
 	}
 
 	m_currRssUsage = getCurrentRssUsage();
@@ -162,54 +173,154 @@ bool MemoryMonitor::timerTicked()
 	g_warning("SysMgr MemoryMonitor: LOW MEMORY: State: %s, current RSS usage: %dMB\n",
 			  nameForState(m_state), m_currRssUsage);
 
-	return true;
+	return needsPolling();
 }
 
-int MemoryMonitor::getCurrentRssUsage() const
+bool MemoryMonitor::needsPolling() const
 {
-	FILE* f = fopen(m_fileName, "rb");
-	if (!f)
-		return m_currRssUsage;
+	if (!m_pressureWatcher.watching() || m_state != Normal
+		|| m_pressureWatcher.pressure() != ReclaimPolicy::PressureNormal)
+		return true;
 
-	int totalSize, rssSize;
+#if defined(HAS_MEMCHUTE)
+	if (!memRestrict.empty())
+		return true;
+#endif
 
-	int result = fscanf(f, "%d %d", &totalSize, &rssSize);
-	(void)result;
+	return false;
+}
 
-	fclose(f);	
-	
-    return (rssSize * 4096) / (1024 * 1024);
+void MemoryMonitor::pollIfNeeded()
+{
+	if (!m_timer.running() && needsPolling())
+		m_timer.start(kTimerMs);
 }
 
-bool MemoryMonitor::getMemInfo(int& lowMemoryEntryRem, int& criticalMemoryEntryRem, int& rebootMemoryEntryRem)
+void MemoryMonitor::pressureWatcherCallback(ReclaimPolicy::Pressure pressure, void* data)
 {
-    std::ifstream memInfo("/sys/class/memnotify/meminfo");
-    if (!memInfo) {
-		g_warning("MemoryMonitor::getMemInfo Failed to open /sys/class/memnotify/meminfo");
-		return false;
+	static_cast<MemoryMonitor*>(data)->pressureChanged(pressure);
+}
+
+void MemoryMonitor::pressureChanged(ReclaimPolicy::Pressure pressure)
+{
+#if !defined(HAS_MEMCHUTE)
+	// nothing else sets the state here
+	MemState state = static_cast<MemState>(pressure);
+	if (state != m_state) {
+		m_state = state;
+		Q_EMIT memoryStateChanged(m_state == Critical);
 	}
+#endif
 
-	std::string field;
+	if (pressure != ReclaimPolicy::PressureNormal)
+		reclaimApplications(currentPressure());
 
-	// Skip lines till we reach the "Enter Thresholds" section
-	bool inEnterThresholdSection = false;
-	while (memInfo >> field) {
-		if (strcasecmp(field.c_str(), "Enter") == 0) {
-			std::getline(memInfo, field);
-			inEnterThresholdSection = true;
-			break;
-		}
+	// also where a watcher that gave up ends up: the timer takes over
+	pollIfNeeded();
+}
+
+ReclaimPolicy::Pressure MemoryMonitor::currentPressure()
+{
+	ReclaimPolicy::Pressure pressure = qMax(static_cast<ReclaimPolicy::Pressure>(m_state),
+											m_pressureWatcher.pressure());
+
+	float someAvg10, fullAvg10;
+	if (!m_sampler.memoryPressure(someAvg10, fullAvg10))
+		return pressure;
+
+	ReclaimPolicy::Pressure stalled = ReclaimPolicy::PressureNormal;
+	if (fullAvg10 >= kPsiFullCritical)
+		stalled = ReclaimPolicy::PressureCritical;
+	else if (someAvg10 >= kPsiSomeLow)
+		stalled = ReclaimPolicy::PressureLow;
+	else if (someAvg10 >= kPsiSomeMedium)
+		stalled = ReclaimPolicy::PressureMedium;
+
+	return qMax(pressure, stalled);
+}
+
+void MemoryMonitor::reclaimApplications(ReclaimPolicy::Pressure pressure)
+{
+	uint32_t now = Time::curTimeMs();
+	if (m_lastReclaimMs && now - m_lastReclaimMs < kReclaimSettleMs)
+		return;
+
+	// without the compositor's word on what is on screen, any app could be the one the user is looking at
+	ApplicationProcessManager* processManager = ApplicationProcessManager::instance();
+	if (!processManager->foregroundKnown())
+		return;
+
+	QList<ApplicationProcess*> running = processManager->runningApplications();
+
+	std::vector<pid_t> pids;
+	Q_FOREACH(ApplicationProcess* process, running)
+		pids.push_back(process->pid());
+
+	MemorySampler::ProcessSamples samples;
+	m_appSampler.keepOnly(pids);
+	m_appSampler.sampleProcesses(pids, samples);
+
+	std::vector<ReclaimPolicy::Candidate> candidates;
+	Q_FOREACH(ApplicationProcess* process, running) {
+		MemorySampler::ProcessSamples::const_iterator sample = samples.find(process->pid());
+		if (process->pid() <= 0 || sample == samples.end())
+			continue;
+
+		ReclaimPolicy::Candidate candidate;
+		candidate.appId = process->id().toStdString();
+		candidate.pid = process->pid();
+		candidate.memoryMb = sample->second.totalMb();
+		candidate.idleMs = qMax<qint64>(processManager->idleMs(process), 0);
+		candidate.foreground = processManager->isForeground(process);
 
-		std::getline(memInfo, field);
+		ApplicationDescription* desc = ApplicationManager::instance()->getAppById(candidate.appId);
+		candidate.handlesRelaunch = desc && desc->handlesRelaunch();
+
+		candidates.push_back(candidate);
 	}
 
-	if (!inEnterThresholdSection) {
-		g_warning("MemoryMonitor::getMemInfo Could not find Enter Threshold section");
-		return false;
+	std::vector<ReclaimPolicy::Candidate> selected = ReclaimPolicy::select(candidates, pressure);
+	if (selected.empty())
+		return;
+
+	const char* pressureName = ReclaimPolicy::pressureName(pressure);
+	for (std::vector<ReclaimPolicy::Candidate>::const_iterator it = selected.begin(); it != selected.end(); ++it) {
+		g_warning("MemoryMonitor: %s memory pressure, terminating %s (pid %lld, %d MB, idle %llu s)",
+				  pressureName, it->appId.c_str(), (long long) it->pid, it->memoryMb,
+				  (unsigned long long) it->idleMs / 1000);
+
+		processManager->killByAppId(it->appId);
+		m_appSampler.forget(it->pid);
+
+		Reclaim reclaim;
+		reclaim.appId = it->appId;
+		reclaim.pid = it->pid;
+		reclaim.memoryMb = it->memoryMb;
+		reclaim.pressure = pressureName;
+		reclaim.time = ::time(0);
+		m_recentReclaims.push_back(reclaim);
+		while (m_recentReclaims.size() > kRecentReclaims)
+			m_recentReclaims.pop_front();
+
+		Q_EMIT applicationReclaimed(QString::fromStdString(it->appId), it->pid, it->memoryMb, pressureName);
 	}
 
+	m_lastReclaimMs = now ? now : 1;
+}
+
+int MemoryMonitor::getCurrentRssUsage()
+{
+	long rssPages = m_sampler.selfRssPages();
+	if (rssPages < 0)
+		return m_currRssUsage;
+
+    return (rssPages * 4096) / (1024 * 1024);
+}
+
+bool MemoryMonitor::getMemInfo(int& lowMemoryEntryRem, int& criticalMemoryEntryRem, int& rebootMemoryEntryRem)
+{
 	/*
-	  Sample file contents:
+	  Sample /sys/class/memnotify/meminfo contents, we want the Rem of the Enter Thresholds:
 
 	  Used (Mem+Swap): 160MB
 	  Used (Mem): 91MB
@@ -230,113 +341,24 @@ bool MemoryMonitor::getMemInfo(int& lowMemoryEntryRem, int& criticalMemoryEntryR
 	  reboot: 112, 224MB, Rem: 64MB:
 	*/
 
-	std::string dummyStr;
-	int dummyInt;
-
-	lowMemoryEntryRem = -1;
-	criticalMemoryEntryRem = -1;
-	rebootMemoryEntryRem = -1;
-
-	const int neededEntries = 3;
-	int foundEntries = 0;
-	
-	
-	while (memInfo >> field) {
-		if (strcasecmp(field.c_str(), "low:") == 0) {
-
-			memInfo >> dummyStr;
-			memInfo >> dummyStr;
-			memInfo >> dummyStr;
-			memInfo >> lowMemoryEntryRem;
-			memInfo >> dummyStr;
-
-			foundEntries++;
-		}
-		else if (strcasecmp(field.c_str(), "critical:") == 0) {
-
-			memInfo >> dummyStr;
-			memInfo >> dummyStr;
-			memInfo >> dummyStr;
-			memInfo >> criticalMemoryEntryRem;
-			memInfo >> dummyStr;
-
-			foundEntries++;
-		}
-		else if (strcasecmp(field.c_str(), "reboot:") == 0) {
-
-			memInfo >> dummyStr;
-			memInfo >> dummyStr;
-			memInfo >> dummyStr;
-			memInfo >> rebootMemoryEntryRem;
-			memInfo >> dummyStr;
-
-			foundEntries++;
-			// Done
-			break;
-		}
-		else {
-			std::getline(memInfo, field);
-		}
+	if (!m_sampler.memnotifyEnterRem(lowMemoryEntryRem, criticalMemoryEntryRem, rebootMemoryEntryRem)) {
+		g_warning("MemoryMonitor::getMemInfo Failed to read the Enter Thresholds of /sys/class/memnotify/meminfo");
+		return false;
 	}
 
-	memInfo.close();
-    return (neededEntries == foundEntries);
+	return true;
 }
 
-int MemoryMonitor::getProcessMemInfo(pid_t pid)
+void MemoryMonitor::sampleMonitoredProcesses(MemorySampler::ProcessSamples& r_samples)
 {
-	int procRss  = -1;
-	int procSwap = -1;
-	
- 	char fileName[kFileNameLen];
- 	fileName[kFileNameLen - 1] = 0;
- 	
-	snprintf(fileName, kFileNameLen - 1, "/proc/%d/status", pid);
-    std::ifstream status(fileName);
-   
-    if (!status) {
-        return -1;
-    }
-    std::string field;
-    std::string label;
-
-    while(status >> field) {
-        // strip off the ':' on the end of each label
-        field = field.substr(0, field.length() - 1);
-        
-        if (field == sProcRSS) {
-            status >> procRss;
-            status >> label;
-
-            //Make sure the value is in megabytes
-            if (!strcasecmp(label.c_str(), sKBLabel.c_str())) {
-            	procRss /= 1024;
-            } else if (strcasecmp(label.c_str(), sMBLabel.c_str())) {
-            	procRss /= 1024 * 1024;
-            }
-
-            if(procSwap != -1) break;
-        } else if (field == sProcSwap) {
-            status >> procSwap;
-            status >> label;
-
-            //Make sure the value is in megabytes
-            if (!strcasecmp(label.c_str(), sKBLabel.c_str())) {
-            	procSwap /= 1024;
-            } else if (strcasecmp(label.c_str(), sMBLabel.c_str())) {
-            	procSwap /= 1024 * 1024;
-            }
-            
-            if(procRss != -1) break;
-        }       
-    }
-    
-    status.close();
-    
-    if ((-1 == procRss) || (-1 == procSwap))
-    	return -1;
-    
-    return procRss + procSwap;
+#if defined(HAS_MEMCHUTE)
+	std::vector<pid_t> pids;
+	pids.reserve(memRestrict.size());
+	for (ProcMemRestrictions::const_iterator it = memRestrict.begin(); it != memRestrict.end(); ++it)
+		pids.push_back(it->first);
+
+	m_sampler.sampleProcesses(pids, r_samples);
+#endif
 }
 
 void MemoryMonitor::monitorNativeProcessMemory(pid_t pid, int maxMemAllowed, pid_t updateFromPid)
@@ -353,6 +375,8 @@ void MemoryMonitor::monitorNativeProcessMemory(pid_t pid, int maxMemAllowed, pid
 				// remove the old monitor
 				memRestrict.erase(old);
 				delete monitor;
+				if (updateFromPid != pid)
+					m_sampler.forget(updateFromPid);
 			}
 		}
 	} 
@@ -364,6 +388,8 @@ void MemoryMonitor::monitorNativeProcessMemory(pid_t pid, int maxMemAllowed, pid
 	monitor->violationNumber = 0;
 	
 	memRestrict[pid] = monitor;
+
+	pollIfNeeded();
 #endif
 }
 
@@ -374,6 +400,10 @@ int MemoryMonitor::getMonitoredProcessesMemoryOffset()
 	int takenMem, declaredMem;
 	ProcMemRestrictions::iterator it, temp;
 	
+	// find out how much memory the processes are actually taking at the moment
+	MemorySampler::ProcessSamples samples;
+	sampleMonitoredProcesses(samples);
+
 	it = memRestrict.begin();
 	
 	// iterate through all monitored processes
@@ -386,8 +416,8 @@ int MemoryMonitor::getMonitoredProcessesMemoryOffset()
 		// declared memory figure
 		declaredMem = monitor->maxMemAllowed;
 		
-		// find out how much memory the process is actually taking at the moment
-		takenMem = getProcessMemInfo(monitor->pid);
+		MemorySampler::ProcessSamples::const_iterator sample = samples.find(monitor->pid);
+		takenMem = (sample != samples.end()) ? sample->second.totalMb() : -1;
 		
 		if (declaredMem > takenMem){ // if process isn't at or above its declared memory figure
 			// add the difference to the memory offset
@@ -403,6 +433,9 @@ void MemoryMonitor::checkMonitoredProcesses()
 {
 	int procMem;
 	
+	MemorySampler::ProcessSamples samples;
+	sampleMonitoredProcesses(samples);
+
 	ProcMemRestrictions::iterator it, temp;
 	it = memRestrict.begin();
 	while (it != memRestrict.end()) {
@@ -411,7 +444,8 @@ void MemoryMonitor::checkMonitoredProcesses()
 		
 		ProcMemMonitor *monitor = temp->second;
 		
-		procMem = getProcessMemInfo(monitor->pid);
+		MemorySampler::ProcessSamples::const_iterator sample = samples.find(monitor->pid);
+		procMem = (sample != samples.end()) ? sample->second.totalMb() : -1;
 		
 		if(-1 == procMem) { // Process doesn't exist (terminated), so remove the entry from the monitor list
 			memRestrict.erase(temp);
@@ -435,6 +469,7 @@ void MemoryMonitor::checkMonitoredProcesses()
 						IpcServer::instance()->killProcess(monitor->pid, true);
 						
 						// remove the entry from the monitor list
+						m_sampler.forget(monitor->pid);
 						memRestrict.erase(temp);
 						delete monitor;
 					}
@@ -509,5 +544,10 @@ void MemoryMonitor::memchuteCallback(MemchuteThreshold threshold)
 void MemoryMonitor::memchuteStateChanged()
 {
 	Q_EMIT memoryStateChanged(m_state == Critical);
+	pollIfNeeded();
+
+	// don't wait for the next tick once it gets serious
+	if (m_state >= Low)
+		reclaimApplications(currentPressure());
 }
 #endif
@@ -25,11 +25,18 @@
 #include "Common.h"
 
 #include <stdint.h>
+#include <time.h>
+#include <list>
 #include <map>
+#include <string>
 #include <QObject>
+#include <QString>
 
 #include "Timer.h"
 #include "Mutex.h"
+#include "MemoryPressureWatcher.h"
+#include "MemorySampler.h"
+#include "ReclaimPolicy.h"
 
 #if defined(HAS_MEMCHUTE)
 extern "C" {
@@ -62,9 +69,22 @@ public:
 
 	bool getMemInfo(int& lowMemoryEntryRem, int& criticalMemoryEntryRem, int& rebootMemoryEntryRem);
 
+	// an application terminated to get memory back
+	struct Reclaim {
+		std::string appId;
+		qint64 pid;
+		int memoryMb;
+		std::string pressure;
+		time_t time;
+	};
+
+	// newest last
+	const std::list<Reclaim>& recentReclaims() const { return m_recentReclaims; }
+
 Q_SIGNALS:
 
 	void memoryStateChanged(bool critical);
+	void applicationReclaimed(const QString& appId, qint64 pid, int memoryMb, const QString& pressure);
 
 private:
 
@@ -72,12 +92,25 @@ private:
 	~MemoryMonitor();
 
 	bool timerTicked();
-	int getCurrentRssUsage() const;
+	int getCurrentRssUsage();
+
+	// the timer only runs while there is something to poll: no pressure watcher, pressure above Normal or
+	// native processes to check
+	bool needsPolling() const;
+	void pollIfNeeded();
 
-	int getProcessMemInfo(pid_t pid);
+	static void pressureWatcherCallback(ReclaimPolicy::Pressure pressure, void* data);
+	void pressureChanged(ReclaimPolicy::Pressure pressure);
+
+	// all monitored processes in one pass; the ones that are gone are left out
+	void sampleMonitoredProcesses(MemorySampler::ProcessSamples& r_samples);
 
 	void adjustOomScore();
 
+	// the memchute (or pressure watcher) state, raised to what the kernel's pressure stall averages say
+	ReclaimPolicy::Pressure currentPressure();
+	void reclaimApplications(ReclaimPolicy::Pressure pressure);
+
 #if defined(HAS_MEMCHUTE)
     static void memchuteCallback(MemchuteThreshold threshold);
 	void memchuteStateChanged();
@@ -91,7 +124,14 @@ private:
 	int m_currRssUsage;
 
 	static const int kFileNameLen = 128;
-	char m_fileName[kFileNameLen];
+
+	MemorySampler m_sampler;
+	MemoryPressureWatcher m_pressureWatcher;
+
+	// for the running applications, kept apart so their files can be dropped with the apps
+	MemorySampler m_appSampler;
+	uint32_t m_lastReclaimMs;
+	std::list<Reclaim> m_recentReclaims;
 
 	MemState m_state;	
 
@@ -0,0 +1,380 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "MemoryPressureWatcher.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// stall (us) per PsiWindowUs for each level; see the class comment
+static const struct {
+	ReclaimPolicy::Pressure level;
+	const char* kind;
+	unsigned int stallUs;
+} sPsiTriggers[] = {
+	{ ReclaimPolicy::PressureMedium, "some", 100000 },
+	{ ReclaimPolicy::PressureLow, "some", 250000 },
+	{ ReclaimPolicy::PressureCritical, "full", 100000 },
+};
+
+MemoryPressureWatcher::MemoryPressureWatcher(Callback callback, void* data, const char* psiPath,
+											 const char* procSelfCgroupPath, const char* cgroupRoot)
+	: m_callback(callback)
+	, m_data(data)
+	, m_psiPath(psiPath)
+	, m_procSelfCgroupPath(procSelfCgroupPath)
+	, m_cgroupRoot(cgroupRoot)
+	, m_context(0)
+	, m_recoverySource(0)
+	, m_pressure(ReclaimPolicy::PressureNormal)
+{
+	for (int i = 0; i <= ReclaimPolicy::PressureCritical; i++)
+		m_lastFiredMs[i] = -1;
+}
+
+MemoryPressureWatcher::~MemoryPressureWatcher()
+{
+	removeWatches();
+
+	if (m_recoverySource) {
+		g_source_destroy(m_recoverySource);
+		g_source_unref(m_recoverySource);
+	}
+}
+
+bool MemoryPressureWatcher::start(GMainContext* context)
+{
+	if (watching())
+		return true;
+
+	m_context = context;
+	if (addPsiTriggers(context) || addCgroupEvents(context)) {
+		g_message("MemoryPressureWatcher: watching memory pressure through %s", sourceName());
+		return true;
+	}
+
+	g_message("MemoryPressureWatcher: no PSI triggers or cgroup memory events, memory pressure is polled");
+	return false;
+}
+
+void MemoryPressureWatcher::stop()
+{
+	if (!watching())
+		return;
+
+	removeWatches();
+	g_message("MemoryPressureWatcher: stopped watching memory pressure, it has to be polled");
+
+	if (m_callback)
+		m_callback(m_pressure, m_data);
+}
+
+const char* MemoryPressureWatcher::sourceName() const
+{
+	if (m_watches.empty())
+		return "none";
+
+	return m_watches.front()->kind == KindPsi ? "psi" : "cgroup";
+}
+
+MemoryPressureWatcher::Watch* MemoryPressureWatcher::addWatch(GMainContext* context, Kind kind, int fd,
+															  GIOCondition condition)
+{
+	Watch* watch = new Watch;
+	watch->watcher = this;
+	watch->kind = kind;
+	watch->level = ReclaimPolicy::PressureNormal;
+	watch->fd = fd;
+	watch->channel = g_io_channel_unix_new(fd);
+	watch->source = g_io_create_watch(watch->channel, condition);
+	g_source_set_callback(watch->source, (GSourceFunc) watchCallback, watch, NULL);
+	g_source_attach(watch->source, context);
+
+	m_watches.push_back(watch);
+	return watch;
+}
+
+void MemoryPressureWatcher::removeWatches()
+{
+	while (!m_watches.empty()) {
+		Watch* watch = m_watches.back();
+		m_watches.pop_back();
+		g_source_destroy(watch->source);
+		g_source_unref(watch->source);
+		g_io_channel_unref(watch->channel);
+		::close(watch->fd);
+		delete watch;
+	}
+}
+
+bool MemoryPressureWatcher::addPsiTriggers(GMainContext* context)
+{
+	for (unsigned int i = 0; i < G_N_ELEMENTS(sPsiTriggers); i++) {
+
+		// one trigger per open file
+		int fd = ::open(m_psiPath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0)
+			break;
+
+		char trigger[64];
+		snprintf(trigger, sizeof(trigger), "%s %u %u", sPsiTriggers[i].kind, sPsiTriggers[i].stallUs,
+				 (unsigned int) PsiWindowUs);
+		if (::write(fd, trigger, strlen(trigger) + 1) < 0) {
+			g_warning("MemoryPressureWatcher: can't set PSI trigger \"%s\": %s", trigger, strerror(errno));
+			::close(fd);
+			break;
+		}
+
+		// the kernel signals a crossed trigger with POLLPRI
+		Watch* watch = addWatch(context, KindPsi, fd, G_IO_PRI);
+		watch->level = sPsiTriggers[i].level;
+	}
+
+	// all or nothing: a Medium trigger alone would never tell Critical apart
+	if (m_watches.size() == G_N_ELEMENTS(sPsiTriggers))
+		return true;
+
+	removeWatches();
+	return false;
+}
+
+bool MemoryPressureWatcher::addCgroupEvents(GMainContext* context)
+{
+	char buffer[512];
+	int fd = ::open(m_procSelfCgroupPath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	ssize_t length = ::read(fd, buffer, sizeof(buffer) - 1);
+	::close(fd);
+
+	std::string path = scanCgroupPath(buffer, length > 0 ? length : 0);
+	if (path.empty())
+		return false;
+
+	// the root cgroup has no memory.events
+	path = m_cgroupRoot + path + "/memory.events";
+	fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	// a change to the file shows as POLLPRI (and POLLERR) until it is read again
+	addWatch(context, KindCgroup, fd, G_IO_PRI);
+	if (!readCgroupEvents(m_cgroupEvents)) {
+		removeWatches();
+		return false;
+	}
+
+	return true;
+}
+
+bool MemoryPressureWatcher::readCgroupEvents(CgroupEvents& r_events)
+{
+	if (m_watches.empty() || m_watches.front()->kind != KindCgroup)
+		return false;
+
+	char buffer[512];
+	ssize_t length;
+	do {
+		length = ::pread(m_watches.front()->fd, buffer, sizeof(buffer) - 1, 0);
+	} while (length < 0 && errno == EINTR);
+
+	return length > 0 && scanCgroupEvents(buffer, length, r_events);
+}
+
+gboolean MemoryPressureWatcher::watchCallback(GIOChannel* channel, GIOCondition condition, gpointer data)
+{
+	Watch* watch = (Watch*) data;
+	watch->watcher->fired(watch, condition);
+	return TRUE;
+}
+
+void MemoryPressureWatcher::fired(Watch* watch, GIOCondition condition)
+{
+	ReclaimPolicy::Pressure level = ReclaimPolicy::PressureNormal;
+
+	if (watch->kind == KindPsi) {
+		// POLLERR comes with POLLPRI only when the trigger is gone, and keeps coming. The triggers are all
+		// or nothing, so stop listening to every one of them; watch is gone after this
+		if (condition & G_IO_ERR) {
+			g_warning("MemoryPressureWatcher: PSI trigger failed, no longer watching memory pressure");
+			stop();
+			return;
+		}
+		level = watch->level;
+	}
+	else {
+		CgroupEvents events;
+		if (!readCgroupEvents(events))
+			return;
+		level = cgroupEventsLevel(m_cgroupEvents, events);
+		m_cgroupEvents = events;
+	}
+
+	if (level != ReclaimPolicy::PressureNormal && noteEvent(level, nowMs()))
+		changed();
+
+	scheduleRecovery();
+}
+
+bool MemoryPressureWatcher::noteEvent(ReclaimPolicy::Pressure level, int64_t nowMs)
+{
+	m_lastFiredMs[level] = nowMs;
+	if (level <= m_pressure)
+		return false;
+
+	m_pressure = level;
+	return true;
+}
+
+bool MemoryPressureWatcher::recover(int64_t nowMs)
+{
+	ReclaimPolicy::Pressure level = ReclaimPolicy::PressureNormal;
+	for (int l = m_pressure; l > ReclaimPolicy::PressureNormal; l--) {
+		if (m_lastFiredMs[l] >= 0 && nowMs - m_lastFiredMs[l] < RecoveryMs) {
+			level = static_cast<ReclaimPolicy::Pressure>(l);
+			break;
+		}
+	}
+
+	if (level == m_pressure)
+		return false;
+
+	m_pressure = level;
+	return true;
+}
+
+void MemoryPressureWatcher::changed()
+{
+	g_message("MemoryPressureWatcher: memory pressure %s", ReclaimPolicy::pressureName(m_pressure));
+
+	if (m_callback)
+		m_callback(m_pressure, m_data);
+}
+
+void MemoryPressureWatcher::scheduleRecovery()
+{
+	if (m_recoverySource || m_pressure == ReclaimPolicy::PressureNormal)
+		return;
+
+	m_recoverySource = g_timeout_source_new(RecoveryMs);
+	g_source_set_callback(m_recoverySource, recoveryCallback, this, NULL);
+	g_source_attach(m_recoverySource, m_context);
+}
+
+gboolean MemoryPressureWatcher::recoveryCallback(gpointer data)
+{
+	MemoryPressureWatcher* watcher = (MemoryPressureWatcher*) data;
+
+	g_source_unref(watcher->m_recoverySource);
+	watcher->m_recoverySource = 0;
+
+	if (watcher->recover(nowMs()))
+		watcher->changed();
+
+	// one-shot; another only while the pressure is still up
+	watcher->scheduleRecovery();
+	return FALSE;
+}
+
+int64_t MemoryPressureWatcher::nowMs()
+{
+	return g_get_monotonic_time() / 1000;
+}
+
+bool MemoryPressureWatcher::scanCgroupEvents(const char* text, int length, CgroupEvents& r_events)
+{
+	std::string contents(text, length);
+	const char* p = contents.c_str();
+	int found = 0;
+
+	while (*p) {
+		const char* value = strchr(p, ' ');
+		const char* end = strchr(p, '\n');
+		if (!end)
+			end = p + strlen(p);
+
+		if (value && value < end) {
+			std::string key(p, value - p);
+			uint64_t count = strtoull(value + 1, 0, 10);
+
+			uint64_t* counter = 0;
+			if (key == "low")
+				counter = &r_events.low;
+			else if (key == "high")
+				counter = &r_events.high;
+			else if (key == "max")
+				counter = &r_events.max;
+			else if (key == "oom")
+				counter = &r_events.oom;
+			else if (key == "oom_kill")
+				counter = &r_events.oomKill;
+
+			if (counter) {
+				*counter = count;
+				found++;
+			}
+		}
+
+		p = *end ? end + 1 : end;
+	}
+
+	return found > 0;
+}
+
+ReclaimPolicy::Pressure MemoryPressureWatcher::cgroupEventsLevel(const CgroupEvents& before, const CgroupEvents& after)
+{
+	if (after.max > before.max || after.oom > before.oom || after.oomKill > before.oomKill)
+		return ReclaimPolicy::PressureCritical;
+	if (after.high > before.high)
+		return ReclaimPolicy::PressureLow;
+	if (after.low > before.low)
+		return ReclaimPolicy::PressureMedium;
+
+	return ReclaimPolicy::PressureNormal;
+}
+
+std::string MemoryPressureWatcher::scanCgroupPath(const char* text, int length)
+{
+	std::string contents(text, length);
+	std::string::size_type pos = 0;
+
+	while (pos < contents.size()) {
+		std::string::size_type end = contents.find('\n', pos);
+		if (end == std::string::npos)
+			end = contents.size();
+
+		// v1 hierarchies have a number and controllers before the path; v2 is "0::"
+		if (contents.compare(pos, 3, "0::") == 0) {
+			std::string path = contents.substr(pos + 3, end - pos - 3);
+			return path == "/" ? "" : path;
+		}
+
+		pos = end + 1;
+	}
+
+	return "";
+}
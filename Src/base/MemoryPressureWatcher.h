@@ -0,0 +1,157 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef MEMORYPRESSUREWATCHER_H
+#define MEMORYPRESSUREWATCHER_H
+
+#include "Common.h"
+
+#include <glib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ReclaimPolicy.h"
+
+/*
+ * Tells MemoryMonitor about memory pressure as the kernel sees it, without polling.
+ *
+ * Where the kernel has PSI, a trigger is registered on /proc/pressure/memory for each step up:
+ *
+ *     Medium      some tasks stalled 100ms in a second
+ *     Low         some tasks stalled 250ms in a second
+ *     Critical    all tasks stalled 100ms in a second
+ *
+ * and the kernel wakes the main loop when one is crossed. Otherwise, if sysmgr is in a cgroup v2 memory
+ * controller, its memory.events is watched: reclaim below "low" is Medium, hitting "high" is Low, hitting
+ * "max" or an OOM kill is Critical.
+ *
+ * Both only tell when pressure rises, so each level is held for RecoveryMs after it last fired and then
+ * stepped down. While the pressure is Normal nothing wakes up at all; above it, one timeout per RecoveryMs.
+ *
+ * If a PSI trigger fails, all of them are dropped (one level alone can't be told apart from the others) and
+ * watching() turns false; the callback is called then too, so the caller knows to poll again.
+ */
+class MemoryPressureWatcher
+{
+public:
+
+	typedef void (*Callback)(ReclaimPolicy::Pressure pressure, void* data);
+
+	enum {
+		RecoveryMs = 5000,
+		PsiWindowUs = 1000000
+	};
+
+	// callback is called on the main loop with every change of pressure(), and when watching() turns false
+	MemoryPressureWatcher(Callback callback, void* data,
+						  const char* psiPath = "/proc/pressure/memory",
+						  const char* procSelfCgroupPath = "/proc/self/cgroup",
+						  const char* cgroupRoot = "/sys/fs/cgroup");
+	~MemoryPressureWatcher();
+
+	// false if there is nothing to watch; the caller has to poll then
+	bool start(GMainContext* context);
+	bool watching() const { return !m_watches.empty(); }
+	// drop every watch and tell the callback; the pressure held so far still recovers as usual
+	void stop();
+
+	// "psi", "cgroup" or "none"
+	const char* sourceName() const;
+
+	ReclaimPolicy::Pressure pressure() const { return m_pressure; }
+
+	// the level bookkeeping, apart from the main loop for tests: a level fired at nowMs, and the pressure
+	// as of nowMs. Both return true when pressure() changed.
+	bool noteEvent(ReclaimPolicy::Pressure level, int64_t nowMs);
+	bool recover(int64_t nowMs);
+
+	// the counters of a cgroup v2 memory.events file
+	struct CgroupEvents {
+		uint64_t low;
+		uint64_t high;
+		uint64_t max;
+		uint64_t oom;
+		uint64_t oomKill;
+
+		CgroupEvents() : low(0), high(0), max(0), oom(0), oomKill(0) {}
+	};
+
+	static bool scanCgroupEvents(const char* text, int length, CgroupEvents& r_events);
+	// the highest level that went up from before to after, PressureNormal if none did
+	static ReclaimPolicy::Pressure cgroupEventsLevel(const CgroupEvents& before, const CgroupEvents& after);
+	// the cgroup v2 path ("0::/path") in the contents of /proc/self/cgroup, empty if there's none
+	static std::string scanCgroupPath(const char* text, int length);
+
+private:
+
+	enum Kind {
+		KindPsi,
+		KindCgroup
+	};
+
+	struct Watch {
+		MemoryPressureWatcher* watcher;
+		Kind kind;
+		ReclaimPolicy::Pressure level;		// for KindPsi
+		int fd;
+		GIOChannel* channel;
+		GSource* source;
+	};
+
+	bool addPsiTriggers(GMainContext* context);
+	bool addCgroupEvents(GMainContext* context);
+	Watch* addWatch(GMainContext* context, Kind kind, int fd, GIOCondition condition);
+	void removeWatches();
+	bool readCgroupEvents(CgroupEvents& r_events);
+
+	void fired(Watch* watch, GIOCondition condition);
+	void changed();
+	void scheduleRecovery();
+
+	static gboolean watchCallback(GIOChannel* channel, GIOCondition condition, gpointer data);
+	static gboolean recoveryCallback(gpointer data);
+
+	static int64_t nowMs();
+
+	Callback m_callback;
+	void* m_data;
+
+	std::string m_psiPath;
+	std::string m_procSelfCgroupPath;
+	std::string m_cgroupRoot;
+
+	GMainContext* m_context;
+	std::vector<Watch*> m_watches;
+	GSource* m_recoverySource;
+
+	CgroupEvents m_cgroupEvents;
+
+	ReclaimPolicy::Pressure m_pressure;
+	int64_t m_lastFiredMs[ReclaimPolicy::PressureCritical + 1];
+
+private:
+
+	MemoryPressureWatcher(const MemoryPressureWatcher&);
+	MemoryPressureWatcher& operator=(const MemoryPressureWatcher&);
+};
+
+#endif /* MEMORYPRESSUREWATCHER_H */
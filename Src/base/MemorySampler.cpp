@@ -0,0 +1,414 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "MemorySampler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+static const char* const sRollupFile = "smaps_rollup";
+static const char* const sStatusFile = "status";
+
+static inline bool isBlank(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline char lower(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+// p at the start of a line: the start of the next one, or end
+static inline const char* nextLine(const char* p, const char* end)
+{
+	const char* nl = (const char*) memchr(p, '\n', end - p);
+	return nl ? nl + 1 : end;
+}
+
+static inline const char* skipBlanks(const char* p, const char* end)
+{
+	while (p < end && isBlank(*p))
+		p++;
+	return p;
+}
+
+// an optionally signed decimal at p; false if there are no digits
+static bool scanNumber(const char*& p, const char* end, long& r_value)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+	if (p >= end || !isDigit(*p))
+		return false;
+
+	long value = 0;
+	while (p < end && isDigit(*p))
+		value = value * 10 + (*p++ - '0');
+
+	r_value = negative ? -value : value;
+	return true;
+}
+
+// case insensitive: does the text at p start with word?
+static bool startsWith(const char* p, const char* end, const char* word)
+{
+	for (; *word; word++, p++) {
+		if (p >= end || lower(*p) != lower(*word))
+			return false;
+	}
+	return true;
+}
+
+int MemorySampler::ProcessSample::totalMb() const
+{
+	if (pssKb >= 0)
+		return (pssKb + (swapPssKb >= 0 ? swapPssKb : swapKb)) / 1024;
+
+	return (rssKb + swapKb) / 1024;
+}
+
+MemorySampler::MemorySampler(const char* procRoot, const char* memnotifyPath)
+	: m_procRoot(procRoot)
+	, m_memnotifyPath(memnotifyPath)
+	, m_statmFd(-1)
+	, m_memnotifyFd(-1)
+	, m_pressureFd(-1)
+	, m_pressureMissing(false)
+{
+	m_buffer[0] = 0;
+}
+
+MemorySampler::~MemorySampler()
+{
+	for (std::map<pid_t, ProcFile>::iterator it = m_processFiles.begin(); it != m_processFiles.end(); ++it)
+		closeFile(it->second.fd);
+
+	closeFile(m_statmFd);
+	closeFile(m_memnotifyFd);
+	closeFile(m_pressureFd);
+}
+
+void MemorySampler::closeFile(int& fd)
+{
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+}
+
+int MemorySampler::readFile(int fd)
+{
+	ssize_t length;
+	do {
+		length = ::pread(fd, m_buffer, BufferSize - 1, 0);
+	} while (length < 0 && errno == EINTR);
+
+	if (length < 0)
+		length = 0;
+
+	m_buffer[length] = 0;
+	return length;
+}
+
+bool MemorySampler::openProcessFile(pid_t pid, ProcFile& r_file)
+{
+	char path[256];
+
+	// smaps_rollup can exist and still not be readable to us, so try a read before settling on it
+	snprintf(path, sizeof(path), "%s/%d/%s", m_procRoot.c_str(), (int) pid, sRollupFile);
+	r_file.fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (r_file.fd >= 0) {
+		if (readFile(r_file.fd) > 0) {
+			r_file.rollup = true;
+			return true;
+		}
+		closeFile(r_file.fd);
+	}
+
+	snprintf(path, sizeof(path), "%s/%d/%s", m_procRoot.c_str(), (int) pid, sStatusFile);
+	r_file.fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	r_file.rollup = false;
+	return r_file.fd >= 0;
+}
+
+bool MemorySampler::sampleProcess(pid_t pid, ProcessSample& r_sample)
+{
+	std::map<pid_t, ProcFile>::iterator it = m_processFiles.find(pid);
+	if (it == m_processFiles.end()) {
+		ProcFile file;
+		if (!openProcessFile(pid, file))
+			return false;
+		it = m_processFiles.insert(std::make_pair(pid, file)).first;
+	}
+
+	const ProcFile& file = it->second;
+	int length = readFile(file.fd);
+
+	ProcessSample sample;
+	bool found;
+	if (file.rollup) {
+		found = scanField(m_buffer, length, "Rss", sample.rssKb)
+			 && scanField(m_buffer, length, "Pss", sample.pssKb)
+			 && scanField(m_buffer, length, "Swap", sample.swapKb);
+		if (found && !scanField(m_buffer, length, "SwapPss", sample.swapPssKb))
+			sample.swapPssKb = -1;
+	}
+	else {
+		found = scanField(m_buffer, length, "VmRSS", sample.rssKb)
+			 && scanField(m_buffer, length, "VmSwap", sample.swapKb);
+	}
+
+	// gone, or a zombie that has no memory left to report
+	if (!found) {
+		forget(pid);
+		return false;
+	}
+
+	r_sample = sample;
+	return true;
+}
+
+void MemorySampler::sampleProcesses(const std::vector<pid_t>& pids, ProcessSamples& r_samples)
+{
+	ProcessSample sample;
+	for (std::vector<pid_t>::const_iterator it = pids.begin(); it != pids.end(); ++it) {
+		if (sampleProcess(*it, sample))
+			r_samples[*it] = sample;
+	}
+}
+
+void MemorySampler::forget(pid_t pid)
+{
+	std::map<pid_t, ProcFile>::iterator it = m_processFiles.find(pid);
+	if (it == m_processFiles.end())
+		return;
+
+	closeFile(it->second.fd);
+	m_processFiles.erase(it);
+}
+
+void MemorySampler::keepOnly(const std::vector<pid_t>& pids)
+{
+	std::map<pid_t, ProcFile>::iterator it = m_processFiles.begin();
+	while (it != m_processFiles.end()) {
+		if (std::find(pids.begin(), pids.end(), it->first) == pids.end()) {
+			closeFile(it->second.fd);
+			m_processFiles.erase(it++);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+unsigned int MemorySampler::openFileCount() const
+{
+	return m_processFiles.size() + (m_statmFd >= 0 ? 1 : 0) + (m_memnotifyFd >= 0 ? 1 : 0)
+		 + (m_pressureFd >= 0 ? 1 : 0);
+}
+
+long MemorySampler::selfRssPages()
+{
+	if (m_statmFd < 0) {
+		std::string path = m_procRoot + "/self/statm";
+		m_statmFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_statmFd < 0)
+			return -1;
+	}
+
+	long pages;
+	if (!scanStatmRss(m_buffer, readFile(m_statmFd), pages))
+		return -1;
+
+	return pages;
+}
+
+bool MemorySampler::memnotifyEnterRem(int& r_lowRem, int& r_criticalRem, int& r_rebootRem)
+{
+	r_lowRem = -1;
+	r_criticalRem = -1;
+	r_rebootRem = -1;
+
+	if (m_memnotifyFd < 0) {
+		m_memnotifyFd = ::open(m_memnotifyPath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_memnotifyFd < 0)
+			return false;
+	}
+
+	return scanMemnotify(m_buffer, readFile(m_memnotifyFd), r_lowRem, r_criticalRem, r_rebootRem);
+}
+
+bool MemorySampler::memoryPressure(float& r_someAvg10, float& r_fullAvg10)
+{
+	if (m_pressureFd < 0) {
+		// not there before 4.20 or without CONFIG_PSI; no use trying again every time
+		if (m_pressureMissing)
+			return false;
+
+		std::string path = m_procRoot + "/pressure/memory";
+		m_pressureFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_pressureFd < 0) {
+			m_pressureMissing = true;
+			return false;
+		}
+	}
+
+	return scanPressure(m_buffer, readFile(m_pressureFd), r_someAvg10, r_fullAvg10);
+}
+
+bool MemorySampler::scanField(const char* text, int length, const char* label, int& r_valueKb)
+{
+	const char* end = text + length;
+	size_t labelLength = strlen(label);
+
+	for (const char* p = text; p < end; p = nextLine(p, end)) {
+		if ((size_t) (end - p) <= labelLength || p[labelLength] != ':' || memcmp(p, label, labelLength) != 0)
+			continue;
+
+		const char* q = skipBlanks(p + labelLength + 1, end);
+		long value;
+		if (!scanNumber(q, end, value))
+			return false;
+
+		q = skipBlanks(q, end);
+		if (q < end && lower(*q) == 'k')
+			r_valueKb = value;
+		else if (q < end && lower(*q) == 'm')
+			r_valueKb = value * 1024;
+		else
+			r_valueKb = value / 1024;
+		return true;
+	}
+	return false;
+}
+
+bool MemorySampler::scanMemnotify(const char* text, int length, int& r_lowRem, int& r_criticalRem, int& r_rebootRem)
+{
+	const char* end = text + length;
+	const char* p = text;
+
+	// skip lines till we reach the "Enter Thresholds" section
+	for (; p < end; p = nextLine(p, end)) {
+		if (startsWith(skipBlanks(p, end), end, "Enter")) {
+			p = nextLine(p, end);
+			break;
+		}
+	}
+
+	// "low: 100, 200MB, Rem: 40MB:"
+	int found = 0;
+	for (; p < end && !startsWith(skipBlanks(p, end), end, "Leave"); p = nextLine(p, end)) {
+		const char* line = skipBlanks(p, end);
+		const char* lineEnd = nextLine(line, end);
+
+		int* rem = 0;
+		if (startsWith(line, lineEnd, "low:"))
+			rem = &r_lowRem;
+		else if (startsWith(line, lineEnd, "critical:"))
+			rem = &r_criticalRem;
+		else if (startsWith(line, lineEnd, "reboot:"))
+			rem = &r_rebootRem;
+		if (!rem)
+			continue;
+
+		for (const char* q = line; q < lineEnd; q++) {
+			if (startsWith(q, lineEnd, "Rem:")) {
+				q = skipBlanks(q + 4, lineEnd);
+				long value;
+				if (scanNumber(q, lineEnd, value)) {
+					*rem = value;
+					found++;
+				}
+				break;
+			}
+		}
+	}
+
+	return found == 3;
+}
+
+bool MemorySampler::scanStatmRss(const char* text, int length, long& r_pages)
+{
+	const char* end = text + length;
+	const char* p = skipBlanks(text, end);
+
+	long size;
+	if (!scanNumber(p, end, size))
+		return false;
+
+	p = skipBlanks(p, end);
+	return scanNumber(p, end, r_pages);
+}
+
+// "some avg10=1.53 avg60=0.87 avg300=0.22 total=1234567"
+static bool scanAvg10(const char* line, const char* end, float& r_value)
+{
+	for (const char* p = line; p < end && *p != '\n'; p++) {
+		if (!startsWith(p, end, "avg10="))
+			continue;
+
+		p += 6;
+		long whole;
+		if (!scanNumber(p, end, whole))
+			return false;
+
+		float fraction = 0, scale = 0.1f;
+		if (p < end && *p == '.') {
+			for (p++; p < end && isDigit(*p); p++, scale /= 10)
+				fraction += (*p - '0') * scale;
+		}
+		r_value = whole + fraction;
+		return true;
+	}
+	return false;
+}
+
+bool MemorySampler::scanPressure(const char* text, int length, float& r_someAvg10, float& r_fullAvg10)
+{
+	const char* end = text + length;
+	bool some = false, full = false;
+
+	for (const char* p = text; p < end; p = nextLine(p, end)) {
+		if (startsWith(p, end, "some "))
+			some = scanAvg10(p, end, r_someAvg10);
+		else if (startsWith(p, end, "full "))
+			full = scanAvg10(p, end, r_fullAvg10);
+	}
+
+	// older kernels only have the "some" line
+	if (some && !full)
+		r_fullAvg10 = 0;
+
+	return some;
+}
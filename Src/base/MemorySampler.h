@@ -0,0 +1,130 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef MEMORYSAMPLER_H
+#define MEMORYSAMPLER_H
+
+#include "Common.h"
+
+#include <sys/types.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Reads the memory figures MemoryMonitor acts on: per process usage, our own RSS, the memnotify thresholds
+ * and the kernel's memory pressure (PSI).
+ *
+ * Every file is opened once and read again with pread() into a fixed buffer, which makes the kernel
+ * regenerate it; nothing is allocated and nothing goes through iostreams on a sample. A /proc file opened
+ * for a process fails to read once that process is gone, which is how dead pids are noticed (a recycled pid
+ * gets new files).
+ *
+ * For a process, /proc/<pid>/smaps_rollup is read where the kernel has it: its Pss counts shared pages once
+ * per sharer, where VmRSS from /proc/<pid>/status counts them in full for every process mapping them.
+ */
+class MemorySampler
+{
+public:
+
+	struct ProcessSample {
+		int rssKb;
+		int swapKb;
+		int pssKb;			// -1 without smaps_rollup
+		int swapPssKb;		// -1 without smaps_rollup
+
+		ProcessSample() : rssKb(-1), swapKb(-1), pssKb(-1), swapPssKb(-1) {}
+
+		// proportional when known, else resident; swap included
+		int totalMb() const;
+	};
+
+	typedef std::map<pid_t, ProcessSample> ProcessSamples;
+
+	// the roots are for tests; the paths are built from them as "<procRoot>/<pid>/status"
+	explicit MemorySampler(const char* procRoot = "/proc",
+						   const char* memnotifyPath = "/sys/class/memnotify/meminfo");
+	~MemorySampler();
+
+	// samples all of pids in one pass. Processes that are gone are left out of r_samples and forgotten.
+	void sampleProcesses(const std::vector<pid_t>& pids, ProcessSamples& r_samples);
+	bool sampleProcess(pid_t pid, ProcessSample& r_sample);
+
+	// closes what was kept open for pid
+	void forget(pid_t pid);
+	// ... or for every pid not in pids
+	void keepOnly(const std::vector<pid_t>& pids);
+	unsigned int openFileCount() const;
+
+	// resident pages of this process (from <procRoot>/self/statm), -1 if it can't be read
+	long selfRssPages();
+
+	// the "Rem" of the low, critical and reboot entry thresholds in MB, -1 for one that isn't listed
+	bool memnotifyEnterRem(int& r_lowRem, int& r_criticalRem, int& r_rebootRem);
+
+	// the share of the last 10 seconds (in percent) some / all tasks were stalled on memory, from
+	// <procRoot>/pressure/memory; false where the kernel has no PSI
+	bool memoryPressure(float& r_someAvg10, float& r_fullAvg10);
+
+	// the scanners, on a buffer holding a whole file
+	// "<label>: <value> [kB|mB]" at the start of a line, the value in kB
+	static bool scanField(const char* text, int length, const char* label, int& r_valueKb);
+	// see getMemInfo() in MemoryMonitor.cpp for what the memnotify file looks like
+	static bool scanMemnotify(const char* text, int length, int& r_lowRem, int& r_criticalRem, int& r_rebootRem);
+	// the second number of statm
+	static bool scanStatmRss(const char* text, int length, long& r_pages);
+	// the avg10 of the "some" and "full" lines
+	static bool scanPressure(const char* text, int length, float& r_someAvg10, float& r_fullAvg10);
+
+private:
+
+	// a file kept open between reads; -1 when closed
+	struct ProcFile {
+		int fd;
+		bool rollup;
+
+		ProcFile() : fd(-1), rollup(false) {}
+	};
+
+	bool openProcessFile(pid_t pid, ProcFile& r_file);
+	int readFile(int fd);
+	static void closeFile(int& fd);
+
+	enum { BufferSize = 4096 };
+
+	std::string m_procRoot;
+	std::string m_memnotifyPath;
+
+	std::map<pid_t, ProcFile> m_processFiles;
+	int m_statmFd;
+	int m_memnotifyFd;
+	int m_pressureFd;
+	bool m_pressureMissing;
+
+	char m_buffer[BufferSize];
+
+private:
+
+	MemorySampler(const MemorySampler&);
+	MemorySampler& operator=(const MemorySampler&);
+};
+
+#endif /* MEMORYSAMPLER_H */
@@ -0,0 +1,105 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "ReclaimPolicy.h"
+
+#include <algorithm>
+
+static const uint64_t kMaxIdleMinutes = 60;
+
+uint64_t ReclaimPolicy::score(const Candidate& candidate)
+{
+	uint64_t memory = (candidate.memoryMb > 0 ? candidate.memoryMb : 0) + 1;
+	uint64_t idleMinutes = std::min<uint64_t>(candidate.idleMs / (60 * 1000), kMaxIdleMinutes);
+
+	return memory * (1 + idleMinutes) * (candidate.handlesRelaunch ? 2 : 1);
+}
+
+static bool higherScore(const ReclaimPolicy::Candidate& a, const ReclaimPolicy::Candidate& b)
+{
+	uint64_t scoreA = ReclaimPolicy::score(a);
+	uint64_t scoreB = ReclaimPolicy::score(b);
+	if (scoreA != scoreB)
+		return scoreA > scoreB;
+
+	return a.idleMs > b.idleMs;
+}
+
+std::vector<ReclaimPolicy::Candidate> ReclaimPolicy::select(const std::vector<Candidate>& candidates, Pressure pressure)
+{
+	std::vector<Candidate> selected;
+	if (pressure == PressureNormal)
+		return selected;
+
+	uint64_t minIdleMs = 0;
+	int reclaimMb = 0;
+	unsigned int maxCount = candidates.size();
+	switch (pressure) {
+	case PressureMedium:
+		minIdleMs = MediumMinIdleMs;
+		maxCount = 1;
+		break;
+	case PressureLow:
+		minIdleMs = LowMinIdleMs;
+		reclaimMb = LowReclaimMb;
+		break;
+	default:
+		reclaimMb = CriticalReclaimMb;
+		break;
+	}
+
+	std::vector<Candidate> eligible;
+	for (std::vector<Candidate>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+		// the one in front of the user stays, whatever it costs
+		if (!it->foreground && it->idleMs >= minIdleMs)
+			eligible.push_back(*it);
+	}
+	std::stable_sort(eligible.begin(), eligible.end(), higherScore);
+
+	int freedMb = 0;
+	for (std::vector<Candidate>::const_iterator it = eligible.begin(); it != eligible.end(); ++it) {
+		if (selected.size() >= maxCount || (reclaimMb > 0 && freedMb >= reclaimMb))
+			break;
+
+		selected.push_back(*it);
+		freedMb += it->memoryMb > 0 ? it->memoryMb : 0;
+	}
+
+	return selected;
+}
+
+const char* ReclaimPolicy::pressureName(Pressure pressure)
+{
+	switch (pressure) {
+	case PressureMedium:
+		return "Medium";
+	case PressureLow:
+		return "Low";
+	case PressureCritical:
+		return "Critical";
+	default:
+		break;
+	}
+
+	return "Normal";
+}
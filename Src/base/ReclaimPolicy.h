@@ -0,0 +1,83 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef RECLAIMPOLICY_H
+#define RECLAIMPOLICY_H
+
+#include "Common.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Which running applications MemoryMonitor terminates to get memory back, and in what order.
+ *
+ * Every candidate gets a score; the higher it is, the sooner it goes:
+ *
+ *     (memory in MB + 1) * (1 + minutes since it last had focus, up to an hour) * (2 if it handles relaunch)
+ *
+ * so big apps nobody has looked at in a while go first, and an app that restores itself when relaunched
+ * goes before one that would lose its state. The app on screen, as the compositor last reported it, is never
+ * picked, however long it has been there.
+ *
+ * How much is taken depends on the pressure: at Medium one app that has been idle a good while, at Low
+ * enough idle apps to free LowReclaimMb, at Critical enough of any app to free CriticalReclaimMb.
+ */
+class ReclaimPolicy
+{
+public:
+
+	// the same steps as MemoryMonitor::MemState
+	enum Pressure {
+		PressureNormal = 0,
+		PressureMedium,
+		PressureLow,
+		PressureCritical
+	};
+
+	struct Candidate {
+		std::string appId;
+		int64_t pid;
+		int memoryMb;				// -1 if unknown
+		uint64_t idleMs;			// since it last had focus (or was launched)
+		bool handlesRelaunch;
+		bool foreground;			// on screen
+
+		Candidate() : pid(0), memoryMb(-1), idleMs(0), handlesRelaunch(false), foreground(false) {}
+	};
+
+	enum {
+		MediumMinIdleMs = 5 * 60 * 1000,
+		LowMinIdleMs = 30 * 1000,
+		LowReclaimMb = 64,
+		CriticalReclaimMb = 128
+	};
+
+	static uint64_t score(const Candidate& candidate);
+
+	// the candidates to terminate at this pressure, in the order to do it
+	static std::vector<Candidate> select(const std::vector<Candidate>& candidates, Pressure pressure);
+
+	static const char* pressureName(Pressure pressure);
+};
+
+#endif /* RECLAIMPOLICY_H */
@@ -33,12 +33,15 @@
 #include "ApplicationDescription.h"
 #include "ApplicationManager.h"
 #include "ApplicationDescription.h"
+#include "ApplicationProcessManager.h"
 #include "AnimationSettings.h"
 #include "HostBase.h"
 #include "Logging.h"
+#include "LogFilter.h"
 #include "Settings.h"
 #include "SystemService.h"
 #include "Utils.h"
+#include "ValidatedJsonMessage.h"
 
 #include "MemoryMonitor.h"
 #include "Security.h"
@@ -61,6 +64,8 @@ static const std::string sModalWindowSubscriptionPrefix = "MODAL_WINDOW_";
 static const std::string sCreateModalTag = ", \"createAsModal\": true }";
 static const std::string sModalLaunchTimedOut = "Modal window launch took more than 5 seconds.";
 static const std::string sModalDimissTimedOut = "Modal window dismiss took more than 5 seconds.";
+// the only service that knows which application is in front
+static const char* sCompositorServiceName = "org.webosports.luna";
 
 QTimer SystemService::sModalLauchCheckTimer;
 SystemService::ActiveModalDialogInfo SystemService::sActiveModalInfo;
@@ -82,6 +87,8 @@ static bool cbGetAppRestoreNeeded(LSHandle* lshandle, LSMessage *message,
 								  void *user_data);
 static bool cbGetForegroundApplication(LSHandle* lsHandle, LSMessage *message,
 									   void *user_data);
+static bool cbSetForegroundApplication(LSHandle* lsHandle, LSMessage *message,
+									   void *user_data);
 static bool cbApplicationHasBeenTerminated(LSHandle* lsHandle, LSMessage *message,
 									       void *user_data);
 static bool cbGetLockStatus(LSHandle* lsHandle, LSMessage *message,
@@ -138,6 +145,9 @@ static bool cbLogTouchEvents(LSHandle* lsHandle, LSMessage *message,
 static bool cbSetBenchmarkFlags(LSHandle* lsHandle, LSMessage *message,
                                 void *user_data);
 
+static bool cbLogChannels(LSHandle* lsHandle, LSMessage *message,
+                          void *user_data);
+
 static bool cbDumpRasters(LSHandle* lsHandle, LSMessage *message,
 						  void *user_data);
 
@@ -161,6 +171,8 @@ static bool cbDismissModalApp(LSHandle* lshandle, LSMessage *message,
 
 static bool cbSubscribeTurboMode(LSHandle* lshandle, LSMessage *message, void *user_data);
 
+static bool cbGetReclaimedApplications(LSHandle* lshandle, LSMessage *message, void *user_data);
+
 static bool cbSubscriptionCancel(LSHandle *lshandle, LSMessage *message, void *user_data);
 
 /*! \page com_palm_systemmanager Service API com.palm.systemmanager
@@ -175,6 +187,7 @@ static bool cbSubscriptionCancel(LSHandle *lshandle, LSMessage *message, void *u
  *  - \ref com_palm_systemmanager_get_dock_mode_status
  *  - \ref com_palm_systemmanager_get_foreground_application
  *  - \ref com_palm_systemmanager_get_lock_status
+ *  - \ref com_palm_systemmanager_get_reclaimed_applications
  *  - \ref com_palm_systemmanager_get_security_policy
  *  - \ref com_palm_systemmanager_get_system_status
  *  - \ref com_palm_systemmanager_launch_modal_app
@@ -184,6 +197,7 @@ static bool cbSubscriptionCancel(LSHandle *lshandle, LSMessage *message, void *u
  *  - \ref com_palm_systemmanager_run_progress_animation
  *  - \ref com_palm_systemmanager_set_animation_values
  *  - \ref com_palm_systemmanager_set_device_passcode
+ *  - \ref com_palm_systemmanager_set_foreground_application
  *  - \ref com_palm_systemmanager_set_javascript_flags
  *  - \ref com_palm_systemmanager_subscribe_turbo_mode
  *  - \ref com_palm_systemmanager_system_ui
@@ -202,6 +216,7 @@ static LSMethod s_methods[]  = {
 	{ "getAppRestoreNeeded", cbGetAppRestoreNeeded },
 	{ "applicationHasBeenTerminated", cbApplicationHasBeenTerminated},
 	{ "getForegroundApplication", cbGetForegroundApplication },
+	{ "setForegroundApplication", cbSetForegroundApplication },
 	{ "getLockStatus", cbGetLockStatus },
 	{ "getDockModeStatus", cbGetDockModeStatus },
 	{ "setDevicePasscode", cbSetDevicePasscode },
@@ -227,6 +242,7 @@ static LSMethod s_methods[]  = {
 	{ "enableFpsCounter", cbEnableFpsCounter },
 	{ "enableTouchPlot", cbEnableTouchPlot },
 	{ "setBenchmarkFlags", cbSetBenchmarkFlags },
+	{ "logChannels", cbLogChannels },
 	{ "systemUiDbg",	   cbSystemUiDbg },
 	{ "dumpRasters", cbDumpRasters },
 	{ "dumpJemallocHeap", cbDumpJemallocHeap },
@@ -236,6 +252,7 @@ static LSMethod s_methods[]  = {
     { "launchModalApp", cbLaunchModalApp },
     { "dismissModalApp", cbDismissModalApp },
     { "subscribeTurboMode", cbSubscribeTurboMode },
+    { "getReclaimedApplications", cbGetReclaimedApplications },
     { 0, 0 },
 };
 
@@ -278,6 +295,8 @@ void SystemService::init()
     // connect(SystemUiController::instance(), SIGNAL(signalModalWindowAdded()), this, SLOT(slotModalWindowAdded()));
     // connect(SystemUiController::instance(), SIGNAL(signalModalWindowRemoved()), this, SLOT(slotModalWindowRemoved()));
 	connect(&sModalLauchCheckTimer, SIGNAL(timeout()), SLOT(slotModalDialogTimerFired()));
+	connect(MemoryMonitor::instance(), SIGNAL(applicationReclaimed(QString,qint64,int,QString)),
+			SLOT(postApplicationReclaimed(QString,qint64,int,QString)));
 }
 
 void SystemService::startService()
@@ -406,6 +425,11 @@ void SystemService::postForegroundApplicationChange(const std::string& title,
 		json_object_object_add(json, (char*) "id",
 							   json_object_new_string((char*) id.c_str()));
 
+	m_foregroundTitle = title;
+	m_foregroundMenuName = menuname;
+	m_foregroundId = id;
+	ApplicationProcessManager::instance()->setForegroundApplication(id);
+
 	retVal = LSSubscriptionPost(m_service, "/", "getForegroundApplication",
 								json_object_to_json_string(json), &lsError);
 	if (!retVal)
@@ -444,6 +468,52 @@ void SystemService::postApplicationHasBeenTerminated(const std::string& title,
 	json_object_put(json);
 }
 
+static json_object* reclaimToJson(const MemoryMonitor::Reclaim& reclaim)
+{
+	json_object* json = json_object_new_object();
+	json_object_object_add(json, "appId", json_object_new_string(reclaim.appId.c_str()));
+	json_object_object_add(json, "pid", json_object_new_int(reclaim.pid));
+	json_object_object_add(json, "memoryMb", json_object_new_int(reclaim.memoryMb));
+	json_object_object_add(json, "pressure", json_object_new_string(reclaim.pressure.c_str()));
+	json_object_object_add(json, "time", json_object_new_int(reclaim.time));
+	return json;
+}
+
+void SystemService::postApplicationReclaimed(const QString& appId, qint64 pid, int memoryMb, const QString& pressure)
+{
+	LSError lsError;
+	LSErrorInit(&lsError);
+
+	MemoryMonitor::Reclaim reclaim;
+	reclaim.appId = appId.toStdString();
+	reclaim.pid = pid;
+	reclaim.memoryMb = memoryMb;
+	reclaim.pressure = pressure.toStdString();
+	reclaim.time = ::time(0);
+
+	json_object* reclaimed = json_object_new_array();
+	json_object_array_add(reclaimed, reclaimToJson(reclaim));
+	json_object* json = json_object_new_object();
+	json_object_object_add(json, "reclaimed", reclaimed);
+
+	if (!LSSubscriptionPost(m_service, "/", "getReclaimedApplications",
+							json_object_to_json_string(json), &lsError))
+		LSErrorFree (&lsError);
+
+	json_object_put(json);
+
+	// it is gone as far as anyone listening for terminated apps is concerned, too
+	std::string title, menuName;
+	ApplicationDescription* desc = ApplicationManager::instance()->getAppById(reclaim.appId);
+	if (desc) {
+		const LaunchPoint* lp = desc->getDefaultLaunchPoint();
+		if (lp)
+			title = lp->title();
+		menuName = desc->menuName();
+	}
+	postApplicationHasBeenTerminated(title, menuName, reclaim.appId);
+}
+
 void SystemService::postLockStatus(bool locked)
 {
 	LSError lsError;
@@ -981,9 +1051,9 @@ void SystemService::enterMSM()
 //}
 
 //workaround until an agreement is reached with activitydamager about message formats
-static pbnjson::JSchema cbSystemUiSchema()
+static const pbnjson::JSchema& cbSystemUiSchema()
 {
-	return pbnjson::JSchemaFragment("{}");
+	return JsonSchemaCache::schema("{}");
 }
 
 /*!
@@ -1308,7 +1378,7 @@ static bool cbSystemUi(LSHandle* lshandle, LSMessage *message, void *user_data)
 
 	pbnjson::JGenerator generator;
 
-	generator.toString(payload, pbnjson::JSchemaFragment("{}"), result);
+	generator.toString(payload, JsonSchemaCache::schema("{}"), result);
 
 	if (!LSMessageReply(lshandle, message, result.c_str(), &lserror))
 		LSErrorFree(&lserror);
@@ -1316,9 +1386,9 @@ static bool cbSystemUi(LSHandle* lshandle, LSMessage *message, void *user_data)
 	return true;
 }
 
-static pbnjson::JSchema cbSystemUiDbgSchema()
+static const pbnjson::JSchema& cbSystemUiDbgSchema()
 {
-	return pbnjson::JSchemaFragment("{}");
+	return JsonSchemaCache::schema("{}");
 }
 
 static bool cbSystemUiDbg(LSHandle* lshandle, LSMessage *message,
@@ -1366,7 +1436,7 @@ static bool cbSystemUiDbg(LSHandle* lshandle, LSMessage *message,
 
 	payload.put("returnValue", true);
 	pbnjson::JGenerator generator;
-	generator.toString(payload, pbnjson::JSchemaFragment("{}"), result);
+	generator.toString(payload, JsonSchemaCache::schema("{}"), result);
 	if (!LSMessageReply(lshandle, message, result.c_str(), &lserror))
 		LSErrorFree(&lserror);
 
@@ -1787,9 +1857,9 @@ static bool cbGetForegroundApplication(LSHandle* lsHandle, LSMessage *message,
 		}
 	}
 
-//	title = SystemUiController::instance()->maximizedApplicationName();
-//	appMenuName = SystemUiController::instance()->maximizedApplicationMenuName();
-//	id = SystemUiController::instance()->maximizedApplicationId();
+	title = SystemService::instance()->foregroundTitle();
+	appMenuName = SystemService::instance()->foregroundMenuName();
+	id = SystemService::instance()->foregroundId();
 
 	if (!title.empty())
 		json_object_object_add(json, (char*) "title",
@@ -1814,6 +1884,108 @@ Done:
 	return true;
 }
 
+/*!
+\page com_palm_systemmanager
+\n
+\section com_palm_systemmanager_set_foreground_application setForegroundApplication
+
+\e Public.
+
+com.palm.systemmanager/setForegroundApplication
+
+Tell the system manager which application is now in front. Called by the compositor on every change; the
+change is posted to getForegroundApplication subscribers, and the application in front is never terminated
+to free memory. Until the first call, no application is terminated to free memory.
+
+Only the compositor (org.webosports.luna) may call this; calls from any other sender fail with "Only the
+compositor may set the foreground application".
+
+\subsection com_palm_systemmanager_set_foreground_application_syntax Syntax:
+\code
+{
+    "id": string,
+    "title": string,
+    "appmenu": string
+}
+\endcode
+
+\param id Id of the application. Leave out when no application is in front.
+\param title Title of the application.
+\param appmenu Title of the application menu.
+
+\subsection com_palm_systemmanager_set_foreground_application_returns Returns:
+\code
+{
+    "returnValue": boolean,
+    "errorText": string
+}
+\endcode
+
+\param returnValue Indicates if the call was succesful.
+\param errorText Describes the error if the call was not succesful.
+
+\subsection com_palm_systemmanager_set_foreground_application_examples Examples:
+\code
+luna-send -n 1 -f luna://com.palm.systemmanager/setForegroundApplication '{ "id": "com.palm.app.browser", "title": "Web" }'
+\endcode
+
+Example response for a succesful call:
+\code
+{
+    "returnValue": true
+}
+\endcode
+
+Example response when called by anything but the compositor, luna-send included:
+\code
+{
+    "returnValue": false,
+    "errorText": "Only the compositor may set the foreground application"
+}
+\endcode
+*/
+static bool cbSetForegroundApplication(LSHandle* lsHandle, LSMessage *message,
+									   void *user_data)
+{
+	// {"id": string, "title": string, "appmenu": string}
+	VALIDATE_SCHEMA_AND_PARSE(lsHandle,
+	                          message,
+	                          SCHEMA_3(OPTIONAL(id, string), OPTIONAL(title, string), OPTIONAL(appmenu, string)),
+	                          request);
+
+	// anyone else could name a different app and have the real one in front terminated under memory pressure
+	const char* sender = LSMessageGetSenderServiceName(message);
+	bool allowed = sender && strcmp(sender, sCompositorServiceName) == 0;
+
+	if (allowed) {
+		std::string id;
+		std::string title;
+		std::string appMenuName;
+		request.getString("id", id);
+		request.getString("title", title);
+		request.getString("appmenu", appMenuName);
+
+		SystemService::instance()->postForegroundApplicationChange(title, appMenuName, id);
+	}
+	else {
+		g_warning("%s: denied to %s", __PRETTY_FUNCTION__, sender ? sender : "a sender without a service name");
+	}
+
+	LSError lsError;
+	LSErrorInit(&lsError);
+	json_object* json = json_object_new_object();
+	json_object_object_add(json, "returnValue", json_object_new_boolean(allowed));
+	if (!allowed)
+		json_object_object_add(json, "errorText",
+							   json_object_new_string("Only the compositor may set the foreground application"));
+	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(json), &lsError))
+		LSErrorFree(&lsError);
+
+	json_object_put(json);
+
+	return true;
+}
+
 /*!
 \page com_palm_systemmanager
 \n
@@ -3725,15 +3897,56 @@ Done:
 }
 
 
-static inline std::string unsafeJsonToStr(const pbnjson::JValue& value)
+// Switches log channels (see LogFilter.h) on a running sysmgr, and lists them:
+//   luna-send -n 1 luna://com.palm.systemmanager/logChannels '{"channel":"ApplicationInstaller","enable":true}'
+//   luna-send -n 1 luna://com.palm.systemmanager/logChannels '{}'
+bool cbLogChannels(LSHandle* lsHandle, LSMessage *message, void *user_data)
 {
-	std::string result;
-	pbnjson::JGenerator generator;
-	if (!generator.toString(value, pbnjson::JSchemaFragment("{}"), result))
-		return "";
-	return result;
+	// {"channel":string, "enable":boolean}
+	VALIDATE_SCHEMA_AND_PARSE(lsHandle,
+	                          message,
+	                          SCHEMA_2(OPTIONAL(channel, string), OPTIONAL(enable, boolean)),
+	                          request);
+
+	std::string channel;
+	bool hasChannel = request.getString("channel", channel);
+	bool hasEnable = request.value("enable").isBoolean();
+	const char* errorText = 0;
+
+	if (hasChannel != hasEnable || (hasChannel && channel.empty()))
+		errorText = "channel and enable must be given together";
+	else if (hasChannel)
+		logSetChannelEnabled(channel.c_str(), request.value("enable").asBool());
+
+	json_object* reply = json_object_new_object();
+	json_object_object_add(reply, "returnValue", json_object_new_boolean(errorText == 0));
+	if (errorText) {
+		json_object_object_add(reply, "errorText", json_object_new_string(errorText));
+	}
+	else {
+		json_object* channels = json_object_new_object();
+		std::map<std::string, bool> states = logChannels();
+		for (std::map<std::string, bool>::const_iterator it = states.begin(); it != states.end(); ++it)
+			json_object_object_add(channels, it->first.c_str(), json_object_new_boolean(it->second));
+		json_object_object_add(reply, "channels", channels);
+	}
+
+	LSError err;
+	LSErrorInit(&err);
+	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &err))
+		LSErrorFree(&err);
+
+	json_object_put(reply);
+	return true;
 }
 
+static const char* const sBenchmarkFlagsSchema =
+	"{\"type\":\"object\",\"additionalProperties\":false,\"properties\":{"
+		"\"animationFps\":{\"type\":\"number\",\"description\":\"The FPS to drive Qt animations at\",\"optional\":true},"
+		"\"vsync\":{\"type\":\"boolean\",\"description\":\"If set to false then disable vsync.  Otherwise drive vsync normally\",\"optional\":true},"
+		"\"cardLoadingAnimation\":{\"type\":\"boolean\",\"description\":\"Turn On/Off the Card Loading Animation\",\"optional\":true}"
+	"}}";
+
 bool cbSetBenchmarkFlags(LSHandle *lsHandle, LSMessage *message, void *user_data)
 {
 	const char* str = LSMessageGetPayload(message);
@@ -3744,33 +3957,9 @@ bool cbSetBenchmarkFlags(LSHandle *lsHandle, LSMessage *message, void *user_data
 	std::string errMsg;
 	bool hasRequest = false;
 
-	pbnjson::JSchemaFragment objSchema = pbnjson::JSchemaFragment("{\"type\": \"object\"}");
-
-	pbnjson::JValue ipcSchemaInfo = pbnjson::Object();
-	ipcSchemaInfo.put("type", "object");
-	ipcSchemaInfo.put("properties", pbnjson::Object());
-	ipcSchemaInfo.put("additionalProperties", false);
-	ipcSchemaInfo["properties"].put("animationFps", pbnjson::Object());
-	ipcSchemaInfo["properties"].put("vsync", pbnjson::Object());
-	ipcSchemaInfo["properties"].put("cardLoadingAnimation", pbnjson::Object());
-	ipcSchemaInfo["properties"]["animationFps"].put("type", "number");
-	ipcSchemaInfo["properties"]["animationFps"].put("description", "The FPS to drive Qt animations at");
-	ipcSchemaInfo["properties"]["animationFps"].put("optional", true);
-	ipcSchemaInfo["properties"]["vsync"].put("type", "boolean");
-	ipcSchemaInfo["properties"]["vsync"].put("description", "If set to false then disable vsync.  Otherwise drive vsync normally");
-	ipcSchemaInfo["properties"]["vsync"].put("optional", true);
-	ipcSchemaInfo["properties"]["cardLoadingAnimation"].put("type", "boolean");
-	ipcSchemaInfo["properties"]["cardLoadingAnimation"].put("description", "Turn On/Off the Card Loading Animation");
-	ipcSchemaInfo["properties"]["cardLoadingAnimation"].put("optional", true);		
-
-
-	std::string ipcSchemaStr = unsafeJsonToStr(ipcSchemaInfo);
-	Q_ASSERT(!ipcSchemaStr.empty());
-	pbnjson::JSchemaFragment ipcSchema(ipcSchemaStr);
-
 	pbnjson::JValue request;
 	pbnjson::JDomParser parser;
-	if (!parser.parse(str, ipcSchema)) {
+	if (!parser.parse(str, JsonSchemaCache::schema(sBenchmarkFlagsSchema))) {
 		errCode = -1;
 		errMsg = "Malformed message";
 		goto Done;
@@ -3831,7 +4020,7 @@ bool cbSetBenchmarkFlags(LSHandle *lsHandle, LSMessage *message, void *user_data
 
 	if (!hasRequest) {
 		errCode = -1;
-		errMsg = "No request. Must match schema: " + ipcSchemaStr;
+		errMsg = std::string("No request. Must match schema: ") + sBenchmarkFlagsSchema;
 	}
 
 Done:
@@ -3844,7 +4033,7 @@ Done:
 	}
 
 	pbnjson::JGenerator generator;
-	if (!generator.toString(replyObj, objSchema, reply))
+	if (!generator.toString(replyObj, JsonSchemaCache::schema("{\"type\": \"object\"}"), reply))
 		return false;
 
 	LSError error;
@@ -3992,7 +4181,7 @@ bool cbGetSystemStatus(LSHandle *lsHandle, LSMessage *message, void *user_data)
 
     std::string replyStr;
     pbnjson::JGenerator generator;
-    generator.toString(replyObj, pbnjson::JSchemaFragment("{}"), replyStr);
+    generator.toString(replyObj, JsonSchemaCache::schema("{}"), replyStr);
 
     if (!LSMessageReply(lsHandle, message, replyStr.c_str(), &error)) {
         LSErrorFree(&error);
@@ -4012,7 +4201,7 @@ void SystemService::postSystemStatus()
 
     std::string replyStr;
     pbnjson::JGenerator generator;
-    generator.toString(replyObj, pbnjson::JSchemaFragment("{}"), replyStr);
+    generator.toString(replyObj, JsonSchemaCache::schema("{}"), replyStr);
     if (!LSSubscriptionPost(m_service, "/", "getSystemStatus", replyStr.c_str(), &lsError))
         LSErrorFree (&lsError);
 }
@@ -5377,6 +5566,109 @@ static bool cbSubscribeTurboMode(LSHandle* lshandle, LSMessage *message, void *u
 	return true;
 }
 
+/*!
+\page com_palm_systemmanager
+\n
+\section com_palm_systemmanager_get_reclaimed_applications getReclaimedApplications
+
+\e Public.
+
+com.palm.systemmanager/getReclaimedApplications
+
+Get the applications most recently terminated to free memory, newest last. Subscribers are sent each
+application as it is terminated.
+
+\subsection com_palm_systemmanager_get_reclaimed_applications_syntax Syntax:
+\code
+{
+    "subscribe": boolean
+}
+\endcode
+
+\param subscribe Set to true to receive events when applications are terminated for memory.
+
+\subsection com_palm_systemmanager_get_reclaimed_applications_returns Returns:
+\code
+{
+    "reclaimed": [
+        {
+            "appId": string,
+            "pid": int,
+            "memoryMb": int,
+            "pressure": string,
+            "time": int
+        }
+    ],
+    "returnValue": boolean,
+    "subscribed": boolean
+}
+\endcode
+
+\param reclaimed The terminated applications. Events carry just the one application.
+\param appId Id of the application.
+\param pid Process id it had.
+\param memoryMb Memory it was using, proportional set size where the kernel reports it, swap included.
+\param pressure Memory pressure it was terminated at: "Medium", "Low" or "Critical".
+\param time When it was terminated, in seconds since the epoch.
+\param returnValue Indicates if the call was succesful.
+\param subscribed True if subscribed to events.
+
+\subsection com_palm_systemmanager_get_reclaimed_applications_examples Examples:
+\code
+luna-send -i -f luna://com.palm.systemmanager/getReclaimedApplications '{ "subscribe": true }'
+\endcode
+
+Example response for a succesful call:
+\code
+{
+    "reclaimed": [
+        {
+            "appId": "com.palm.app.maps",
+            "pid": 1873,
+            "memoryMb": 58,
+            "pressure": "Low",
+            "time": 1370000000
+        }
+    ],
+    "returnValue": true,
+    "subscribed": true
+}
+\endcode
+*/
+static bool cbGetReclaimedApplications(LSHandle* lshandle, LSMessage *message, void *user_data)
+{
+    SUBSCRIBE_SCHEMA_RETURN(lshandle, message);
+
+	bool success = true;
+	bool subscribed = false;
+	LSError lsError;
+	json_object* response = json_object_new_object();
+
+	LSErrorInit(&lsError);
+
+	if (LSMessageIsSubscription(message)) {
+		success = LSSubscriptionProcess(lshandle, message, &subscribed, &lsError);
+		if (!success)
+			LSErrorFree(&lsError);
+	}
+
+	json_object* reclaimed = json_object_new_array();
+	const std::list<MemoryMonitor::Reclaim>& reclaims = MemoryMonitor::instance()->recentReclaims();
+	for (std::list<MemoryMonitor::Reclaim>::const_iterator it = reclaims.begin(); it != reclaims.end(); ++it)
+		json_object_array_add(reclaimed, reclaimToJson(*it));
+
+	json_object_object_add(response, "reclaimed", reclaimed);
+	json_object_object_add(response, "returnValue", json_object_new_boolean(success));
+	json_object_object_add(response, "subscribed", json_object_new_boolean(subscribed));
+
+	if (!LSMessageReply(lshandle, message, json_object_to_json_string(response), &lsError))
+		LSErrorFree(&lsError);
+
+	json_object_put(response);
+
+	return true;
+}
+
 static bool cbSubscriptionCancel(LSHandle *lshandle, LSMessage *message, void *user_data)
 {
 	if (sTurboModeSubscriptions.erase(message) == 1) {
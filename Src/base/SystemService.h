@@ -73,6 +73,9 @@ public:
 	LSHandle* serviceHandle() const { return m_service; }
 
 	void postForegroundApplicationChange(const std::string& name,const std::string& menuname, const std::string& id);
+	const std::string& foregroundTitle() const { return m_foregroundTitle; }
+	const std::string& foregroundMenuName() const { return m_foregroundMenuName; }
+	const std::string& foregroundId() const { return m_foregroundId; }
 	void postApplicationHasBeenTerminated(const std::string& title, const std::string& menuname, const std::string& id);
 	
 	void postLockStatus(bool locked);
@@ -111,6 +114,7 @@ private Q_SLOTS:
 	void slotModalWindowAdded();
 	void slotModalWindowRemoved();
 	void slotModalDialogTimerFired();
+	void postApplicationReclaimed(const QString& appId, qint64 pid, int memoryMb, const QString& pressure);
 
 Q_SIGNALS:
 
@@ -163,6 +167,9 @@ private:
 	bool m_msmExitClean;
 	bool m_fscking;
 	bool m_cardLoadingAnimation;
+	std::string m_foregroundTitle;			// as the compositor last reported it; see setForegroundApplication
+	std::string m_foregroundMenuName;
+	std::string m_foregroundId;
 	static ActiveModalDialogInfo sActiveModalInfo;
 	static std::string sTempCaller;
 	static std::string sTempLaunchApp;
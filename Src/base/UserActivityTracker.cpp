@@ -0,0 +1,38 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+#include "UserActivityTracker.h"
+
+UserActivityTracker::UserActivityTracker()
+    : m_pendingEvents(0)
+    , m_lastActivityMs(0)
+    , m_events(0)
+    , m_batches(0)
+{
+}
+
+void UserActivityTracker::endBatch(uint32_t nowMs)
+{
+    if (m_pendingEvents == 0)
+        return;
+
+    m_lastActivityMs = nowMs;
+    m_events += m_pendingEvents;
+    m_batches++;
+    m_pendingEvents = 0;
+}
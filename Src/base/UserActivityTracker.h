@@ -0,0 +1,77 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+#ifndef USERACTIVITYTRACKER_H
+#define USERACTIVITYTRACKER_H
+
+#include <stdint.h>
+
+/*
+ * Folds the input events read on one wakeup of the main loop into a single record of user activity.
+ *
+ * A finger on the touchpanel sends a report every frame, and nearly all of them only say again that the
+ * user is there. Events are counted as they are read; when the batch ends the time is taken and stored
+ * once, and the display hears about it once. touchEdge() tells DisplayManager::handleTouchEvent() whether
+ * that is one of the edges it has to act on.
+ */
+class UserActivityTracker
+{
+public:
+    UserActivityTracker();
+
+    enum TouchEdge {
+        TouchEdgeNone,              // on with the activity timer running, the usual case
+        TouchEdgeWake,              // dimmed: back on through the state machine
+        TouchEdgeStartActivity      // on (or on the puck) without the activity timer
+    };
+
+    static TouchEdge touchEdge(bool dimmed, bool on, bool activityRunning)
+    {
+        if (dimmed)
+            return TouchEdgeWake;
+        if (on && !activityRunning)
+            return TouchEdgeStartActivity;
+        return TouchEdgeNone;
+    }
+
+    void addEvent(int touches)
+    {
+        if (touches > 0)
+            m_pendingEvents++;
+    }
+
+    // events with touches since the last endBatch()
+    unsigned int pendingEvents() const { return m_pendingEvents; }
+
+    // closes the batch; if it had touches, lastActivityMs() becomes nowMs
+    void endBatch(uint32_t nowMs);
+
+    uint32_t lastActivityMs() const { return m_lastActivityMs; }
+
+    // events with touches, and the batches that had any, so far
+    uint64_t events() const { return m_events; }
+    uint64_t batches() const { return m_batches; }
+
+private:
+    unsigned int m_pendingEvents;
+    uint32_t m_lastActivityMs;
+    uint64_t m_events;
+    uint64_t m_batches;
+};
+
+#endif // USERACTIVITYTRACKER_H
@@ -0,0 +1,147 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef VALIDATEDJSONMESSAGE_H
+#define VALIDATEDJSONMESSAGE_H
+
+#include "Common.h"
+
+#include <string>
+#include <map>
+#include <stdint.h>
+
+#include "JSONUtils.h"
+#include "Settings.h"
+
+/*
+ * A service call payload, parsed once and kept as a DOM for the handler to read from.
+ *
+ * Handlers that check the payload with VALIDATE_SCHEMA_AND_RETURN and then json_tokener_parse() it
+ * parse every message twice (three times when it fails validation). With VALIDATE_SCHEMA_AND_PARSE
+ * the validating parse is the one the handler reads from. When schema validation is switched off
+ * (schemaValidationOption=0), nothing is parsed until the handler first asks for a value.
+ *
+ * Values read the way cjson's json_object_get_string() gave them, so ported handlers keep behaving the
+ * same: strings as they are, anything else as its json text, null the same as missing.
+ */
+class ValidatedJsonMessage
+{
+public:
+
+	ValidatedJsonMessage(LSMessage* message, const char* schema);
+	ValidatedJsonMessage(const char* payload, const char* schema);
+
+	// false if the handler should return right away (the error has been replied when lssender is given)
+	bool parse(const char* callerFunction, LSHandle* lssender, ESchemaErrorOptions validationOption);
+
+	const char* payload() const { return m_payload; }
+
+	// false if there is no payload or it isn't json
+	bool isValid() const;
+	const pbnjson::JValue& root() const;
+
+	bool has(const std::string& key) const;
+	pbnjson::JValue value(const std::string& key) const;
+	bool getString(const std::string& key, std::string& r_value) const;
+	// false unless the value is a number that fits
+	bool getInteger(const std::string& key, int64_t& r_value) const;
+
+	static std::string toString(const pbnjson::JValue& value);
+
+private:
+
+	void parseDom(const pbnjson::JSchema& schema) const;
+
+	LSMessage* m_message;
+	const char* m_payload;
+	const char* m_schemaText;
+	const char* m_callerFunction;
+
+	mutable pbnjson::JDomParser m_parser;
+	mutable pbnjson::JValue m_root;
+	mutable bool m_parsed;
+	mutable bool m_valid;
+};
+
+// what was spent parsing service call payloads, per handler
+class JsonParseStats
+{
+public:
+
+	struct Counter {
+		Counter() : calls(0), parses(0), failures(0), totalUs(0), maxUs(0) {}
+
+		unsigned int calls;
+		unsigned int parses;		// full parses of the payload
+		unsigned int failures;
+		uint64_t totalUs;
+		uint64_t maxUs;
+	};
+
+	typedef std::map<std::string, Counter> CounterMap;
+
+	static void record(const char* method, unsigned int calls, unsigned int parses, bool failed, uint64_t us);
+	static CounterMap counters();
+	static void reset();
+
+	static uint64_t nowUs();
+};
+
+/*
+ * Schemas compiled once for the life of the process, shared by every handler (and thread).
+ *
+ * Schema texts are almost all literals, so an entry is looked up by the address of the text, and the text
+ * is compared before it is used: an address can be reused for other text (a std::string's c_str()). Texts
+ * seen at another address share the one compiled schema. Nothing is ever evicted; there are as many entries
+ * as there are distinct schemas in the code.
+ */
+class JsonSchemaCache
+{
+public:
+
+	struct Counters {
+		Counters() : hits(0), misses(0), schemas(0) {}
+
+		unsigned int hits;
+		unsigned int misses;		// lookups that had to compile the schema
+		unsigned int schemas;
+	};
+
+	static const pbnjson::JSchema& schema(const char* text);
+	static Counters counters();
+};
+
+#define VALIDATE_SCHEMA_AND_PARSE(lsHandle, message, schema, r_parsed) \
+	ValidatedJsonMessage r_parsed(message, schema); \
+	if (!r_parsed.parse(__FUNCTION__, lsHandle, static_cast<ESchemaErrorOptions>(Settings::LunaSettings()->schemaValidationOption))) \
+		return true;
+
+// the one from JSONUtils.h compiles the schema for every message; this validates the same way against the
+// cached one, for every file that includes this header
+#undef VALIDATE_SCHEMA_AND_RETURN
+#define VALIDATE_SCHEMA_AND_RETURN(lsHandle, message, schema) \
+	{ \
+		ValidatedJsonMessage validatedMessage(message, schema); \
+		if (!validatedMessage.parse(__FUNCTION__, lsHandle, static_cast<ESchemaErrorOptions>(Settings::LunaSettings()->schemaValidationOption))) \
+			return true; \
+	}
+
+#endif /* VALIDATEDJSONMESSAGE_H */
@@ -0,0 +1,403 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "ApplicationChangeJournal.h"
+#include "Preferences.h"
+
+#include <sys/inotify.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const uint32_t s_watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+									IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+// all a parent of a missing root has to tell is that something was created in it, or that it went away
+static const uint32_t s_parentMask = IN_CREATE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+ApplicationChangeJournal::ApplicationChangeJournal()
+	: m_fd(-1)
+	, m_channel(0)
+	, m_source(0)
+	, m_lostTrack(false)
+{
+}
+
+ApplicationChangeJournal::~ApplicationChangeJournal()
+{
+	if (m_source) {
+		g_source_destroy(m_source);
+		g_source_unref(m_source);
+	}
+
+	if (m_channel)
+		g_io_channel_unref(m_channel);
+
+	if (m_fd >= 0)
+		::close(m_fd);
+}
+
+bool ApplicationChangeJournal::start(GMainContext* context)
+{
+	if (m_fd >= 0)
+		return true;
+
+	m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_fd < 0) {
+		g_warning("%s: inotify_init1 failed: %s", __FUNCTION__, strerror(errno));
+		return false;
+	}
+
+	m_channel = g_io_channel_unix_new(m_fd);
+	m_source = g_io_create_watch(m_channel, (GIOCondition) (G_IO_IN | G_IO_ERR | G_IO_HUP));
+	g_source_set_callback(m_source, (GSourceFunc) inotifyCallback, this, NULL);
+	g_source_attach(m_source, context);
+
+	return true;
+}
+
+std::string ApplicationChangeJournal::normalizePath(const std::string& path)
+{
+	std::string result;
+	result.reserve(path.size());
+
+	for (std::string::size_type i = 0; i < path.size(); i++) {
+		if (path[i] == '/' && !result.empty() && result[result.size() - 1] == '/')
+			continue;
+		result += path[i];
+	}
+
+	if (result.size() > 1 && result[result.size() - 1] == '/')
+		result.erase(result.size() - 1);
+
+	return result;
+}
+
+void ApplicationChangeJournal::addRoot(FolderKind kind, const std::string& rootFolder)
+{
+	std::string root = normalizePath(rootFolder);
+	if (root.empty())
+		return;
+
+	for (unsigned int i = 0; i < m_roots.size(); i++) {
+		if (m_roots[i].first == kind && m_roots[i].second == root)
+			return;
+	}
+
+	m_roots.push_back(std::make_pair(kind, root));
+	watchRoot(kind, root, false);
+}
+
+void ApplicationChangeJournal::watchRoot(FolderKind kind, const std::string& root, bool created)
+{
+	if (m_fd < 0)
+		return;
+
+	Watch watch;
+	watch.kind = kind;
+	watch.root = root;
+	if (!addWatch(root, watch)) {
+		struct stat stBuf;
+		if (::stat(root.c_str(), &stBuf) != 0 && errno == ENOENT)
+			watchParentOf(root);
+		return;
+	}
+
+	struct dirent** list = NULL;
+	int count = ::scandir(root.c_str(), &list, 0, 0);
+	if (count < 0)
+		return;
+
+	for (int i = 0; i < count; i++) {
+		if (list[i]) {
+			if (list[i]->d_name[0] != '.') {
+				std::string folder = root + "/" + list[i]->d_name;
+
+				struct stat stBuf;
+				if (::stat(folder.c_str(), &stBuf) == 0 && S_ISDIR(stBuf.st_mode)) {
+					// a root that only just appeared was never scanned: whatever is in it is new
+					if (created)
+						m_dirty[kind].insert(folder);
+					watchFolder(kind, root, folder);
+				}
+			}
+			free(list[i]);
+		}
+	}
+
+	if (list)
+		free(list);
+}
+
+void ApplicationChangeJournal::watchParentOf(const std::string& path)
+{
+	std::string parent = path;
+	while (parent != "/") {
+		std::string::size_type slash = parent.rfind('/');
+		if (slash == std::string::npos)
+			return;
+		parent = slash ? parent.substr(0, slash) : std::string("/");
+
+		int wd = ::inotify_add_watch(m_fd, parent.c_str(), s_parentMask);
+		if (wd >= 0) {
+			m_parentWatches.insert(wd);
+			return;
+		}
+
+		if (errno != ENOENT) {
+			g_warning("%s: can't watch %s for %s: %s", __FUNCTION__, parent.c_str(), path.c_str(), strerror(errno));
+			m_lostTrack = true;
+			return;
+		}
+	}
+}
+
+bool ApplicationChangeJournal::rootWatched(const std::string& root) const
+{
+	for (std::map<int, Watch>::const_iterator it = m_watches.begin(); it != m_watches.end(); ++it) {
+		if (it->second.folder.empty() && it->second.root == root)
+			return true;
+	}
+	return false;
+}
+
+void ApplicationChangeJournal::watchMissingRoots()
+{
+	bool missing = false;
+	for (unsigned int i = 0; i < m_roots.size(); i++) {
+		if (rootWatched(m_roots[i].second))
+			continue;
+
+		// either it is there now, or this moves the parent watch one level closer to it
+		watchRoot(m_roots[i].first, m_roots[i].second, true);
+		if (!rootWatched(m_roots[i].second))
+			missing = true;
+	}
+
+	if (missing)
+		return;
+
+	for (std::set<int>::const_iterator it = m_parentWatches.begin(); it != m_parentWatches.end(); ++it) {
+		if (m_watches.find(*it) == m_watches.end())
+			::inotify_rm_watch(m_fd, *it);
+	}
+	m_parentWatches.clear();
+}
+
+void ApplicationChangeJournal::watchFolder(FolderKind kind, const std::string& root, const std::string& folder)
+{
+	Watch watch;
+	watch.kind = kind;
+	watch.root = root;
+	watch.folder = folder;
+
+	if (!addWatch(folder, watch))
+		return;
+
+	// the localized descriptor locations, same search order as ApplicationManager::scanOneApplicationFolder()
+	std::string locale = LocalePreferences::instance()->locale();
+	std::string language, region;
+	std::size_t underscorePos = locale.find("_");
+	if (underscorePos != std::string::npos) {
+		language = locale.substr(0, underscorePos);
+		region = locale.substr(underscorePos+1);
+	}
+
+	std::string resources = folder + "/resources";
+	if (!addWatch(resources, watch))
+		return;
+
+	if (!language.empty()) {
+		addWatch(resources + "/" + language, watch);
+		if (!region.empty())
+			addWatch(resources + "/" + language + "/" + region, watch);
+	}
+	if (!locale.empty())
+		addWatch(resources + "/" + locale, watch);
+}
+
+bool ApplicationChangeJournal::addWatch(const std::string& path, const Watch& watch)
+{
+	int wd = ::inotify_add_watch(m_fd, path.c_str(), s_watchMask);
+	if (wd < 0) {
+		if (errno != ENOENT && errno != ENOTDIR) {
+			// most likely out of watches (max_user_watches); we can't vouch for anything anymore
+			g_warning("%s: can't watch %s: %s", __FUNCTION__, path.c_str(), strerror(errno));
+			m_lostTrack = true;
+		}
+		return false;
+	}
+
+	m_watches[wd] = watch;
+	return true;
+}
+
+void ApplicationChangeJournal::unwatchFolder(const std::string& folder)
+{
+	std::map<int, Watch>::iterator it = m_watches.begin();
+	while (it != m_watches.end()) {
+		if (it->second.folder == folder) {
+			::inotify_rm_watch(m_fd, it->first);
+			m_watches.erase(it++);
+		}
+		else
+			++it;
+	}
+}
+
+void ApplicationChangeJournal::readEvents()
+{
+	if (m_fd < 0)
+		return;
+
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool rootsAppeared = false;
+
+	while (true) {
+
+		ssize_t len = ::read(m_fd, buf, sizeof(buf));
+		if (len <= 0) {
+			if (len < 0 && errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (char* ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event*) ptr)->len) {
+
+			const struct inotify_event* event = (const struct inotify_event*) ptr;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				g_warning("%s: inotify queue overflowed", __FUNCTION__);
+				m_lostTrack = true;
+				continue;
+			}
+
+			// something was created next to (or on the way to) a missing root, or the parent went away
+			if (m_parentWatches.find(event->wd) != m_parentWatches.end()) {
+				if (event->mask & IN_IGNORED)
+					m_parentWatches.erase(event->wd);
+				if (event->mask & (IN_ISDIR | IN_IGNORED))
+					rootsAppeared = true;
+			}
+
+			std::map<int, Watch>::iterator it = m_watches.find(event->wd);
+			if (it == m_watches.end())
+				continue;
+
+			if (event->mask & IN_IGNORED) {
+				m_watches.erase(it);
+				continue;
+			}
+
+			Watch watch = it->second;
+
+			if (watch.folder.empty()) {
+
+				// the root itself went away or moved; nothing below it can be trusted
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+					m_lostTrack = true;
+					continue;
+				}
+
+				if (!event->len || event->name[0] == '.')
+					continue;
+
+				std::string folder = watch.root + "/" + event->name;
+				m_dirty[watch.kind].insert(folder);
+
+				if (event->mask & IN_ISDIR) {
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+						watchFolder(watch.kind, watch.root, folder);
+					else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+						unwatchFolder(folder);
+				}
+			}
+			else {
+				m_dirty[watch.kind].insert(watch.folder);
+
+				// a resources/ or locale folder may have just been created: pick it up
+				if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+					watchFolder(watch.kind, watch.root, watch.folder);
+			}
+		}
+	}
+
+	if (rootsAppeared)
+		watchMissingRoots();
+}
+
+gboolean ApplicationChangeJournal::inotifyCallback(GIOChannel* /*channel*/, GIOCondition condition, gpointer data)
+{
+	ApplicationChangeJournal* journal = static_cast<ApplicationChangeJournal*>(data);
+
+	if (condition & (G_IO_ERR | G_IO_HUP)) {
+		journal->m_lostTrack = true;
+		return TRUE;
+	}
+
+	journal->readEvents();
+	return TRUE;
+}
+
+bool ApplicationChangeJournal::takeChanges(FolderKind kind, std::set<std::string>& r_folders)
+{
+	r_folders.clear();
+
+	if (m_fd < 0)
+		return false;
+
+	// whatever the kernel has queued up to now; the main loop may not have gotten to it yet
+	readEvents();
+
+	if (m_lostTrack)
+		return false;
+
+	r_folders.swap(m_dirty[kind]);
+	return true;
+}
+
+void ApplicationChangeJournal::markClean(FolderKind kind, const std::string& folder)
+{
+	readEvents();
+	m_dirty[kind].erase(normalizePath(folder));
+}
+
+void ApplicationChangeJournal::resync()
+{
+	if (m_fd < 0)
+		return;
+
+	readEvents();
+
+	for (int kind = 0; kind < Kind_Count; kind++)
+		m_dirty[kind].clear();
+	m_lostTrack = false;
+
+	// re-adding a path that is already watched just hands back its existing descriptor
+	for (unsigned int i = 0; i < m_roots.size(); i++)
+		watchRoot(m_roots[i].first, m_roots[i].second, false);
+}
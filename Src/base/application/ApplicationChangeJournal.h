@@ -0,0 +1,112 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef APPLICATIONCHANGEJOURNAL_H
+#define APPLICATIONCHANGEJOURNAL_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <glib.h>
+
+/*
+ * inotify backed record of which application, package and service folders changed on disk.
+ *
+ * Each root folder (e.g. one of Settings::lunaAppsPaths) is watched along with every folder directly
+ * under it and the localized resources/ folders an appinfo.json/packageinfo.json can live in. Events are
+ * picked up from the main loop as they arrive, and takeChanges() drains whatever the kernel has queued
+ * before handing out the touched folders, so a change made before a rescan request is never missed.
+ *
+ * A root folder that doesn't exist yet (nothing installed into a fresh apps folder) is waited for through a
+ * watch on its nearest existing parent; once it shows up, everything under it counts as changed.
+ *
+ * If the journal loses track (queue overflow, out of watches, a root folder moving) takeChanges() says so,
+ * and the caller has to fall back to a full scan and then call resync().
+ */
+class ApplicationChangeJournal
+{
+public:
+
+	enum FolderKind {
+		Kind_Application = 0,
+		Kind_Package,
+		Kind_Service,
+		Kind_Count
+	};
+
+	ApplicationChangeJournal();
+	~ApplicationChangeJournal();
+
+	// opens the inotify instance and attaches it to the main loop context; false if inotify isn't usable
+	bool start(GMainContext* context);
+
+	void addRoot(FolderKind kind, const std::string& rootFolder);
+
+	// hands out (and forgets) the folders of this kind touched since the last call, or since resync().
+	// returns false if changes may have been lost; r_folders is then empty and a full scan is needed
+	bool takeChanges(FolderKind kind, std::set<std::string>& r_folders);
+
+	// a folder was just rescanned by other means (e.g. forceSingleAppScan); drop it from the pending set
+	void markClean(FolderKind kind, const std::string& folder);
+
+	// re-arm every watch and clear all pending changes, after the caller did a full scan
+	void resync();
+
+	// "/a//b/c/" -> "/a/b/c", so paths built in different places compare equal
+	static std::string normalizePath(const std::string& path);
+
+private:
+
+	struct Watch {
+		FolderKind kind;
+		std::string root;		// the root folder this watch lives under
+		std::string folder;		// the app/package/service folder, empty for the root watch itself
+	};
+
+	void watchRoot(FolderKind kind, const std::string& root, bool created);
+	void watchParentOf(const std::string& path);
+	void watchMissingRoots();
+	bool rootWatched(const std::string& root) const;
+	void watchFolder(FolderKind kind, const std::string& root, const std::string& folder);
+	bool addWatch(const std::string& path, const Watch& watch);
+	void unwatchFolder(const std::string& folder);
+
+	void readEvents();
+	static gboolean inotifyCallback(GIOChannel* channel, GIOCondition condition, gpointer data);
+
+	int m_fd;
+	GIOChannel* m_channel;
+	GSource* m_source;
+	bool m_lostTrack;
+
+	std::vector<std::pair<FolderKind, std::string> > m_roots;
+	std::map<int, Watch> m_watches;				// inotify watch descriptor -> what it covers
+	std::set<int> m_parentWatches;				// ... and those on parents of roots still missing
+	std::set<std::string> m_dirty[Kind_Count];
+
+	ApplicationChangeJournal(const ApplicationChangeJournal&);
+	ApplicationChangeJournal& operator=(const ApplicationChangeJournal&);
+};
+
+#endif /* APPLICATIONCHANGEJOURNAL_H */
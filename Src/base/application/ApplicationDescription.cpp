@@ -80,10 +80,45 @@ ApplicationDescription::~ApplicationDescription()
 }
 
 ApplicationDescription* ApplicationDescription::fromFile(const std::string& filePath, const std::string& folderPath)
+{
+	char* jsonStr = 0;
+	struct json_object* root=0;
+	ApplicationDescription* appDesc = 0;
+
+	jsonStr = readFile(filePath.c_str());
+	if (!jsonStr || !g_utf8_validate(jsonStr, -1, NULL))
+	{
+		delete [] jsonStr;
+		return 0;
+	}
+
+	root = json_tokener_parse( jsonStr );
+	if( !root || is_error( root ) )
+	{
+		g_warning("%s: Failed to parse '%s' into a JSON string", __FUNCTION__, filePath.c_str() );
+		delete [] jsonStr;
+		return 0;
+	}
+
+	appDesc = fromAppInfoJson(root, filePath, folderPath);
+
+	json_object_put(root);
+	delete [] jsonStr;
+
+	return appDesc;
+}
+
+/*
+ * Builds the descriptor from an already parsed appinfo.json object. The caller keeps ownership of root.
+ * filePath is the appinfo.json the object came from; it is used to resolve relative icon/entry point paths.
+ *
+ * Like fromFile(), this registers the app's mime types and redirects with the MimeSystem, and creates the
+ * launcher for sysmgr builtins, so it must be called from the main thread.
+ */
+ApplicationDescription* ApplicationDescription::fromAppInfoJson(struct json_object* root, const std::string& filePath, const std::string& folderPath)
 {
 	bool success = false;
 	ApplicationDescription* appDesc = 0;
-	char* jsonStr = 0;
 	const gchar* palmAppDirPrefix = "/usr/palm/applications/";
 	std::vector<MimeRegInfo> extractedMimeTypes;
 	std::string launchParams;
@@ -91,13 +126,6 @@ ApplicationDescription* ApplicationDescription::fromFile(const std::string& file
 	std::string builtinEntrypt;
 	std::string builtinArgs;
 
-	jsonStr = readFile(filePath.c_str());
-	if (!jsonStr || !g_utf8_validate(jsonStr, -1, NULL))
-	{
-		return 0;
-	}
-
-	struct json_object* root=0;
 	struct json_object* label=0;
 
 	std::string title, icon, dirPath;
@@ -108,11 +136,10 @@ ApplicationDescription* ApplicationDescription::fromFile(const std::string& file
 	dirPath += "/";
 	g_free(dirPathCStr);
 	
-	root = json_tokener_parse( jsonStr );
-	if( !root || is_error( root ) )
+	if( !root || is_error( root ) || !json_object_is_type(root, json_type_object) )
 	{
-		g_warning("%s: Failed to parse '%s' into a JSON string", __FUNCTION__, filePath.c_str() );
-		goto Done;
+		g_warning("%s: '%s' is not a JSON object", __FUNCTION__, filePath.c_str() );
+		return 0;
 	}
 	
 	appDesc = new ApplicationDescription();
@@ -506,10 +533,6 @@ ApplicationDescription* ApplicationDescription::fromFile(const std::string& file
 	}
 Done:
 
-	if( root && !is_error(root) )json_object_put(root);
-
-	delete [] jsonStr;
-
 	if (!success) {
 		delete appDesc;
 		return 0;
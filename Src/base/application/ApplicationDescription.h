@@ -86,6 +86,7 @@ public:
 	~ApplicationDescription();
 
 	static ApplicationDescription* fromFile(const std::string& filePath, const std::string& folderPath);
+	static ApplicationDescription* fromAppInfoJson(struct json_object* root, const std::string& filePath, const std::string& folderPath);
     static ApplicationDescription* fromJsonString(const char* jsonStr);
 	static ApplicationDescription* fromApplicationStatus(const ApplicationStatus& appStatus, bool isUpdating);
 	static ApplicationDescription* fromNativeDockApp(const std::string& id, const std::string& title, 
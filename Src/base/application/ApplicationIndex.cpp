@@ -0,0 +1,190 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "ApplicationIndex.h"
+#include "ApplicationDescription.h"
+#include "PackageDescription.h"
+#include "LaunchPoint.h"
+#include "LaunchPointSearchIndex.h"
+
+ApplicationIndex::ApplicationIndex()
+	: m_search(0)
+{
+	m_apps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	m_launchPoints = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	m_packagesByAppId = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	m_packagesByServiceId = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+ApplicationIndex::~ApplicationIndex()
+{
+	g_hash_table_destroy(m_apps);
+	g_hash_table_destroy(m_launchPoints);
+	g_hash_table_destroy(m_packagesByAppId);
+	g_hash_table_destroy(m_packagesByServiceId);
+	delete m_search;
+}
+
+void ApplicationIndex::insertKey(GHashTable* table, const std::string& key, gpointer value)
+{
+	if (!value || g_hash_table_lookup(table, key.c_str()))
+		return;		//first one in wins (same as the old list-order scan)
+
+	g_hash_table_insert(table, g_strdup(key.c_str()), value);
+}
+
+void ApplicationIndex::removeKey(GHashTable* table, const std::string& key, gconstpointer value)
+{
+	//only drop it if the key still refers to this object; a stale removal must not evict someone else
+	if (g_hash_table_lookup(table, key.c_str()) == value)
+		g_hash_table_remove(table, key.c_str());
+}
+
+void ApplicationIndex::insertApp(ApplicationDescription* appDesc)
+{
+	if (!appDesc)
+		return;
+
+	insertKey(m_apps, appDesc->id(), appDesc);
+
+	const LaunchPointList& lps = appDesc->launchPoints();
+	for (LaunchPointList::const_iterator it = lps.begin(); it != lps.end(); ++it)
+		insertLaunchPoint(*it);
+}
+
+void ApplicationIndex::removeApp(const ApplicationDescription* appDesc)
+{
+	if (!appDesc)
+		return;
+
+	const LaunchPointList& lps = appDesc->launchPoints();
+	for (LaunchPointList::const_iterator it = lps.begin(); it != lps.end(); ++it)
+		removeLaunchPoint(*it);
+
+	removeKey(m_apps, appDesc->id(), appDesc);
+}
+
+void ApplicationIndex::insertLaunchPoint(const LaunchPoint* lp)
+{
+	if (!lp)
+		return;
+	insertKey(m_launchPoints, lp->launchPointId(), const_cast<LaunchPoint*>(lp));
+	if (m_search)
+		m_search->insert(lp);
+}
+
+void ApplicationIndex::removeLaunchPoint(const LaunchPoint* lp)
+{
+	if (!lp)
+		return;
+	removeKey(m_launchPoints, lp->launchPointId(), lp);
+	if (m_search)
+		m_search->remove(lp);
+}
+
+void ApplicationIndex::refreshApp(const ApplicationDescription* appDesc)
+{
+	if (!appDesc || !m_search)
+		return;
+
+	const LaunchPointList& lps = appDesc->launchPoints();
+	for (LaunchPointList::const_iterator it = lps.begin(); it != lps.end(); ++it)
+		m_search->insert(*it);
+}
+
+void ApplicationIndex::insertPackage(PackageDescription* packageDesc)
+{
+	if (!packageDesc)
+		return;
+
+	std::vector<std::string>::const_iterator it, itEnd;
+	for (it = packageDesc->appIds().begin(), itEnd = packageDesc->appIds().end(); it != itEnd; ++it)
+		insertKey(m_packagesByAppId, *it, packageDesc);
+
+	for (it = packageDesc->serviceIds().begin(), itEnd = packageDesc->serviceIds().end(); it != itEnd; ++it)
+		insertKey(m_packagesByServiceId, *it, packageDesc);
+}
+
+void ApplicationIndex::removePackage(const PackageDescription* packageDesc)
+{
+	if (!packageDesc)
+		return;
+
+	std::vector<std::string>::const_iterator it, itEnd;
+	for (it = packageDesc->appIds().begin(), itEnd = packageDesc->appIds().end(); it != itEnd; ++it)
+		removeKey(m_packagesByAppId, *it, packageDesc);
+
+	for (it = packageDesc->serviceIds().begin(), itEnd = packageDesc->serviceIds().end(); it != itEnd; ++it)
+		removeKey(m_packagesByServiceId, *it, packageDesc);
+}
+
+ApplicationDescription* ApplicationIndex::appById(const std::string& appId) const
+{
+	return static_cast<ApplicationDescription*>(g_hash_table_lookup(m_apps, appId.c_str()));
+}
+
+const LaunchPoint* ApplicationIndex::launchPointById(const std::string& launchPointId) const
+{
+	return static_cast<const LaunchPoint*>(g_hash_table_lookup(m_launchPoints, launchPointId.c_str()));
+}
+
+PackageDescription* ApplicationIndex::packageByAppId(const std::string& appId) const
+{
+	return static_cast<PackageDescription*>(g_hash_table_lookup(m_packagesByAppId, appId.c_str()));
+}
+
+PackageDescription* ApplicationIndex::packageByServiceId(const std::string& serviceId) const
+{
+	return static_cast<PackageDescription*>(g_hash_table_lookup(m_packagesByServiceId, serviceId.c_str()));
+}
+
+bool ApplicationIndex::containsApp(const ApplicationDescription* appDesc) const
+{
+	return appDesc && (appById(appDesc->id()) == appDesc);
+}
+
+unsigned int ApplicationIndex::appCount() const
+{
+	return g_hash_table_size(m_apps);
+}
+
+unsigned int ApplicationIndex::launchPointCount() const
+{
+	return g_hash_table_size(m_launchPoints);
+}
+
+void ApplicationIndex::clear()
+{
+	g_hash_table_remove_all(m_apps);
+	g_hash_table_remove_all(m_launchPoints);
+	g_hash_table_remove_all(m_packagesByAppId);
+	g_hash_table_remove_all(m_packagesByServiceId);
+	if (m_search)
+		m_search->clear();
+}
+
+void ApplicationIndex::enableSearch()
+{
+	if (!m_search)
+		m_search = new LaunchPointSearchIndex();
+}
@@ -0,0 +1,101 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef APPLICATIONINDEX_H
+#define APPLICATIONINDEX_H
+
+#include "Common.h"
+
+#include <string>
+#include <glib.h>
+
+class ApplicationDescription;
+class PackageDescription;
+class LaunchPoint;
+class LaunchPointSearchIndex;
+
+/*
+ * Secondary lookup tables for the ApplicationManager registries.
+ *
+ * The owning lists (m_registeredApps, m_systemApps, m_pendingApps, m_registeredPackages) stay the
+ * authoritative containers; this only maps ids to the objects held there so that the getXXXById family
+ * doesn't have to walk every app and every launch point. The index never owns or deletes anything.
+ *
+ * First insert wins for a given key, which matches the "first match in list order" behavior of the
+ * linear scans this replaces. Removal only drops a key if it still maps to the object being removed.
+ *
+ * With enableSearch() the launch points are also kept in a LaunchPointSearchIndex, for title/keyword search.
+ *
+ * NOT thread safe - callers mutate and query it under the same lock that guards the owning lists.
+ */
+class ApplicationIndex
+{
+public:
+
+	ApplicationIndex();
+	~ApplicationIndex();
+
+	// apps; these also (un)index all of the app's current launch points
+	void insertApp(ApplicationDescription* appDesc);
+	void removeApp(const ApplicationDescription* appDesc);
+
+	void insertLaunchPoint(const LaunchPoint* lp);
+	void removeLaunchPoint(const LaunchPoint* lp);
+
+	// re-reads the search terms of the app's launch points after its title/keywords/menu name changed in place
+	void refreshApp(const ApplicationDescription* appDesc);
+
+	// packages; indexes the package under each of its app ids and service ids
+	void insertPackage(PackageDescription* packageDesc);
+	void removePackage(const PackageDescription* packageDesc);
+
+	ApplicationDescription*	appById(const std::string& appId) const;
+	const LaunchPoint*		launchPointById(const std::string& launchPointId) const;
+	PackageDescription*		packageByAppId(const std::string& appId) const;
+	PackageDescription*		packageByServiceId(const std::string& serviceId) const;
+
+	bool containsApp(const ApplicationDescription* appDesc) const;
+
+	unsigned int appCount() const;
+	unsigned int launchPointCount() const;
+
+	void clear();
+
+	// starts keeping the launch points in a search index; call before anything is inserted
+	void enableSearch();
+	const LaunchPointSearchIndex* search() const { return m_search; }
+
+private:
+
+	static void insertKey(GHashTable* table, const std::string& key, gpointer value);
+	static void removeKey(GHashTable* table, const std::string& key, gconstpointer value);
+
+	GHashTable* m_apps;					// app id -> ApplicationDescription*
+	GHashTable* m_launchPoints;			// launch point id -> const LaunchPoint*
+	GHashTable* m_packagesByAppId;		// app id -> PackageDescription*
+	GHashTable* m_packagesByServiceId;	// service id -> PackageDescription*
+	LaunchPointSearchIndex* m_search;	// NULL unless enableSearch()
+
+	ApplicationIndex(const ApplicationIndex&);
+	ApplicationIndex& operator=(const ApplicationIndex&);
+};
+
+#endif /* APPLICATIONINDEX_H */
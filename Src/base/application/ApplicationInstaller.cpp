@@ -27,7 +27,10 @@
 
 #include "HostBase.h"
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
 #include "Logging.h"
+#include "LogFilter.h"
+#include "LunaConf.h"
 #include "Settings.h"
 #include "SystemService.h"
 #include "Time.h"
@@ -49,7 +52,6 @@
 #include "cjson/json_util.h"
 #include <errno.h>
 
-#include <ftw.h>
 #include <dirent.h>
 #include <regex.h>
 #include <glib.h>
@@ -59,6 +61,8 @@
 #include <QUrl>
 
 #include "PackageDescription.h"
+#include "PackageSizeAccounting.h"
+#include "SignatureVerifier.h"
 
 #define REMOVER_RETURNC__FAILEDIPKGREMOVE			1
 #define REMOVER_RETURNC__SUCCESS					0
@@ -97,29 +101,19 @@ static const char*		s_pkginstallerExec 						=	"opkg";
 static const char*		s_pkginstallerOpts_location				=	"-o";
 static const char*		s_pkginstallerOpts_remove				=	"remove";
 
-static const char *	const s_verifyExec							=	"openssl";
 #if defined(TARGET_DEVICE)
 static const char * const s_revocationCertFile = "/etc/ssl/certs/pubsubsigning-bundle.crt";
 #else
 static const char * const s_revocationCertFile = "/etc/ssl/certs/pubsubsigning-bundle.crt";
 #endif
 
-static const char * const s_extractKeyOpts[] = { "x509" , "-in" , "-pubkey" , ">"};
-
 static ApplicationInstaller* s_instance = 0;
-static const char*    s_logChannel = "ApplicationInstaller";
+static LogChannel*    s_logChannel = logChannel("ApplicationInstaller");
 
 
 ////                    CLASS STATICS   --------------------------------------------------------------------------------
-Mutex		ApplicationInstaller::s_sizeFnMutex;
-std::string	ApplicationInstaller::s_sizeFnBaseDir;
-uint64_t		ApplicationInstaller::s_sizeFnAccumulator = 0;
-uint64_t		ApplicationInstaller::s_auxSizeFnAccumulator = 0;
-uint64_t		ApplicationInstaller::s_targetFsBlockSize = 0;
-json_object * ApplicationInstaller::s_manifestJobj = 0;
 std::string  ApplicationInstaller::s_installer_version 	= 	"1.0.0";
 	
-std::list<CommandParams*> ApplicationInstaller::s_commandParams;
 json_object * ApplicationInstaller::dbg_statxfs_persistent;
 	
 statfsfn ApplicationInstaller::s_statfsFn = ::statfs;
@@ -175,8 +169,24 @@ ApplicationInstaller* ApplicationInstaller::instance()
 	return s_instance;
 }
 
+// how many install/remove commands may run at once; [ApplicationInstaller] MaxConcurrentCommands in luna.conf
+static unsigned int readMaxConcurrentCommands()
+{
+	static const int maxAllowed = 8;
+
+	int value = 1;
+	readLunaConfInteger("ApplicationInstaller", "MaxConcurrentCommands", value);
+
+	if (value < 1 || value > maxAllowed) {
+		g_warning("%s: MaxConcurrentCommands %d is out of range, clamping to [1,%d]", __FUNCTION__, value, maxAllowed);
+		value = CLAMP(value, 1, maxAllowed);
+	}
+	return (unsigned int) value;
+}
+
 ApplicationInstaller::ApplicationInstaller()
 	: m_inBrickMode(false)
+	, m_commands(readMaxConcurrentCommands())
 	, m_service (NULL)
 {
 }
@@ -226,7 +236,7 @@ void ApplicationInstaller::startService()
 
 	GMainLoop *mainLoop = HostBase::instance()->mainLoop();
 
-	luna_log(s_logChannel, "ApplicationInstaller (service) starting...");
+	channel_log(s_logChannel, "ApplicationInstaller (service) starting...");
    
     result = LSRegister("com.palm.appinstaller", &m_service, &lsError);
 	if (!result)
@@ -243,11 +253,11 @@ void ApplicationInstaller::startService()
 Done:
 
 	if (!result) {
-		luna_critical(s_logChannel, "Failed in ApplicationInstaller: %s", lsError.message);
+		channel_critical(s_logChannel, "Failed in ApplicationInstaller: %s", lsError.message);
 		LSErrorFree(&lsError);
 	}
 	else {
-		luna_log(s_logChannel, "ApplicationInstaller on service bus");
+		channel_log(s_logChannel, "ApplicationInstaller on service bus");
 	}
 }
 
@@ -350,7 +360,7 @@ static void util_ipkgInstallDone (GPid pid, gint status, gpointer data)
     g_warning ("%s: closing process id %d", __PRETTY_FUNCTION__, pid);
     g_spawn_close_pid (pid);
 
-	ApplicationInstaller::instance()->oneCommandProcessed();
+	ApplicationInstaller::instance()->oneCommandProcessed(installParams);
 }
 
 static void util_ipkgRemoveDone (GPid pid, gint status, gpointer data)
@@ -399,7 +409,7 @@ static void util_ipkgRemoveDone (GPid pid, gint status, gpointer data)
     g_warning ("%s: closing process id %d", __PRETTY_FUNCTION__, pid);
     g_spawn_close_pid (pid);
 
-	ApplicationInstaller::instance()->oneCommandProcessed();
+	ApplicationInstaller::instance()->oneCommandProcessed(removeParams);
 }
 
 static gboolean util_ipkgInstallIoChannelCallback(GIOChannel* channel, GIOCondition condition, gpointer arg)
@@ -739,10 +749,9 @@ int ApplicationInstaller::lunasvcRemove(RemoveParams *removeParams)
 	else {
 		setpriority(PRIO_PROCESS, childPid, IPKG_PROCESS_PRIORITY);
 
-		m_cmdState.processing = true;
-		m_cmdState.pid = childPid;
-		m_cmdState.sourceId = g_child_watch_add_full(G_PRIORITY_HIGH_IDLE, childPid,
-													 util_ipkgRemoveDone, removeParams, NULL);
+		removeParams->_childPid = childPid;
+		removeParams->_childWatch = g_child_watch_add_full(G_PRIORITY_HIGH_IDLE, childPid,
+														   util_ipkgRemoveDone, removeParams, NULL);
 		
 	    g_warning ("ApplicationInstaller::lunasvcRemove(): Step 2: added watch on child pid %d", childPid);
 	}
@@ -759,8 +768,7 @@ int ApplicationInstaller::lunasvcRemove(RemoveParams *removeParams)
 	}
 
 	//remove the app manifest
-	std::string appManifestPath = Settings::LunaSettings()->packageManifestsPath + std::string("/")+packageName+std::string(".pmmanifest");
-	unlink(appManifestPath.c_str());			//even if packageName is somehow == "", this will be harmless as it will try to unlink a <whatever>/.pmmanifest file (non existent)
+	sizeAccounting()->forget(packageName);
 
 	return REMOVER_RETURNC__SUCCESS;
 }
@@ -774,7 +782,7 @@ gboolean ApplicationInstaller::cbShallowRemove(gpointer param)
 	EventReporter::instance()->report("uninstall", removeParams->_packageName.c_str());
 	util_LSSubReplyWithRelay_IgnoreError((LSHandle*)removeParams->_lshandle, ls_sub_key, removeParams->ticketId, ls_payload);
 
-	ApplicationInstaller::instance()->oneCommandProcessed();
+	ApplicationInstaller::instance()->oneCommandProcessed(removeParams);
 
 	return FALSE;
 }
@@ -1209,24 +1217,30 @@ int ApplicationInstaller::getAllUserInstalledAppSizes(std::vector<std::pair<std:
 	if (r == 0)
 		return 0;		//no apps found
 	
-	int n_found=0;
-	for (std::vector<std::string>::iterator it = appNames.begin();it != appNames.end();++it) 
+	// the size of an app is that of its package; all of them are measured in one pass
+	std::vector<std::string> packageIds;
+	for (std::vector<std::string>::iterator it = appNames.begin();it != appNames.end();++it)
 	{
-		
-		ApplicationDescription * appDesc = ApplicationManager::instance()->getAppById(*it);
-		if (appDesc == NULL)
+		PackageDescription * packageDesc = ApplicationManager::instance()->getPackageInfoByAppId(*it);
+		if (packageDesc == NULL)
 		{
-			g_warning("%s: Cannot find descriptor for %s",__FUNCTION__,(*it).c_str());
-			appList.push_back(std::pair<std::string,uint64_t>(*it,0));
-			++n_found;
+			g_warning("%s: Cannot find package descriptor for %s",__FUNCTION__,(*it).c_str());
+			packageIds.push_back(std::string());
 			continue;
 		}
-		
-		g_warning("%s: Found size = %llu for %s",__FUNCTION__,appDesc->appSize(),(*it).c_str());
-		appList.push_back(std::pair<std::string,uint64_t>(*it,appDesc->appSize()));
+		packageIds.push_back(packageDesc->id());
+	}
+
+	std::vector<uint64_t> sizes;
+	getSizesOfPackagesById(packageIds,sizes);
+
+	int n_found=0;
+	for (unsigned int i = 0;i < appNames.size();++i)
+	{
+		appList.push_back(std::pair<std::string,uint64_t>(appNames[i],sizes[i]));
 		++n_found;
 	} //end app name iteration
-	
+
 	return n_found;
 }
 
@@ -1268,140 +1282,78 @@ uint64_t ApplicationInstaller::getFsFreeSpaceInBlocks(const std::string& pathOnF
 	return (fs_stats.f_bfree);
 }
 
-//static 
-uint64_t ApplicationInstaller::getSizeOfAppDir(const std::string& dirName)
+//static
+PackageSizeAccounting* ApplicationInstaller::sizeAccounting()
 {
-	gchar cstr[FILENAME_MAX+1];
-	if (dirName.length() > FILENAME_MAX)
-		return 0;
-	strcpy(cstr,dirName.c_str());
-
-	gchar * g_stdoutBuffer = NULL;
-	gchar * g_stderrBuffer = NULL;
-	gchar * argv[] = {(gchar *)"du",(gchar *)"-s",cstr,0};
-	GError * gerr = NULL;
-	gint exit_status=0;
-	GSpawnFlags flags = (GSpawnFlags)(G_SPAWN_SEARCH_PATH);
-	gboolean resultStatus = g_spawn_sync(NULL,
-			argv,
-			NULL,
-			flags,
-			NULL,
-			NULL,
-			&g_stdoutBuffer,
-			&g_stderrBuffer,
-			&exit_status,
-			&gerr);
-
-	g_free(g_stderrBuffer);		//don't need it...can probably supress this buffer from being created with a GFlag but I've had some trouble w/ that...
+	static PackageSizeAccounting* s_sizeAccounting = 0;
+	if (!s_sizeAccounting)
+		s_sizeAccounting = new PackageSizeAccounting(Settings::LunaSettings()->packageManifestsPath, s_installer_version);
+	return s_sizeAccounting;
+}
 
-	if ((!resultStatus) || (!g_stdoutBuffer)) {
-		if (gerr) {
-			g_warning("ApplicationInstaller::getSizeOfAppDir(): error - %s",gerr->message);
-			g_error_free(gerr);
-		}
-		
-	}
+//static
+SignatureVerifier* ApplicationInstaller::signatureVerifier()
+{
+	static SignatureVerifier* s_signatureVerifier = 0;
+	if (!s_signatureVerifier)
+		s_signatureVerifier = new SignatureVerifier();
+	return s_signatureVerifier;
+}
 
-	//split
-	gchar ** tokens = g_strsplit_set(g_stdoutBuffer,(gchar *)" \t",2);
-	g_free(g_stdoutBuffer);
-	if (tokens == NULL) {
-		return 0;
+// the folders of a package and the block size of the filesystem they are counted for
+static bool packageToMeasure(const std::string& destFsPath, PackageDescription* packageDesc, PackageSizeAccounting::Package& r_package)
+{
+	if (!packageDesc) {
+		g_warning("packageDesc is null in %s", __PRETTY_FUNCTION__);
+		return false;
 	}
-	if (tokens[0] == NULL) {
-		//nothing...
-		g_strfreev(tokens);
-		return 0;
+	if (packageDesc->id().empty()) {
+		g_warning("packageDesc->id() is empty in %s", __PRETTY_FUNCTION__);
+		return false;
 	}
 
-	long sz = atol(tokens[0]);
-	g_strfreev(tokens);
-	if (sz == 0) {
-		//nothing
-		return 0;
+	uint64_t bsize = 0;
+	if (destFsPath.empty())
+		ApplicationInstaller::getFsFreeSpaceInBlocks(packageDesc->folderPath(), &bsize);
+	else
+		ApplicationInstaller::getFsFreeSpaceInBlocks(destFsPath, &bsize);
+
+	if (bsize == 0) {
+		g_warning("filesystem block size for %s is 0 in %s", packageDesc->id().c_str(), __PRETTY_FUNCTION__);
+		return false;
 	}
 
-	return (((uint64_t)sz) * 1024);
-}
+	r_package.id = packageDesc->id();
+	r_package.version = packageDesc->version();
+	r_package.blockSize = bsize;
+	r_package.folders.clear();
 
-//static 
-int ApplicationInstaller::_getSizeCbFn(const char *fpath, const struct stat *sb,int typeflag, struct FTW *ftwbuf)
-{
-//	printf("%-3s %2d %7lld   %-40s %d %s\n",
-//			(typeflag == FTW_D) ?   "dir"   : (typeflag == FTW_DNR) ? "(access denied)" :
-//	(typeflag == FTW_DP) ?  "dp"  : (typeflag == FTW_F) ?   "file" :
-//	(typeflag == FTW_DP) ?  "dp"  : (typeflag == FTW_SL) ?  "symlink" :
-//	(typeflag == FTW_SLN) ? "symlink-broken" : "???",
-//			ftwbuf->level, (long long) sb->st_size,
-//			fpath, ftwbuf->base, fpath + ftwbuf->base);
-	//if (typeflag == FTW_F) 
-	if (s_sizeFnBaseDir != fpath) //exclude the base dir entry
-	{
-		s_sizeFnAccumulator += (uint64_t) sb->st_blocks;
-		s_auxSizeFnAccumulator += (uint64_t) sb->st_size;
-	}
-	return 0;           /* To tell nftw() to continue */
+	// the apps in this package, then its services, then the package folder itself
+	std::vector<std::string>::const_iterator appIdIt, appIdItEnd;
+	for (appIdIt = packageDesc->appIds().begin(), appIdItEnd = packageDesc->appIds().end(); appIdIt != appIdItEnd; ++appIdIt)
+		r_package.folders.push_back(Settings::LunaSettings()->appInstallBase + std::string("/") + Settings::LunaSettings()->appInstallRelative + std::string("/") + *appIdIt + std::string("/"));
 
+	std::vector<std::string>::const_iterator serviceIdIt, serviceIdItEnd;
+	for (serviceIdIt = packageDesc->serviceIds().begin(), serviceIdItEnd = packageDesc->serviceIds().end(); serviceIdIt != serviceIdItEnd; ++serviceIdIt)
+		r_package.folders.push_back(Settings::LunaSettings()->serviceInstallBase + std::string("/") + Settings::LunaSettings()->serviceInstallRelative + std::string("/") + *serviceIdIt + std::string("/"));
+
+	r_package.folders.push_back(packageDesc->folderPath());
+	return true;
 }
 
-//static 
-int ApplicationInstaller::_getSizeOfAppCbFn(const char *fpath, const struct stat *sb,int typeflag, struct FTW *ftwbuf)
+//static
+uint64_t ApplicationInstaller::getSizeOfAppDir(const std::string& dirName)
 {
-	uint64_t resizedBlocks;
-	if (s_sizeFnBaseDir != std::string(fpath)) //exclude the base dir entry
-	{
-		s_auxSizeFnAccumulator += sb->st_size;
-		if (typeflag == FTW_DP)
-		{
-			resizedBlocks = 1;
-			s_sizeFnAccumulator += 1;				//1 block for directories	
-		}
-		else 
-		{
-			resizedBlocks = ((((uint64_t) sb->st_size)) / s_targetFsBlockSize) + ((((uint64_t) sb->st_size)) % s_targetFsBlockSize ? 1 : 0);
-			s_sizeFnAccumulator += resizedBlocks;
-		}
-		
-		if ((s_manifestJobj) && (!is_error(s_manifestJobj)))
-		{
-			//pull out the two j-arrays
-			std::string bsizeStr = toSTLString<uint64_t>(s_targetFsBlockSize);
-			int addRc = 0;
-			json_object * jArray_real = json_object_object_get(s_manifestJobj,"real");
-			if ((jArray_real == 0) || (is_error(jArray_real)))
-			{
-				jArray_real = json_object_new_array();
-				addRc |= 1;
-			}
-			json_object * jArray_bsize = json_object_object_get(s_manifestJobj,bsizeStr.c_str());
-			if ((jArray_bsize == 0) || (is_error(jArray_bsize)))
-			{
-				jArray_bsize = json_object_new_array();
-				addRc |= 2;
-			}
-			
-			//add to arrays
-			std::string sz = toSTLString<uint64_t>(((uint64_t) sb->st_size));
-			json_object * innerJobj = json_object_new_object();
-			json_object_object_add(innerJobj,"file",json_object_new_string(fpath));
-			json_object_object_add(innerJobj,"size",json_object_new_string(sz.c_str()));
-			json_object_array_add(jArray_real,innerJobj);
-			sz = toSTLString<uint64_t>(resizedBlocks * s_targetFsBlockSize);
-			innerJobj = json_object_new_object();
-			json_object_object_add(innerJobj,"file",json_object_new_string(fpath));
-			json_object_object_add(innerJobj,"size",json_object_new_string(sz.c_str()));
-			json_object_array_add(jArray_bsize,innerJobj);
-			
-			//add the arrays to the top level obj, if necessary
-			if (addRc & 1)
-				json_object_object_add(s_manifestJobj,"real",jArray_real);
-			if (addRc & 2)
-				json_object_object_add(s_manifestJobj,bsizeStr.c_str(),jArray_bsize);
-		}
-			
-	}
-	return 0;           /* To tell nftw() to continue */
+	// what 'du -s' would say: allocated space, the folder itself included
+	PackageSizeAccounting::Walk walk;
+	if (!PackageSizeAccounting::walk(dirName, 1, walk))
+		return 0;
+
+	struct stat st;
+	if (stat(dirName.c_str(), &st) == 0)
+		walk.allocatedBytes += (uint64_t) st.st_blocks * 512;
+
+	return walk.allocatedBytes;
 }
 
 //static
@@ -1413,113 +1365,96 @@ uint64_t ApplicationInstaller::getSizeOfPackageById(const std::string& packageId
 	 *
 	 */
 
-	PackageDescription* packageDesc = ApplicationManager::instance()->getPackageInfoByPackageId(packageId);
-	if (packageDesc) {
-		if (packageDesc->packageSize() == 0)
-			packageDesc->setPackageSize(getSizeOfPackageOnFsGenerateManifest("", packageDesc, NULL));	//TODO: maybe check for an existing manifest? (though likely it's not there)
-		return (packageDesc->packageSize());
+	std::vector<std::string> packageIds(1, packageId);
+	std::vector<uint64_t> sizes;
+	getSizesOfPackagesById(packageIds, sizes);
+	return sizes[0];
+}
+
+//static
+void ApplicationInstaller::getSizesOfPackagesById(const std::vector<std::string>& packageIds, std::vector<uint64_t>& r_sizes)
+{
+	r_sizes.assign(packageIds.size(), 0);
+
+	std::vector<PackageSizeAccounting::Package> packages;
+	std::vector<PackageDescription*> packageDescs;
+	std::vector<unsigned int> indexes;
+
+	for (unsigned int i = 0; i < packageIds.size(); i++) {
+		if (packageIds[i].empty())
+			continue;
+
+		PackageDescription* packageDesc = ApplicationManager::instance()->getPackageInfoByPackageId(packageIds[i]);
+		PackageSizeAccounting::Package package;
+		if (!packageDesc || !packageToMeasure("", packageDesc, package))
+			continue;
+
+		packages.push_back(package);
+		packageDescs.push_back(packageDesc);
+		indexes.push_back(i);
 	}
-	return 0;
+
+	// packages that haven't changed since they were last measured aren't walked; the others are walked in parallel
+	sizeAccounting()->measure(packages, true);
+
+	// most of these are answered from the cache with the size the package already has; only a size that moved
+	// makes the list* replies stale
+	bool changed = false;
+	for (unsigned int i = 0; i < packages.size(); i++) {
+		if (packageDescs[i]->packageSize() != packages[i].size
+				|| packageDescs[i]->blockSize() != (uint32_t) packages[i].blockSize) {
+			packageDescs[i]->setPackageSize(packages[i].size);
+			packageDescs[i]->setBlockSize((uint32_t) packages[i].blockSize);
+			changed = true;
+		}
+		r_sizes[indexes[i]] = packages[i].size;
+	}
+	if (changed)
+		ApplicationManager::instance()->registryChanged();
 }
 
 //static
 uint64_t ApplicationInstaller::getSizeOfAppOnFs(const std::string& destFsPath,const std::string& dirName,uint32_t * r_pBsize)
 {
-	MutexLocker lock(&s_sizeFnMutex);
-	s_sizeFnBaseDir = dirName;
-	s_sizeFnAccumulator = 0;
-	s_auxSizeFnAccumulator = 0;
+	uint64_t bsize = 0;
 	if (destFsPath.empty())
-		getFsFreeSpaceInBlocks(dirName,&s_targetFsBlockSize);
+		getFsFreeSpaceInBlocks(dirName,&bsize);
 	else
-		getFsFreeSpaceInBlocks(destFsPath,&s_targetFsBlockSize);
-	
-	if (s_targetFsBlockSize == 0)
+		getFsFreeSpaceInBlocks(destFsPath,&bsize);
+
+	if (bsize == 0)
 		return 0;
-	
-	nftw(dirName.c_str(), ApplicationInstaller::_getSizeOfAppCbFn, 20, FTW_PHYS | FTW_DEPTH);
+
+	PackageSizeAccounting::Walk walk;
+	PackageSizeAccounting::walk(dirName, bsize, walk);
 	if (r_pBsize)
-		*r_pBsize = s_targetFsBlockSize;
-	return s_sizeFnAccumulator * s_targetFsBlockSize;			//up to this point, the size was in fs blocks
-		
+		*r_pBsize = bsize;
+	return walk.blocks * bsize;
 }
 
-uint64_t ApplicationInstaller::getSizeOfPackageOnFsGenerateManifest(const std::string& destFsPath, PackageDescription* packageDesc, uint32_t * r_pBsize)
+//static
+uint64_t ApplicationInstaller::getSizeOfPackage(PackageDescription* packageDesc, uint32_t * r_pBsize)
 {
-	MutexLocker lock(&s_sizeFnMutex);
-	if (!packageDesc) {
-		g_warning("packageDesc is null in %s", __PRETTY_FUNCTION__);
+	std::vector<PackageSizeAccounting::Package> packages(1);
+	if (!packageToMeasure("", packageDesc, packages[0]))
 		return 0;
-	}
-	if (packageDesc->id().empty()) {
-		g_warning("packageDesc->id() is empty in %s", __PRETTY_FUNCTION__);
-		return 0;
-	}
 
-	s_sizeFnAccumulator = 0;
-	s_auxSizeFnAccumulator = 0;
-
-	if (destFsPath.empty()) {
-		getFsFreeSpaceInBlocks(packageDesc->folderPath(), &s_targetFsBlockSize);
-	} else {
-		getFsFreeSpaceInBlocks(destFsPath, &s_targetFsBlockSize);
-	}
+	sizeAccounting()->measure(packages, true);
+	if (r_pBsize)
+		*r_pBsize = packages[0].blockSize;
+	return packages[0].size;
+}
 
-	if (s_targetFsBlockSize == 0) {
-		g_warning("s_targetFsBlockSize is 0 in %s", __PRETTY_FUNCTION__);
+uint64_t ApplicationInstaller::getSizeOfPackageOnFsGenerateManifest(const std::string& destFsPath, PackageDescription* packageDesc, uint32_t * r_pBsize)
+{
+	std::vector<PackageSizeAccounting::Package> packages(1);
+	if (!packageToMeasure(destFsPath, packageDesc, packages[0]))
 		return 0;
-	}
-
-	//if the manifest jobj is uncleared, clear it
-	if (s_manifestJobj && (!is_error(s_manifestJobj)))
-	{
-		json_object_put(s_manifestJobj);
-	}
-	s_manifestJobj = json_object_new_object();
-	json_object_object_add(s_manifestJobj,"version",json_object_new_string(packageDesc->version().c_str()));
-	json_object_object_add(s_manifestJobj,"installer",json_object_new_string(ApplicationInstaller::s_installer_version.c_str()));
-
-	// add up the sizes of all the apps in this package
-	std::vector<std::string>::const_iterator appIdIt, appIdItEnd;
-	for (appIdIt = packageDesc->appIds().begin(), appIdItEnd = packageDesc->appIds().end(); appIdIt != appIdItEnd; ++appIdIt) {
-		std::string folderPath = Settings::LunaSettings()->appInstallBase + std::string("/") + Settings::LunaSettings()->appInstallRelative + std::string("/") + *appIdIt + std::string("/");
-		s_sizeFnBaseDir = folderPath;
-		nftw(folderPath.c_str(), ApplicationInstaller::_getSizeOfAppCbFn, 20, FTW_PHYS | FTW_DEPTH);
-		printf("DDD: %s looking at app folder %s\n", __PRETTY_FUNCTION__, (*appIdIt).c_str());
-	}
-
-	// now add up the sizes of all the services in this package
-	std::vector<std::string>::const_iterator serviceIdIt, serviceIdItEnd;
-	for (serviceIdIt = packageDesc->serviceIds().begin(), serviceIdItEnd = packageDesc->serviceIds().end(); serviceIdIt != serviceIdItEnd; ++serviceIdIt) {
-		std::string folderPath = Settings::LunaSettings()->serviceInstallBase + std::string("/") + Settings::LunaSettings()->serviceInstallRelative + std::string("/") + *serviceIdIt + std::string("/");
-		s_sizeFnBaseDir = folderPath;
-		nftw(folderPath.c_str(), ApplicationInstaller::_getSizeOfAppCbFn, 20, FTW_PHYS | FTW_DEPTH);
-	}
-
-	// finally add the size of the package folder itself
-	std::string packageFolder = packageDesc->folderPath();
-	s_sizeFnBaseDir = packageFolder;
-	nftw(packageFolder.c_str(), ApplicationInstaller::_getSizeOfAppCbFn, 20, FTW_PHYS | FTW_DEPTH);
 
+	sizeAccounting()->measure(packages, false);
 	if (r_pBsize)
-		*r_pBsize = s_targetFsBlockSize;
-
-	//put the total sizes into the manifest obj
-	std::string bsizeStr = toSTLString<uint64_t>(s_targetFsBlockSize);
-	std::string sizeStr = toSTLString<uint64_t>(s_auxSizeFnAccumulator);
-	json_object * totalSizeJobj = json_object_new_object();
-	json_object_object_add(totalSizeJobj,"real",json_object_new_string(sizeStr.c_str()));
-	sizeStr = toSTLString<uint64_t>(s_sizeFnAccumulator * s_targetFsBlockSize);
-	json_object_object_add(totalSizeJobj,bsizeStr.c_str(),json_object_new_string(sizeStr.c_str()));
-	json_object_object_add(s_manifestJobj,"totals",totalSizeJobj);
-
-	//write to the manifest file
-	std::string path = Settings::LunaSettings()->packageManifestsPath + std::string("/") + packageDesc->id() + std::string(".pmmanifest");
-	json_object_to_file((char *) path.c_str(), s_manifestJobj);
-	json_object_put(s_manifestJobj);
-	s_manifestJobj = NULL;
-
-	return s_sizeFnAccumulator * s_targetFsBlockSize;			//up to this point, the size was in fs blocks
+		*r_pBsize = packages[0].blockSize;
+	return packages[0].size;
 }
 
 //static
@@ -1546,24 +1481,27 @@ bool ApplicationInstaller::arePathsOnSameFilesystem(const std::string& path1,con
 //static 
 int ApplicationInstaller::doSignatureVerifyOnFile(const std::string& file,const std::string& signatureFile,const std::string& pubkeyFile)
 {
-	std::vector<std::string> params;
-	params.push_back("dgst");params.push_back("-sha1");params.push_back("-verify");
-	params.push_back(pubkeyFile);params.push_back("-signature");params.push_back(signatureFile);
-	params.push_back(file);
-	return (ApplicationInstaller::runOpenSSL(params,std::string("")));
+	std::vector<std::string> files(1, file);
+	return doSignatureVerifyOnFiles(files, signatureFile, pubkeyFile);
 }
 
 //static 
+/*
+ * Returns <= 0 for error, >0 for success
+ *
+ * the files are verified as if they were concatenated, the same as cat <files> | openssl dgst -sha1 -verify <pubkeyFile> -signature <signatureFile>
+ */
 int ApplicationInstaller::doSignatureVerifyOnFiles(std::vector<std::string>& files,const std::string& signatureFile,const std::string& pubkeyFile)
 {
-	std::vector<std::string> params;
-	std::string globbedparam = std::string("/bin/cat ");
-	for (std::vector<std::string>::iterator it = files.begin();it != files.end();++it) {
-		globbedparam += (*it + std::string(" "));
-	}
-	globbedparam += std::string("| openssl dgst -sha1 -verify ") + pubkeyFile + std::string(" -signature ") + signatureFile;
-	params.push_back("-c");params.push_back(globbedparam);
-	return (ApplicationInstaller::runOpenSSL(params,std::string("sh")));
+	SignatureVerifier::Request request;
+	request.files = files;
+	request.keyFile = pubkeyFile;
+	if (!SignatureVerifier::readFile(signatureFile, request.signature)) {
+		g_warning("ApplicationInstaller::doSignatureVerifyOnFiles(): can't read signature file %s", signatureFile.c_str());
+		return -1;
+	}
+
+	return signatureVerifier()->verify(request);
 }
 
 //static 
@@ -1580,120 +1518,15 @@ int ApplicationInstaller::extractPublicKeyFromCert(const std::string& certFile,c
 	if (doesExistOnFilesystem(pubkeyFile.c_str()))
 		return 0;
 	
-	//extract the public key
-	//openssl x509 -in <certname> -pubkey -out pubkey.pem
-	std::string space = std::string(" ");
-	std::string cmdline = std::string(s_verifyExec)
-	+space+std::string(s_extractKeyOpts[0])
-	+space+std::string(s_extractKeyOpts[1])
-	+space+certFile
-	+space+std::string(s_extractKeyOpts[2])
-	+space+std::string(s_extractKeyOpts[3])
-	+space+pubkeyFile;
-
-	g_warning("ApplicationInstaller::extractPublicKeyFromCert(): executing (via system()): %s",cmdline.c_str());
-	int exit_status = system(cmdline.c_str());
-	if (isNonErrorProcExit((int)exit_status) == false) {
-		g_warning("ApplicationInstaller::extractPublicKeyFromCert(): error: system() call returned %d",exit_status);
+	//extract the public key (what openssl x509 -in <certname> -pubkey -out pubkey.pem did)
+	if (!signatureVerifier()->writePublicKey(certFile, pubkeyFile)) {
+		g_warning("ApplicationInstaller::extractPublicKeyFromCert(): error: couldn't extract the public key of %s",certFile.c_str());
 		return 0;
 	}
 
 	return 1;
 }
 
-//static
-/*
- * Returns <= 0 for error, >0 for success
- * 
- * parameter command can be specified as a "", in which case the default openssl commandname is used
- */
-int ApplicationInstaller::runOpenSSL(std::vector<std::string>& params,const std::string& command)
-{
-	
-	gchar * g_stdoutBuffer = NULL;
-	gchar * g_stderrBuffer = NULL;
-	std::string re;
-	int rc=0;
-	
-	gchar ** argv = new gchar *[params.size()+2];
-	if (command.size()) {
-		argv[0] = new gchar[command.size()+1];
-		strcpy(argv[0],command.c_str());
-	}
-	else {
-		argv[0] = new gchar[strlen("openssl")+1];
-		strcpy(argv[0],"openssl");
-	}
-	int sz=1;
-	for (std::vector<std::string>::iterator it = params.begin();
-			it != params.end();++it,++sz) 
-	{
-		std::string& str = (*it);
-		argv[sz] = new gchar[str.size()+1];
-		strcpy(argv[sz],str.c_str());
-	}
-	argv[sz] = 0;
-	
- 	GError * gerr = NULL;
-	gint exit_status=0;
-	GSpawnFlags flags = (GSpawnFlags)(G_SPAWN_SEARCH_PATH);
-
-	/*
-	 * gboolean            g_spawn_sync                 (const gchar *working_directory,
-		                                                         gchar **argv,
-		                                                         gchar **envp,
-		                                                         GSpawnFlags flags,
-		                                                         GSpawnChildSetupFunc child_setup,
-		                                                         gpointer user_data,
-		                                                         gchar **standard_output,
-		                                                         gchar **standard_error,
-		                                                         gint *exit_status,
-		                                                         GError **error);
-	 */
-
-	gboolean resultStatus = g_spawn_sync(NULL,
-			argv,
-			NULL,
-			flags,
-			NULL,
-			NULL,
-			&g_stdoutBuffer,
-			&g_stderrBuffer,
-			&exit_status,
-			&gerr);
-
-	if ((!resultStatus) || (!g_stdoutBuffer)) {
-		rc = -1;
-		goto Done_run_ssl;
-	}
-	
-	//for some reason, the regexec doesn't like "|" or expects it in some weird way
-	if (compare_regex(".*failure.*",g_stdoutBuffer) || compare_regex(".*error.*",g_stdoutBuffer))
-		rc = 0;
-	else
-		rc =1;
-
-Done_run_ssl:
-
-	if (g_stdoutBuffer)
-		g_free(g_stdoutBuffer);
-	if (g_stderrBuffer)
-		g_free(g_stderrBuffer);
-	if (gerr) {
-		g_warning("ApplicationInstaller::runOpenSSL(): error - %s",gerr->message);
-		g_error_free(gerr);
-	}
-	
-	while (sz >= 0) {
-		if (argv[sz])
-			delete[] argv[sz];
-		--sz;
-	}
-	delete[] argv;
-	
-	return rc;	
-}
-
 //static 
 int ApplicationInstaller::runIpkgRemove(const std::string& ipkgRoot,const std::string& packageName)
 {
@@ -1896,14 +1729,14 @@ bool ApplicationInstaller::cbInstall(LSHandle* lshandle, LSMessage *msg,void *us
 
 	label = json_object_object_get(root, "target");
 	if ((!label) || (is_error(label))) {
-		luna_warn(s_logChannel, "Failed to find param target in message");
+		channel_warn(s_logChannel, "Failed to find param target in message");
 		goto Done;
 	}
 
 	target_ccptr = (const char *)(json_object_get_string(label));
 
 	if (!target_ccptr) {
-		luna_warn(s_logChannel, "Failed to find param target (non-string in tag) in message");
+		channel_warn(s_logChannel, "Failed to find param target (non-string in tag) in message");
 		goto Done;
 	}
 	targetPackageFile = target_ccptr;
@@ -2097,7 +1930,7 @@ bool ApplicationInstaller::cbInstallNoVerify(LSHandle* lshandle, LSMessage *msg,
 
 	label = json_object_object_get(root, "target");
 	if ((!label) || (is_error(label))) {
-		luna_warn(s_logChannel, "Failed to find param target in message");
+		channel_warn(s_logChannel, "Failed to find param target in message");
 		errorCode = std::string("Failed to find param target in message");
 		goto Done;
 	}
@@ -2105,7 +1938,7 @@ bool ApplicationInstaller::cbInstallNoVerify(LSHandle* lshandle, LSMessage *msg,
 	targetPackageFile = std::string((const char *)(json_object_get_string(label)));
 
 	if (targetPackageFile.length() == 0) {
-		luna_warn(s_logChannel, "Failed to find param target (non-string in tag) in message");
+		channel_warn(s_logChannel, "Failed to find param target (non-string in tag) in message");
 		errorCode = std::string("Failed to find param target (non-string in tag) in message");
 		goto Done;
 	}
@@ -2295,14 +2128,14 @@ bool ApplicationInstaller::cbRemove(LSHandle* lshandle, LSMessage *msg,void *use
 
 	package = json_object_object_get(root, "packageName");
 	if (!package) {
-		luna_warn(s_logChannel, "Failed to find param packageName in message");
+		channel_warn(s_logChannel, "Failed to find param packageName in message");
 		goto Done;
 	}
 
 	packageName_ccptr = (const char *)(json_object_get_string(package));
 
 	if (!packageName_ccptr) {
-		luna_warn(s_logChannel, "Failed to find param packageName (non-string in tag) in message");
+		channel_warn(s_logChannel, "Failed to find param packageName (non-string in tag) in message");
 		goto Done;
 	}
 	packageName = packageName_ccptr;
@@ -2496,20 +2329,20 @@ bool ApplicationInstaller::cbNotifyOnChange(LSHandle* lshandle, LSMessage *msg,v
 
 	if (is_error(root)) {
 		root = NULL;
-		luna_warn(s_logChannel, "Failed to find param appId in message...defaulting to all appIds");
+		channel_warn(s_logChannel, "Failed to find param appId in message...defaulting to all appIds");
 		appid_ccptr = "*";
 	}
 	else {
 		j_appid = json_object_object_get(root, "appId");
 		if (!j_appid) {
-			luna_warn(s_logChannel, "Failed to find param appId in message...defaulting to all appIds");
+			channel_warn(s_logChannel, "Failed to find param appId in message...defaulting to all appIds");
 			appid_ccptr = "*";
 		}
 		else {
 			appid_ccptr = (const char *)(json_object_get_string(j_appid));
 
 			if (!appid_ccptr) {
-				luna_warn(s_logChannel, "Failed to find param appId (non-string in tag) in message...defaulting to all appIds");
+				channel_warn(s_logChannel, "Failed to find param appId (non-string in tag) in message...defaulting to all appIds");
 				appid_ccptr = "*";
 			}
 		}
@@ -3375,15 +3208,11 @@ bool ApplicationInstaller::cbRevoke(LSHandle* lshandle,LSMessage *msg,void *user
 	std::string errorText;
 	std::string innerPayload;
 	std::string appIdGlob;
-	std::string appIdGlobTmpFilename;
 	std::string signatureBase64;
-	std::string signatureRaw;
-	std::string signatureTmpFilename;
 	struct json_object * appidArray;
 	std::string appIdForIdx;
 	int listIdx;
-	std::vector<std::string> opensslParams;
-	std::string pubkeyTmpFilename;
+	SignatureVerifier::Request verifyRequest;
 
     // {"item": string, "payload": {"signature": string, "appId": array}}
     VALIDATE_SCHEMA_AND_RETURN(lshandle,
@@ -3428,7 +3257,7 @@ bool ApplicationInstaller::cbRevoke(LSHandle* lshandle,LSMessage *msg,void *user
 		goto Done;
 	}
 	
-	signatureRaw = base64_decode(signatureBase64);
+	verifyRequest.signature = base64_decode(signatureBase64);
 	
 	if ((appidArray = JsonGetObject(payload_root,"appId")) == NULL) {
 		errorText = "missing appId key";
@@ -3445,30 +3274,12 @@ bool ApplicationInstaller::cbRevoke(LSHandle* lshandle,LSMessage *msg,void *user
 		appIdGlob += appIdForIdx;
 	}
 	
-	//write the signature out to a temp file
-	if (writeToTempFile(signatureRaw,"/tmp/",signatureTmpFilename) == false) {
-		errorText = "couldn't create temp filename for signature";
-		goto Done;
-	}
-	
-	//write appid glob to a temp file
-	if (writeToTempFile(appIdGlob,"/tmp/",appIdGlobTmpFilename) == false) {
-		errorText = "couldn't create temp filename for appid glob";
-		goto Done;
-	}
-	
-	//extract the pubkey to a tempfile
-	//but first delete any old ones there
-	pubkeyTmpFilename = std::string("/tmp/pubsub_pubkey.pem");
-	unlink(pubkeyTmpFilename.c_str());
-	if (ApplicationInstaller::extractPublicKeyFromCert(s_revocationCertFile,pubkeyTmpFilename) <= 0) {
-		errorText = "key extraction from cert failed";
-		goto Done;
-	}
-				
-	//verify the signature
-	if (ApplicationInstaller::doSignatureVerifyOnFile(appIdGlobTmpFilename,signatureTmpFilename,pubkeyTmpFilename) <= 0) {
-		errorText = "verify failed";
+	//verify the signature of the appid glob against the key of the pubsub signing cert, both in memory
+	verifyRequest.data = appIdGlob;
+	verifyRequest.keyFile = s_revocationCertFile;
+	verifyRequest.keyFormat = SignatureVerifier::Certificate;
+	if (ApplicationInstaller::signatureVerifier()->verify(verifyRequest) <= 0) {
+		errorText = (verifyRequest.result < 0) ? "key extraction from cert failed" : "verify failed";
 		goto Done;
 	}
 	
@@ -3486,11 +3297,6 @@ Done:
 	if (item_root)
 		json_object_put(item_root);
 	
-	if (signatureTmpFilename.size())
-		deleteFile(signatureTmpFilename.c_str());
-	if (pubkeyTmpFilename.size())
-		deleteFile(pubkeyTmpFilename.c_str());
-	
 	std::string reply;
 	if (errorText.size()) {
 		reply = std::string("{ \"returnValue\":false , \"errorCode\":\"")+errorText+std::string("\"}");
@@ -3933,11 +3739,10 @@ bool ApplicationInstaller::isValidInstallURI(const std::string& url)
 
 void ApplicationInstaller::processOrQueueCommand(CommandParams* cmd)
 {
-    s_commandParams.push_back(cmd);
-	if (s_commandParams.size() == 1) {
-		// First command in queue. start executing
-		while (processNextCommand()) {}
-	}
+	m_commands.queue(cmd);
+
+	// starts it right away unless all slots are taken, or a command on the same package is still running
+	while (processNextCommand()) {}
 }
 
 // returns true if it should be called again
@@ -3948,16 +3753,13 @@ bool ApplicationInstaller::processNextCommand()
 	if (G_UNLIKELY(Settings::LunaSettings()->uiType == Settings::UI_MINIMAL))
 		return false;	
 	
-	if (s_commandParams.empty())
-		return false;
-
 	if (m_inBrickMode)
 		return false;
 
-	if (m_cmdState.processing)
+	CommandParams* cmd = m_commands.takeNext();
+	if (!cmd)
 		return false;
-	
-	CommandParams* cmd = s_commandParams.front();
+
 	bool ret;
 	
     switch (cmd->_type) {
@@ -3978,14 +3780,14 @@ bool ApplicationInstaller::processNextCommand()
 	}
 
 	if (ret) {
-		// Command started. don't call me again
-		return false;
+		// Command started. another slot may still be free
+		return true;
 	}
 
 	// Command failed
 	g_critical("%s:%d Command failed: %d", __PRETTY_FUNCTION__, __LINE__,
 			  cmd->_type);
-	s_commandParams.pop_front();
+	m_commands.finished(cmd);
 	delete cmd;
 	return true; // call me again
 }
@@ -4041,11 +3843,10 @@ bool ApplicationInstaller::processInstallCommand(InstallParams* params)
 							  params, NULL);
 		g_source_attach(params->_childStdOutSource, g_main_loop_get_context(HostBase::instance()->mainLoop()));
 
-		m_cmdState.processing = true;
-		m_cmdState.pid = childPid;
-		m_cmdState.sourceId = g_child_watch_add_full(G_PRIORITY_DEFAULT_IDLE, childPid,
+		params->_childPid = childPid;
+		params->_childWatch = g_child_watch_add_full(G_PRIORITY_DEFAULT_IDLE, childPid,
 													 util_ipkgInstallDone,
-													 params, NULL);		
+													 params, NULL);
 		return true;
 	}
 
@@ -4097,16 +3898,13 @@ bool ApplicationInstaller::processRemoveCommand(RemoveParams* removeParams)
 	return rc == REMOVER_RETURNC__SUCCESS;
 }
 
-void ApplicationInstaller::oneCommandProcessed()
+void ApplicationInstaller::oneCommandProcessed(CommandParams* cmd)
 {
-	luna_assert(!s_commandParams.empty());
+	luna_assert(!m_commands.isIdle());
 
-	CommandParams* cmd = s_commandParams.front();
-	s_commandParams.pop_front();
+	m_commands.finished(cmd);
 	delete cmd;
 
-	m_cmdState.reset();
-	
 	while (processNextCommand()) {}
 }
 
@@ -4126,14 +3924,18 @@ void ApplicationInstaller::enterBrickMode()
 	g_message("%s", __PRETTY_FUNCTION__);
 	m_inBrickMode = true;  
 	
-	if (m_cmdState.processing) {
+	// stop the running commands and put them back at the head of the queue, in the order they were started.
+	// a shallow remove has no child and finishes on its own
+	std::list<CommandParams*> running = m_commands.running();
+	for (std::list<CommandParams*>::reverse_iterator it = running.rbegin(); it != running.rend(); ++it) {
 
-		g_message("%s: Currently processing command. Stopping it",
-				  __PRETTY_FUNCTION__);
+		CommandParams* cmd = *it;
+		if (cmd->_childPid == -1)
+			continue;
 
-		luna_assert(!s_commandParams.empty());
+		g_message("%s: Currently processing command %d on %s. Stopping it",
+				  __PRETTY_FUNCTION__, cmd->_type, cmd->packageKey().c_str());
 
-		CommandParams* cmd = s_commandParams.front();
 		if (cmd->_childStdOutChannel) {
 			g_io_channel_unref(cmd->_childStdOutChannel);
 			cmd->_childStdOutChannel = 0;
@@ -4145,13 +3947,15 @@ void ApplicationInstaller::enterBrickMode()
 			cmd->_childStdOutSource = 0;			
 		}
 
-		g_source_remove(m_cmdState.sourceId);
-		
+		g_source_remove(cmd->_childWatch);
+		cmd->_childWatch = 0;
+
 		int status;
-		::kill(m_cmdState.pid, SIGKILL);		
-		::waitpid(m_cmdState.pid, &status, WNOHANG);
+		::kill(cmd->_childPid, SIGKILL);
+		::waitpid(cmd->_childPid, &status, WNOHANG);
+		cmd->_childPid = -1;
 
-		m_cmdState.reset();
+		m_commands.requeue(cmd);
 	}
 }
 
@@ -4165,17 +3969,13 @@ void ApplicationInstaller::exitBrickMode()
 
 	util_validateCryptofs();	
 
-	// This should not happen
-	if (m_cmdState.processing)
-		return;
-	
 	// Resume any pending install/remove commands
 	while (processNextCommand()) {}
 }
 
 bool ApplicationInstaller::allowSuspend()
 {
-	return !m_cmdState.processing;
+	return m_commands.isIdle();
 }
 
 json_object * ApplicationInstaller::packageInfoFileToJson(const std::string& packageId)
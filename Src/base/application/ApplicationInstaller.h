@@ -35,6 +35,7 @@
 #include <lunaservice.h>
 
 #include "MutexLocker.h"
+#include "InstallerCommandScheduler.h"
 
 #include <QObject>
 
@@ -42,6 +43,8 @@
 #include <sys/statvfs.h>
 
 class PackageDescription;
+class PackageSizeAccounting;
+class SignatureVerifier;
 
 // for debug only
 typedef int (*statfsfn)(const char *, struct statfs *);
@@ -58,7 +61,7 @@ public:
 	};
 
 	CommandParams(Type t) :
-		_type(t), _childStdOutChannel(0), _childStdOutSource(0) {
+		_type(t), _childStdOutChannel(0), _childStdOutSource(0), _childPid(-1), _childWatch(0) {
 	}
 	
 	virtual ~CommandParams() {
@@ -71,9 +74,14 @@ public:
 		}
 	}
 
+	// the package the command works on; commands on the same package never run at the same time
+	virtual std::string packageKey() const = 0;
+
 	Type _type;
 	GIOChannel* _childStdOutChannel;
 	GSource* _childStdOutSource;
+	GPid _childPid;			// the ApplicationInstallerUtility or ipkg child, while it runs
+	guint _childWatch;
 };
 
 class InstallParams : public CommandParams {
@@ -81,6 +89,15 @@ public:
 	InstallParams(const std::string& target, const std::string& id, const unsigned long ticket, LSHandle * lshandle,const LSMessage * msg,const unsigned int uncompressedSizeInKB, bool verify = true, bool systemMode = false)
 		: CommandParams(CommandParams::Install), _target(target) , _id(id), ticketId(ticket) , _lshandle(lshandle) , _msg(msg) , _verify(verify), _sysMode(systemMode), _uncompressedSizeInKB(uncompressedSizeInKB)
 	{ }
+
+	// installs queued without an id are keyed by the package name in the file name (<id>_<version>_<arch>.ipk)
+	std::string packageKey() const {
+		if (!_id.empty())
+			return _id;
+		std::string name = _target.substr(_target.find_last_of('/') + 1);
+		return name.substr(0, name.find('_'));
+	}
+
 	const std::string _target;
 	const std::string _id;
 	const unsigned long ticketId;
@@ -97,6 +114,9 @@ public:
 	RemoveParams(const std::string& packageName,const unsigned long ticket,LSHandle * lshandle,const LSMessage * msg,int cause) 
 		: CommandParams(CommandParams::Remove), _packageName(packageName) , ticketId(ticket) , _lshandle(lshandle) , _msg(msg)  , _cause(cause)
 	{}
+
+	std::string packageKey() const { return _packageName; }
+
 	const std::string _packageName;
 	const unsigned long ticketId;
 	const LSHandle * _lshandle;
@@ -142,24 +162,20 @@ public:
 
 	bool downloadAndInstall (LSHandle* handle, const std::string& targetPackageFile, struct json_object* authToken, struct json_object* deviceId,
 			unsigned long ticket, bool subscribe);
-	void oneCommandProcessed();
+	void oneCommandProcessed(CommandParams* cmd);
 
 	static uint64_t getSizeOfAppDir(const std::string& dirName);
 	
-	static Mutex		s_sizeFnMutex;
-	static uint64_t		s_sizeFnAccumulator;
-	static uint64_t		s_auxSizeFnAccumulator;
-	static uint64_t		s_targetFsBlockSize;
-	static std::string  s_sizeFnBaseDir;
-	static json_object * s_manifestJobj;
+	static PackageSizeAccounting* sizeAccounting();
+	static SignatureVerifier* signatureVerifier();
 	
-	static int _getSizeCbFn(const char *fpath, const struct stat *sb,int typeflag, struct FTW *ftwbuf);
-	static int _getSizeOfAppCbFn(const char *fpath, const struct stat *sb,int typeflag, struct FTW *ftwbuf);
-	
-//	static uint64_t getSizeOfAppDir_opt(const std::string& dirName);
 	static uint64_t getSizeOfAppOnFs(const std::string& destFsPath,const std::string& dirName,uint32_t * r_pBsize=NULL);
 	static uint64_t getSizeOfPackageOnFsGenerateManifest(const std::string& destFsPath, PackageDescription* packageDesc, uint32_t * r_pBsize);
+	// like the above, but reuses the last measurement (or manifest) if nothing in the package changed since
+	static uint64_t getSizeOfPackage(PackageDescription* packageDesc, uint32_t * r_pBsize);
 	static uint64_t getSizeOfPackageById(const std::string& packageId);
+	// sizes of many packages in one pass; unknown packages are 0
+	static void getSizesOfPackagesById(const std::vector<std::string>& packageIds, std::vector<uint64_t>& r_sizes);
 
 	static uint64_t getFsFreeSpaceInMB(const std::string& pathOnFs);
 	static uint64_t getFsFreeSpaceInBlocks(const std::string& pathOnFs,uint64_t * pBlockSize = 0);
@@ -221,29 +237,12 @@ private:
 	static int doSignatureVerifyOnFile(const std::string& file,const std::string& signatureFile,const std::string& pubkeyFile);
 	static int doSignatureVerifyOnFiles(std::vector<std::string>& files,const std::string& signatureFile,const std::string& pubkeyFile);
 	static int extractPublicKeyFromCert(const std::string& certFile,const std::string& pubkeyFile);
-	static int runOpenSSL(std::vector<std::string>& params,const std::string& command);
 	static int runIpkgRemove(const std::string& ipkgRoot,const std::string& packageName);
 	
-	static std::list<CommandParams*> s_commandParams;
 	bool m_inBrickMode;
 
-	struct CommandState {
-		CommandState() {
-			reset();
-		}
-		
-		void reset() {
-			processing = false;
-			sourceId = 0;
-			pid = -1;
-		}
-			
-		bool processing;
-		guint sourceId;
-		GPid pid;		
-	};
-
-	CommandState m_cmdState;
+	// queued and running install/remove commands; [ApplicationInstaller] MaxConcurrentCommands in luna.conf of them run at once
+	InstallerCommandScheduler<CommandParams> m_commands;
 	
 	//------------------------------------------------ DEBUG -----------------------------------------------------------
 	
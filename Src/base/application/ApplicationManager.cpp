@@ -22,6 +22,12 @@
 
 #include "ApplicationManager.h"
 #include "ApplicationDescription.h"
+#include "ApplicationScanner.h"
+#include "ApplicationChangeJournal.h"
+#include "LaunchPointSearchIndex.h"
+#include "ListResponseCache.h"
+#include "LaunchPointChangeBatcher.h"
+#include "LogFilter.h"
 #include "ApplicationStatus.h"
 #include "PackageDescription.h"
 #include "ServiceDescription.h"
@@ -34,6 +40,7 @@
 #include "SystemService.h"
 #include "HostBase.h"
 #include "Utils.h"
+#include "Time.h"
 
 #include "ApplicationInstaller.h"
 #include "EventReporter.h"
@@ -77,7 +84,7 @@
 
 #include <QProcess>
 
-static const char* sAppMgrChnl = "ApplicationManager";
+static LogChannel* sAppMgrChnl = logChannel("ApplicationManager");
 
 static const char* sServiceInstallerTypeService = "services";
 static const char* sServiceInstallerTypeApplication = "applications";
@@ -89,9 +96,13 @@ Mutex ApplicationManager::s_mutexExecLockFunctions;
 
 static std::string rot13( const char* s );
 static bool hardwareFeaturesRequirementSatisfied(uint32_t hardwareFeaturesNeeded);
+static bool isSearchable(const LaunchPoint* lp);
 
 unsigned long ApplicationManager::s_ticketGenerator = 1;
 
+// installer progress of an app is signalled at most this often
+static const unsigned int s_launchPointProgressIntervalMs = 500;
+
 ApplicationManager* ApplicationManager::instance()
 {
 	MutexLocker m(&s_mutexExecLockFunctions);		//WARNING: currently the s_instance variable and the exec-lock stuff are the only things that need sync-ing, but
@@ -110,12 +121,22 @@ ApplicationManager::ApplicationManager()
 	m_serviceHandlePublic = 0;
 	m_serviceHandlePrivate = 0;
 	m_initialScan = true;
+	m_scanner = 0;
+	m_changeJournal = 0;
+	m_generation = ListResponseCache::initialGeneration();
+	m_launchPointChanges = new LaunchPointChangeBatcher(s_launchPointProgressIntervalMs);
+	m_launchPointFlushSource = 0;
+	m_launchPointFlushDue = 0;
+	m_registeredIndex.enableSearch();
 
 	////hmmm, maybe better to load these in init()? need to consider race based on request-before-init...
-	if (doesExistOnFilesystem(Settings::LunaSettings()->lunaCmdHandlerSavedPath.c_str()))
-		MimeSystem::instance(Settings::LunaSettings()->lunaCmdHandlerSavedPath);
-	else
-		MimeSystem::instance(Settings::LunaSettings()->lunaCmdHandlerPath);
+	std::string mimeTableErr;
+	if (!MimeSystem::instance()->restoreMimeTableFromStore(mimeTableErr)) {
+		if (doesExistOnFilesystem(Settings::LunaSettings()->lunaCmdHandlerSavedPath.c_str()))		//json active copy, saved before there was a store
+			MimeSystem::instance(Settings::LunaSettings()->lunaCmdHandlerSavedPath);
+		else
+			MimeSystem::instance(Settings::LunaSettings()->lunaCmdHandlerPath);
+	}
 
 	startService();
 }
@@ -124,6 +145,12 @@ ApplicationManager::~ApplicationManager()
 {
 	clear();
 	stopService();
+	delete m_changeJournal;
+	for (std::map<std::string, ListResponseCache*>::iterator it = m_responseCaches.begin(); it != m_responseCaches.end(); ++it)
+		delete it->second;
+	if (m_launchPointFlushSource)
+		g_source_remove(m_launchPointFlushSource);
+	delete m_launchPointChanges;
 	s_instance = 0;
 }
 
@@ -137,6 +164,7 @@ void ApplicationManager::clear()
 	}
 
 	m_registeredApps.clear();
+	m_registeredIndex.clear();
 	m_initialScan = true;
 
 	for (unsigned int i=0; i < m_systemApps.size(); ++i) {
@@ -144,9 +172,11 @@ void ApplicationManager::clear()
 	}
 
 	m_systemApps.clear();
+	m_systemIndex.clear();
 }
 
 static const char* s_hiddenAppsPath = "/var/luna/data/.hidden-apps.json";
+static const char* s_appScanCachePath = "/var/luna/data/.appinfo-cache.json";
 
 bool ApplicationManager::init(  )
 {
@@ -168,6 +198,9 @@ bool ApplicationManager::init(  )
 
 	loadHiddenApps();
 
+	// start journaling folder changes before the initial scan, so that nothing slips in between the two
+	startChangeJournal();
+
 	// scan for applications.
 	m_initialScan = true;
 	Q_EMIT signalInitialScanStart();
@@ -178,6 +211,31 @@ bool ApplicationManager::init(  )
 	return true;
 }
 
+void ApplicationManager::startChangeJournal()
+{
+	if (m_changeJournal)
+		return;
+
+	m_changeJournal = new ApplicationChangeJournal();
+	if (!m_changeJournal->start(g_main_loop_get_context(HostBase::instance()->mainLoop()))) {
+		g_warning("%s: no change journal; rescans will walk all application folders", __FUNCTION__);
+		delete m_changeJournal;
+		m_changeJournal = 0;
+		return;
+	}
+
+	std::vector<std::string>::const_iterator appFolderIter = Settings::LunaSettings()->lunaAppsPaths.begin();
+	for (; appFolderIter != Settings::LunaSettings()->lunaAppsPaths.end(); ++appFolderIter) {
+		if (appFolderIter->size())
+			m_changeJournal->addRoot(ApplicationChangeJournal::Kind_Application, *appFolderIter);
+	}
+
+	m_changeJournal->addRoot(ApplicationChangeJournal::Kind_Package, Settings::LunaSettings()->packageInstallBase + std::string("/")
+							 + Settings::LunaSettings()->packageInstallRelative);
+	m_changeJournal->addRoot(ApplicationChangeJournal::Kind_Service, Settings::LunaSettings()->serviceInstallBase + std::string("/")
+							 + Settings::LunaSettings()->serviceInstallRelative);
+}
+
 void ApplicationManager::runAppInstallScripts()
 {
 	std::string cmd;
@@ -263,6 +321,7 @@ void ApplicationManager::hideApp(const std::string& appId)
 		return;		//already hidden
 
 	m_hiddenApps.insert(appId);
+	registryChanged();
 
 	json_object* apps = json_object_new_array();
 	if (apps == NULL)
@@ -317,19 +376,66 @@ void ApplicationManager::scan()
 {
 	MutexLocker locker(&m_mutex);
 
+	// appinfo.json files are read and parsed up front (in parallel, and only if they changed since the
+	// last scan) by the scanner; the app descriptors are still built here, in the usual order
+	ApplicationScanner scanner(s_appScanCachePath, LocalePreferences::instance()->locale());
+	m_scanner = &scanner;
+
+	m_scanStats = ScanStats();
+	m_scanStats.initial = m_initialScan;
+	uint32_t scanStart = Time::curTimeMs();
+
+	runScan();
+	registryChanged();
+
+	m_scanner = 0;
+
+	uint32_t phaseStart = Time::curTimeMs();
+	scanner.saveCache();
+	recordScanPhase("saveCache", phaseStart);
+
+	m_scanStats.totalMs = Time::curTimeMs() - scanStart;
+	m_scanStats.cacheHits = scanner.cacheHits();
+	m_scanStats.cacheMisses = scanner.cacheMisses();
+	m_scanStats.filesParsed = scanner.filesParsed();
+	m_scanStats.workerThreads = scanner.workerThreads();
+
+	g_message("%s: %s scan took %u ms (appinfo cache: %u hits, %u misses, %u files parsed)", __FUNCTION__,
+			  m_scanStats.initial ? "initial" : "re-", m_scanStats.totalMs,
+			  m_scanStats.cacheHits, m_scanStats.cacheMisses, m_scanStats.filesParsed);
+}
+
+void ApplicationManager::recordScanPhase(const char* phase, uint32_t& phaseStart)
+{
+	uint32_t now = Time::curTimeMs();
+	m_scanStats.phases.push_back(std::make_pair(std::string(phase), now - phaseStart));
+	phaseStart = now;
+}
+
+void ApplicationManager::runScan()
+{
 	// FIXME: Need to launch boot time apps
 
+	uint32_t phaseStart = Time::curTimeMs();
+
 	if (m_initialScan) {
 		m_initialScan=false;				//TODO: reset this if scans fail
 		scanForSystemApplications();
+		recordScanPhase("systemApplications", phaseStart);
 		scanForApplications();
+		recordScanPhase("applications", phaseStart);
 		scanForPackages();
+		recordScanPhase("packages", phaseStart);
 		createPackageDescriptionForOldApps();
+		recordScanPhase("oldAppPackages", phaseStart);
 		scanForServices();
+		recordScanPhase("services", phaseStart);
 		scanForPendingApplications();
+		recordScanPhase("pendingApplications", phaseStart);
 
 		scanForLaunchPoints(Settings::LunaSettings()->lunaPresetLaunchPointsPath);
 		scanForLaunchPoints(Settings::LunaSettings()->lunaLaunchPointsPath);
+		recordScanPhase("launchPoints", phaseStart);
 		return;
 	}
 
@@ -339,7 +445,16 @@ void ApplicationManager::scan()
 	std::vector<ApplicationDescription *> changed;			//these pointers will point to things in m_registeredApps
 
 	ApplicationDescription * pAppDesc, *pRegAppDesc;
+
+	// taken before discoverAppChanges(), which resyncs the journal if it has to fall back to a full walk
+	std::set<std::string> changedPackageFolders, changedServiceFolders;
+	bool packagesTracked = m_changeJournal &&
+		m_changeJournal->takeChanges(ApplicationChangeJournal::Kind_Package, changedPackageFolders);
+	bool servicesTracked = m_changeJournal &&
+		m_changeJournal->takeChanges(ApplicationChangeJournal::Kind_Service, changedServiceFolders);
+
 	ApplicationManager::instance()->discoverAppChanges(added,removed,changed);
+	recordScanPhase("discoverAppChanges", phaseStart);
 
 	std::vector<ApplicationDescription *>::iterator it = added.begin();
 
@@ -385,6 +500,7 @@ void ApplicationManager::scan()
 
 		//now update the app descriptor for this app
 		pRegAppDesc->update(*pAppDesc);
+		m_registeredIndex.refreshApp(pRegAppDesc);
 		//and post a launchpoint update
 		postLaunchPointChange(pRegAppDesc->getDefaultLaunchPoint(), "updated");
 		// remove the update appdesc from our pending list
@@ -414,11 +530,13 @@ void ApplicationManager::scan()
 		pAppDesc = *it;
 		if (pAppDesc->isRemoveFlagged()) {
 			it = m_registeredApps.erase(it);
+			m_registeredIndex.removeApp(pAppDesc);
 			pAppDesc->launchPoints(launchPoints);
 			for (LaunchPointList::iterator lpit = launchPoints.begin();lpit != launchPoints.end();lpit++) {
 				const LaunchPoint *pLpoint = *lpit;
 				if (pLpoint->isDefault()) {
 					postLaunchPointChange(pLpoint, "removed");
+					unindexLaunchPoint(pLpoint);
 					pAppDesc->removeLaunchPoint(pLpoint);
 				}
 				else {
@@ -442,6 +560,7 @@ void ApplicationManager::scan()
 	while (it !=  added.end()) {
 		pAppDesc = *it;								//pAppDesc points to a NEW ApplicationDescriptor
 		m_registeredApps.push_back(pAppDesc);
+		m_registeredIndex.insertApp(pAppDesc);
 		const LaunchPoint *pLpoint = pAppDesc->getDefaultLaunchPoint();
 		if (pLpoint) {
 			postLaunchPointChange(pLpoint,"added");
@@ -453,6 +572,15 @@ void ApplicationManager::scan()
 		it++;
 	}
 
+	recordScanPhase("applyAppChanges", phaseStart);
+
+	//packages and services only get picked up here if the journal saw their folders change
+	if (packagesTracked)
+		rescanPackageFolders(changedPackageFolders);
+	if (servicesTracked)
+		rescanServiceFolders(changedServiceFolders);
+	recordScanPhase("packagesAndServices", phaseStart);
+
 	//force caches to clear
     // WebAppMgrProxy::instance()->clearWebkitCache();
 
@@ -469,10 +597,11 @@ void ApplicationManager::postInstallScan(const std::string& appId) {
 	ApplicationDescription* appDesc = installApp(appId);
 	PackageDescription* packageDesc = PackageDescription::fromApplicationDescription(appDesc);
 	if (packageDesc) {
-		m_registeredPackages[packageDesc->id()] = packageDesc;
+		registerPackage(packageDesc);
 	}
 
 	createOrUpdatePackageManifest(packageDesc);
+	registryChanged();
 
 	serviceInstallerInstallApp(appId, sServiceInstallerTypeApplication, Settings::LunaSettings()->appInstallBase);
 
@@ -492,7 +621,10 @@ void ApplicationManager::postInstallScan(json_object * pPackageInfoJson, const s
 	if (!packageDesc)
 		return;
 
-	m_registeredPackages[packageDesc->id()] = packageDesc;
+	if (m_changeJournal)
+		m_changeJournal->markClean(ApplicationChangeJournal::Kind_Package, packageFolder);
+
+	registerPackage(packageDesc);
 
 	std::vector<std::string>::const_iterator appIdIt, appIdItEnd;
 	for (appIdIt = packageDesc->appIds().begin(), appIdItEnd = packageDesc->appIds().end(); appIdIt != appIdItEnd; ++appIdIt) {
@@ -510,6 +642,8 @@ void ApplicationManager::postInstallScan(json_object * pPackageInfoJson, const s
 		std::string servicePathFull = Settings::LunaSettings()->serviceInstallBase + std::string("/")
 				+ Settings::LunaSettings()->serviceInstallRelative + std::string("/") + *serviceIdIt;
 		ServiceDescription* serviceDesc = scanOneServiceFolder(servicePathFull);
+		if (m_changeJournal)
+			m_changeJournal->markClean(ApplicationChangeJournal::Kind_Service, servicePathFull);
 		if (serviceDesc) {
 			m_registeredServices[serviceDesc->id()] = serviceDesc;
 			serviceInstallerInstallApp(*serviceIdIt, sServiceInstallerTypeService, Settings::LunaSettings()->appInstallBase);
@@ -517,6 +651,7 @@ void ApplicationManager::postInstallScan(json_object * pPackageInfoJson, const s
 	}
 
 	createOrUpdatePackageManifest(packageDesc);
+	registryChanged();
 
 	//force caches to clear
     // WebAppMgrProxy::instance()->clearWebkitCache();
@@ -568,6 +703,7 @@ ApplicationDescription* ApplicationManager::installSysApp(const std::string& app
 	// newly installed app
 	g_message("(A)\t%s", pAppDesc->id().c_str());
 	m_registeredApps.push_back(pAppDesc);
+	m_registeredIndex.insertApp(pAppDesc);
 	const LaunchPoint *pLpoint = pAppDesc->getDefaultLaunchPoint();
 	if (pLpoint)
 	{
@@ -588,6 +724,8 @@ ApplicationDescription* ApplicationManager::installApp(const std::string& appId)
 			+ Settings::LunaSettings()->appInstallRelative + std::string("/") + appId;
 	ApplicationDescription* existingAppDesc = getAppById(appId);
 	ApplicationDescription* newAppDesc = scanOneApplicationFolder(appPathFull);
+	if (m_changeJournal)
+		m_changeJournal->markClean(ApplicationChangeJournal::Kind_Application, appPathFull);
 	if (!newAppDesc) {
 		g_warning("Failed to scan newly installed/updated app: %s, which was supposed to be in [%s]", appId.c_str(),appPathFull.c_str());
 		return NULL;
@@ -607,6 +745,7 @@ ApplicationDescription* ApplicationManager::installApp(const std::string& appId)
 			disableDockModeLaunchPoint(existingAppDesc->id().c_str());
 		}
 		existingAppDesc->update(*newAppDesc);
+		m_registeredIndex.refreshApp(existingAppDesc);
 		g_message("%s: updated app descriptor: new value: %s",__FUNCTION__,existingAppDesc->toString().c_str());
 
 		//and post a launchpoint update
@@ -627,6 +766,7 @@ ApplicationDescription* ApplicationManager::installApp(const std::string& appId)
 		g_message("(A)\t%s", newAppDesc->id().c_str());
 		EventReporter::instance()->report("install", newAppDesc->id().c_str());
 		m_registeredApps.push_back(newAppDesc);
+		m_registeredIndex.insertApp(newAppDesc);
 		const LaunchPoint *pLpoint = newAppDesc->getDefaultLaunchPoint();
 		if (pLpoint) {
 			postLaunchPointChange(pLpoint, "added");
@@ -652,59 +792,12 @@ void ApplicationManager::createOrUpdatePackageManifest(PackageDescription* packa
 	// check the size of the package
 	if (Settings::LunaSettings()->scanCalculatesAppSizes && !isSystemApp) {
 		g_debug("%s: [SIZE-SCAN] [MANIFESTS]: Calculating package size for [%s]", __PRETTY_FUNCTION__, packageDesc->id().c_str());
-		uint64_t fsbsize;
-		std::string packageFolderPath = packageDesc->folderPath();
-		(void)ApplicationInstaller::getFsFreeSpaceInBlocks(packageFolderPath, &fsbsize); //I don't expect this to EVER fail if the folderPath is correct
-																								 //(which means the rest of the scan before ths is not corrupted)
-		// check to see if the manifest file exists
-		std::string manifestFilePath = Settings::LunaSettings()->packageManifestsPath + std::string("/") + packageDesc->id() + std::string(".pmmanifest");
-		json_object * manifestJobj = json_object_from_file((char *)manifestFilePath.c_str());
-		if ((manifestJobj == 0) || (is_error(manifestJobj))) {
-			// didn't find the manifest...generate it!
-			g_debug("%s: [MANIFESTS]: manifest for %s not found, generating",__PRETTY_FUNCTION__, packageDesc->id().c_str());
-			packageDesc->setPackageSize(ApplicationInstaller::getSizeOfPackageOnFsGenerateManifest("", packageDesc, NULL));
-		} else {
-			// Found the manifest, but check to see if the version of the package was updated...if it was, then regenerate manifest.
-			// otherwise, just grab the total size from the manifest...providing the current installed fs blocksize's corresponding size is in the manifest. If not, regenerate!
-			std::string manifestVersion;
-			std::string installerVersion;
-			extractFromJson(manifestJobj,"version",manifestVersion);
-			extractFromJson(manifestJobj,"installer",installerVersion);
-
-			if ((manifestVersion != packageDesc->version()) || (installerVersion != ApplicationInstaller::s_installer_version)) {
-				// regen manifest
-				g_debug("%s: [MANIFESTS]: manifest for %s is for version [%s],[%s] and package and installer are at version [%s],[%s],  re-generating",
-							__PRETTY_FUNCTION__,
-							packageDesc->id().c_str(),
-							manifestVersion.c_str(),
-							installerVersion.c_str(),
-							packageDesc->version().c_str(),
-							ApplicationInstaller::s_installer_version.c_str());
-				packageDesc->setPackageSize(ApplicationInstaller::getSizeOfPackageOnFsGenerateManifest("", packageDesc, NULL));
-			} else {
-				json_object * totalSizesJobj = JsonGetObject(manifestJobj,"totals");
-				if (totalSizesJobj == NULL) {
-					// totals not found...manifest needs to be regen-d
-					g_debug("%s: [MANIFESTS]: manifest for %s missing size totals table, re-generating", __PRETTY_FUNCTION__, packageDesc->id().c_str());
-					packageDesc->setPackageSize(ApplicationInstaller::getSizeOfPackageOnFsGenerateManifest("", packageDesc, NULL));
-				} else {
-					std::string bsizeStr = toSTLString<uint64_t>(fsbsize);
-					std::string packageSizeStr;
-					if (extractFromJson(totalSizesJobj, bsizeStr.c_str(), packageSizeStr) == false) {
-						// totals not found...manifest needs to be regen-d
-						g_debug("%s: [MANIFESTS]: manifest for %s missing size total for blocksize = %s, re-generating", __PRETTY_FUNCTION__, packageDesc->id().c_str(), bsizeStr.c_str());
-						packageDesc->setPackageSize(ApplicationInstaller::getSizeOfPackageOnFsGenerateManifest("", packageDesc, NULL));
-					} else {
-						// set the size that's found
-						uint64_t packageSize = strtouq(packageSizeStr.c_str(), NULL, 10);
-						g_debug("%s: [MANIFESTS]: manifest for %s blocksize = %s found total size = %llu...setting on package desc",__PRETTY_FUNCTION__, packageDesc->id().c_str(), bsizeStr.c_str(), packageSize);
-						packageDesc->setPackageSize(packageSize);
-					}
-				}
-			} //end else = manifest is for the correct version
-			json_object_put(manifestJobj);
-		}	//end else = found manifest
-		packageDesc->setBlockSize((uint32_t)fsbsize);	//should be an ok cast, because if bsize is ever > 2^32 -1 , we have issues!!!!
+		// the size comes from the package's manifest, or from its last measurement, unless the version changed or
+		// something in its folders did; then it is measured again and the manifest rewritten
+		uint32_t fsbsize = 0;
+		packageDesc->setPackageSize(ApplicationInstaller::getSizeOfPackage(packageDesc, &fsbsize));
+		packageDesc->setBlockSize(fsbsize);
+		ApplicationManager::instance()->registryChanged();
 
 		g_debug("%s: [SIZES]: size of [%s] is %llu",__PRETTY_FUNCTION__, packageDesc->id().c_str(), packageDesc->packageSize());
 	}
@@ -845,43 +938,25 @@ ApplicationDescription* ApplicationManager::getAppById( const std::string& appId
 {
 	MutexLocker locker(&m_mutex);
 
-	for( std::vector<ApplicationDescription*>::iterator it=m_registeredApps.begin();
-	it != m_registeredApps.end(); ++it )
-	{
-		ApplicationDescription* app = *it;
-		if( app->id() == appId )
-			return app;
-	}
+	ApplicationDescription* app = m_registeredIndex.appById(appId);
+	if (app)
+		return app;
 
-	for( std::vector<ApplicationDescription*>::iterator it=m_systemApps.begin();
-	it != m_systemApps.end(); ++it )
-	{
-		ApplicationDescription* app = *it;
-		if (app->id() == appId )
-			return app;
-	}
-	return 0;
+	return m_systemIndex.appById(appId);
 }
 
 ApplicationDescription* ApplicationManager::getAppByIdHardwareCompatibleAppsOnly( const std::string& appId )
 {
 	MutexLocker locker(&m_mutex);
 
-	for( std::vector<ApplicationDescription*>::iterator it=m_registeredApps.begin();
-	it != m_registeredApps.end(); ++it )
-	{
-		ApplicationDescription* app = *it;
-		if ((app->id() == appId) && (hardwareFeaturesRequirementSatisfied(app->hardwareFeaturesNeeded())))
-			return app;
-	}
+	ApplicationDescription* app = m_registeredIndex.appById(appId);
+	if (app && hardwareFeaturesRequirementSatisfied(app->hardwareFeaturesNeeded()))
+		return app;
+
+	app = m_systemIndex.appById(appId);
+	if (app && hardwareFeaturesRequirementSatisfied(app->hardwareFeaturesNeeded()))
+		return app;
 
-	for( std::vector<ApplicationDescription*>::iterator it=m_systemApps.begin();
-	it != m_systemApps.end(); ++it )
-	{
-		ApplicationDescription* app = *it;
-		if ((app->id() == appId) && (hardwareFeaturesRequirementSatisfied(app->hardwareFeaturesNeeded())))
-			return app;
-	}
 	return 0;
 }
 
@@ -917,6 +992,7 @@ bool ApplicationManager::enableDockModeLaunchPoint (const char* appId)
 		ApplicationDescription* appDesc = getAppById(appId);
 		if (appDesc) {
 			m_dockModeLaunchPoints.insert(appDesc->getDefaultLaunchPoint());
+			registryChanged();
 			Q_EMIT signalDockModeLaunchPointEnabled (appDesc->getDefaultLaunchPoint());
 			return true;
 		}
@@ -934,6 +1010,7 @@ bool ApplicationManager::disableDockModeLaunchPoint (const char* appId)
 		if (appDesc) {
 			Q_EMIT signalDockModeLaunchPointDisabled (appDesc->getDefaultLaunchPoint());
 			m_dockModeLaunchPoints.erase(appDesc->getDefaultLaunchPoint());
+			registryChanged();
 		}
 	}
 	return false;
@@ -944,14 +1021,7 @@ ApplicationDescription* ApplicationManager::getPendingAppById(const std::string&
 {
 	MutexLocker locker(&m_mutex);
 
-	std::vector<ApplicationDescription*>::iterator it, itEnd;
-	for (it=m_pendingApps.begin(), itEnd = m_pendingApps.end(); it != itEnd; ++it)
-	{
-		ApplicationDescription* app = *it;
-		if( app->id() == appId )
-			return app;
-	}
-	return 0;
+	return m_pendingIndex.appById(appId);
 }
 
 bool ApplicationManager::getAppsByPackageId(const std::string& packageId, std::vector<ApplicationDescription *>& r_apps)
@@ -990,32 +1060,12 @@ bool ApplicationManager::getServicesByPackageId(const std::string& packageId, st
 
 PackageDescription* ApplicationManager::getPackageInfoByAppId(const std::string& anyAppIdInPackage)
 {
-    for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
-		PackageDescription* packageDesc = (*it).second;
-		std::vector<std::string> appIds = packageDesc->appIds();
-		std::vector<std::string>::const_iterator appIdIt, appIdItEnd;
-		for (appIdIt = appIds.begin(), appIdItEnd = appIds.end(); appIdIt != appIdItEnd; ++appIdIt) {
-			if (anyAppIdInPackage == *appIdIt) {
-				return packageDesc;
-			}
-		}
-    }
-	return NULL;
+	return m_registeredIndex.packageByAppId(anyAppIdInPackage);
 }
 
 PackageDescription* ApplicationManager::getPackageInfoByServiceId(const std::string& anyServiceIdInPackage)
 {
-    for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
-		PackageDescription* packageDesc = (*it).second;
-		std::vector<std::string> serviceIds = packageDesc->serviceIds();
-		std::vector<std::string>::const_iterator serviceIdIt, serviceIdItEnd;
-		for (serviceIdIt = serviceIds.begin(), serviceIdItEnd = serviceIds.end(); serviceIdIt != serviceIdItEnd; ++serviceIdIt) {
-			if (anyServiceIdInPackage == *serviceIdIt) {
-				return packageDesc;
-			}
-		}
-    }
-	return NULL;
+	return m_registeredIndex.packageByServiceId(anyServiceIdInPackage);
 }
 
 PackageDescription* ApplicationManager::getPackageInfoByPackageId(const std::string& packageId)
@@ -1045,6 +1095,38 @@ ApplicationDescription* ApplicationManager::getAppById( const std::string& appId
 	return 0;
 }
 
+///BE SURE TO EXTERNALLY LOCK APPLIST IF NEEDED!!!
+void ApplicationManager::registerPackage(PackageDescription* packageDesc)
+{
+	std::map<std::string, PackageDescription*>::iterator find_it = m_registeredPackages.find(packageDesc->id());
+	if (find_it != m_registeredPackages.end())
+		m_registeredIndex.removePackage(find_it->second);
+
+	m_registeredPackages[packageDesc->id()] = packageDesc;
+	m_registeredIndex.insertPackage(packageDesc);
+	registryChanged();
+}
+
+///BE SURE TO EXTERNALLY LOCK APPLIST IF NEEDED!!!
+void ApplicationManager::indexLaunchPoint(const LaunchPoint* lp)
+{
+	ApplicationDescription* appDesc = lp->appDesc();
+	if (m_registeredIndex.containsApp(appDesc))
+		m_registeredIndex.insertLaunchPoint(lp);
+	else if (m_systemIndex.containsApp(appDesc))
+		m_systemIndex.insertLaunchPoint(lp);
+	else if (m_pendingIndex.containsApp(appDesc))
+		m_pendingIndex.insertLaunchPoint(lp);
+}
+
+///BE SURE TO EXTERNALLY LOCK APPLIST IF NEEDED!!!
+void ApplicationManager::unindexLaunchPoint(const LaunchPoint* lp)
+{
+	m_registeredIndex.removeLaunchPoint(lp);
+	m_systemIndex.removeLaunchPoint(lp);
+	m_pendingIndex.removeLaunchPoint(lp);
+}
+
 const LaunchPoint* ApplicationManager::getLaunchPointByIdHardwareCompatibleAppsOnly(const std::string& launchPointId)
 {
 	if (launchPointId.empty())
@@ -1052,47 +1134,21 @@ const LaunchPoint* ApplicationManager::getLaunchPointByIdHardwareCompatibleAppsO
 
 	MutexLocker locker(&m_mutex);
 
-	std::vector<ApplicationDescription*>::const_iterator it, itEnd;
-	for (it = m_registeredApps.begin(), itEnd = m_registeredApps.end(); it != itEnd; ++it)
-	{
-		ApplicationDescription* appDesc = *it;
-		if (appDesc == NULL)
-			continue;	//BAD
-		if (!(hardwareFeaturesRequirementSatisfied(appDesc->hardwareFeaturesNeeded())))
-			continue;
-
-		for (LaunchPointList::const_iterator iter = appDesc->launchPoints().begin();
-				iter != appDesc->launchPoints().end(); ++iter) {
-
-			const LaunchPoint* lp = *iter;
-			if (launchPointId == lp->launchPointId()) {
-				// always include pending versions
-				if (lp->isDefault()) {
-					ApplicationDescription* pending = getPendingAppById(lp->appDesc()->id());
-					if (pending) {
-						lp = pending->getDefaultLaunchPoint();
-					}
-				}
-				return lp;
+	const LaunchPoint* lp = m_registeredIndex.launchPointById(launchPointId);
+	if (lp && lp->appDesc() && hardwareFeaturesRequirementSatisfied(lp->appDesc()->hardwareFeaturesNeeded())) {
+		// always include pending versions
+		if (lp->isDefault()) {
+			ApplicationDescription* pending = m_pendingIndex.appById(lp->appDesc()->id());
+			if (pending) {
+				lp = pending->getDefaultLaunchPoint();
 			}
 		}
+		return lp;
 	}
 
-	for (it = m_pendingApps.begin(), itEnd = m_pendingApps.end(); it != itEnd; ++it)
-	{
-		ApplicationDescription* appDesc = *it;
-		if (appDesc == NULL)
-			continue;	//BAD
-		if (!(hardwareFeaturesRequirementSatisfied(appDesc->hardwareFeaturesNeeded())))
-			continue;
-		for (LaunchPointList::const_iterator iter = appDesc->launchPoints().begin();
-				iter != appDesc->launchPoints().end(); ++iter) {
-
-			const LaunchPoint* lp = *iter;
-			if (launchPointId == lp->launchPointId())
-				return lp;
-		}
-	}
+	lp = m_pendingIndex.launchPointById(launchPointId);
+	if (lp && lp->appDesc() && hardwareFeaturesRequirementSatisfied(lp->appDesc()->hardwareFeaturesNeeded()))
+		return lp;
 
 	return 0;
 }
@@ -1104,42 +1160,19 @@ const LaunchPoint* ApplicationManager::getLaunchPointById(const std::string& lau
 
 	MutexLocker locker(&m_mutex);
 
-	std::vector<ApplicationDescription*>::const_iterator it, itEnd;
-	for (it = m_registeredApps.begin(), itEnd = m_registeredApps.end(); it != itEnd; ++it)
-	{
-		ApplicationDescription* appDesc = *it;
-
-		for (LaunchPointList::const_iterator iter = appDesc->launchPoints().begin();
-		iter != appDesc->launchPoints().end(); ++iter) {
-
-			const LaunchPoint* lp = *iter;
-			if (launchPointId == lp->launchPointId()) {
-				// always include pending versions
-				if (lp->isDefault()) {
-					ApplicationDescription* pending = getPendingAppById(lp->appDesc()->id());
-					if (pending) {
-						lp = pending->getDefaultLaunchPoint();
-					}
-				}
-				return lp;
+	const LaunchPoint* lp = m_registeredIndex.launchPointById(launchPointId);
+	if (lp) {
+		// always include pending versions
+		if (lp->isDefault()) {
+			ApplicationDescription* pending = m_pendingIndex.appById(lp->appDesc()->id());
+			if (pending) {
+				lp = pending->getDefaultLaunchPoint();
 			}
 		}
+		return lp;
 	}
 
-	for (it = m_pendingApps.begin(), itEnd = m_pendingApps.end(); it != itEnd; ++it)
-	{
-		ApplicationDescription* appDesc = *it;
-
-		for (LaunchPointList::const_iterator iter = appDesc->launchPoints().begin();
-		iter != appDesc->launchPoints().end(); ++iter) {
-
-			const LaunchPoint* lp = *iter;
-			if (launchPointId == lp->launchPointId())
-				return lp;
-		}
-	}
-
-	return 0;
+	return m_pendingIndex.launchPointById(launchPointId);
 }
 
 void ApplicationManager::scanForApplications()
@@ -1157,7 +1190,7 @@ void ApplicationManager::scanForApplications()
 			if (appFolder[appFolder.size() - 1] != '/')
 				appFolder += "/";
 
-			luna_log(sAppMgrChnl, "scanning apps from %s", appFolder.c_str());
+			channel_log(sAppMgrChnl, "scanning apps from %s", appFolder.c_str());
 			scanApplicationsFolders(appFolder);
 		}
 		appFolderIter++;
@@ -1187,7 +1220,7 @@ void ApplicationManager::scanForPackages()
 				if (::stat(onePackageFolderPath.c_str(), &stBuf) == 0 && stBuf.st_mode & S_IFDIR) {
 					PackageDescription* packageDesc = scanOnePackageFolder(onePackageFolderPath);
 					if (packageDesc) {
-						m_registeredPackages[packageDesc->id()] = packageDesc;
+						registerPackage(packageDesc);
 						if (packageDesc->accountIds().size() > 0) {
 							std::vector<ApplicationDescription*> apps;
 							getAppsByPackageId(packageDesc->id(), apps);
@@ -1204,10 +1237,12 @@ void ApplicationManager::scanForPackages()
 		}
 	}
 
-	g_message("%s(%s): the new-style packages are now: ", __PRETTY_FUNCTION__, packagesFolder.c_str());
-    for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
-		PackageDescription* packageDesc = (*it).second;
-		g_message("\t%s", packageDesc->id().c_str());
+	if (logLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+		g_message("%s(%s): the new-style packages are now: ", __PRETTY_FUNCTION__, packagesFolder.c_str());
+		for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
+			PackageDescription* packageDesc = (*it).second;
+			g_message("\t%s", packageDesc->id().c_str());
+		}
 	}
 
 	if (list)
@@ -1222,16 +1257,18 @@ void ApplicationManager::createPackageDescriptionForOldApps()
 			// This app did not have a packageinfo under /packages. We therefore need to create the PackageDescription for it
 			PackageDescription* packageDesc = PackageDescription::fromApplicationDescription(appDesc);
 			if (packageDesc) {
-				m_registeredPackages[packageDesc->id()] = packageDesc;
+				registerPackage(packageDesc);
 				createOrUpdatePackageManifest(packageDesc);
 			}
 		}
 	}
 
-	g_message("%s: the packages are now: ", __PRETTY_FUNCTION__);
-    for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
-		PackageDescription* packageDesc = (*it).second;
-		g_message("\t%s", packageDesc->id().c_str());
+	if (logLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+		g_message("%s: the packages are now: ", __PRETTY_FUNCTION__);
+		for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
+			PackageDescription* packageDesc = (*it).second;
+			g_message("\t%s", packageDesc->id().c_str());
+		}
 	}
 }
 
@@ -1265,11 +1302,13 @@ void ApplicationManager::scanForServices()
 		}
 	}
 
-	g_message("%s(%s): the services are now: ", __PRETTY_FUNCTION__, servicesFolder.c_str());
+	if (logLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+		g_message("%s(%s): the services are now: ", __PRETTY_FUNCTION__, servicesFolder.c_str());
 
-    for (std::map<std::string, ServiceDescription*>::const_iterator it = m_registeredServices.begin(); it != m_registeredServices.end(); ++it) {
-		ServiceDescription* serviceDesc = (*it).second;
-		g_message("\t%s", serviceDesc->id().c_str());
+		for (std::map<std::string, ServiceDescription*>::const_iterator it = m_registeredServices.begin(); it != m_registeredServices.end(); ++it) {
+			ServiceDescription* serviceDesc = (*it).second;
+			g_message("\t%s", serviceDesc->id().c_str());
+		}
 	}
 
 	if (list)
@@ -1296,6 +1335,9 @@ void ApplicationManager::scanForSystemApplications()
 
 	std::string platformVersion = DeviceInfo::instance()->platformVersion();
 
+	if (m_scanner)
+		m_scanner->prefetch(systemPaths);
+
 	for (size_t i=0; i < systemPaths.size(); i++) {
 		ApplicationDescription* appDesc = scanOneApplicationFolder(systemPaths[i]);
 		if (appDesc) {
@@ -1305,6 +1347,7 @@ void ApplicationManager::scanForSystemApplications()
 				appDesc->setRemovable(false);
 				appDesc->setVersion(platformVersion);
 				m_systemApps.push_back(appDesc);
+				m_systemIndex.insertApp(appDesc);
 			}
 			else {
 				delete appDesc;
@@ -1339,6 +1382,7 @@ void ApplicationManager::scanForPendingApplications()
 						appDesc->setStatus(ApplicationDescription::Status_Installing);
 					appDesc->setRemovable(true); // always deletable
 					m_pendingApps.push_back(appDesc);
+					m_pendingIndex.insertApp(appDesc);
 					//LAUNCHER3-ADD:
 					Q_EMIT signalScanFoundApp(appDesc);
 				}
@@ -1408,6 +1452,7 @@ void ApplicationManager::scanForLaunchPoints(std::string launchPointFolder)
 
 		launchPoint->setAppDesc(appDesc);
 		appDesc->addLaunchPoint(launchPoint);
+		indexLaunchPoint(launchPoint);
 		//LAUNCHER3-ADD
 		Q_EMIT signalScanFoundAuxiliaryLaunchPoint(appDesc,launchPoint);
 		free(list[i]);
@@ -1428,6 +1473,8 @@ void ApplicationManager::scanApplicationsFolders(const std::string& appFoldersPa
 	if (count < 0)
 		return;
 
+	prefetchApplicationFolders(folderPath, list, count);
+
 	//check to see if this is a system folder: rooted at /usr               TODO: make this better
 	bool isSystemFolder;
 	std::string systemPath("/usr");
@@ -1485,6 +1532,7 @@ void ApplicationManager::scanApplicationsFolders(const std::string& appFoldersPa
 									<< " , UserHideable = " << (appDesc->isUserHideable() ? "TRUE" : "FALSE");
 
 							m_registeredApps.push_back(appDesc);
+							m_registeredIndex.insertApp(appDesc);
 							//LAUNCHER3-ADD:
 							Q_EMIT signalScanFoundApp(appDesc);
 							//--end
@@ -1500,12 +1548,14 @@ void ApplicationManager::scanApplicationsFolders(const std::string& appFoldersPa
 		}
 	}
 
-	g_message("ApplicationManager::scanApplicationsFolders(%s): the apps are now: ",appFoldersPath.c_str());
-	for( std::vector<ApplicationDescription*>::iterator it=m_registeredApps.begin();
-	it != m_registeredApps.end(); ++it )
-	{
-		ApplicationDescription* app = *it;
-		g_message("\t%s",app->id().c_str());
+	if (logLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+		g_message("ApplicationManager::scanApplicationsFolders(%s): the apps are now: ",appFoldersPath.c_str());
+		for( std::vector<ApplicationDescription*>::iterator it=m_registeredApps.begin();
+		it != m_registeredApps.end(); ++it )
+		{
+			ApplicationDescription* app = *it;
+			g_message("\t%s",app->id().c_str());
+		}
 	}
 
 	if (list)
@@ -1522,6 +1572,8 @@ void ApplicationManager::scanApplicationsFolders(const std::string& appFoldersPa
 	if (count < 0)
 		return;
 
+	prefetchApplicationFolders(folderPath, list, count);
+
 	for (int i = 0; i < count; i++) {
 
 		if (list[i]) {
@@ -1548,18 +1600,34 @@ void ApplicationManager::scanApplicationsFolders(const std::string& appFoldersPa
 		}
 	}
 
-	g_message("ApplicationManager::scanApplicationsFolders(%s): the apps are now: ",appFoldersPath.c_str());
-	for( std::map<std::string,ApplicationDescription*>::iterator it=foundApps.begin();
-	it != foundApps.end(); ++it )
-	{
-		ApplicationDescription* app = it->second;
-		g_message("\t%s",app->id().c_str());
+	if (logLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+		g_message("ApplicationManager::scanApplicationsFolders(%s): the apps are now: ",appFoldersPath.c_str());
+		for( std::map<std::string,ApplicationDescription*>::iterator it=foundApps.begin();
+		it != foundApps.end(); ++it )
+		{
+			ApplicationDescription* app = it->second;
+			g_message("\t%s",app->id().c_str());
+		}
 	}
 
 	if (list)
 		free(list);
 }
 
+void ApplicationManager::prefetchApplicationFolders(const std::string& folderPath, struct dirent** list, int count)
+{
+	if (!m_scanner)
+		return;
+
+	std::vector<std::string> appFolderPaths;
+	for (int i = 0; i < count; i++) {
+		if (list[i] && list[i]->d_name[0] != '.')
+			appFolderPaths.push_back(folderPath + list[i]->d_name);
+	}
+
+	m_scanner->prefetch(appFolderPaths);
+}
+
 ApplicationDescription* ApplicationManager::scanOneApplicationFolder(const std::string& appFolderPath)
 {
 	// Do we have a locale setting
@@ -1577,7 +1645,12 @@ ApplicationDescription* ApplicationManager::scanOneApplicationFolder(const std::
 	std::string appJsonPath;
 	ApplicationDescription* appDesc = 0;
 
-	if (!language.empty() && !region.empty()) {
+	// already read and parsed by the scanner? (falls through to the full search below if that one didn't pan out)
+	json_object* prefetchedRoot = m_scanner ? m_scanner->appInfo(appFolderPath, appJsonPath) : 0;
+	if (prefetchedRoot)
+		appDesc = ApplicationDescription::fromAppInfoJson(prefetchedRoot, appJsonPath, appFolderPath);
+
+	if (!appDesc && !language.empty() && !region.empty()) {
 		appJsonPath = appFolderPath + "/resources/" + language + "/" + region +"/appinfo.json";
 		appDesc = ApplicationDescription::fromFile(appJsonPath, appFolderPath);
 	}
@@ -1718,6 +1791,18 @@ ServiceDescription* ApplicationManager::scanOneServiceFolder(const std::string&
 void ApplicationManager::discoverAppChanges(std::vector<ApplicationDescription *>& added,std::vector<ApplicationDescription *>& removed,std::vector<ApplicationDescription *>& changed) {
 	//DANGER: temporal non-safety; apps may change state after the lists are generated. Call under proper locks
 
+	//if the journal kept track, only the folders it saw change need another look
+	std::set<std::string> changedFolders;
+	if (m_changeJournal) {
+		if (m_changeJournal->takeChanges(ApplicationChangeJournal::Kind_Application, changedFolders)) {
+			discoverAppChangesInFolders(changedFolders,added,removed,changed);
+			return;
+		}
+		//lost track; start over from a clean slate. Anything changing from here on is journaled again
+		g_warning("%s: change journal lost track, walking all application folders", __FUNCTION__);
+		m_changeJournal->resync();
+	}
+
 	//gather up the current view of apps from "what's on the disk" perspective, into a new vector
 	std::map<std::string,ApplicationDescription *> onDiskApps;
 
@@ -1730,7 +1815,7 @@ void ApplicationManager::discoverAppChanges(std::vector<ApplicationDescription *
 			if (appFolder[appFolder.size() - 1] != '/')
 				appFolder += "/";
 
-			luna_log(sAppMgrChnl, "scanning apps from %s", appFolder.c_str());
+			channel_log(sAppMgrChnl, "scanning apps from %s", appFolder.c_str());
 			scanApplicationsFolders(appFolder,onDiskApps);
 		}
 		appFolderIter++;
@@ -1774,18 +1859,161 @@ void ApplicationManager::discoverAppChanges(std::vector<ApplicationDescription *
 	}
 }
 
+//same contract as discoverAppChanges(), restricted to the given (normalized) app folders. An app registered from one of
+//	these folders is "removed" if none of them holds its id anymore; an app found in them is "added" if its id isn't registered,
+//	and "changed" if it fails the strict comparison with the registered one
+void ApplicationManager::discoverAppChangesInFolders(const std::set<std::string>& folders,std::vector<ApplicationDescription *>& added,std::vector<ApplicationDescription *>& removed,std::vector<ApplicationDescription *>& changed) {
+
+	std::map<std::string,ApplicationDescription *> onDiskApps;
+
+	for (std::set<std::string>::const_iterator folderIt = folders.begin(); folderIt != folders.end(); ++folderIt) {
+
+		struct stat stBuf;
+		if (::stat(folderIt->c_str(), &stBuf) != 0 || !(stBuf.st_mode & S_IFDIR))
+			continue;
+
+		channel_log(sAppMgrChnl, "rescanning app folder %s", folderIt->c_str());
+		ApplicationDescription* appDesc = scanOneApplicationFolder(*folderIt);
+		if (appDesc) {
+			if (!getAppById(appDesc->id(),onDiskApps))
+				onDiskApps[appDesc->id()] = appDesc;
+			else
+				delete appDesc;
+		}
+	}
+
+	for (std::vector<ApplicationDescription *>::iterator it = m_registeredApps.begin(); it != m_registeredApps.end(); ++it) {
+		ApplicationDescription *pAppDesc = *it;
+		if (!pAppDesc || folders.find(ApplicationChangeJournal::normalizePath(pAppDesc->folderPath())) == folders.end())
+			continue;
+
+		if (getAppById(pAppDesc->id(),onDiskApps) == NULL)
+			removed.push_back(pAppDesc);
+	}
+
+	for (std::map<std::string,ApplicationDescription *>::iterator map_iter = onDiskApps.begin(); map_iter != onDiskApps.end(); ++map_iter) {
+		ApplicationDescription *pAppDesc = map_iter->second;
+		ApplicationDescription *pRegAppDesc = m_registeredIndex.appById(pAppDesc->id());
+
+		if (pRegAppDesc == NULL)
+			added.push_back(pAppDesc);
+		else if (folders.find(ApplicationChangeJournal::normalizePath(pRegAppDesc->folderPath())) == folders.end())
+			delete pAppDesc;		//a copy of an app that is registered from an untouched folder; the registered one stays
+		else if (pAppDesc->strictCompare(*pRegAppDesc) == false)
+			changed.push_back(pAppDesc);
+		else
+			delete pAppDesc;		//unchanged
+	}
+}
+
+void ApplicationManager::rescanPackageFolders(const std::set<std::string>& packageFolders)
+{
+	bool droppedAny = false;
+
+	for (std::set<std::string>::const_iterator folderIt = packageFolders.begin(); folderIt != packageFolders.end(); ++folderIt) {
+
+		PackageDescription* packageDesc = 0;
+		struct stat stBuf;
+		if (::stat(folderIt->c_str(), &stBuf) == 0 && stBuf.st_mode & S_IFDIR)
+			packageDesc = scanOnePackageFolder(*folderIt);
+
+		//whatever was registered from this folder up to now
+		PackageDescription* oldDesc = 0;
+		for (std::map<std::string, PackageDescription*>::const_iterator it = m_registeredPackages.begin(); it != m_registeredPackages.end(); ++it) {
+			if (!it->second->isOldStyle() && ApplicationChangeJournal::normalizePath(it->second->folderPath()) == *folderIt) {
+				oldDesc = it->second;
+				break;
+			}
+		}
+
+		PackageDescription* replacedDesc = 0;
+		if (packageDesc) {
+			std::map<std::string, PackageDescription*>::iterator find_it = m_registeredPackages.find(packageDesc->id());
+			if (find_it != m_registeredPackages.end()) {
+				if (find_it->second->jsonString() == packageDesc->jsonString()) {
+					delete packageDesc;
+					continue;
+				}
+				replacedDesc = find_it->second;
+			}
+
+			g_message("%s: (%s)\t%s", __FUNCTION__, replacedDesc ? "U" : "A", packageDesc->id().c_str());
+			registerPackage(packageDesc);
+			if (packageDesc->accountIds().size() > 0) {
+				std::vector<ApplicationDescription*> apps;
+				getAppsByPackageId(packageDesc->id(), apps);
+				for (std::vector<ApplicationDescription*>::iterator it = apps.begin(); it != apps.end(); ++it)
+					(*it)->setHasAccounts(true);
+			}
+			createOrUpdatePackageManifest(packageDesc);
+			delete replacedDesc;
+		}
+
+		if (oldDesc && oldDesc != replacedDesc) {
+			g_message("%s: (R)\t%s", __FUNCTION__, oldDesc->id().c_str());
+			m_registeredIndex.removePackage(oldDesc);
+			m_registeredPackages.erase(oldDesc->id());
+			delete oldDesc;
+			droppedAny = true;
+		}
+	}
+
+	//apps left without a package fall back to the old-style one, as at boot
+	if (droppedAny)
+		createPackageDescriptionForOldApps();
+}
+
+void ApplicationManager::rescanServiceFolders(const std::set<std::string>& serviceFolders)
+{
+	for (std::set<std::string>::const_iterator folderIt = serviceFolders.begin(); folderIt != serviceFolders.end(); ++folderIt) {
+
+		ServiceDescription* serviceDesc = 0;
+		struct stat stBuf;
+		if (::stat(folderIt->c_str(), &stBuf) == 0 && stBuf.st_mode & S_IFDIR)
+			serviceDesc = scanOneServiceFolder(*folderIt);
+
+		if (serviceDesc) {
+			std::map<std::string, ServiceDescription*>::iterator find_it = m_registeredServices.find(serviceDesc->id());
+			if (find_it != m_registeredServices.end()) {
+				if (find_it->second->jsonString() == serviceDesc->jsonString()) {
+					delete serviceDesc;
+					continue;
+				}
+				delete find_it->second;
+			}
+			g_message("%s: (%s)\t%s", __FUNCTION__, find_it != m_registeredServices.end() ? "U" : "A", serviceDesc->id().c_str());
+			m_registeredServices[serviceDesc->id()] = serviceDesc;
+		}
+		else {
+			//service folders are named after the service id (see postInstallScan)
+			gchar* serviceId = g_path_get_basename(folderIt->c_str());
+			std::map<std::string, ServiceDescription*>::iterator find_it = m_registeredServices.find(serviceId);
+			if (find_it != m_registeredServices.end()) {
+				g_message("%s: (R)\t%s", __FUNCTION__, serviceId);
+				delete find_it->second;
+				m_registeredServices.erase(find_it);
+			}
+			g_free(serviceId);
+		}
+	}
+}
+
 bool ApplicationManager::removePendingApp(const std::string& id)
 {
 	MutexLocker locker(&m_mutex);
 
+	dropLaunchPointProgress(id);
+
 	std::vector<ApplicationDescription*>::iterator it, itEnd;
 	for (it = m_pendingApps.begin(), itEnd = m_pendingApps.end(); it != itEnd; ++it) {
 
 		ApplicationDescription* appDesc = *it;
 		if (appDesc->id() == id) {
 			g_warning("%s: successfully removed '%s' from the set of pending applications", __PRETTY_FUNCTION__, id.c_str());
+			m_pendingIndex.removeApp(appDesc);
 			delete appDesc;
 			m_pendingApps.erase(it);
+			registryChanged();
 			return true;
 		}
 	}
@@ -1815,8 +2043,10 @@ bool ApplicationManager::removePackage( const std::string& id,int cause)
 		serviceInstallerUninstallApp(*serviceIdIt, sServiceInstallerTypeService, Settings::LunaSettings()->appInstallBase);
 	}
 
+	m_registeredIndex.removePackage(packageDesc);
 	m_registeredPackages.erase(id);
 	delete packageDesc;
+	registryChanged();
 
 	return true;
 }
@@ -1837,6 +2067,7 @@ bool ApplicationManager::removeSysApp(const std::string& id)
 				const LaunchPoint *pLpoint = *lpit;
 				if (pLpoint->isDefault()) {
 					postLaunchPointChange(pLpoint, "removed");
+					unindexLaunchPoint(pLpoint);
 					pAppDesc->removeLaunchPoint(pLpoint);
 				}
 				else {
@@ -1859,6 +2090,8 @@ bool ApplicationManager::removeSysApp(const std::string& id)
 				hideApp(pAppDesc->id());
 			}
 
+			m_registeredApps.erase(it);
+			m_registeredIndex.removeApp(pAppDesc);
 			delete pAppDesc;
 			return true;
 		}		//break out here if we're guaranteed that there are no duplicate app ids in the list
@@ -1872,6 +2105,7 @@ bool ApplicationManager::removeSysApp(const std::string& id)
 		pAppDesc = *it;
 		if (pAppDesc->id() == id) {
 			m_pendingApps.erase(it);
+			m_pendingIndex.removeApp(pAppDesc);
 			postLaunchPointChange(pAppDesc->getDefaultLaunchPoint(), "removed");
 			ApplicationInstaller::instance()->notifyAppRemoved(pAppDesc->id(),pAppDesc->version(),0);
 			delete pAppDesc;
@@ -1896,6 +2130,7 @@ bool ApplicationManager::removeApp( const std::string& appId,int cause)
 			pAppDesc->executionLock();
 			pAppDesc->flagForRemoval();	//not needed but it helps in debugging later, in case any of this fn fails
 			it = m_registeredApps.erase(it);
+			m_registeredIndex.removeApp(pAppDesc);
 
             ApplicationProcessManager::instance()->killByAppId(pAppDesc->id());
 
@@ -1904,6 +2139,7 @@ bool ApplicationManager::removeApp( const std::string& appId,int cause)
 				const LaunchPoint *pLpoint = *lpit;
 				if (pLpoint->isDefault()) {
 					postLaunchPointChange(pLpoint, "removed");
+					unindexLaunchPoint(pLpoint);
 					pAppDesc->removeLaunchPoint(pLpoint);
 				}
 				else {
@@ -1939,6 +2175,7 @@ bool ApplicationManager::removeApp( const std::string& appId,int cause)
 		pAppDesc = *it;
 		if (pAppDesc->id() == appId) {
 			m_pendingApps.erase(it);
+			m_pendingIndex.removeApp(pAppDesc);
 			postLaunchPointChange(pAppDesc->getDefaultLaunchPoint(), "removed");
 			ApplicationInstaller::instance()->notifyAppRemoved(pAppDesc->id(),pAppDesc->version(),cause);
 			delete pAppDesc;
@@ -1961,7 +2198,7 @@ void ApplicationManager::launchBootTimeApps()
 
 		ApplicationDescription* app = *it;
 		if (appsToLaunchAtBoot.find(app->id()) != appsToLaunchAtBoot.end()) {
-			luna_log(sAppMgrChnl, "Launching headless app: %s (%s)",
+			channel_log(sAppMgrChnl, "Launching headless app: %s (%s)",
 					app->id().c_str(), app->entryPoint().c_str());
 			ApplicationProcessManager::instance()->launch(app->id(), "{\"launchedAtBoot\":true}");
 		}
@@ -1978,6 +2215,7 @@ bool ApplicationManager::isLaunchAtBootApp(const std::string& appId)
 
 void ApplicationManager::focusApplication(std::string appId)
 {
+	// the compositor reports the change back through systemmanager/setForegroundApplication once it happened
 	const char *params = g_strdup_printf("{\"appId\":\"%s\"}", appId.c_str());
 
 	LSCall(m_serviceHandlePrivate,
@@ -2057,7 +2295,7 @@ std::string ApplicationManager::addLaunchPoint(const std::string& id,
 
 	std::string launchPointFolder = Settings::LunaSettings()->lunaLaunchPointsPath;
 	if (!launchPointFolder.size()) {
-		luna_warn(sAppMgrChnl, "Launch Point Folder path not set");
+		channel_warn(sAppMgrChnl, "Launch Point Folder path not set");
 		return "";
 	}
 
@@ -2078,12 +2316,13 @@ std::string ApplicationManager::addLaunchPoint(const std::string& id,
 		json_object_put(json);
 
 	if (!success) {
-		luna_warn(sAppMgrChnl, "Failed to write file: %s", launchPointFolder.c_str());
+		channel_warn(sAppMgrChnl, "Failed to write file: %s", launchPointFolder.c_str());
 		delete lp;
 		return "";
 	}
 
 	appDesc->addLaunchPoint(lp);
+	indexLaunchPoint(lp);
 
 	postLaunchPointChange(lp, "added");
 
@@ -2112,7 +2351,7 @@ bool ApplicationManager::removeLaunchPoint(const std::string& launchPointId,std:
 
 	std::string launchPointFolder = Settings::LunaSettings()->lunaLaunchPointsPath;
 	if (!launchPointFolder.size()) {
-		luna_warn(sAppMgrChnl, "Launch Point Folder path not set");
+		channel_warn(sAppMgrChnl, "Launch Point Folder path not set");
 		extendedReturnCause = std::string("launch point folder not set");
 		return false;
 	}
@@ -2131,6 +2370,7 @@ bool ApplicationManager::removeLaunchPoint(const std::string& launchPointId,std:
 	postLaunchPointChange(lp, "removed");
 
 	ApplicationDescription* appDesc = lp->appDesc();
+	unindexLaunchPoint(lp);
 	appDesc->removeLaunchPoint(lp);
 
 	return true;
@@ -2321,62 +2561,42 @@ void ApplicationManager::searchLaunchPoints(SearchSet& matchedByTitle, SearchSet
 	matchedByTitle.clear();
 	matchedByKeyword.clear();
 
-	std::vector<ApplicationDescription*>::const_iterator appDescIt = m_registeredApps.begin();
-	std::vector<ApplicationDescription*>::const_iterator appDescEndIt = m_registeredApps.end();
+	const LaunchPointSearchIndex* search = m_registeredIndex.search();
+	if (!search)
+		return;
 
 	gchar* lcSearchTerm = g_utf8_strdown(searchTerm.c_str(), -1);
+	std::string lcTerm(lcSearchTerm ? lcSearchTerm : "");
+	g_free(lcSearchTerm);
 
-	for (; appDescIt != appDescEndIt; ++appDescIt) {
-
-		ApplicationDescription* appDesc = *appDescIt;
-		if (!appDesc)
-			continue;
-
-		if (!appDesc->isVisible() || appDesc->isRemoveFlagged())
-			continue;
+	// whole/partial keyword starts with search term?
+	bool partialKeywords = searchTerm.size() >= 3 && Settings::LunaSettings()->usePartialKeywordAppSearch;
 
-		if (!hardwareFeaturesRequirementSatisfied(appDesc->hardwareFeaturesNeeded()))
-			continue;
+	std::vector<const LaunchPoint*> byTitle;
+	std::vector<const LaunchPoint*> byKeyword;
+	search->search(lcTerm, partialKeywords, byTitle, byKeyword);
 
-		LaunchPointList::const_iterator lpIt = appDesc->launchPoints().begin();
-		LaunchPointList::const_iterator lpEndIt = appDesc->launchPoints().end();
-
-		for (; lpIt != lpEndIt; ++lpIt) {
-
-			bool foundMatch = false;
-			const LaunchPoint* lp = *lpIt;
-			if (!lp)
-				continue;
+	for (std::vector<const LaunchPoint*>::const_iterator it = byTitle.begin(); it != byTitle.end(); ++it) {
+		if (isSearchable(*it))
+			matchedByTitle.insert(*it);
+	}
+	for (std::vector<const LaunchPoint*>::const_iterator it = byKeyword.begin(); it != byKeyword.end(); ++it) {
+		if (isSearchable(*it))
+			matchedByKeyword.insert(*it);
+	}
+}
 
-			if (lp->matchesTitle(lcSearchTerm)) {
-				g_message("found match by title: %s", lp->title().c_str());
-				matchedByTitle.insert(lp);
-			}
-			else if (lp->isDefault() && !foundMatch) {
-				// whole/partial keyword starts with search term?
-				if (searchTerm.size() >= 3 && Settings::LunaSettings()->usePartialKeywordAppSearch) {
-					foundMatch = appDesc->doesMatchKeywordPartial(lcSearchTerm);
-				}
-				else {
-					foundMatch  = appDesc->doesMatchKeywordExact(lcSearchTerm);
-				}
-				// menu name starts with search term?
-				if (!foundMatch) {
-					gchar* lcMenuName = g_utf8_strdown(appDesc->menuName().c_str(), -1);
-					foundMatch = g_str_has_prefix(lcMenuName, lcSearchTerm);
-					g_free(lcMenuName);
-				}
+static bool isSearchable(const LaunchPoint* lp)
+{
+	// the index doesn't hear about these changing, so they are checked on every result
+	ApplicationDescription* appDesc = lp ? lp->appDesc() : 0;
+	if (!appDesc)
+		return false;
 
-				if (foundMatch) {
-					g_message("found match by keyword/appmenu: %s", lp->title().c_str());
-					matchedByKeyword.insert(lp);
-				}
-			}
-		}
-	}
+	if (!appDesc->isVisible() || appDesc->isRemoveFlagged())
+		return false;
 
-	if (lcSearchTerm)
-		g_free(lcSearchTerm);
+	return hardwareFeaturesRequirementSatisfied(appDesc->hardwareFeaturesNeeded());
 }
 
 std::string	ApplicationManager::mimeTableAsJsonString()
@@ -2415,6 +2635,46 @@ std::string	ApplicationManager::mimeTableAsJsonString()
 	return MimeSystem::instance()->allTablesAsJsonString();
 }
 
+ListResponseCache* ApplicationManager::responseCache(const std::string& method, const std::vector<std::string>& listNames)
+{
+	std::map<std::string, ListResponseCache*>::iterator it = m_responseCaches.find(method);
+	if (it != m_responseCaches.end())
+		return it->second;
+
+	ListResponseCache* cache = new ListResponseCache(listNames);
+	m_responseCaches[method] = cache;
+	return cache;
+}
+
+std::string ApplicationManager::scanStatsAsJsonString()
+{
+	MutexLocker locker(&m_mutex);
+
+	json_object* json = json_object_new_object();
+	json_object* phases = json_object_new_array();
+
+	for (std::vector<std::pair<std::string, uint32_t> >::const_iterator it = m_scanStats.phases.begin();
+		 it != m_scanStats.phases.end(); ++it) {
+		json_object* phase = json_object_new_object();
+		json_object_object_add(phase, "phase", json_object_new_string(it->first.c_str()));
+		json_object_object_add(phase, "ms", json_object_new_int(it->second));
+		json_object_array_add(phases, phase);
+	}
+
+	json_object_object_add(json, "returnValue", json_object_new_boolean(true));
+	json_object_object_add(json, "initialScan", json_object_new_boolean(m_scanStats.initial));
+	json_object_object_add(json, "totalMs", json_object_new_int(m_scanStats.totalMs));
+	json_object_object_add(json, "phases", phases);
+	json_object_object_add(json, "cacheHits", json_object_new_int(m_scanStats.cacheHits));
+	json_object_object_add(json, "cacheMisses", json_object_new_int(m_scanStats.cacheMisses));
+	json_object_object_add(json, "filesParsed", json_object_new_int(m_scanStats.filesParsed));
+	json_object_object_add(json, "workerThreads", json_object_new_int(m_scanStats.workerThreads));
+
+	std::string s = json_object_to_json_string(json);
+	json_object_put(json);
+	return s;
+}
+
 // support of whitelist removed
 ApplicationDescription* ApplicationManager::checkAppAgainstWhiteList( ApplicationDescription* appDesc )
 {
@@ -2535,6 +2795,7 @@ void ApplicationManager::handleApplicationStatusUpdates(LSMessage* msg)
 							if (appDesc)
 							{
 								m_pendingApps.push_back(appDesc);
+								m_pendingIndex.insertApp(appDesc);
 							}
 						}
 					}
@@ -2579,17 +2840,25 @@ void ApplicationManager::handleApplicationStatusUpdates(LSMessage* msg)
 			if (appDesc) {
 				// update status
 				g_debug("%s [INSTALLER]: ApplicationStatus State = %d - updating status of an installing app", __FUNCTION__,(int)(appStatus.state));
+				ApplicationDescription::Status oldStatus = appDesc->status();
+				std::string oldIconPath = appDesc->getDefaultLaunchPoint()->iconPath();
 				appDesc->update(appStatus, appExists);
-				QBitArray statusBits = QBitArray(LaunchPointUpdatedReason::SIZEOF);
-				statusBits.setBit(LaunchPointUpdatedReason::Status);
-				statusBits.setBit(LaunchPointUpdatedReason::Progress);
-				Q_EMIT signalLaunchPointUpdated(appDesc->getDefaultLaunchPoint(),statusBits);
+
+				// a download ticks many times a second; only a change of status or icon can't wait
+				bool progressOnly = appDesc->status() == oldStatus && appDesc->getDefaultLaunchPoint()->iconPath() == oldIconPath;
+				if (!progressOnly || passLaunchPointProgress(appDesc->id())) {
+					QBitArray statusBits = QBitArray(LaunchPointUpdatedReason::SIZEOF);
+					statusBits.setBit(LaunchPointUpdatedReason::Status);
+					statusBits.setBit(LaunchPointUpdatedReason::Progress);
+					Q_EMIT signalLaunchPointUpdated(appDesc->getDefaultLaunchPoint(),statusBits);
+				}
 			}
 			else {
 				appDesc = ApplicationDescription::fromApplicationStatus(appStatus, appExists);
 				if (appDesc) {
 					g_debug("%s [INSTALLER]: ApplicationStatus State = %d - initial status of an installing app", __FUNCTION__,(int)(appStatus.state));
 					m_pendingApps.push_back(appDesc);
+					m_pendingIndex.insertApp(appDesc);
 					QBitArray statusBits = QBitArray(LaunchPointAddedReason::SIZEOF);
 					statusBits.setBit(LaunchPointAddedReason::InstallerStatusUpdate);
 					Q_EMIT signalLaunchPointAdded(appDesc->getDefaultLaunchPoint(),statusBits);
@@ -2600,6 +2869,9 @@ void ApplicationManager::handleApplicationStatusUpdates(LSMessage* msg)
 
 Done:
 
+	// pending apps may have come, gone or changed status
+	registryChanged();
+
 	if (payload && !is_error(payload))
 		json_object_put(payload);
 }
@@ -3073,6 +3345,7 @@ void ApplicationManager::slotVoiceDialAllowSettingChanged(bool v)
 
 void ApplicationManager::dbgEmitSignalLaunchPointUpdated(const LaunchPoint * lp,const QBitArray& statusBits)
 {
+	registryChanged();
 	Q_EMIT signalLaunchPointUpdated(lp,statusBits);
 }
 
@@ -29,21 +29,28 @@
 #include <list>
 #include <map>
 #include <set>
+#include <stdint.h>
 
 #include "lunaservice.h"
 #include "Mutex.h"
 #include "MimeSystem.h"
+#include "ApplicationIndex.h"
 
 #include <QObject>
 #include <QBitArray>
 
+class ApplicationChangeJournal;
+class ListResponseCache;
+class LaunchPointChangeBatcher;
 class ApplicationDescription;
+class ApplicationScanner;
 class PackageDescription;
 class ServiceDescription;
 class LaunchPoint;
 class CommandHandler;
 class ResourceHandler;
 class RedirectHandler;
+struct dirent;
 
 //LAUNCHER3-ADDED:
 namespace LaunchPointUpdatedReason
@@ -156,6 +163,14 @@ public:
 
 	std::string				mimeTableAsJsonString();
 
+	// goes up on every change to the registered apps, packages, services and launch points
+	uint32_t generation() const { return (uint32_t) g_atomic_int_get(&m_generation); }
+	void registryChanged() { g_atomic_int_inc(&m_generation); }
+
+	// the cached reply of a list service method, made of these lists (see ListResponseCache)
+	ListResponseCache* responseCache(const std::string& method, const std::vector<std::string>& listNames);
+	std::string				scanStatsAsJsonString();
+
 	void relayStatus(const std::string& jsonPayload,const unsigned long ticketId);
 
 	static ApplicationDescription* checkAppAgainstWhiteList( ApplicationDescription* appDesc );
@@ -235,6 +250,8 @@ public Q_SLOTS:
 
 private:
 
+	void runScan();
+	void recordScanPhase(const char* phase, uint32_t& phaseStart);
 	void scanForApplications();
 	void scanForPackages();
 	void createPackageDescriptionForOldApps();
@@ -244,6 +261,7 @@ private:
 	void scanForLaunchPoints(std::string launchPointFolder);
 	void scanApplicationsFolders(const std::string& appFolders);
 	void scanApplicationsFolders(const std::string& appFoldersPath,std::map<std::string,ApplicationDescription *>& foundApps);
+	void prefetchApplicationFolders(const std::string& folderPath, struct dirent** list, int count);
 	ApplicationDescription* scanOneApplicationFolder(const std::string& appFolderPath);
 	PackageDescription* scanOnePackageFolder(const std::string& packageFolderPath);
 	ServiceDescription* scanOneServiceFolder(const std::string& serviceFolderPath);
@@ -255,9 +273,17 @@ private:
 
 	//discoverAppChanges: temporal non-safety; apps may change state after the lists are generated. Call under proper locks
 	void discoverAppChanges(std::vector<ApplicationDescription *>& added,std::vector<ApplicationDescription *>& removed,std::vector<ApplicationDescription *>& changed);
+	void discoverAppChangesInFolders(const std::set<std::string>& folders,std::vector<ApplicationDescription *>& added,std::vector<ApplicationDescription *>& removed,std::vector<ApplicationDescription *>& changed);
+	void rescanPackageFolders(const std::set<std::string>& packageFolders);
+	void rescanServiceFolders(const std::set<std::string>& serviceFolders);
+	void startChangeJournal();
 
 	ApplicationDescription* getAppById( const std::string& appId,const std::map<std::string,ApplicationDescription *>& appMap);
 
+	void registerPackage(PackageDescription* packageDesc);
+	void indexLaunchPoint(const LaunchPoint* lp);
+	void unindexLaunchPoint(const LaunchPoint* lp);
+
 	void scanFolderResursively( const std::string& path );
 	void clear();
 	void dumpStats();
@@ -294,11 +320,47 @@ private:
 	std::map<std::string, PackageDescription*> m_registeredPackages;
 	std::map<std::string, ServiceDescription*> m_registeredServices;
 
+	// id lookups into the lists above; must be kept in step with every push_back/erase on them
+	ApplicationIndex m_registeredIndex;		// m_registeredApps (+ their launch points) and m_registeredPackages
+	ApplicationIndex m_systemIndex;			// m_systemApps
+	ApplicationIndex m_pendingIndex;		// m_pendingApps (+ their launch points)
+
+	// timings and appinfo cache counters of the last scan(), for applicationManager/scanStats
+	struct ScanStats {
+		ScanStats() : initial(false), totalMs(0), cacheHits(0), cacheMisses(0), filesParsed(0), workerThreads(0) {}
+
+		bool initial;
+		uint32_t totalMs;
+		unsigned int cacheHits;
+		unsigned int cacheMisses;
+		unsigned int filesParsed;
+		unsigned int workerThreads;
+		std::vector<std::pair<std::string, uint32_t> > phases;
+	};
+
+	ApplicationScanner* m_scanner;		// only set while scan() runs
+	ApplicationChangeJournal* m_changeJournal;	// app/package/service folders touched since the last scan; NULL if inotify is unavailable
+	ScanStats m_scanStats;
+
+	volatile gint m_generation;
+	std::map<std::string, ListResponseCache*> m_responseCaches;
+
+	// launchPointChanges posts to batched subscribers, and installer progress signals held back, until the next flush
+	LaunchPointChangeBatcher* m_launchPointChanges;
+	Mutex m_launchPointChangeMutex;
+	guint m_launchPointFlushSource;
+	uint64_t m_launchPointFlushDue;		// monotonic ms at which m_launchPointFlushSource fires
+
 	Mutex m_mutex;
 
 	bool	startService();
 	void	stopService();
 	void    postLaunchPointChange(const LaunchPoint* lp, const std::string& change);
+	bool    passLaunchPointProgress(const std::string& appId);
+	void    dropLaunchPointProgress(const std::string& appId);
+	void    scheduleLaunchPointFlush(unsigned int delayMs);
+	static gboolean cbFlushLaunchPointChanges(gpointer data);
+	void    flushLaunchPointChanges();
 	LSPalmService*	m_service;
 	LSHandle* m_serviceHandlePublic;
 	LSHandle* m_serviceHandlePrivate;
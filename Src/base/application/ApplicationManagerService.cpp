@@ -25,7 +25,11 @@
 #include "Common.h"
 #include "HostBase.h"
 #include "JSONUtils.h"
+#include "ValidatedJsonMessage.h"
 #include "MimeSystem.h"
+#include "ListResponseCache.h"
+#include "LaunchPointChangeBatcher.h"
+#include "LogFilter.h"
 #include "PackageDescription.h"
 #include "ServiceDescription.h"
 #include "Settings.h"
@@ -67,6 +71,22 @@ extern "C" bool LSMessageGetSubscribe(LSMessage *message);			//THIS SHOULD BE IN
 
 static bool s_extraLogging = false;
 
+// launch point changes within this long are posted to batched launchPointChanges subscribers as one message
+static const unsigned int s_launchPointBatchMs = 100;
+
+// the list* methods took any payload before they learned sinceGeneration; other properties are still ignored
+static const char* const s_listRequestSchema =
+	"{\"type\":\"object\",\"additionalProperties\":true,\"properties\":{"
+		"\"sinceGeneration\":{\"type\":\"integer\",\"optional\":true}"
+	"}}";
+
+static uint64_t monotonicMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 static std::string getAbsolutePath(const std::string& inStr,
 		const std::string& parentDirectory);
 
@@ -129,6 +149,7 @@ static std::string getAbsolutePath(const std::string& inStr,
  *  - \ref com_palm_application_manager_restore_mime_table
  *  - \ref com_palm_application_manager_running
  *  - \ref com_palm_application_manager_save_mime_table
+ *  - \ref com_palm_application_manager_scan_stats
  *  - \ref com_palm_application_manager_search_apps
  *  - \ref com_palm_application_manager_swap_redirect_handler
  *  - \ref com_palm_application_manager_swap_resource_handler
@@ -1003,6 +1024,25 @@ static bool servicecallback_install( LSHandle* lshandle, LSMessage *message,
 }
 
 
+// the "params" of an open or launch request, as the launched app gets it: an object params (or an empty one
+// if none were given) carries the caller's "$activity" along; string params are passed on untouched
+static std::string activityParams(const ValidatedJsonMessage& request)
+{
+	pbnjson::JValue params = request.value("params");
+	if (request.has("params") && !params.isObject()) {
+		std::string str;
+		request.getString("params", str);
+		return str;
+	}
+
+	if (!request.has("params"))
+		params = pbnjson::Object();
+	if (request.has("$activity"))
+		params.put("$activity", request.value("$activity"));
+	return ValidatedJsonMessage::toString(params);
+}
+
+
 /*!
 \page com_palm_application_manager
 \n
@@ -1163,18 +1203,9 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 	std::string processId = "";
 	std::string errMsg;
 	bool success = false;
-	struct json_object* root=0;
-	struct json_object* appid=0;
-	struct json_object* paramblock=0;
-	struct json_object* target=0;
-	struct json_object* targetMime=0;
-	struct json_object* auth=0;
-	struct json_object* devid=0;
-	struct json_object* ovrhandlerappid=0;
 	struct json_object* json=0;
-	struct json_object* activityMgrParam=0;
-	struct json_object* trueFileNameParam=0;
 
+	std::string appId;
 	std::string params;
 	const char* callerId = LSMessageGetApplicationID(message);
 	std::string targetAppId;
@@ -1191,12 +1222,13 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 
     // {"id": string, "target": string, "mime": string, "params": [ string, object ], "authToken": object, "deviceId": object, "overrideHandlerAppId": string, "fileName": string}
 
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_8(REQUIRED(id, string), REQUIRED(target, string), REQUIRED(mime, string),
-                                        REQUIRED_UNION_2(params, object, string), REQUIRED(authToken, object),
-                                        REQUIRED(deviceId, object), REQUIRED(overrideHandlerAppId, string),
-                                        REQUIRED(fileName, string)));
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              SCHEMA_8(REQUIRED(id, string), REQUIRED(target, string), REQUIRED(mime, string),
+                                       REQUIRED_UNION_2(params, object, string), REQUIRED(authToken, object),
+                                       REQUIRED(deviceId, object), REQUIRED(overrideHandlerAppId, string),
+                                       REQUIRED(fileName, string)),
+                              request);
 
 	//rather than what's in the resource handler file
 	// (currently command-resource-handlers.json)
@@ -1206,67 +1238,24 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 	// this will be our return payload object
 	json = json_object_new_object();
 
-	const char* str = LSMessageGetPayload( message );
-	if (!str) {
+	if (!request.payload()) {
 		errMsg = "No payload provided";
 		goto done;
 	}
 
-	root = json_tokener_parse( str );
-	if (!root || is_error(root)) {
+	if (!request.isValid()) {
 		errMsg = "Malformed JSON detected in payload";
 		goto done;
 	}
 
-	appid = json_object_object_get(root,"id");
-	target = json_object_object_get(root,"target");
-	targetMime = json_object_object_get(root,"mime");
-	paramblock = json_object_object_get(root,"params");
-	auth = json_object_object_get(root,"authToken");
-	devid = json_object_object_get(root,"deviceId");
-	ovrhandlerappid = json_object_object_get(root,"overrideHandlerAppId");
-	activityMgrParam = json_object_object_get(root,"$activity");
-	trueFileNameParam = json_object_object_get(root,"fileName");
-
-	if (is_error(trueFileNameParam))
-		trueFileNameParam = 0;
-	if (is_error(activityMgrParam))
-		activityMgrParam  = 0;
-	if (is_error(paramblock))
-		paramblock = 0;
-
-	if (paramblock) {
-		if (json_object_is_type(paramblock,json_type_object))
-		{
-			if (activityMgrParam)
-				json_object_object_add(paramblock,"$activity",json_object_get(activityMgrParam));	//inject it into the param block
-			params = json_object_to_json_string( paramblock );
-		}
-		else
-		{
-			//the param object was not a json object...just treat it as a string and don't do anything to it
-			params = json_object_get_string(paramblock);
-		}
-	}
-	else
-	{
-		//create a param block
-		paramblock = json_object_new_object();
-		if (activityMgrParam)
-			json_object_object_add(paramblock,"$activity",json_object_get(activityMgrParam));
-		// add it to the root so that it'll be deleted automatically later
-		json_object_object_add(root,"params",paramblock);
-		params = json_object_to_json_string( paramblock );
-	}
+	params = activityParams(request);
 
-	if ((ovrhandlerappid) && (!is_error(ovrhandlerappid)))
-		ovrHandlerAppId=json_object_get_string(ovrhandlerappid);
+	request.getString("overrideHandlerAppId", ovrHandlerAppId);
 
-	if (appid)
+	if (request.getString("id", appId))
 	{
 		// we'll assume this is an appId, and we'll launch it.
-        std::string url = json_object_get_string(appid);
-        processId = ApplicationManager::instance()->launch(url, params);
+        processId = ApplicationManager::instance()->launch(appId, params);
 		if (!processId.empty()) {
 			success = true;
 			json_object_object_add(json, "processId", json_object_new_string(processId.c_str()));
@@ -1274,20 +1263,15 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 		goto done;
 	}
 
-	if (!target) {
+	if (!request.has("target")) {
 		errMsg = "Unable to process command. Provide a valid \"id\" or \"target\" field";
 		goto done;
 	}
 	// We have a resource URL to open. Try to find the correct application to launch
 
-	if (targetMime) {
-		const char* mimeStr = json_object_get_string(targetMime);
-		if (mimeStr) {
-			strMime = mimeStr;
-		}
-	}
+	request.getString("mime", strMime);
 
-	targetUri = json_object_get_string(target);
+	request.getString("target", targetUri);
 	if (targetUri.empty()) {
 		errMsg = "empty target name, or not-a-string";
 		goto done;
@@ -1299,9 +1283,8 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 		goto done;
 	}
 
-	if (trueFileNameParam)
+	if (request.getString("fileName", trueFileName))
 	{
-		trueFileName = json_object_get_string(trueFileNameParam);
 		appArgUrl = std::string("{ \"target\":\"") + targetUri.c_str() + std::string("\" , \"fileName\":\"")+trueFileName+std::string("\"}");
 	}
 	else
@@ -1360,23 +1343,23 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 				bool retval;
 				LSError lserror;
 				LSErrorInit (&lserror);
-				json_object* downloadParams = json_object_new_object();
-				json_object_object_add (downloadParams, "target", json_object_new_string (targetUri.c_str()));
+				pbnjson::JValue downloadParams = pbnjson::Object();
+				downloadParams.put ("target", targetUri);
 				if (!strMime.empty())
-					json_object_object_add (downloadParams, "mime", json_object_new_string (strMime.c_str()));
-				if (auth && devid) {
-					json_object_object_add (downloadParams, "authToken", auth);
-					json_object_object_add (downloadParams, "deviceId", devid);
+					downloadParams.put ("mime", strMime);
+				if (request.has("authToken") && request.has("deviceId")) {
+					downloadParams.put ("authToken", request.value("authToken"));
+					downloadParams.put ("deviceId", request.value("deviceId"));
 				}
 
-				json_object_object_add (downloadParams, "subscribe", json_object_new_boolean (true));
+				downloadParams.put ("subscribe", true);
+				std::string downloadPayload = ValidatedJsonMessage::toString(downloadParams);
 
-				g_debug ("sending download request to download manager with params: %s\n", json_object_to_json_string (downloadParams));
+				g_debug ("sending download request to download manager with params: %s\n", downloadPayload.c_str());
 
 				ApplicationManager::DownloadRequest* req = new ApplicationManager::DownloadRequest (ticket, ovrHandlerAppId, strMime, LSMessageIsSubscription (message));
-				retval = LSCall (lshandle, "palm://com.palm.downloadmanager/download", json_object_to_json_string (downloadParams),
+				retval = LSCall (lshandle, "palm://com.palm.downloadmanager/download", downloadPayload.c_str(),
 						ApplicationManager::cbDownloadManagerUpdate, req, NULL, &lserror); 
-				json_object_put (downloadParams);
 				if (!retval) {
 					LSErrorPrint (&lserror, stderr);
 					LSErrorFree (&lserror);
@@ -1445,8 +1428,6 @@ static bool servicecallback_open( LSHandle* lshandle, LSMessage *message,
 	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror ))
 		LSErrorFree (&lserror); 
 
-	if (root && !is_error(root))
-		json_object_put( root );
 	json_object_put(json);
 	return true;
 }
@@ -1516,78 +1497,41 @@ static bool servicecallback_launch( LSHandle* lshandle, LSMessage *message,
 	LSErrorInit(&lserror);
 	std::string errMsg;
 	std::string processId;
-	json_object * label = 0;
-	json_object * root = 0;
-	json_object * activityMgrParam = 0;
 	std::string id;
 	std::string params;
 	const char* caller = LSMessageGetApplicationID(message);
 	std::string callerAppId;
 	std::string callerProcessId;
 	bool success=false;
-    qint64 pid;
 
     // {"id": object { "label" :string }, "params": [ string, object ]}
 
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_2(NAKED_OBJECT_REQUIRED_1(id, label, string), REQUIRED_UNION_2(params, object, string)));
-	const char* str = LSMessageGetPayload( message );
-	if (!str) {
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              SCHEMA_2(NAKED_OBJECT_REQUIRED_1(id, label, string), REQUIRED_UNION_2(params, object, string)),
+                              request);
+	if (!request.payload()) {
 		errMsg = "No payload provided";
 		goto Done;
 	}
 
-	root = json_tokener_parse( str );
-	if (!root || is_error(root)) {
+	if (!request.isValid()) {
 		errMsg = "Malformed JSON detected in payload";
 		goto Done;
 	}
 
-	label = json_object_object_get(root,"id");
-	if (!label) {
+	if (!request.getString("id", id)) {
 		g_message("ApplicationManagerService:: servicecallback_launch(): can't parse input json - id");
 		errMsg = "Unable to process command. Provide a valid \"id\" field";
 		goto Done;
 	}
-	id = json_object_get_string(label);
 	if (id.length() == 0) {
 		g_message("ApplicationManagerService:: servicecallback_launch(): invalid id specified");
 		errMsg = "Invalid id specified";
 		goto Done;
 	}
 
-	label = json_object_object_get(root,"params");
-	activityMgrParam = json_object_object_get(root,"$activity");
-
-	if (is_error(activityMgrParam))
-		activityMgrParam  = 0;
-	if (is_error(label))
-		label = 0;
-
-	if (label) {
-		if (json_object_is_type(label,json_type_object))
-		{
-			if (activityMgrParam)
-				json_object_object_add(label,"$activity",json_object_get(activityMgrParam));	//inject it into the param block
-			params = json_object_to_json_string( label );
-		}
-		else
-		{
-			//the param object was not a json object...just treat it as a string and don't do anything to it
-			params = json_object_get_string(label);
-		}
-	}
-	else
-	{
-		//create a param block
-		label = json_object_new_object();
-		if (activityMgrParam)
-			json_object_object_add(label,"$activity",json_object_get(activityMgrParam));
-		// add it to the root so that it'll be deleted automatically later
-		json_object_object_add(root,"params",label);
-		params = json_object_to_json_string( label );
-	}
+	params = activityParams(request);
 
 	if (caller)
 		splitWindowIdentifierToAppAndProcessId(caller, callerAppId, callerProcessId);
@@ -1600,9 +1544,6 @@ static bool servicecallback_launch( LSHandle* lshandle, LSMessage *message,
 
 	Done:
 
-	if( root && !is_error(root) ) 
-		json_object_put( root );
-
 	json_object* json = json_object_new_object();
 	json_object_object_add(json, "returnValue", json_object_new_boolean(success));
 	if (success)
@@ -1619,6 +1560,67 @@ static bool servicecallback_launch( LSHandle* lshandle, LSMessage *message,
 
 }
 
+/*
+ * The list methods below (listApps, listPackages, listLaunchPoints, listDockModeLaunchPoints,
+ * listPendingLaunchPoints) reply from a ListResponseCache that is only rebuilt when the registry generation
+ * (ApplicationManager::generation()) moved since the last call. Each takes an optional "sinceGeneration",
+ * the "generation" of an earlier reply, and then replies with just the items that changed after it and the
+ * keys of the ones that went away (see ListResponseCache), or with the full list if that can't be told.
+ */
+
+// "sinceGeneration" of a list request, if it has one
+static bool listSinceGeneration(const ValidatedJsonMessage& request, uint32_t& r_generation)
+{
+	int64_t since = 0;
+	if (!request.getInteger("sinceGeneration", since) || since < 0 || since > G_MAXUINT32)
+		return false;
+	r_generation = (uint32_t) since;
+	return true;
+}
+
+static void replyWithResponse(LSHandle* lshandle, LSMessage* message, const std::string& response)
+{
+	LSError lserror;
+	LSErrorInit(&lserror);
+	if (!LSMessageReply( lshandle, message, response.c_str(), &lserror ))
+		LSErrorFree (&lserror);
+}
+
+// replies to a list request from the cache of method, first rebuilding it with build if the registry changed
+static void replyWithList(LSHandle* lshandle, LSMessage* message, const ValidatedJsonMessage& request,
+		const char* method, const char* listName, void (*build)(ListResponseCache::ItemList& r_items))
+{
+	ApplicationManager* appMgr = ApplicationManager::instance();
+
+	// read before building: a change made while the list is built leaves the cache behind, never ahead
+	uint32_t generation = appMgr->generation();
+	ListResponseCache* cache = appMgr->responseCache(method, std::vector<std::string>(1, listName));
+	if (!cache->isCurrent(generation)) {
+		std::vector<ListResponseCache::ItemList> lists(1);
+		build(lists[0]);
+		cache->update(generation, lists);
+	}
+
+	uint32_t since = 0;
+	if (listSinceGeneration(request, since))
+		replyWithResponse(lshandle, message, cache->response(since));
+	else
+		replyWithResponse(lshandle, message, cache->response());
+}
+
+static void addListItem(ListResponseCache::ItemList& r_items, const std::string& key, json_object* item)
+{
+	r_items.push_back(std::make_pair(key, std::string(json_object_to_json_string(item))));
+	json_object_put(item);
+}
+
+static void buildAppList(ListResponseCache::ItemList& r_items)
+{
+	std::vector<ApplicationDescription*> apps = ApplicationManager::instance()->allApps();
+	for (std::vector<ApplicationDescription*>::iterator it = apps.begin(); it != apps.end(); ++it)
+		addListItem(r_items, (*it)->id(), (*it)->toJSON());
+}
+
 /*!
 \page com_palm_application_manager
 \n
@@ -1633,20 +1635,29 @@ List all registered applications.
 \subsection com_palm_application_manager_list_apps_syntax Syntax:
 \code
 {
+    "sinceGeneration": int
 }
 \endcode
 
+\param sinceGeneration Optional. The "generation" of an earlier reply; only what changed since is returned.
+
 \subsection com_palm_application_manager_list_apps_returns Returns:
 \code
 {
     "returnValue": boolean,
+    "generation": int,
     "apps": [ object array ]
 }
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param generation Registry generation the reply was built at.
 \param apps Array that contains objects for the applications.
 
+When \c sinceGeneration was given and is recent enough, \c apps only holds the entries added or changed since,
+\c "delta" is true and \c "removed" holds the keys of the ones that went away: \c { "apps": [ string array ] }.
+Entries are keyed by id. Otherwise the full list is returned.
+
 \subsection com_palm_application_manager_list_apps_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.applicationManager/listApps '{}'
@@ -1721,42 +1732,90 @@ Example response for a failed call:
 static bool servicecallback_listApps(LSHandle* lshandle, LSMessage *message,
 		void *user_data)
 {
-	LSError lserror;
-	LSErrorInit(&lserror);
-	json_object* json = 0;
-	json_object* array = 0;
+    // {"sinceGeneration": integer}
 
-    // {}
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              s_listRequestSchema,
+                              request);
 
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_ANY);
+	replyWithList(lshandle, message, request, "listApps", "apps", buildAppList);
+	return true;
+}
 
+static void buildPackageList(ListResponseCache::ItemList& r_items)
+{
 	ApplicationManager* appMgr  = ApplicationManager::instance();
-	std::vector<ApplicationDescription*> apps = appMgr->allApps();
+	std::map<std::string, PackageDescription*> packages = appMgr->allPackages();
 
-	json = json_object_new_object();
-	if (json == NULL)
-		return false;
+	for (std::map<std::string, PackageDescription*>::const_iterator it = packages.begin(); it != packages.end(); ++it) {
+		PackageDescription* packageDesc = (*it).second;
+		json_object* packageJson = packageDesc->toJSON();
+		if (!packageJson) {
+			continue;
+		}
 
-	array = json_object_new_array();
-	if (array) {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(true));
-		for (std::vector<ApplicationDescription*>::iterator it = apps.begin(); it != apps.end(); ++it) {
+		// App catalog wants us to copy over some of the app properties to the package.
+		std::string appId = packageDesc->appIds().front();
+		if (appId != "") {
+			ApplicationDescription* appDesc = appMgr->getAppById(appId);
+			if (appDesc) {
+				if (packageDesc->isOldStyle()) {
+					json_object_object_add(packageJson, (char*) "loc_name", json_object_new_string(appDesc->title().c_str()));
+					json_object_object_add(packageJson, (char*) "vendor", json_object_new_string(appDesc->vendorName().c_str()));
+					json_object_object_add(packageJson, (char*) "vendorUrl", json_object_new_string(appDesc->vendorUrl().c_str()));
+					json_object_object_add(packageJson, (char*) "icon", json_object_new_string(appDesc->launchPoints().front()->iconPath().c_str()));
+					json_object_object_add(packageJson, (char*) "miniicon", json_object_new_string(appDesc->miniIconUrl().c_str()));
+				}
+				json_object_object_add(packageJson, (char*) "userInstalled",json_object_new_boolean(appDesc->isRemovable() && !appDesc->isUserHideable()));
+			}
+		}
 
-			json_object_array_add(array, (*it)->toJSON());
+
+		// We remove the app/apps and services arrays of IDs (that came from packageinfo.json) and instead add them with the full descriptions
+		// i.e. (we need to include an array of app descriptors instead of an array of app ids for listPackages)
+		json_object* label = JsonGetObject(packageJson, "app");
+		if (label) {
+			json_object_object_del(packageJson, (char*) "app");
+		} else {
+			label = JsonGetObject(packageJson, (char*) "apps");
+			if (label) {
+				json_object_object_del(packageJson, (char*) "apps");
+			}
+		}
+		label = JsonGetObject(packageJson, "services");
+		if (label) {
+			json_object_object_del(packageJson, (char*) "services");
 		}
-		json_object_object_add(json, "apps", array);
-	}
-	else {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(false));
-	}
 
-	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror ))
-		LSErrorFree (&lserror); 
+		// Add the array of app descriptions
+		json_object* apps = json_object_new_array();
+		std::vector<std::string>::const_iterator appIdIt, appIdItEnd;
+		for (appIdIt = packageDesc->appIds().begin(), appIdItEnd = packageDesc->appIds().end(); appIdIt != appIdItEnd; ++appIdIt) {
+			ApplicationDescription* appDesc = appMgr->getAppById(*appIdIt);
+			if (appDesc) {
+				json_object_array_add(apps, appDesc->toJSON());
+			} else {
+				g_warning("%s: Application with appId %s was not found", __PRETTY_FUNCTION__, (*appIdIt).c_str());
+			}
+		}
+		json_object_object_add(packageJson, "apps", apps);
+
+		// Add the array of service descriptions
+		json_object* services = json_object_new_array();
+		std::vector<std::string>::const_iterator serviceIdIt, serviceIdItEnd;
+		for (serviceIdIt = packageDesc->serviceIds().begin(), serviceIdItEnd = packageDesc->serviceIds().end(); serviceIdIt != serviceIdItEnd; ++serviceIdIt) {
+			ServiceDescription* serviceDesc = appMgr->getServiceInfoByServiceId(*serviceIdIt);
+			if (serviceDesc) {
+				json_object_array_add(services, serviceDesc->toJSON());
+			} else {
+				g_warning("%s: Service with serviceId %s was not found", __PRETTY_FUNCTION__, (*serviceIdIt).c_str());
+			}
+		}
+		json_object_object_add(packageJson, "services", services);
 
-	json_object_put(json);
-	return true;
+		addListItem(r_items, packageDesc->id(), packageJson);
+	}
 }
 
 /*!
@@ -1773,20 +1832,29 @@ List all the registered packages and their apps and service descriptions
 \subsection com_palm_application_manager_list_packages_syntax Syntax:
 \code
 {
+    "sinceGeneration": int
 }
 \endcode
 
+\param sinceGeneration Optional. The "generation" of an earlier reply; only what changed since is returned.
+
 \subsection com_palm_application_manager_list_packages_returns Returns:
 \code
 {
     "returnValue": true,
+    "generation": int,
     "packages": [ object array ]
 }
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param generation Registry generation the reply was built at.
 \param packages Array that contains objects for the packages.
 
+When \c sinceGeneration was given and is recent enough, \c packages only holds the entries added or changed since,
+\c "delta" is true and \c "removed" holds the keys of the ones that went away: \c { "packages": [ string array ] }.
+Entries are keyed by package id. Otherwise the full list is returned.
+
 \subsection com_palm_application_manager_list_packages_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.applicationManager/listPackages '{}'
@@ -1875,108 +1943,15 @@ Example response for a failed call:
 */
 static bool servicecallback_listPackages(LSHandle* lshandle, LSMessage *message, void *user_data)
 {
-	LSError lserror;
-	LSErrorInit(&lserror);
-	json_object* json = NULL;
-	json_object* array = NULL;
-
-	ApplicationManager* appMgr  = ApplicationManager::instance();
-	std::map<std::string, PackageDescription*> packages = appMgr->allPackages();
-
-    // {}
-
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_ANY);
-
-	json = json_object_new_object();
-	if (json == NULL)
-		return false;
-
-	array = json_object_new_array();
-	if (array) {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(true));
-	    for (std::map<std::string, PackageDescription*>::const_iterator it = packages.begin(); it != packages.end(); ++it) {
-			PackageDescription* packageDesc = (*it).second;
-			json_object* packageJson = packageDesc->toJSON();
-			if (!packageJson) {
-				continue;
-			}
-
-			// App catalog wants us to copy over some of the app properties to the package.
-			std::string appId = packageDesc->appIds().front();
-			if (appId != "") {
-				ApplicationDescription* appDesc = appMgr->getAppById(appId);
-				if (appDesc) {
-					if (packageDesc->isOldStyle()) {
-						json_object_object_add(packageJson, (char*) "loc_name", json_object_new_string(appDesc->title().c_str()));
-						json_object_object_add(packageJson, (char*) "vendor", json_object_new_string(appDesc->vendorName().c_str()));
-						json_object_object_add(packageJson, (char*) "vendorUrl", json_object_new_string(appDesc->vendorUrl().c_str()));
-						json_object_object_add(packageJson, (char*) "icon", json_object_new_string(appDesc->launchPoints().front()->iconPath().c_str()));
-						json_object_object_add(packageJson, (char*) "miniicon", json_object_new_string(appDesc->miniIconUrl().c_str()));
-					}
-					json_object_object_add(packageJson, (char*) "userInstalled",json_object_new_boolean(appDesc->isRemovable() && !appDesc->isUserHideable()));
-				}
-			}
-
+    // {"sinceGeneration": integer}
 
-			// We remove the app/apps and services arrays of IDs (that came from packageinfo.json) and instead add them with the full descriptions
-			// i.e. (we need to include an array of app descriptors instead of an array of app ids for listPackages)
-			json_object* label = JsonGetObject(packageJson, "app");
-			if (label) {
-				json_object_object_del(packageJson, (char*) "app");
-			} else {
-				label = JsonGetObject(packageJson, (char*) "apps");
-				if (label) {
-					json_object_object_del(packageJson, (char*) "apps");
-				}
-			}
-			label = JsonGetObject(packageJson, "services");
-			if (label) {
-				json_object_object_del(packageJson, (char*) "services");
-			}
-
-			// Add the array of app descriptions
-			json_object* apps = json_object_new_array();
-			std::vector<std::string>::const_iterator appIdIt, appIdItEnd;
-			for (appIdIt = packageDesc->appIds().begin(), appIdItEnd = packageDesc->appIds().end(); appIdIt != appIdItEnd; ++appIdIt) {
-				ApplicationDescription* appDesc = appMgr->getAppById(*appIdIt);
-				if (appDesc) {
-					json_object_array_add(apps, appDesc->toJSON());
-				} else {
-					g_warning("%s: Application with appId %s was not found", __PRETTY_FUNCTION__, (*appIdIt).c_str());
-				}
-			}
-			json_object_object_add(packageJson, "apps", apps);
-
-			// Add the array of service descriptions
-			json_object* services = json_object_new_array();
-			std::vector<std::string>::const_iterator serviceIdIt, serviceIdItEnd;
-			for (serviceIdIt = packageDesc->serviceIds().begin(), serviceIdItEnd = packageDesc->serviceIds().end(); serviceIdIt != serviceIdItEnd; ++serviceIdIt) {
-				ServiceDescription* serviceDesc = appMgr->getServiceInfoByServiceId(*serviceIdIt);
-				if (serviceDesc) {
-					json_object_array_add(services, serviceDesc->toJSON());
-				} else {
-					g_warning("%s: Service with serviceId %s was not found", __PRETTY_FUNCTION__, (*serviceIdIt).c_str());
-				}
-			}
-			json_object_object_add(packageJson, "services", services);
-
-
-			json_object_array_add(array, packageJson);
-	    }
-		json_object_object_add(json, "packages", array);
-	}
-	else {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(false));
-	}
-
-	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror ))
-		LSErrorFree (&lserror);
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              s_listRequestSchema,
+                              request);
 
-	json_object_put(json);
+	replyWithList(lshandle, message, request, "listPackages", "packages", buildPackageList);
 	return true;
-
 }
 
 /*!
@@ -2054,6 +2029,9 @@ static bool servicecallback_getSizeOf(LSHandle* lshandle, LSMessage *message,
 	std::string appId;
 	std::string errorText;
 	std::vector<std::pair<std::string,uint32_t> > sizes;
+	std::vector<std::string> appIds;
+	std::vector<std::string> packageIds;
+	std::vector<uint64_t> packageSizes;
 	bool includeDbSize = true;
 
     // {"includeDbSize": bool, "appIds": array}
@@ -2093,10 +2071,8 @@ static bool servicecallback_getSizeOf(LSHandle* lshandle, LSMessage *message,
 				errorText = "Could not find the PackageDescription for the appId";
 				goto Done_servicecallback_getSizeOf;
 			}
-			uint32_t s = ApplicationInstaller::getSizeOfPackageById(packageDesc->id());
-			if (includeDbSize && s > 0)
-				s += APPINFO_SIZEOF_APPDB;
-			sizes.push_back(std::pair<std::string,uint32_t>(appId,s));
+			appIds.push_back(appId);
+			packageIds.push_back(packageDesc->id());
 		}
 	}
 	else {
@@ -2115,13 +2091,20 @@ static bool servicecallback_getSizeOf(LSHandle* lshandle, LSMessage *message,
 			json_object* obj = (json_object*) array_list_get_idx(appIdArray, i);
 			appId = json_object_get_string(obj);
 			if (appId.length()) {
-				uint32_t s = ApplicationInstaller::getSizeOfPackageById(appId);
-				if (includeDbSize && s > 0)
-					s += APPINFO_SIZEOF_APPDB;
-				sizes.push_back(std::pair<std::string,uint32_t>(appId,s));
+				appIds.push_back(appId);
+				packageIds.push_back(appId);
 			}
 		}
 	}
+
+	// all of them in one pass; only packages that changed since they were last measured are walked
+	ApplicationInstaller::getSizesOfPackagesById(packageIds, packageSizes);
+	for (unsigned int i = 0; i < appIds.size(); i++) {
+		uint32_t s = packageSizes[i];
+		if (includeDbSize && s > 0)
+			s += APPINFO_SIZEOF_APPDB;
+		sizes.push_back(std::pair<std::string,uint32_t>(appIds[i],s));
+	}
 	
 	Done_servicecallback_getSizeOf:
 
@@ -2258,7 +2241,9 @@ static bool servicecallback_searchForApps(LSHandle* lshandle, LSMessage *message
 
 	array = json_object_new_array();
 
-	g_message("title match ordering:");
+	bool logMatches = logLevelEnabled(G_LOG_LEVEL_MESSAGE);
+	if (logMatches)
+		g_message("title match ordering:");
 	// first include title sorted matches from the title string
 	for (it = matchedByTitle.begin(), itEnd = matchedByTitle.end(); it != itEnd; ++it) {
 
@@ -2266,12 +2251,14 @@ static bool servicecallback_searchForApps(LSHandle* lshandle, LSMessage *message
 		if (!lp)
 			continue;
 		json_object * result = json_object_new_object();
-		g_message("\t%s", lp->title().c_str());
+		if (logMatches)
+			g_message("\t%s", lp->title().c_str());
 		json_object_object_add(result, "launchPoint", json_object_new_string(lp->launchPointId().c_str()));
 		json_object_array_add(array, result);
 	}
 
-	g_message("keyword match ordering:");
+	if (logMatches)
+		g_message("keyword match ordering:");
 	// followed by title sorted matches from the keyword/appmenu string
 	for (it = matchedByKeyword.begin(), itEnd = matchedByKeyword.end(); it != itEnd; ++it) {
 
@@ -2279,7 +2266,8 @@ static bool servicecallback_searchForApps(LSHandle* lshandle, LSMessage *message
 		if (!lp)
 			continue;
 		json_object * result = json_object_new_object();
-		g_message("\t%s", lp->title().c_str());
+		if (logMatches)
+			g_message("\t%s", lp->title().c_str());
 		json_object_object_add(result, "launchPoint", json_object_new_string(lp->launchPointId().c_str()));
 		json_object_array_add(array, result);
 	}
@@ -2312,6 +2300,38 @@ static bool servicecallback_searchForApps(LSHandle* lshandle, LSMessage *message
 	ListLaunchPoints: This returns all the launchPoints
  */
 
+static void addLaunchPointItems(ListResponseCache::ItemList& r_items, const std::vector<const LaunchPoint*>& launchPoints)
+{
+	for (std::vector<const LaunchPoint*>::const_iterator it = launchPoints.begin(); it != launchPoints.end(); ++it)
+		addListItem(r_items, (*it)->launchPointId(), (*it)->toJSON());
+}
+
+static void buildLaunchPointList(ListResponseCache::ItemList& r_items)
+{
+	addLaunchPointItems(r_items, ApplicationManager::instance()->allLaunchPoints());
+}
+
+static void buildDockModeLaunchPointList(ListResponseCache::ItemList& r_items)
+{
+	ApplicationManager* appMgr  = ApplicationManager::instance();
+	std::vector<const LaunchPoint*> launchPoints = appMgr->allDockModeLaunchPoints();
+	const std::set<const LaunchPoint*>& enabledLaunchPoints = appMgr->enabledDockModeLaunchPoints();
+
+	for (std::vector<const LaunchPoint*>::iterator it = launchPoints.begin(); it != launchPoints.end(); ++it) {
+		json_object* obj = (*it)->toJSON();
+		if (enabledLaunchPoints.find (*it) == enabledLaunchPoints.end())
+			json_object_object_add (obj, "enabled", json_object_new_boolean(false));
+		else
+			json_object_object_add (obj, "enabled", json_object_new_boolean(true));
+		addListItem(r_items, (*it)->launchPointId(), obj);
+	}
+}
+
+static void buildPendingLaunchPointList(ListResponseCache::ItemList& r_items)
+{
+	addLaunchPointItems(r_items, ApplicationManager::instance()->allPendingLaunchPoints());
+}
+
 /*!
 \page com_palm_application_manager
 \n
@@ -2326,13 +2346,17 @@ Get all launch points.
 \subsection com_palm_application_manager_list_launch_points_syntax Syntax:
 \code
 {
+    "sinceGeneration": int
 }
 \endcode
 
+\param sinceGeneration Optional. The "generation" of an earlier reply; only what changed since is returned.
+
 \subsection com_palm_application_manager_list_launch_points_returns Returns:
 \code
 {
     "returnValue": boolean,
+    "generation": int,
     "launchPoints": [
         {
             "id": string,
@@ -2353,6 +2377,7 @@ Get all launch points.
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param generation Registry generation the reply was built at.
 \param launchPoints Object array of launch points, see fields below.
 \param id ID.
 \param version Version information.
@@ -2367,6 +2392,10 @@ Get all launch points.
 \param appmenu Menu title
 \param icon Path to application icon.
 
+When \c sinceGeneration was given and is recent enough, \c launchPoints only holds the entries added or changed since,
+\c "delta" is true and \c "removed" holds the keys of the ones that went away: \c { "launchPoints": [ string array ] }.
+Entries are keyed by launchPointId. Otherwise the full list is returned.
+
 \subsection com_palm_application_manager_list_launch_points_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.applicationManager/listLaunchPoints '{}'
@@ -2434,44 +2463,14 @@ Example response for a failed call:
 static bool servicecallback_listLaunchPoints(LSHandle* lshandle, LSMessage *message,
 		void *user_data)
 {
-	LSError lserror;
-	LSErrorInit(&lserror);
-	json_object* json = 0;
-	json_object* array = 0;
-
-    // {}
-
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_ANY);
-
-	ApplicationManager* appMgr  = ApplicationManager::instance();
-	std::vector<const LaunchPoint*> launchPoints = appMgr->allLaunchPoints();
-
-	json = json_object_new_object();
-	if (json == NULL)
-		return false;
-
-	array = json_object_new_array();
-	if (array) {
-
-		json_object_object_add(json, "returnValue", json_object_new_boolean(true));
-		for (std::vector<const LaunchPoint*>::iterator it = launchPoints.begin();
-			it != launchPoints.end(); ++it) {
-
-			json_object_array_add(array, (*it)->toJSON());
-		}
-		json_object_object_add(json, "launchPoints", array);
-	}
-	else {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(false));
-	}
+    // {"sinceGeneration": integer}
 
-	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror )) {
-		LSErrorFree (&lserror);
-	}
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              s_listRequestSchema,
+                              request);
 
-	json_object_put(json);
+	replyWithList(lshandle, message, request, "listLaunchPoints", "launchPoints", buildLaunchPointList);
 	return true;
 }
 
@@ -2489,20 +2488,29 @@ List all dock mode launch points.
 \subsection com_palm_application_manager_list_dock_mode_launch_points_syntax Syntax:
 \code
 {
+    "sinceGeneration": int
 }
 \endcode
 
+\param sinceGeneration Optional. The "generation" of an earlier reply; only what changed since is returned.
+
 \subsection com_palm_application_manager_list_dock_mode_launch_points_returns Returns:
 \code
 {
     "returnValue": boolean,
+    "generation": int,
     "launchPoints": [ object array ]
 }
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param generation Registry generation the reply was built at.
 \param launchPoints Launch points in an object array.
 
+When \c sinceGeneration was given and is recent enough, \c launchPoints only holds the entries added or changed since,
+\c "delta" is true and \c "removed" holds the keys of the ones that went away: \c { "launchPoints": [ string array ] }.
+Entries are keyed by launchPointId. Otherwise the full list is returned.
+
 \subsection com_palm_application_manager_list_dock_mode_launch_points_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.applicationManager/listDockModeLaunchPoints '{}'
@@ -2561,57 +2569,21 @@ Example response for a failed call:
 static bool servicecallback_listDockModeLaunchPoints(LSHandle* lshandle, LSMessage *message,
 		void *user_data)
 {
-	LSError lserror;
-	LSErrorInit(&lserror);
-	json_object* json = 0;
-	json_object* array = 0;
+    // {"sinceGeneration": integer}
 
-	ApplicationManager* appMgr  = ApplicationManager::instance();
-	std::vector<const LaunchPoint*> launchPoints = appMgr->allDockModeLaunchPoints();
-	const std::set<const LaunchPoint*>& enabledLaunchPoints = appMgr->enabledDockModeLaunchPoints();
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              s_listRequestSchema,
+                              request);
 
-    // {}
+	replyWithList(lshandle, message, request, "listDockModeLaunchPoints", "launchPoints", buildDockModeLaunchPointList);
+	return true;
+}
 
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_ANY);
-
-	json = json_object_new_object();
-	if (json == NULL)
-		return false;
-
-	array = json_object_new_array();
-	if (array) {
-
-		json_object_object_add(json, "returnValue", json_object_new_boolean(true));
-		for (std::vector<const LaunchPoint*>::iterator it = launchPoints.begin();
-			it != launchPoints.end(); ++it) {
-			json_object* obj = (*it)->toJSON();
-			if (enabledLaunchPoints.find (*it) == enabledLaunchPoints.end())
-				json_object_object_add (obj, "enabled", json_object_new_boolean(false));
-			else
-				json_object_object_add (obj, "enabled", json_object_new_boolean(true));
-
-			json_object_array_add(array, obj);
-		}
-		json_object_object_add(json, "launchPoints", array);
-	}
-	else {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(false));
-	}
-
-	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror )) {
-		LSErrorFree (&lserror);
-	}
-
-	json_object_put(json);
-	return true;
-}
-
-/*!
-\page com_palm_application_manager
-\n
-\section com_palm_application_manager_list_pending_launch_points listPendingLaunchPoints
+/*!
+\page com_palm_application_manager
+\n
+\section com_palm_application_manager_list_pending_launch_points listPendingLaunchPoints
 
 \e Public.
 
@@ -2622,20 +2594,29 @@ Get a list of all the launchPoints which are pending an update or a new install.
 \subsection com_palm_application_manager_list_pending_launch_points_syntax Syntax:
 \code
 {
+    "sinceGeneration": int
 }
 \endcode
 
+\param sinceGeneration Optional. The "generation" of an earlier reply; only what changed since is returned.
+
 \subsection com_palm_application_manager_list_pending_launch_points_returns Returns:
 \code
 {
     "returnValue": boolean,
+    "generation": int,
     "launchPoints": [ object array ]
 }
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param generation Registry generation the reply was built at.
 \param launchPoints Pending launch points in an object array.
 
+When \c sinceGeneration was given and is recent enough, \c launchPoints only holds the entries added or changed since,
+\c "delta" is true and \c "removed" holds the keys of the ones that went away: \c { "launchPoints": [ string array ] }.
+Entries are keyed by launchPointId. Otherwise the full list is returned.
+
 \subsection com_palm_application_manager_list_pending_launch_points_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.applicationManager/listPendingLaunchPoints '{}'
@@ -2660,44 +2641,14 @@ Example response for a failed call:
 static bool servicecallback_listPendingLaunchPoints(LSHandle* lshandle, LSMessage *message,
 		void *user_data)
 {
-	LSError lserror;
-	LSErrorInit(&lserror);
-	json_object* json = 0;
-	json_object* array = 0;
-
-	ApplicationManager* appMgr  = ApplicationManager::instance();
-	std::vector<const LaunchPoint*> launchPoints = appMgr->allPendingLaunchPoints();
-
-    // {}
-
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_ANY);
-
-	json = json_object_new_object();
-	if (json == NULL)
-		return false;
-
-	array = json_object_new_array();
-	if (array != NULL) {
-
-		json_object_object_add(json, "returnValue", json_object_new_boolean(true));
-		for (std::vector<const LaunchPoint*>::iterator it = launchPoints.begin();
-			it != launchPoints.end(); ++it) {
+    // {"sinceGeneration": integer}
 
-			json_object_array_add(array, (*it)->toJSON());
-		}
-		json_object_object_add(json, "launchPoints", array);
-	}
-	else {
-		json_object_object_add(json, "returnValue", json_object_new_boolean(false));
-	}
-
-	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror )) {
-		LSErrorFree (&lserror);
-	}
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              s_listRequestSchema,
+                              request);
 
-	json_object_put(json);
+	replyWithList(lshandle, message, request, "listPendingLaunchPoints", "launchPoints", buildPendingLaunchPointList);
 	return true;
 }
 
@@ -2823,222 +2774,594 @@ Add the launchpoint represented by the passed appId to the dock mode.
 
 \param returnValue Indicates if the call was succesful.
 
-\subsection com_palm_application_manager_add_dock_mode_launch_point_examples Examples:
+\subsection com_palm_application_manager_add_dock_mode_launch_point_examples Examples:
+\code
+luna-send -n 1 -f luna://com.palm.applicationManager/addDockModeLaunchPoint '{ "appId": "com.palm.app.musicplayer" }'
+\endcode
+
+Example response for a succesful call:
+\code
+{
+    "returnValue": true
+}
+\endcode
+
+Example response for a failed call:
+\code
+{
+    "returnValue": false
+}
+\endcode
+*/
+static bool servicecallback_addDockModeLaunchPoint(LSHandle* lsHandle, LSMessage* message, void* user_data) {
+	json_object* root = 0;
+	json_object* appId = 0;
+	json_object* returnJson = 0;
+	bool returnValue = true;
+	LSError lserror;
+	LSErrorInit(&lserror);
+
+    // {"appID": string}
+
+    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
+                               message,
+                               SCHEMA_1(REQUIRED(appID, string)));
+
+	const char* str = LSMessageGetPayload(message);
+	if (!str)
+		return false;
+
+	root = json_tokener_parse(str);
+	if (is_error(root)) {
+		g_warning("%s: malformed json\n", __PRETTY_FUNCTION__);
+		return true;
+	}
+
+	appId = json_object_object_get(root, "appId");
+	if (appId && !is_error(appId)) {
+		returnValue = ApplicationManager::instance()->enableDockModeLaunchPoint(json_object_get_string(appId));
+	}
+
+	returnJson = json_object_new_object();
+	json_object_object_add(returnJson, "returnValue", json_object_new_boolean(returnValue));
+	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(returnJson), &lserror)) {
+		LSErrorFree(&lserror);
+	}
+
+	if (root && !is_error(root))
+		json_object_put(root);
+
+	json_object_put(returnJson);
+	return true;
+}
+
+/*!
+\page com_palm_application_manager
+\n
+\section com_palm_application_manager_remove_dock_mode_launch_point removeDockModeLaunchPoint
+
+\e Private.
+
+com.palm.applicationManager/removeDockModeLaunchPoint
+
+Removes a launch point represented by an application ID from the dock mode.
+
+\subsection com_palm_application_manager_remove_dock_mode_launch_point_syntax Syntax:
+\code
+{
+    "appId": string
+}
+\endcode
+
+\subsection com_palm_application_manager_remove_dock_mode_launch_point_returns Returns:
+\code
+{
+    "returnValue": boolean
+}
+\endcode
+
+\param returnValue Indicates if the call was succesful.
+
+\subsection com_palm_application_manager_remove_dock_mode_launch_point_examples Examples:
+\code
+luna-send -n 1 -f luna://com.palm.applicationManager/removeDockModeLaunchPoint '{ "appId": "com.palm.app.foo" }'
+\endcode
+
+Example response for a succesful call:
+\code
+{
+    "returnValue": true
+}
+\endcode
+
+Example response for a failed call:
+\code
+{
+    "returnValue": false
+}
+\endcode
+*/
+static bool servicecallback_removeDockModeLaunchPoint(LSHandle* lsHandle, LSMessage* message, void* user_data) {
+	json_object* root = 0;
+	json_object* appId = 0;
+	json_object* returnJson = 0;
+	bool returnValue = false;
+	LSError lserror;
+	LSErrorInit(&lserror);
+
+    // {"appID": string }
+
+    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
+                               message,
+                               SCHEMA_1(REQUIRED(appID, string)));
+
+	const char* str = LSMessageGetPayload(message);
+	if (!str)
+		return false;
+
+	root = json_tokener_parse(str);
+	if (is_error(root)) {
+		g_warning("%s: malformed json\n", __PRETTY_FUNCTION__);
+		return true;
+	}
+
+	appId = json_object_object_get(root, "appId");
+	if (appId) {
+		returnValue = ApplicationManager::instance()->disableDockModeLaunchPoint(json_object_get_string(appId));
+	}
+
+	returnJson = json_object_new_object();
+	json_object_object_add(returnJson, "returnValue", json_object_new_boolean(returnValue));
+	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(returnJson), &lserror)) {
+		LSErrorFree(&lserror);
+	}
+
+	if (root && !is_error(root))
+		json_object_put(root);
+
+	json_object_put(returnJson);
+	return true;
+}
+
+/*!
+\page com_palm_application_manager
+\n
+\section com_palm_application_manager_rescan rescan
+
+\e Private.
+
+com.palm.applicationManager/rescan
+
+Rescan/load the running applications.
+
+\subsection com_palm_application_manager_rescan_syntax Syntax:
+\code
+{
+}
+\endcode
+
+\subsection com_palm_application_manager_rescan_returns Returns:
+\code
+{
+    "returnValue": boolean
+}
+\endcode
+
+\param returnValue Indicates if the call was succesful.
+
+\subsection com_palm_application_manager_rescan_examples Examples:
+\code
+luna-send -n 1 -f luna://com.palm.applicationManager/rescan '{}'
+\endcode
+
+Example response for a succesful call:
+\code
+{
+    "returnValue": true
+}
+\endcode
+*/
+static bool servicecallback_rescan( LSHandle* lshandle,
+		LSMessage * message, void * /*user_data*/)
+{
+	json_object* json = 0;
+	LSError lserror;
+	LSErrorInit(&lserror);
+
+    // {}
+
+    VALIDATE_SCHEMA_AND_RETURN(lshandle,
+                               message,
+                               SCHEMA_ANY);
+
+	ApplicationManager::instance()->scan();
+
+	json = json_object_new_object();
+	if (!json || is_error(json))
+		goto Done;
+
+	json_object_object_add(json, "returnValue",json_object_new_boolean(true));
+
+	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror )) {
+		LSErrorFree(&lserror);
+	}
+
+	Done:
+	if (json)
+		json_object_put(json);
+
+	return true;
+}
+
+
+/*!
+\page com_palm_application_manager
+\n
+\section com_palm_application_manager_scan_stats scanStats
+
+\e Private.
+
+com.palm.applicationManager/scanStats
+
+Get the timings of the last application scan (initial scan or rescan), broken down by phase, and the
+hit/miss counts of the appinfo.json manifest cache.
+
+\subsection com_palm_application_manager_scan_stats_syntax Syntax:
+\code
+{
+}
+\endcode
+
+\subsection com_palm_application_manager_scan_stats_returns Returns:
+\code
+{
+    "returnValue": boolean,
+    "initialScan": boolean,
+    "totalMs": int,
+    "phases": [
+        {
+            "phase": string,
+            "ms": int
+        }
+    ],
+    "cacheHits": int,
+    "cacheMisses": int,
+    "filesParsed": int,
+    "workerThreads": int
+}
+\endcode
+
+\param returnValue Indicates if the call was succesful.
+\param initialScan True if the last scan was the boot time scan, false for a rescan.
+\param totalMs Wall time of the whole scan, in milliseconds.
+\param phases The scan phases in the order they ran, each with its wall time in milliseconds.
+\param cacheHits Number of application folders served from the manifest cache.
+\param cacheMisses Number of application folders whose appinfo.json had to be read.
+\param filesParsed Number of appinfo.json files read and parsed.
+\param workerThreads Size of the thread pool used to read appinfo.json files.
+
+\subsection com_palm_application_manager_scan_stats_examples Examples:
 \code
-luna-send -n 1 -f luna://com.palm.applicationManager/addDockModeLaunchPoint '{ "appId": "com.palm.app.musicplayer" }'
+luna-send -n 1 -f luna://com.palm.applicationManager/scanStats '{}'
 \endcode
 
 Example response for a succesful call:
 \code
 {
-    "returnValue": true
-}
-\endcode
-
-Example response for a failed call:
-\code
-{
-    "returnValue": false
+    "returnValue": true,
+    "initialScan": true,
+    "totalMs": 412,
+    "phases": [
+        { "phase": "systemApplications", "ms": 3 },
+        { "phase": "applications", "ms": 188 },
+        { "phase": "packages", "ms": 61 },
+        { "phase": "oldAppPackages", "ms": 2 },
+        { "phase": "services", "ms": 40 },
+        { "phase": "pendingApplications", "ms": 1 },
+        { "phase": "launchPoints", "ms": 97 },
+        { "phase": "saveCache", "ms": 20 }
+    ],
+    "cacheHits": 97,
+    "cacheMisses": 3,
+    "filesParsed": 3,
+    "workerThreads": 2
 }
 \endcode
 */
-static bool servicecallback_addDockModeLaunchPoint(LSHandle* lsHandle, LSMessage* message, void* user_data) {
-	json_object* root = 0;
-	json_object* appId = 0;
-	json_object* returnJson = 0;
-	bool returnValue = true;
+static bool servicecallback_scanStats( LSHandle* lshandle,
+		LSMessage * message, void * /*user_data*/)
+{
 	LSError lserror;
 	LSErrorInit(&lserror);
 
-    // {"appID": string}
+    // {}
 
-    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
+    VALIDATE_SCHEMA_AND_RETURN(lshandle,
                                message,
-                               SCHEMA_1(REQUIRED(appID, string)));
-
-	const char* str = LSMessageGetPayload(message);
-	if (!str)
-		return false;
-
-	root = json_tokener_parse(str);
-	if (is_error(root)) {
-		g_warning("%s: malformed json\n", __PRETTY_FUNCTION__);
-		return true;
-	}
-
-	appId = json_object_object_get(root, "appId");
-	if (appId && !is_error(appId)) {
-		returnValue = ApplicationManager::instance()->enableDockModeLaunchPoint(json_object_get_string(appId));
-	}
+                               SCHEMA_ANY);
 
-	returnJson = json_object_new_object();
-	json_object_object_add(returnJson, "returnValue", json_object_new_boolean(returnValue));
-	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(returnJson), &lserror)) {
+	std::string s = ApplicationManager::instance()->scanStatsAsJsonString();
+	if (!LSMessageReply( lshandle, message, s.c_str(), &lserror ))
 		LSErrorFree(&lserror);
-	}
 
-	if (root && !is_error(root))
-		json_object_put(root);
-
-	json_object_put(returnJson);
 	return true;
 }
 
+
 /*!
 \page com_palm_application_manager
 \n
-\section com_palm_application_manager_remove_dock_mode_launch_point removeDockModeLaunchPoint
+\section com_palm_application_manager_launch_stats launchStats
 
 \e Private.
 
-com.palm.applicationManager/removeDockModeLaunchPoint
+com.palm.applicationManager/launchStats
 
-Removes a launch point represented by an application ID from the dock mode.
+Get the latencies of application launches since boot, split into the time to resolve the app and build
+its command line, the time to fork the process, and the time until the exec of the app was confirmed.
+Launches through the zygote (sysmgr started with --zygote) and through a plain fork of sysmgr are
+counted separately, so the two can be compared.
 
-\subsection com_palm_application_manager_remove_dock_mode_launch_point_syntax Syntax:
+\subsection com_palm_application_manager_launch_stats_syntax Syntax:
 \code
 {
-    "appId": string
 }
 \endcode
 
-\subsection com_palm_application_manager_remove_dock_mode_launch_point_returns Returns:
+\subsection com_palm_application_manager_launch_stats_returns Returns:
 \code
 {
-    "returnValue": boolean
+    "returnValue": boolean,
+    "process": {
+        "launches": int,
+        "failures": int,
+        "maxUs": {
+            "resolve": int,
+            "spawn": int,
+            "firstAlive": int
+        },
+        "averageUs": {
+            "resolve": int,
+            "spawn": int,
+            "firstAlive": int
+        }
+    },
+    "zygote": {
+        ...same as process...
+    },
+    "recent": [
+        {
+            "id": string,
+            "processid": string,
+            "resolveUs": int,
+            "spawnUs": int,
+            "firstAliveUs": int,
+            "zygote": boolean,
+            "failed": boolean
+        }
+    ]
 }
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param process Launches forked by sysmgr itself.
+\param zygote Launches forked by the zygote.
+\param launches Number of launches whose process has either started or failed to start.
+\param failures Number of those launches whose process could not be started.
+\param maxUs Longest time of each launch phase over all successful launches, in microseconds.
+\param averageUs Average time of each launch phase over all successful launches, in microseconds.
+\param recent The last launches, oldest first.
 
-\subsection com_palm_application_manager_remove_dock_mode_launch_point_examples Examples:
+\subsection com_palm_application_manager_launch_stats_examples Examples:
 \code
-luna-send -n 1 -f luna://com.palm.applicationManager/removeDockModeLaunchPoint '{ "appId": "com.palm.app.foo" }'
+luna-send -n 1 -f luna://com.palm.applicationManager/launchStats '{}'
 \endcode
 
 Example response for a succesful call:
 \code
 {
-    "returnValue": true
+    "returnValue": true,
+    "process": {
+        "launches": 1,
+        "failures": 0,
+        "maxUs": { "resolve": 310, "spawn": 9411, "firstAlive": 1870 },
+        "averageUs": { "resolve": 310, "spawn": 9411, "firstAlive": 1870 }
+    },
+    "zygote": {
+        "launches": 1,
+        "failures": 0,
+        "maxUs": { "resolve": 100, "spawn": 493, "firstAlive": 1218 },
+        "averageUs": { "resolve": 100, "spawn": 493, "firstAlive": 1218 }
+    },
+    "recent": [
+        { "id": "com.palm.launcher", "processid": "1013", "resolveUs": 100, "spawnUs": 493, "firstAliveUs": 1218, "zygote": true, "failed": false },
+        { "id": "com.palm.app.email", "processid": "1042", "resolveUs": 310, "spawnUs": 9411, "firstAliveUs": 1870, "zygote": false, "failed": false }
+    ]
 }
 \endcode
+*/
+static json_object* launchPhasesToJson(qint64 resolveUs, qint64 spawnUs, qint64 firstAliveUs)
+{
+	json_object* json = json_object_new_object();
+	json_object_object_add(json, "resolve", json_object_new_int((int)resolveUs));
+	json_object_object_add(json, "spawn", json_object_new_int((int)spawnUs));
+	json_object_object_add(json, "firstAlive", json_object_new_int((int)firstAliveUs));
+	return json;
+}
 
-Example response for a failed call:
-\code
+static json_object* launchTotalsToJson(const ApplicationLaunchTotals& totals)
 {
-    "returnValue": false
+	unsigned int succeeded = totals.launches - totals.failures;
+
+	json_object* json = json_object_new_object();
+	json_object_object_add(json, "launches", json_object_new_int(totals.launches));
+	json_object_object_add(json, "failures", json_object_new_int(totals.failures));
+	json_object_object_add(json, "maxUs", launchPhasesToJson(totals.maxResolveUs, totals.maxSpawnUs, totals.maxFirstAliveUs));
+	json_object_object_add(json, "averageUs", succeeded ?
+			launchPhasesToJson(totals.totalResolveUs / succeeded, totals.totalSpawnUs / succeeded, totals.totalFirstAliveUs / succeeded)
+			: launchPhasesToJson(0, 0, 0));
+	return json;
 }
-\endcode
-*/
-static bool servicecallback_removeDockModeLaunchPoint(LSHandle* lsHandle, LSMessage* message, void* user_data) {
-	json_object* root = 0;
-	json_object* appId = 0;
-	json_object* returnJson = 0;
-	bool returnValue = false;
+
+static bool servicecallback_launchStats( LSHandle* lshandle,
+		LSMessage * message, void * /*user_data*/)
+{
 	LSError lserror;
 	LSErrorInit(&lserror);
 
-    // {"appID": string }
+    // {}
 
-    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
+    VALIDATE_SCHEMA_AND_RETURN(lshandle,
                                message,
-                               SCHEMA_1(REQUIRED(appID, string)));
+                               SCHEMA_ANY);
 
-	const char* str = LSMessageGetPayload(message);
-	if (!str)
-		return false;
+	const ApplicationLaunchStats& stats = ApplicationProcessManager::instance()->launchStats();
 
-	root = json_tokener_parse(str);
-	if (is_error(root)) {
-		g_warning("%s: malformed json\n", __PRETTY_FUNCTION__);
-		return true;
-	}
+	json_object* json = json_object_new_object();
+	json_object* recent = json_object_new_array();
 
-	appId = json_object_object_get(root, "appId");
-	if (appId) {
-		returnValue = ApplicationManager::instance()->disableDockModeLaunchPoint(json_object_get_string(appId));
+	Q_FOREACH(const ApplicationLaunchSample& sample, stats.recent) {
+		json_object* launch = json_object_new_object();
+		json_object_object_add(launch, "id", json_object_new_string(sample.appId.toUtf8().constData()));
+		json_object_object_add(launch, "processid", json_object_new_string(QString::number(sample.pid).toUtf8().constData()));
+		json_object_object_add(launch, "resolveUs", json_object_new_int((int)sample.resolveUs));
+		json_object_object_add(launch, "spawnUs", json_object_new_int((int)sample.spawnUs));
+		json_object_object_add(launch, "firstAliveUs", json_object_new_int((int)sample.firstAliveUs));
+		json_object_object_add(launch, "zygote", json_object_new_boolean(sample.zygote));
+		json_object_object_add(launch, "failed", json_object_new_boolean(sample.failed));
+		json_object_array_add(recent, launch);
 	}
 
-	returnJson = json_object_new_object();
-	json_object_object_add(returnJson, "returnValue", json_object_new_boolean(returnValue));
-	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(returnJson), &lserror)) {
-		LSErrorFree(&lserror);
-	}
+	json_object_object_add(json, "returnValue", json_object_new_boolean(true));
+	json_object_object_add(json, "process", launchTotalsToJson(stats.process));
+	json_object_object_add(json, "zygote", launchTotalsToJson(stats.zygote));
+	json_object_object_add(json, "recent", recent);
 
-	if (root && !is_error(root))
-		json_object_put(root);
+	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror ))
+		LSErrorFree(&lserror);
 
-	json_object_put(returnJson);
+	json_object_put(json);
 	return true;
 }
 
+
 /*!
 \page com_palm_application_manager
 \n
-\section com_palm_application_manager_rescan rescan
+\section com_palm_application_manager_parse_stats parseStats
 
 \e Private.
 
-com.palm.applicationManager/rescan
+com.palm.applicationManager/parseStats
 
-Rescan/load the running applications.
+Report how much parsing of request payloads the handlers that validate them have done, and how often the
+schemas they validate against were found compiled already.
 
-\subsection com_palm_application_manager_rescan_syntax Syntax:
+\subsection com_palm_application_manager_parse_stats_syntax Syntax:
 \code
 {
+    "reset": boolean
 }
 \endcode
 
-\subsection com_palm_application_manager_rescan_returns Returns:
+\param reset Clear the counters after reporting them.
+
+\subsection com_palm_application_manager_parse_stats_returns Returns:
 \code
 {
-    "returnValue": boolean
+    "returnValue": boolean,
+    "methods": [
+        {
+            "method": string,
+            "calls": int,
+            "parses": int,
+            "failures": int,
+            "totalUs": int,
+            "maxUs": int
+        }
+    ],
+    "schemaCache": {
+        "hits": int,
+        "misses": int,
+        "schemas": int
+    }
 }
 \endcode
 
 \param returnValue Indicates if the call was succesful.
+\param method The handler.
+\param calls Number of requests it got.
+\param parses Number of times a payload was parsed in full. At most one per request, except for a request that fails validation.
+\param failures Number of requests whose payload failed validation or wasn't json.
+\param totalUs Time spent validating and parsing, in microseconds.
+\param maxUs Longest time spent on one request, in microseconds.
+\param hits Number of times a schema was used without compiling it.
+\param misses Number of times a schema had to be compiled.
+\param schemas Number of distinct schemas compiled so far; they are kept for the life of the process.
 
-\subsection com_palm_application_manager_rescan_examples Examples:
+\subsection com_palm_application_manager_parse_stats_examples Examples:
 \code
-luna-send -n 1 -f luna://com.palm.applicationManager/rescan '{}'
+luna-send -n 1 -f luna://com.palm.applicationManager/parseStats '{}'
 \endcode
 
 Example response for a succesful call:
 \code
 {
-    "returnValue": true
+    "returnValue": true,
+    "methods": [
+        { "method": "servicecallback_launch", "calls": 12, "parses": 12, "failures": 0, "totalUs": 913, "maxUs": 140 },
+        { "method": "servicecallback_listLaunchPoints", "calls": 3, "parses": 0, "failures": 0, "totalUs": 2, "maxUs": 1 }
+    ],
+    "schemaCache": { "hits": 214, "misses": 9, "schemas": 9 }
 }
 \endcode
 */
-static bool servicecallback_rescan( LSHandle* lshandle,
+static bool servicecallback_parseStats( LSHandle* lshandle,
 		LSMessage * message, void * /*user_data*/)
 {
-	json_object* json = 0;
 	LSError lserror;
 	LSErrorInit(&lserror);
 
-    // {}
+    // {"reset": boolean}
 
-    VALIDATE_SCHEMA_AND_RETURN(lshandle,
-                               message,
-                               SCHEMA_ANY);
+    VALIDATE_SCHEMA_AND_PARSE(lshandle,
+                              message,
+                              SCHEMA_1(OPTIONAL(reset, boolean)),
+                              request);
 
-	ApplicationManager::instance()->scan();
+	JsonParseStats::CounterMap counters = JsonParseStats::counters();
+	if (request.value("reset").isBoolean() && request.value("reset").asBool())
+		JsonParseStats::reset();
 
-	json = json_object_new_object();
-	if (!json || is_error(json))
-		goto Done;
+	json_object* json = json_object_new_object();
+	json_object* methods = json_object_new_array();
+
+	for (JsonParseStats::CounterMap::const_iterator it = counters.begin(); it != counters.end(); ++it) {
+		const JsonParseStats::Counter& counter = it->second;
+		json_object* method = json_object_new_object();
+		json_object_object_add(method, "method", json_object_new_string(it->first.c_str()));
+		json_object_object_add(method, "calls", json_object_new_int(counter.calls));
+		json_object_object_add(method, "parses", json_object_new_int(counter.parses));
+		json_object_object_add(method, "failures", json_object_new_int(counter.failures));
+		json_object_object_add(method, "totalUs", json_object_new_int((int)counter.totalUs));
+		json_object_object_add(method, "maxUs", json_object_new_int((int)counter.maxUs));
+		json_object_array_add(methods, method);
+	}
+
+	JsonSchemaCache::Counters cacheCounters = JsonSchemaCache::counters();
+	json_object* schemaCache = json_object_new_object();
+	json_object_object_add(schemaCache, "hits", json_object_new_int(cacheCounters.hits));
+	json_object_object_add(schemaCache, "misses", json_object_new_int(cacheCounters.misses));
+	json_object_object_add(schemaCache, "schemas", json_object_new_int(cacheCounters.schemas));
 
-	json_object_object_add(json, "returnValue",json_object_new_boolean(true));
+	json_object_object_add(json, "returnValue", json_object_new_boolean(true));
+	json_object_object_add(json, "methods", methods);
+	json_object_object_add(json, "schemaCache", schemaCache);
 
-	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror )) {
+	if (!LSMessageReply( lshandle, message, json_object_to_json_string(json), &lserror ))
 		LSErrorFree(&lserror);
-	}
-
-	Done:
-	if (json)
-		json_object_put(json);
 
+	json_object_put(json);
 	return true;
 }
 
@@ -3558,11 +3881,13 @@ Subscription method to be informed when changes occur in launchPoints.
 \subsection com_palm_application_manager_launch_point_changes_syntax Syntax:
 \code
 {
-    "subscribe": boolean
+    "subscribe": boolean,
+    "batched": boolean
 }
 \endcode
 
 \param subscribe Set to true to be to be informed when changes occur in launchPoints.
+\param batched Optional. Set to true to get the changes of every 100 ms as one message (see below) instead of one message per change.
 
 \subsection com_palm_application_manager_launch_point_changes_returns Returns:
 \code
@@ -3619,6 +3944,28 @@ Example of a status change message when a launch point is added:
     "change": "added"
 }
 \endcode
+
+Example of a status change message for a batched subscription. Several changes to one launch point within
+a batch are folded into one; one added and removed again within it is left out.
+\code
+{
+    "launchPointChanges": [
+        {
+            "change": "added",
+            "launchPoint": {
+                "id": "com.palm.app.musicplayer",
+                "launchPointId": "00453104",
+                "title": "musaa",
+                ...
+            }
+        },
+        {
+            "change": "removed",
+            "launchPoint": { launch point object }
+        }
+    ]
+}
+\endcode
 */
 static bool servicecallback_launchPointChanges(LSHandle* lsHandle, LSMessage *message, void *userData)
 {
@@ -3629,18 +3976,25 @@ static bool servicecallback_launchPointChanges(LSHandle* lsHandle, LSMessage *me
 	bool success = false;
 	bool subscribed = false;
 
-    // {}
+    // {"subscribe": boolean, "batched": boolean}
 
-    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
-                               message,
-                               SCHEMA_ANY);
+    VALIDATE_SCHEMA_AND_PARSE(lsHandle,
+                              message,
+                              SCHEMA_ANY,
+                              request);
 
 	if (!LSMessageIsSubscription(message)) {
 		errMsg = "Only supports subscriptions";
 		goto Done;
 	}
 
-	success = LSSubscriptionProcess(lsHandle, message, &subscribed, &lsError);
+	if (request.value("batched").isBoolean() && request.value("batched").asBool()) {
+		success = LaunchPointChangeBatcher::subscribe(lsHandle, message, &lsError);
+		subscribed = success;
+	}
+	else {
+		success = LSSubscriptionProcess(lsHandle, message, &subscribed, &lsError);
+	}
 	if (!success) {
 		LSErrorFree (&lsError);
 		errMsg = "Failed to process subscription";
@@ -3759,12 +4113,17 @@ Get the complete mime table.
 \subsection com_palm_application_manager_dump_mime_table_syntax Syntax:
 \code
 {
+    "sinceGeneration": int
 }
 \endcode
 
+\param sinceGeneration Optional. The "generation" of an earlier reply; only what changed since is returned.
+
 \subsection com_palm_application_manager_dump_mime_table_returns Returns:
 \code
 {
+    "returnValue": true,
+    "generation": int,
     "resources": [
         {
             "mimeType": string,
@@ -3790,6 +4149,8 @@ Get the complete mime table.
 }
 \endcode
 
+\param returnValue Always true.
+\param generation Mime table generation the reply was built at.
 \param resources Object array with objects for different mime types and their resource handlers.
 \param mimeType The mime type.
 \param handlers Object which contains the primary handler followed by alternate handlers.
@@ -3797,6 +4158,10 @@ Get the complete mime table.
 \param url The URL pattern.
 \param handlers Object which contains the primary handler followed by alternate handlers.
 
+When \c sinceGeneration was given and is recent enough, \c resources and \c redirects only hold the entries
+added or changed since, \c "delta" is true and \c "removed" holds the mime types and URL patterns that went away:
+\c { "resources": [ string array ], "redirects": [ string array ] }. Otherwise the full table is returned.
+
 \subsection com_palm_application_manager_dump_mime_table_examples Examples:
 \code
 luna-send -n 1 -f luna://com.palm.applicationManager/dumpMimeTable '{}'
@@ -3866,18 +4231,18 @@ Example response for a succesful call:
 */
 static bool servicecallback_dumpMimeTable(LSHandle* lsHandle, LSMessage *message, void *userData)
 {
-	LSError     lsError;
-	LSErrorInit(&lsError);
-
-    // {}
+    // {"sinceGeneration": integer}
 
-    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
-                               message,
-                               SCHEMA_ANY);
+    VALIDATE_SCHEMA_AND_PARSE(lsHandle,
+                              message,
+                              s_listRequestSchema,
+                              request);
 
-	std::string s = ApplicationManager::instance()->mimeTableAsJsonString();
-	if (!LSMessageReply(lsHandle, message, s.c_str(), &lsError))
-		LSErrorFree (&lsError);
+	uint32_t since = 0;
+	if (listSinceGeneration(request, since))
+		replyWithResponse(lsHandle, message, MimeSystem::instance()->tablesResponse(since));
+	else
+		replyWithResponse(lsHandle, message, MimeSystem::instance()->tablesResponse());
 
 	return true;
 }
@@ -4032,7 +4397,7 @@ static bool servicecallback_addResourceHandler(LSHandle* lsHandle, LSMessage *me
 	}
 	else {
 		json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
-		MimeSystem::instance()->saveMimeTableToActiveFile(errorText);	//ignore errors
+		MimeSystem::instance()->scheduleSaveToActiveFile();
 	}
 
 	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &lserror))
@@ -4172,7 +4537,7 @@ static bool servicecallback_addRedirectHandler(LSHandle* lsHandle, LSMessage *me
 	}
 	else {
 		json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
-		MimeSystem::instance()->saveMimeTableToActiveFile(errorText);	//ignore errors
+		MimeSystem::instance()->scheduleSaveToActiveFile();
 	}
 
 	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &lserror))
@@ -4374,31 +4739,28 @@ static bool servicecallback_getHandlerForMimeType(LSHandle* lsHandle, LSMessage
 {
 	LSError lserror;
 	LSErrorInit(&lserror);
-	json_object* root = 0;
 	std::string errorText;
 	std::string mime;
 	ResourceHandler rsrcHandler;
 
     // {"mimeType": string}
 
-    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
-                               message,
-                               SCHEMA_1(REQUIRED(mimeType, string)));
+    VALIDATE_SCHEMA_AND_PARSE(lsHandle,
+                              message,
+                              SCHEMA_1(REQUIRED(mimeType, string)),
+                              request);
 
-	const char* str = LSMessageGetPayload( message );
-	if (!str) {
+	if (!request.payload()) {
 		errorText = "No payload provided";
 		goto Done_servicecallback_getHandlerForMimeType;
 	}
 
-	root = json_tokener_parse( str );
-	if (!root || is_error(root)) {
+	if (!request.isValid()) {
 		errorText = "Malformed JSON detected in payload";
-		root = 0;
 		goto Done_servicecallback_getHandlerForMimeType;
 	}
 
-	if (extractFromJson(root,"mimeType",mime) == false) {
+	if (request.getString("mimeType",mime) == false) {
 		errorText = "Missing mimeType parameter";
 		goto Done_servicecallback_getHandlerForMimeType;
 	}
@@ -4412,9 +4774,6 @@ static bool servicecallback_getHandlerForMimeType(LSHandle* lsHandle, LSMessage
 
 	Done_servicecallback_getHandlerForMimeType:
 
-	if (root)
-		json_object_put(root);
-
 	json_object * reply = json_object_new_object();
 	json_object_object_add(reply, "subscribed", json_object_new_boolean(false));
 	if (errorText.size() > 0) {
@@ -4645,7 +5004,6 @@ static bool servicecallback_getHandlerForUrl(LSHandle* lsHandle, LSMessage *mess
 
 	LSError lserror;
 	LSErrorInit(&lserror);
-	json_object* root = 0;
 	std::string errorText;
 	std::string url;
 	std::string mime;
@@ -4658,24 +5016,22 @@ static bool servicecallback_getHandlerForUrl(LSHandle* lsHandle, LSMessage *mess
 
     // {"url": string}
 
-    VALIDATE_SCHEMA_AND_RETURN(lsHandle,
-                               message,
-                               SCHEMA_1(REQUIRED(url, string)));
+    VALIDATE_SCHEMA_AND_PARSE(lsHandle,
+                              message,
+                              SCHEMA_1(REQUIRED(url, string)),
+                              request);
 
-	const char* str = LSMessageGetPayload( message );
-	if (!str) {
+	if (!request.payload()) {
 		errorText = "No payload provided";
 		goto Done_servicecallback_getHandlerForUrl;
 	}
 
-	root = json_tokener_parse( str );
-	if (!root || is_error(root)) {
+	if (!request.isValid()) {
 		errorText = "Malformed JSON detected in payload";
-		root = 0;
 		goto Done_servicecallback_getHandlerForUrl;
 	}
 
-	if (extractFromJson(root,"url",url) == false) {
+	if (request.getString("url",url) == false) {
 		errorText = "Missing url parameter";
 		goto Done_servicecallback_getHandlerForUrl;
 	}
@@ -4713,9 +5069,6 @@ static bool servicecallback_getHandlerForUrl(LSHandle* lsHandle, LSMessage *mess
 
 	Done_servicecallback_getHandlerForUrl:
 
-	if (root)
-		json_object_put(root);
-
 	json_object * reply = json_object_new_object();
 	json_object_object_add(reply, "subscribed", json_object_new_boolean(false));
 	if (errorText.size() > 0) {
@@ -6415,7 +6768,7 @@ static bool servicecallback_swapResourceHandler(LSHandle* lsHandle, LSMessage *m
 	}
 	else {
 		json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
-		MimeSystem::instance()->saveMimeTableToActiveFile(errorText);	//ignore errors
+		MimeSystem::instance()->scheduleSaveToActiveFile();
 	}
 
 	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &lserror))
@@ -6543,7 +6896,7 @@ static bool servicecallback_swapRedirectHandler(LSHandle* lsHandle, LSMessage *m
 	}
 	else {
 		json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
-		MimeSystem::instance()->saveMimeTableToActiveFile(errorText);	//ignore errors
+		MimeSystem::instance()->scheduleSaveToActiveFile();
 	}
 
 	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &lserror))
@@ -6756,7 +7109,7 @@ static bool servicecallback_registerVerbs(LSHandle* lsHandle, LSMessage *message
 	}
 	else {
 		json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
-		MimeSystem::instance()->saveMimeTableToActiveFile(errorText);	//ignore errors
+		MimeSystem::instance()->scheduleSaveToActiveFile();
 	}
 
 	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &lserror))
@@ -6871,7 +7224,7 @@ static bool servicecallback_removeHandlersForAppId(LSHandle* lsHandle, LSMessage
 	else {
 		json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
 		//save the table to active file
-		MimeSystem::instance()->saveMimeTableToActiveFile(errorText);	//ignore errors
+		MimeSystem::instance()->scheduleSaveToActiveFile();
 	}
 
 	if (!LSMessageReply(lsHandle, message, json_object_to_json_string(reply), &lserror))
@@ -7403,6 +7756,7 @@ void ApplicationManager::postLaunchPointChange(const LaunchPoint* lp, const std:
 	LSErrorInit(&lsError);
 	json_object* json = 0;
 
+	registryChanged();
 
 	if (change == "removed") {
 		Q_EMIT signalLaunchPointRemoved(lp);
@@ -7421,8 +7775,16 @@ void ApplicationManager::postLaunchPointChange(const LaunchPoint* lp, const std:
 	}
 
 	json = lp->toJSON();
+	g_debug("%s: Posting LaunchPoint change %s %s", __PRETTY_FUNCTION__, change.c_str(), lp->launchPointId().c_str());
+
+	// batched subscribers get it with the other changes of the next s_launchPointBatchMs
+	{
+		MutexLocker locker(&m_launchPointChangeMutex);
+		m_launchPointChanges->queueChange(lp->launchPointId(), change, json_object_to_json_string(json));
+	}
+	scheduleLaunchPointFlush(s_launchPointBatchMs);
+
 	json_object_object_add(json, "change", json_object_new_string(change.c_str()));
-	g_message("%s: Posting LaunchPoint change %s", __PRETTY_FUNCTION__, json_object_to_json_string(json));
 	if (!LSSubscriptionPost(m_serviceHandlePrivate, "/", "launchPointChanges", 
 			json_object_to_json_string(json), &lsError))
 		LSErrorFree (&lsError);
@@ -7431,6 +7793,100 @@ void ApplicationManager::postLaunchPointChange(const LaunchPoint* lp, const std:
 		json_object_put(json);
 }
 
+// true if an installer progress update of appId may be signalled now; if not, it is signalled at the next flush
+bool ApplicationManager::passLaunchPointProgress(const std::string& appId)
+{
+	bool pass;
+	unsigned int due = 0;
+	{
+		MutexLocker locker(&m_launchPointChangeMutex);
+		pass = m_launchPointChanges->passProgress(appId, monotonicMs());
+		if (!pass)
+			due = m_launchPointChanges->nextProgressDue(monotonicMs());
+	}
+
+	if (!pass)
+		scheduleLaunchPointFlush(due);
+	return pass;
+}
+
+void ApplicationManager::dropLaunchPointProgress(const std::string& appId)
+{
+	MutexLocker locker(&m_launchPointChangeMutex);
+	m_launchPointChanges->dropProgress(appId);
+}
+
+// changes queued while a flush is scheduled go out with it, unless they need it sooner (a launch point change
+// mustn't wait for a held back progress update that is due later)
+void ApplicationManager::scheduleLaunchPointFlush(unsigned int delayMs)
+{
+	uint64_t due = monotonicMs() + delayMs;
+
+	MutexLocker locker(&m_launchPointChangeMutex);
+	if (m_launchPointFlushSource) {
+		if (m_launchPointFlushDue <= due)
+			return;
+		g_source_remove(m_launchPointFlushSource);
+	}
+	m_launchPointFlushSource = g_timeout_add(delayMs, cbFlushLaunchPointChanges, this);
+	m_launchPointFlushDue = due;
+}
+
+gboolean ApplicationManager::cbFlushLaunchPointChanges(gpointer data)
+{
+	ApplicationManager* appMgr = static_cast<ApplicationManager*>(data);
+	{
+		MutexLocker locker(&appMgr->m_launchPointChangeMutex);
+		appMgr->m_launchPointFlushSource = 0;
+	}
+	appMgr->flushLaunchPointChanges();
+	return FALSE;
+}
+
+void ApplicationManager::flushLaunchPointChanges()
+{
+	// for looking up the pending apps of held back progress; always taken before m_launchPointChangeMutex
+	MutexLocker locker(&m_mutex);
+
+	std::string batch;
+	std::vector<std::string> dueProgress;
+	{
+		MutexLocker changeLocker(&m_launchPointChangeMutex);
+		if (m_launchPointChanges->hasChanges())
+			batch = m_launchPointChanges->takeChanges();
+		dueProgress = m_launchPointChanges->takeDueProgress(monotonicMs());
+	}
+
+	if (!batch.empty()) {
+		LSError lsError;
+		LSErrorInit(&lsError);
+		if (!LaunchPointChangeBatcher::post(m_serviceHandlePrivate, batch, &lsError))
+			LSErrorFree (&lsError);
+	}
+
+	for (std::vector<std::string>::const_iterator it = dueProgress.begin(); it != dueProgress.end(); ++it) {
+		ApplicationDescription* appDesc = getPendingAppById(*it);
+		if (!appDesc)
+			continue;
+		QBitArray statusBits = QBitArray(LaunchPointUpdatedReason::SIZEOF);
+		statusBits.setBit(LaunchPointUpdatedReason::Status);
+		statusBits.setBit(LaunchPointUpdatedReason::Progress);
+		Q_EMIT signalLaunchPointUpdated(appDesc->getDefaultLaunchPoint(),statusBits);
+	}
+
+	bool held;
+	unsigned int nextDue = 0;
+	{
+		MutexLocker changeLocker(&m_launchPointChangeMutex);
+		held = m_launchPointChanges->hasHeldProgress();
+		if (held)
+			nextDue = m_launchPointChanges->nextProgressDue(monotonicMs());
+	}
+
+	if (held)
+		scheduleLaunchPointFlush(nextDue);
+}
+
 /*!
  *	\fn com.palm.applicationManager/running
  *	\brief List all running applications in the system manager.
@@ -8113,6 +8569,9 @@ static LSMethod appMgrMethodsPrivate[] = {
 		{ "addDockModeLaunchPoint", servicecallback_addDockModeLaunchPoint },
 		{ "removeDockModeLaunchPoint", servicecallback_removeDockModeLaunchPoint },
 		{ "rescan", servicecallback_rescan },
+		{ "scanStats", servicecallback_scanStats },
+		{ "launchStats", servicecallback_launchStats },
+		{ "parseStats", servicecallback_parseStats },
 		{ "launchPointChanges", servicecallback_launchPointChanges },
 		{ "inspect", servicecallback_inspect },
 		{ "getResourceInfo", servicecallback_getresourceinfo },
@@ -0,0 +1,384 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "ApplicationScanner.h"
+#include "Utils.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cjson/json.h>
+
+static const int s_cacheVersion = 1;
+static const unsigned int s_maxWorkerThreads = 4;
+
+// stat values are stored as decimal strings: cjson ints are only 32 bits
+static void addStatValue(json_object* obj, const char* key, unsigned long long value)
+{
+	gchar* str = g_strdup_printf("%llu", value);
+	json_object_object_add(obj, key, json_object_new_string(str));
+	g_free(str);
+}
+
+static bool getStatValue(json_object* obj, const char* key, unsigned long long& r_value)
+{
+	json_object* label = json_object_object_get(obj, key);
+	if (!label || is_error(label) || !json_object_is_type(label, json_type_string))
+		return false;
+	r_value = strtoull(json_object_get_string(label), NULL, 10);
+	return true;
+}
+
+static bool getStringValue(json_object* obj, const char* key, std::string& r_value)
+{
+	json_object* label = json_object_object_get(obj, key);
+	if (!label || is_error(label) || !json_object_is_type(label, json_type_string))
+		return false;
+	r_value = json_object_get_string(label);
+	return true;
+}
+
+ApplicationScanner::ApplicationScanner(const std::string& cachePath, const std::string& locale)
+	: m_cachePath(cachePath)
+	, m_locale(locale)
+	, m_dirty(false)
+	, m_workerThreads(0)
+	, m_cacheHits(0)
+	, m_cacheMisses(0)
+	, m_filesParsed(0)
+{
+	long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+	m_workerThreads = (cpus > 0) ? (unsigned int)cpus : 1;
+	if (m_workerThreads > s_maxWorkerThreads)
+		m_workerThreads = s_maxWorkerThreads;
+
+	loadCache();
+}
+
+ApplicationScanner::~ApplicationScanner()
+{
+	EntryMap* maps[] = { &m_cached, &m_entries };
+	for (unsigned int i = 0; i < G_N_ELEMENTS(maps); i++) {
+		for (EntryMap::iterator it = maps[i]->begin(); it != maps[i]->end(); ++it) {
+			if (it->second->root)
+				json_object_put(it->second->root);
+			delete it->second;
+		}
+		maps[i]->clear();
+	}
+}
+
+void ApplicationScanner::appInfoCandidates(const std::string& appFolderPath, const std::string& locale,
+										   std::vector<std::string>& r_paths)
+{
+	std::string language, region;
+	std::size_t underscorePos = locale.find("_");
+	if (underscorePos != std::string::npos) {
+		language = locale.substr(0, underscorePos);
+		region = locale.substr(underscorePos+1);
+	}
+
+	r_paths.clear();
+	if (!language.empty() && !region.empty())
+		r_paths.push_back(appFolderPath + "/resources/" + language + "/" + region + "/appinfo.json");
+	r_paths.push_back(appFolderPath + "/resources/" + language + "/appinfo.json");
+	r_paths.push_back(appFolderPath + "/resources/" + locale + "/appinfo.json");
+	r_paths.push_back(appFolderPath + "/appinfo.json");
+}
+
+void ApplicationScanner::loadCache()
+{
+	if (m_cachePath.empty())
+		return;
+
+	char* jsonStr = readFile(m_cachePath.c_str());
+	if (!jsonStr)
+		return;
+
+	json_object* root = json_tokener_parse(jsonStr);
+	delete [] jsonStr;
+
+	if (!root || is_error(root))
+		return;
+
+	json_object* label = json_object_object_get(root, "version");
+	std::string locale;
+	if (!label || is_error(label) || json_object_get_int(label) != s_cacheVersion ||
+		!getStringValue(root, "locale", locale) || locale != m_locale) {
+		// written by a different format or for a different locale; everything gets re-read
+		g_message("%s: discarding app scan cache %s", __FUNCTION__, m_cachePath.c_str());
+		json_object_put(root);
+		m_dirty = true;
+		return;
+	}
+
+	json_object* folders = json_object_object_get(root, "folders");
+	if (folders && !is_error(folders) && json_object_is_type(folders, json_type_array)) {
+
+		for (int i = 0; i < json_object_array_length(folders); i++) {
+
+			json_object* item = json_object_array_get_idx(folders, i);
+			if (!item || is_error(item))
+				continue;
+
+			json_object* appInfo = json_object_object_get(item, "appinfo");
+			if (!appInfo || is_error(appInfo) || !json_object_is_type(appInfo, json_type_object))
+				continue;
+
+			Entry* entry = new Entry();
+			unsigned long long folderMtime, folderInode, fileMtime, fileInode, fileSize;
+			if (!getStringValue(item, "folder", entry->folderPath) ||
+				!getStringValue(item, "path", entry->appInfoPath) ||
+				!getStatValue(item, "folderMtime", folderMtime) ||
+				!getStatValue(item, "folderInode", folderInode) ||
+				!getStatValue(item, "mtime", fileMtime) ||
+				!getStatValue(item, "inode", fileInode) ||
+				!getStatValue(item, "size", fileSize) ||
+				m_cached.find(entry->folderPath) != m_cached.end()) {
+				delete entry;
+				continue;
+			}
+
+			entry->folderMtime = (time_t) folderMtime;
+			entry->folderInode = (ino_t) folderInode;
+			entry->fileMtime = (time_t) fileMtime;
+			entry->fileInode = (ino_t) fileInode;
+			entry->fileSize = (off_t) fileSize;
+			entry->root = json_object_get(appInfo);		// outlives the document
+
+			m_cached[entry->folderPath] = entry;
+		}
+	}
+
+	json_object_put(root);
+}
+
+bool ApplicationScanner::entryIsCurrent(const Entry* entry) const
+{
+	struct stat stBuf;
+
+	if (::stat(entry->folderPath.c_str(), &stBuf) != 0 ||
+		stBuf.st_mtime != entry->folderMtime || stBuf.st_ino != entry->folderInode)
+		return false;
+
+	if (::stat(entry->appInfoPath.c_str(), &stBuf) != 0 ||
+		stBuf.st_mtime != entry->fileMtime || stBuf.st_ino != entry->fileInode || stBuf.st_size != entry->fileSize)
+		return false;
+
+	// a more specific localized appinfo.json showing up under resources/ doesn't touch the app folder itself
+	std::vector<std::string> candidates;
+	appInfoCandidates(entry->folderPath, m_locale, candidates);
+	for (unsigned int i = 0; i < candidates.size(); i++) {
+		if (candidates[i] == entry->appInfoPath)
+			return true;
+		if (::access(candidates[i].c_str(), F_OK) == 0)
+			return false;
+	}
+
+	return false;
+}
+
+// runs on a worker thread; touches nothing but the entry
+void ApplicationScanner::parseEntry(Entry* entry)
+{
+	struct stat stBuf;
+	if (::stat(entry->folderPath.c_str(), &stBuf) != 0)
+		return;
+	entry->folderMtime = stBuf.st_mtime;
+	entry->folderInode = stBuf.st_ino;
+
+	std::vector<std::string> candidates;
+	appInfoCandidates(entry->folderPath, m_locale, candidates);
+
+	for (unsigned int i = 0; i < candidates.size(); i++) {
+
+		if (::stat(candidates[i].c_str(), &stBuf) != 0)
+			continue;
+
+		char* jsonStr = readFile(candidates[i].c_str());
+		if (!jsonStr || !g_utf8_validate(jsonStr, -1, NULL)) {
+			delete [] jsonStr;
+			continue;
+		}
+
+		json_object* root = json_tokener_parse(jsonStr);
+		delete [] jsonStr;
+		g_atomic_int_inc(&m_filesParsed);
+
+		if (!root || is_error(root))
+			continue;
+
+		// same acceptance test as ApplicationDescription::fromFile(): an object with an id and a title
+		json_object* id = 0;
+		json_object* title = 0;
+		if (!json_object_is_type(root, json_type_object) ||
+			!(id = json_object_object_get(root, "id")) || is_error(id) ||
+			!(title = json_object_object_get(root, "title")) || is_error(title)) {
+			json_object_put(root);
+			continue;
+		}
+
+		entry->appInfoPath = candidates[i];
+		entry->fileMtime = stBuf.st_mtime;
+		entry->fileInode = stBuf.st_ino;
+		entry->fileSize = stBuf.st_size;
+		entry->root = root;
+		return;
+	}
+}
+
+void ApplicationScanner::workerFunc(gpointer data, gpointer userData)
+{
+	static_cast<ApplicationScanner*>(userData)->parseEntry(static_cast<Entry*>(data));
+}
+
+void ApplicationScanner::prefetch(const std::vector<std::string>& appFolderPaths)
+{
+	std::vector<Entry*> misses;
+
+	for (std::vector<std::string>::const_iterator it = appFolderPaths.begin(); it != appFolderPaths.end(); ++it) {
+
+		if (m_entries.find(*it) != m_entries.end())
+			continue;
+
+		EntryMap::iterator cacheIt = m_cached.find(*it);
+		if (cacheIt != m_cached.end()) {
+			Entry* entry = cacheIt->second;
+			m_cached.erase(cacheIt);
+
+			if (entryIsCurrent(entry)) {
+				m_entries[*it] = entry;
+				m_cacheHits++;
+				continue;
+			}
+
+			if (entry->root)
+				json_object_put(entry->root);
+			delete entry;
+		}
+
+		Entry* entry = new Entry();
+		entry->folderPath = *it;
+		m_entries[*it] = entry;
+		misses.push_back(entry);
+	}
+
+	if (misses.empty())
+		return;
+
+	m_cacheMisses += misses.size();
+	m_dirty = true;
+
+	GThreadPool* pool = 0;
+	if (misses.size() > 1 && m_workerThreads > 1)
+		pool = g_thread_pool_new(workerFunc, this, m_workerThreads, FALSE, NULL);
+
+	if (!pool) {
+		for (unsigned int i = 0; i < misses.size(); i++)
+			parseEntry(misses[i]);
+		return;
+	}
+
+	for (unsigned int i = 0; i < misses.size(); i++)
+		g_thread_pool_push(pool, misses[i], NULL);
+
+	// waits for the queue to drain
+	g_thread_pool_free(pool, FALSE, TRUE);
+}
+
+json_object* ApplicationScanner::appInfo(const std::string& appFolderPath, std::string& r_appInfoPath)
+{
+	EntryMap::const_iterator it = m_entries.find(appFolderPath);
+	if (it == m_entries.end() || !it->second->root)
+		return 0;
+
+	r_appInfoPath = it->second->appInfoPath;
+	return it->second->root;
+}
+
+bool ApplicationScanner::saveCache()
+{
+	// folders that dropped out since the last scan also make the manifest stale
+	if (!m_cached.empty())
+		m_dirty = true;
+
+	if (!m_dirty || m_cachePath.empty())
+		return true;
+
+	json_object* root = json_object_new_object();
+	json_object* folders = json_object_new_array();
+
+	json_object_object_add(root, "version", json_object_new_int(s_cacheVersion));
+	json_object_object_add(root, "locale", json_object_new_string(m_locale.c_str()));
+
+	for (EntryMap::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+
+		const Entry* entry = it->second;
+		if (!entry->root)
+			continue;
+
+		json_object* item = json_object_new_object();
+		json_object_object_add(item, "folder", json_object_new_string(entry->folderPath.c_str()));
+		json_object_object_add(item, "path", json_object_new_string(entry->appInfoPath.c_str()));
+		addStatValue(item, "folderMtime", entry->folderMtime);
+		addStatValue(item, "folderInode", entry->folderInode);
+		addStatValue(item, "mtime", entry->fileMtime);
+		addStatValue(item, "inode", entry->fileInode);
+		addStatValue(item, "size", entry->fileSize);
+		json_object_object_add(item, "appinfo", json_object_get(entry->root));
+
+		json_object_array_add(folders, item);
+	}
+
+	json_object_object_add(root, "folders", folders);
+
+	// write to the side and rename over, so a crash mid-write never leaves a truncated manifest
+	std::string tmpPath = m_cachePath + ".tmp";
+	bool success = false;
+
+	FILE* fp = fopen(tmpPath.c_str(), "w");
+	if (fp) {
+		const char* jsonStr = json_object_to_json_string(root);
+		size_t len = strlen(jsonStr);
+		success = (fwrite(jsonStr, 1, len, fp) == len);
+		success = (fflush(fp) == 0) && success;
+		success = (fsync(fileno(fp)) == 0) && success;
+		fclose(fp);
+
+		if (success)
+			success = (::rename(tmpPath.c_str(), m_cachePath.c_str()) == 0);
+		if (!success)
+			::unlink(tmpPath.c_str());
+	}
+
+	if (!success)
+		g_warning("%s: failed to write app scan cache %s", __FUNCTION__, m_cachePath.c_str());
+	else
+		m_dirty = false;
+
+	json_object_put(root);
+	return success;
+}
@@ -0,0 +1,117 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef APPLICATIONSCANNER_H
+#define APPLICATIONSCANNER_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/types.h>
+#include <glib.h>
+
+struct json_object;
+
+/*
+ * Reads and parses the appinfo.json files of a set of application folders ahead of
+ * ApplicationManager::scanOneApplicationFolder().
+ *
+ * prefetch() resolves each folder's appinfo.json using the same locale search order as
+ * scanOneApplicationFolder() and reads/validates/parses the misses on a small thread pool.
+ * Folders whose folder and appinfo.json stat (mtime, inode, size) match the manifest cache
+ * written by the previous scan are served straight from the cache without touching the file.
+ *
+ * Only the file work is done off the main thread: building the ApplicationDescription (which
+ * registers mime handlers and creates sysmgr builtin launchers) stays with the caller, in the
+ * caller's order, so scan results are identical to the serial scan.
+ *
+ * A scanner lives for the duration of one ApplicationManager::scan(); it is NOT thread safe
+ * apart from its own worker pool.
+ */
+class ApplicationScanner
+{
+public:
+
+	ApplicationScanner(const std::string& cachePath, const std::string& locale);
+	~ApplicationScanner();
+
+	// read and parse the appinfo.json of every folder in the list that isn't already known
+	void prefetch(const std::vector<std::string>& appFolderPaths);
+
+	// the parsed appinfo.json for the folder (owned by the scanner), and the path it came from.
+	// NULL if the folder was never prefetched or has no usable appinfo.json
+	struct json_object* appInfo(const std::string& appFolderPath, std::string& r_appInfoPath);
+
+	// write the manifest cache for the folders seen during this scan; only if something changed
+	bool saveCache();
+
+	unsigned int cacheHits() const { return m_cacheHits; }
+	unsigned int cacheMisses() const { return m_cacheMisses; }
+	unsigned int filesParsed() const { return m_filesParsed; }
+	unsigned int workerThreads() const { return m_workerThreads; }
+
+	// the appinfo.json candidates for a folder, in the order scanOneApplicationFolder() tries them
+	static void appInfoCandidates(const std::string& appFolderPath, const std::string& locale,
+								  std::vector<std::string>& r_paths);
+
+private:
+
+	struct Entry {
+		Entry() : folderMtime(0), folderInode(0), fileMtime(0), fileInode(0), fileSize(0), root(0) {}
+
+		std::string folderPath;
+		std::string appInfoPath;
+		time_t	folderMtime;
+		ino_t	folderInode;
+		time_t	fileMtime;
+		ino_t	fileInode;
+		off_t	fileSize;
+		struct json_object* root;
+	};
+
+	typedef std::map<std::string, Entry*> EntryMap;
+
+	void loadCache();
+	bool entryIsCurrent(const Entry* entry) const;
+	void parseEntry(Entry* entry);
+
+	static void workerFunc(gpointer data, gpointer userData);
+
+	std::string m_cachePath;
+	std::string m_locale;
+
+	EntryMap m_cached;		// from the manifest written by the last scan
+	EntryMap m_entries;		// folders seen during this scan
+
+	bool m_dirty;
+	unsigned int m_workerThreads;
+
+	unsigned int m_cacheHits;
+	unsigned int m_cacheMisses;
+	volatile gint m_filesParsed;
+
+	ApplicationScanner(const ApplicationScanner&);
+	ApplicationScanner& operator=(const ApplicationScanner&);
+};
+
+#endif /* APPLICATIONSCANNER_H */
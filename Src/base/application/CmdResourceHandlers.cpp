@@ -36,22 +36,14 @@ RedirectHandler::RedirectHandler(const std::string& urlRe, const std::string& ap
 	m_urlRe(urlRe), m_appId(appId) , m_valid(true) , m_schemeForm(schemeform) , m_tag("")
 {
 	m_index = MimeSystem::assignIndex();
-	if (!urlRe.empty() && 0 == regcomp(&m_urlReg, urlRe.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
-	}
-	else {
-		::memset(&m_urlReg, 0, sizeof(m_urlReg));
-	}
+	m_urlReg = compileRe(urlRe);
 }
 
 RedirectHandler::RedirectHandler(const std::string& urlRe, const std::string& appId , bool schemeform, const std::string& handler_tag) :
 	m_urlRe(urlRe), m_appId(appId) , m_valid(true), m_schemeForm(schemeform) , m_tag(handler_tag)
 {
 	m_index = MimeSystem::assignIndex();
-	if (!urlRe.empty() && 0 == regcomp(&m_urlReg, urlRe.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
-	}
-	else {
-		::memset(&m_urlReg, 0, sizeof(m_urlReg));
-	}
+	m_urlReg = compileRe(urlRe);
 }
 
 RedirectHandler::RedirectHandler(const RedirectHandler& c) 
@@ -64,21 +56,17 @@ RedirectHandler::RedirectHandler(const RedirectHandler& c)
 	m_schemeForm = c.m_schemeForm;
 	m_verbs = c.m_verbs;
 	
-	if (!m_urlRe.empty() && 0 == regcomp(&m_urlReg, m_urlRe.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
-	}
-	else {
-		::memset(&m_urlReg, 0, sizeof(m_urlReg));
-	}
-	
+	m_urlReg = acquireRe(c.m_urlReg);
 }
+
 RedirectHandler& RedirectHandler::operator=(const RedirectHandler& c) 
 {
 	if (this == &c)
 		return *this;
 	
-	if (reValid()) {
-		regfree(&m_urlReg);
-	}
+	CompiledRe* previous = m_urlReg;
+	m_urlReg = acquireRe(c.m_urlReg);
+	releaseRe(previous);
 	
 	m_urlRe = c.m_urlRe;
 	m_appId = c.m_appId;
@@ -88,18 +76,11 @@ RedirectHandler& RedirectHandler::operator=(const RedirectHandler& c)
 	m_schemeForm = c.m_schemeForm;
 	m_verbs = c.m_verbs;
 	
-	if (!m_urlRe.empty() && 0 == regcomp(&m_urlReg, m_urlRe.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
-	}
-	else {
-		::memset(&m_urlReg, 0, sizeof(m_urlReg));
-	}
-	
 	return *this;
 }
 
-RedirectHandler::RedirectHandler() : m_valid(false), m_schemeForm(false), m_index(0)
+RedirectHandler::RedirectHandler() : m_urlReg(0), m_valid(false), m_schemeForm(false), m_index(0)
 {
-	::memset(&m_urlReg, 0, sizeof(m_urlReg));
 }
 
 /**
@@ -107,8 +88,39 @@ RedirectHandler::RedirectHandler() : m_valid(false), m_schemeForm(false), m_inde
  */
 RedirectHandler::~RedirectHandler()
 {
-	if (reValid()) {
-		regfree(&m_urlReg);
+	releaseRe(m_urlReg);
+}
+
+//static
+RedirectHandler::CompiledRe* RedirectHandler::compileRe(const std::string& urlRe)
+{
+	if (urlRe.empty())
+		return 0;
+	
+	CompiledRe* compiled = new CompiledRe;
+	if (regcomp(&compiled->re, urlRe.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0) {
+		delete compiled;
+		return 0;
+	}
+	
+	compiled->refCount = 1;
+	return compiled;
+}
+
+//static
+RedirectHandler::CompiledRe* RedirectHandler::acquireRe(CompiledRe* compiled)
+{
+	if (compiled)
+		g_atomic_int_inc(&compiled->refCount);
+	return compiled;
+}
+
+//static
+void RedirectHandler::releaseRe(CompiledRe* compiled)
+{
+	if (compiled && g_atomic_int_dec_and_test(&compiled->refCount)) {
+		regfree(&compiled->re);
+		delete compiled;
 	}
 }
 
@@ -118,7 +130,7 @@ RedirectHandler::~RedirectHandler()
  */
 bool RedirectHandler::matches(const std::string& url) const
 {
-	return !url.empty() && reValid() && regexec(&m_urlReg, url.c_str(), 0, NULL, 0) == 0;
+	return !url.empty() && reValid() && regexec(&m_urlReg->re, url.c_str(), 0, NULL, 0) == 0;
 }
 
 /**
@@ -126,7 +138,7 @@ bool RedirectHandler::matches(const std::string& url) const
  */
 bool RedirectHandler::reValid() const
 {
-	return m_urlReg.buffer != NULL;
+	return m_urlReg != NULL;
 }
 
 bool RedirectHandler::addVerb(const std::string& verb,const std::string& jsonizedParams)
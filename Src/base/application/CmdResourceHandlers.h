@@ -27,6 +27,7 @@
 
 #include <regex.h>
 #include <stdint.h>
+#include <glib.h>
 #include <string>
 #include <vector>
 #include <map>
@@ -89,9 +90,19 @@ class RedirectHandler
 		
 	private:
 		
+		// the compiled form of m_urlRe; copies of a handler share it instead of compiling it again
+		struct CompiledRe {
+			regex_t re;
+			volatile gint refCount;
+		};
+
+		static CompiledRe* compileRe(const std::string& urlRe);
+		static CompiledRe* acquireRe(CompiledRe* compiled);
+		static void releaseRe(CompiledRe* compiled);
+
 		std::string m_urlRe; ///< The URL regular expression
 		std::string m_appId;
-		regex_t m_urlReg; ///< The compiled URL regular expression
+		CompiledRe* m_urlReg; ///< The compiled URL regular expression, NULL if it didn't compile
 		bool	m_valid;
 		bool	m_schemeForm;
 		std::string m_tag;
@@ -0,0 +1,112 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef INSTALLERCOMMANDSCHEDULER_H
+#define INSTALLERCOMMANDSCHEDULER_H
+
+#include <list>
+#include <set>
+#include <string>
+#include <algorithm>
+
+/*
+ * Decides which of the queued install and remove commands of ApplicationInstaller may run.
+ *
+ * Up to maxRunning() commands run at the same time. Commands on the same package (Command::packageKey())
+ * run one after the other in the order they were queued; a command never overtakes an earlier one on
+ * its package. Commands on different packages start in queue order as slots free up, and finish in
+ * whatever order they finish.
+ *
+ * The scheduler only keeps the bookkeeping; starting a command and noticing that it is done is up to
+ * the caller. It does not own the commands.
+ */
+template<typename Command>
+class InstallerCommandScheduler
+{
+public:
+	InstallerCommandScheduler(unsigned int maxRunning = 1)
+		: m_maxRunning(maxRunning ? maxRunning : 1)
+	{
+	}
+
+	unsigned int maxRunning() const { return m_maxRunning; }
+	void setMaxRunning(unsigned int maxRunning) { m_maxRunning = maxRunning ? maxRunning : 1; }
+
+	void queue(Command* cmd)
+	{
+		m_pending.push_back(cmd);
+	}
+
+	// the oldest queued command that may start now, moved over to the running ones; 0 if there is none
+	Command* takeNext()
+	{
+		if (m_running.size() >= m_maxRunning)
+			return 0;
+
+		std::set<std::string> busy;
+		for (typename CommandList::const_iterator it = m_running.begin(); it != m_running.end(); ++it)
+			busy.insert((*it)->packageKey());
+
+		for (typename CommandList::iterator it = m_pending.begin(); it != m_pending.end(); ++it) {
+			if (busy.find((*it)->packageKey()) != busy.end())
+				continue;
+
+			Command* cmd = *it;
+			m_pending.erase(it);
+			m_running.push_back(cmd);
+			return cmd;
+		}
+
+		return 0;
+	}
+
+	// the command is done, or failed to start
+	void finished(Command* cmd)
+	{
+		m_running.remove(cmd);
+		m_pending.remove(cmd);
+	}
+
+	// puts a running command back at the head of the queue, to be started again
+	void requeue(Command* cmd)
+	{
+		if (std::find(m_running.begin(), m_running.end(), cmd) == m_running.end())
+			return;
+
+		m_running.remove(cmd);
+		m_pending.push_front(cmd);
+	}
+
+	bool isIdle() const { return m_running.empty(); }
+	bool isEmpty() const { return m_running.empty() && m_pending.empty(); }
+
+	const std::list<Command*>& running() const { return m_running; }
+	const std::list<Command*>& pending() const { return m_pending; }
+
+private:
+	typedef std::list<Command*> CommandList;
+
+	unsigned int m_maxRunning;
+	CommandList m_pending;		// in the order they were queued
+	CommandList m_running;		// in the order they were started
+};
+
+#endif /* INSTALLERCOMMANDSCHEDULER_H */
@@ -225,6 +225,12 @@ std::string LaunchPoint::entryPoint() const
 	return "";
 }
 
+//static
+const gchar* LaunchPoint::titleDelimiters()
+{
+	return " ,._-:;()\\[]{}\"/";
+}
+
 bool LaunchPoint::matchesTitle(const gchar* str) const
 {
 	if (!str || !m_title.lowercase)
@@ -233,7 +239,7 @@ bool LaunchPoint::matchesTitle(const gchar* str) const
 	if (g_str_has_prefix(m_title.lowercase, str))
 		return true;
 
-	static const gchar* delimiters = " ,._-:;()\\[]{}\"/";
+	static const gchar* delimiters = titleDelimiters();
 	static size_t len = strlen(delimiters);
 	bool matches = false;
 	const gchar* start = m_title.lowercase;
@@ -65,6 +65,7 @@ public:
 	const std::string& id() const               { return m_id; }
 	const std::string& launchPointId() const    { return m_launchPointId; }
 	const std::string& title() const            { return m_title.original; }
+	const gchar* lowercaseTitle() const         { return m_title.lowercase; }
 	const std::string& menuName() const			{ return m_appmenuName; }
 	const std::string& iconPath() const         { return m_iconPath; }
 	const std::string& params() const           { return m_params; }
@@ -77,6 +78,7 @@ public:
 	std::string entryPoint() const;
 
 	bool matchesTitle(const gchar* str) const;
+	static const gchar* titleDelimiters();		// a title word starts at the beginning or after one of these
 	int compareByKeys(const LaunchPoint* lp) const;
 
 	bool				isVisible() const;
@@ -0,0 +1,149 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "LaunchPointChangeBatcher.h"
+
+#include <algorithm>
+
+// LSSubscriptionAdd() files a subscriber under this key as given; it is not a category + method path
+static const char* s_subscriptionKey = "launchPointChangesBatched";
+
+LaunchPointChangeBatcher::LaunchPointChangeBatcher(unsigned int progressIntervalMs)
+	: m_progressIntervalMs(progressIntervalMs)
+{
+}
+
+bool LaunchPointChangeBatcher::subscribe(LSHandle* lsHandle, LSMessage* message, LSError* lsError)
+{
+	return LSSubscriptionAdd(lsHandle, s_subscriptionKey, message, lsError);
+}
+
+bool LaunchPointChangeBatcher::post(LSHandle* lsHandle, const std::string& batch, LSError* lsError)
+{
+	return LSSubscriptionReply(lsHandle, s_subscriptionKey, batch.c_str(), lsError);
+}
+
+void LaunchPointChangeBatcher::queueChange(const std::string& launchPointId, const std::string& change, const std::string& json)
+{
+	std::map<std::string, Change>::iterator it = m_changes.find(launchPointId);
+	if (it == m_changes.end()) {
+		Change c;
+		c.change = change;
+		c.json = json;
+		m_changes[launchPointId] = c;
+		m_order.push_back(launchPointId);
+		return;
+	}
+
+	const std::string& queued = it->second.change;
+	if (queued == "added" && change == "removed") {
+		// came and went within the batch; nobody has seen it
+		m_changes.erase(it);
+		m_order.erase(std::find(m_order.begin(), m_order.end(), launchPointId));
+		return;
+	}
+
+	// an added one stays added: it is still new to subscribers
+	if (queued == "removed" && change == "added")
+		it->second.change = "updated";
+	else if (queued != "added")
+		it->second.change = change;
+
+	it->second.json = json;
+}
+
+std::string LaunchPointChangeBatcher::takeChanges()
+{
+	size_t size = 32;
+	for (std::map<std::string, Change>::const_iterator it = m_changes.begin(); it != m_changes.end(); ++it)
+		size += it->second.json.size() + 40;
+
+	std::string message;
+	message.reserve(size);
+	message += "{\"launchPointChanges\":[";
+	for (std::vector<std::string>::const_iterator it = m_order.begin(); it != m_order.end(); ++it) {
+		const Change& c = m_changes[*it];
+		if (it != m_order.begin())
+			message += ",";
+		message += "{\"change\":\"" + c.change + "\",\"launchPoint\":" + c.json + "}";
+	}
+	message += "]}";
+
+	m_order.clear();
+	m_changes.clear();
+	return message;
+}
+
+bool LaunchPointChangeBatcher::passProgress(const std::string& key, uint64_t nowMs)
+{
+	std::map<std::string, uint64_t>::iterator it = m_lastProgress.find(key);
+	if (it == m_lastProgress.end() || nowMs >= it->second + m_progressIntervalMs) {
+		m_lastProgress[key] = nowMs;
+		m_held.erase(key);
+		return true;
+	}
+
+	m_held.insert(key);
+	return false;
+}
+
+void LaunchPointChangeBatcher::dropProgress(const std::string& key)
+{
+	m_lastProgress.erase(key);
+	m_held.erase(key);
+}
+
+std::vector<std::string> LaunchPointChangeBatcher::takeDueProgress(uint64_t nowMs)
+{
+	std::vector<std::string> due;
+	for (std::set<std::string>::iterator it = m_held.begin(); it != m_held.end(); ) {
+		uint64_t& last = m_lastProgress[*it];
+		if (nowMs >= last + m_progressIntervalMs) {
+			last = nowMs;
+			due.push_back(*it);
+			m_held.erase(it++);
+		}
+		else {
+			++it;
+		}
+	}
+	return due;
+}
+
+unsigned int LaunchPointChangeBatcher::nextProgressDue(uint64_t nowMs) const
+{
+	uint64_t next = 0;
+	bool found = false;
+	for (std::set<std::string>::const_iterator it = m_held.begin(); it != m_held.end(); ++it) {
+		std::map<std::string, uint64_t>::const_iterator last = m_lastProgress.find(*it);
+		uint64_t due = (last == m_lastProgress.end()) ? nowMs : last->second + m_progressIntervalMs;
+		if (!found || due < next) {
+			next = due;
+			found = true;
+		}
+	}
+
+	if (!found || next <= nowMs)
+		return 0;
+	return (unsigned int) (next - nowMs);
+}
@@ -0,0 +1,96 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef LAUNCHPOINTCHANGEBATCHER_H
+#define LAUNCHPOINTCHANGEBATCHER_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <lunaservice.h>
+
+/*
+ * Collects launch point changes between two flushes of the launchPointChanges subscription, and holds back
+ * installer progress updates that come faster than a launcher can use them.
+ *
+ * Changes to the same launch point within one batch fold into one: added then updated is still added (with
+ * the latest description), anything then removed is removed, added then removed is nothing at all, and
+ * removed then added is updated. takeChanges() gives the batch as one message:
+ *
+ *   { "launchPointChanges": [ { "change": "added", "launchPoint": { ...LaunchPoint::toJSON()... } }, ... ] }
+ *
+ * Progress-only updates are passed on at most once per progress interval per key; the last one held back
+ * is handed out by takeDueProgress() once its interval is up, so the final progress is never lost.
+ *
+ * The batcher only keeps the bookkeeping; timers and signals are up to the owner. Batched subscribers are
+ * added with subscribe() and a batch goes out with post(), so both use the same subscription key. Not thread
+ * safe.
+ */
+class LaunchPointChangeBatcher
+{
+public:
+
+	explicit LaunchPointChangeBatcher(unsigned int progressIntervalMs);
+
+	// add message as a batched subscriber, and post a batch to those; same as the LSSubscription* calls
+	static bool subscribe(LSHandle* lsHandle, LSMessage* message, LSError* lsError);
+	static bool post(LSHandle* lsHandle, const std::string& batch, LSError* lsError);
+
+	// json: the launch point as LaunchPoint::toJSON() gives it; change: "added", "updated" or "removed"
+	void queueChange(const std::string& launchPointId, const std::string& change, const std::string& json);
+	bool hasChanges() const { return !m_order.empty(); }
+	unsigned int changeCount() const { return m_order.size(); }
+
+	// the batch message, in the order the launch points first changed in; the batch is emptied
+	std::string takeChanges();
+
+	// true if a progress-only update of key may go out now; if not it is held back
+	bool passProgress(const std::string& key, uint64_t nowMs);
+	// forget key, e.g. when its app went away; a held back update of it is dropped
+	void dropProgress(const std::string& key);
+	bool hasHeldProgress() const { return !m_held.empty(); }
+
+	// the held back keys whose interval is up at nowMs; they count as passed on at nowMs
+	std::vector<std::string> takeDueProgress(uint64_t nowMs);
+	// ms from nowMs until the next held back key is due (0 if one is due already or none is held)
+	unsigned int nextProgressDue(uint64_t nowMs) const;
+
+private:
+
+	struct Change {
+		std::string change;
+		std::string json;
+	};
+
+	unsigned int m_progressIntervalMs;
+
+	std::vector<std::string> m_order;				// launch point ids, in the order they first changed in
+	std::map<std::string, Change> m_changes;
+
+	std::map<std::string, uint64_t> m_lastProgress;	// when the last progress update of a key went out
+	std::set<std::string> m_held;
+};
+
+#endif /* LAUNCHPOINTCHANGEBATCHER_H */
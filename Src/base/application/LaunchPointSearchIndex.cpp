@@ -0,0 +1,203 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "LaunchPointSearchIndex.h"
+#include "ApplicationDescription.h"
+#include "LaunchPoint.h"
+
+#include <string.h>
+#include <glib.h>
+
+LaunchPointSearchIndex::LaunchPointSearchIndex()
+	: m_generation(0)
+	, m_lastPartialKeywords(false)
+	, m_lastGeneration(0)
+	, m_narrowedSearches(0)
+	, m_fullSearches(0)
+{
+}
+
+LaunchPointSearchIndex::~LaunchPointSearchIndex()
+{
+}
+
+//static
+void LaunchPointSearchIndex::titleWordStarts(const char* lcTitle, std::vector<size_t>& r_offsets)
+{
+	if (!lcTitle || !lcTitle[0])
+		return;
+
+	const gchar* delimiters = LaunchPoint::titleDelimiters();
+	r_offsets.push_back(0);
+
+	// delimiters are all ascii, so the byte after one always starts a character
+	for (size_t i = 1; lcTitle[i]; i++) {
+		if (strchr(delimiters, lcTitle[i - 1]))
+			r_offsets.push_back(i);
+	}
+}
+
+void LaunchPointSearchIndex::insert(const LaunchPoint* lp)
+{
+	if (!lp)
+		return;
+
+	remove(lp);
+
+	Entry& entry = m_entries[lp];
+	entry.isDefault = lp->isDefault();
+
+	const char* lcTitle = lp->lowercaseTitle();
+	std::vector<size_t> offsets;
+	titleWordStarts(lcTitle, offsets);
+	for (std::vector<size_t>::iterator it = offsets.begin(); it != offsets.end(); ++it)
+		entry.titleWords.push_back(m_titleWords.insert(std::make_pair(std::string(lcTitle + *it), lp)));
+
+	// keywords and the menu name belong to the app, and only its default launch point is found by them
+	ApplicationDescription* appDesc = lp->appDesc();
+	if (entry.isDefault && appDesc) {
+		std::list<std::string> keywords = appDesc->keywords();
+		for (std::list<std::string>::iterator it = keywords.begin(); it != keywords.end(); ++it)
+			entry.keywords.push_back(m_keywords.insert(std::make_pair(*it, lp)));
+
+		gchar* lcMenuName = g_utf8_strdown(appDesc->menuName().c_str(), -1);
+		if (lcMenuName && lcMenuName[0]) {
+			entry.lcMenuName = lcMenuName;
+			entry.menuNames.push_back(m_menuNames.insert(std::make_pair(entry.lcMenuName, lp)));
+		}
+		g_free(lcMenuName);
+	}
+
+	m_generation++;
+}
+
+void LaunchPointSearchIndex::remove(const LaunchPoint* lp)
+{
+	std::map<const LaunchPoint*, Entry>::iterator found = m_entries.find(lp);
+	if (found == m_entries.end())
+		return;
+
+	Entry& entry = found->second;
+	for (std::vector<TokenMap::iterator>::iterator it = entry.titleWords.begin(); it != entry.titleWords.end(); ++it)
+		m_titleWords.erase(*it);
+	for (std::vector<TokenMap::iterator>::iterator it = entry.keywords.begin(); it != entry.keywords.end(); ++it)
+		m_keywords.erase(*it);
+	for (std::vector<TokenMap::iterator>::iterator it = entry.menuNames.begin(); it != entry.menuNames.end(); ++it)
+		m_menuNames.erase(*it);
+
+	m_entries.erase(found);
+	m_generation++;
+}
+
+void LaunchPointSearchIndex::clear()
+{
+	m_titleWords.clear();
+	m_keywords.clear();
+	m_menuNames.clear();
+	m_entries.clear();
+	m_generation++;
+}
+
+//static
+void LaunchPointSearchIndex::collectPrefix(const TokenMap& tokens, const std::string& prefix, std::set<const LaunchPoint*>& r_lps)
+{
+	for (TokenMap::const_iterator it = tokens.lower_bound(prefix); it != tokens.end(); ++it) {
+		if (it->first.compare(0, prefix.size(), prefix) != 0)
+			break;
+		r_lps.insert(it->second);
+	}
+}
+
+bool LaunchPointSearchIndex::matchesKeyword(const LaunchPoint* lp, const Entry& entry, const std::string& lcTerm,
+											bool partialKeywords) const
+{
+	if (!entry.isDefault || !lp->appDesc())
+		return false;
+
+	if (partialKeywords ? lp->appDesc()->doesMatchKeywordPartial(lcTerm.c_str())
+						: lp->appDesc()->doesMatchKeywordExact(lcTerm.c_str()))
+		return true;
+
+	return entry.lcMenuName.compare(0, lcTerm.size(), lcTerm) == 0;
+}
+
+void LaunchPointSearchIndex::search(const std::string& lcTerm, bool partialKeywords,
+									std::vector<const LaunchPoint*>& r_byTitle, std::vector<const LaunchPoint*>& r_byKeyword) const
+{
+	r_byTitle.clear();
+	r_byKeyword.clear();
+	if (lcTerm.empty())
+		return;
+
+	// Every launch point matching a term also matched any prefix of it: title words and partial keywords
+	// only ever get fewer hits as the term grows. An exact keyword match for the shorter term says nothing
+	// about the longer one, so a remembered exact-keyword result is only reused for the very same query.
+	bool narrow = !m_lastTerm.empty() && m_lastGeneration == m_generation
+			&& lcTerm.size() >= m_lastTerm.size() && lcTerm.compare(0, m_lastTerm.size(), m_lastTerm) == 0
+			&& (m_lastPartialKeywords || (!partialKeywords && lcTerm == m_lastTerm));
+
+	if (narrow) {
+
+		// a launch point that was found by title can now be found by keyword instead, so both are candidates
+		std::vector<const LaunchPoint*> candidates(m_lastByTitle);
+		candidates.insert(candidates.end(), m_lastByKeyword.begin(), m_lastByKeyword.end());
+
+		for (std::vector<const LaunchPoint*>::iterator it = candidates.begin(); it != candidates.end(); ++it) {
+			std::map<const LaunchPoint*, Entry>::const_iterator entry = m_entries.find(*it);
+			if (entry == m_entries.end())
+				continue;
+			if ((*it)->matchesTitle(lcTerm.c_str()))
+				r_byTitle.push_back(*it);
+			else if (matchesKeyword(*it, entry->second, lcTerm, partialKeywords))
+				r_byKeyword.push_back(*it);
+		}
+		m_narrowedSearches++;
+	}
+	else {
+		std::set<const LaunchPoint*> byTitle;
+		collectPrefix(m_titleWords, lcTerm, byTitle);
+
+		std::set<const LaunchPoint*> byKeyword;
+		if (partialKeywords)
+			collectPrefix(m_keywords, lcTerm, byKeyword);
+		else {
+			std::pair<TokenMap::const_iterator, TokenMap::const_iterator> range = m_keywords.equal_range(lcTerm);
+			for (TokenMap::const_iterator it = range.first; it != range.second; ++it)
+				byKeyword.insert(it->second);
+		}
+		collectPrefix(m_menuNames, lcTerm, byKeyword);
+
+		r_byTitle.assign(byTitle.begin(), byTitle.end());
+		for (std::set<const LaunchPoint*>::iterator it = byKeyword.begin(); it != byKeyword.end(); ++it) {
+			if (byTitle.find(*it) == byTitle.end())
+				r_byKeyword.push_back(*it);
+		}
+		m_fullSearches++;
+	}
+
+	m_lastTerm = lcTerm;
+	m_lastPartialKeywords = partialKeywords;
+	m_lastGeneration = m_generation;
+	m_lastByTitle = r_byTitle;
+	m_lastByKeyword = r_byKeyword;
+}
@@ -0,0 +1,115 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef LAUNCHPOINTSEARCHINDEX_H
+#define LAUNCHPOINTSEARCHINDEX_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+class LaunchPoint;
+
+/*
+ * Prefix index over the launch points for ApplicationManager::searchLaunchPoints().
+ *
+ * Three sorted token tables, each searched with a lower_bound on the term and a walk over the keys that
+ * start with it:
+ *   - the lowercased title from every word start on ("music player" -> "music player", "player"); the
+ *     word starts are the ones LaunchPoint::matchesTitle() accepts (start of title, or after a delimiter)
+ *   - the app's keywords, for default launch points
+ *   - the app's lowercased menu name, for default launch points
+ *
+ * The previous query is remembered. When the next one extends it (typing one more character) and nothing
+ * was indexed or unindexed in between, the answer is found by narrowing the previous candidates instead of
+ * going back to the tables.
+ *
+ * Candidates are not filtered by app visibility, removal or hardware requirements; those change without
+ * the index hearing about it, so the caller checks them on the result.
+ *
+ * NOT thread safe - same rules as ApplicationIndex, which owns it.
+ */
+class LaunchPointSearchIndex
+{
+public:
+
+	LaunchPointSearchIndex();
+	~LaunchPointSearchIndex();
+
+	// (re)indexes the launch point with its current title (and app keywords/menu name, if it's a default one)
+	void insert(const LaunchPoint* lp);
+	void remove(const LaunchPoint* lp);
+	void clear();
+
+	// lcTerm must already be lowercased. r_byTitle gets the launch points with a title word starting with
+	// the term; r_byKeyword the default launch points not in r_byTitle whose app has a keyword starting with
+	// (partialKeywords) or equal to the term, or a menu name starting with it
+	void search(const std::string& lcTerm, bool partialKeywords,
+				std::vector<const LaunchPoint*>& r_byTitle, std::vector<const LaunchPoint*>& r_byKeyword) const;
+
+	unsigned int size() const { return m_entries.size(); }
+
+	// lookups answered by narrowing the previous result, and from the tables
+	unsigned int narrowedSearches() const { return m_narrowedSearches; }
+	unsigned int fullSearches() const { return m_fullSearches; }
+
+	// start offsets of the title words LaunchPoint::matchesTitle() would match at
+	static void titleWordStarts(const char* lcTitle, std::vector<size_t>& r_offsets);
+
+private:
+
+	typedef std::multimap<std::string, const LaunchPoint*> TokenMap;
+
+	struct Entry {
+		std::vector<TokenMap::iterator> titleWords;
+		std::vector<TokenMap::iterator> keywords;
+		std::vector<TokenMap::iterator> menuNames;
+		std::string lcMenuName;
+		bool isDefault;
+	};
+
+	static void collectPrefix(const TokenMap& tokens, const std::string& prefix, std::set<const LaunchPoint*>& r_lps);
+	bool matchesKeyword(const LaunchPoint* lp, const Entry& entry, const std::string& lcTerm, bool partialKeywords) const;
+
+	TokenMap m_titleWords;
+	TokenMap m_keywords;
+	TokenMap m_menuNames;
+	std::map<const LaunchPoint*, Entry> m_entries;
+
+	// bumped on every change, so a remembered result is never narrowed across one
+	unsigned int m_generation;
+
+	mutable std::string m_lastTerm;
+	mutable bool m_lastPartialKeywords;
+	mutable unsigned int m_lastGeneration;
+	mutable std::vector<const LaunchPoint*> m_lastByTitle;
+	mutable std::vector<const LaunchPoint*> m_lastByKeyword;
+	mutable unsigned int m_narrowedSearches;
+	mutable unsigned int m_fullSearches;
+
+	LaunchPointSearchIndex(const LaunchPointSearchIndex&);
+	LaunchPointSearchIndex& operator=(const LaunchPointSearchIndex&);
+};
+
+#endif /* LAUNCHPOINTSEARCHINDEX_H */
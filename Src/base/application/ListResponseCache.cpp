@@ -0,0 +1,211 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "ListResponseCache.h"
+
+#include <stdio.h>
+#include <glib.h>
+#include <cjson/json.h>
+
+// removals remembered per list; a delta older than the oldest of them can't be given
+static const unsigned int s_maxRemoved = 256;
+
+static std::string toJsonString(const std::string& str)
+{
+	json_object* jstr = json_object_new_string(str.c_str());
+	std::string s = json_object_to_json_string(jstr);
+	json_object_put(jstr);
+	return s;
+}
+
+static std::string generationPrefix(uint32_t generation)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "{\"returnValue\":true,\"generation\":%u", generation);
+	return buf;
+}
+
+ListResponseCache::ListResponseCache(const std::vector<std::string>& listNames)
+	: m_generation(0)
+	, m_oldestDelta(0)
+	, m_valid(false)
+{
+	m_lists.resize(listNames.size());
+	for (unsigned int i = 0; i < listNames.size(); i++)
+		m_lists[i].name = listNames[i];
+}
+
+//static
+uint32_t ListResponseCache::initialGeneration()
+{
+	return (uint32_t) g_random_int_range(1, 1 << 30);
+}
+
+void ListResponseCache::update(uint32_t generation, const std::vector<ItemList>& lists)
+{
+	if (lists.size() != m_lists.size()) {
+		g_warning("%s: %u lists given, %u expected", __PRETTY_FUNCTION__, (unsigned int) lists.size(), (unsigned int) m_lists.size());
+		return;
+	}
+
+	for (unsigned int i = 0; i < m_lists.size(); i++) {
+
+		List& list = m_lists[i];
+		std::map<std::string, Item> items;
+		std::vector<std::string> order;
+
+		for (ItemList::const_iterator it = lists[i].begin(); it != lists[i].end(); ++it) {
+
+			if (items.find(it->first) != items.end())
+				continue;
+
+			Item item;
+			item.json = it->second;
+			item.changed = generation;
+
+			std::map<std::string, Item>::const_iterator old = list.items.find(it->first);
+			if (m_valid && old != list.items.end() && old->second.json == item.json)
+				item.changed = old->second.changed;
+
+			list.removed.erase(it->first);
+			items[it->first] = item;
+			order.push_back(it->first);
+		}
+
+		if (m_valid) {
+			for (std::map<std::string, Item>::const_iterator it = list.items.begin(); it != list.items.end(); ++it) {
+				if (items.find(it->first) != items.end())
+					continue;
+
+				Removed removed;
+				removed.keyJson = toJsonString(it->first);
+				removed.removed = generation;
+				list.removed[it->first] = removed;
+			}
+		}
+
+		list.items.swap(items);
+		list.order.swap(order);
+		pruneRemoved(list);
+	}
+
+	if (!m_valid)
+		m_oldestDelta = generation;
+	m_generation = generation;
+	m_valid = true;
+
+	buildResponse(lists);
+}
+
+void ListResponseCache::pruneRemoved(List& list)
+{
+	while (list.removed.size() > s_maxRemoved) {
+
+		std::map<std::string, Removed>::iterator oldest = list.removed.begin();
+		for (std::map<std::string, Removed>::iterator it = list.removed.begin(); it != list.removed.end(); ++it) {
+			if (it->second.removed < oldest->second.removed)
+				oldest = it;
+		}
+
+		// whoever is behind this removal would miss it
+		if (oldest->second.removed > m_oldestDelta)
+			m_oldestDelta = oldest->second.removed;
+		list.removed.erase(oldest);
+	}
+}
+
+void ListResponseCache::buildResponse(const std::vector<ItemList>& lists)
+{
+	size_t size = 64;
+	for (unsigned int i = 0; i < lists.size(); i++) {
+		size += m_lists[i].name.size() + 8;
+		for (ItemList::const_iterator it = lists[i].begin(); it != lists[i].end(); ++it)
+			size += it->second.size() + 1;
+	}
+
+	m_response.clear();
+	m_response.reserve(size);
+	m_response += generationPrefix(m_generation);
+
+	for (unsigned int i = 0; i < lists.size(); i++) {
+		m_response += ",\"" + m_lists[i].name + "\":[";
+		for (ItemList::const_iterator it = lists[i].begin(); it != lists[i].end(); ++it) {
+			if (it != lists[i].begin())
+				m_response += ",";
+			m_response += it->second;
+		}
+		m_response += "]";
+	}
+
+	m_response += "}";
+}
+
+bool ListResponseCache::canDelta(uint32_t sinceGeneration) const
+{
+	return m_valid && sinceGeneration >= m_oldestDelta && sinceGeneration <= m_generation;
+}
+
+std::string ListResponseCache::response(uint32_t sinceGeneration) const
+{
+	if (!canDelta(sinceGeneration))
+		return m_response;
+
+	std::string s = generationPrefix(m_generation) + ",\"delta\":true";
+
+	for (unsigned int i = 0; i < m_lists.size(); i++) {
+		const List& list = m_lists[i];
+		bool first = true;
+		s += ",\"" + list.name + "\":[";
+		for (std::vector<std::string>::const_iterator it = list.order.begin(); it != list.order.end(); ++it) {
+			const Item& item = list.items.find(*it)->second;
+			if (item.changed <= sinceGeneration)
+				continue;
+			if (!first)
+				s += ",";
+			s += item.json;
+			first = false;
+		}
+		s += "]";
+	}
+
+	s += ",\"removed\":{";
+	for (unsigned int i = 0; i < m_lists.size(); i++) {
+		const List& list = m_lists[i];
+		bool first = true;
+		if (i > 0)
+			s += ",";
+		s += "\"" + list.name + "\":[";
+		for (std::map<std::string, Removed>::const_iterator it = list.removed.begin(); it != list.removed.end(); ++it) {
+			if (it->second.removed <= sinceGeneration)
+				continue;
+			if (!first)
+				s += ",";
+			s += it->second.keyJson;
+			first = false;
+		}
+		s += "]";
+	}
+	s += "}}";
+
+	return s;
+}
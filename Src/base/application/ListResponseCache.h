@@ -0,0 +1,101 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef LISTRESPONSECACHE_H
+#define LISTRESPONSECACHE_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+/*
+ * The reply of a list service method (listApps, dumpMimeTable, ...), kept as the string that was sent, for as
+ * long as the generation it was built at is current.
+ *
+ * The owner stamps its tables with a generation that goes up on every change; the cache is rebuilt (update())
+ * only when that generation has moved. Each item is remembered by its key along with the generation it last
+ * changed at, and the keys that went away with the generation they left at, so a caller that was given
+ * generation N can be answered with only what changed after N:
+ *
+ *   { "returnValue": true, "generation": 12, "apps": [ ...every app... ] }
+ *   { "returnValue": true, "generation": 12, "delta": true, "apps": [ ...changed or added... ], "removed": { "apps": [ "id", ... ] } }
+ *
+ * A delta can't be given for a generation older than the removals still remembered, or one the cache has never
+ * seen (e.g. from before a restart; generations start at a random value for that reason): those get the full reply.
+ *
+ * Not thread safe; the list service methods all run on the main loop.
+ */
+class ListResponseCache
+{
+public:
+
+	typedef std::vector<std::pair<std::string, std::string> > ItemList;		// key, json text of the item; in list order
+
+	// one list per name, replied in this order
+	explicit ListResponseCache(const std::vector<std::string>& listNames);
+
+	bool isCurrent(uint32_t generation) const { return m_valid && m_generation == generation; }
+
+	// lists[i] is the content of list i as it was at generation
+	void update(uint32_t generation, const std::vector<ItemList>& lists);
+
+	// valid until the next update()
+	const std::string& response() const { return m_response; }
+	std::string response(uint32_t sinceGeneration) const;
+
+	bool canDelta(uint32_t sinceGeneration) const;
+
+	// a starting generation for an owner, unlikely to overlap one handed out before a restart
+	static uint32_t initialGeneration();
+
+private:
+
+	struct Item {
+		std::string json;
+		uint32_t changed;
+	};
+
+	struct Removed {
+		std::string keyJson;	// the key as a json string
+		uint32_t removed;
+	};
+
+	struct List {
+		std::string name;
+		std::vector<std::string> order;
+		std::map<std::string, Item> items;
+		std::map<std::string, Removed> removed;
+	};
+
+	void pruneRemoved(List& list);
+	void buildResponse(const std::vector<ItemList>& lists);
+
+	std::vector<List> m_lists;
+	uint32_t m_generation;
+	uint32_t m_oldestDelta;		// deltas can be given from this generation on
+	bool m_valid;
+	std::string m_response;
+};
+
+#endif /* LISTRESPONSECACHE_H */
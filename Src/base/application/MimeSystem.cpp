@@ -29,6 +29,7 @@
 #include <cjson/json_util.h>
 #include <glib.h>
 #include "MimeSystem.h"
+#include "ListResponseCache.h"
 #include "MutexLocker.h"
 #include <algorithm>
 #include "Utils.h"
@@ -42,6 +43,8 @@ uint32_t MimeSystem::s_lastAssignedIndex = 0;
 std::vector<uint32_t> MimeSystem::s_indexRecycler;
 Mutex 		MimeSystem::s_mutex;
 
+#define MIMESYSTEM_ACTIVE_SAVE_DELAY_MS		500
+
 // ---------------------------------------------------------------------------------------------------------------------
 // --------------------------------------------------- public ----------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
@@ -218,12 +221,26 @@ int MimeSystem::RedirectHandlerNode::swapHandler(uint32_t index)
 	return 1;
 }
 
+MimeSystem::RedirectHandlerNode::RedirectHandlerNode(const RedirectHandlerNode& c)
+	: m_redirectHandler(c.m_redirectHandler) , m_verbCache(c.m_verbCache) , m_snapshotRefs(1) , m_snapshotCopy(true)
+{
+	//the handlers keep their indexes; a snapshot copy never assigns or reclaims any
+	m_handlersByIndex[m_redirectHandler.index()] = &m_redirectHandler;
+	for (std::vector<RedirectHandler *>::const_iterator it = c.m_alternates.begin();
+			it != c.m_alternates.end();++it) {
+		RedirectHandler * p_handler = new RedirectHandler(*(*it));
+		m_alternates.push_back(p_handler);
+		m_handlersByIndex[p_handler->index()] = p_handler;
+	}
+}
+
 MimeSystem::RedirectHandlerNode::~RedirectHandlerNode()
 {
 	//clear out all entries
 	for (std::vector<RedirectHandler *>::iterator it = m_alternates.begin();
 			it != m_alternates.end();++it) {
-		MimeSystem::reclaimIndex((*it)->index());
+		if (!m_snapshotCopy)
+			MimeSystem::reclaimIndex((*it)->index());
 		delete ((*it));
 	}
 }
@@ -378,6 +395,100 @@ MimeSystem::RedirectHandlerNode * MimeSystem::RedirectHandlerNode::fromJson(stru
 	return p_rhn;
 }
 	
+/*
+ * binary form for MimeTableStore: the handlers, primary first, each with its verbs, then the verb cache.
+ * The verb cache refers to handlers by the index they had when encoded; decode() maps those to the new ones.
+ */
+void MimeSystem::RedirectHandlerNode::encode(MimeTableStore::Encoder& enc)
+{
+	enc.putUInt32(1 + m_alternates.size());
+	for (uint32_t i=0;i<=m_alternates.size();i++) {
+		RedirectHandler& handler = (i == 0 ? m_redirectHandler : *(m_alternates[i-1]));
+		enc.putString(handler.urlRe());
+		enc.putString(handler.appId());
+		enc.putBool(handler.isSchemeForm());
+		enc.putString(handler.tag());
+		enc.putUInt32(handler.index());
+		enc.putUInt32(handler.verbs().size());
+		for (std::map<std::string,std::string>::const_iterator it = handler.verbs().begin();it != handler.verbs().end();++it) {
+			enc.putString(it->first);
+			enc.putString(it->second);
+		}
+	}
+	enc.putUInt32(m_verbCache.size());
+	for (std::map<std::string,VerbCacheEntry>::iterator it = m_verbCache.begin();it != m_verbCache.end();++it) {
+		enc.putString(it->first);
+		enc.putUInt32(it->second.activeIndex);
+	}
+}
+
+//static
+MimeSystem::RedirectHandlerNode * MimeSystem::RedirectHandlerNode::decode(MimeTableStore::Decoder& dec)		//WARNING: memory allocated (RedirectHandlerNode object)
+{
+	uint32_t handlerCount;
+	if (!dec.getUInt32(handlerCount) || handlerCount == 0)
+		return NULL;
+
+	RedirectHandlerNode * p_rhn = NULL;
+	std::map<uint32_t,uint32_t> savedToNewIndex;
+	for (uint32_t i=0;i<handlerCount;i++) {
+		std::string url,appId;
+		bool schemeForm;
+		std::string tag;
+		uint32_t savedIndex,verbCount;
+		if (!dec.getString(url) || !dec.getString(appId) || !dec.getBool(schemeForm)
+			|| !dec.getString(tag) || !dec.getUInt32(savedIndex) || !dec.getUInt32(verbCount))
+		{
+			delete p_rhn;
+			return NULL;
+		}
+		std::map<std::string,std::string> verbs;
+		for (uint32_t v=0;v<verbCount;v++) {
+			std::string verb,params;
+			if (!dec.getString(verb) || !dec.getString(params)) {
+				delete p_rhn;
+				return NULL;
+			}
+			verbs[verb] = params;
+		}
+
+		RedirectHandler * p_handler;
+		if (p_rhn == NULL) {
+			p_rhn = new RedirectHandlerNode(url,appId,schemeForm);
+			p_rhn->m_redirectHandler.setTag(tag);
+			p_handler = &(p_rhn->m_redirectHandler);
+		}
+		else {
+			p_handler = new RedirectHandler(url,appId,schemeForm,tag);
+			p_rhn->m_handlersByIndex[p_handler->index()] = p_handler;
+			p_rhn->m_alternates.push_back(p_handler);
+		}
+		savedToNewIndex[savedIndex] = p_handler->index();
+		if (verbs.size())
+			MimeSystem::addVerbs(verbs,*p_rhn,*p_handler);
+	}
+
+	uint32_t verbCacheCount;
+	if (!dec.getUInt32(verbCacheCount)) {
+		delete p_rhn;
+		return NULL;
+	}
+	for (uint32_t i=0;i<verbCacheCount;i++) {
+		std::string verb;
+		uint32_t savedIndex;
+		if (!dec.getString(verb) || !dec.getUInt32(savedIndex)) {
+			delete p_rhn;
+			return NULL;
+		}
+		std::map<std::string,VerbCacheEntry>::iterator vit = p_rhn->m_verbCache.find(verb);
+		std::map<uint32_t,uint32_t>::iterator iit = savedToNewIndex.find(savedIndex);
+		if ((vit != p_rhn->m_verbCache.end()) && (iit != savedToNewIndex.end()))
+			vit->second.activeIndex = iit->second;
+	}
+
+	return p_rhn;
+}
+
 int MimeSystem::RedirectHandlerNode::fixupVerbCacheTable(struct json_object * jsonHandlerNodeEntry)
 {
 	std::map<std::string,uint32_t> verbs;
@@ -565,12 +676,26 @@ bool MimeSystem::ResourceHandlerNode::reassignRandomVerbHandler(const std::strin
 	return true;
 }
 
+MimeSystem::ResourceHandlerNode::ResourceHandlerNode(const ResourceHandlerNode& c)
+	: m_resourceHandler(c.m_resourceHandler) , m_verbCache(c.m_verbCache) , m_snapshotRefs(1) , m_snapshotCopy(true)
+{
+	//the handlers keep their indexes; a snapshot copy never assigns or reclaims any
+	m_handlersByIndex[m_resourceHandler.index()] = &m_resourceHandler;
+	for (std::vector<ResourceHandler *>::const_iterator it = c.m_alternates.begin();
+			it != c.m_alternates.end();++it) {
+		ResourceHandler * p_handler = new ResourceHandler(*(*it));
+		m_alternates.push_back(p_handler);
+		m_handlersByIndex[p_handler->index()] = p_handler;
+	}
+}
+
 MimeSystem::ResourceHandlerNode::~ResourceHandlerNode()
 {
 	//clear out all entries
 	for (std::vector<ResourceHandler *>::iterator it = m_alternates.begin();
 			it != m_alternates.end();++it) {
-		MimeSystem::reclaimIndex((*it)->index());
+		if (!m_snapshotCopy)
+			MimeSystem::reclaimIndex((*it)->index());
 		delete ((*it));
 	}
 }
@@ -752,6 +877,100 @@ MimeSystem::ResourceHandlerNode * MimeSystem::ResourceHandlerNode::fromJson(stru
 	return p_rhn;
 }
 	
+/*
+ * binary form for MimeTableStore; same layout as RedirectHandlerNode::encode()
+ */
+void MimeSystem::ResourceHandlerNode::encode(MimeTableStore::Encoder& enc)
+{
+	enc.putUInt32(1 + m_alternates.size());
+	for (uint32_t i=0;i<=m_alternates.size();i++) {
+		ResourceHandler& handler = (i == 0 ? m_resourceHandler : *(m_alternates[i-1]));
+		enc.putString(handler.fileExt());
+		enc.putString(handler.contentType());
+		enc.putString(handler.appId());
+		enc.putBool(handler.stream());
+		enc.putString(handler.tag());
+		enc.putUInt32(handler.index());
+		enc.putUInt32(handler.verbs().size());
+		for (std::map<std::string,std::string>::const_iterator it = handler.verbs().begin();it != handler.verbs().end();++it) {
+			enc.putString(it->first);
+			enc.putString(it->second);
+		}
+	}
+	enc.putUInt32(m_verbCache.size());
+	for (std::map<std::string,VerbCacheEntry>::iterator it = m_verbCache.begin();it != m_verbCache.end();++it) {
+		enc.putString(it->first);
+		enc.putUInt32(it->second.activeIndex);
+	}
+}
+
+//static
+MimeSystem::ResourceHandlerNode * MimeSystem::ResourceHandlerNode::decode(MimeTableStore::Decoder& dec)		//WARNING: memory allocated (ResourceHandlerNode object)
+{
+	uint32_t handlerCount;
+	if (!dec.getUInt32(handlerCount) || handlerCount == 0)
+		return NULL;
+
+	ResourceHandlerNode * p_rhn = NULL;
+	std::map<uint32_t,uint32_t> savedToNewIndex;
+	for (uint32_t i=0;i<handlerCount;i++) {
+		std::string extension,mime,appId;
+		bool stream;
+		std::string tag;
+		uint32_t savedIndex,verbCount;
+		if (!dec.getString(extension) || !dec.getString(mime) || !dec.getString(appId) || !dec.getBool(stream)
+			|| !dec.getString(tag) || !dec.getUInt32(savedIndex) || !dec.getUInt32(verbCount))
+		{
+			delete p_rhn;
+			return NULL;
+		}
+		std::map<std::string,std::string> verbs;
+		for (uint32_t v=0;v<verbCount;v++) {
+			std::string verb,params;
+			if (!dec.getString(verb) || !dec.getString(params)) {
+				delete p_rhn;
+				return NULL;
+			}
+			verbs[verb] = params;
+		}
+
+		ResourceHandler * p_handler;
+		if (p_rhn == NULL) {
+			p_rhn = new ResourceHandlerNode(extension,mime,appId,stream);
+			p_rhn->m_resourceHandler.setTag(tag);
+			p_handler = &(p_rhn->m_resourceHandler);
+		}
+		else {
+			p_handler = new ResourceHandler(extension,mime,appId,stream,tag);
+			p_rhn->m_handlersByIndex[p_handler->index()] = p_handler;
+			p_rhn->m_alternates.push_back(p_handler);
+		}
+		savedToNewIndex[savedIndex] = p_handler->index();
+		if (verbs.size())
+			MimeSystem::addVerbs(verbs,*p_rhn,*p_handler);
+	}
+
+	uint32_t verbCacheCount;
+	if (!dec.getUInt32(verbCacheCount)) {
+		delete p_rhn;
+		return NULL;
+	}
+	for (uint32_t i=0;i<verbCacheCount;i++) {
+		std::string verb;
+		uint32_t savedIndex;
+		if (!dec.getString(verb) || !dec.getUInt32(savedIndex)) {
+			delete p_rhn;
+			return NULL;
+		}
+		std::map<std::string,VerbCacheEntry>::iterator vit = p_rhn->m_verbCache.find(verb);
+		std::map<uint32_t,uint32_t>::iterator iit = savedToNewIndex.find(savedIndex);
+		if ((vit != p_rhn->m_verbCache.end()) && (iit != savedToNewIndex.end()))
+			vit->second.activeIndex = iit->second;
+	}
+
+	return p_rhn;
+}
+
 int MimeSystem::ResourceHandlerNode::fixupVerbCacheTable(struct json_object * jsonHandlerNodeEntry)
 {
 	std::map<std::string,uint32_t> verbs;
@@ -790,7 +1009,7 @@ MimeSystem * MimeSystem::instance(const std::string& baseConfigFile)
 {
 
 	MimeSystem * inst = instance();	
-	MutexLocker lock(&(inst->m_mutex));
+	TableWriter writer(inst);
 	
 	struct json_object * file_root_jobj = json_object_from_file(const_cast<char *>(baseConfigFile.c_str()));
 	if ((file_root_jobj == NULL) || (is_error(file_root_jobj)))
@@ -805,7 +1024,7 @@ MimeSystem * MimeSystem::instance(const std::string& baseConfigFile)
 MimeSystem * MimeSystem::instance(const std::string& baseConfigFile,const std::string& customizedConfigFile)
 {
 	MimeSystem * inst = instance();
-	MutexLocker lock(&(inst->m_mutex));
+	TableWriter writer(inst);
 	
 	//Since whatever comes first will not get overridden by what comes after, start with the customized file and then load the base file
 	
@@ -830,7 +1049,7 @@ MimeSystem * MimeSystem::instance(const std::string& baseConfigFile,const std::s
  */
 int MimeSystem::populateFromJson(struct json_object * root)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	if ((root == NULL) || (is_error(root)))
 		return 0;
 
@@ -920,12 +1139,12 @@ int MimeSystem::populateFromJson(struct json_object * root)
 
 std::string	MimeSystem::getActiveAppIdForResource(std::string mimeType)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 	
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it != m_resourceHandlerMap.end()) {
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it != snapshot->m_resourceHandlerMap.end()) {
 		return it->second->m_resourceHandler.appId();
 	}
 	return "";
@@ -933,12 +1152,12 @@ std::string	MimeSystem::getActiveAppIdForResource(std::string mimeType)
 
 int	MimeSystem::getAllAppIdForResource(std::string mimeType,std::string& r_active,std::vector<std::string>& r_alternatives)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 	
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it == m_resourceHandlerMap.end()) {
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it == snapshot->m_resourceHandlerMap.end()) {
 		return 0;
 	}
 	ResourceHandlerNode * p_rhn = it->second;
@@ -954,12 +1173,12 @@ int	MimeSystem::getAllAppIdForResource(std::string mimeType,std::string& r_activ
 
 ResourceHandler	MimeSystem::getActiveHandlerForResource(std::string mimeType)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 	
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it != m_resourceHandlerMap.end()) {
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it != snapshot->m_resourceHandlerMap.end()) {
 		return it->second->m_resourceHandler;
 	}
 	return ResourceHandler();	//return invalid object (see ResourceHandler::valid() )
@@ -967,12 +1186,12 @@ ResourceHandler	MimeSystem::getActiveHandlerForResource(std::string mimeType)
 
 int	MimeSystem::getAllHandlersForResource(std::string mimeType,ResourceHandler& r_active,std::vector<ResourceHandler>& r_alternatives)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 	
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it == m_resourceHandlerMap.end()) {
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it == snapshot->m_resourceHandlerMap.end()) {
 		return 0;
 	}
 	ResourceHandlerNode * p_rhn = it->second;
@@ -988,38 +1207,34 @@ int	MimeSystem::getAllHandlersForResource(std::string mimeType,ResourceHandler&
 	
 std::string	MimeSystem::getActiveAppIdForRedirect(const std::string& url,bool doNotUseRegexpMatch,bool disallowSchemeForms)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	RedirectMapIterType it;
 	
 	if (doNotUseRegexpMatch) {
 		//strict retrieval by string equivalence on the regexp
-		it = m_redirectHandlerMap.find(url);
-		if (it != m_redirectHandlerMap.end()) {
+		it = snapshot->m_redirectHandlerMap.find(url);
+		if (it != snapshot->m_redirectHandlerMap.end()) {
 			//found
 			return it->second->m_redirectHandler.appId();
 		}
 	}
 	else {
-		for (it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-			if ((disallowSchemeForms) && (it->second->m_redirectHandler.isSchemeForm()))
-				continue;
-			//try and match against it
-			if (it->second->m_redirectHandler.matches(url))
-				return it->second->m_redirectHandler.appId();
-		}
+		RedirectHandlerNode * p_rhn = snapshot->matchRedirectNode(url,!disallowSchemeForms,true);
+		if (p_rhn)
+			return p_rhn->m_redirectHandler.appId();
 	}
 	return "";
 }
 
 int	MimeSystem::getAllAppIdForRedirect(const std::string& url,bool doNotUseRegexpMatch,std::string& r_active,std::vector<std::string>& r_alternatives)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	int rc=0;
 	RedirectMapIterType it;
 	if (doNotUseRegexpMatch) {
 		//strict retrieval by string equivalence on the regexp
-		it = m_redirectHandlerMap.find(url);
-		if (it != m_redirectHandlerMap.end()) {
+		it = snapshot->m_redirectHandlerMap.find(url);
+		if (it != snapshot->m_redirectHandlerMap.end()) {
 			//found
 			RedirectHandlerNode * p_rhn = it->second;
 			//Active is a litte bit ambiguous here since there may be multiple nodes that match the url (regexps can overlap, and also scheme and "redirect" forms can refer to the same url patterns)
@@ -1038,13 +1253,11 @@ int	MimeSystem::getAllAppIdForRedirect(const std::string& url,bool doNotUseRegex
 	}
 	
 	//else, do a regexp match
-	for (it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		//try and match against it
-		if (it->second->m_redirectHandler.matches(url) == false)
-			continue;
-		
+	std::vector<RedirectHandlerNode *> nodes;
+	snapshot->matchAllRedirectNodes(url,nodes);
+	for (std::vector<RedirectHandlerNode *>::iterator node_it = nodes.begin();node_it != nodes.end();++node_it) {
 		//found a node that matches the url
-		RedirectHandlerNode * p_rhn = it->second;
+		RedirectHandlerNode * p_rhn = *node_it;
 		//Active is a litte bit ambiguous here since there may be multiple nodes that match the url (regexps can overlap, and also scheme and "redirect" forms can refer to the same url patterns)
 		//But we want an "active" to keep the API somewhat consistent...so just set the "active" as the primary handler of the first node that's found
 		if (rc == 0) {
@@ -1069,38 +1282,34 @@ int	MimeSystem::getAllAppIdForRedirect(const std::string& url,bool doNotUseRegex
 
 RedirectHandler	MimeSystem::getActiveHandlerForRedirect(const std::string& url,bool doNotUseRegexpMatch, bool disallowSchemeForms)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	RedirectMapIterType it;
 	
 	if (doNotUseRegexpMatch) {
 		//strict retrieval by string equivalence on the regexp
-		it = m_redirectHandlerMap.find(url);
-		if (it != m_redirectHandlerMap.end()) {
+		it = snapshot->m_redirectHandlerMap.find(url);
+		if (it != snapshot->m_redirectHandlerMap.end()) {
 			//found
 			return it->second->m_redirectHandler;
 		}
 	}
 	else {
-		for (it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-			if ((disallowSchemeForms) && (it->second->m_redirectHandler.isSchemeForm()))
-				continue;
-			//try and match against it
-			if (it->second->m_redirectHandler.matches(url))
-				return it->second->m_redirectHandler;
-		}
+		RedirectHandlerNode * p_rhn = snapshot->matchRedirectNode(url,!disallowSchemeForms,true);
+		if (p_rhn)
+			return p_rhn->m_redirectHandler;
 	}
 	return RedirectHandler();
 }
 
 int	MimeSystem::getAllHandlersForRedirect(const std::string& url,bool doNotUseRegexpMatch,RedirectHandler& r_active,std::vector<RedirectHandler>& r_alternatives)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	int rc=0;
 	RedirectMapIterType it;
 	if (doNotUseRegexpMatch) {
 		//strict retrieval by string equivalence on the regexp
-		it = m_redirectHandlerMap.find(url);
-		if (it != m_redirectHandlerMap.end()) {
+		it = snapshot->m_redirectHandlerMap.find(url);
+		if (it != snapshot->m_redirectHandlerMap.end()) {
 			//found
 			RedirectHandlerNode * p_rhn = it->second;
 			//Active is a litte bit ambiguous here since there may be multiple nodes that match the url (regexps can overlap, and also scheme and "redirect" forms can refer to the same url patterns)
@@ -1121,14 +1330,11 @@ int	MimeSystem::getAllHandlersForRedirect(const std::string& url,bool doNotUseRe
 	}
 
 	//else, do a regexp match
-
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		//try and match against it
-		if (it->second->m_redirectHandler.matches(url) == false)
-			continue;
-
+	std::vector<RedirectHandlerNode *> nodes;
+	snapshot->matchAllRedirectNodes(url,nodes);
+	for (std::vector<RedirectHandlerNode *>::iterator node_it = nodes.begin();node_it != nodes.end();++node_it) {
 		//found a node that matches the url
-		RedirectHandlerNode * p_rhn = it->second;
+		RedirectHandlerNode * p_rhn = *node_it;
 		//Active is a litte bit ambiguous here since there may be multiple nodes that match the url (regexps can overlap, and also scheme and "redirect" forms can refer to the same url patterns)
 		//But we want an "active" to keep the API somewhat consistent...so just set the "active" as the primary handler of the first node that's found
 		
@@ -1153,12 +1359,12 @@ int	MimeSystem::getAllHandlersForRedirect(const std::string& url,bool doNotUseRe
 
 std::string	MimeSystem::getAppIdByVerbForResource(std::string mimeType,const std::string& verb,std::string& r_params,uint32_t& r_index)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 		
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it == m_resourceHandlerMap.end())
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it == snapshot->m_resourceHandlerMap.end())
 		return "";
 	
 	//found...
@@ -1186,12 +1392,12 @@ std::string	MimeSystem::getAppIdByVerbForResource(std::string mimeType,const std
 
 ResourceHandler	MimeSystem::getHandlerByVerbForResource(std::string mimeType,const std::string& verb)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 		
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it == m_resourceHandlerMap.end())
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it == snapshot->m_resourceHandlerMap.end())
 		return ResourceHandler();
 
 	//found...
@@ -1212,12 +1418,12 @@ ResourceHandler	MimeSystem::getHandlerByVerbForResource(std::string mimeType,con
 
 int	MimeSystem::getAllHandlersByVerbForResource(std::string mimeType,const std::string& verb,std::vector<ResourceHandler>& r_handlers)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 		
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it == m_resourceHandlerMap.end())
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it == snapshot->m_resourceHandlerMap.end())
 		return 0;
 
 	//found...
@@ -1255,12 +1461,12 @@ int	MimeSystem::getAllHandlersByVerbForResource(std::string mimeType,const std::
 
 int MimeSystem::getAllAppIdByVerbForResource(std::string mimeType,const std::string& verb,std::vector<VerbInfo>& r_handlers)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 	
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it == m_resourceHandlerMap.end())
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mimeType);
+	if (it == snapshot->m_resourceHandlerMap.end())
 		return 0;
 
 	//found...
@@ -1296,17 +1502,8 @@ int MimeSystem::getAllAppIdByVerbForResource(std::string mimeType,const std::str
 
 std::string	MimeSystem::getAppIdByVerbForRedirect(const std::string& url,bool disallowSchemeForms,const std::string& verb,std::string& r_params,uint32_t& r_index)
 {
-	MutexLocker lock(&m_mutex);
-	RedirectHandlerNode * p_rhn = NULL;
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		if ((disallowSchemeForms) && (it->second->m_redirectHandler.isSchemeForm()))
-			continue;
-		//try and match against it
-		if (it->second->m_redirectHandler.matches(url)) {
-			p_rhn = it->second;
-			break;
-		}
-	}
+	SnapshotRef snapshot(this);
+	RedirectHandlerNode * p_rhn = snapshot->matchRedirectNode(url,!disallowSchemeForms,true);
 	
 	if (p_rhn == NULL)
 		return "";
@@ -1335,17 +1532,8 @@ std::string	MimeSystem::getAppIdByVerbForRedirect(const std::string& url,bool di
 
 RedirectHandler	MimeSystem::getHandlerByVerbForRedirect(const std::string& url,bool disallowSchemeForms,const std::string& verb)
 {
-	MutexLocker lock(&m_mutex);
-	RedirectHandlerNode * p_rhn = NULL;
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		if ((disallowSchemeForms) && (it->second->m_redirectHandler.isSchemeForm()))
-			continue;
-		//try and match against it
-		if (it->second->m_redirectHandler.matches(url)) {
-			p_rhn = it->second;
-			break;
-		}
-	}
+	SnapshotRef snapshot(this);
+	RedirectHandlerNode * p_rhn = snapshot->matchRedirectNode(url,!disallowSchemeForms,true);
 
 	if (p_rhn == NULL)
 		return RedirectHandler();
@@ -1368,14 +1556,12 @@ RedirectHandler	MimeSystem::getHandlerByVerbForRedirect(const std::string& url,b
 
 int MimeSystem::getAllHandlersByVerbForRedirect(const std::string& url,const std::string& verb,std::vector<RedirectHandler>& r_handlers)
 {
-	MutexLocker lock(&m_mutex);
-	RedirectHandlerNode * p_rhn = NULL;
+	SnapshotRef snapshot(this);
 	int rc = 0;
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		if (it->second->m_redirectHandler.matches(url) == false)
-			continue;
-
-		p_rhn = it->second;
+	std::vector<RedirectHandlerNode *> nodes;
+	snapshot->matchAllRedirectNodes(url,nodes);
+	for (std::vector<RedirectHandlerNode *>::iterator node_it = nodes.begin();node_it != nodes.end();++node_it) {
+		RedirectHandlerNode * p_rhn = *node_it;
 
 		//found...
 
@@ -1410,14 +1596,12 @@ int MimeSystem::getAllHandlersByVerbForRedirect(const std::string& url,const std
 
 int MimeSystem::getAllAppIdByVerbForRedirect(const std::string& url,const std::string& verb,std::vector<VerbInfo>& r_handlers)
 {
-	MutexLocker lock(&m_mutex);
-	RedirectHandlerNode * p_rhn = NULL;
+	SnapshotRef snapshot(this);
 	int rc = 0;
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		if (it->second->m_redirectHandler.matches(url) == false)
-			continue;
-
-		p_rhn = it->second;
+	std::vector<RedirectHandlerNode *> nodes;
+	snapshot->matchAllRedirectNodes(url,nodes);
+	for (std::vector<RedirectHandlerNode *>::iterator node_it = nodes.begin();node_it != nodes.end();++node_it) {
+		RedirectHandlerNode * p_rhn = *node_it;
 
 		//found...
 
@@ -1452,8 +1636,9 @@ int MimeSystem::getAllAppIdByVerbForRedirect(const std::string& url,const std::s
 
 RedirectHandler	MimeSystem::getRedirectHandlerDirect(const uint32_t index)
 {
+	SnapshotRef snapshot(this);
 	
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
+	for (RedirectMapIterType it = snapshot->m_redirectHandlerMap.begin();it != snapshot->m_redirectHandlerMap.end();++it) {
 		std::map<uint32_t,RedirectHandler *>::iterator rit = it->second->m_handlersByIndex.find(index);
 		if (rit != it->second->m_handlersByIndex.end())
 			return (*(rit->second));
@@ -1464,7 +1649,8 @@ RedirectHandler	MimeSystem::getRedirectHandlerDirect(const uint32_t index)
 
 ResourceHandler	MimeSystem::getResourceHandlerDirect(const uint32_t index)
 {
-	for (ResourceMapIterType it = m_resourceHandlerMap.begin();it != m_resourceHandlerMap.end();++it) {
+	SnapshotRef snapshot(this);
+	for (ResourceMapIterType it = snapshot->m_resourceHandlerMap.begin();it != snapshot->m_resourceHandlerMap.end();++it) {
 		std::map<uint32_t,ResourceHandler *>::iterator rit = it->second->m_handlersByIndex.find(index);
 		if (rit != it->second->m_handlersByIndex.end())
 			return (*(rit->second));
@@ -1475,17 +1661,20 @@ ResourceHandler	MimeSystem::getResourceHandlerDirect(const uint32_t index)
 	
 int MimeSystem::removeAllForAppId(const std::string& appId)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	std::vector<std::string> keys;
 	//go through all the nodes
 	
 	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) 
 	{
+		std::size_t handlerCount = it->second->m_handlersByIndex.size();
 		int rc = it->second->removeAppId(appId);
 		if (rc == RC_HANDLERNODE_REMOVEAPPID_REMOVENODE) {
 			//need to remove the whole node
 			keys.push_back(it->first);
 		}
+		if ((rc == RC_HANDLERNODE_REMOVEAPPID_REMOVENODE) || (it->second->m_handlersByIndex.size() != handlerCount))
+			markRedirectDirty(it->first);
 	}
 	
 	//erase all the keys for nodes which are completely obliterated
@@ -1500,11 +1689,14 @@ int MimeSystem::removeAllForAppId(const std::string& appId)
 	
 	for (ResourceMapIterType it = m_resourceHandlerMap.begin();it != m_resourceHandlerMap.end();++it) 
 	{
+		std::size_t handlerCount = it->second->m_handlersByIndex.size();
 		int rc = it->second->removeAppId(appId);
 		if (rc == RC_HANDLERNODE_REMOVEAPPID_REMOVENODE) {
 			//need to remove the whole node
 			keys.push_back(it->first);
 		}
+		if ((rc == RC_HANDLERNODE_REMOVEAPPID_REMOVENODE) || (it->second->m_handlersByIndex.size() != handlerCount))
+			markResourceDirty(it->first);
 	}
 
 	//erase all the keys for nodes which are completely obliterated
@@ -1520,7 +1712,7 @@ int MimeSystem::removeAllForAppId(const std::string& appId)
 
 int	MimeSystem::removeAllForMimeType(std::string mimeType)
 {	
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	
 	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), tolower);
 		
@@ -1530,18 +1722,20 @@ int	MimeSystem::removeAllForMimeType(std::string mimeType)
 		return 0;
 	delete (it->second);
 	m_resourceHandlerMap.erase(it);
+	markResourceDirty(mimeType);
 	return 1;
 }
 
 int	MimeSystem::removeAllForUrl(const std::string& url)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	//find the RedirectHandlerNode, and delete it
 	RedirectMapIterType it = m_redirectHandlerMap.find(url);
 	if (it == m_redirectHandlerMap.end())
 		return 0;
 	delete (it->second);
 	m_redirectHandlerMap.erase(it);
+	markRedirectDirty(url);
 	return 1;
 }
 
@@ -1550,7 +1744,7 @@ int	MimeSystem::removeAllForUrl(const std::string& url)
  */
 int	MimeSystem::addResourceHandler(std::string& extension,std::string mimeType,bool shouldDownload,const std::string appId,const std::map<std::string,std::string> * pVerbs,bool sysDefault)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	
 	//if mimeType is blank, bail
 	if (mimeType.size() == 0)
@@ -1569,6 +1763,7 @@ int	MimeSystem::addResourceHandler(std::string& extension,std::string mimeType,b
 	if (mit == m_extensionToMimeMap.end()) {
 		//add it...
 		m_extensionToMimeMap[extension] = mimeType;
+		markResourceDirty(mimeType);
 	}
 	else {
 	
@@ -1590,6 +1785,7 @@ int	MimeSystem::addResourceHandler(std::string& extension,std::string mimeType,b
 		if (sysDefault)
 			p_rhn->m_resourceHandler.setTag("system-default");	//also tag as a system default
 		m_resourceHandlerMap[mimeType] = p_rhn;
+		markResourceDirty(mimeType);
 		return 1;
 	}
 	
@@ -1601,13 +1797,14 @@ int	MimeSystem::addResourceHandler(std::string& extension,std::string mimeType,b
 	//add it
 	ResourceHandler * p_newHandler = new ResourceHandler(extension,mimeType,appId,!shouldDownload);
 	p_rhn->m_handlersByIndex[p_newHandler->index()] = p_newHandler;
+	markResourceDirty(mimeType);
 	p_rhn->m_alternates.push_back(p_newHandler);
 	return 2;
 }
 
 int	MimeSystem::addResourceHandler(std::string extension,bool shouldDownload,const std::string appId,const std::map<std::string,std::string> * pVerbs,bool sysDefault)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	//find the mime type for this extension
 	std::transform(extension.begin(), extension.end(), extension.begin(), tolower);
 	std::map<std::string,std::string>::iterator mit = m_extensionToMimeMap.find(extension);
@@ -1625,6 +1822,7 @@ int	MimeSystem::addResourceHandler(std::string extension,bool shouldDownload,con
 		if (sysDefault)
 			p_rhn->m_resourceHandler.setTag("system-default");	//also tag as a system default
 		m_resourceHandlerMap[mimeType] = p_rhn;
+		markResourceDirty(mimeType);
 		return 1;
 	}
 
@@ -1636,6 +1834,7 @@ int	MimeSystem::addResourceHandler(std::string extension,bool shouldDownload,con
 	//add it
 	ResourceHandler * p_newHandler = new ResourceHandler(extension,mimeType,appId,!shouldDownload);
 	p_rhn->m_handlersByIndex[p_newHandler->index()] = p_newHandler;
+	markResourceDirty(mimeType);
 
 	p_rhn->m_alternates.push_back(p_newHandler);
 		
@@ -1644,7 +1843,7 @@ int	MimeSystem::addResourceHandler(std::string extension,bool shouldDownload,con
 
 int	MimeSystem::addRedirectHandler(const std::string& url,const std::string appId,const std::map<std::string,std::string> * pVerbs,bool isSchemeForm,bool sysDefault)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	//see if there is a primary entry already
 	RedirectMapIterType it = m_redirectHandlerMap.find(url);
 	if (it == m_redirectHandlerMap.end()) {
@@ -1653,6 +1852,7 @@ int	MimeSystem::addRedirectHandler(const std::string& url,const std::string appI
 		if (sysDefault)
 			p_rhn->m_redirectHandler.setTag("system-default");	//also tag as a system default
 		m_redirectHandlerMap[url] = p_rhn;
+		markRedirectDirty(url);
 		return 1;
 	}
 
@@ -1664,6 +1864,7 @@ int	MimeSystem::addRedirectHandler(const std::string& url,const std::string appI
 	//add it
 	RedirectHandler * p_newHandler = new RedirectHandler(url,appId,isSchemeForm);
 	p_rhn->m_handlersByIndex[p_newHandler->index()] = p_newHandler;
+	markRedirectDirty(url);
 	
 	p_rhn->m_alternates.push_back(p_newHandler);
 	return 2;
@@ -1671,12 +1872,13 @@ int	MimeSystem::addRedirectHandler(const std::string& url,const std::string appI
 
 int	MimeSystem::addVerbsToResourceHandler(std::string mimeType,const std::string& appId,const std::map<std::string,std::string>& verbs)
 {
-
+	TableWriter writer(this);
 	std::transform(mimeType.begin(),mimeType.end(),mimeType.begin(),tolower);
 	ResourceMapIterType resource_it = m_resourceHandlerMap.find(mimeType);
 	if (resource_it != m_resourceHandlerMap.end())
 	{
 		ResourceHandlerNode * p_rhn = resource_it->second;
+		markResourceDirty(mimeType);
 		//go through the handlers to find the app id
 		if (p_rhn->m_resourceHandler.appId() == appId)
 			return MimeSystem::addVerbs(verbs,*p_rhn,p_rhn->m_resourceHandler);		//found it...add verbs
@@ -1692,10 +1894,12 @@ int	MimeSystem::addVerbsToResourceHandler(std::string mimeType,const std::string
 
 int	MimeSystem::addVerbsToRedirectHandler(const std::string& url,const std::string& appId,const std::map<std::string,std::string>& verbs)
 {
+	TableWriter writer(this);
 	RedirectMapIterType redirect_it = m_redirectHandlerMap.find(url);
 	if (redirect_it != m_redirectHandlerMap.end())
 	{
 		RedirectHandlerNode * p_rhn = redirect_it->second;
+		markRedirectDirty(url);
 		//go through the handlers to find the app id
 		if (p_rhn->m_redirectHandler.appId() == appId)
 			return MimeSystem::addVerbs(verbs,*p_rhn,p_rhn->m_redirectHandler);		//found it...add verbs
@@ -1711,45 +1915,52 @@ int	MimeSystem::addVerbsToRedirectHandler(const std::string& url,const std::stri
 
 int	MimeSystem::addVerbsDirect(uint32_t index,const std::map<std::string,std::string>& verbs)
 {
+	TableWriter writer(this);
 	//scan all the maps to find one that has the index in question
 	for (ResourceMapIterType resource_it = m_resourceHandlerMap.begin();
 			resource_it != m_resourceHandlerMap.end();++resource_it)
 	{
 		ResourceHandlerNode * p_rhn = resource_it->second;
 		std::map<uint32_t,ResourceHandler *>::iterator find_it = p_rhn->m_handlersByIndex.find(index);
-		if (find_it != p_rhn->m_handlersByIndex.end())
+		if (find_it != p_rhn->m_handlersByIndex.end()) {
+			markResourceDirty(resource_it->first);
 			return MimeSystem::addVerbs(verbs,*p_rhn,*(find_it->second));		//found it...add verbs
+		}
 	}
 	for (RedirectMapIterType redirect_it = m_redirectHandlerMap.begin();
 	redirect_it != m_redirectHandlerMap.end();++redirect_it)
 	{
 		RedirectHandlerNode * p_rhn = redirect_it->second;
 		std::map<uint32_t,RedirectHandler *>::iterator find_it = p_rhn->m_handlersByIndex.find(index);
-		if (find_it != p_rhn->m_handlersByIndex.end())
+		if (find_it != p_rhn->m_handlersByIndex.end()) {
+			markRedirectDirty(redirect_it->first);
 			return MimeSystem::addVerbs(verbs,*p_rhn,*(find_it->second));		//found it...add verbs
+		}
 	}
 	return 0;
 }
 	
 int MimeSystem::swapResourceHandler(std::string mimeType, uint32_t index)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	std::transform(mimeType.begin(),mimeType.end(),mimeType.begin(),tolower);
 		
 	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
 	if (it == m_resourceHandlerMap.end())
 		return 0;
 	
+	markResourceDirty(mimeType);
 	return (it->second->swapHandler(index));
 }
 
 int	MimeSystem::swapRedirectHandler(const std::string& url, uint32_t index)
 {
-	MutexLocker lock(&m_mutex);
+	TableWriter writer(this);
 	RedirectMapIterType it = m_redirectHandlerMap.find(url);
 	if (it == m_redirectHandlerMap.end())
 		return 0;
 
+	markRedirectDirty(url);
 	return (it->second->swapHandler(index));
 }
 
@@ -1777,10 +1988,10 @@ bool MimeSystem::getExtensionFromUrl(const std::string& url,std::string& r_extn)
 
 bool MimeSystem::getMimeTypeByExtension(std::string extension,std::string& r_mimeType)
 {
-	MutexLocker lock(&m_mutex);
+	SnapshotRef snapshot(this);
 	std::transform(extension.begin(), extension.end(), extension.begin(), tolower);
-	std::map<std::string,std::string>::iterator it = m_extensionToMimeMap.find(extension);
-	if (it != m_extensionToMimeMap.end()) 
+	std::map<std::string,std::string>::iterator it = snapshot->m_extensionToMimeMap.find(extension);
+	if (it != snapshot->m_extensionToMimeMap.end()) 
 	{
 		r_mimeType = it->second;
 		return true;
@@ -1819,6 +2030,7 @@ std::string	MimeSystem::makePseudoExtensionFromMime(const std::string& mimeType)
 
 std::string	MimeSystem::allTablesAsJsonString()
 {
+	//keeps writers out so both tables come from the same snapshot; lookups aren't held up
 	MutexLocker locker(&m_mutex);
 	json_object * jobj = json_object_new_object();
 	json_object_object_add(jobj,(char *)"resources",resourceTableAsJsonArray());
@@ -1830,7 +2042,6 @@ std::string	MimeSystem::allTablesAsJsonString()
 
 std::string	MimeSystem::resourceTableAsJsonString()
 {
-	MutexLocker locker(&m_mutex);
 	json_object * jobj = resourceTableAsJson();
 	std::string s = json_object_to_json_string(jobj);
 	json_object_put(jobj);
@@ -1839,11 +2050,11 @@ std::string	MimeSystem::resourceTableAsJsonString()
 
 json_object * MimeSystem::resourceTableAsJson()	//WARNING: memory allocated; caller must clean
 {
-	MutexLocker locker(&m_mutex);
+	SnapshotRef snapshot(this);
 	json_object * jobj = json_object_new_object();
 	json_object * jarray = json_object_new_array();
-	for (ResourceMapIterType it = m_resourceHandlerMap.begin();
-	it != m_resourceHandlerMap.end();++it) 
+	for (ResourceMapIterType it = snapshot->m_resourceHandlerMap.begin();
+	it != snapshot->m_resourceHandlerMap.end();++it) 
 	{
 		json_object * inner_jobj = json_object_new_object();
 		json_object_object_add(inner_jobj,(char *)"mimeType",json_object_new_string(it->first.c_str()));
@@ -1856,10 +2067,10 @@ json_object * MimeSystem::resourceTableAsJson()	//WARNING: memory allocated; cal
 
 json_object * MimeSystem::resourceTableAsJsonArray()	//WARNING: memory allocated; caller must clean
 {
-	MutexLocker locker(&m_mutex);
+	SnapshotRef snapshot(this);
 	json_object * jobj = json_object_new_array();
-	for (ResourceMapIterType it = m_resourceHandlerMap.begin();
-	it != m_resourceHandlerMap.end();++it) 
+	for (ResourceMapIterType it = snapshot->m_resourceHandlerMap.begin();
+	it != snapshot->m_resourceHandlerMap.end();++it) 
 	{
 		json_object * inner_jobj = json_object_new_object();
 		json_object_object_add(inner_jobj,(char *)"mimeType",json_object_new_string(it->first.c_str()));
@@ -1873,7 +2084,6 @@ json_object * MimeSystem::resourceTableAsJsonArray()	//WARNING: memory allocated
 
 std::string	MimeSystem::redirectTableAsJsonString()
 {
-	MutexLocker locker(&m_mutex);
 	json_object * jobj = redirectTableAsJson();
 	std::string s = json_object_to_json_string(jobj);
 	json_object_put(jobj);
@@ -1882,11 +2092,11 @@ std::string	MimeSystem::redirectTableAsJsonString()
 	
 json_object * MimeSystem::redirectTableAsJson() //WARNING: memory allocated; caller must clean
 {
-	MutexLocker locker(&m_mutex);
+	SnapshotRef snapshot(this);
 	json_object * jobj = json_object_new_object();
 	json_object * jarray = json_object_new_array();
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();
-	it != m_redirectHandlerMap.end();++it) 
+	for (RedirectMapIterType it = snapshot->m_redirectHandlerMap.begin();
+	it != snapshot->m_redirectHandlerMap.end();++it) 
 	{
 		json_object * inner_jobj = json_object_new_object();
 		json_object_object_add(inner_jobj,(char *)"url",json_object_new_string(it->first.c_str()));
@@ -1899,10 +2109,10 @@ json_object * MimeSystem::redirectTableAsJson() //WARNING: memory allocated; cal
 
 json_object * MimeSystem::redirectTableAsJsonArray() //WARNING: memory allocated; caller must clean
 {
-	MutexLocker locker(&m_mutex);
+	SnapshotRef snapshot(this);
 	json_object * jobj = json_object_new_array();
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();
-	it != m_redirectHandlerMap.end();++it) 
+	for (RedirectMapIterType it = snapshot->m_redirectHandlerMap.begin();
+	it != snapshot->m_redirectHandlerMap.end();++it) 
 	{
 		json_object * inner_jobj = json_object_new_object();
 		json_object_object_add(inner_jobj,(char *)"url",json_object_new_string(it->first.c_str()));
@@ -1914,7 +2124,6 @@ json_object * MimeSystem::redirectTableAsJsonArray() //WARNING: memory allocated
 
 std::string	MimeSystem::extensionMapAsJsonString()
 {
-	MutexLocker locker(&m_mutex);
 	struct json_object * jobj = extensionMapAsJson();
 	std::string s = json_object_to_json_string(jobj);
 	json_object_put(jobj);
@@ -1923,12 +2132,12 @@ std::string	MimeSystem::extensionMapAsJsonString()
 
 json_object * MimeSystem::extensionMapAsJson()	//WARNING: memory allocated; caller must clean
 {
-	MutexLocker locker(&m_mutex);
+	SnapshotRef snapshot(this);
 	struct json_object * jobj = json_object_new_object();
 	json_object * jarr = json_object_new_array();
 	
-	for (std::map<std::string,std::string>::iterator it = m_extensionToMimeMap.begin();
-		it != m_extensionToMimeMap.end();++it) {
+	for (std::map<std::string,std::string>::iterator it = snapshot->m_extensionToMimeMap.begin();
+		it != snapshot->m_extensionToMimeMap.end();++it) {
 		struct json_object * jobj_inner = json_object_new_object();
 		json_object_object_add(jobj_inner,(char *)(it->first.c_str()),json_object_new_string(it->second.c_str()));
 		json_object_array_add(jarr,jobj_inner);
@@ -1939,11 +2148,11 @@ json_object * MimeSystem::extensionMapAsJson()	//WARNING: memory allocated; call
 
 json_object * MimeSystem::extensionMapAsJsonArray() //WARNING: memory allocated; caller must clean
 {
-	MutexLocker locker(&m_mutex);
+	SnapshotRef snapshot(this);
 	json_object * jarr = json_object_new_array();
 	
-	for (std::map<std::string,std::string>::iterator it = m_extensionToMimeMap.begin();
-		it != m_extensionToMimeMap.end();++it) {
+	for (std::map<std::string,std::string>::iterator it = snapshot->m_extensionToMimeMap.begin();
+		it != snapshot->m_extensionToMimeMap.end();++it) {
 		struct json_object * jobj_inner = json_object_new_object();
 		json_object_object_add(jobj_inner,(char *)(it->first.c_str()),json_object_new_string(it->second.c_str()));
 		json_object_array_add(jarr,jobj_inner);
@@ -1951,17 +2160,59 @@ json_object * MimeSystem::extensionMapAsJsonArray() //WARNING: memory allocated;
 	return jarr;
 }
 
+uint32_t MimeSystem::generation()
+{
+	SnapshotRef snapshot(this);
+	return snapshot->m_generation;
+}
+
+/*
+ * (CALL UNDER m_responseMutex) m_tablesResponse, brought up to the current snapshot. Only the entries of a
+ * rebuild go through toJson(); a snapshot that didn't change costs nothing
+ */
+const ListResponseCache * MimeSystem::currentTablesResponse()
+{
+	SnapshotRef snapshot(this);
+	if (m_tablesResponse->isCurrent(snapshot->m_generation))
+		return m_tablesResponse;
+	
+	std::vector<ListResponseCache::ItemList> lists(2);
+	for (ResourceMapIterType it = snapshot->m_resourceHandlerMap.begin();it != snapshot->m_resourceHandlerMap.end();++it) {
+		json_object * inner_jobj = json_object_new_object();
+		json_object_object_add(inner_jobj,(char *)"mimeType",json_object_new_string(it->first.c_str()));
+		json_object_object_add(inner_jobj,(char *)"handlers",it->second->toJson());
+		lists[0].push_back(std::make_pair(it->first,std::string(json_object_to_json_string(inner_jobj))));
+		json_object_put(inner_jobj);
+	}
+	for (RedirectMapIterType it = snapshot->m_redirectHandlerMap.begin();it != snapshot->m_redirectHandlerMap.end();++it) {
+		json_object * inner_jobj = json_object_new_object();
+		json_object_object_add(inner_jobj,(char *)"url",json_object_new_string(it->first.c_str()));
+		json_object_object_add(inner_jobj,(char *)"handlers",it->second->toJson());
+		lists[1].push_back(std::make_pair(it->first,std::string(json_object_to_json_string(inner_jobj))));
+		json_object_put(inner_jobj);
+	}
+	
+	m_tablesResponse->update(snapshot->m_generation,lists);
+	return m_tablesResponse;
+}
+
+std::string MimeSystem::tablesResponse()
+{
+	MutexLocker locker(&m_responseMutex);
+	return currentTablesResponse()->response();
+}
+
+std::string MimeSystem::tablesResponse(uint32_t sinceGeneration)
+{
+	MutexLocker locker(&m_responseMutex);
+	return currentTablesResponse()->response(sinceGeneration);
+}
+
 bool MimeSystem::saveMimeTable(const std::string& file,std::string& r_err)
 {
+	//keeps writers out so all the tables come from the same snapshot; lookups aren't held up
 	MutexLocker locker(&m_mutex);
-	std::string mimeTablesJsonStr;
 	r_err.clear();
-	//try and open the file
-	FILE * fp = fopen(file.c_str(),"w");
-	if (!fp) {
-		r_err = "Unable to open file "+file;
-		return false;
-	}
 	
 	struct json_object * outer_jobj = json_object_new_object();
 	
@@ -1973,61 +2224,180 @@ bool MimeSystem::saveMimeTable(const std::string& file,std::string& r_err)
 	
 	std::string s = json_object_to_json_string(outer_jobj);
 	json_object_put(outer_jobj);
+	s += "\n\n";
 	
-	//write it
-	size_t wr = fwrite(s.data(),1,s.size(),fp);
-	if (wr != s.size()) {
-		r_err = "Couldn't write maps to file "+file;
-		goto Done_saveMimeTable;
+	//write to the side and rename over, so a crash mid-write never leaves a truncated file
+	std::string tmpFile = file + ".tmp";
+	FILE * fp = fopen(tmpFile.c_str(),"w");
+	if (!fp) {
+		r_err = "Unable to open file "+file;
+		return false;
 	}
 	
-	fprintf(fp,"\n\n");
-	
-Done_saveMimeTable:
-
+	bool success = (fwrite(s.data(),1,s.size(),fp) == s.size());
+	success = (fflush(fp) == 0) && success;
+	success = (fsync(fileno(fp)) == 0) && success;
 	fclose(fp);
-	if (r_err.size())
+	
+	if (success)
+		success = (rename(tmpFile.c_str(),file.c_str()) == 0);
+	if (!success) {
+		unlink(tmpFile.c_str());
+		r_err = "Couldn't write maps to file "+file;
 		return false;
+	}
 	return true;
 }
 
 bool MimeSystem::saveMimeTableToActiveFile(std::string& r_err)
 {
+	//keeps writers out while the records are collected; lookups aren't held up
 	MutexLocker locker(&m_mutex);
-	std::string mimeTablesJsonStr;
 	r_err.clear();
-	//try and open the file
-	FILE * fp = fopen(Settings::LunaSettings()->lunaCmdHandlerSavedPath.c_str(),"w");
-	if (!fp) {
-		r_err = std::string("Unable to open file ")+Settings::LunaSettings()->lunaCmdHandlerSavedPath;
-		return false;
-	}
-	
-	struct json_object * outer_jobj = json_object_new_object();
 	
-	//get the extension map, and the mime tables and wrap into a json object
-	json_object_object_add(outer_jobj,(char *)"schemaVersion",json_object_new_int(2));
-	json_object_object_add(outer_jobj,(char *)"extensionMap",extensionMapAsJsonArray());
-	json_object_object_add(outer_jobj,(char *)"resources",resourceTableAsJsonArray());
-	json_object_object_add(outer_jobj,(char *)"redirects",redirectTableAsJsonArray());
+	//this save covers whatever the scheduled one would have written
+	if (m_saveSource) {
+		g_source_remove(m_saveSource);
+		m_saveSource = 0;
+	}
 	
-	std::string s = json_object_to_json_string(outer_jobj);
-	json_object_put(outer_jobj);
+	return writeActiveFile(true,r_err);
+}
+
+/*
+ * (CALL UNDER m_mutex) Only what changed since the last save is written: one record per touched mime type / url,
+ * appended to the store's log. The whole table is rewritten (compacted) when the tables were replaced wholesale
+ * (restore, clear), and on a synced save when most of the table changed or the log has grown past the snapshot.
+ * Without sync, appends reach the file but not necessarily the disk; a rewrite is always synced.
+ */
+bool MimeSystem::writeActiveFile(bool sync,std::string& r_err)
+{
+	MimeTableStore * store = activeStore();
+	bool rewrite = m_unsavedAll || !store->hasSnapshot()
+			|| (sync && ((m_unsavedResources.size() + m_unsavedRedirects.size()) * 2 > (m_resourceHandlerMap.size() + m_redirectHandlerMap.size())));
 	
-	//write it
-	size_t wr = fwrite(s.data(),1,s.size(),fp);
-	if (wr != s.size()) {
-		r_err = std::string("Couldn't write maps to file ")+Settings::LunaSettings()->lunaCmdHandlerSavedPath;
-		goto Done_saveMimeTableToActiveFile;
+	std::vector<MimeTableStore::Record> records;
+	bool rc = true;
+	if (!rewrite) {
+		if (!m_unsavedResources.empty() || !m_unsavedRedirects.empty()) {
+			unsavedRecords(records);
+			rc = store->append(records,sync,r_err);
+		}
+		else if (sync) {
+			rc = store->sync(r_err);
+		}
+		rewrite = rc && sync && store->shouldCompact();
+	}
+	if (rewrite) {
+		records.clear();
+		tableRecords(records);
+		rc = store->compact(records,r_err);
 	}
 	
-	fprintf(fp,"\n\n");
-	
-Done_saveMimeTableToActiveFile:
+	if (rc) {
+		m_unsavedResources.clear();
+		m_unsavedRedirects.clear();
+		m_unsavedAll = false;
+	}
+	return rc;
+}
 
-	fclose(fp);
-	if (r_err.size())
+/*
+ * Handler changes come in bursts (an install or a restore touches many entries, one service call each); saving
+ * after every one of them meant a write and an fdatasync() per call. The change is written to the log right away,
+ * so once the caller is answered it survives sysmgr going down; only the fdatasync() (and any compaction) waits for
+ * the timeout. The timeout isn't pushed back by later changes, so nothing waits longer than
+ * MIMESYSTEM_ACTIVE_SAVE_DELAY_MS to reach the disk.
+ */
+void MimeSystem::scheduleSaveToActiveFile()
+{
+	MutexLocker locker(&m_mutex);
+	std::string err;
+	if (!writeActiveFile(false,err))
+		g_warning("MimeSystem: writing to the active mime table failed: %s",err.c_str());
+	if (!m_saveSource)
+		m_saveSource = g_timeout_add(MIMESYSTEM_ACTIVE_SAVE_DELAY_MS,cbSaveToActiveFile,this);
+}
+
+bool MimeSystem::flushScheduledSave(std::string& r_err)
+{
+	{
+		MutexLocker locker(&m_mutex);
+		r_err.clear();
+		if (!m_saveSource)
+			return true;
+	}
+	return saveMimeTableToActiveFile(r_err);
+}
+
+unsigned int MimeSystem::activeFileWrites()
+{
+	MutexLocker locker(&m_mutex);
+	MimeTableStore * store = activeStore();
+	return store->appends() + store->compactions();
+}
+
+unsigned int MimeSystem::activeFileSyncs()
+{
+	MutexLocker locker(&m_mutex);
+	return activeStore()->syncs();
+}
+
+//static
+gboolean MimeSystem::cbSaveToActiveFile(gpointer data)
+{
+	MimeSystem * mimeSystem = static_cast<MimeSystem *>(data);
+	{
+		MutexLocker locker(&(mimeSystem->m_mutex));
+		mimeSystem->m_saveSource = 0;		//the source goes away when this returns false
+	}
+	std::string err;
+	if (!mimeSystem->saveMimeTableToActiveFile(err))
+		g_warning("MimeSystem: saving the active mime table failed: %s",err.c_str());
+	return false;
+}
+
+bool MimeSystem::restoreMimeTableFromStore(std::string& r_err)
+{
+	TableWriter writer(this);
+	
+	std::vector<MimeTableStore::Record> records;
+	if (!activeStore()->load(records,r_err))
 		return false;
+	
+	//(also resets the handler index generator, so this has to come before any node is made)
+	destroy();
+	
+	bool complete = true;
+	for (std::vector<MimeTableStore::Record>::iterator it = records.begin();it != records.end();++it) {
+		MimeTableStore::Decoder dec(it->value.data(),it->value.size());
+		if (it->type == MimeTableStore::RecordExtension) {
+			m_extensionToMimeMap[it->key] = it->value;
+		}
+		else if (it->type == MimeTableStore::RecordResource) {
+			ResourceHandlerNode * p_rhn = ResourceHandlerNode::decode(dec);
+			if (p_rhn)
+				m_resourceHandlerMap[it->key] = p_rhn;
+			else {
+				g_warning("MimeSystem::restoreMimeTableFromStore(): skipping unreadable entry for resource %s",it->key.c_str());
+				complete = false;
+			}
+		}
+		else if (it->type == MimeTableStore::RecordRedirect) {
+			RedirectHandlerNode * p_rhn = RedirectHandlerNode::decode(dec);
+			if (p_rhn)
+				m_redirectHandlerMap[it->key] = p_rhn;
+			else {
+				g_warning("MimeSystem::restoreMimeTableFromStore(): skipping unreadable entry for url %s",it->key.c_str());
+				complete = false;
+			}
+		}
+	}
+	
+	//the store already has all of this; if something had to be skipped, the next save rewrites it without it
+	m_unsavedResources.clear();
+	m_unsavedRedirects.clear();
+	m_unsavedAll = !complete;
 	return true;
 }
 
@@ -2054,6 +2424,8 @@ bool MimeSystem::restoreMimeTable(const std::string& file,std::string& r_err)
 
 bool MimeSystem::restoreMimeTable(json_object * root,std::string& r_err)
 {
+	TableWriter writer(this);
+	markAllDirty();
 	std::string val_s;
 	json_object * topLevel_jobj;
 	
@@ -2144,7 +2516,10 @@ void MimeSystem::deleteSavedMimeTable()
 {
 	MutexLocker locker(&s_mutex);
 	unlink(Settings::LunaSettings()->lunaCmdHandlerSavedPath.c_str());
-	
+	if (s_p_inst) {
+		MutexLocker tableLocker(&(s_p_inst->m_mutex));
+		s_p_inst->activeStore()->remove();
+	}
 }
 
 bool MimeSystem::dbg_printMimeTables()
@@ -2184,9 +2559,9 @@ bool MimeSystem::dbg_printMimeTables()
 
 bool MimeSystem::dbg_getResourceTableStrings(std::vector<std::pair<std::string,std::vector<std::string> > >& r_resourceTableStrings)
 {
-	MutexLocker locker(&m_mutex);
-	for (ResourceMapIterType it = m_resourceHandlerMap.begin();
-	it != m_resourceHandlerMap.end();++it) 
+	SnapshotRef snapshot(this);
+	for (ResourceMapIterType it = snapshot->m_resourceHandlerMap.begin();
+	it != snapshot->m_resourceHandlerMap.end();++it) 
 	{
 		ResourceHandlerNode * p_rhn = it->second;
 		std::vector<std::string> strings;
@@ -2203,9 +2578,9 @@ bool MimeSystem::dbg_getResourceTableStrings(std::vector<std::pair<std::string,s
 
 bool MimeSystem::dbg_getRedirectTableStrings(std::vector<std::pair<std::string,std::vector<std::string> > >& r_redirectTableStrings)
 {
-	MutexLocker locker(&m_mutex);
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();
-	it != m_redirectHandlerMap.end();++it) 
+	SnapshotRef snapshot(this);
+	for (RedirectMapIterType it = snapshot->m_redirectHandlerMap.begin();
+	it != snapshot->m_redirectHandlerMap.end();++it) 
 	{
 		RedirectHandlerNode * p_rhn = it->second;
 		std::vector<std::string> strings;
@@ -2222,8 +2597,9 @@ bool MimeSystem::dbg_getRedirectTableStrings(std::vector<std::pair<std::string,s
 
 void MimeSystem::dbg_printVerbCacheTableForResource(const std::string& mime)
 {
-	MutexLocker locker(&m_mutex);
-	ResourceHandlerNode * p_rhn = getResourceHandlerNode(mime);
+	SnapshotRef snapshot(this);
+	ResourceMapIterType it = snapshot->m_resourceHandlerMap.find(mime);
+	ResourceHandlerNode * p_rhn = (it != snapshot->m_resourceHandlerMap.end() ? it->second : NULL);
 	if (p_rhn == NULL) {
 		printf("didn't find any nodes for mime type %s\n",mime.c_str());
 		return;
@@ -2234,8 +2610,8 @@ void MimeSystem::dbg_printVerbCacheTableForResource(const std::string& mime)
 
 void MimeSystem::dbg_printVerbCacheTableForRedirect(const std::string& url)
 {
-	MutexLocker locker(&m_mutex);
-	RedirectHandlerNode * p_rhn = this->getRedirectHandlerNode(url);
+	SnapshotRef snapshot(this);
+	RedirectHandlerNode * p_rhn = snapshot->matchRedirectNode(url,false,true);
 	if (p_rhn == NULL) {
 		printf("didn't find any nodes for redirect(url) %s\n",url.c_str());
 		return;
@@ -2245,8 +2621,8 @@ void MimeSystem::dbg_printVerbCacheTableForRedirect(const std::string& url)
 
 void MimeSystem::dbg_printVerbCacheTableForScheme(const std::string& url)
 {
-	MutexLocker locker(&m_mutex);
-	RedirectHandlerNode * p_rhn = this->getSchemeHandlerNode(url);
+	SnapshotRef snapshot(this);
+	RedirectHandlerNode * p_rhn = snapshot->matchRedirectNode(url,true,false);
 	if (p_rhn == NULL) {
 		printf("didn't find any nodes for redirect(scheme) %s\n",url.c_str());
 		return;
@@ -2284,20 +2660,232 @@ void MimeSystem::dbg_printRedirectHandlerNode(const RedirectHandlerNode * p_redi
 // --------------------------------------------------- private ---------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 
-MimeSystem::MimeSystem() 
+MimeSystem::MimeSystem() : m_snapshot(new Snapshot()) , m_snapshotEpoch(0) , m_writeDepth(0) , m_allDirty(false) , m_store(0) , m_tablesResponse(0) , m_unsavedAll(false) , m_saveSource(0)
 {
-	
+	std::vector<std::string> listNames;
+	listNames.push_back("resources");
+	listNames.push_back("redirects");
+	m_tablesResponse = new ListResponseCache(listNames);
+	m_snapshot->m_generation = ListResponseCache::initialGeneration();
+	m_snapshotReaders[0] = 0;
+	m_snapshotReaders[1] = 0;
 }
 
 //virtual 
 MimeSystem::~MimeSystem()
 {
+	std::string err;
+	if (!flushScheduledSave(err))
+		g_warning("MimeSystem: saving the active mime table failed: %s",err.c_str());
 	destroy();
+	releaseSnapshot(m_snapshot);
+	delete m_store;
+	delete m_tablesResponse;
+}
+
+MimeSystem::Snapshot::~Snapshot()
+{
+	for (ResourceMapIterType it = m_resourceHandlerMap.begin();it != m_resourceHandlerMap.end();++it) {
+		if (g_atomic_int_dec_and_test(&(it->second->m_snapshotRefs)))
+			delete it->second;
+	}
+	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
+		if (g_atomic_int_dec_and_test(&(it->second->m_snapshotRefs)))
+			delete it->second;
+	}
+	if (m_redirectIndex && g_atomic_int_dec_and_test(&(m_redirectIndex->m_refCount)))
+		delete m_redirectIndex;
+}
+
+MimeSystem::RedirectHandlerNode * MimeSystem::Snapshot::matchRedirectNode(const std::string& url,bool schemeForms,bool urlForms)
+{
+	if (!m_redirectIndex)
+		return NULL;
+	return static_cast<RedirectHandlerNode *>(m_redirectIndex->m_matcher.matchFirst(url,schemeForms,urlForms));
+}
+
+int MimeSystem::Snapshot::matchAllRedirectNodes(const std::string& url,std::vector<RedirectHandlerNode *>& r_nodes)
+{
+	if (!m_redirectIndex)
+		return 0;
+	std::vector<void *> cookies;
+	int rc = m_redirectIndex->m_matcher.matchAll(url,cookies);
+	for (std::vector<void *>::iterator it = cookies.begin();it != cookies.end();++it)
+		r_nodes.push_back(static_cast<RedirectHandlerNode *>(*it));
+	return rc;
+}
+
+/*
+ * lock free; the epoch is re-checked after announcing the reader so that publishSnapshot(), which flips the epoch
+ * after swapping the pointer, either waits for this reader or this reader sees the new pointer
+ */
+MimeSystem::Snapshot * MimeSystem::acquireSnapshot()
+{
+	gint epoch;
+	for (;;) {
+		epoch = g_atomic_int_get(&m_snapshotEpoch);
+		g_atomic_int_inc(&(m_snapshotReaders[epoch]));
+		if (g_atomic_int_get(&m_snapshotEpoch) == epoch)
+			break;
+		g_atomic_int_add(&(m_snapshotReaders[epoch]),-1);
+	}
+	Snapshot * snapshot = static_cast<Snapshot *>(g_atomic_pointer_get(reinterpret_cast<volatile gpointer *>(&m_snapshot)));
+	g_atomic_int_inc(&(snapshot->m_refCount));
+	g_atomic_int_add(&(m_snapshotReaders[epoch]),-1);
+	return snapshot;
+}
+
+//static
+void MimeSystem::releaseSnapshot(Snapshot * snapshot)
+{
+	if (snapshot && g_atomic_int_dec_and_test(&(snapshot->m_refCount)))
+		delete snapshot;
+}
+
+/*
+ * (CALL UNDER m_mutex) builds the snapshot for the live tables as they are now and makes it the one lookups see
+ */
+void MimeSystem::publishSnapshot()
+{
+	if (!m_allDirty && m_dirtyResources.empty() && m_dirtyRedirects.empty())
+		return;
+	
+	//m_snapshot is only ever replaced here, under m_mutex
+	Snapshot * previous = m_snapshot;
+	Snapshot * next = new Snapshot();
+	next->m_generation = previous->m_generation + 1;
+	next->m_extensionToMimeMap = m_extensionToMimeMap;
+	
+	for (ResourceMapIterType it = m_resourceHandlerMap.begin();it != m_resourceHandlerMap.end();++it) {
+		ResourceHandlerNode * p_rhn = NULL;
+		if (!m_allDirty && (m_dirtyResources.find(it->first) == m_dirtyResources.end())) {
+			ResourceMapIterType prev_it = previous->m_resourceHandlerMap.find(it->first);
+			if (prev_it != previous->m_resourceHandlerMap.end()) {
+				p_rhn = prev_it->second;
+				g_atomic_int_inc(&(p_rhn->m_snapshotRefs));
+			}
+		}
+		if (!p_rhn)
+			p_rhn = new ResourceHandlerNode(*(it->second));
+		next->m_resourceHandlerMap.insert(next->m_resourceHandlerMap.end(),std::make_pair(it->first,p_rhn));
+	}
+	
+	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
+		RedirectHandlerNode * p_rhn = NULL;
+		if (!m_allDirty && (m_dirtyRedirects.find(it->first) == m_dirtyRedirects.end())) {
+			RedirectMapIterType prev_it = previous->m_redirectHandlerMap.find(it->first);
+			if (prev_it != previous->m_redirectHandlerMap.end()) {
+				p_rhn = prev_it->second;
+				g_atomic_int_inc(&(p_rhn->m_snapshotRefs));
+			}
+		}
+		if (!p_rhn)
+			p_rhn = new RedirectHandlerNode(*(it->second));
+		next->m_redirectHandlerMap.insert(next->m_redirectHandlerMap.end(),std::make_pair(it->first,p_rhn));
+	}
+	
+	if (!m_allDirty && m_dirtyRedirects.empty() && previous->m_redirectIndex) {
+		//same nodes as before, so the same matcher (its cookies are the node pointers)
+		next->m_redirectIndex = previous->m_redirectIndex;
+		g_atomic_int_inc(&(next->m_redirectIndex->m_refCount));
+	}
+	else {
+		//table order, so the first match is the same node a walk over the map would find
+		next->m_redirectIndex = new RedirectIndex();
+		for (RedirectMapIterType it = next->m_redirectHandlerMap.begin();it != next->m_redirectHandlerMap.end();++it)
+			next->m_redirectIndex->m_matcher.add(it->second->m_redirectHandler,it->second);
+	}
+	
+	g_atomic_pointer_set(reinterpret_cast<volatile gpointer *>(&m_snapshot),next);
+	
+	//readers still in the old epoch may have loaded previous without counting it yet; they are a load and an
+	//increment away from done
+	gint epoch = g_atomic_int_get(&m_snapshotEpoch);
+	g_atomic_int_set(&m_snapshotEpoch,1-epoch);
+	while (g_atomic_int_get(&(m_snapshotReaders[epoch])) != 0)
+		g_thread_yield();
+	releaseSnapshot(previous);
+	
+	m_dirtyResources.clear();
+	m_dirtyRedirects.clear();
+	m_allDirty = false;
+}
+
+/*
+ * (CALL UNDER m_mutex) the store that saveMimeTableToActiveFile() writes to: a snapshot and its log next to
+ * where the json active copy used to go (the json copy is still read, if there's no store yet)
+ */
+MimeTableStore * MimeSystem::activeStore()
+{
+	if (!m_store) {
+		std::string base = Settings::LunaSettings()->lunaCmdHandlerSavedPath;
+		if ((base.size() > 5) && (base.compare(base.size()-5,5,".json") == 0))
+			base.erase(base.size()-5);
+		m_store = new MimeTableStore(base+".tbl",base+".log");
+	}
+	return m_store;
+}
+
+/*
+ * (CALL UNDER m_mutex) every table entry as store records
+ */
+void MimeSystem::tableRecords(std::vector<MimeTableStore::Record>& r_records)
+{
+	for (std::map<std::string,std::string>::iterator it = m_extensionToMimeMap.begin();it != m_extensionToMimeMap.end();++it)
+		r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordExtension,it->first,it->second));
+	
+	for (ResourceMapIterType it = m_resourceHandlerMap.begin();it != m_resourceHandlerMap.end();++it) {
+		r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordResource,it->first,std::string()));
+		MimeTableStore::Encoder enc(r_records.back().value);
+		it->second->encode(enc);
+	}
+	
+	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
+		r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordRedirect,it->first,std::string()));
+		MimeTableStore::Encoder enc(r_records.back().value);
+		it->second->encode(enc);
+	}
+}
+
+/*
+ * (CALL UNDER m_mutex) store records for the entries changed since the last save. Extension mappings are
+ * only ever added alongside a resource handler (and only cleared all at once), so the ones for the changed
+ * mime types cover every new mapping
+ */
+void MimeSystem::unsavedRecords(std::vector<MimeTableStore::Record>& r_records)
+{
+	for (std::map<std::string,std::string>::iterator it = m_extensionToMimeMap.begin();it != m_extensionToMimeMap.end();++it) {
+		if (m_unsavedResources.find(it->second) != m_unsavedResources.end())
+			r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordExtension,it->first,it->second));
+	}
+	
+	for (std::set<std::string>::iterator it = m_unsavedResources.begin();it != m_unsavedResources.end();++it) {
+		ResourceMapIterType node_it = m_resourceHandlerMap.find(*it);
+		if (node_it == m_resourceHandlerMap.end()) {
+			r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordRemoveResource,*it,std::string()));
+			continue;
+		}
+		r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordResource,*it,std::string()));
+		MimeTableStore::Encoder enc(r_records.back().value);
+		node_it->second->encode(enc);
+	}
+	
+	for (std::set<std::string>::iterator it = m_unsavedRedirects.begin();it != m_unsavedRedirects.end();++it) {
+		RedirectMapIterType node_it = m_redirectHandlerMap.find(*it);
+		if (node_it == m_redirectHandlerMap.end()) {
+			r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordRemoveRedirect,*it,std::string()));
+			continue;
+		}
+		r_records.push_back(MimeTableStore::Record(MimeTableStore::RecordRedirect,*it,std::string()));
+		MimeTableStore::Encoder enc(r_records.back().value);
+		node_it->second->encode(enc);
+	}
 }
 
 void MimeSystem::destroy()
 {
-	MutexLocker locker(&m_mutex);
+	TableWriter writer(this);
+	markAllDirty();
 	m_extensionToMimeMap.clear();
 	for (RedirectMapIterType it = m_redirectHandlerMap.begin();
 		it != m_redirectHandlerMap.end();++it) 
@@ -2457,41 +3045,4 @@ int MimeSystem::extractVerbsFromHandlerNodeEntryJson(struct json_object * jsonHa
 	return rc;
 }
 
-MimeSystem::ResourceHandlerNode * MimeSystem::getResourceHandlerNode(const std::string& mimeType)
-{
-	MutexLocker lock(&m_mutex);
-	ResourceMapIterType it = m_resourceHandlerMap.find(mimeType);
-	if (it != m_resourceHandlerMap.end()) {
-		return it->second;
-	}
-	return NULL;	//return invalid object (see ResourceHandler::valid() )
-		
-}
-
-MimeSystem::RedirectHandlerNode * MimeSystem::getRedirectHandlerNode(const std::string& url)
-{
-	MutexLocker lock(&m_mutex);
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		if (it->second->m_redirectHandler.isSchemeForm())
-			continue;
-		//try and match against it
-		if (it->second->m_redirectHandler.matches(url))
-			return it->second;
-	}
-	return NULL;
-		
-}
-
-MimeSystem::RedirectHandlerNode * MimeSystem::getSchemeHandlerNode(const std::string& url)
-{
-	MutexLocker lock(&m_mutex);
-	for (RedirectMapIterType it = m_redirectHandlerMap.begin();it != m_redirectHandlerMap.end();++it) {
-		if (it->second->m_redirectHandler.isSchemeForm() == false)
-			continue;
-		//try and match against it
-		if (it->second->m_redirectHandler.matches(url))
-			return it->second;
-	}
-	return NULL;
-}
 
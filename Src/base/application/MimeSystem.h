@@ -29,9 +29,15 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <glib.h>
 
 #include "Mutex.h"
+#include "MutexLocker.h"
 #include "CmdResourceHandlers.h"
+#include "RedirectMatcher.h"
+#include "MimeTableStore.h"
+
+class ListResponseCache;
 
 class MimeSystem
 {
@@ -135,11 +141,24 @@ public:
 	std::string			extensionMapAsJsonString();
 	json_object *		extensionMapAsJson();	//WARNING: memory allocated; caller must clean
 	json_object *		extensionMapAsJsonArray();	//WARNING: memory allocated; caller must clean
+	
+	//the dumpMimeTable reply for the tables as they are now; rebuilt only if they changed since the last call.
+	//With sinceGeneration, only the entries that changed after it (see ListResponseCache)
+	std::string			tablesResponse();
+	std::string			tablesResponse(uint32_t sinceGeneration);
+	uint32_t			generation();
 		
 	bool				saveMimeTable(const std::string& file,std::string& r_err);
 	bool				saveMimeTableToActiveFile(std::string& r_err);
+	//writes the changes to the active store's log now, and syncs (or compacts) it from a timeout,
+	//MIMESYSTEM_ACTIVE_SAVE_DELAY_MS after the first change that asked for it; changes in the meantime share the sync
+	void				scheduleSaveToActiveFile();
+	bool				flushScheduledSave(std::string& r_err);		//saves now if a save is scheduled
+	unsigned int		activeFileWrites();			//appends to and rewrites of the active store so far
+	unsigned int		activeFileSyncs();			//... and the syncs that put them on the disk
 	bool				restoreMimeTable(const std::string& file,std::string& r_err);
 	bool				restoreMimeTable(json_object * source,std::string& r_err);			//a version of restore that takes a read-in version of the file as a json obj.
+	bool				restoreMimeTableFromStore(std::string& r_err);		//the tables saved by saveMimeTableToActiveFile()
 	bool				clearMimeTable();
 	static void			deleteSavedMimeTable();				
 	
@@ -178,9 +197,10 @@ private:
 	
 	class RedirectHandlerNode {
 	public:
-		RedirectHandlerNode(const std::string& urlRe, const std::string& appId , bool schemeForm) : m_redirectHandler(urlRe,appId,schemeForm) {
+		RedirectHandlerNode(const std::string& urlRe, const std::string& appId , bool schemeForm) : m_redirectHandler(urlRe,appId,schemeForm) , m_snapshotRefs(1) , m_snapshotCopy(false) {
 			m_handlersByIndex[m_redirectHandler.index()] = &m_redirectHandler;
 		}
+		RedirectHandlerNode(const RedirectHandlerNode& c);		//snapshot copy; see Snapshot
 		RedirectHandler	m_redirectHandler;
 		std::vector<RedirectHandler *> m_alternates;
 	
@@ -215,8 +235,15 @@ private:
 		struct json_object * toJson();			//WARNING: memory allocated; caller must clean
 		static MimeSystem::RedirectHandlerNode * fromJsonString(const std::string& jsonString);
 		static MimeSystem::RedirectHandlerNode * fromJson(struct json_object * jobj);
+		void encode(MimeTableStore::Encoder& enc);
+		static MimeSystem::RedirectHandlerNode * decode(MimeTableStore::Decoder& dec);
 		
 		int fixupVerbCacheTable(struct json_object * jsonHandlerNodeEntry);
+		
+		volatile gint m_snapshotRefs;
+		bool m_snapshotCopy;
+	private:
+		RedirectHandlerNode& operator=(const RedirectHandlerNode& c);
 	};
 
 	class ResourceHandlerNode {
@@ -224,9 +251,10 @@ private:
 		ResourceHandlerNode(const std::string& ext, 
 						const std::string& contentType, 
 						const std::string& appId, 
-						bool stream=false ) : m_resourceHandler(ext,contentType,appId,stream) {
+						bool stream=false ) : m_resourceHandler(ext,contentType,appId,stream) , m_snapshotRefs(1) , m_snapshotCopy(false) {
 			m_handlersByIndex[m_resourceHandler.index()] = &m_resourceHandler;
 		}
+		ResourceHandlerNode(const ResourceHandlerNode& c);		//snapshot copy; see Snapshot
 		
 		ResourceHandler		m_resourceHandler;
 		std::vector<ResourceHandler *> m_alternates;
@@ -273,10 +301,95 @@ private:
 		struct json_object * toJson();			//WARNING: memory allocated; caller must clean
 		static MimeSystem::ResourceHandlerNode * fromJsonString(const std::string& jsonString);
 		static MimeSystem::ResourceHandlerNode * fromJson(struct json_object * jobj);
+		void encode(MimeTableStore::Encoder& enc);
+		static MimeSystem::ResourceHandlerNode * decode(MimeTableStore::Decoder& dec);
 		
 		int fixupVerbCacheTable(struct json_object * jsonHandlerNodeEntry);
+		
+		volatile gint m_snapshotRefs;
+		bool m_snapshotCopy;
+	private:
+		ResourceHandlerNode& operator=(const ResourceHandlerNode& c);
+	};
+	
+	/*
+	 * An immutable copy of the handler tables that every lookup runs against, so lookups never wait on m_mutex
+	 * (and so never wait on a writer or on saveMimeTable()).
+	 *
+	 * Writers change the live tables under m_mutex through a TableWriter, which marks what it touched. When the
+	 * outermost TableWriter goes away a new snapshot is published: nodes that weren't touched are shared with the
+	 * previous snapshot, touched ones are copied from the live tables. Readers hold a SnapshotRef for the duration
+	 * of the lookup; a snapshot (and a shared node) is freed when the last reference to it goes away.
+	 *
+	 * Taking a reference doesn't lock anything: the reader announces itself in m_snapshotReaders for the current
+	 * m_snapshotEpoch, loads m_snapshot and bumps its count. publishSnapshot() swaps the pointer, flips the epoch
+	 * and waits for the readers of the old epoch to drain before it drops its own reference to the old snapshot,
+	 * so a snapshot can't be freed between a reader loading the pointer and counting its reference.
+	 */
+	class RedirectIndex {
+	public:
+		RedirectIndex() : m_refCount(1) {}
+		RedirectMatcher m_matcher;		//cookies are the snapshot's RedirectHandlerNode pointers
+		volatile gint m_refCount;
+	};
+	
+	class Snapshot {
+	public:
+		Snapshot() : m_redirectIndex(0) , m_generation(0) , m_refCount(1) {}
+		~Snapshot();
+		
+		RedirectHandlerNode *	matchRedirectNode(const std::string& url,bool schemeForms,bool urlForms);
+		int						matchAllRedirectNodes(const std::string& url,std::vector<RedirectHandlerNode *>& r_nodes);
+		
+		std::map<std::string,MimeSystem::ResourceHandlerNode *> m_resourceHandlerMap;
+		std::map<std::string,MimeSystem::RedirectHandlerNode *> m_redirectHandlerMap;
+		std::map<std::string,std::string>						m_extensionToMimeMap;
+		RedirectIndex *			m_redirectIndex;
+		uint32_t				m_generation;
+		volatile gint			m_refCount;
+	private:
+		Snapshot(const Snapshot& c);
+		Snapshot& operator=(const Snapshot& c);
+	};
+	
+	class SnapshotRef {
+	public:
+		SnapshotRef(MimeSystem * mimeSystem) : m_snapshot(mimeSystem->acquireSnapshot()) {}
+		~SnapshotRef() { MimeSystem::releaseSnapshot(m_snapshot); }
+		Snapshot * operator->() const { return m_snapshot; }
+	private:
+		Snapshot * m_snapshot;
+		SnapshotRef(const SnapshotRef& c);
+		SnapshotRef& operator=(const SnapshotRef& c);
 	};
 	
+	class TableWriter {
+	public:
+		TableWriter(MimeSystem * mimeSystem) : m_locker(&mimeSystem->m_mutex) , m_mimeSystem(mimeSystem) { ++m_mimeSystem->m_writeDepth; }
+		~TableWriter() {
+			if (--m_mimeSystem->m_writeDepth == 0)
+				m_mimeSystem->publishSnapshot();
+		}
+	private:
+		MutexLocker m_locker;
+		MimeSystem * m_mimeSystem;
+		TableWriter(const TableWriter& c);
+		TableWriter& operator=(const TableWriter& c);
+	};
+	
+	Snapshot *			acquireSnapshot();
+	static void			releaseSnapshot(Snapshot * snapshot);
+	void				publishSnapshot();
+	void				markResourceDirty(const std::string& mimeType) { m_dirtyResources.insert(mimeType); m_unsavedResources.insert(mimeType); }
+	void				markRedirectDirty(const std::string& url) { m_dirtyRedirects.insert(url); m_unsavedRedirects.insert(url); }
+	void				markAllDirty() { m_allDirty = true; m_unsavedAll = true; }
+	const ListResponseCache * currentTablesResponse();
+	
+	MimeTableStore *	activeStore();
+	void				tableRecords(std::vector<MimeTableStore::Record>& r_records);
+	void				unsavedRecords(std::vector<MimeTableStore::Record>& r_records);
+	bool				writeActiveFile(bool sync,std::string& r_err);
+	
 	static void reclaimIndex(uint32_t idx);
 	
 	static int addVerbs(const std::map<std::string,std::string>& verbs,ResourceHandlerNode& resourceHandlerNode,ResourceHandler& newHandler);
@@ -297,20 +410,35 @@ public:
 	
 private:
 
-	ResourceHandlerNode *	getResourceHandlerNode(const std::string& mimeType);
-	RedirectHandlerNode *	getRedirectHandlerNode(const std::string& url);
-	RedirectHandlerNode *	getSchemeHandlerNode(const std::string& url);
 	
 /// ------------------------------------------- vars -------------------------------------------------------------------
 	
 	static MimeSystem * s_p_inst;
 	
 	static Mutex 	s_mutex;
-	Mutex 			m_mutex;
+	Mutex 			m_mutex;			//writers; lookups go through m_snapshot instead
 	
 	std::map<std::string,MimeSystem::ResourceHandlerNode *> m_resourceHandlerMap;
 	std::map<std::string,MimeSystem::RedirectHandlerNode *> m_redirectHandlerMap;
 	
+	Snapshot * volatile		m_snapshot;				//readers load it with g_atomic_pointer_get
+	volatile gint			m_snapshotEpoch;
+	volatile gint			m_snapshotReaders[2];	//readers taking a reference, per epoch; see acquireSnapshot()
+	int						m_writeDepth;
+	std::set<std::string>	m_dirtyResources;
+	std::set<std::string>	m_dirtyRedirects;
+	bool					m_allDirty;
+	
+	MimeTableStore *		m_store;				//lazily, see activeStore()
+	
+	Mutex					m_responseMutex;
+	ListResponseCache *		m_tablesResponse;
+	std::set<std::string>	m_unsavedResources;		//changed since the last saveMimeTableToActiveFile()
+	std::set<std::string>	m_unsavedRedirects;
+	bool					m_unsavedAll;
+	guint					m_saveSource;			//scheduleSaveToActiveFile()
+	static gboolean			cbSaveToActiveFile(gpointer data);
+	
 	std::map<std::string,std::string>						m_extensionToMimeMap;
 	static uint32_t 	s_genIndex;
 	static uint32_t		s_lastAssignedIndex;
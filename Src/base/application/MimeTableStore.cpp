@@ -0,0 +1,480 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "MimeTableStore.h"
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <glib.h>
+
+/*
+ * file:	magic (8 bytes) | generation (u32) | record frames...
+ * frame:	body length (u32) | checksum of the body (u32) | body
+ * body:	type (u32) | key (string) | value (string)
+ *
+ * A log is only replayed over the snapshot whose generation it carries; compact() bumps the generation,
+ * so a log left behind by a crash in the middle of compact() is recognized as stale.
+ */
+
+static const char* const kSnapshotMagic = "MIMETBL1";
+static const char* const kLogMagic = "MIMELOG1";
+static const size_t kMagicSize = 8;
+static const size_t kHeaderSize = kMagicSize + 4;
+static const size_t kFrameHeaderSize = 8;
+
+// a log smaller than this is never worth a rewrite of the snapshot
+static const off_t kMinCompactLogSize = 64 * 1024;
+
+static inline void storeUInt32(char* p, uint32_t v)
+{
+	p[0] = (char) (v & 0xff);
+	p[1] = (char) ((v >> 8) & 0xff);
+	p[2] = (char) ((v >> 16) & 0xff);
+	p[3] = (char) ((v >> 24) & 0xff);
+}
+
+static inline uint32_t loadUInt32(const char* p)
+{
+	const unsigned char* u = (const unsigned char*) p;
+	return ((uint32_t) u[0]) | ((uint32_t) u[1] << 8) | ((uint32_t) u[2] << 16) | ((uint32_t) u[3] << 24);
+}
+
+// FNV-1a; only has to catch a torn or garbled frame, not an adversary
+static uint32_t checksum(const char* data, size_t size)
+{
+	uint32_t h = 2166136261U;
+	for (size_t i = 0; i < size; i++) {
+		h ^= (unsigned char) data[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static std::string fileHeader(const char* magic, uint32_t generation)
+{
+	std::string header(magic, kMagicSize);
+	char gen[4];
+	storeUInt32(gen, generation);
+	header.append(gen, 4);
+	return header;
+}
+
+static bool writeAll(int fd, const std::string& data)
+{
+	const char* p = data.data();
+	size_t left = data.size();
+	while (left > 0) {
+		ssize_t wr = ::write(fd, p, left);
+		if (wr < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		p += wr;
+		left -= wr;
+	}
+	return true;
+}
+
+// the generation in the header of the file, if it's a file of that kind
+static bool readGeneration(const std::string& path, const char* magic, uint32_t& r_generation)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	char header[kHeaderSize];
+	bool valid = (::read(fd, header, kHeaderSize) == (ssize_t) kHeaderSize) && (memcmp(header, magic, kMagicSize) == 0);
+	::close(fd);
+
+	if (valid)
+		r_generation = loadUInt32(header + kMagicSize);
+	return valid;
+}
+
+// -------------------------------------------------------------------------
+
+void MimeTableStore::Encoder::putUInt32(uint32_t v)
+{
+	char buf[4];
+	storeUInt32(buf, v);
+	m_out.append(buf, 4);
+}
+
+void MimeTableStore::Encoder::putString(const std::string& s)
+{
+	putUInt32(s.size());
+	m_out.append(s);
+}
+
+bool MimeTableStore::Decoder::getUInt32(uint32_t& r_v)
+{
+	if (m_end - m_pos < 4) {
+		m_pos = m_end;
+		return false;
+	}
+	r_v = loadUInt32(m_pos);
+	m_pos += 4;
+	return true;
+}
+
+bool MimeTableStore::Decoder::getBool(bool& r_v)
+{
+	uint32_t v;
+	if (!getUInt32(v))
+		return false;
+	r_v = (v != 0);
+	return true;
+}
+
+bool MimeTableStore::Decoder::getString(std::string& r_s)
+{
+	uint32_t size;
+	if (!getUInt32(size))
+		return false;
+	if ((size_t) (m_end - m_pos) < size) {
+		m_pos = m_end;
+		return false;
+	}
+	r_s.assign(m_pos, size);
+	m_pos += size;
+	return true;
+}
+
+// -------------------------------------------------------------------------
+
+MimeTableStore::MimeTableStore(const std::string& snapshotPath, const std::string& logPath)
+	: m_snapshotPath(snapshotPath)
+	, m_logPath(logPath)
+	, m_generation(0)
+	, m_snapshotSize(0)
+	, m_logSize(0)
+	, m_appends(0)
+	, m_compactions(0)
+	, m_syncs(0)
+	, m_logUnsynced(false)
+{
+	// so that even a compact() without a load() first moves past whatever log is lying around
+	readGeneration(m_snapshotPath, kSnapshotMagic, m_generation);
+}
+
+MimeTableStore::~MimeTableStore()
+{
+}
+
+//static
+void MimeTableStore::encodeRecord(const Record& record, std::string& r_out)
+{
+	std::string body;
+	Encoder enc(body);
+	enc.putUInt32(record.type);
+	enc.putString(record.key);
+	enc.putString(record.value);
+
+	char frame[kFrameHeaderSize];
+	storeUInt32(frame, body.size());
+	storeUInt32(frame + 4, checksum(body.data(), body.size()));
+	r_out.append(frame, kFrameHeaderSize);
+	r_out.append(body);
+}
+
+//static
+bool MimeTableStore::readFile(const std::string& path, const char* magic, std::vector<Record>& r_records,
+							  uint32_t& r_generation, off_t& r_validSize, off_t& r_fileSize)
+{
+	r_validSize = 0;
+	r_fileSize = 0;
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	r_fileSize = st.st_size;
+	if (st.st_size < (off_t) kHeaderSize) {
+		::close(fd);
+		return false;
+	}
+
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	const char* data = (const char*) map;
+	if (memcmp(data, magic, kMagicSize) != 0) {
+		munmap(map, st.st_size);
+		return false;
+	}
+	r_generation = loadUInt32(data + kMagicSize);
+
+	// stop at the first frame that is cut short or doesn't check out; everything before it is good
+	size_t pos = kHeaderSize;
+	size_t size = st.st_size;
+	while (size - pos >= kFrameHeaderSize) {
+		uint32_t bodySize = loadUInt32(data + pos);
+		uint32_t bodySum = loadUInt32(data + pos + 4);
+		if (size - pos - kFrameHeaderSize < bodySize)
+			break;
+
+		const char* body = data + pos + kFrameHeaderSize;
+		if (checksum(body, bodySize) != bodySum)
+			break;
+
+		Record record;
+		Decoder dec(body, bodySize);
+		if (!dec.getUInt32(record.type) || !dec.getString(record.key) || !dec.getString(record.value))
+			break;
+		r_records.push_back(record);
+
+		pos += kFrameHeaderSize + bodySize;
+	}
+	r_validSize = pos;
+
+	munmap(map, st.st_size);
+	return true;
+}
+
+bool MimeTableStore::load(std::vector<Record>& r_records, std::string& r_err)
+{
+	r_err.clear();
+
+	std::vector<Record> records;
+	uint32_t generation = 0;
+	off_t validSize, fileSize;
+
+	if (!readFile(m_snapshotPath, kSnapshotMagic, records, generation, validSize, fileSize)) {
+		r_err = "No saved tables found in " + m_snapshotPath;
+		return false;
+	}
+	if (validSize != fileSize) {
+		// the snapshot is written to the side and renamed into place, so it can't be torn; it's damaged
+		r_err = "Saved tables in " + m_snapshotPath + " are damaged";
+		return false;
+	}
+	m_generation = generation;
+	m_snapshotSize = fileSize;
+
+	std::vector<Record> logRecords;
+	uint32_t logGeneration = 0;
+	m_logSize = 0;
+	if (readFile(m_logPath, kLogMagic, logRecords, logGeneration, validSize, fileSize) && logGeneration == m_generation) {
+		if (validSize != fileSize) {
+			g_warning("%s: dropping %d bytes of incomplete records at the end of %s", __FUNCTION__,
+					  (int) (fileSize - validSize), m_logPath.c_str());
+			if (truncate(m_logPath.c_str(), validSize) != 0)
+				validSize = fileSize;
+		}
+		m_logSize = validSize;
+		records.insert(records.end(), logRecords.begin(), logRecords.end());
+	}
+	else if (fileSize > 0) {
+		// left over from before the snapshot was last rewritten, or not a log at all
+		::unlink(m_logPath.c_str());
+	}
+
+	// the last record for a key wins; the category keeps extensions, resources and redirects apart
+	std::map<std::pair<int, std::string>, size_t> latest;
+	for (size_t i = 0; i < records.size(); i++) {
+		int category;
+		switch (records[i].type) {
+		case RecordExtension:
+			category = 0;
+			break;
+		case RecordResource:
+		case RecordRemoveResource:
+			category = 1;
+			break;
+		case RecordRedirect:
+		case RecordRemoveRedirect:
+			category = 2;
+			break;
+		default:
+			continue;
+		}
+
+		std::pair<int, std::string> key(category, records[i].key);
+		if (records[i].type == RecordRemoveResource || records[i].type == RecordRemoveRedirect)
+			latest.erase(key);
+		else
+			latest[key] = i;
+	}
+
+	r_records.clear();
+	r_records.reserve(latest.size());
+	for (std::map<std::pair<int, std::string>, size_t>::iterator it = latest.begin(); it != latest.end(); ++it)
+		r_records.push_back(records[it->second]);
+
+	return true;
+}
+
+bool MimeTableStore::append(const std::vector<Record>& records, bool sync, std::string& r_err)
+{
+	r_err.clear();
+	if (records.empty())
+		return true;
+
+	std::string data;
+	for (std::vector<Record>::const_iterator it = records.begin(); it != records.end(); ++it)
+		encodeRecord(*it, data);
+
+	int fd = ::open(m_logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0) {
+		r_err = "Unable to open file " + m_logPath;
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		r_err = "Unable to open file " + m_logPath;
+		return false;
+	}
+	if (st.st_size == 0)
+		data.insert(0, fileHeader(kLogMagic, m_generation));
+
+	bool success = writeAll(fd, data) && (!sync || fdatasync(fd) == 0);
+	if (!success) {
+		// don't leave half a frame behind for the next append to land after
+		if (ftruncate(fd, st.st_size) != 0)
+			g_warning("%s: couldn't roll back a partial append to %s", __FUNCTION__, m_logPath.c_str());
+	}
+	::close(fd);
+
+	if (!success) {
+		r_err = "Couldn't write maps to file " + m_logPath;
+		return false;
+	}
+
+	m_logSize = st.st_size + data.size();
+	m_appends++;
+	if (sync)
+		m_syncs++;
+	m_logUnsynced = !sync;
+	return true;
+}
+
+bool MimeTableStore::sync(std::string& r_err)
+{
+	r_err.clear();
+	if (!m_logUnsynced)
+		return true;
+
+	int fd = ::open(m_logPath.c_str(), O_WRONLY);
+	if (fd < 0) {
+		r_err = "Unable to open file " + m_logPath;
+		return false;
+	}
+
+	bool success = (fdatasync(fd) == 0);
+	::close(fd);
+
+	if (!success) {
+		r_err = "Couldn't sync file " + m_logPath;
+		return false;
+	}
+
+	m_syncs++;
+	m_logUnsynced = false;
+	return true;
+}
+
+bool MimeTableStore::compact(const std::vector<Record>& records, std::string& r_err)
+{
+	r_err.clear();
+
+	std::string data = fileHeader(kSnapshotMagic, m_generation + 1);
+	for (std::vector<Record>::const_iterator it = records.begin(); it != records.end(); ++it)
+		encodeRecord(*it, data);
+
+	// write to the side and rename over, so a crash mid-write never leaves a truncated snapshot
+	std::string tmpPath = m_snapshotPath + ".tmp";
+	bool success = false;
+
+	int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		success = writeAll(fd, data);
+		success = (fdatasync(fd) == 0) && success;
+		::close(fd);
+
+		if (success)
+			success = (::rename(tmpPath.c_str(), m_snapshotPath.c_str()) == 0);
+		if (!success)
+			::unlink(tmpPath.c_str());
+	}
+
+	// the rename is only durable once the folder is synced, and the old snapshot needs its log until then
+	if (success) {
+		std::string::size_type slash = m_snapshotPath.rfind('/');
+		std::string folder = (slash == std::string::npos) ? "." : (slash ? m_snapshotPath.substr(0, slash) : "/");
+		int dirFd = ::open(folder.c_str(), O_RDONLY | O_DIRECTORY);
+		if (dirFd < 0 || fsync(dirFd) != 0)
+			g_warning("%s: couldn't sync %s after renaming %s into it", __FUNCTION__, folder.c_str(), m_snapshotPath.c_str());
+		if (dirFd >= 0)
+			::close(dirFd);
+	}
+
+	if (!success) {
+		r_err = "Couldn't write maps to file " + m_snapshotPath;
+		return false;
+	}
+
+	// the old log carries the old generation, so it's already dead; this just reclaims the space
+	m_generation++;
+	::unlink(m_logPath.c_str());
+
+	m_snapshotSize = data.size();
+	m_logSize = 0;
+	m_logUnsynced = false;
+	m_compactions++;
+	m_syncs++;
+	return true;
+}
+
+bool MimeTableStore::hasSnapshot() const
+{
+	return (access(m_snapshotPath.c_str(), F_OK) == 0);
+}
+
+bool MimeTableStore::shouldCompact() const
+{
+	return (m_logSize > kMinCompactLogSize) && (m_logSize > m_snapshotSize);
+}
+
+void MimeTableStore::remove()
+{
+	::unlink(m_snapshotPath.c_str());
+	::unlink(m_logPath.c_str());
+	m_snapshotSize = 0;
+	m_logSize = 0;
+}
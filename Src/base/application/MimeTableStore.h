@@ -0,0 +1,152 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef MIMETABLESTORE_H
+#define MIMETABLESTORE_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * The on-disk form of the active MimeSystem tables: a binary snapshot of every entry plus an append-only
+ * log of the entries that changed since that snapshot was written.
+ *
+ * A record is one table entry keyed the way MimeSystem keys it: an extension -> mime type mapping, a whole
+ * resource or redirect handler node (encoded by the node itself), or the removal of a node. Every record is
+ * framed with its length and a checksum, so a log whose last append was cut short loads up to the last
+ * complete record and the torn tail is cut off before anything is appended after it.
+ *
+ * compact() writes a new snapshot to a temp file, renames it over the old one (syncing the folder, so the
+ * rename itself is on disk) and only then drops the log.
+ * A crash at any point leaves either the old snapshot with its log, or the new snapshot next to a log that
+ * belongs to the old one and is ignored. Snapshot and log are mapped and decoded in place on load; there is
+ * no json on this path.
+ *
+ * Not thread safe; MimeSystem only touches it with its table mutex held.
+ */
+class MimeTableStore
+{
+public:
+
+	enum RecordType {
+		RecordExtension = 1,		// key: extension, value: mime type
+		RecordResource,				// key: mime type, value: encoded ResourceHandlerNode
+		RecordRedirect,				// key: url regexp, value: encoded RedirectHandlerNode
+		RecordRemoveResource,		// key: mime type
+		RecordRemoveRedirect		// key: url regexp
+	};
+
+	struct Record {
+		Record() : type(0) {}
+		Record(uint32_t t, const std::string& k, const std::string& v) : type(t), key(k), value(v) {}
+
+		uint32_t type;
+		std::string key;
+		std::string value;
+	};
+
+	// fixed width little endian integers and length prefixed strings, appended to a buffer
+	class Encoder
+	{
+	public:
+		Encoder(std::string& out) : m_out(out) {}
+
+		void putUInt32(uint32_t v);
+		void putBool(bool v) { putUInt32(v ? 1 : 0); }
+		void putString(const std::string& s);
+
+	private:
+		std::string& m_out;
+	};
+
+	// reads what an Encoder wrote; every get fails (and keeps failing) once the data runs out
+	class Decoder
+	{
+	public:
+		Decoder(const char* data, size_t size) : m_pos(data), m_end(data + size) {}
+
+		bool getUInt32(uint32_t& r_v);
+		bool getBool(bool& r_v);
+		bool getString(std::string& r_s);
+		bool atEnd() const { return m_pos == m_end; }
+
+	private:
+		const char* m_pos;
+		const char* m_end;
+	};
+
+	MimeTableStore(const std::string& snapshotPath, const std::string& logPath);
+	~MimeTableStore();
+
+	// the tables as of the last append: the snapshot's records with the log replayed over them and removals
+	// applied; extensions first, then resources, then redirects. false if there is no (readable) snapshot
+	bool load(std::vector<Record>& r_records, std::string& r_err);
+
+	// adds the records to the log with a single write. Without sync they are in the file (and outlive the
+	// process) but not necessarily on the disk until the next sync(), synced append() or compact()
+	bool append(const std::vector<Record>& records, bool sync, std::string& r_err);
+
+	// puts appends made without sync on the disk; true right away if there are none
+	bool sync(std::string& r_err);
+
+	// replaces the snapshot with the records (the complete tables) and empties the log
+	bool compact(const std::vector<Record>& records, std::string& r_err);
+
+	bool hasSnapshot() const;
+
+	// the log has outgrown the snapshot it amends; time for compact()
+	bool shouldCompact() const;
+
+	void remove();
+
+	const std::string& snapshotPath() const { return m_snapshotPath; }
+	const std::string& logPath() const { return m_logPath; }
+
+	unsigned int appends() const { return m_appends; }
+	unsigned int compactions() const { return m_compactions; }
+	// fdatasync()s of the log and the snapshot so far
+	unsigned int syncs() const { return m_syncs; }
+
+private:
+
+	static void encodeRecord(const Record& record, std::string& r_out);
+	static bool readFile(const std::string& path, const char* magic, std::vector<Record>& r_records,
+						 uint32_t& r_generation, off_t& r_validSize, off_t& r_fileSize);
+
+	std::string m_snapshotPath;
+	std::string m_logPath;
+	uint32_t m_generation;		// of the snapshot on disk; a log is only valid for the generation it names
+	off_t m_snapshotSize;
+	off_t m_logSize;
+	unsigned int m_appends;
+	unsigned int m_compactions;
+	unsigned int m_syncs;
+	bool m_logUnsynced;		// appended to without a sync since the last one
+
+	MimeTableStore(const MimeTableStore&);
+	MimeTableStore& operator=(const MimeTableStore&);
+};
+
+#endif /* MIMETABLESTORE_H */
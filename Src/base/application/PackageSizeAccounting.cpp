@@ -0,0 +1,473 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "PackageSizeAccounting.h"
+#include "MutexLocker.h"
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cjson/json.h>
+#include <cjson/json_util.h>
+
+static const unsigned int s_maxWorkerThreads = 4;
+
+// sizes and mtimes are stored as decimal strings: cjson ints are only 32 bits
+static json_object* newNumberString(unsigned long long value)
+{
+	gchar* str = g_strdup_printf("%llu", value);
+	json_object* obj = json_object_new_string(str);
+	g_free(str);
+	return obj;
+}
+
+static bool getNumberString(json_object* obj, const char* key, unsigned long long& r_value)
+{
+	json_object* label = json_object_object_get(obj, key);
+	if (!label || is_error(label) || !json_object_is_type(label, json_type_string))
+		return false;
+	r_value = strtoull(json_object_get_string(label), NULL, 10);
+	return true;
+}
+
+static bool getStringValue(json_object* obj, const char* key, std::string& r_value)
+{
+	json_object* label = json_object_object_get(obj, key);
+	if (!label || is_error(label) || !json_object_is_type(label, json_type_string))
+		return false;
+	r_value = json_object_get_string(label);
+	return true;
+}
+
+static json_object* getArray(json_object* obj, const char* key)
+{
+	json_object* label = json_object_object_get(obj, key);
+	if (!label || is_error(label) || !json_object_is_type(label, json_type_array))
+		return 0;
+	return label;
+}
+
+// in nanoseconds; a change in the same second as the walk still shows
+static uint64_t mtimeOf(const struct stat& st)
+{
+	return (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+}
+
+static uint64_t folderMtime(const std::string& path)
+{
+	struct stat st;
+	if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+		return 0;
+	return mtimeOf(st);
+}
+
+// takes over fd
+static void walkFolder(int fd, const std::string& path, uint64_t blockSize, PackageSizeAccounting::Walk& r_walk)
+{
+	DIR* dir = ::fdopendir(fd);
+	if (!dir) {
+		::close(fd);
+		return;
+	}
+
+	struct dirent* ent;
+	while ((ent = ::readdir(dir)) != 0) {
+
+		const char* name = ent->d_name;
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+			continue;
+
+		// symlinks are counted as themselves, never followed
+		struct stat st;
+		if (::fstatat(::dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+			continue;
+
+		std::string entryPath = path + "/" + name;
+		uint64_t blocks;
+
+		if (S_ISDIR(st.st_mode))
+			blocks = 1;
+		else
+			blocks = ((uint64_t)st.st_size + blockSize - 1) / blockSize;
+
+		r_walk.realBytes += st.st_size;
+		r_walk.allocatedBytes += (uint64_t)st.st_blocks * 512;
+		r_walk.blocks += blocks;
+		if (r_walk.listFiles)
+			r_walk.files.push_back(PackageSizeAccounting::File(entryPath, st.st_size, blocks));
+
+		if (S_ISDIR(st.st_mode)) {
+			r_walk.folders.push_back(std::make_pair(entryPath, mtimeOf(st)));
+
+			int childFd = ::openat(::dirfd(dir), name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+			if (childFd >= 0)
+				walkFolder(childFd, entryPath, blockSize, r_walk);
+		}
+	}
+
+	::closedir(dir);
+}
+
+PackageSizeAccounting::PackageSizeAccounting(const std::string& manifestDir, const std::string& installerVersion)
+	: m_manifestDir(manifestDir)
+	, m_installerVersion(installerVersion)
+	, m_workerThreads(0)
+	, m_cacheHits(0)
+	, m_manifestHits(0)
+	, m_walks(0)
+{
+	long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+	m_workerThreads = (cpus > 0) ? (unsigned int)cpus : 1;
+	if (m_workerThreads > s_maxWorkerThreads)
+		m_workerThreads = s_maxWorkerThreads;
+}
+
+PackageSizeAccounting::~PackageSizeAccounting()
+{
+}
+
+bool PackageSizeAccounting::walk(const std::string& dirPath, uint64_t blockSize, Walk& r_walk)
+{
+	if (blockSize == 0 || dirPath.empty())
+		return false;
+
+	int fd = ::open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	std::string path = dirPath;
+	while (path.size() > 1 && path[path.size() - 1] == '/')
+		path.erase(path.size() - 1);
+
+	// the top folder is only there for its mtime
+	r_walk.folders.push_back(std::make_pair(path, mtimeOf(st)));
+	walkFolder(fd, path, blockSize, r_walk);
+	return true;
+}
+
+std::string PackageSizeAccounting::manifestPath(const std::string& packageId) const
+{
+	return m_manifestDir + "/" + packageId + ".pmmanifest";
+}
+
+void PackageSizeAccounting::workerFunc(gpointer data, gpointer userData)
+{
+	Job* job = static_cast<Job*>(data);
+	job->found = PackageSizeAccounting::walk(job->path, job->blockSize, job->walk);
+}
+
+void PackageSizeAccounting::measure(std::vector<Package>& packages, bool reuse)
+{
+	MutexLocker locker(&m_mutex);
+
+	// jobs are queued package by package, so each package's jobs are next to each other
+	std::vector<Job*> jobs;
+
+	// the first package with each id, and the later ones that only copy it
+	std::map<std::string, unsigned int> firstById;
+	std::vector<std::pair<unsigned int, unsigned int> > copies;
+
+	for (unsigned int i = 0; i < packages.size(); i++) {
+
+		Package& package = packages[i];
+		package.size = 0;
+		package.fromCache = false;
+
+		if (package.id.empty() || package.blockSize == 0)
+			continue;
+
+		std::pair<std::map<std::string, unsigned int>::iterator, bool> first =
+			firstById.insert(std::make_pair(package.id, i));
+		if (!first.second) {
+			copies.push_back(std::make_pair(i, first.first->second));
+			continue;
+		}
+
+		if (reuse) {
+			EntryMap::const_iterator it = m_entries.find(package.id);
+			if (it != m_entries.end() && isCurrent(it->second, package)) {
+				package.size = it->second.size;
+				package.fromCache = true;
+				m_cacheHits++;
+				continue;
+			}
+
+			Entry entry;
+			if (loadManifest(package, entry) && isCurrent(entry, package)) {
+				package.size = entry.size;
+				package.fromCache = true;
+				m_entries[package.id] = entry;
+				m_manifestHits++;
+				continue;
+			}
+		}
+
+		for (std::vector<std::string>::const_iterator it = package.folders.begin(); it != package.folders.end(); ++it)
+			jobs.push_back(new Job(i, *it, package.blockSize));
+	}
+
+	if (!jobs.empty())
+		walkJobs(packages, jobs);
+
+	for (unsigned int i = 0; i < copies.size(); i++) {
+		packages[copies[i].first].size = packages[copies[i].second].size;
+		packages[copies[i].first].fromCache = packages[copies[i].second].fromCache;
+	}
+}
+
+// (CALL UNDER m_mutex) walks the jobs and files the results under their packages
+void PackageSizeAccounting::walkJobs(std::vector<Package>& packages, std::vector<Job*>& jobs)
+{
+	GThreadPool* pool = 0;
+	if (jobs.size() > 1 && m_workerThreads > 1)
+		pool = g_thread_pool_new(workerFunc, this, m_workerThreads, FALSE, NULL);
+
+	if (pool) {
+		for (unsigned int i = 0; i < jobs.size(); i++)
+			g_thread_pool_push(pool, jobs[i], NULL);
+
+		// waits for the queue to drain
+		g_thread_pool_free(pool, FALSE, TRUE);
+	}
+	else {
+		for (unsigned int i = 0; i < jobs.size(); i++)
+			workerFunc(jobs[i], this);
+	}
+
+	unsigned int first = 0;
+	while (first < jobs.size()) {
+
+		unsigned int end = first + 1;
+		while (end < jobs.size() && jobs[end]->package == jobs[first]->package)
+			end++;
+
+		Package& package = packages[jobs[first]->package];
+		std::vector<Job*> packageJobs(jobs.begin() + first, jobs.begin() + end);
+
+		Entry entry;
+		entry.version = package.version;
+		entry.blockSize = package.blockSize;
+		entry.roots = package.folders;
+
+		uint64_t blocks = 0;
+		for (unsigned int i = 0; i < packageJobs.size(); i++) {
+			const Job* job = packageJobs[i];
+			blocks += job->walk.blocks;
+
+			// a folder that isn't there yet invalidates the entry once it shows up
+			if (job->found)
+				entry.folders.insert(entry.folders.end(), job->walk.folders.begin(), job->walk.folders.end());
+			else
+				entry.folders.push_back(std::make_pair(job->path, (uint64_t)0));
+		}
+
+		entry.size = blocks * package.blockSize;
+		package.size = entry.size;
+		m_entries[package.id] = entry;
+		m_walks++;
+
+		if (!m_manifestDir.empty())
+			writeManifest(package, packageJobs, blocks);
+
+		first = end;
+	}
+
+	for (unsigned int i = 0; i < jobs.size(); i++)
+		delete jobs[i];
+}
+
+void PackageSizeAccounting::forget(const std::string& packageId)
+{
+	MutexLocker locker(&m_mutex);
+
+	m_entries.erase(packageId);
+	if (!m_manifestDir.empty() && !packageId.empty())
+		::unlink(manifestPath(packageId).c_str());
+}
+
+bool PackageSizeAccounting::isCurrent(const Entry& entry, const Package& package) const
+{
+	if (entry.version != package.version || entry.blockSize != package.blockSize || entry.roots != package.folders)
+		return false;
+
+	// adding, removing or renaming anything bumps the mtime of the directory it is in. A file changed in
+	// place doesn't, see the class comment
+	for (std::vector<std::pair<std::string, uint64_t> >::const_iterator it = entry.folders.begin();
+		 it != entry.folders.end(); ++it) {
+		if (folderMtime(it->first) != it->second)
+			return false;
+	}
+
+	return true;
+}
+
+bool PackageSizeAccounting::loadManifest(const Package& package, Entry& r_entry) const
+{
+	if (m_manifestDir.empty())
+		return false;
+
+	json_object* root = json_object_from_file(const_cast<char*>(manifestPath(package.id).c_str()));
+	if (!root || is_error(root))
+		return false;
+
+	bool valid = false;
+	std::string version, installer;
+	unsigned long long size = 0;
+	gchar* bsizeStr = g_strdup_printf("%llu", (unsigned long long) package.blockSize);
+
+	json_object* totals = json_object_object_get(root, "totals");
+	json_object* roots = getArray(root, "roots");
+	json_object* folders = getArray(root, "folders");
+
+	// manifests written before the mtimes were recorded are walked once more
+	if (getStringValue(root, "version", version) && getStringValue(root, "installer", installer) &&
+		installer == m_installerVersion && totals && !is_error(totals) &&
+		getNumberString(totals, bsizeStr, size) && roots && folders) {
+
+		r_entry.version = version;
+		r_entry.blockSize = package.blockSize;
+		r_entry.size = size;
+		valid = true;
+
+		for (int i = 0; valid && i < json_object_array_length(roots); i++) {
+			json_object* item = json_object_array_get_idx(roots, i);
+			if (!item || !json_object_is_type(item, json_type_string))
+				valid = false;
+			else
+				r_entry.roots.push_back(json_object_get_string(item));
+		}
+
+		for (int i = 0; valid && i < json_object_array_length(folders); i++) {
+			json_object* item = json_object_array_get_idx(folders, i);
+			std::string path;
+			unsigned long long mtime = 0;
+			if (!item || !getStringValue(item, "path", path) || !getNumberString(item, "mtime", mtime))
+				valid = false;
+			else
+				r_entry.folders.push_back(std::make_pair(path, (uint64_t) mtime));
+		}
+	}
+
+	g_free(bsizeStr);
+	json_object_put(root);
+	return valid;
+}
+
+bool PackageSizeAccounting::writeManifest(const Package& package, const std::vector<Job*>& jobs, uint64_t blocks) const
+{
+	gchar* bsizeStr = g_strdup_printf("%llu", (unsigned long long) package.blockSize);
+
+	json_object* root = json_object_new_object();
+	json_object* realFiles = json_object_new_array();
+	json_object* blockFiles = json_object_new_array();
+	json_object* roots = json_object_new_array();
+	json_object* folders = json_object_new_array();
+	uint64_t realBytes = 0;
+
+	json_object_object_add(root, "version", json_object_new_string(package.version.c_str()));
+	json_object_object_add(root, "installer", json_object_new_string(m_installerVersion.c_str()));
+
+	for (std::vector<std::string>::const_iterator it = package.folders.begin(); it != package.folders.end(); ++it)
+		json_object_array_add(roots, json_object_new_string(it->c_str()));
+
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+
+		const Job* job = jobs[i];
+		realBytes += job->walk.realBytes;
+
+		for (std::vector<File>::const_iterator it = job->walk.files.begin(); it != job->walk.files.end(); ++it) {
+			json_object* item = json_object_new_object();
+			json_object_object_add(item, "file", json_object_new_string(it->path.c_str()));
+			json_object_object_add(item, "size", newNumberString(it->size));
+			json_object_array_add(realFiles, item);
+
+			item = json_object_new_object();
+			json_object_object_add(item, "file", json_object_new_string(it->path.c_str()));
+			json_object_object_add(item, "size", newNumberString(it->blocks * package.blockSize));
+			json_object_array_add(blockFiles, item);
+		}
+
+		if (!job->found) {
+			json_object* item = json_object_new_object();
+			json_object_object_add(item, "path", json_object_new_string(job->path.c_str()));
+			json_object_object_add(item, "mtime", newNumberString(0));
+			json_object_array_add(folders, item);
+			continue;
+		}
+
+		for (std::vector<std::pair<std::string, uint64_t> >::const_iterator it = job->walk.folders.begin();
+			 it != job->walk.folders.end(); ++it) {
+			json_object* item = json_object_new_object();
+			json_object_object_add(item, "path", json_object_new_string(it->first.c_str()));
+			json_object_object_add(item, "mtime", newNumberString(it->second));
+			json_object_array_add(folders, item);
+		}
+	}
+
+	json_object_object_add(root, "real", realFiles);
+	json_object_object_add(root, bsizeStr, blockFiles);
+
+	json_object* totals = json_object_new_object();
+	json_object_object_add(totals, "real", newNumberString(realBytes));
+	json_object_object_add(totals, bsizeStr, newNumberString(blocks * package.blockSize));
+	json_object_object_add(root, "totals", totals);
+
+	json_object_object_add(root, "roots", roots);
+	json_object_object_add(root, "folders", folders);
+
+	// write to the side and rename over; a manifest lost to a crash is only walked again, so no fsync
+	std::string path = manifestPath(package.id);
+	std::string tmpPath = path + ".tmp";
+	bool success = false;
+
+	FILE* fp = fopen(tmpPath.c_str(), "w");
+	if (fp) {
+		const char* jsonStr = json_object_to_json_string(root);
+		size_t len = strlen(jsonStr);
+		success = (fwrite(jsonStr, 1, len, fp) == len);
+		success = (fclose(fp) == 0) && success;
+
+		if (success)
+			success = (::rename(tmpPath.c_str(), path.c_str()) == 0);
+		if (!success)
+			::unlink(tmpPath.c_str());
+	}
+
+	if (!success)
+		g_warning("%s: failed to write package manifest %s", __FUNCTION__, path.c_str());
+
+	json_object_put(root);
+	g_free(bsizeStr);
+	return success;
+}
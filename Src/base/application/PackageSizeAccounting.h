@@ -0,0 +1,163 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef PACKAGESIZEACCOUNTING_H
+#define PACKAGESIZEACCOUNTING_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <sys/types.h>
+#include <glib.h>
+
+#include "Mutex.h"
+
+struct json_object;
+
+/*
+ * Adds up the installed size of packages the way the installer accounts for it: every file rounded
+ * up to whole blocks of the target filesystem, one block per directory, the top folder not counted.
+ *
+ * walk() is a plain openat()/fstatat() descent that keeps everything it finds in the Walk it is
+ * given, so any number of walks can run at once. measure() sizes a whole batch of packages in one
+ * go, spreading their folders over a small thread pool.
+ *
+ * Each measured package gets a .pmmanifest (the same file the installer always wrote) that now also
+ * records the mtime of every directory that was walked. A package is walked again only when its
+ * version, the installer version or the block size differ, or when one of those directories has been
+ * modified; otherwise its size comes from memory or, after a restart, from the manifest.
+ *
+ * Only directory mtimes are checked, so a file that is rewritten or grown in place (which doesn't touch
+ * the directory it is in) keeps its old size until something else invalidates the package. Installed
+ * packages are only ever replaced whole, by an install with a new version, so that takes a hand edit on
+ * the device; checking every file instead would cost about as much as walking the package again.
+ */
+class PackageSizeAccounting
+{
+public:
+
+	struct File {
+		File(const std::string& path, uint64_t size, uint64_t blocks) : path(path), size(size), blocks(blocks) {}
+
+		std::string path;
+		uint64_t size;
+		uint64_t blocks;
+	};
+
+	// everything below one folder
+	struct Walk {
+		Walk(bool listFiles = false) : realBytes(0), allocatedBytes(0), blocks(0), listFiles(listFiles) {}
+
+		uint64_t realBytes;			// st_size of every entry
+		uint64_t allocatedBytes;	// st_blocks of every entry, in bytes (what du reports)
+		uint64_t blocks;			// in blocks of the size passed to walk()
+		bool listFiles;
+
+		std::vector<File> files;								// only with listFiles
+		std::vector<std::pair<std::string, uint64_t> > folders;	// path and mtime (ns); the top folder and all below it
+	};
+
+	// one package to size
+	struct Package {
+		Package() : blockSize(0), size(0), fromCache(false) {}
+
+		std::string id;
+		std::string version;
+		std::vector<std::string> folders;	// its app, service and package folders
+		uint64_t blockSize;					// of the filesystem it is counted for
+
+		uint64_t size;						// out: in bytes, whole blocks
+		bool fromCache;						// out: not walked
+	};
+
+	PackageSizeAccounting(const std::string& manifestDir, const std::string& installerVersion);
+	~PackageSizeAccounting();
+
+	// adds up dirPath into r_walk; reentrant. false if dirPath couldn't be opened
+	static bool walk(const std::string& dirPath, uint64_t blockSize, Walk& r_walk);
+
+	// sizes every package in the list. with reuse, packages whose size is still current are not walked;
+	// without, all of them are walked and get a new manifest. A package id that comes more than once is
+	// measured once, and every copy gets that result
+	void measure(std::vector<Package>& packages, bool reuse);
+
+	// forget a package, e.g. after it was removed
+	void forget(const std::string& packageId);
+
+	std::string manifestPath(const std::string& packageId) const;
+
+	unsigned int cacheHits() const { return m_cacheHits; }
+	unsigned int manifestHits() const { return m_manifestHits; }
+	unsigned int walks() const { return m_walks; }
+	unsigned int workerThreads() const { return m_workerThreads; }
+
+private:
+
+	struct Entry {
+		Entry() : blockSize(0), size(0) {}
+
+		std::string version;
+		uint64_t blockSize;
+		uint64_t size;
+		std::vector<std::string> roots;							// Package::folders when it was walked
+		std::vector<std::pair<std::string, uint64_t> > folders;	// every directory that was walked
+	};
+
+	// one folder of one package, walked on the pool
+	struct Job {
+		Job(unsigned int package, const std::string& path, uint64_t blockSize)
+			: package(package), path(path), blockSize(blockSize), walk(true), found(false) {}
+
+		unsigned int package;
+		std::string path;
+		uint64_t blockSize;
+		Walk walk;
+		bool found;
+	};
+
+	typedef std::map<std::string, Entry> EntryMap;
+
+	void walkJobs(std::vector<Package>& packages, std::vector<Job*>& jobs);
+	bool isCurrent(const Entry& entry, const Package& package) const;
+	bool loadManifest(const Package& package, Entry& r_entry) const;
+	bool writeManifest(const Package& package, const std::vector<Job*>& jobs, uint64_t blocks) const;
+
+	static void workerFunc(gpointer data, gpointer userData);
+
+	std::string m_manifestDir;
+	std::string m_installerVersion;
+
+	Mutex m_mutex;
+	EntryMap m_entries;		// by package id
+
+	unsigned int m_workerThreads;
+	unsigned int m_cacheHits;
+	unsigned int m_manifestHits;
+	unsigned int m_walks;
+
+	PackageSizeAccounting(const PackageSizeAccounting&);
+	PackageSizeAccounting& operator=(const PackageSizeAccounting&);
+};
+
+#endif /* PACKAGESIZEACCOUNTING_H */
@@ -0,0 +1,330 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "RedirectMatcher.h"
+
+#include <string.h>
+
+static inline char asciiLower(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (c - 'A' + 'a') : c;
+}
+
+static inline bool isSchemeChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+}
+
+// i is on the opening '['; returns the position of the closing ']' (or the end of the string)
+static std::string::size_type skipBracket(const std::string& re, std::string::size_type i)
+{
+	i++;
+	if (i < re.size() && re[i] == '^')
+		i++;
+	if (i < re.size() && re[i] == ']')
+		i++;
+
+	while (i < re.size() && re[i] != ']') {
+		// [:alpha:], [.x.] and [=x=] can contain a ']'
+		if (re[i] == '[' && i + 1 < re.size() && (re[i+1] == ':' || re[i+1] == '.' || re[i+1] == '=')) {
+			char delim = re[i+1];
+			i += 2;
+			while (i + 1 < re.size() && !(re[i] == delim && re[i+1] == ']'))
+				i++;
+			i += 2;
+			continue;
+		}
+		i++;
+	}
+
+	return i;
+}
+
+RedirectMatcher::RedirectMatcher()
+{
+	m_schemes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+RedirectMatcher::~RedirectMatcher()
+{
+	g_hash_table_destroy(m_schemes);
+}
+
+void RedirectMatcher::clear()
+{
+	m_entries.clear();
+	m_patternEntries.clear();
+	m_schemeBuckets.clear();
+	g_hash_table_remove_all(m_schemes);
+}
+
+void RedirectMatcher::add(const RedirectHandler& handler, void* cookie)
+{
+	// a pattern that didn't compile never matches anything
+	if (!handler.reValid())
+		return;
+
+	int idx = m_entries.size();
+	m_entries.push_back(Entry(handler, cookie));
+
+	std::string scheme;
+	if (literalScheme(handler.urlRe(), scheme)) {
+
+		gpointer bucket = g_hash_table_lookup(m_schemes, scheme.c_str());
+		if (!bucket) {
+			m_schemeBuckets.push_back(std::vector<int>());
+			bucket = GINT_TO_POINTER(m_schemeBuckets.size());
+			g_hash_table_insert(m_schemes, g_strdup(scheme.c_str()), bucket);
+		}
+
+		m_schemeBuckets[GPOINTER_TO_INT(bucket) - 1].push_back(idx);
+		return;
+	}
+
+	m_entries[idx].literal = requiredLiteral(handler.urlRe());
+	m_patternEntries.push_back(idx);
+}
+
+const std::vector<int>* RedirectMatcher::schemeBucket(const std::string& lowerUrl) const
+{
+	std::string::size_type colonPos = lowerUrl.find(':');
+	if (colonPos == std::string::npos || colonPos == 0)
+		return 0;
+
+	std::string scheme = lowerUrl.substr(0, colonPos);
+	gpointer bucket = g_hash_table_lookup(m_schemes, scheme.c_str());
+	if (!bucket)
+		return 0;
+
+	return &m_schemeBuckets[GPOINTER_TO_INT(bucket) - 1];
+}
+
+bool RedirectMatcher::entryMatches(const Entry& entry, const std::string& url, const std::string& lowerUrl) const
+{
+	if (!entry.literal.empty() && lowerUrl.find(entry.literal) == std::string::npos)
+		return false;
+
+	return entry.handler.matches(url);
+}
+
+void* RedirectMatcher::matchFirst(const std::string& url, bool schemeForms, bool urlForms) const
+{
+	if (url.empty() || m_entries.empty())
+		return 0;
+
+	std::string lowerUrl(url);
+	for (std::string::size_type i = 0; i < lowerUrl.size(); i++)
+		lowerUrl[i] = asciiLower(lowerUrl[i]);
+
+	// a literal scheme entry matches outright; it only bounds how far the pattern entries need to go
+	int best = m_entries.size();
+	const std::vector<int>* bucket = schemeBucket(lowerUrl);
+	if (bucket) {
+		for (std::vector<int>::const_iterator it = bucket->begin(); it != bucket->end(); ++it) {
+			bool schemeForm = m_entries[*it].handler.isSchemeForm();
+			if ((schemeForm && schemeForms) || (!schemeForm && urlForms)) {
+				best = *it;
+				break;
+			}
+		}
+	}
+
+	for (std::vector<int>::const_iterator it = m_patternEntries.begin(); it != m_patternEntries.end(); ++it) {
+		if (*it >= best)
+			break;
+
+		const Entry& entry = m_entries[*it];
+		bool schemeForm = entry.handler.isSchemeForm();
+		if ((schemeForm && !schemeForms) || (!schemeForm && !urlForms))
+			continue;
+
+		if (entryMatches(entry, url, lowerUrl))
+			return entry.cookie;
+	}
+
+	if (best < (int) m_entries.size())
+		return m_entries[best].cookie;
+
+	return 0;
+}
+
+int RedirectMatcher::matchAll(const std::string& url, std::vector<void*>& r_cookies) const
+{
+	if (url.empty() || m_entries.empty())
+		return 0;
+
+	std::string lowerUrl(url);
+	for (std::string::size_type i = 0; i < lowerUrl.size(); i++)
+		lowerUrl[i] = asciiLower(lowerUrl[i]);
+
+	std::vector<int> matched;
+	for (std::vector<int>::const_iterator it = m_patternEntries.begin(); it != m_patternEntries.end(); ++it) {
+		if (entryMatches(m_entries[*it], url, lowerUrl))
+			matched.push_back(*it);
+	}
+
+	// merge with the scheme entries; both lists are already in priority order
+	static const std::vector<int> s_noBucket;
+	const std::vector<int>* bucket = schemeBucket(lowerUrl);
+	if (!bucket)
+		bucket = &s_noBucket;
+
+	std::vector<int>::const_iterator mit = matched.begin();
+	std::vector<int>::const_iterator bit = bucket->begin();
+	int count = 0;
+
+	while (mit != matched.end() || bit != bucket->end()) {
+		int idx;
+		if (bit == bucket->end() || (mit != matched.end() && *mit < *bit))
+			idx = *mit++;
+		else
+			idx = *bit++;
+
+		r_cookies.push_back(m_entries[idx].cookie);
+		count++;
+	}
+
+	return count;
+}
+
+//static
+bool RedirectMatcher::literalScheme(const std::string& urlRe, std::string& r_scheme)
+{
+	// exactly ^[A-Za-z0-9-]+:
+	if (urlRe.size() < 3 || urlRe[0] != '^' || urlRe[urlRe.size() - 1] != ':')
+		return false;
+
+	std::string scheme;
+	for (std::string::size_type i = 1; i < urlRe.size() - 1; i++) {
+		if (!isSchemeChar(urlRe[i]))
+			return false;
+		scheme += asciiLower(urlRe[i]);
+	}
+
+	r_scheme = scheme;
+	return true;
+}
+
+//static
+std::string RedirectMatcher::requiredLiteral(const std::string& urlRe)
+{
+	// Only literal runs outside of any group count, and anything unexpected just ends the current run:
+	// a shorter literal (or none) only costs a regexec, a wrong one would lose matches.
+
+	std::string best;
+	std::string run;
+	int depth = 0;
+
+	for (std::string::size_type i = 0; i < urlRe.size(); i++) {
+
+		char c = urlRe[i];
+
+		if (depth > 0) {
+			if (c == '\\')
+				i++;
+			else if (c == '[')
+				i = skipBracket(urlRe, i);
+			else if (c == '(')
+				depth++;
+			else if (c == ')')
+				depth--;
+			continue;
+		}
+
+		bool literal = false;
+		bool endRun = false;
+
+		switch (c) {
+		case '|':
+			// alternatives at the top level: nothing is required
+			return std::string();
+		case '\\':
+			if (i + 1 < urlRe.size()) {
+				char next = urlRe[++i];
+				// \w, \b, \< and friends are classes or assertions, not literals
+				if (isSchemeChar(next) || next == '<' || next == '>' || next == '`' || next == '\'')
+					endRun = true;
+				else {
+					c = next;
+					literal = true;
+				}
+			}
+			else
+				endRun = true;
+			break;
+		case '[':
+			i = skipBracket(urlRe, i);
+			endRun = true;
+			break;
+		case '(':
+			depth++;
+			endRun = true;
+			break;
+		case '*':
+		case '?':
+		case '{':
+			// the atom before is optional
+			if (!run.empty())
+				run.erase(run.size() - 1);
+			if (c == '{') {
+				while (i < urlRe.size() && urlRe[i] != '}')
+					i++;
+			}
+			endRun = true;
+			break;
+		case '+':
+			// the atom before is required, but whatever follows isn't right after it
+			endRun = true;
+			break;
+		case '.':
+		case '^':
+		case '$':
+		case ')':
+			endRun = true;
+			break;
+		default:
+			literal = true;
+			break;
+		}
+
+		// REG_ICASE folding of anything outside ASCII is up to the locale; don't guess
+		if (literal && (unsigned char) c >= 0x80) {
+			literal = false;
+			endRun = true;
+		}
+
+		if (literal)
+			run += asciiLower(c);
+
+		if (endRun) {
+			if (run.size() > best.size())
+				best = run;
+			run.clear();
+		}
+	}
+
+	if (run.size() > best.size())
+		best = run;
+
+	return best;
+}
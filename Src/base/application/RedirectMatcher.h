@@ -0,0 +1,96 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef REDIRECTMATCHER_H
+#define REDIRECTMATCHER_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <glib.h>
+
+#include "CmdResourceHandlers.h"
+
+/*
+ * Matches a url against a set of redirect handler patterns without running every regexp.
+ *
+ * Handlers are added in priority order (MimeSystem adds them in redirect table order) and every lookup
+ * returns what a linear walk calling RedirectHandler::matches() on each one would have returned.
+ *
+ * Patterns that are nothing but a literal scheme ("^tel:", "^x-palm-foo:") are looked up in a hash by the
+ * url's scheme and never reach regexec. Every other pattern carries the longest literal run the regexp
+ * requires (e.g. "youtube.com/watch" out of "^https?://(www\.)?youtube\.com/watch.*"), and the url has
+ * to contain it before the regexp is tried.
+ *
+ * The matcher keeps its own copies of the handlers (which share the compiled regexp with the originals)
+ * plus an opaque cookie per handler for the caller. Lookups only read, so once built a matcher can be
+ * used from several threads at once; building it (add/clear) is not thread safe.
+ */
+class RedirectMatcher
+{
+public:
+
+	RedirectMatcher();
+	~RedirectMatcher();
+
+	void clear();
+
+	// handlers must be added highest priority first
+	void add(const RedirectHandler& handler, void* cookie);
+
+	unsigned int size() const { return m_entries.size(); }
+
+	// the cookie of the first handler matching the url, limited to scheme and/or url forms; NULL if none
+	void* matchFirst(const std::string& url, bool schemeForms, bool urlForms) const;
+
+	// the cookies of every handler matching the url, in priority order. returns how many were added
+	int matchAll(const std::string& url, std::vector<void*>& r_cookies) const;
+
+	// "^tel:" -> "tel". false if the pattern is anything more than an anchored literal scheme
+	static bool literalScheme(const std::string& urlRe, std::string& r_scheme);
+
+	// the longest literal (lowercased) any url matching the extended regexp must contain; empty if unsure
+	static std::string requiredLiteral(const std::string& urlRe);
+
+private:
+
+	struct Entry {
+		Entry(const RedirectHandler& h, void* c) : handler(h), cookie(c) {}
+
+		RedirectHandler handler;
+		void* cookie;
+		std::string literal;
+	};
+
+	bool entryMatches(const Entry& entry, const std::string& url, const std::string& lowerUrl) const;
+	const std::vector<int>* schemeBucket(const std::string& lowerUrl) const;
+
+	std::vector<Entry> m_entries;
+	std::vector<int> m_patternEntries;				// entries that need regexec, in priority order
+	std::vector<std::vector<int> > m_schemeBuckets;	// literal scheme entries, in priority order per scheme
+	GHashTable* m_schemes;							// scheme -> index in m_schemeBuckets + 1
+
+	RedirectMatcher(const RedirectMatcher&);
+	RedirectMatcher& operator=(const RedirectMatcher&);
+};
+
+#endif /* REDIRECTMATCHER_H */
@@ -0,0 +1,330 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "SignatureVerifier.h"
+#include "MutexLocker.h"
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+static const unsigned int s_maxWorkerThreads = 4;
+static const size_t s_readChunkSize = 64 * 1024;
+
+static uint64_t mtimeOf(const struct stat& st)
+{
+	return (uint64_t) st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+}
+
+SignatureVerifier::SignatureVerifier()
+	: m_workerThreads(0)
+	, m_keyLoads(0)
+	, m_keyCacheHits(0)
+{
+	long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+	m_workerThreads = (cpus > 0) ? (unsigned int)cpus : 1;
+	if (m_workerThreads > s_maxWorkerThreads)
+		m_workerThreads = s_maxWorkerThreads;
+}
+
+SignatureVerifier::~SignatureVerifier()
+{
+	clearKeys();
+}
+
+void SignatureVerifier::clearKeys()
+{
+	MutexLocker locker(&m_mutex);
+
+	for (KeyMap::iterator it = m_keys.begin(); it != m_keys.end(); ++it)
+		EVP_PKEY_free(it->second.pkey);
+	m_keys.clear();
+}
+
+//static
+bool SignatureVerifier::readFile(const std::string& path, std::string& r_contents)
+{
+	r_contents.clear();
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	char buf[4096];
+	ssize_t n;
+	while ((n = ::read(fd, buf, sizeof(buf))) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			::close(fd);
+			return false;
+		}
+		r_contents.append(buf, n);
+	}
+
+	::close(fd);
+	return true;
+}
+
+EVP_PKEY* SignatureVerifier::publicKey(const std::string& path, KeyFormat format)
+{
+	struct stat st;
+	if (path.empty() || ::stat(path.c_str(), &st) != 0) {
+		g_warning("%s: can't stat %s", __PRETTY_FUNCTION__, path.c_str());
+		return 0;
+	}
+
+	KeyMap::iterator it = m_keys.find(path);
+	if (it != m_keys.end()) {
+		const Key& key = it->second;
+		if (key.format == format && key.dev == st.st_dev && key.ino == st.st_ino &&
+			key.size == st.st_size && key.mtime == mtimeOf(st)) {
+			m_keyCacheHits++;
+			return key.pkey;
+		}
+
+		EVP_PKEY_free(key.pkey);
+		m_keys.erase(it);
+	}
+
+	FILE* file = ::fopen(path.c_str(), "r");
+	if (!file) {
+		g_warning("%s: can't open %s", __PRETTY_FUNCTION__, path.c_str());
+		return 0;
+	}
+
+	EVP_PKEY* pkey = 0;
+	if (format == Certificate) {
+		X509* cert = PEM_read_X509(file, NULL, NULL, NULL);
+		if (cert) {
+			pkey = X509_get_pubkey(cert);
+			X509_free(cert);
+		}
+	}
+	else {
+		pkey = PEM_read_PUBKEY(file, NULL, NULL, NULL);
+	}
+	::fclose(file);
+
+	if (!pkey) {
+		g_warning("%s: no public key in %s", __PRETTY_FUNCTION__, path.c_str());
+		return 0;
+	}
+
+	Key key;
+	key.pkey = pkey;
+	key.format = format;
+	key.dev = st.st_dev;
+	key.ino = st.st_ino;
+	key.size = st.st_size;
+	key.mtime = mtimeOf(st);
+	m_keys[path] = key;
+	m_keyLoads++;
+
+	return pkey;
+}
+
+bool SignatureVerifier::writePublicKey(const std::string& certFile, const std::string& pubkeyFile)
+{
+	MutexLocker locker(&m_mutex);
+
+	EVP_PKEY* pkey = publicKey(certFile, Certificate);
+	if (!pkey)
+		return false;
+
+	int fd = ::open(pubkeyFile.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		g_warning("%s: can't create %s: %s", __PRETTY_FUNCTION__, pubkeyFile.c_str(), strerror(errno));
+		return false;
+	}
+
+	FILE* file = ::fdopen(fd, "w");
+	if (!file) {
+		::close(fd);
+		return false;
+	}
+
+	bool written = PEM_write_PUBKEY(file, pkey) == 1;
+	if (::fclose(file) != 0)
+		written = false;
+
+	if (!written)
+		::unlink(pubkeyFile.c_str());
+	return written;
+}
+
+//static
+bool SignatureVerifier::hashFile(const std::string& path, EVP_MD_CTX* ctx)
+{
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	if (st.st_size == 0) {
+		::close(fd);
+		return true;
+	}
+
+	void* map = ::mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map != MAP_FAILED) {
+		::madvise(map, st.st_size, MADV_SEQUENTIAL);
+		bool ok = EVP_VerifyUpdate(ctx, map, st.st_size) == 1;
+		::munmap(map, st.st_size);
+		::close(fd);
+		return ok;
+	}
+
+	// pipes, some special filesystems
+	char* buf = new char[s_readChunkSize];
+	bool ok = true;
+	ssize_t n;
+	while ((n = ::read(fd, buf, s_readChunkSize)) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			ok = false;
+			break;
+		}
+		if (EVP_VerifyUpdate(ctx, buf, n) != 1) {
+			ok = false;
+			break;
+		}
+	}
+
+	delete [] buf;
+	::close(fd);
+	return ok;
+}
+
+//static
+void SignatureVerifier::workerFunc(gpointer data, gpointer userData)
+{
+	Job* job = static_cast<Job*>(data);
+	const Request& request = *job->request;
+
+	for (std::vector<std::string>::const_iterator it = request.files.begin(); it != request.files.end(); ++it) {
+		if (!hashFile(*it, job->ctx)) {
+			g_warning("%s: can't hash %s", __PRETTY_FUNCTION__, it->c_str());
+			return;
+		}
+	}
+
+	if (!request.data.empty() && EVP_VerifyUpdate(job->ctx, request.data.data(), request.data.size()) != 1)
+		return;
+
+	job->hashed = true;
+}
+
+int SignatureVerifier::verify(Request& request)
+{
+	std::vector<Request> requests(1, request);
+	verify(requests);
+	request.result = requests[0].result;
+	return request.result;
+}
+
+void SignatureVerifier::verify(std::vector<Request>& requests)
+{
+	MutexLocker locker(&m_mutex);
+
+	std::vector<Job*> jobs;
+	std::vector<EVP_PKEY*> keys;
+
+	// keys and digest setup stay on this thread; only the hashing goes to the pool
+	for (unsigned int i = 0; i < requests.size(); i++) {
+
+		Request& request = requests[i];
+		request.result = -1;
+
+		EVP_PKEY* pkey = publicKey(request.keyFile, request.keyFormat);
+		if (!pkey)
+			continue;
+
+		if (request.signature.empty()) {
+			request.result = 0;
+			continue;
+		}
+
+		EVP_MD_CTX* ctx = EVP_MD_CTX_create();
+		if (!ctx)
+			continue;
+
+		if (EVP_VerifyInit_ex(ctx, EVP_sha1(), NULL) != 1) {
+			EVP_MD_CTX_destroy(ctx);
+			continue;
+		}
+
+		jobs.push_back(new Job(&request, ctx));
+		keys.push_back(pkey);
+	}
+
+	if (jobs.empty())
+		return;
+
+	GThreadPool* pool = 0;
+	if (jobs.size() > 1 && m_workerThreads > 1)
+		pool = g_thread_pool_new(workerFunc, this, m_workerThreads, FALSE, NULL);
+
+	if (pool) {
+		for (unsigned int i = 0; i < jobs.size(); i++)
+			g_thread_pool_push(pool, jobs[i], NULL);
+
+		// waits for the queue to drain
+		g_thread_pool_free(pool, FALSE, TRUE);
+	}
+	else {
+		for (unsigned int i = 0; i < jobs.size(); i++)
+			workerFunc(jobs[i], this);
+	}
+
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+
+		Job* job = jobs[i];
+		Request& request = *job->request;
+
+		if (job->hashed) {
+			int rc = EVP_VerifyFinal(job->ctx, (const unsigned char*) request.signature.data(),
+									 request.signature.size(), keys[i]);
+			request.result = (rc == 1) ? 1 : 0;
+			if (rc != 1)
+				ERR_clear_error();
+		}
+
+		EVP_MD_CTX_destroy(job->ctx);
+		delete job;
+	}
+}
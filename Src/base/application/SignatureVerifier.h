@@ -0,0 +1,127 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef SIGNATUREVERIFIER_H
+#define SIGNATUREVERIFIER_H
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <sys/types.h>
+#include <glib.h>
+#include <openssl/ossl_typ.h>
+
+#include "Mutex.h"
+
+/*
+ * Checks SHA-1 signatures the way "openssl dgst -sha1 -verify <key> -signature <sig> <files>" does,
+ * without running openssl.
+ *
+ * Files are mapped (or read in chunks if they can't be) and hashed in order, as if they had been
+ * concatenated. Public keys are parsed once, from a PEM public key or from the first certificate of
+ * a PEM file, and kept until the file changes on disk.
+ *
+ * verify() on a list hashes the requests on a small thread pool, one request per thread; the
+ * signature checks themselves are cheap and done on the calling thread afterwards, which also keeps
+ * libcrypto's key handling on one thread.
+ */
+class SignatureVerifier
+{
+public:
+
+	enum KeyFormat {
+		PublicKey,		// -----BEGIN PUBLIC KEY-----
+		Certificate		// -----BEGIN CERTIFICATE-----, its public key
+	};
+
+	struct Request {
+		Request() : keyFormat(PublicKey), result(-1) {}
+
+		std::vector<std::string> files;		// hashed in this order
+		std::string data;					// hashed after the files
+		std::string signature;				// raw, not base64
+		std::string keyFile;
+		KeyFormat keyFormat;
+
+		int result;							// out: > 0 verified, 0 bad signature, < 0 couldn't be checked
+	};
+
+	SignatureVerifier();
+	~SignatureVerifier();
+
+	// returns request.result
+	int verify(Request& request);
+	void verify(std::vector<Request>& requests);
+
+	// writes the public key of certFile to pubkeyFile as PEM
+	bool writePublicKey(const std::string& certFile, const std::string& pubkeyFile);
+
+	// drops the parsed keys
+	void clearKeys();
+
+	static bool readFile(const std::string& path, std::string& r_contents);
+
+	unsigned int keyLoads() const { return m_keyLoads; }
+	unsigned int keyCacheHits() const { return m_keyCacheHits; }
+	unsigned int workerThreads() const { return m_workerThreads; }
+
+private:
+
+	struct Key {
+		Key() : pkey(0), format(PublicKey), dev(0), ino(0), size(0), mtime(0) {}
+
+		EVP_PKEY* pkey;
+		KeyFormat format;
+		dev_t dev;
+		ino_t ino;
+		off_t size;
+		uint64_t mtime;
+	};
+
+	// one request, hashed on the pool
+	struct Job {
+		Job(Request* request, EVP_MD_CTX* ctx) : request(request), ctx(ctx), hashed(false) {}
+
+		Request* request;
+		EVP_MD_CTX* ctx;
+		bool hashed;
+	};
+
+	typedef std::map<std::string, Key> KeyMap;
+
+	// owned by the cache; 0 if the file has no usable key
+	EVP_PKEY* publicKey(const std::string& path, KeyFormat format);
+
+	static bool hashFile(const std::string& path, EVP_MD_CTX* ctx);
+	static void workerFunc(gpointer data, gpointer userData);
+
+	Mutex m_mutex;
+	KeyMap m_keys;
+	unsigned int m_workerThreads;
+
+	unsigned int m_keyLoads;
+	unsigned int m_keyCacheHits;
+};
+
+#endif /* SIGNATUREVERIFIER_H */
@@ -0,0 +1,73 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "LunaConf.h"
+
+const char* const kLunaConfFile = "/etc/palm/luna.conf";
+const char* const kLunaConfFilePlatform = "/etc/palm/luna-platform.conf";
+
+void readLunaConf(LunaConfReader reader, void* data)
+{
+	const char* const files[] = { kLunaConfFile, kLunaConfFilePlatform };
+
+	for (unsigned int i = 0; i < G_N_ELEMENTS(files); i++) {
+		GKeyFile* keyfile = g_key_file_new();
+		if (g_key_file_load_from_file(keyfile, files[i], G_KEY_FILE_NONE, NULL))
+			reader(keyfile, files[i], data);
+		g_key_file_free(keyfile);
+	}
+}
+
+bool lunaConfInteger(GKeyFile* keyfile, const char* group, const char* key, int& r_value)
+{
+	GError* err = NULL;
+	int value = g_key_file_get_integer(keyfile, group, key, &err);
+	if (err) {
+		g_error_free(err);
+		return false;
+	}
+
+	r_value = value;
+	return true;
+}
+
+struct IntegerKey {
+	const char* group;
+	const char* key;
+	int* value;
+	bool found;
+};
+
+static void readIntegerKey(GKeyFile* keyfile, const char* path, void* data)
+{
+	IntegerKey* integer = static_cast<IntegerKey*>(data);
+	if (lunaConfInteger(keyfile, integer->group, integer->key, *integer->value))
+		integer->found = true;
+}
+
+bool readLunaConfInteger(const char* group, const char* key, int& r_value)
+{
+	IntegerKey integer = { group, key, &r_value, false };
+	readLunaConf(readIntegerKey, &integer);
+	return integer.found;
+}
@@ -0,0 +1,47 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef LUNACONF_H
+#define LUNACONF_H
+
+#include "Common.h"
+
+#include <glib.h>
+
+/*
+ * Reads luna.conf keys that Settings doesn't keep, for the code that uses them. The files are the ones
+ * Settings loads, in the same order: /etc/palm/luna.conf, then /etc/palm/luna-platform.conf, a key in
+ * the platform file overriding the same key in the base one.
+ */
+
+extern const char* const kLunaConfFile;
+extern const char* const kLunaConfFilePlatform;
+
+// called with each of the two files that loads, the base one first
+typedef void (*LunaConfReader)(GKeyFile* keyfile, const char* path, void* data);
+
+void readLunaConf(LunaConfReader reader, void* data);
+
+// [group] key as an integer; r_value is left alone where the key isn't there
+bool lunaConfInteger(GKeyFile* keyfile, const char* group, const char* key, int& r_value);
+bool readLunaConfInteger(const char* group, const char* key, int& r_value);
+
+#endif /* LUNACONF_H */
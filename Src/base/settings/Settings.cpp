@@ -31,13 +31,12 @@
 
 #include "Utils.h"
 #include "Logging.h"
+#include "LunaConf.h"
 
 #if !defined(TARGET_DESKTOP)
  #include <lunaprefs.h>
 #endif
 
-static const char* kSettingsFile = "/etc/palm/luna.conf";
-static const char* kSettingsFilePlatform = "/etc/palm/luna-platform.conf";
 static QHash<QString, QVariant> *allSettings = 0;
 
 #if 0
@@ -245,8 +244,8 @@ Settings::Settings()
     , allowAllAppsInLowMemory(false)
 {
     allSettings = new QHash<QString, QVariant>();
-	load(kSettingsFile);
-	load(kSettingsFilePlatform);
+	load(kLunaConfFile);
+	load(kLunaConfFilePlatform);
 
 	postLoad();
 
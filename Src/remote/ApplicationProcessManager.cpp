@@ -18,22 +18,39 @@
 
 #include <QProcess>
 #include <QDebug>
+#include <QTemporaryFile>
+
+#include <signal.h>
+#include <string.h>
 
 #include "ApplicationProcessManager.h"
+#include "ApplicationZygote.h"
 #include "ApplicationDescription.h"
 #include "ApplicationManager.h"
 
 #define WEBAPP_LAUNCHER_PATH    "/usr/sbin/webapp-launcher"
 #define QMLAPP_LAUNCHER_PATH    "/usr/bin/qt5/qmlscene"
 
+// launches kept for applicationManager/launchStats
+#define MAX_RECENT_LAUNCHES     32
+
 ApplicationProcess::ApplicationProcess(const QString& id, QObject *parent) :
-    QProcess(parent),
-    m_id(id)
+    QObject(parent),
+    m_id(id),
+    m_process(0),
+    m_pid(0),
+    m_inZygote(false),
+    m_requestedAt(0),
+    m_resolvedAt(0),
+    m_spawnedAt(0),
+    m_focusedAt(0)
 {
 }
 
-void ApplicationProcess::setupChildProcess()
+void ApplicationProcess::setLaunchTimes(qint64 requestedAt, qint64 resolvedAt)
 {
+    m_requestedAt = requestedAt;
+    m_resolvedAt = resolvedAt;
 }
 
 QString ApplicationProcess::id() const
@@ -41,6 +58,93 @@ QString ApplicationProcess::id() const
     return m_id;
 }
 
+qint64 ApplicationProcess::pid() const
+{
+    return m_pid;
+}
+
+bool ApplicationProcess::startProcess(const QString& path, const QStringList& parameters,
+                                      const QProcessEnvironment& environment)
+{
+    m_process = new QProcess(this);
+    m_process->setProcessEnvironment(environment);
+    m_process->setProcessChannelMode(QProcess::ForwardedChannels);
+
+    connect(m_process, SIGNAL(started()), this, SIGNAL(started()));
+    connect(m_process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SIGNAL(finished()));
+
+    // NOTE: Currently we're just forking once so the new process will be a child of ours and
+    // will exit once we exit.
+    // start() returns once the child is forked and its pid is known; whether the exec went through is
+    // only reported later (started() or error(FailedToStart)), so the main loop isn't held up waiting
+    // for it, which matters for the burst of launches at boot.
+    m_process->start(path, parameters);
+    if (m_process->state() == QProcess::NotRunning || m_process->pid() <= 0)
+        return false;
+
+    // only now, so that a failed fork above isn't also reported as failedToStart()
+    connect(m_process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onProcessError(QProcess::ProcessError)));
+
+    m_pid = m_process->pid();
+    return true;
+}
+
+bool ApplicationProcess::startInZygote(ApplicationZygote* zygote, const QString& path, const QStringList& parameters)
+{
+    m_pid = zygote->spawn(path, parameters);
+    m_inZygote = m_pid > 0;
+    return m_inZygote;
+}
+
+void ApplicationProcess::kill()
+{
+    if (m_process)
+        m_process->kill();
+    else if (m_pid > 0)
+        ::kill(m_pid, SIGKILL);
+}
+
+void ApplicationProcess::onProcessError(QProcess::ProcessError error)
+{
+    // crashes and the like still end in finished(); a failed exec never does
+    if (error != QProcess::FailedToStart)
+        return;
+
+    qWarning() << "Application" << m_id << "failed to start:" << m_process->errorString();
+    Q_EMIT failedToStart();
+}
+
+void ApplicationProcess::zygoteProcessStarted()
+{
+    Q_EMIT started();
+}
+
+void ApplicationProcess::zygoteProcessFailedToStart()
+{
+    Q_EMIT failedToStart();
+}
+
+void ApplicationProcess::zygoteProcessExited()
+{
+    Q_EMIT finished();
+}
+
+void ApplicationLaunchTotals::add(const ApplicationLaunchSample& sample)
+{
+    launches++;
+    if (sample.failed) {
+        failures++;
+        return;
+    }
+
+    totalResolveUs += sample.resolveUs;
+    totalSpawnUs += sample.spawnUs;
+    totalFirstAliveUs += sample.firstAliveUs;
+    maxResolveUs = qMax(maxResolveUs, sample.resolveUs);
+    maxSpawnUs = qMax(maxSpawnUs, sample.spawnUs);
+    maxFirstAliveUs = qMax(maxFirstAliveUs, sample.firstAliveUs);
+}
+
 ApplicationProcessManager* ApplicationProcessManager::instance()
 {
     static ApplicationProcessManager *instance = 0;
@@ -51,31 +155,42 @@ ApplicationProcessManager* ApplicationProcessManager::instance()
 }
 
 ApplicationProcessManager::ApplicationProcessManager() :
-    QObject(0)
+    QObject(0),
+    m_zygote(0),
+    m_launchRequestedAt(0),
+    m_foregroundKnown(false)
 {
+    m_clock.start();
+
+    // the same for every app; no need to copy our environment again on each launch
+    m_environment = QProcessEnvironment::systemEnvironment();
+    m_environment.insert("XDG_RUNTIME_DIR","/tmp/luna-session");
+    m_environment.insert("QT_WAYLAND_DISABLE_WINDOWDECORATION", "1");
+    m_environment.insert("QT_IM_MODULE", "Maliit");
+    m_environment.insert("SDL_VIDEODRIVER", "wayland");
+
+    m_zygote = ApplicationZygote::instance();
+    if (m_zygote) {
+        connect(m_zygote, SIGNAL(processStarted(qint64)), this, SLOT(onZygoteProcessStarted(qint64)));
+        connect(m_zygote, SIGNAL(processFailedToStart(qint64,int)), this, SLOT(onZygoteProcessFailedToStart(qint64,int)));
+        connect(m_zygote, SIGNAL(processExited(qint64,int)), this, SLOT(onZygoteProcessExited(qint64,int)));
+        connect(m_zygote, SIGNAL(died()), this, SLOT(onZygoteDied()));
+    }
 }
 
-bool ApplicationProcessManager::isRunning(std::string appId)
+ApplicationProcess* ApplicationProcessManager::processById(const QString& appId) const
 {
-    Q_FOREACH(ApplicationProcess *app, m_applications) {
-        if (app->id() == QString::fromStdString(appId))
-            return true;
-    }
+    return m_processById.value(appId, 0);
+}
 
-    return false;
+bool ApplicationProcessManager::isRunning(std::string appId)
+{
+    return processById(QString::fromStdString(appId)) != 0;
 }
 
 std::string ApplicationProcessManager::getPid(std::string appId)
 {
-    ApplicationProcess *selectedApp = 0;
-
-    Q_FOREACH(ApplicationProcess *app, m_applications) {
-        if (app->id() == QString::fromStdString(appId)) {
-            selectedApp = app;
-            break;
-        }
-    }
-
+    ApplicationProcess *selectedApp = processById(QString::fromStdString(appId));
     if (selectedApp == 0)
         return std::string("");
 
@@ -88,17 +203,46 @@ QList<ApplicationProcess*> ApplicationProcessManager::runningApplications() cons
     return m_applications;
 }
 
+void ApplicationProcessManager::setForegroundApplication(const std::string& appId)
+{
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+
+    // the one leaving the front is idle from now on, not from when it got there
+    ApplicationProcess *previous = processById(m_foregroundAppId);
+    if (previous)
+        previous->setFocusedAt(now);
+
+    m_foregroundAppId = QString::fromStdString(appId);
+    m_foregroundKnown = true;
+
+    ApplicationProcess *process = processById(m_foregroundAppId);
+    if (process)
+        process->setFocusedAt(now);
+}
+
+bool ApplicationProcessManager::isForeground(const ApplicationProcess* process) const
+{
+    return !m_foregroundAppId.isEmpty() && process->id() == m_foregroundAppId;
+}
+
+qint64 ApplicationProcessManager::idleMs(const ApplicationProcess* process) const
+{
+    if (isForeground(process))
+        return 0;
+    return (m_clock.nsecsElapsed() / 1000 - process->focusedAt()) / 1000;
+}
+
 void ApplicationProcessManager::killByAppId(std::string appId)
 {
-    Q_FOREACH(ApplicationProcess *app, m_applications) {
-        if (app->id() == QString::fromStdString(appId)) {
-            app->kill();
-        }
-    }
+    ApplicationProcess *app = processById(QString::fromStdString(appId));
+    if (app)
+        app->kill();
 }
 
 std::string ApplicationProcessManager::launch(std::string appId, std::string params)
 {
+    m_launchRequestedAt = m_clock.nsecsElapsed() / 1000;
+
     qDebug() << "Launching application" << QString::fromStdString(appId);
 
     ApplicationDescription* desc = ApplicationManager::instance()->getPendingAppById(appId);
@@ -113,12 +257,11 @@ std::string ApplicationProcessManager::launch(std::string appId, std::string par
 
     bool running = false;
     qint64 pid = 0;
-    Q_FOREACH(ApplicationProcess *app, m_applications) {
-        if (app->id() == QString::fromStdString(appId)) {
-            running = true;
-            pid = app->pid();
-            break;
-        }
+    ApplicationProcess *app = processById(QString::fromStdString(appId));
+    if (app) {
+        running = true;
+        pid = app->pid();
+        app->setFocusedAt(m_launchRequestedAt);
     }
 
     if (!running) {
@@ -154,45 +297,163 @@ std::string ApplicationProcessManager::launch(std::string appId, std::string par
 
 qint64 ApplicationProcessManager::launchProcess(const QString& id, const QString &path, const QStringList &parameters)
 {
+    qint64 resolvedAt = m_clock.nsecsElapsed() / 1000;
+
     qDebug() << "Starting process" << id << path << parameters;
 
     ApplicationProcess *process = new ApplicationProcess(id);
+    process->setLaunchTimes(m_launchRequestedAt, resolvedAt);
 
-    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
-    environment.insert("XDG_RUNTIME_DIR","/tmp/luna-session");
-    environment.insert("QT_WAYLAND_DISABLE_WINDOWDECORATION", "1");
-    environment.insert("QT_IM_MODULE", "Maliit");
-    environment.insert("SDL_VIDEODRIVER", "wayland");
+    connect(process, SIGNAL(started()), this, SLOT(onProcessStarted()));
+    connect(process, SIGNAL(failedToStart()), this, SLOT(onProcessFailedToStart()));
+    connect(process, SIGNAL(finished()), this, SLOT(onProcessFinished()));
 
-    process->setProcessEnvironment(environment);
-    process->setProcessChannelMode(QProcess::ForwardedChannels);
+    // the zygote, when there is one, takes every launch it can; QProcess is the fallback
+    bool forked = (m_zygote && m_zygote->isRunning() && process->startInZygote(m_zygote, path, parameters))
+            || process->startProcess(path, parameters, m_environment);
+    process->setSpawnedAt(m_clock.nsecsElapsed() / 1000);
+    process->setFocusedAt(process->spawnedAt());
 
-    connect(process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(onProcessFinished(int,QProcess::ExitStatus)));
-
-    // NOTE: Currently we're just forking once so the new process will be a child of ours and
-    // will exit once we exit.
-    process->start(path, parameters);
-    process->waitForStarted();
-
-    if (process->state() != QProcess::Running) {
+    if (!forked) {
         qDebug() << "Failed to start process";
+        recordLaunch(process, true);
+        process->disconnect(this);
         process->deleteLater();
         return -1;
     }
 
     m_applications.append(process);
+    m_processById.insert(id, process);
+    if (process->inZygote())
+        m_zygoteProcesses.insert(process->pid(), process);
 
     return process->pid();
 }
 
-void ApplicationProcessManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void ApplicationProcessManager::onProcessStarted()
+{
+    ApplicationProcess *process = static_cast<ApplicationProcess*>(sender());
+
+    recordLaunch(process, false);
+
+    Q_EMIT applicationStarted(process->id(), process->pid());
+}
+
+void ApplicationProcessManager::onProcessFailedToStart()
+{
+    ApplicationProcess *process = static_cast<ApplicationProcess*>(sender());
+
+    recordLaunch(process, true);
+    removeProcess(process);
+    process->deleteLater();
+
+    Q_EMIT applicationLaunchFailed(process->id());
+}
+
+void ApplicationProcessManager::onProcessFinished()
 {
     ApplicationProcess *process = static_cast<ApplicationProcess*>(sender());
 
     qDebug() << "Application" << process->id() << "exited";
 
+    removeProcess(process);
+    process->deleteLater();
+}
+
+void ApplicationProcessManager::onZygoteProcessStarted(qint64 pid)
+{
+    ApplicationProcess *process = m_zygoteProcesses.value(pid, 0);
+    if (process)
+        process->zygoteProcessStarted();
+}
+
+void ApplicationProcessManager::onZygoteProcessFailedToStart(qint64 pid, int error)
+{
+    ApplicationProcess *process = m_zygoteProcesses.value(pid, 0);
+    if (!process)
+        return;
+
+    qWarning() << "Application" << process->id() << "failed to start:" << strerror(error);
+    process->zygoteProcessFailedToStart();
+}
+
+void ApplicationProcessManager::onZygoteProcessExited(qint64 pid, int status)
+{
+    ApplicationProcess *process = m_zygoteProcesses.value(pid, 0);
+    if (process)
+        process->zygoteProcessExited();
+}
+
+void ApplicationProcessManager::onZygoteDied()
+{
+    qWarning() << "Launch zygote is gone, launching through QProcess from now on";
+
+    // its children were killed along with it
+    Q_FOREACH(ApplicationProcess *process, m_zygoteProcesses.values())
+        process->zygoteProcessExited();
+}
+
+void ApplicationProcessManager::removeProcess(ApplicationProcess *process)
+{
     m_applications.removeAll(process);
-    delete process;
+
+    // a relaunch may already have taken the id over
+    if (processById(process->id()) == process)
+        m_processById.remove(process->id());
+
+    if (process->inZygote() && m_zygoteProcesses.value(process->pid(), 0) == process)
+        m_zygoteProcesses.remove(process->pid());
+}
+
+void ApplicationProcessManager::recordLaunch(ApplicationProcess *process, bool failed)
+{
+    ApplicationLaunchSample sample;
+    sample.appId = process->id();
+    sample.pid = failed ? 0 : process->pid();
+    sample.resolveUs = process->resolvedAt() - process->requestedAt();
+    sample.spawnUs = process->spawnedAt() - process->resolvedAt();
+    sample.firstAliveUs = failed ? 0 : m_clock.nsecsElapsed() / 1000 - process->spawnedAt();
+    sample.zygote = process->inZygote();
+    sample.failed = failed;
+
+    if (sample.zygote)
+        m_launchStats.zygote.add(sample);
+    else
+        m_launchStats.process.add(sample);
+
+    m_launchStats.recent.append(sample);
+    while (m_launchStats.recent.size() > MAX_RECENT_LAUNCHES)
+        m_launchStats.recent.removeFirst();
+}
+
+QString ApplicationProcessManager::appInfoFileFor(ApplicationDescription *desc)
+{
+    // apps without an appinfo.json on disk get theirs written out for the launcher; once per app (and
+    // again only if the description changes) rather than into a new temp file on every launch
+    QByteArray appDescription = QString::fromStdString(desc->toString()).toUtf8();
+    QString id = QString::fromStdString(desc->id());
+    uint contentHash = qHash(appDescription);
+
+    QHash<QString, QString>::const_iterator existing = m_appInfoFiles.constFind(id);
+    if (existing != m_appInfoFiles.constEnd() && m_appInfoHashes.value(id) == contentHash
+            && QFile::exists(existing.value()))
+        return existing.value();
+
+    QTemporaryFile appInfoFile;
+    appInfoFile.setAutoRemove(false);
+    if (!appInfoFile.open()) {
+        qWarning() << "Failed to write appinfo for" << id;
+        return QString();
+    }
+    appInfoFile.write(appDescription);
+    appInfoFile.close();
+
+    if (existing != m_appInfoFiles.constEnd())
+        QFile::remove(existing.value());
+
+    m_appInfoFiles.insert(id, appInfoFile.fileName());
+    m_appInfoHashes.insert(id, contentHash);
+    return appInfoFile.fileName();
 }
 
 qint64 ApplicationProcessManager::launchWebApp(ApplicationDescription *desc, std::string &params)
@@ -201,14 +462,9 @@ qint64 ApplicationProcessManager::launchWebApp(ApplicationDescription *desc, std
 
     if (desc->filePath().length() == 0)
     {
-        QString appDescription = QString::fromStdString(desc->toString());
-        QTemporaryFile appInfoFile;
-        appInfoFile.setAutoRemove(false);
-        appInfoFile.open();
-        appInfoFile.write(appDescription.toUtf8());
-        appInfoFile.close();
-
-        appInfoFilePath = appInfoFile.fileName();
+        appInfoFilePath = appInfoFileFor(desc);
+        if (appInfoFilePath.isEmpty())
+            return -1;
     }
     else
     {
@@ -23,24 +23,103 @@
 #include <QString>
 #include <QProcess>
 #include <QList>
-#include <QTemporaryFile>
+#include <QHash>
+#include <QElapsedTimer>
 
 #include "ApplicationDescription.h"
 #include "Common.h"
 #include "WindowTypes.h"
 
-class ApplicationProcess : public QProcess
+class ApplicationZygote;
+
+// a running application; forked by sysmgr through QProcess, or by the ApplicationZygote
+class ApplicationProcess : public QObject
 {
+    Q_OBJECT
 public:
     ApplicationProcess(const QString &id, QObject *parent = 0);
 
     QString id() const;
+    qint64 pid() const;
+
+    // both return once the process is forked; false if it couldn't be
+    bool startProcess(const QString& path, const QStringList& parameters, const QProcessEnvironment& environment);
+    bool startInZygote(ApplicationZygote* zygote, const QString& path, const QStringList& parameters);
+
+    bool inZygote() const { return m_inZygote; }
+    void kill();
+
+    // the zygote reports on its children to ApplicationProcessManager, which passes it on here
+    void zygoteProcessStarted();
+    void zygoteProcessFailedToStart();
+    void zygoteProcessExited();
+
+    // launch timestamps, in microseconds on ApplicationProcessManager's clock
+    qint64 requestedAt() const { return m_requestedAt; }
+    qint64 resolvedAt() const { return m_resolvedAt; }
+    qint64 spawnedAt() const { return m_spawnedAt; }
+    void setLaunchTimes(qint64 requestedAt, qint64 resolvedAt);
+    void setSpawnedAt(qint64 spawnedAt) { m_spawnedAt = spawnedAt; }
+
+    // when it was last in front (or launched), on the same clock
+    qint64 focusedAt() const { return m_focusedAt; }
+    void setFocusedAt(qint64 focusedAt) { m_focusedAt = focusedAt; }
 
-protected:
-    void setupChildProcess();
+Q_SIGNALS:
+    void started();
+    void failedToStart();
+    void finished();
+
+private Q_SLOTS:
+    void onProcessError(QProcess::ProcessError error);
 
 private:
     QString m_id;
+    QProcess* m_process;
+    qint64 m_pid;
+    bool m_inZygote;
+    qint64 m_requestedAt;
+    qint64 m_resolvedAt;
+    qint64 m_spawnedAt;
+    qint64 m_focusedAt;
+};
+
+// where the time of an application launch went, for applicationManager/launchStats
+struct ApplicationLaunchSample
+{
+    ApplicationLaunchSample() : pid(0), resolveUs(0), spawnUs(0), firstAliveUs(0), zygote(false), failed(false) {}
+
+    QString appId;
+    qint64 pid;
+    qint64 resolveUs;       // launch request -> app description found, command line built
+    qint64 spawnUs;         // -> fork done, pid known
+    qint64 firstAliveUs;    // -> exec of the app confirmed
+    bool zygote;            // forked by the ApplicationZygote rather than by QProcess
+    bool failed;
+};
+
+struct ApplicationLaunchTotals
+{
+    ApplicationLaunchTotals() : launches(0), failures(0), maxResolveUs(0), maxSpawnUs(0), maxFirstAliveUs(0),
+        totalResolveUs(0), totalSpawnUs(0), totalFirstAliveUs(0) {}
+
+    void add(const ApplicationLaunchSample& sample);
+
+    unsigned int launches;
+    unsigned int failures;
+    qint64 maxResolveUs;
+    qint64 maxSpawnUs;
+    qint64 maxFirstAliveUs;
+    qint64 totalResolveUs;
+    qint64 totalSpawnUs;
+    qint64 totalFirstAliveUs;
+};
+
+struct ApplicationLaunchStats
+{
+    ApplicationLaunchTotals process;    // launched through QProcess
+    ApplicationLaunchTotals zygote;     // launched through the ApplicationZygote
+    QList<ApplicationLaunchSample> recent;   // newest last
 };
 
 class ApplicationProcessManager : public QObject
@@ -57,12 +136,38 @@ public:
 
     QList<ApplicationProcess*> runningApplications() const;
 
+    // for MemoryMonitor to tell the apps in use from the ones left in the background. The compositor reports
+    // every foreground change (an empty id when no app is in front); until it has, nothing counts as foreground
+    void setForegroundApplication(const std::string& appId);
+    bool foregroundKnown() const { return m_foregroundKnown; }
+    bool isForeground(const ApplicationProcess* process) const;
+    qint64 idleMs(const ApplicationProcess* process) const;
+
+    const ApplicationLaunchStats& launchStats() const { return m_launchStats; }
+
+Q_SIGNALS:
+    // launch() returns as soon as the process is forked; these report how the exec went
+    void applicationStarted(const QString& appId, qint64 pid);
+    void applicationLaunchFailed(const QString& appId);
+
 private Q_SLOTS:
-    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessStarted();
+    void onProcessFailedToStart();
+    void onProcessFinished();
+
+    void onZygoteProcessStarted(qint64 pid);
+    void onZygoteProcessFailedToStart(qint64 pid, int error);
+    void onZygoteProcessExited(qint64 pid, int status);
+    void onZygoteDied();
 
 private:
     ApplicationProcessManager();
 
+    ApplicationProcess* processById(const QString& appId) const;
+    void removeProcess(ApplicationProcess* process);
+    void recordLaunch(ApplicationProcess* process, bool failed);
+    QString appInfoFileFor(ApplicationDescription* desc);
+
     qint64 launchWebApp(ApplicationDescription *desc, std::string& params);
     qint64 launchNativeApp(ApplicationDescription *desc, std::string& params);
     qint64 launchQMLApp(ApplicationDescription *desc, std::string& params);
@@ -70,6 +175,23 @@ private:
     qint64 launchProcess(const QString& id, const QString& path, const QStringList& parameters);
 
     QList<ApplicationProcess*> m_applications;
+    QHash<QString, ApplicationProcess*> m_processById;
+    QHash<qint64, ApplicationProcess*> m_zygoteProcesses;     // by pid
+
+    ApplicationZygote* m_zygote;    // 0 unless sysmgr was started with --zygote
+
+    // appinfo.json contents handed to the webapp launcher for apps without a file, by app id
+    QHash<QString, QString> m_appInfoFiles;
+    QHash<QString, uint> m_appInfoHashes;
+
+    QProcessEnvironment m_environment;
+
+    QElapsedTimer m_clock;
+    qint64 m_launchRequestedAt;
+    ApplicationLaunchStats m_launchStats;
+
+    QString m_foregroundAppId;
+    bool m_foregroundKnown;
 };
 
 #endif // APPLICATONPROCESSMANAGER_H
@@ -0,0 +1,392 @@
+/* @@@LICENSE
+*
+* (c) 2013 Simon Busch <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+#include <QSocketNotifier>
+#include <QMetaObject>
+#include <QDebug>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "ApplicationZygote.h"
+
+// largest launch request (path and parameters, NUL separated); bigger ones go through QProcess
+#define ZYGOTE_MAX_REQUEST      65536
+#define ZYGOTE_MAX_ARGS         256
+
+// how long spawn() waits for the helper to report the fork before giving up on it
+#define ZYGOTE_SPAWN_TIMEOUT_MS 2000
+
+enum {
+    ReplySpawned = 1,       // pid of the fork, or -1 and the errno of fork()
+    ReplyStarted,           // the exec went through
+    ReplyFailed,            // the exec failed; value is its errno
+    ReplyExited             // value is the wait status
+};
+
+extern char** environ;
+
+int ApplicationZygote::s_fd = -1;
+pid_t ApplicationZygote::s_helperPid = -1;
+
+bool ApplicationZygote::start()
+{
+    if (s_fd >= 0)
+        return true;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        qWarning("%s: socketpair failed: %s", __FUNCTION__, strerror(errno));
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        qWarning("%s: fork failed: %s", __FUNCTION__, strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        helperMain(fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    s_fd = fds[0];
+    s_helperPid = pid;
+    return true;
+}
+
+ApplicationZygote* ApplicationZygote::instance()
+{
+    static ApplicationZygote* instance = 0;
+    if (!instance && s_fd >= 0)
+        instance = new ApplicationZygote(s_fd, s_helperPid);
+
+    return instance;
+}
+
+ApplicationZygote::ApplicationZygote(int fd, pid_t helperPid) :
+    QObject(0),
+    m_fd(fd),
+    m_helperPid(helperPid),
+    m_serial(0)
+{
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadable()));
+}
+
+qint64 ApplicationZygote::spawn(const QString& path, const QStringList& parameters)
+{
+    // the helper execs without a PATH search, which is left to QProcess
+    if (m_fd < 0 || !path.startsWith('/') || parameters.size() + 1 > ZYGOTE_MAX_ARGS)
+        return -1;
+
+    quint32 serial = ++m_serial;
+
+    QByteArray request(reinterpret_cast<const char*>(&serial), sizeof(serial));
+    request.append(path.toLocal8Bit());
+    request.append('\0');
+    Q_FOREACH(const QString& parameter, parameters) {
+        request.append(parameter.toLocal8Bit());
+        request.append('\0');
+    }
+
+    if (request.size() > ZYGOTE_MAX_REQUEST)
+        return -1;
+
+    if (send(m_fd, request.constData(), request.size(), MSG_NOSIGNAL) != request.size()) {
+        qWarning("%s: lost the launch helper: %s", __FUNCTION__, strerror(errno));
+        shutdown();
+        return -1;
+    }
+
+    Reply reply;
+    while (readReply(reply, true)) {
+        if (reply.type == ReplySpawned && reply.serial == serial)
+            return reply.pid > 0 ? reply.pid : -1;
+
+        // news about earlier launches; handed out from the main loop, not from inside this call
+        if (m_pending.isEmpty())
+            QMetaObject::invokeMethod(this, "dispatchPending", Qt::QueuedConnection);
+        m_pending.append(reply);
+    }
+
+    return -1;
+}
+
+bool ApplicationZygote::readReply(Reply& r_reply, bool wait)
+{
+    if (m_fd < 0)
+        return false;
+
+    if (wait) {
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int rc;
+        do {
+            rc = poll(&pfd, 1, ZYGOTE_SPAWN_TIMEOUT_MS);
+        } while (rc < 0 && errno == EINTR);
+
+        if (rc <= 0) {
+            qWarning("%s: the launch helper stopped answering", __FUNCTION__);
+            shutdown();
+            return false;
+        }
+    }
+
+    ssize_t len;
+    do {
+        len = recv(m_fd, &r_reply, sizeof(r_reply), wait ? 0 : MSG_DONTWAIT);
+    } while (len < 0 && errno == EINTR);
+
+    if (len == sizeof(r_reply))
+        return true;
+
+    if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return false;
+
+    qWarning("%s: lost the launch helper", __FUNCTION__);
+    shutdown();
+    return false;
+}
+
+void ApplicationZygote::onReadable()
+{
+    dispatchPending();
+
+    Reply reply;
+    while (readReply(reply, false))
+        dispatch(reply);
+}
+
+void ApplicationZygote::dispatchPending()
+{
+    QList<Reply> pending;
+    pending.swap(m_pending);
+
+    Q_FOREACH(const Reply& reply, pending)
+        dispatch(reply);
+}
+
+void ApplicationZygote::dispatch(const Reply& reply)
+{
+    switch (reply.type) {
+    case ReplyStarted:
+        Q_EMIT processStarted(reply.pid);
+        break;
+    case ReplyFailed:
+        Q_EMIT processFailedToStart(reply.pid, reply.value);
+        break;
+    case ReplyExited:
+        Q_EMIT processExited(reply.pid, reply.value);
+        break;
+    default:
+        // a spawn() that timed out and got its answer late
+        break;
+    }
+}
+
+void ApplicationZygote::shutdown()
+{
+    if (m_fd < 0)
+        return;
+
+    m_notifier->setEnabled(false);
+    m_notifier->deleteLater();
+    m_notifier = 0;
+
+    close(m_fd);
+    m_fd = -1;
+    s_fd = -1;
+
+    // closing the socket makes it exit; reap it if it already has
+    waitpid(m_helperPid, 0, WNOHANG);
+
+    QMetaObject::invokeMethod(this, "died", Qt::QueuedConnection);
+}
+
+// -------------------------------------------------------------------------
+// the helper process
+
+static int s_childSignalPipe[2] = { -1, -1 };
+
+static void helperChildSignalHandler(int)
+{
+    int savedErrno = errno;
+    char c = 0;
+    if (write(s_childSignalPipe[1], &c, 1) < 0) {
+        // full; the loop is going to reap anyway
+    }
+    errno = savedErrno;
+}
+
+static void helperSendReply(int fd, quint32 type, quint32 serial, qint32 pid, qint32 value)
+{
+    quint32 reply[4] = { type, serial, (quint32)pid, (quint32)value };
+    if (send(fd, reply, sizeof(reply), MSG_NOSIGNAL) < 0) {
+        // sysmgr is gone; the next recv() tells the loop
+    }
+}
+
+static void helperSpawn(int fd, pid_t helperPid, quint32 serial, char* path, char** argv)
+{
+    // reports the errno of a failed exec; closes by itself on a successful one
+    int execPipe[2];
+    if (pipe2(execPipe, O_CLOEXEC) < 0) {
+        helperSendReply(fd, ReplySpawned, serial, -1, errno);
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+
+        // go down with the helper, and so with sysmgr, as QProcess children do
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != helperPid)
+            _exit(127);
+
+        execve(path, argv, environ);
+
+        int err = errno;
+        if (write(execPipe[1], &err, sizeof(err)) < 0) {
+            // nothing left to tell it with
+        }
+        _exit(127);
+    }
+
+    close(execPipe[1]);
+
+    if (pid < 0) {
+        helperSendReply(fd, ReplySpawned, serial, -1, errno);
+        close(execPipe[0]);
+        return;
+    }
+
+    helperSendReply(fd, ReplySpawned, serial, pid, 0);
+
+    int err = 0;
+    ssize_t len;
+    do {
+        len = read(execPipe[0], &err, sizeof(err));
+    } while (len < 0 && errno == EINTR);
+    close(execPipe[0]);
+
+    if (len == sizeof(err))
+        helperSendReply(fd, ReplyFailed, serial, pid, err);
+    else
+        helperSendReply(fd, ReplyStarted, serial, pid, 0);
+}
+
+void ApplicationZygote::helperMain(int fd)
+{
+    prctl(PR_SET_NAME, "sysmgr-zygote");
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    // the environment every app is launched with (see ApplicationProcessManager)
+    setenv("XDG_RUNTIME_DIR", "/tmp/luna-session", 1);
+    setenv("QT_WAYLAND_DISABLE_WINDOWDECORATION", "1", 1);
+    setenv("QT_IM_MODULE", "Maliit", 1);
+    setenv("SDL_VIDEODRIVER", "wayland", 1);
+
+    if (pipe2(s_childSignalPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+        _exit(1);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = helperChildSignalHandler;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, 0);
+
+    pid_t helperPid = getpid();
+    static char request[ZYGOTE_MAX_REQUEST + 1];
+    char* argv[ZYGOTE_MAX_ARGS + 1];
+
+    while (true) {
+        struct pollfd pfds[2];
+        pfds[0].fd = fd;
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        pfds[1].fd = s_childSignalPipe[0];
+        pfds[1].events = POLLIN;
+        pfds[1].revents = 0;
+
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            _exit(1);
+        }
+
+        if (pfds[1].revents) {
+            char drain[64];
+            while (read(s_childSignalPipe[0], drain, sizeof(drain)) > 0)
+                ;
+
+            int status;
+            pid_t pid;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+                helperSendReply(fd, ReplyExited, 0, pid, status);
+        }
+
+        if (!pfds[0].revents)
+            continue;
+
+        ssize_t len = recv(fd, request, ZYGOTE_MAX_REQUEST, 0);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            _exit(0);		// sysmgr closed its end (or died)
+
+        if (len < (ssize_t)sizeof(quint32) + 1)
+            continue;
+
+        quint32 serial;
+        memcpy(&serial, request, sizeof(serial));
+        request[len] = '\0';
+
+        // path, then the parameters; argv[0] is the path as QProcess passes it
+        int argc = 0;
+        char* p = request + sizeof(serial);
+        char* end = request + len;
+        while (p < end && argc < ZYGOTE_MAX_ARGS) {
+            argv[argc++] = p;
+            p += strlen(p) + 1;
+        }
+        argv[argc] = 0;
+
+        helperSpawn(fd, helperPid, serial, argv[0], argv);
+    }
+}
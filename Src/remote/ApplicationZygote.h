@@ -0,0 +1,98 @@
+/* @@@LICENSE
+*
+* (c) 2013 Simon Busch <morphis@gravedo.de>
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+#ifndef APPLICATIONZYGOTE_H
+#define APPLICATIONZYGOTE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <sys/types.h>
+
+class QSocketNotifier;
+
+/*
+ * A helper process that forks and execs applications on behalf of sysmgr.
+ *
+ * start() forks the helper right at the beginning of main(), while sysmgr is still small and single
+ * threaded, and sets the launch environment (Wayland, Maliit) up in it once. Launching an app is then a
+ * request over a local socket: the helper forks its own, tiny, address space and execs the app with the
+ * prepared environment, instead of sysmgr copying its page tables and building the environment again for
+ * every launch.
+ *
+ * spawn() only waits for the helper to report the pid of the fork. Whether the exec went through and
+ * when the app exits arrive later as signals, from the main loop.
+ *
+ * Apps are children of the helper, not of sysmgr. They get SIGKILL when the helper goes away, and the
+ * helper exits when sysmgr closes its end of the socket, so apps still don't outlive sysmgr.
+ */
+class ApplicationZygote : public QObject
+{
+    Q_OBJECT
+public:
+    // forks the helper; call before any threads are started. false if it could not be started
+    static bool start();
+
+    // 0 unless start() succeeded
+    static ApplicationZygote* instance();
+
+    bool isRunning() const { return m_fd >= 0; }
+
+    // asks the helper to fork and exec path; the pid of the fork, or -1
+    qint64 spawn(const QString& path, const QStringList& parameters);
+
+Q_SIGNALS:
+    void processStarted(qint64 pid);
+    void processFailedToStart(qint64 pid, int error);
+    void processExited(qint64 pid, int status);
+
+    // the helper is gone, and with it every app it had started
+    void died();
+
+private Q_SLOTS:
+    void onReadable();
+    void dispatchPending();
+
+private:
+    struct Reply {
+        quint32 type;
+        quint32 serial;
+        qint32 pid;
+        qint32 value;
+    };
+
+    ApplicationZygote(int fd, pid_t helperPid);
+
+    bool readReply(Reply& r_reply, bool wait);
+    void dispatch(const Reply& reply);
+    void shutdown();
+
+    static void helperMain(int fd);
+
+    int m_fd;
+    pid_t m_helperPid;
+    quint32 m_serial;
+    QSocketNotifier* m_notifier;
+    QList<Reply> m_pending;    // replies that came in while spawn() was waiting for its own
+
+    static int s_fd;
+    static pid_t s_helperPid;
+};
+
+#endif // APPLICATIONZYGOTE_H
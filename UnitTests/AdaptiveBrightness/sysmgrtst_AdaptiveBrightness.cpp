@@ -0,0 +1,263 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include <QtTest/QtTest>
+
+#include <stdlib.h>
+
+#include "AdaptiveBrightness.h"
+#include "AlsRegionEstimator.h"
+
+// the scales the regions used to step between
+static const int kDarkScale = 20;
+static const int kDimScale = 50;
+static const int kOutdoorScale = 150;
+
+// how often the sensor reports at its fast rate, and how often DisplayManager steps a ramp
+static const uint32_t kSampleMs = 100;
+// how far a ramp moves in one of those at the default rate
+static const int kRampPerSample = AdaptiveBrightness::DefaultRampPerSecond * kSampleMs / 1000;
+
+// a light level held for a while
+struct TraceStep {
+	int32_t lux;
+	uint32_t durationMs;
+};
+
+// indoors, lights dimmed, into a dark room, out into daylight and back in: a region change each
+static const TraceStep kTrace[] = {
+	{ 300, 10000 },
+	{ 60, 10000 },
+	{ 1, 15000 },
+	{ 20000, 15000 },
+	{ 400, 10000 },
+};
+
+struct ReplayResult {
+	int readings;
+	int updates;		// backlight calls
+	int largestStep;	// the largest change of scale in one of them
+	int finalScale;
+};
+
+// each reading within +-5% of the trace, the same every run
+static int32_t noisy(int32_t lux, unsigned int& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	int percent = (int) ((seed >> 16) % 11) - 5;
+	return lux + lux * percent / 100;
+}
+
+// the brightness engine as DisplayManager drives it: a reading and a ramp step per tick
+static ReplayResult replayCurve(const TraceStep* trace, int steps)
+{
+	AdaptiveBrightness brightness;
+	brightness.setRegionScales(kDarkScale, kDimScale, kOutdoorScale);
+
+	ReplayResult result = { 0, 0, 0, brightness.scale() };
+	unsigned int seed = 1;
+	uint32_t now = 0;
+
+	for (int i = 0; i < steps; i++) {
+		for (uint32_t t = 0; t < trace[i].durationMs; t += kSampleMs, now += kSampleMs) {
+			brightness.addSample(noisy(trace[i].lux, seed), now);
+			result.readings++;
+			int before = brightness.scale();
+			if (brightness.step(now)) {
+				result.updates++;
+				result.largestStep = qMax(result.largestStep, abs(brightness.scale() - before));
+			}
+		}
+	}
+
+	result.finalScale = brightness.scale();
+	return result;
+}
+
+// the regions as they were: a backlight call with every region change
+static ReplayResult replayRegions(const TraceStep* trace, int steps)
+{
+	static const int scales[] = { 100, kDarkScale, kDimScale, 100, kOutdoorScale };
+
+	AlsRegionEstimator estimator;
+	ReplayResult result = { 0, 0, 0, 100 };
+	unsigned int seed = 1;
+
+	for (int i = 0; i < steps; i++) {
+		for (uint32_t t = 0; t < trace[i].durationMs; t += kSampleMs) {
+			result.readings++;
+			if (estimator.addSample(noisy(trace[i].lux, seed))) {
+				int scale = scales[estimator.region()];
+				result.updates++;
+				result.largestStep = qMax(result.largestStep, abs(scale - result.finalScale));
+				result.finalScale = scale;
+			}
+		}
+	}
+
+	return result;
+}
+
+class AdaptiveBrightnessTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testCurve();
+	void testSetCurve();
+	void testThreshold();
+	void testRamp();
+	void testSettle();
+	void testReplay();
+	void benchReplay();
+};
+
+void AdaptiveBrightnessTest::testCurve()
+{
+	AdaptiveBrightness brightness;
+	QCOMPARE(brightness.curveScale(0), 100);
+	QCOMPARE(brightness.curveScale(100000), 100);
+
+	brightness.setRegionScales(kDarkScale, kDimScale, kOutdoorScale);
+	QCOMPARE(brightness.curveScale(0), kDarkScale);
+	QCOMPARE(brightness.curveScale(6), kDarkScale);
+	QCOMPARE(brightness.curveScale(50), kDimScale);
+	QCOMPARE(brightness.curveScale(75), (kDimScale + 100) / 2);
+	QCOMPARE(brightness.curveScale(500), 100);
+	QCOMPARE(brightness.curveScale(3000), (100 + kOutdoorScale) / 2);
+	QCOMPARE(brightness.curveScale(100000), kOutdoorScale);
+
+	// no steps along it
+	for (int32_t lux = 1; lux < 10000; lux++)
+		QVERIFY(abs(brightness.curveScale(lux) - brightness.curveScale(lux - 1)) <= 1);
+}
+
+void AdaptiveBrightnessTest::testSetCurve()
+{
+	AdaptiveBrightness brightness;
+	const AdaptiveBrightness::Point unordered[] = { { 0, 10 }, { 100, 50 }, { 100, 80 } };
+	QVERIFY(!brightness.setCurve(unordered, 3));
+	QVERIFY(!brightness.setCurve(unordered, 0));
+	QCOMPARE(brightness.curveScale(100), 100);
+
+	const AdaptiveBrightness::Point points[] = { { 10, 10 }, { 110, 60 } };
+	QVERIFY(brightness.setCurve(points, 2));
+	QCOMPARE(brightness.curveScale(0), 10);
+	QCOMPARE(brightness.curveScale(60), 35);
+	QCOMPARE(brightness.curveScale(200), 60);
+}
+
+void AdaptiveBrightnessTest::testThreshold()
+{
+	AdaptiveBrightness brightness;
+	brightness.setRegionScales(kDarkScale, kDimScale, kOutdoorScale);
+
+	// flickering across the dim/indoor border, by less than a noticeable step
+	QVERIFY(!brightness.addSample(100, 0));
+	for (uint32_t now = 0; now < 10000; now += kSampleMs) {
+		brightness.addSample(now % 200 ? 96 : 110, now);
+		QVERIFY(!brightness.step(now));
+	}
+	QCOMPARE(brightness.scale(), 100);
+	QCOMPARE(brightness.changes(), (uint32_t) 0);
+}
+
+void AdaptiveBrightnessTest::testRamp()
+{
+	AdaptiveBrightness brightness;
+	brightness.setRegionScales(kDarkScale, kDimScale, kOutdoorScale);
+	brightness.setSmoothing(100);
+
+	// 100 to 20 at 40 a second
+	QVERIFY(brightness.addSample(0, 0));
+	QCOMPARE(brightness.target(), kDarkScale);
+	QVERIFY(brightness.ramping());
+
+	// down in a few steps of about a quarter of the way each, never back up
+	const int stepSize = (100 - kDarkScale) / AdaptiveBrightness::RampSteps;
+	uint32_t now = kSampleMs;
+	for (; brightness.ramping(); now += kSampleMs) {
+		int before = brightness.scale();
+		if (brightness.step(now)) {
+			QVERIFY(brightness.scale() < before);
+			QVERIFY(before - brightness.scale() <= stepSize + kRampPerSample);
+		}
+		else {
+			QCOMPARE(brightness.scale(), before);
+		}
+	}
+
+	// at the end of the ramp
+	now -= kSampleMs;
+	QVERIFY(now >= 2000 - kSampleMs && now <= 2000 + kSampleMs);
+	QCOMPARE(brightness.scale(), kDarkScale);
+	QCOMPARE(brightness.changes(), (uint32_t) AdaptiveBrightness::RampSteps);
+	QVERIFY(!brightness.step(5000));
+}
+
+void AdaptiveBrightnessTest::testSettle()
+{
+	AdaptiveBrightness brightness;
+	brightness.setRegionScales(kDarkScale, kDimScale, kOutdoorScale);
+
+	QVERIFY(brightness.addSample(20000, 0));
+	QVERIFY(brightness.settle());
+	QCOMPARE(brightness.scale(), kOutdoorScale);
+	QVERIFY(!brightness.ramping());
+	QVERIFY(!brightness.settle());
+
+	// after a restart the next reading counts in full
+	brightness.restart();
+	QCOMPARE(brightness.scale(), kOutdoorScale);
+	brightness.addSample(300, 0);
+	QCOMPARE(brightness.smoothedLux(), 300);
+	QCOMPARE(brightness.target(), 100);
+}
+
+void AdaptiveBrightnessTest::testReplay()
+{
+	const int steps = sizeof(kTrace) / sizeof(kTrace[0]);
+	ReplayResult regions = replayRegions(kTrace, steps);
+	ReplayResult curve = replayCurve(kTrace, steps);
+
+	// the same light ends at the same brightness
+	QCOMPARE(curve.finalScale, regions.finalScale);
+
+	// each jump of the regions becomes a ramp of a few steps: no more calls than that, and each step a
+	// share of the largest jump
+	QVERIFY(regions.updates > 0);
+	QVERIFY(curve.updates <= regions.updates * AdaptiveBrightness::RampSteps);
+	QVERIFY(curve.largestStep <= (regions.largestStep + AdaptiveBrightness::RampSteps - 1)
+								 / AdaptiveBrightness::RampSteps + kRampPerSample);
+	QVERIFY(curve.updates < curve.readings / 10);
+}
+
+void AdaptiveBrightnessTest::benchReplay()
+{
+	QBENCHMARK {
+		replayCurve(kTrace, sizeof(kTrace) / sizeof(kTrace[0]));
+	}
+}
+
+QTEST_MAIN(AdaptiveBrightnessTest)
+
+#include "sysmgrtst_AdaptiveBrightness.moc"
@@ -0,0 +1,207 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include <QtTest/QtTest>
+
+#include <new>
+#include <stdlib.h>
+
+#include "AlsRegionEstimator.h"
+
+// every allocation in the test binary, so the sample path can be shown not to make any
+static unsigned long s_allocations = 0;
+
+#if __cplusplus >= 201103L
+void* operator new(size_t size)
+#else
+void* operator new(size_t size) throw(std::bad_alloc)
+#endif
+{
+	s_allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		abort();
+	return p;
+}
+
+void operator delete(void* p) throw()
+{
+	free(p);
+}
+
+// a lux reading held for a number of samples, and the region expected after the last of them
+struct TraceStep {
+	int32_t lux;
+	int samples;
+	int region;
+};
+
+// indoors, into a dark room, out into daylight and back in
+static const TraceStep kTrace[] = {
+	{ 300, 10, ALS_REGION_INDOOR },
+	{ 1, 4, ALS_REGION_INDOOR },		// not enough of the window yet
+	{ 1, 10, ALS_REGION_DARK },
+	{ 9, 10, ALS_REGION_DARK },			// within the margin above DARK
+	{ 40, 10, ALS_REGION_DIM },
+	{ 105, 10, ALS_REGION_DIM },		// within the margin above DIM
+	{ 20000, 10, ALS_REGION_OUTDOOR },	// across INDOOR in one step
+	{ 950, 10, ALS_REGION_OUTDOOR },	// within the margin below OUTDOOR
+	{ 500, 10, ALS_REGION_INDOOR },
+	{ 0, 10, ALS_REGION_DARK },
+};
+
+static int replay(AlsRegionEstimator& estimator, const TraceStep* trace, int steps)
+{
+	int changes = 0;
+	for (int i = 0; i < steps; i++) {
+		for (int n = 0; n < trace[i].samples; n++) {
+			if (estimator.addSample(trace[i].lux))
+				changes++;
+		}
+	}
+	return changes;
+}
+
+class AlsRegionEstimatorTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testWindowFill();
+	void testTrace();
+	void testMinMax();
+	void testReset();
+	void testNoAllocations();
+	void benchAddSample();
+};
+
+void AlsRegionEstimatorTest::testWindowFill()
+{
+	AlsRegionEstimator estimator;
+	QCOMPARE(estimator.region(), ALS_REGION_INDOOR);
+	QCOMPARE(estimator.count(), 0);
+	QCOMPARE(estimator.average(), 0);
+
+	// the region holds until the window is full
+	for (int i = 0; i < ALS_SAMPLE_SIZE - 1; i++) {
+		QVERIFY(!estimator.addSample(1));
+		QCOMPARE(estimator.region(), ALS_REGION_INDOOR);
+	}
+	QVERIFY(!estimator.full());
+
+	QVERIFY(estimator.addSample(1));
+	QVERIFY(estimator.full());
+	QCOMPARE(estimator.count(), ALS_SAMPLE_SIZE);
+	QCOMPARE(estimator.region(), ALS_REGION_DARK);
+
+	// and the window never grows past its size
+	estimator.addSample(1);
+	QCOMPARE(estimator.count(), ALS_SAMPLE_SIZE);
+}
+
+void AlsRegionEstimatorTest::testTrace()
+{
+	AlsRegionEstimator estimator;
+	for (unsigned int i = 0; i < sizeof(kTrace) / sizeof(kTrace[0]); i++) {
+		replay(estimator, &kTrace[i], 1);
+		QCOMPARE(estimator.region(), kTrace[i].region);
+		QCOMPARE(estimator.last(), kTrace[i].lux);
+	}
+
+	// as the window slides, the average passes through DIM on the way into and out of the dark room, but
+	// jumps straight from DIM to OUTDOOR; nothing changes while the samples stay within a margin
+	estimator.reset();
+	QCOMPARE(replay(estimator, kTrace, sizeof(kTrace) / sizeof(kTrace[0])), 7);
+}
+
+void AlsRegionEstimatorTest::testMinMax()
+{
+	AlsRegionEstimator estimator;
+	for (int lux = 1; lux <= ALS_SAMPLE_SIZE; lux++)
+		estimator.addSample(lux);
+
+	QCOMPARE(estimator.minimum(), 1);
+	QCOMPARE(estimator.maximum(), ALS_SAMPLE_SIZE);
+	QCOMPARE(estimator.average(), (1 + ALS_SAMPLE_SIZE) * ALS_SAMPLE_SIZE / 2 / ALS_SAMPLE_SIZE);
+
+	// the minimum leaves the window
+	estimator.addSample(5);
+	QCOMPARE(estimator.minimum(), 2);
+	QCOMPARE(estimator.maximum(), ALS_SAMPLE_SIZE);
+
+	// a new maximum, which stays for a window
+	estimator.addSample(1000);
+	QCOMPARE(estimator.maximum(), 1000);
+	for (int i = 0; i < ALS_SAMPLE_SIZE - 1; i++)
+		estimator.addSample(7);
+	QCOMPARE(estimator.maximum(), 1000);
+	QCOMPARE(estimator.minimum(), 7);
+
+	estimator.addSample(7);
+	QCOMPARE(estimator.maximum(), 7);
+	QCOMPARE(estimator.average(), 7);
+}
+
+void AlsRegionEstimatorTest::testReset()
+{
+	AlsRegionEstimator estimator;
+	replay(estimator, kTrace, 3);
+	QCOMPARE(estimator.region(), ALS_REGION_DARK);
+
+	estimator.reset(ALS_REGION_OUTDOOR);
+	QCOMPARE(estimator.region(), ALS_REGION_OUTDOOR);
+	QCOMPARE(estimator.count(), 0);
+	QCOMPARE(estimator.minimum(), 0);
+	QCOMPARE(estimator.maximum(), 0);
+
+	QVERIFY(estimator.inRegion(950));
+	QVERIFY(!estimator.inRegion(850));
+
+	// undefined has no borders; the first sample starts it over from INDOOR
+	estimator.reset(ALS_REGION_UNDEFINED);
+	QVERIFY(estimator.addSample(300));
+	QCOMPARE(estimator.region(), ALS_REGION_INDOOR);
+}
+
+void AlsRegionEstimatorTest::testNoAllocations()
+{
+	AlsRegionEstimator estimator;
+	replay(estimator, kTrace, 1);
+
+	// once the window is full, a reading (region changes included) costs no heap at all
+	unsigned long before = s_allocations;
+	int changes = replay(estimator, kTrace, sizeof(kTrace) / sizeof(kTrace[0]));
+	QCOMPARE(s_allocations, before);
+	QVERIFY(changes > 0);
+}
+
+void AlsRegionEstimatorTest::benchAddSample()
+{
+	AlsRegionEstimator estimator;
+	QBENCHMARK {
+		replay(estimator, kTrace, sizeof(kTrace) / sizeof(kTrace[0]));
+	}
+}
+
+QTEST_MAIN(AlsRegionEstimatorTest)
+
+#include "sysmgrtst_AlsRegionEstimator.moc"
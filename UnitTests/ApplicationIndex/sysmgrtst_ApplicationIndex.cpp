@@ -0,0 +1,332 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <vector>
+#include <string>
+#include <set>
+
+#include <glib.h>
+#include <cjson/json.h>
+
+#include "ApplicationIndex.h"
+#include "ApplicationDescription.h"
+#include "ApplicationStatus.h"
+#include "LaunchPoint.h"
+#include "LaunchPointSearchIndex.h"
+
+// -------------------------------------------------------------------------
+
+static std::string syntheticAppId(int i)
+{
+	gchar* id = g_strdup_printf("com.example.synthetic.app%05d", i);
+	std::string r(id);
+	g_free(id);
+	return r;
+}
+
+// a few words recombined, so that search terms hit a realistic share of the titles
+static std::string syntheticTitle(int i)
+{
+	static const char* words[] = { "Mail", "Music", "Maps", "Memo", "Photos", "Phone", "Player", "Calendar",
+								   "Calculator", "Camera", "Clock", "Contacts", "Browser", "Books", "News", "Notes" };
+	static const int numWords = sizeof(words) / sizeof(words[0]);
+
+	gchar* title = g_strdup_printf("%s %s-%d", words[i % numWords], words[(i / numWords) % numWords], i);
+	std::string r(title);
+	g_free(title);
+	return r;
+}
+
+static ApplicationDescription* makeSyntheticApp(int i)
+{
+	json_object* status = json_object_new_object();
+	json_object* details = json_object_new_object();
+	json_object_object_add(status, "id", json_object_new_string(syntheticAppId(i).c_str()));
+	json_object_object_add(details, "title", json_object_new_string(syntheticTitle(i).c_str()));
+	json_object_object_add(details, "version", json_object_new_string("1.0.0"));
+	json_object_object_add(status, "details", details);
+
+	ApplicationStatus appStatus(status);
+	ApplicationDescription* appDesc = ApplicationDescription::fromApplicationStatus(appStatus, false);
+
+	json_object_put(status);
+	return appDesc;
+}
+
+// the pre-index lookup, kept here as the baseline
+static ApplicationDescription* linearGetAppById(const std::vector<ApplicationDescription*>& apps, const std::string& appId)
+{
+	for (std::vector<ApplicationDescription*>::const_iterator it = apps.begin(); it != apps.end(); ++it) {
+		if ((*it)->id() == appId)
+			return *it;
+	}
+	return 0;
+}
+
+static const LaunchPoint* linearGetLaunchPointById(const std::vector<ApplicationDescription*>& apps, const std::string& lpId)
+{
+	for (std::vector<ApplicationDescription*>::const_iterator it = apps.begin(); it != apps.end(); ++it) {
+		for (LaunchPointList::const_iterator iter = (*it)->launchPoints().begin();
+				iter != (*it)->launchPoints().end(); ++iter) {
+			if (lpId == (*iter)->launchPointId())
+				return *iter;
+		}
+	}
+	return 0;
+}
+
+// the pre-index search, kept here as the baseline (titles only; the synthetic apps have no keywords)
+static void linearSearchByTitle(const std::vector<ApplicationDescription*>& apps, const std::string& lcTerm,
+								std::set<const LaunchPoint*>& r_matched)
+{
+	r_matched.clear();
+	for (std::vector<ApplicationDescription*>::const_iterator it = apps.begin(); it != apps.end(); ++it) {
+		for (LaunchPointList::const_iterator iter = (*it)->launchPoints().begin();
+				iter != (*it)->launchPoints().end(); ++iter) {
+			if ((*iter)->matchesTitle(lcTerm.c_str()))
+				r_matched.insert(*iter);
+		}
+	}
+}
+
+static void indexedSearchByTitle(const LaunchPointSearchIndex* search, const std::string& lcTerm,
+								 std::set<const LaunchPoint*>& r_matched)
+{
+	std::vector<const LaunchPoint*> byTitle;
+	std::vector<const LaunchPoint*> byKeyword;
+	search->search(lcTerm, true, byTitle, byKeyword);
+	r_matched.clear();
+	r_matched.insert(byTitle.begin(), byTitle.end());
+}
+
+// -------------------------------------------------------------------------
+
+class ApplicationIndexTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	void populate(int count);
+	void release();
+
+	std::vector<ApplicationDescription*> m_apps;
+	std::vector<std::string> m_probeIds;
+	ApplicationIndex m_index;
+
+private Q_SLOTS:
+
+	void testConsistency();
+	void testSearchConsistency();
+
+	void benchLinearLookup_data();
+	void benchLinearLookup();
+	void benchIndexedLookup_data();
+	void benchIndexedLookup();
+	void benchLinearSearch_data();
+	void benchLinearSearch();
+	void benchIndexedSearch_data();
+	void benchIndexedSearch();
+};
+
+void ApplicationIndexTest::populate(int count)
+{
+	release();
+	m_index.enableSearch();
+
+	for (int i = 0; i < count; i++) {
+		ApplicationDescription* appDesc = makeSyntheticApp(i);
+		m_apps.push_back(appDesc);
+		m_index.insertApp(appDesc);
+	}
+
+	// probe a spread of ids, including some misses, so the linear scan pays its average cost
+	for (int i = 0; i < 64; i++)
+		m_probeIds.push_back(syntheticAppId((i * 7919) % (count + count / 8)));
+}
+
+void ApplicationIndexTest::release()
+{
+	m_index.clear();
+	for (unsigned int i = 0; i < m_apps.size(); i++)
+		delete m_apps[i];
+	m_apps.clear();
+	m_probeIds.clear();
+}
+
+void ApplicationIndexTest::testConsistency()
+{
+	populate(100);
+
+	QCOMPARE(m_index.appCount(), 100u);
+	QCOMPARE(m_index.launchPointCount(), 100u);
+
+	for (unsigned int i = 0; i < m_probeIds.size(); i++) {
+		QCOMPARE(m_index.appById(m_probeIds[i]), linearGetAppById(m_apps, m_probeIds[i]));
+		QCOMPARE(m_index.launchPointById(m_probeIds[i] + "_default"),
+				 linearGetLaunchPointById(m_apps, m_probeIds[i] + "_default"));
+	}
+
+	// removal drops the app and its launch points
+	ApplicationDescription* victim = m_apps[42];
+	m_index.removeApp(victim);
+	QVERIFY(m_index.appById(victim->id()) == 0);
+	QVERIFY(m_index.launchPointById(victim->id() + "_default") == 0);
+	QCOMPARE(m_index.appCount(), 99u);
+
+	// a duplicate id must not evict the original, and a stale removal must not evict the live one
+	ApplicationDescription* dup = makeSyntheticApp(7);
+	m_index.insertApp(dup);
+	QVERIFY(m_index.appById(dup->id()) == m_apps[7]);
+	m_index.removeApp(dup);
+	QVERIFY(m_index.appById(dup->id()) == m_apps[7]);
+	delete dup;
+
+	release();
+}
+
+void ApplicationIndexTest::testSearchConsistency()
+{
+	populate(500);
+
+	const LaunchPointSearchIndex* search = m_index.search();
+	QVERIFY(search != 0);
+	QCOMPARE(search->size(), 500u);
+
+	// typing one character at a time (narrowed from the previous result), then unrelated terms
+	const char* terms[] = { "c", "ca", "cal", "calc", "calcu", "p", "ph", "pho", "phot", "photos",
+							"-1", "-12", "books-4", "mail m", "x", "music" };
+	std::set<const LaunchPoint*> linear;
+	std::set<const LaunchPoint*> indexed;
+	for (unsigned int i = 0; i < sizeof(terms) / sizeof(terms[0]); i++) {
+		linearSearchByTitle(m_apps, terms[i], linear);
+		indexedSearchByTitle(search, terms[i], indexed);
+		QVERIFY2(linear == indexed, terms[i]);
+	}
+	QVERIFY(search->narrowedSearches() > 0);
+
+	// a removal in between must not be answered from the remembered result
+	indexedSearchByTitle(search, "cam", indexed);
+	QVERIFY(!indexed.empty());
+	ApplicationDescription* victim = (*indexed.begin())->appDesc();
+	QVERIFY(victim != 0);
+	m_index.removeApp(victim);
+	indexedSearchByTitle(search, "came", indexed);
+	QVERIFY(indexed.find(victim->getDefaultLaunchPoint()) == indexed.end());
+
+	// and a title changed in place is found under the new one once the app is refreshed
+	const_cast<LaunchPoint*>(m_apps[3]->getDefaultLaunchPoint())->updateTitle("Zebra Crossing");
+	m_index.refreshApp(m_apps[3]);
+	indexedSearchByTitle(search, "cross", indexed);
+	QCOMPARE(indexed.size(), (size_t)1);
+	QVERIFY(*indexed.begin() == m_apps[3]->getDefaultLaunchPoint());
+
+	release();
+}
+
+void ApplicationIndexTest::benchLinearLookup_data()
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("100") << 100;
+	QTest::newRow("1k") << 1000;
+	QTest::newRow("10k") << 10000;
+}
+
+void ApplicationIndexTest::benchLinearLookup()
+{
+	QFETCH(int, count);
+	populate(count);
+
+	QBENCHMARK {
+		for (unsigned int i = 0; i < m_probeIds.size(); i++) {
+			linearGetAppById(m_apps, m_probeIds[i]);
+			linearGetLaunchPointById(m_apps, m_probeIds[i] + "_default");
+		}
+	}
+
+	release();
+}
+
+void ApplicationIndexTest::benchIndexedLookup_data()
+{
+	benchLinearLookup_data();
+}
+
+void ApplicationIndexTest::benchIndexedLookup()
+{
+	QFETCH(int, count);
+	populate(count);
+
+	QBENCHMARK {
+		for (unsigned int i = 0; i < m_probeIds.size(); i++) {
+			m_index.appById(m_probeIds[i]);
+			m_index.launchPointById(m_probeIds[i] + "_default");
+		}
+	}
+
+	release();
+}
+
+void ApplicationIndexTest::benchLinearSearch_data()
+{
+	benchLinearLookup_data();
+}
+
+void ApplicationIndexTest::benchLinearSearch()
+{
+	QFETCH(int, count);
+	populate(count);
+
+	std::set<const LaunchPoint*> matched;
+	QBENCHMARK {
+		linearSearchByTitle(m_apps, "c", matched);
+		linearSearchByTitle(m_apps, "ca", matched);
+		linearSearchByTitle(m_apps, "cam", matched);
+		linearSearchByTitle(m_apps, "came", matched);
+	}
+
+	release();
+}
+
+void ApplicationIndexTest::benchIndexedSearch_data()
+{
+	benchLinearLookup_data();
+}
+
+void ApplicationIndexTest::benchIndexedSearch()
+{
+	QFETCH(int, count);
+	populate(count);
+
+	std::set<const LaunchPoint*> matched;
+	QBENCHMARK {
+		indexedSearchByTitle(m_index.search(), "c", matched);
+		indexedSearchByTitle(m_index.search(), "ca", matched);
+		indexedSearchByTitle(m_index.search(), "cam", matched);
+		indexedSearchByTitle(m_index.search(), "came", matched);
+	}
+
+	release();
+}
+
+QTEST_MAIN(ApplicationIndexTest)
+#include "sysmgrtst_ApplicationIndex.moc"
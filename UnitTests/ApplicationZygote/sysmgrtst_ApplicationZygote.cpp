@@ -0,0 +1,183 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+#include <QProcess>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "ApplicationZygote.h"
+
+#define TRUE_PATH	"/bin/true"
+
+// -------------------------------------------------------------------------
+
+class ApplicationZygoteTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	// makes this process about as big as sysmgr, which is what a plain fork has to copy the page tables of
+	void grow(int megabytes);
+
+	QByteArray m_ballast;
+
+private Q_SLOTS:
+
+	void initTestCase();
+
+	void testSpawnStartsAndExits();
+	void testExecFailureReported();
+	void testRelativePathRefused();
+
+	void benchQProcessLaunch_data();
+	void benchQProcessLaunch();
+	void benchZygoteLaunch_data();
+	void benchZygoteLaunch();
+};
+
+void ApplicationZygoteTest::grow(int megabytes)
+{
+	m_ballast.fill('x', megabytes * 1024 * 1024);
+}
+
+void ApplicationZygoteTest::initTestCase()
+{
+	QVERIFY(ApplicationZygote::instance() != 0);
+	QVERIFY(ApplicationZygote::instance()->isRunning());
+}
+
+void ApplicationZygoteTest::testSpawnStartsAndExits()
+{
+	ApplicationZygote* zygote = ApplicationZygote::instance();
+	QSignalSpy started(zygote, SIGNAL(processStarted(qint64)));
+	QSignalSpy exited(zygote, SIGNAL(processExited(qint64,int)));
+
+	qint64 pid = zygote->spawn(TRUE_PATH, QStringList());
+	QVERIFY(pid > 0);
+
+	for (int i = 0; i < 100 && exited.count() == 0; i++)
+		QTest::qWait(50);
+
+	QCOMPARE(started.count(), 1);
+	QCOMPARE(started.at(0).at(0).toLongLong(), pid);
+	QCOMPARE(exited.count(), 1);
+	QCOMPARE(exited.at(0).at(0).toLongLong(), pid);
+
+	int status = exited.at(0).at(1).toInt();
+	QVERIFY(WIFEXITED(status));
+	QCOMPARE(WEXITSTATUS(status), 0);
+}
+
+void ApplicationZygoteTest::testExecFailureReported()
+{
+	ApplicationZygote* zygote = ApplicationZygote::instance();
+	QSignalSpy started(zygote, SIGNAL(processStarted(qint64)));
+	QSignalSpy failed(zygote, SIGNAL(processFailedToStart(qint64,int)));
+
+	// the fork works, the exec doesn't
+	qint64 pid = zygote->spawn("/nonexistent/sysmgrtst-app", QStringList() << "-p" << "{}");
+	QVERIFY(pid > 0);
+
+	for (int i = 0; i < 100 && failed.count() == 0; i++)
+		QTest::qWait(50);
+
+	QCOMPARE(failed.count(), 1);
+	QCOMPARE(failed.at(0).at(0).toLongLong(), pid);
+	QCOMPARE(failed.at(0).at(1).toInt(), ENOENT);
+	QCOMPARE(started.count(), 0);
+	QVERIFY(zygote->isRunning());
+}
+
+void ApplicationZygoteTest::testRelativePathRefused()
+{
+	// no PATH search in the helper; ApplicationProcessManager hands these to QProcess
+	QCOMPARE(ApplicationZygote::instance()->spawn("true", QStringList()), (qint64)-1);
+	QVERIFY(ApplicationZygote::instance()->isRunning());
+}
+
+void ApplicationZygoteTest::benchQProcessLaunch_data()
+{
+	QTest::addColumn<int>("megabytes");
+	QTest::newRow("small") << 0;
+	QTest::newRow("64M") << 64;
+	QTest::newRow("256M") << 256;
+}
+
+// launch to pid, as ApplicationProcessManager::launchProcess() sees it
+void ApplicationZygoteTest::benchQProcessLaunch()
+{
+	QFETCH(int, megabytes);
+	grow(megabytes);
+
+	QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+	QList<QProcess*> processes;
+
+	QBENCHMARK {
+		QProcess* process = new QProcess;
+		process->setProcessEnvironment(environment);
+		process->start(TRUE_PATH, QStringList());
+		QVERIFY(process->pid() > 0);
+		processes.append(process);
+	}
+
+	Q_FOREACH(QProcess* process, processes) {
+		process->waitForFinished();
+		delete process;
+	}
+	grow(0);
+}
+
+void ApplicationZygoteTest::benchZygoteLaunch_data()
+{
+	benchQProcessLaunch_data();
+}
+
+void ApplicationZygoteTest::benchZygoteLaunch()
+{
+	QFETCH(int, megabytes);
+	grow(megabytes);
+
+	ApplicationZygote* zygote = ApplicationZygote::instance();
+
+	QBENCHMARK {
+		QVERIFY(zygote->spawn(TRUE_PATH, QStringList()) > 0);
+	}
+
+	// let the start/exit reports drain
+	QTest::qWait(100);
+	grow(0);
+}
+
+// the helper has to be forked before Qt starts any threads, as sysmgr's main() does
+int main(int argc, char** argv)
+{
+	if (!ApplicationZygote::start())
+		return 1;
+
+	QCoreApplication app(argc, argv);
+	ApplicationZygoteTest test;
+	return QTest::qExec(&test, argc, argv);
+}
+
+#include "sysmgrtst_ApplicationZygote.moc"
@@ -0,0 +1,371 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include <QtTest/QtTest>
+
+#include "DisplayTransitions.h"
+
+static const uint32_t kCall = DisplayGuardOnCall;
+static const uint32_t kPuck = DisplayGuardOnPuck;
+static const uint32_t kUnlocked = DisplayGuardUnlocked;
+static const uint32_t kBacklight = DisplayGuardBacklightOn;
+static const uint32_t kAllGuards = kCall | kPuck | kUnlocked | kBacklight;
+
+// DisplayOff::handleEvent() as it was written out before the table: the state it moved to, Off if none
+static DisplayState offBefore(DisplayEvent event, uint32_t guards)
+{
+	bool call = guards & kCall, puck = guards & kPuck, unlocked = guards & kUnlocked;
+
+	switch (event) {
+	case DisplayEventPowerKeyPress:
+		if (guards & kBacklight)
+			return DisplayStateOff;
+		// fall through
+	case DisplayEventHomeKeyPress:
+		if (puck)
+			return (unlocked || call) ? DisplayStateOnPuck : DisplayStateDockMode;
+		return (unlocked || call) ? DisplayStateOn : DisplayStateOnLocked;
+	case DisplayEventPowerKeyHold:
+	case DisplayEventIncomingCall:
+	case DisplayEventOnCall:
+	case DisplayEventUserActivity:
+		if (puck)
+			return DisplayStateOnPuck;
+		return unlocked ? DisplayStateOn : DisplayStateOnLocked;
+	case DisplayEventOnPuck:
+		return (call || unlocked) ? DisplayStateOnPuck : DisplayStateDockMode;
+	case DisplayEventUsbIn:
+	case DisplayEventSliderOpen:
+	case DisplayEventUserActivityExternalInput:
+		return puck ? DisplayStateOnPuck : DisplayStateOn;
+	case DisplayEventApiOn:
+		if (puck)
+			return call ? DisplayStateOnPuck : DisplayStateDockMode;
+		return unlocked ? DisplayStateOn : DisplayStateOnLocked;
+	case DisplayEventPowerdSuspend:
+		return DisplayStateOffSuspended;
+	case DisplayEventApiDock:
+		return call ? DisplayStateOff : DisplayStateDockMode;
+	default:
+		return DisplayStateOff;
+	}
+}
+
+// DisplayOn::handleEvent() as it was written out before the table: the state it moved to, On if none
+static DisplayState onBefore(DisplayEvent event, uint32_t guards)
+{
+	bool call = guards & kCall, puck = guards & kPuck;
+
+	switch (event) {
+	case DisplayEventPowerKeyPress:
+		if (!(guards & kBacklight))
+			return DisplayStateOn;
+		// fall through
+	case DisplayEventApiOff:
+		if (call)
+			return DisplayStateOffOnCall;
+		return puck ? DisplayStateDockMode : DisplayStateOff;
+	case DisplayEventOnPuck:
+		return DisplayStateOnPuck;
+	case DisplayEventProximityOn:
+		return DisplayStateOffOnCall;
+	case DisplayEventApiDim:
+		return DisplayStateDim;
+	case DisplayEventLockScreen:
+		return (puck && !call) ? DisplayStateDockMode : DisplayStateOnLocked;
+	case DisplayEventApiDock:
+		return call ? DisplayStateOn : DisplayStateDockMode;
+	default:
+		return DisplayStateOn;
+	}
+}
+
+// DisplayOnLocked::handleEvent() as it was written out before the table: the state it moved to, OnLocked if none
+static DisplayState onLockedBefore(DisplayEvent event, uint32_t guards)
+{
+	bool call = guards & kCall;
+
+	switch (event) {
+	case DisplayEventPowerKeyPress:
+		if (!(guards & kBacklight))
+			return DisplayStateOnLocked;
+		// fall through
+	case DisplayEventApiOff:
+		return call ? DisplayStateOffOnCall : DisplayStateOff;
+	case DisplayEventOnPuck:
+		return DisplayStateOnPuck;
+	case DisplayEventUsbIn:
+	case DisplayEventSliderOpen:
+	case DisplayEventUserActivityExternalInput:
+	case DisplayEventUnlockScreen:
+		return DisplayStateOn;
+	case DisplayEventProximityOn:
+		return DisplayStateOffOnCall;
+	case DisplayEventApiDock:
+		return call ? DisplayStateOnLocked : DisplayStateDockMode;
+	default:
+		return DisplayStateOnLocked;
+	}
+}
+
+// DisplayDim::handleEvent() as it was written out before the table: the state it moved to, Dim if none
+static DisplayState dimBefore(DisplayEvent event, uint32_t guards)
+{
+	bool call = guards & kCall, puck = guards & kPuck;
+
+	switch (event) {
+	case DisplayEventPowerKeyPress:
+	case DisplayEventSliderClose:
+	case DisplayEventApiOff:
+		if (call)
+			return DisplayStateOffOnCall;
+		return puck ? DisplayStateDockMode : DisplayStateOff;
+	case DisplayEventPowerKeyHold:
+	case DisplayEventUsbIn:
+	case DisplayEventIncomingCall:
+	case DisplayEventApiOn:
+	case DisplayEventHomeKeyPress:
+	case DisplayEventUserActivity:
+	case DisplayEventUserActivityExternalInput:
+		return puck ? DisplayStateOnPuck : DisplayStateOn;
+	case DisplayEventOnPuck:
+		return DisplayStateOnPuck;
+	case DisplayEventOffPuck:
+		return DisplayStateOn;
+	case DisplayEventProximityOn:
+		return call ? DisplayStateOffOnCall : DisplayStateDim;
+	case DisplayEventLockScreen:
+		return DisplayStateOnLocked;
+	case DisplayEventApiDock:
+		return call ? DisplayStateDim : DisplayStateDockMode;
+	default:
+		return DisplayStateDim;
+	}
+}
+
+typedef DisplayState (*SwitchBefore)(DisplayEvent event, uint32_t guards);
+
+// every event under every combination of guards moves state where its old switch did
+static void compareWithSwitch(DisplayState state, SwitchBefore before)
+{
+	for (int e = 0; e < DisplayEventMax; e++) {
+		DisplayEvent event = static_cast<DisplayEvent>(e);
+		for (uint32_t guards = 0; guards <= kAllGuards; guards++) {
+			DisplayState to = state;
+			DisplayTransitions::lookup(state, event, guards, to);
+
+			if (to != before(event, guards))
+				qWarning("%s in %s with guards 0x%x", DisplayTransitions::eventName(event),
+						 DisplayTransitions::stateName(state), guards);
+			QCOMPARE(to, before(event, guards));
+		}
+	}
+}
+
+// a state change as /control/transitions reports it
+struct RecordedTransition {
+	DisplayEvent event;
+	DisplayState from;
+	DisplayState to;
+	uint32_t guards;
+};
+
+// off the puck and locked, a power key press; then onto the puck, docked; off it, and an incoming call
+// that is let ring out before the display is turned off
+static const RecordedTransition kRecorded[] = {
+	{ DisplayEventPowerKeyPress, DisplayStateOff, DisplayStateOnLocked, 0 },
+	{ DisplayEventTimeout, DisplayStateOnLocked, DisplayStateOff, kBacklight },
+	{ DisplayEventOnPuck, DisplayStateOff, DisplayStateDockMode, kPuck },
+	{ DisplayEventOffPuck, DisplayStateDockMode, DisplayStateOn, 0 },
+	{ DisplayEventTimeout, DisplayStateOn, DisplayStateOff, kBacklight },
+	{ DisplayEventIncomingCall, DisplayStateOff, DisplayStateOnLocked, kCall },
+	{ DisplayEventApiOff, DisplayStateOnLocked, DisplayStateOff, kBacklight },
+	{ DisplayEventUsbIn, DisplayStateOff, DisplayStateOn, kUnlocked },
+};
+
+class DisplayTransitionsTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testOffMatchesSwitch();
+	void testOnMatchesSwitch();
+	void testOnLockedMatchesSwitch();
+	void testDimMatchesSwitch();
+	void testUnhandled();
+	void testReplay();
+	void testNames();
+	void testTracer();
+	void testLatency();
+	void benchLookup();
+};
+
+void DisplayTransitionsTest::testOffMatchesSwitch()
+{
+	compareWithSwitch(DisplayStateOff, offBefore);
+}
+
+void DisplayTransitionsTest::testOnMatchesSwitch()
+{
+	compareWithSwitch(DisplayStateOn, onBefore);
+}
+
+void DisplayTransitionsTest::testOnLockedMatchesSwitch()
+{
+	compareWithSwitch(DisplayStateOnLocked, onLockedBefore);
+}
+
+void DisplayTransitionsTest::testDimMatchesSwitch()
+{
+	compareWithSwitch(DisplayStateDim, dimBefore);
+}
+
+void DisplayTransitionsTest::testUnhandled()
+{
+	DisplayState to = DisplayStateMax;
+
+	// what Off, On, OnLocked and Dim still handle themselves
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOff, DisplayEventOffCall));
+	QVERIFY(!DisplayTransitions::lookup(DisplayStateOff, DisplayEventOffCall, 0, to));
+	QCOMPARE(to, DisplayStateMax);
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOn, DisplayEventAlsChange));
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOn, DisplayEventSliderOpen));
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOnLocked, DisplayEventUpdateBrightness));
+	QVERIFY(!DisplayTransitions::handles(DisplayStateDim, DisplayEventProximityOff));
+
+	// states that have no rows yet
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOffOnCall, DisplayEventPowerKeyPress));
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOnPuck, DisplayEventPowerKeyPress));
+	QVERIFY(!DisplayTransitions::handles(DisplayStateDockMode, DisplayEventOffPuck));
+
+	QVERIFY(!DisplayTransitions::handles(DisplayStateMax, DisplayEventPowerKeyPress));
+	QVERIFY(!DisplayTransitions::handles(DisplayStateOff, DisplayEventMax));
+}
+
+void DisplayTransitionsTest::testReplay()
+{
+	int replayed = 0;
+	for (unsigned int i = 0; i < sizeof(kRecorded) / sizeof(kRecorded[0]); i++) {
+		const RecordedTransition& recorded = kRecorded[i];
+		if (i > 0)
+			QCOMPARE(recorded.from, kRecorded[i - 1].to);
+
+		// the moves of states that go by the table have to come out the same
+		if (!DisplayTransitions::handles(recorded.from, recorded.event))
+			continue;
+
+		DisplayState to;
+		QVERIFY(DisplayTransitions::lookup(recorded.from, recorded.event, recorded.guards, to));
+		QCOMPARE(to, recorded.to);
+		replayed++;
+	}
+
+	QCOMPARE(replayed, 5);
+}
+
+void DisplayTransitionsTest::testNames()
+{
+	QSet<QString> names;
+	for (int s = 0; s < DisplayStateMax; s++)
+		names.insert(DisplayTransitions::stateName(static_cast<DisplayState>(s)));
+	QCOMPARE(names.size(), (int) DisplayStateMax);
+	QVERIFY(!names.contains("unknown"));
+
+	names.clear();
+	for (int e = 0; e < DisplayEventMax; e++)
+		names.insert(DisplayTransitions::eventName(static_cast<DisplayEvent>(e)));
+	QCOMPARE(names.size(), (int) DisplayEventMax);
+	QVERIFY(!names.contains("unknown"));
+
+	QCOMPARE(QString(DisplayTransitions::stateName(DisplayStateOnLocked)), QString("onLocked"));
+	QCOMPARE(QString(DisplayTransitions::eventName(DisplayEventHomeKeyPress)), QString("homeKeyPress"));
+	QCOMPARE(QString(DisplayTransitions::eventName(DisplayEventMax)), QString("unknown"));
+}
+
+void DisplayTransitionsTest::testTracer()
+{
+	DisplayTransitionTracer tracer;
+	QCOMPARE(tracer.count(), 0);
+	tracer.backlightChanged(10, true);
+
+	const int total = DisplayTransitionTracer::Capacity + 6;
+	for (int i = 0; i < total; i++)
+		tracer.record(1000 + i, DisplayEventUserActivity, DisplayStateOff, DisplayStateOn, kUnlocked);
+
+	QCOMPARE(tracer.count(), (int) DisplayTransitionTracer::Capacity);
+	QCOMPARE(tracer.recorded(), (uint32_t) total);
+
+	// the oldest ones went
+	QCOMPARE(tracer.at(0).timeMs, (uint32_t) (1000 + total - 1));
+	QCOMPARE(tracer.at(tracer.count() - 1).timeMs, (uint32_t) (1000 + total - DisplayTransitionTracer::Capacity));
+	QCOMPARE(tracer.at(0).guards, kUnlocked);
+}
+
+void DisplayTransitionsTest::testLatency()
+{
+	DisplayTransitionTracer tracer;
+
+	tracer.record(1000, DisplayEventPowerKeyPress, DisplayStateOff, DisplayStateOnLocked, 0);
+	QCOMPARE(tracer.at(0).latencyMs, -1);
+
+	// superseded before the backlight followed
+	tracer.record(1010, DisplayEventUsbIn, DisplayStateOnLocked, DisplayStateOn, kUnlocked);
+	tracer.backlightChanged(1045, true);
+	QCOMPARE(tracer.at(0).latencyMs, 35);
+	QCOMPARE(tracer.at(1).latencyMs, -1);
+
+	// later brightness changes don't count against it
+	tracer.backlightChanged(5000, true);
+	QCOMPARE(tracer.at(0).latencyMs, 35);
+
+	// a move off waits for the backlight going off, not a late reply from turning it on
+	tracer.record(6000, DisplayEventTimeout, DisplayStateOn, DisplayStateOff, kUnlocked | kBacklight);
+	tracer.backlightChanged(6010, true);
+	QCOMPARE(tracer.at(0).latencyMs, -1);
+	tracer.backlightChanged(6120, false);
+	QCOMPARE(tracer.at(0).latencyMs, 120);
+
+	// and a move on ignores the backlight going off from before it
+	tracer.record(7000, DisplayEventPowerKeyPress, DisplayStateOff, DisplayStateOnLocked, 0);
+	tracer.backlightChanged(7005, false);
+	QCOMPARE(tracer.at(0).latencyMs, -1);
+	tracer.backlightChanged(7040, true);
+	QCOMPARE(tracer.at(0).latencyMs, 40);
+
+	// dimming is the backlight following a move to dim
+	tracer.record(8000, DisplayEventTimeout, DisplayStateOn, DisplayStateDim, kBacklight);
+	tracer.backlightChanged(8030, true);
+	QCOMPARE(tracer.at(0).latencyMs, 30);
+}
+
+void DisplayTransitionsTest::benchLookup()
+{
+	DisplayState to;
+	QBENCHMARK {
+		for (int e = 0; e < DisplayEventMax; e++)
+			DisplayTransitions::lookup(DisplayStateOff, static_cast<DisplayEvent>(e), kPuck | kCall, to);
+	}
+}
+
+QTEST_MAIN(DisplayTransitionsTest)
+
+#include "sysmgrtst_DisplayTransitions.moc"
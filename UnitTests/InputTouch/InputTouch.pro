@@ -45,7 +45,7 @@ QMAKE_CXXFLAGS += -DFIX_FOR_QT
 QMAKE_CXXFLAGS_WARN_ON += -Wno-unused-parameter -Wno-unused-variable -Wno-reorder -Wno-missing-field-initializers -Wno-extra
 
 
-LIBS += -lcjson -lLunaSysMgrIpc -lLunaKeymaps -lWebKitLuna -llunaservice -lpbnjson_cpp
+LIBS += -lcjson -lLunaSysMgrIpc -lLunaKeymaps -lWebKitLuna -llunaservice -lpbnjson_cpp -lcrypto
 
 linux-g++ {
 	include(../../desktop.pri)
@@ -89,13 +89,21 @@ SOURCES += \
 	BannerMessageEventFactory.cpp \
 	ApplicationDescription.cpp \
 	LaunchPoint.cpp \
+	LaunchPointSearchIndex.cpp \
 	ApplicationManager.cpp \
+	ApplicationIndex.cpp \
+	ApplicationScanner.cpp \
+	ApplicationChangeJournal.cpp \
 	CmdResourceHandlers.cpp \
 	ApplicationManagerService.cpp \
 	BackupManager.cpp \
 	WebKitEventListener.cpp \
 	DockPositionManager.cpp \
 	ApplicationInstaller.cpp \
+	PackageSizeAccounting.cpp \
+	SignatureVerifier.cpp \
+	ListResponseCache.cpp \
+	LaunchPointChangeBatcher.cpp \
 	WindowManagerBase.cpp \
 	WindowServer.cpp \
 	FpsHistory.cpp \
@@ -118,15 +126,21 @@ SOURCES += \
 	Timer.cpp \
 	WebAppManager.cpp \
 	Settings.cpp \
+	LunaConf.cpp \
 	DisplayManager.cpp \
 	DisplayStates.cpp \
+	DisplayTransitions.cpp \
 	AmbientLightSensor.cpp \
+	AlsRegionEstimator.cpp \
+	AdaptiveBrightness.cpp \
 	InputManager.cpp \
 	EventReporter.cpp \
 	ProcessManager.cpp \
 	SystemUiController.cpp \
 	BannerMessageHandler.cpp \
 	Logging.cpp \
+	LogRingBuffer.cpp \
+	JSONUtils.cpp \
 	ScaleImageBresenham.cpp \
 	Utils.cpp \
 	EncryptionUtil.cpp \
@@ -153,6 +167,8 @@ SOURCES += \
 	EASPolicyManager.cpp \
 	AnimationSettings.cpp \
 	MimeSystem.cpp \
+	MimeTableStore.cpp \
+	RedirectMatcher.cpp \
 	IpcServer.cpp \
 	IpcClientHost.cpp \
 	WebAppMgrProxy.cpp\
@@ -181,6 +197,9 @@ SOURCES += \
 	DockWindow.cpp \
 	QuicklaunchLayout.cpp \
 	MemoryMonitor.cpp \
+	MemorySampler.cpp \
+	ReclaimPolicy.cpp \
+	MemoryPressureWatcher.cpp \
 	MenuWindowManager.cpp \
 	DashboardWindowManager.cpp \
 	GraphicsItemContainer.cpp \
@@ -220,7 +239,12 @@ SOURCES += \
 	AppDirectRenderingArbitrator.cpp
 
 HEADERS += \
+	LogFilter.h \
+	ValidatedJsonMessage.h \
+	LogRingBuffer.h \
 	AmbientLightSensor.h \
+	AlsRegionEstimator.h \
+	AdaptiveBrightness.h \
 	AnimationSettings.h \
 	ApplicationDescription.h \
 	ApplicationInstallerErrors.h \
@@ -235,6 +259,7 @@ HEADERS += \
 	DeviceInfo.h \
 	DisplayManager.h \
 	DisplayStates.h \
+	DisplayTransitions.h \
 	EASPolicyManager.h \
 	EventReporter.h \
 	EventThrottler.h \
@@ -256,6 +281,7 @@ HEADERS += \
 	RoundedCorners.h \
 	Security.h \
 	Settings.h \
+	LunaConf.h \
 	SuspendBlocker.h \
 	SystemService.h \
 	SystemUiController.h \
@@ -341,6 +367,9 @@ HEADERS += \
 	DockWindow.h \
 	QuicklaunchLayout.h \
 	MemoryMonitor.h \
+	MemorySampler.h \
+	ReclaimPolicy.h \
+	MemoryPressureWatcher.h \
 	MenuWindowManager.h \
 	DashboardWindowManager.h \
 	GraphicsItemContainer.h \
@@ -379,6 +408,11 @@ HEADERS += \
 	LabelProperties.h \
 	OverlayNotificationWindowManager.h \
 	PackageDescription.h \
+	PackageSizeAccounting.h \
+	SignatureVerifier.h \
+	ListResponseCache.h \
+	LaunchPointChangeBatcher.h \
+	InstallerCommandScheduler.h \
 	ServiceDescription.h \
 	AppDirectRenderingArbitrator.h
 
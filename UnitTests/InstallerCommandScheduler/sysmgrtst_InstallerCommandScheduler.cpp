@@ -0,0 +1,286 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+#include <QProcess>
+#include <QEventLoop>
+
+#include "InstallerCommandScheduler.h"
+
+// stands in for InstallParams / RemoveParams
+struct Command
+{
+	Command(const std::string& key, int ticket) : key(key), ticket(ticket), process(0) {}
+
+	std::string packageKey() const { return key; }
+
+	std::string key;
+	int ticket;
+	QProcess* process;
+};
+
+// -------------------------------------------------------------------------
+// runs the commands as child processes and reaps them from the event loop, the way ApplicationInstaller does
+
+class CommandRunner : public QObject
+{
+	Q_OBJECT
+
+public:
+	CommandRunner(InstallerCommandScheduler<Command>& scheduler, const QString& program, const QStringList& args)
+		: m_scheduler(scheduler), m_program(program), m_args(args), m_maxSeen(0)
+	{
+	}
+
+	void run()
+	{
+		startAll();
+		if (!m_scheduler.isEmpty())
+			m_loop.exec();
+	}
+
+	QList<int> m_finishOrder;
+	unsigned int m_maxSeen;
+
+private Q_SLOTS:
+
+	void slotFinished()
+	{
+		QProcess* process = static_cast<QProcess*>(sender());
+		std::list<Command*>::const_iterator it;
+		for (it = m_scheduler.running().begin(); it != m_scheduler.running().end(); ++it) {
+			if ((*it)->process == process)
+				break;
+		}
+		Command* cmd = *it;
+
+		m_finishOrder.append(cmd->ticket);
+		m_scheduler.finished(cmd);
+		process->deleteLater();
+		cmd->process = 0;
+
+		startAll();
+		if (m_scheduler.isEmpty())
+			m_loop.quit();
+	}
+
+private:
+
+	void startAll()
+	{
+		while (Command* cmd = m_scheduler.takeNext()) {
+			cmd->process = new QProcess(this);
+			connect(cmd->process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(slotFinished()));
+			cmd->process->start(m_program, m_args);
+		}
+		m_maxSeen = qMax(m_maxSeen, (unsigned int) m_scheduler.running().size());
+	}
+
+	InstallerCommandScheduler<Command>& m_scheduler;
+	QString m_program;
+	QStringList m_args;
+	QEventLoop m_loop;
+};
+
+// -------------------------------------------------------------------------
+
+class InstallerCommandSchedulerTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	// a bulk restore: mostly distinct packages, every tenth one queued again right behind itself
+	static void makeRestore(std::vector<Command>& commands, int count);
+
+private Q_SLOTS:
+
+	void testSerialByDefault();
+	void testMaxRunning();
+	void testSamePackageKeepsOrder();
+	void testRequeue();
+	void testFailedStart();
+	void testChildProcesses();
+
+	void benchRestore_data();
+	void benchRestore();
+};
+
+void InstallerCommandSchedulerTest::makeRestore(std::vector<Command>& commands, int count)
+{
+	commands.clear();
+	for (int i = 0; i < count; i++) {
+		int package = i - i / 10;
+		commands.push_back(Command(QString("com.example.app%1").arg(package).toStdString(), i));
+	}
+}
+
+void InstallerCommandSchedulerTest::testSerialByDefault()
+{
+	InstallerCommandScheduler<Command> scheduler;
+	Command a("a", 1), b("b", 2);
+	scheduler.queue(&a);
+	scheduler.queue(&b);
+
+	QCOMPARE(scheduler.takeNext(), &a);
+	QVERIFY(scheduler.takeNext() == 0);
+	QVERIFY(!scheduler.isIdle());
+
+	scheduler.finished(&a);
+	QCOMPARE(scheduler.takeNext(), &b);
+	scheduler.finished(&b);
+	QVERIFY(scheduler.isIdle());
+	QVERIFY(scheduler.isEmpty());
+
+	scheduler.setMaxRunning(0);
+	QCOMPARE(scheduler.maxRunning(), 1u);
+}
+
+void InstallerCommandSchedulerTest::testMaxRunning()
+{
+	InstallerCommandScheduler<Command> scheduler(4);
+	std::vector<Command> commands;
+	for (int i = 0; i < 6; i++)
+		commands.push_back(Command(QString::number(i).toStdString(), i));
+	for (unsigned int i = 0; i < commands.size(); i++)
+		scheduler.queue(&commands[i]);
+
+	for (int i = 0; i < 4; i++)
+		QCOMPARE(scheduler.takeNext(), &commands[i]);
+	QVERIFY(scheduler.takeNext() == 0);
+	QCOMPARE((int) scheduler.running().size(), 4);
+	QCOMPARE((int) scheduler.pending().size(), 2);
+
+	// whichever finishes first frees the slot
+	scheduler.finished(&commands[2]);
+	QCOMPARE(scheduler.takeNext(), &commands[4]);
+	QVERIFY(scheduler.takeNext() == 0);
+}
+
+void InstallerCommandSchedulerTest::testSamePackageKeepsOrder()
+{
+	InstallerCommandScheduler<Command> scheduler(4);
+	Command install("a", 1), remove("a", 2), other("b", 3), reinstall("a", 4);
+	scheduler.queue(&install);
+	scheduler.queue(&remove);
+	scheduler.queue(&other);
+	scheduler.queue(&reinstall);
+
+	// the remove waits for the install, but doesn't hold up the other package
+	QCOMPARE(scheduler.takeNext(), &install);
+	QCOMPARE(scheduler.takeNext(), &other);
+	QVERIFY(scheduler.takeNext() == 0);
+
+	scheduler.finished(&install);
+	QCOMPARE(scheduler.takeNext(), &remove);
+	QVERIFY(scheduler.takeNext() == 0);
+
+	scheduler.finished(&remove);
+	QCOMPARE(scheduler.takeNext(), &reinstall);
+}
+
+void InstallerCommandSchedulerTest::testRequeue()
+{
+	InstallerCommandScheduler<Command> scheduler(2);
+	Command a("a", 1), b("b", 2), c("c", 3);
+	scheduler.queue(&a);
+	scheduler.queue(&b);
+	scheduler.queue(&c);
+	scheduler.takeNext();
+	scheduler.takeNext();
+
+	// what enterBrickMode does: the latest started goes back first, so the queue keeps its order
+	scheduler.requeue(&b);
+	scheduler.requeue(&a);
+	QVERIFY(scheduler.isIdle());
+	QCOMPARE(scheduler.pending().front(), &a);
+	QCOMPARE(scheduler.takeNext(), &a);
+	QCOMPARE(scheduler.takeNext(), &b);
+
+	// only running commands are requeued
+	scheduler.requeue(&c);
+	QCOMPARE((int) scheduler.pending().size(), 1);
+}
+
+void InstallerCommandSchedulerTest::testFailedStart()
+{
+	InstallerCommandScheduler<Command> scheduler;
+	Command a("a", 1), b("a", 2);
+	scheduler.queue(&a);
+	scheduler.queue(&b);
+
+	QCOMPARE(scheduler.takeNext(), &a);
+	scheduler.finished(&a);
+	QCOMPARE(scheduler.takeNext(), &b);
+}
+
+void InstallerCommandSchedulerTest::testChildProcesses()
+{
+	std::vector<Command> commands;
+	makeRestore(commands, 40);
+
+	InstallerCommandScheduler<Command> scheduler(4);
+	for (unsigned int i = 0; i < commands.size(); i++)
+		scheduler.queue(&commands[i]);
+
+	CommandRunner runner(scheduler, "sleep", QStringList() << "0.01");
+	runner.run();
+
+	QCOMPARE(runner.m_finishOrder.size(), (int) commands.size());
+	QCOMPARE(runner.m_maxSeen, 4u);
+
+	// a package's commands still finish in the order they were queued
+	QMap<QString, int> lastTicket;
+	Q_FOREACH(int ticket, runner.m_finishOrder) {
+		QString key = QString::fromStdString(commands[ticket].key);
+		QVERIFY(!lastTicket.contains(key) || lastTicket[key] < ticket);
+		lastTicket[key] = ticket;
+	}
+}
+
+void InstallerCommandSchedulerTest::benchRestore_data()
+{
+	QTest::addColumn<int>("maxRunning");
+	QTest::newRow("1") << 1;
+	QTest::newRow("4") << 4;
+}
+
+// 150 commands that each spend their time in a child process, the way the installer utility and ipkg do
+void InstallerCommandSchedulerTest::benchRestore()
+{
+	QFETCH(int, maxRunning);
+
+	std::vector<Command> commands;
+	makeRestore(commands, 150);
+
+	QBENCHMARK_ONCE {
+		InstallerCommandScheduler<Command> scheduler(maxRunning);
+		for (unsigned int i = 0; i < commands.size(); i++)
+			scheduler.queue(&commands[i]);
+
+		CommandRunner runner(scheduler, "sleep", QStringList() << "0.02");
+		runner.run();
+		QCOMPARE(runner.m_finishOrder.size(), (int) commands.size());
+	}
+}
+
+QTEST_MAIN(InstallerCommandSchedulerTest)
+
+#include "sysmgrtst_InstallerCommandScheduler.moc"
@@ -0,0 +1,240 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <stdio.h>
+#include <string.h>
+#include <cjson/json.h>
+
+#include "LaunchPointChangeBatcher.h"
+
+// stand in for the luna-service calls: what subscribe() and post() passed on
+static std::string s_addedKey;
+static std::string s_postedKey;
+static std::string s_postedPayload;
+
+bool LSSubscriptionAdd(LSHandle* sh, const char* key, LSMessage* message, LSError* lserror)
+{
+	s_addedKey = key;
+	return true;
+}
+
+bool LSSubscriptionReply(LSHandle* sh, const char* key, const char* payload, LSError* lserror)
+{
+	s_postedKey = key;
+	s_postedPayload = payload;
+	return true;
+}
+
+static std::string launchPointJson(const std::string& id, int version)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "{\"launchPointId\":\"%s\",\"title\":\"App %d\",\"removable\":true}", id.c_str(), version);
+	return buf;
+}
+
+// the changes of a batch message as "id:change" strings, in order
+static QStringList batchChanges(const std::string& message)
+{
+	QStringList changes;
+	struct json_object* root = json_tokener_parse(message.c_str());
+	if (!root || is_error(root))
+		return changes;
+
+	struct json_object* array = json_object_object_get(root, "launchPointChanges");
+	for (int i = 0; array && i < json_object_array_length(array); i++) {
+		struct json_object* item = json_object_array_get_idx(array, i);
+		struct json_object* lp = json_object_object_get(item, "launchPoint");
+		changes << QString("%1:%2").arg(json_object_get_string(json_object_object_get(lp, "launchPointId")))
+								   .arg(json_object_get_string(json_object_object_get(item, "change")));
+	}
+	json_object_put(root);
+	return changes;
+}
+
+class LaunchPointChangeBatcherTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testBatchOrder();
+	void testCoalesce();
+	void testCoalesce_data();
+	void testLatestJson();
+	void testProgressInterval();
+	void testDropProgress();
+	void testPostReachesSubscribers();
+
+	void benchPostPerChange();
+	void benchBatched();
+};
+
+void LaunchPointChangeBatcherTest::testBatchOrder()
+{
+	LaunchPointChangeBatcher batcher(500);
+	QVERIFY(!batcher.hasChanges());
+
+	batcher.queueChange("b", "added", launchPointJson("b", 0));
+	batcher.queueChange("a", "updated", launchPointJson("a", 0));
+	batcher.queueChange("c", "removed", launchPointJson("c", 0));
+	QCOMPARE(batcher.changeCount(), 3u);
+
+	QCOMPARE(batchChanges(batcher.takeChanges()), QStringList() << "b:added" << "a:updated" << "c:removed");
+	QVERIFY(!batcher.hasChanges());
+	QCOMPARE(batcher.takeChanges(), std::string("{\"launchPointChanges\":[]}"));
+}
+
+void LaunchPointChangeBatcherTest::testCoalesce_data()
+{
+	QTest::addColumn<QString>("first");
+	QTest::addColumn<QString>("second");
+	QTest::addColumn<QString>("result");		// empty: left out of the batch
+
+	QTest::newRow("added, updated") << "added" << "updated" << "added";
+	QTest::newRow("added, removed") << "added" << "removed" << "";
+	QTest::newRow("updated, updated") << "updated" << "updated" << "updated";
+	QTest::newRow("updated, removed") << "updated" << "removed" << "removed";
+	QTest::newRow("removed, added") << "removed" << "added" << "updated";
+}
+
+void LaunchPointChangeBatcherTest::testCoalesce()
+{
+	QFETCH(QString, first);
+	QFETCH(QString, second);
+	QFETCH(QString, result);
+
+	LaunchPointChangeBatcher batcher(500);
+	batcher.queueChange("x", "updated", launchPointJson("x", 0));
+	batcher.queueChange("lp", first.toStdString(), launchPointJson("lp", 1));
+	batcher.queueChange("lp", second.toStdString(), launchPointJson("lp", 2));
+
+	QStringList expected;
+	expected << "x:updated";
+	if (!result.isEmpty())
+		expected << "lp:" + result;
+	QCOMPARE(batchChanges(batcher.takeChanges()), expected);
+}
+
+void LaunchPointChangeBatcherTest::testLatestJson()
+{
+	LaunchPointChangeBatcher batcher(500);
+	for (int i = 0; i < 10; i++)
+		batcher.queueChange("lp", "updated", launchPointJson("lp", i));
+	QCOMPARE(batcher.changeCount(), 1u);
+
+	std::string message = batcher.takeChanges();
+	QVERIFY(message.find("App 9") != std::string::npos);
+	QVERIFY(message.find("App 8") == std::string::npos);
+}
+
+void LaunchPointChangeBatcherTest::testProgressInterval()
+{
+	LaunchPointChangeBatcher batcher(500);
+
+	QVERIFY(batcher.passProgress("app", 1000));
+	QVERIFY(batcher.passProgress("other", 1100));
+	QVERIFY(!batcher.passProgress("app", 1200));
+	QVERIFY(!batcher.passProgress("app", 1300));
+	QVERIFY(batcher.hasHeldProgress());
+	QCOMPARE(batcher.nextProgressDue(1300), 200u);
+
+	QVERIFY(batcher.takeDueProgress(1400).empty());
+	std::vector<std::string> due = batcher.takeDueProgress(1500);
+	QCOMPARE(due.size(), (size_t) 1);
+	QCOMPARE(due[0], std::string("app"));
+	QVERIFY(!batcher.hasHeldProgress());
+
+	// the one handed out counts as passed on
+	QVERIFY(!batcher.passProgress("app", 1600));
+	QVERIFY(batcher.passProgress("app", 2000));
+	QVERIFY(!batcher.hasHeldProgress());
+}
+
+void LaunchPointChangeBatcherTest::testDropProgress()
+{
+	LaunchPointChangeBatcher batcher(500);
+	QVERIFY(batcher.passProgress("app", 0));
+	QVERIFY(!batcher.passProgress("app", 100));
+
+	batcher.dropProgress("app");
+	QVERIFY(!batcher.hasHeldProgress());
+	QVERIFY(batcher.takeDueProgress(10000).empty());
+	QCOMPARE(batcher.nextProgressDue(100), 0u);
+
+	// as if never seen
+	QVERIFY(batcher.passProgress("app", 200));
+}
+
+// a batch has to be posted under the very key its subscribers were added under, or nobody gets it
+void LaunchPointChangeBatcherTest::testPostReachesSubscribers()
+{
+	LaunchPointChangeBatcher batcher(500);
+	batcher.queueChange("a", "added", launchPointJson("a", 0));
+	std::string batch = batcher.takeChanges();
+
+	s_addedKey.clear();
+	s_postedKey.clear();
+	QVERIFY(LaunchPointChangeBatcher::subscribe(0, 0, 0));
+	QVERIFY(LaunchPointChangeBatcher::post(0, batch, 0));
+	QVERIFY(!s_addedKey.empty());
+	QCOMPARE(s_postedKey, s_addedKey);
+	QCOMPARE(s_postedPayload, batch);
+}
+
+static const int s_benchLaunchPoints = 150;
+
+// a rescan that touches every launch point: what was serialized and posted, one message each
+void LaunchPointChangeBatcherTest::benchPostPerChange()
+{
+	QBENCHMARK {
+		size_t posted = 0;
+		for (int i = 0; i < s_benchLaunchPoints; i++) {
+			json_object* json = json_tokener_parse(launchPointJson(QString::number(i).toStdString(), 0).c_str());
+			json_object_object_add(json, "change", json_object_new_string("removed"));
+			posted += strlen(json_object_to_json_string(json));
+			json_object_put(json);
+
+			json = json_tokener_parse(launchPointJson(QString::number(i).toStdString(), 1).c_str());
+			json_object_object_add(json, "change", json_object_new_string("added"));
+			posted += strlen(json_object_to_json_string(json));
+			json_object_put(json);
+		}
+	}
+}
+
+void LaunchPointChangeBatcherTest::benchBatched()
+{
+	LaunchPointChangeBatcher batcher(500);
+
+	QBENCHMARK {
+		for (int i = 0; i < s_benchLaunchPoints; i++) {
+			std::string id = QString::number(i).toStdString();
+			batcher.queueChange(id, "removed", launchPointJson(id, 0));
+			batcher.queueChange(id, "added", launchPointJson(id, 1));
+		}
+		std::string message = batcher.takeChanges();
+	}
+}
+
+QTEST_MAIN(LaunchPointChangeBatcherTest)
+
+#include "sysmgrtst_LaunchPointChangeBatcher.moc"
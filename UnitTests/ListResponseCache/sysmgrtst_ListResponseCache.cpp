@@ -0,0 +1,244 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <stdio.h>
+#include <cjson/json.h>
+
+#include "ListResponseCache.h"
+
+// what an app entry of listApps looks like, give or take
+static std::string appJson(int i, int version)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "{\"id\":\"com.example.app%d\",\"version\":\"1.0.%d\",\"title\":\"App %d\","
+			 "\"icon\":\"/media/cryptofs/apps/usr/palm/applications/com.example.app%d/icon.png\",\"removable\":true}",
+			 i, version, i, i);
+	return buf;
+}
+
+static std::string appId(int i)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "com.example.app%d", i);
+	return buf;
+}
+
+static std::vector<ListResponseCache::ItemList> appLists(int count, int changed = -1)
+{
+	std::vector<ListResponseCache::ItemList> lists(1);
+	for (int i = 0; i < count; i++)
+		lists[0].push_back(std::make_pair(appId(i), appJson(i, i == changed ? 1 : 0)));
+	return lists;
+}
+
+static std::vector<std::string> names(const char* first, const char* second = NULL)
+{
+	std::vector<std::string> v(1, first);
+	if (second)
+		v.push_back(second);
+	return v;
+}
+
+// number of entries of the array at key in object (-1 if it isn't one)
+static int arrayLength(struct json_object* object, const char* key)
+{
+	struct json_object* array = json_object_object_get(object, key);
+	if (!array || !json_object_is_type(array, json_type_array))
+		return -1;
+	return json_object_array_length(array);
+}
+
+class ListResponseCacheTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testFullResponse();
+	void testDeltaOfChanged();
+	void testRemoved();
+	void testReAdded();
+	void testPrunedRemovals();
+	void testUnknownGeneration();
+	void testEscapedKeys();
+
+	void benchBuildTree();
+	void benchCachedResponse();
+};
+
+void ListResponseCacheTest::testFullResponse()
+{
+	ListResponseCache cache(names("resources", "redirects"));
+	QVERIFY(!cache.isCurrent(5));
+
+	std::vector<ListResponseCache::ItemList> lists(2);
+	lists[0].push_back(std::make_pair("text/plain", "{\"mimeType\":\"text/plain\"}"));
+	lists[1].push_back(std::make_pair("^http:", "{\"url\":\"^http:\"}"));
+	cache.update(5, lists);
+
+	QVERIFY(cache.isCurrent(5));
+	QVERIFY(!cache.isCurrent(6));
+	QCOMPARE(cache.response(), std::string("{\"returnValue\":true,\"generation\":5,"
+			 "\"resources\":[{\"mimeType\":\"text/plain\"}],\"redirects\":[{\"url\":\"^http:\"}]}"));
+}
+
+void ListResponseCacheTest::testDeltaOfChanged()
+{
+	ListResponseCache cache(names("apps"));
+	cache.update(10, appLists(20));
+	cache.update(11, appLists(20));		// nothing changed
+	cache.update(12, appLists(20, 7));
+
+	std::string delta = cache.response(10);
+	struct json_object* root = json_tokener_parse(delta.c_str());
+	QVERIFY(root && !is_error(root));
+	QCOMPARE(json_object_get_int(json_object_object_get(root, "generation")), 12);
+	QVERIFY(json_object_get_boolean(json_object_object_get(root, "delta")));
+	QCOMPARE(arrayLength(root, "apps"), 1);
+	QCOMPARE(std::string(json_object_get_string(json_object_object_get(
+			 json_object_array_get_idx(json_object_object_get(root, "apps"), 0), "id"))), appId(7));
+	QCOMPARE(arrayLength(json_object_object_get(root, "removed"), "apps"), 0);
+	json_object_put(root);
+
+	// up to date: an empty delta
+	root = json_tokener_parse(cache.response(12).c_str());
+	QCOMPARE(arrayLength(root, "apps"), 0);
+	json_object_put(root);
+}
+
+void ListResponseCacheTest::testRemoved()
+{
+	ListResponseCache cache(names("apps"));
+	cache.update(1, appLists(5));
+	cache.update(2, appLists(3));
+
+	struct json_object* root = json_tokener_parse(cache.response(1).c_str());
+	QVERIFY(root && !is_error(root));
+	QCOMPARE(arrayLength(root, "apps"), 0);
+	struct json_object* removed = json_object_object_get(json_object_object_get(root, "removed"), "apps");
+	QCOMPARE(json_object_array_length(removed), 2);
+	QCOMPARE(std::string(json_object_get_string(json_object_array_get_idx(removed, 0))), appId(3));
+	QCOMPARE(std::string(json_object_get_string(json_object_array_get_idx(removed, 1))), appId(4));
+	json_object_put(root);
+
+	// the full reply has no trace of them
+	root = json_tokener_parse(cache.response().c_str());
+	QCOMPARE(arrayLength(root, "apps"), 3);
+	QVERIFY(!json_object_object_get(root, "removed"));
+	json_object_put(root);
+}
+
+void ListResponseCacheTest::testReAdded()
+{
+	ListResponseCache cache(names("apps"));
+	cache.update(1, appLists(3));
+	cache.update(2, appLists(2));
+	cache.update(3, appLists(3));
+
+	// removed and back again: a change, not a removal
+	struct json_object* root = json_tokener_parse(cache.response(1).c_str());
+	QCOMPARE(arrayLength(root, "apps"), 1);
+	QCOMPARE(arrayLength(json_object_object_get(root, "removed"), "apps"), 0);
+	json_object_put(root);
+}
+
+void ListResponseCacheTest::testPrunedRemovals()
+{
+	ListResponseCache cache(names("apps"));
+	cache.update(1, appLists(600));
+	cache.update(2, appLists(400));		// 200 removals, all remembered
+	QVERIFY(cache.canDelta(1));
+
+	cache.update(3, appLists(300));		// 300: the oldest of generation 2 are forgotten
+	QVERIFY(!cache.canDelta(1));
+	QVERIFY(cache.canDelta(2));
+	QCOMPARE(cache.response(1), cache.response());
+}
+
+void ListResponseCacheTest::testUnknownGeneration()
+{
+	ListResponseCache cache(names("apps"));
+	QVERIFY(!cache.canDelta(0));
+
+	cache.update(100, appLists(3));
+	cache.update(101, appLists(3, 1));
+
+	// from before this cache existed (or a restart), or from the future
+	QVERIFY(!cache.canDelta(99));
+	QVERIFY(!cache.canDelta(102));
+	QCOMPARE(cache.response(99), cache.response());
+	QCOMPARE(cache.response(5000), cache.response());
+	QVERIFY(cache.canDelta(100));
+}
+
+void ListResponseCacheTest::testEscapedKeys()
+{
+	ListResponseCache cache(names("redirects"));
+	std::vector<ListResponseCache::ItemList> lists(1);
+	lists[0].push_back(std::make_pair("^https?://\"quoted\"\\.example\\.com/", "{}"));
+	cache.update(1, lists);
+	cache.update(2, std::vector<ListResponseCache::ItemList>(1));
+
+	struct json_object* root = json_tokener_parse(cache.response(1).c_str());
+	QVERIFY(root && !is_error(root));
+	struct json_object* removed = json_object_object_get(json_object_object_get(root, "removed"), "redirects");
+	QCOMPARE(std::string(json_object_get_string(json_object_array_get_idx(removed, 0))),
+			 std::string("^https?://\"quoted\"\\.example\\.com/"));
+	json_object_put(root);
+}
+
+static const int s_benchApps = 200;
+
+// what listApps did on every call: a json tree of every app, serialized
+void ListResponseCacheTest::benchBuildTree()
+{
+	std::vector<std::string> apps;
+	for (int i = 0; i < s_benchApps; i++)
+		apps.push_back(appJson(i, 0));
+
+	QBENCHMARK {
+		json_object* json = json_object_new_object();
+		json_object* array = json_object_new_array();
+		json_object_object_add(json, "returnValue", json_object_new_boolean(true));
+		for (int i = 0; i < s_benchApps; i++)
+			json_object_array_add(array, json_tokener_parse(apps[i].c_str()));
+		json_object_object_add(json, "apps", array);
+		std::string reply = json_object_to_json_string(json);
+		json_object_put(json);
+	}
+}
+
+void ListResponseCacheTest::benchCachedResponse()
+{
+	ListResponseCache cache(names("apps"));
+	cache.update(1, appLists(s_benchApps));
+
+	QBENCHMARK {
+		if (!cache.isCurrent(1))
+			cache.update(1, appLists(s_benchApps));
+		std::string reply = cache.response();
+	}
+}
+
+QTEST_MAIN(ListResponseCacheTest)
+
+#include "sysmgrtst_ListResponseCache.moc"
@@ -0,0 +1,138 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <stdlib.h>
+
+#include "Logging.h"
+#include "LogFilter.h"
+
+class LogChannelTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void initTestCase();
+
+	void testFromEnvironment();
+	void testResolveOnce();
+	void testToggle();
+	void testEnableBeforeResolve();
+	void testList();
+
+	void benchLookupByName();
+	void benchHandle();
+};
+
+void LogChannelTest::initTestCase()
+{
+	// read on first use of any channel
+	setenv("LUNA_LOGGING", "ApplicationManager, Installer,,", 1);
+}
+
+void LogChannelTest::testFromEnvironment()
+{
+	QVERIFY(logChannelEnabled(logChannel("ApplicationManager")));
+	QVERIFY(logChannelEnabled(logChannel("Installer")));
+	QVERIFY(!logChannelEnabled(logChannel("ApplicationInstaller")));
+
+	QVERIFY(LunaChannelEnabled("ApplicationManager"));
+	QVERIFY(!LunaChannelEnabled("ApplicationInstaller"));
+	QVERIFY(!LunaChannelEnabled(0));
+	QVERIFY(logChannel(0) == 0);
+}
+
+void LogChannelTest::testResolveOnce()
+{
+	LogChannel* channel = logChannel("Resolved");
+	QVERIFY(channel != 0);
+	QCOMPARE(QString(channel->name), QString("Resolved"));
+	QVERIFY(logChannel("Resolved") == channel);
+
+	std::string copy("Resolved");
+	QVERIFY(logChannel(copy.c_str()) == channel);
+}
+
+void LogChannelTest::testToggle()
+{
+	LogChannel* channel = logChannel("Toggled");
+	QVERIFY(!logChannelEnabled(channel));
+
+	logSetChannelEnabled("Toggled", true);
+	QVERIFY(logChannelEnabled(channel));
+	QVERIFY(LunaChannelEnabled("Toggled"));
+
+	int formatted = 0;
+	channel_log(channel, "formatted %d", ++formatted);
+	QCOMPARE(formatted, 1);
+
+	logSetChannelEnabled("Toggled", false);
+	QVERIFY(!logChannelEnabled(channel));
+	channel_log(channel, "formatted %d", ++formatted);
+	channel_warn(channel, "formatted %d", ++formatted);
+	QCOMPARE(formatted, 1);
+}
+
+void LogChannelTest::testEnableBeforeResolve()
+{
+	logSetChannelEnabled("LoadedLater", true);
+	QVERIFY(logChannelEnabled(logChannel("LoadedLater")));
+}
+
+void LogChannelTest::testList()
+{
+	logChannel("Listed");
+	logSetChannelEnabled("ListedOn", true);
+
+	std::map<std::string, bool> channels = logChannels();
+	QVERIFY(channels.count("Listed"));
+	QVERIFY(!channels["Listed"]);
+	QVERIFY(channels["ListedOn"]);
+	QVERIFY(channels["ApplicationManager"]);
+	QVERIFY(!channels.count(""));
+}
+
+// what every luna_log() paid: the registry lock and a hash lookup
+void LogChannelTest::benchLookupByName()
+{
+	bool enabled = false;
+	QBENCHMARK {
+		for (int i = 0; i < 1000; i++)
+			enabled |= LunaChannelEnabled("ApplicationInstaller");
+	}
+	QVERIFY(!enabled);
+}
+
+void LogChannelTest::benchHandle()
+{
+	LogChannel* channel = logChannel("ApplicationInstaller");
+	bool enabled = false;
+	QBENCHMARK {
+		for (int i = 0; i < 1000; i++)
+			enabled |= logChannelEnabled(channel);
+	}
+	QVERIFY(!enabled);
+}
+
+QTEST_MAIN(LogChannelTest)
+
+#include "sysmgrtst_LogChannel.moc"
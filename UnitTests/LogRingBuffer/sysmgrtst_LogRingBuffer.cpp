@@ -0,0 +1,200 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "LogRingBuffer.h"
+
+static const char* s_scanLine = "ApplicationManager::scanApplicationsFolders(/media/cryptofs/apps/usr/palm/applications/): com.example.app";
+
+class LogRingBufferTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testOrder();
+	void testFullDrops();
+	void testIndentAndTruncation();
+	void testConcurrentProducers();
+
+	void benchMallocAsyncQueue();
+	void benchRingBuffer();
+};
+
+void LogRingBufferTest::testOrder()
+{
+	LogRingBuffer ring(5);
+	QCOMPARE(ring.capacity(), 8u);
+	QVERIFY(ring.empty());
+
+	LogRingBuffer::Record records[8];
+	for (int round = 0; round < 3; round++) {
+		QVERIFY(ring.push(G_LOG_LEVEL_WARNING, 1, "", "one"));
+		QVERIFY(ring.push(G_LOG_LEVEL_DEBUG, 2, "", "two"));
+		QVERIFY(!ring.empty());
+
+		QCOMPARE(ring.pop(records, 8), 2u);
+		QCOMPARE(records[0].level, G_LOG_LEVEL_WARNING);
+		QCOMPARE(records[0].timeNs, (uint64_t) 1);
+		QCOMPARE(QString(records[0].text), QString("one"));
+		QCOMPARE(QString(records[1].text), QString("two"));
+		QVERIFY(ring.empty());
+	}
+	QCOMPARE(ring.dropped(), 0u);
+}
+
+void LogRingBufferTest::testFullDrops()
+{
+	LogRingBuffer ring(4);
+	for (int i = 0; i < 4; i++)
+		QVERIFY(ring.push(G_LOG_LEVEL_MESSAGE, i, "", "kept"));
+	QVERIFY(!ring.push(G_LOG_LEVEL_MESSAGE, 4, "", "dropped"));
+	QVERIFY(!ring.push(G_LOG_LEVEL_MESSAGE, 5, "", "dropped"));
+	QCOMPARE(ring.dropped(), 2u);
+
+	// popping makes room again; what was dropped stays dropped
+	LogRingBuffer::Record records[2];
+	QCOMPARE(ring.pop(records, 2), 2u);
+	QVERIFY(ring.push(G_LOG_LEVEL_MESSAGE, 6, "", "after"));
+
+	LogRingBuffer::Record rest[4];
+	QCOMPARE(ring.pop(rest, 4), 3u);
+	QCOMPARE(QString(rest[2].text), QString("after"));
+	QCOMPARE(ring.dropped(), 2u);
+}
+
+void LogRingBufferTest::testIndentAndTruncation()
+{
+	LogRingBuffer ring(2);
+	LogRingBuffer::Record record;
+
+	QVERIFY(ring.push(G_LOG_LEVEL_MESSAGE, 0, "  ", "indented"));
+	QCOMPARE(ring.pop(&record, 1), 1u);
+	QCOMPARE(record.indentLength, 2u);
+	QCOMPARE(QString(record.text + record.indentLength), QString("indented"));
+
+	std::string longMessage(3 * LogRingBuffer::MaxTextLength, 'x');
+	QVERIFY(ring.push(G_LOG_LEVEL_MESSAGE, 0, 0, longMessage.c_str()));
+	QCOMPARE(ring.pop(&record, 1), 1u);
+	QCOMPARE(record.indentLength, 0u);
+	QCOMPARE(strlen(record.text), (size_t) LogRingBuffer::MaxTextLength - 1);
+}
+
+struct Producer {
+	LogRingBuffer* ring;
+	int id;
+	int count;
+};
+
+static void* produce(void* arg)
+{
+	Producer* producer = static_cast<Producer*>(arg);
+	char message[64];
+	for (int i = 0; i < producer->count; i++) {
+		snprintf(message, sizeof(message), "%d %d", producer->id, i);
+		while (!producer->ring->push(G_LOG_LEVEL_MESSAGE, i, "", message))
+			sched_yield();
+	}
+	return 0;
+}
+
+void LogRingBufferTest::testConcurrentProducers()
+{
+	const int producers = 4;
+	const int perProducer = 20000;
+
+	LogRingBuffer ring(64);
+	Producer args[producers];
+	pthread_t threads[producers];
+	for (int i = 0; i < producers; i++) {
+		args[i].ring = &ring;
+		args[i].id = i;
+		args[i].count = perProducer;
+		pthread_create(&threads[i], 0, produce, &args[i]);
+	}
+
+	// every message arrives once, and in order per producer
+	int next[producers] = { 0 };
+	int received = 0;
+	LogRingBuffer::Record records[16];
+	while (received < producers * perProducer) {
+		unsigned int count = ring.pop(records, 16);
+		for (unsigned int i = 0; i < count; i++) {
+			int id = -1, seq = -1;
+			QCOMPARE(sscanf(records[i].text, "%d %d", &id, &seq), 2);
+			QVERIFY(id >= 0 && id < producers);
+			QCOMPARE(seq, next[id]);
+			next[id]++;
+			received++;
+		}
+		if (!count)
+			sched_yield();
+	}
+
+	for (int i = 0; i < producers; i++)
+		pthread_join(threads[i], 0);
+	QVERIFY(ring.empty());
+}
+
+// what logFilter() did per line before: a malloc'd copy pushed on a GAsyncQueue, freed by the log thread
+void LogRingBufferTest::benchMallocAsyncQueue()
+{
+	GAsyncQueue* queue = g_async_queue_new();
+
+	QBENCHMARK {
+		for (int i = 0; i < 32; i++) {
+			GLogLevelFlags logLevel = G_LOG_LEVEL_MESSAGE;
+			int msgSize = strlen(s_scanLine) + 1;
+			char* buffer = (char*) malloc(sizeof(logLevel) + msgSize);
+			*((GLogLevelFlags*)buffer) = logLevel;
+			memcpy(buffer + sizeof(logLevel), s_scanLine, msgSize);
+			g_async_queue_push(queue, buffer);
+		}
+		for (int i = 0; i < 32; i++)
+			free(g_async_queue_pop(queue));
+	}
+
+	g_async_queue_unref(queue);
+}
+
+void LogRingBufferTest::benchRingBuffer()
+{
+	LogRingBuffer ring(256);
+	LogRingBuffer::Record* records = new LogRingBuffer::Record[32];
+
+	QBENCHMARK {
+		for (int i = 0; i < 32; i++)
+			ring.push(G_LOG_LEVEL_MESSAGE, i, "", s_scanLine);
+		ring.pop(records, 32);
+	}
+
+	delete [] records;
+}
+
+QTEST_MAIN(LogRingBufferTest)
+
+#include "sysmgrtst_LogRingBuffer.moc"
@@ -0,0 +1,229 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "MemoryPressureWatcher.h"
+
+static const char* const kMissing = "/nonexistent/pressure/memory";
+
+static void writeFile(const QString& path, const char* contents)
+{
+	QFile file(path);
+	QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	file.write(contents);
+}
+
+class MemoryPressureWatcherTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testRaise();
+	void testRecover();
+	void testScanCgroupEvents();
+	void testCgroupEventsLevel();
+	void testScanCgroupPath();
+	void testNothingToWatch();
+	void testCgroupEvents();
+	void testStop();
+};
+
+static int s_callbacks;
+
+static void countCallback(ReclaimPolicy::Pressure pressure, void* data)
+{
+	s_callbacks++;
+}
+
+void MemoryPressureWatcherTest::testRaise()
+{
+	MemoryPressureWatcher watcher(0, 0, kMissing);
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureNormal);
+
+	QVERIFY(watcher.noteEvent(ReclaimPolicy::PressureMedium, 1000));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureMedium);
+
+	// the same level again is no change, a higher one is
+	QVERIFY(!watcher.noteEvent(ReclaimPolicy::PressureMedium, 1500));
+	QVERIFY(watcher.noteEvent(ReclaimPolicy::PressureCritical, 2000));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureCritical);
+
+	// a lower one never lowers it
+	QVERIFY(!watcher.noteEvent(ReclaimPolicy::PressureLow, 2500));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureCritical);
+}
+
+void MemoryPressureWatcherTest::testRecover()
+{
+	const int64_t recovery = MemoryPressureWatcher::RecoveryMs;
+	MemoryPressureWatcher watcher(0, 0, kMissing);
+
+	watcher.noteEvent(ReclaimPolicy::PressureMedium, 1000);
+	watcher.noteEvent(ReclaimPolicy::PressureCritical, 2000);
+	watcher.noteEvent(ReclaimPolicy::PressureMedium, 4000);
+
+	// held while it keeps firing
+	QVERIFY(!watcher.recover(2000 + recovery - 1));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureCritical);
+
+	// then down to the highest level still firing, skipping Low which never did
+	QVERIFY(watcher.recover(2000 + recovery));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureMedium);
+
+	QVERIFY(watcher.recover(4000 + recovery));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureNormal);
+	QVERIFY(!watcher.recover(4000 + 2 * recovery));
+
+	// a level fired on its own drops straight back
+	watcher.noteEvent(ReclaimPolicy::PressureLow, 20000);
+	QVERIFY(watcher.recover(20000 + recovery));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureNormal);
+}
+
+void MemoryPressureWatcherTest::testScanCgroupEvents()
+{
+	const char* text =
+		"low 3\n"
+		"high 12\n"
+		"max 1\n"
+		"oom 0\n"
+		"oom_kill 2\n"
+		"oom_group_kill 0\n";
+
+	MemoryPressureWatcher::CgroupEvents events;
+	QVERIFY(MemoryPressureWatcher::scanCgroupEvents(text, strlen(text), events));
+	QCOMPARE(events.low, (uint64_t) 3);
+	QCOMPARE(events.high, (uint64_t) 12);
+	QCOMPARE(events.max, (uint64_t) 1);
+	QCOMPARE(events.oom, (uint64_t) 0);
+	QCOMPARE(events.oomKill, (uint64_t) 2);
+
+	// no trailing newline
+	const char* partial = "high 7";
+	QVERIFY(MemoryPressureWatcher::scanCgroupEvents(partial, strlen(partial), events));
+	QCOMPARE(events.high, (uint64_t) 7);
+
+	const char* other = "anon 4096\nfile 8192\n";
+	QVERIFY(!MemoryPressureWatcher::scanCgroupEvents(other, strlen(other), events));
+	QVERIFY(!MemoryPressureWatcher::scanCgroupEvents("", 0, events));
+}
+
+void MemoryPressureWatcherTest::testCgroupEventsLevel()
+{
+	MemoryPressureWatcher::CgroupEvents before, after;
+	QCOMPARE(MemoryPressureWatcher::cgroupEventsLevel(before, after), ReclaimPolicy::PressureNormal);
+
+	after.low = 1;
+	QCOMPARE(MemoryPressureWatcher::cgroupEventsLevel(before, after), ReclaimPolicy::PressureMedium);
+
+	after.high = 1;
+	QCOMPARE(MemoryPressureWatcher::cgroupEventsLevel(before, after), ReclaimPolicy::PressureLow);
+
+	after.oomKill = 1;
+	QCOMPARE(MemoryPressureWatcher::cgroupEventsLevel(before, after), ReclaimPolicy::PressureCritical);
+
+	// only what went up counts
+	QCOMPARE(MemoryPressureWatcher::cgroupEventsLevel(after, after), ReclaimPolicy::PressureNormal);
+	before = after;
+	after.max = 4;
+	QCOMPARE(MemoryPressureWatcher::cgroupEventsLevel(before, after), ReclaimPolicy::PressureCritical);
+}
+
+void MemoryPressureWatcherTest::testScanCgroupPath()
+{
+	const char* v2 = "0::/system.slice/luna-sysmgr.service\n";
+	QCOMPARE(MemoryPressureWatcher::scanCgroupPath(v2, strlen(v2)), std::string("/system.slice/luna-sysmgr.service"));
+
+	// hybrid: v1 hierarchies first
+	const char* hybrid =
+		"12:memory:/system.slice/luna-sysmgr.service\n"
+		"1:name=systemd:/system.slice/luna-sysmgr.service\n"
+		"0::/system.slice/luna-sysmgr.service";
+	QCOMPARE(MemoryPressureWatcher::scanCgroupPath(hybrid, strlen(hybrid)), std::string("/system.slice/luna-sysmgr.service"));
+
+	// v1 only, and the root cgroup, have nothing to watch
+	const char* v1 = "4:memory:/\n1:cpu:/\n";
+	QVERIFY(MemoryPressureWatcher::scanCgroupPath(v1, strlen(v1)).empty());
+	const char* root = "0::/\n";
+	QVERIFY(MemoryPressureWatcher::scanCgroupPath(root, strlen(root)).empty());
+}
+
+void MemoryPressureWatcherTest::testNothingToWatch()
+{
+	MemoryPressureWatcher watcher(0, 0, kMissing, "/nonexistent/self/cgroup", "/nonexistent/cgroup");
+	QVERIFY(!watcher.start(0));
+	QVERIFY(!watcher.watching());
+	QCOMPARE(QString(watcher.sourceName()), QString("none"));
+}
+
+void MemoryPressureWatcherTest::testCgroupEvents()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QVERIFY(QDir(dir.path()).mkpath("cgroup/sysmgr"));
+
+	writeFile(dir.path() + "/self_cgroup", "0::/sysmgr\n");
+	writeFile(dir.path() + "/cgroup/sysmgr/memory.events", "low 0\nhigh 0\nmax 0\noom 0\noom_kill 0\n");
+
+	QByteArray selfCgroup = QFile::encodeName(dir.path() + "/self_cgroup");
+	QByteArray cgroupRoot = QFile::encodeName(dir.path() + "/cgroup");
+
+	MemoryPressureWatcher watcher(0, 0, kMissing, selfCgroup.constData(), cgroupRoot.constData());
+	QVERIFY(watcher.start(0));
+	QVERIFY(watcher.watching());
+	QCOMPARE(QString(watcher.sourceName()), QString("cgroup"));
+	QCOMPARE(watcher.pressure(), ReclaimPolicy::PressureNormal);
+}
+
+// what a failed PSI trigger does: every watch goes, and the owner is told so it polls again
+void MemoryPressureWatcherTest::testStop()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QVERIFY(QDir(dir.path()).mkpath("cgroup/sysmgr"));
+
+	writeFile(dir.path() + "/self_cgroup", "0::/sysmgr\n");
+	writeFile(dir.path() + "/cgroup/sysmgr/memory.events", "low 0\nhigh 0\nmax 0\noom 0\noom_kill 0\n");
+
+	QByteArray selfCgroup = QFile::encodeName(dir.path() + "/self_cgroup");
+	QByteArray cgroupRoot = QFile::encodeName(dir.path() + "/cgroup");
+
+	s_callbacks = 0;
+	MemoryPressureWatcher watcher(countCallback, 0, kMissing, selfCgroup.constData(), cgroupRoot.constData());
+	QVERIFY(watcher.start(0));
+	QCOMPARE(s_callbacks, 0);
+
+	watcher.stop();
+	QVERIFY(!watcher.watching());
+	QCOMPARE(QString(watcher.sourceName()), QString("none"));
+	QCOMPARE(s_callbacks, 1);
+
+	// nothing left to stop
+	watcher.stop();
+	QCOMPARE(s_callbacks, 1);
+}
+
+QTEST_MAIN(MemoryPressureWatcherTest)
+
+#include "sysmgrtst_MemoryPressureWatcher.moc"
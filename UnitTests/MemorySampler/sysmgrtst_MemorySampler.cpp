@@ -0,0 +1,276 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include <fstream>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "MemorySampler.h"
+
+static const char* s_status =
+	"Name:\tcom.example.app\n"
+	"State:\tS (sleeping)\n"
+	"VmPeak:\t   90000 kB\n"
+	"VmRSS:\t   20480 kB\n"
+	"VmSwap:\t    4096 kB\n"
+	"Threads:\t4\n";
+
+static const char* s_rollup =
+	"00010000-ffff0000 ---p 00000000 00:00 0                          [rollup]\n"
+	"Rss:               20480 kB\n"
+	"Pss:               10240 kB\n"
+	"Swap:               4096 kB\n"
+	"SwapPss:            2048 kB\n";
+
+static const char* s_memnotify =
+	"Used (Mem+Swap): 160MB\n"
+	"Current Threshold: normal\n"
+	"Enter Thresholds:\n"
+	"normal: 0, 0MB, Rem: -160MB:\n"
+	"low: 100, 200MB, Rem: 40MB:\n"
+	"critical: 114, 228MB, Rem: 68MB:\n"
+	"reboot: 120, 240MB, Rem: 80MB:\n"
+	"Leave Thresholds:\n"
+	"normal: 0, 0MB, Rem: -160MB:\n"
+	"low: 94, 188MB, Rem: 28MB:\n"
+	"critical: 108, 216MB, Rem: 56MB:\n"
+	"reboot: 112, 224MB, Rem: 64MB:\n";
+
+class MemorySamplerTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testScanField();
+	void testScanMemnotify();
+	void testScanStatm();
+	void testStatusFile();
+	void testRollupFile();
+	void testGoneProcess();
+	void testSelf();
+
+	void benchIfstreamStatus();
+	void benchSampler();
+
+private:
+
+	void writeFile(const QString& path, const char* contents);
+	QString processDir(const QTemporaryDir& root, int pid);
+};
+
+void MemorySamplerTest::writeFile(const QString& path, const char* contents)
+{
+	QFile file(path);
+	QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	file.write(contents);
+}
+
+QString MemorySamplerTest::processDir(const QTemporaryDir& root, int pid)
+{
+	QString dir = QString("%1/%2").arg(root.path()).arg(pid);
+	QDir().mkpath(dir);
+	return dir;
+}
+
+void MemorySamplerTest::testScanField()
+{
+	int value = 0;
+	QVERIFY(MemorySampler::scanField(s_status, strlen(s_status), "VmRSS", value));
+	QCOMPARE(value, 20480);
+	QVERIFY(MemorySampler::scanField(s_status, strlen(s_status), "VmSwap", value));
+	QCOMPARE(value, 4096);
+
+	// whole labels at the start of a line only
+	QVERIFY(!MemorySampler::scanField(s_status, strlen(s_status), "Vm", value));
+	QVERIFY(!MemorySampler::scanField(s_status, strlen(s_status), "RSS", value));
+	QVERIFY(MemorySampler::scanField(s_rollup, strlen(s_rollup), "Swap", value));
+	QCOMPARE(value, 4096);
+
+	const char* units = "A: 3 mB\nB: 4096\n";
+	QVERIFY(MemorySampler::scanField(units, strlen(units), "A", value));
+	QCOMPARE(value, 3 * 1024);
+	QVERIFY(MemorySampler::scanField(units, strlen(units), "B", value));
+	QCOMPARE(value, 4);
+
+	// cut short
+	QVERIFY(!MemorySampler::scanField(s_status, strstr(s_status, "VmSwap") + 6 - s_status, "VmSwap", value));
+}
+
+void MemorySamplerTest::testScanMemnotify()
+{
+	int low, critical, reboot;
+	QVERIFY(MemorySampler::scanMemnotify(s_memnotify, strlen(s_memnotify), low, critical, reboot));
+	QCOMPARE(low, 40);
+	QCOMPARE(critical, 68);
+	QCOMPARE(reboot, 80);
+
+	const char* noSection = "low: 94, 188MB, Rem: 28MB:\n";
+	QVERIFY(!MemorySampler::scanMemnotify(noSection, strlen(noSection), low, critical, reboot));
+}
+
+void MemorySamplerTest::testScanStatm()
+{
+	const char* statm = "5342 761 530 1 0 231 0\n";
+	long pages = 0;
+	QVERIFY(MemorySampler::scanStatmRss(statm, strlen(statm), pages));
+	QCOMPARE(pages, 761L);
+	QVERIFY(!MemorySampler::scanStatmRss("5342", 4, pages));
+}
+
+void MemorySamplerTest::testStatusFile()
+{
+	QTemporaryDir root;
+	writeFile(processDir(root, 100) + "/status", s_status);
+
+	MemorySampler sampler(root.path().toUtf8().constData(), "/nonexistent");
+	MemorySampler::ProcessSample sample;
+	QVERIFY(sampler.sampleProcess(100, sample));
+	QCOMPARE(sample.rssKb, 20480);
+	QCOMPARE(sample.swapKb, 4096);
+	QCOMPARE(sample.pssKb, -1);
+	QCOMPARE(sample.totalMb(), 24);
+	QCOMPARE(sampler.openFileCount(), 1u);
+
+	// the same descriptor reads what the file says now
+	writeFile(root.path() + "/100/status", "VmRSS:\t1024 kB\nVmSwap:\t0 kB\n");
+	QVERIFY(sampler.sampleProcess(100, sample));
+	QCOMPARE(sample.totalMb(), 1);
+	QCOMPARE(sampler.openFileCount(), 1u);
+
+	int low, critical, reboot;
+	QVERIFY(!sampler.memnotifyEnterRem(low, critical, reboot));
+	QCOMPARE(low, -1);
+}
+
+void MemorySamplerTest::testRollupFile()
+{
+	QTemporaryDir root;
+	QString dir = processDir(root, 200);
+	writeFile(dir + "/status", s_status);
+	writeFile(dir + "/smaps_rollup", s_rollup);
+	writeFile(root.path() + "/meminfo", s_memnotify);
+
+	MemorySampler sampler(root.path().toUtf8().constData(), (root.path() + "/meminfo").toUtf8().constData());
+
+	std::vector<pid_t> pids;
+	pids.push_back(200);
+	pids.push_back(201);
+	MemorySampler::ProcessSamples samples;
+	sampler.sampleProcesses(pids, samples);
+	QCOMPARE(samples.size(), (size_t) 1);
+	QCOMPARE(samples[200].rssKb, 20480);
+	QCOMPARE(samples[200].pssKb, 10240);
+	QCOMPARE(samples[200].swapPssKb, 2048);
+	QCOMPARE(samples[200].totalMb(), 12);
+
+	int low, critical, reboot;
+	QVERIFY(sampler.memnotifyEnterRem(low, critical, reboot));
+	QCOMPARE(critical, 68);
+	QCOMPARE(sampler.openFileCount(), 2u);
+}
+
+void MemorySamplerTest::testGoneProcess()
+{
+	QTemporaryDir root;
+	writeFile(processDir(root, 300) + "/status", s_status);
+
+	MemorySampler sampler(root.path().toUtf8().constData(), "/nonexistent");
+	MemorySampler::ProcessSample sample;
+	QVERIFY(sampler.sampleProcess(300, sample));
+
+	// what a zombie's status looks like
+	writeFile(root.path() + "/300/status", "Name:\tcom.example.app\nState:\tZ (zombie)\n");
+	QVERIFY(!sampler.sampleProcess(300, sample));
+	QCOMPARE(sampler.openFileCount(), 0u);
+
+	QVERIFY(!sampler.sampleProcess(301, sample));
+	QCOMPARE(sampler.openFileCount(), 0u);
+}
+
+void MemorySamplerTest::testSelf()
+{
+	MemorySampler sampler;
+	QVERIFY(sampler.selfRssPages() > 0);
+
+	MemorySampler::ProcessSample sample;
+	QVERIFY(sampler.sampleProcess(getpid(), sample));
+	QVERIFY(sample.rssKb > 0);
+	QVERIFY(sample.swapKb >= 0);
+}
+
+// what MemoryMonitor::getProcessMemInfo() did for every monitored process on every tick
+static int ifstreamProcessMem(pid_t pid)
+{
+	char fileName[128];
+	snprintf(fileName, sizeof(fileName), "/proc/%d/status", pid);
+	std::ifstream status(fileName);
+	if (!status)
+		return -1;
+
+	int procRss = -1, procSwap = -1;
+	std::string field, label;
+	while (status >> field) {
+		field = field.substr(0, field.length() - 1);
+		if (field == "VmRSS") {
+			status >> procRss >> label;
+			if (!strcasecmp(label.c_str(), "kb"))
+				procRss /= 1024;
+			if (procSwap != -1)
+				break;
+		}
+		else if (field == "VmSwap") {
+			status >> procSwap >> label;
+			if (!strcasecmp(label.c_str(), "kb"))
+				procSwap /= 1024;
+			if (procRss != -1)
+				break;
+		}
+	}
+	return (procRss == -1 || procSwap == -1) ? -1 : procRss + procSwap;
+}
+
+void MemorySamplerTest::benchIfstreamStatus()
+{
+	int mem = 0;
+	QBENCHMARK {
+		mem = ifstreamProcessMem(getpid());
+	}
+	QVERIFY(mem >= 0);
+}
+
+void MemorySamplerTest::benchSampler()
+{
+	MemorySampler sampler;
+	std::vector<pid_t> pids(1, getpid());
+	MemorySampler::ProcessSamples samples;
+	QBENCHMARK {
+		sampler.sampleProcesses(pids, samples);
+	}
+	QCOMPARE(samples.size(), (size_t) 1);
+}
+
+QTEST_MAIN(MemorySamplerTest)
+
+#include "sysmgrtst_MemorySampler.moc"
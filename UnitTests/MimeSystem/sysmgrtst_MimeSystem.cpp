@@ -0,0 +1,409 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+#include <QThread>
+
+#include <vector>
+#include <string>
+
+#include <glib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "MimeSystem.h"
+#include "Settings.h"
+
+// -------------------------------------------------------------------------
+
+static const int kStableResources = 400;
+static const int kStableRedirects = 100;
+static const int kLookupsPerReader = 20000;
+
+static const char* kSavedTablePath = "/tmp/sysmgrtst_MimeSystem-active.json";
+static const char* kStorePath = "/tmp/sysmgrtst_MimeSystem-active.tbl";
+static const char* kStoreLogPath = "/tmp/sysmgrtst_MimeSystem-active.log";
+static const char* kJsonCopyPath = "/tmp/sysmgrtst_MimeSystem-copy.json";
+
+static off_t fileSize(const char* path)
+{
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return -1;
+	return st.st_size;
+}
+
+static std::string stableMimeType(int i)
+{
+	gchar* s = g_strdup_printf("application/x-stable-%04d", i);
+	std::string r(s);
+	g_free(s);
+	return r;
+}
+
+static std::string stableScheme(int i)
+{
+	gchar* s = g_strdup_printf("x-stable%04d:", i);
+	std::string r(s);
+	g_free(s);
+	return r;
+}
+
+// looks up handlers that are never removed; any miss means a reader saw a half-updated table
+class LookupThread : public QThread
+{
+public:
+	LookupThread(int lookups) : m_lookups(lookups), m_misses(0) {}
+
+	int misses() const { return m_misses; }
+
+protected:
+	virtual void run() {
+		MimeSystem* mimeSystem = MimeSystem::instance();
+		for (int i = 0; i < m_lookups; i++) {
+			int n = (i * 7919) % kStableResources;
+			if (mimeSystem->getActiveAppIdForResource(stableMimeType(n)).empty())
+				m_misses++;
+
+			std::string params;
+			uint32_t index = 0;
+			if (mimeSystem->getAppIdByVerbForResource(stableMimeType(n), "open", params, index).empty())
+				m_misses++;
+
+			n = i % kStableRedirects;
+			if (mimeSystem->getActiveAppIdForRedirect(stableScheme(n) + "target", false, false).empty())
+				m_misses++;
+		}
+	}
+
+private:
+	int m_lookups;
+	int m_misses;
+};
+
+// adds, swaps and removes handlers for its own churn entries until told to stop
+class MutationThread : public QThread
+{
+public:
+	MutationThread() : m_stop(0), m_mutations(0) {}
+
+	void stop() { g_atomic_int_set(&m_stop, 1); }
+	int mutations() const { return m_mutations; }
+
+protected:
+	virtual void run() {
+		MimeSystem* mimeSystem = MimeSystem::instance();
+		std::map<std::string, std::string> verbs;
+		verbs["open"] = "{}";
+
+		for (int i = 0; !g_atomic_int_get(&m_stop); i++) {
+			gchar* mime = g_strdup_printf("application/x-churn-%d", i % 32);
+			gchar* url = g_strdup_printf("^x-churn%d:", i % 32);
+			std::string extension;
+
+			mimeSystem->addResourceHandler(extension, mime, true, "com.example.churn.a", &verbs, false);
+			mimeSystem->addResourceHandler(extension, mime, true, "com.example.churn.b", &verbs, false);
+			mimeSystem->addRedirectHandler(url, "com.example.churn.a", NULL, true, false);
+
+			ResourceHandler r_active;
+			std::vector<ResourceHandler> r_alternates;
+			if (mimeSystem->getAllHandlersForResource(mime, r_active, r_alternates) > 1)
+				mimeSystem->swapResourceHandler(mime, r_alternates[0].index());
+
+			// and something that touches a stable node without taking it away
+			mimeSystem->addVerbsToResourceHandler(stableMimeType(i % kStableResources), "com.example.stable", verbs);
+
+			mimeSystem->removeAllForMimeType(mime);
+			mimeSystem->removeAllForUrl(url);
+			m_mutations += 6;
+
+			g_free(mime);
+			g_free(url);
+		}
+	}
+
+private:
+	volatile gint m_stop;
+	int m_mutations;
+};
+
+// -------------------------------------------------------------------------
+
+class MimeSystemTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	int runReaders(int readers, bool mutate);
+
+private Q_SLOTS:
+
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testLookupsDuringMutation();
+	void testStoreRoundTrip();
+	void testScheduledSaveBatches();
+
+	void benchSaveAfterChange_data();
+	void benchSaveAfterChange();
+
+	void benchLookupThroughput_data();
+	void benchLookupThroughput();
+};
+
+void MimeSystemTest::initTestCase()
+{
+	Settings::LunaSettings()->lunaCmdHandlerSavedPath = kSavedTablePath;
+	MimeSystem::deleteSavedMimeTable();
+
+	MimeSystem* mimeSystem = MimeSystem::instance();
+	mimeSystem->clearMimeTable();
+
+	std::map<std::string, std::string> verbs;
+	verbs["open"] = "{}";
+
+	for (int i = 0; i < kStableResources; i++) {
+		std::string extension;
+		mimeSystem->addResourceHandler(extension, stableMimeType(i), true, "com.example.stable", NULL, false);
+		mimeSystem->addVerbsToResourceHandler(stableMimeType(i), "com.example.stable", verbs);
+	}
+
+	for (int i = 0; i < kStableRedirects; i++)
+		mimeSystem->addRedirectHandler("^" + stableScheme(i), "com.example.stable", NULL, true, false);
+}
+
+void MimeSystemTest::cleanupTestCase()
+{
+	MimeSystem::instance()->clearMimeTable();
+	MimeSystem::deleteSavedMimeTable();
+	unlink(kJsonCopyPath);
+}
+
+int MimeSystemTest::runReaders(int readers, bool mutate)
+{
+	MutationThread mutator;
+	if (mutate)
+		mutator.start();
+
+	std::vector<LookupThread*> threads;
+	for (int i = 0; i < readers; i++) {
+		threads.push_back(new LookupThread(kLookupsPerReader));
+		threads.back()->start();
+	}
+
+	int misses = 0;
+	for (unsigned int i = 0; i < threads.size(); i++) {
+		threads[i]->wait();
+		misses += threads[i]->misses();
+		delete threads[i];
+	}
+
+	if (mutate) {
+		mutator.stop();
+		mutator.wait();
+	}
+
+	return misses;
+}
+
+void MimeSystemTest::testLookupsDuringMutation()
+{
+	QCOMPARE(runReaders(4, true), 0);
+
+	// the churn entries are all gone again and the stable ones are untouched
+	MimeSystem* mimeSystem = MimeSystem::instance();
+	QVERIFY(mimeSystem->getActiveAppIdForResource("application/x-churn-0").empty());
+	QVERIFY(mimeSystem->getActiveAppIdForRedirect("x-churn0:target", false, false).empty());
+	QCOMPARE(mimeSystem->getActiveAppIdForResource(stableMimeType(0)), std::string("com.example.stable"));
+}
+
+void MimeSystemTest::testStoreRoundTrip()
+{
+	MimeSystem* mimeSystem = MimeSystem::instance();
+	std::string err;
+
+	// the first save after a wholesale change writes the snapshot
+	MimeSystem::deleteSavedMimeTable();
+	QVERIFY(mimeSystem->saveMimeTableToActiveFile(err));
+	QVERIFY(fileSize(kStorePath) > 0);
+	QVERIFY(fileSize(kStoreLogPath) < 0);
+	off_t snapshotSize = fileSize(kStorePath);
+
+	// a couple of changes only go to the log
+	std::map<std::string, std::string> verbs;
+	verbs["edit"] = "{\"mode\":\"rw\"}";
+	std::string extension = "tst";
+	mimeSystem->addResourceHandler(extension, "application/x-roundtrip", false, "com.example.first", &verbs, false);
+	mimeSystem->addResourceHandler(extension, "application/x-roundtrip", false, "com.example.second", &verbs, false);
+	ResourceHandler active;
+	std::vector<ResourceHandler> alternates;
+	mimeSystem->getAllHandlersForResource("application/x-roundtrip", active, alternates);
+	mimeSystem->swapResourceHandler("application/x-roundtrip", alternates[0].index());
+	mimeSystem->removeAllForUrl("^" + stableScheme(0));
+	QVERIFY(mimeSystem->saveMimeTableToActiveFile(err));
+
+	QCOMPARE(fileSize(kStorePath), snapshotSize);
+	QVERIFY(fileSize(kStoreLogPath) > 0);
+
+	std::string params;
+	uint32_t index = 0;
+	std::string verbAppId = mimeSystem->getAppIdByVerbForResource("application/x-roundtrip", "edit", params, index);
+	QVERIFY(!verbAppId.empty());
+
+	// and all of it comes back
+	mimeSystem->clearMimeTable();
+	QVERIFY(mimeSystem->getActiveAppIdForResource(stableMimeType(1)).empty());
+	QVERIFY(mimeSystem->restoreMimeTableFromStore(err));
+
+	QCOMPARE(mimeSystem->getActiveAppIdForResource("application/x-roundtrip"), std::string("com.example.second"));
+	QCOMPARE(mimeSystem->getAllHandlersForResource("application/x-roundtrip", active, alternates), 2);
+	std::string mimeType;
+	QVERIFY(mimeSystem->getMimeTypeByExtension("tst", mimeType));
+	QCOMPARE(mimeType, std::string("application/x-roundtrip"));
+	QVERIFY(mimeSystem->getActiveAppIdForRedirect(stableScheme(0) + "target", false, false).empty());
+	QCOMPARE(mimeSystem->getActiveAppIdForRedirect(stableScheme(1) + "target", false, false), std::string("com.example.stable"));
+
+	// the verb cache still points at the same handler, even though the handler indexes were handed out anew
+	QCOMPARE(mimeSystem->getAppIdByVerbForResource("application/x-roundtrip", "edit", params, index), verbAppId);
+	QCOMPARE(params, std::string("{\"mode\":\"rw\"}"));
+	for (int i = 0; i < kStableResources; i++)
+		QCOMPARE(mimeSystem->getActiveAppIdForResource(stableMimeType(i)), std::string("com.example.stable"));
+
+	// a record cut short by a crash is dropped, the ones before it aren't
+	FILE* fp = fopen(kStoreLogPath, "a");
+	QVERIFY(fp);
+	fwrite("\x40\0\0\0\x12\x34", 1, 6, fp);
+	fclose(fp);
+	mimeSystem->clearMimeTable();
+	QVERIFY(mimeSystem->restoreMimeTableFromStore(err));
+	QCOMPARE(mimeSystem->getActiveAppIdForResource("application/x-roundtrip"), std::string("com.example.second"));
+
+	mimeSystem->removeAllForMimeType("application/x-roundtrip");
+	mimeSystem->addRedirectHandler("^" + stableScheme(0), "com.example.stable", NULL, true, false);
+	QVERIFY(mimeSystem->saveMimeTableToActiveFile(err));
+}
+
+void MimeSystemTest::testScheduledSaveBatches()
+{
+	MimeSystem* mimeSystem = MimeSystem::instance();
+	std::string err;
+	QVERIFY(mimeSystem->saveMimeTableToActiveFile(err));
+	unsigned int writes = mimeSystem->activeFileWrites();
+	unsigned int syncs = mimeSystem->activeFileSyncs();
+
+	// what the service handlers do: a change, then ask for a save, over and over
+	const int kChanges = 20;
+	for (int i = 0; i < kChanges; i++) {
+		gchar* mime = g_strdup_printf("application/x-batched-%d", i);
+		std::string extension;
+		mimeSystem->addResourceHandler(extension, mime, true, "com.example.batched", NULL, false);
+		g_free(mime);
+		mimeSystem->scheduleSaveToActiveFile();
+	}
+
+	// every change is in the file before the caller hears back, only the syncs wait
+	QCOMPARE(mimeSystem->activeFileWrites(), writes + kChanges);
+	QCOMPARE(mimeSystem->activeFileSyncs(), syncs);
+	mimeSystem->clearMimeTable();
+	QVERIFY(mimeSystem->restoreMimeTableFromStore(err));
+	QCOMPARE(mimeSystem->getActiveAppIdForResource("application/x-batched-19"), std::string("com.example.batched"));
+
+	// the timeout syncs them all at once
+	for (int waited = 0; (mimeSystem->activeFileSyncs() == syncs) && (waited < 2000); waited += 10) {
+		while (g_main_context_iteration(NULL, FALSE)) {}
+		usleep(10 * 1000);
+	}
+	QCOMPARE(mimeSystem->activeFileSyncs(), syncs + 1);
+	QVERIFY(mimeSystem->flushScheduledSave(err));
+	QCOMPARE(mimeSystem->activeFileSyncs(), syncs + 1);
+
+	// a save that is due anyway takes the scheduled sync along
+	mimeSystem->removeAllForMimeType("application/x-batched-0");
+	mimeSystem->scheduleSaveToActiveFile();
+	syncs = mimeSystem->activeFileSyncs();
+	QVERIFY(mimeSystem->flushScheduledSave(err));
+	QCOMPARE(mimeSystem->activeFileSyncs(), syncs + 1);
+	QVERIFY(mimeSystem->flushScheduledSave(err));
+	QCOMPARE(mimeSystem->activeFileSyncs(), syncs + 1);
+
+	for (int i = 1; i < kChanges; i++) {
+		gchar* mime = g_strdup_printf("application/x-batched-%d", i);
+		mimeSystem->removeAllForMimeType(mime);
+		g_free(mime);
+	}
+	QVERIFY(mimeSystem->saveMimeTableToActiveFile(err));
+}
+
+void MimeSystemTest::benchSaveAfterChange_data()
+{
+	QTest::addColumn<bool>("incremental");
+
+	QTest::newRow("full json rewrite") << false;
+	QTest::newRow("incremental store") << true;
+}
+
+void MimeSystemTest::benchSaveAfterChange()
+{
+	QFETCH(bool, incremental);
+
+	MimeSystem* mimeSystem = MimeSystem::instance();
+	std::string err;
+	int n = 0;
+
+	// what a bulk install does: one handler change, one save, over and over
+	QBENCHMARK {
+		gchar* mime = g_strdup_printf("application/x-bench-%d", n++ % 64);
+		std::string extension;
+		mimeSystem->addResourceHandler(extension, mime, true, "com.example.bench", NULL, false);
+		g_free(mime);
+
+		if (incremental)
+			mimeSystem->saveMimeTableToActiveFile(err);
+		else
+			mimeSystem->saveMimeTable(kJsonCopyPath, err);
+	}
+}
+
+void MimeSystemTest::benchLookupThroughput_data()
+{
+	QTest::addColumn<int>("readers");
+	QTest::addColumn<bool>("mutate");
+
+	QTest::newRow("1 reader") << 1 << false;
+	QTest::newRow("4 readers") << 4 << false;
+	QTest::newRow("1 reader, mutating") << 1 << true;
+	QTest::newRow("4 readers, mutating") << 4 << true;
+}
+
+void MimeSystemTest::benchLookupThroughput()
+{
+	QFETCH(int, readers);
+	QFETCH(bool, mutate);
+
+	// every reader does the same fixed amount of lookups; flat times across rows mean readers don't wait
+	QBENCHMARK {
+		QCOMPARE(runReaders(readers, mutate), 0);
+	}
+}
+
+QTEST_MAIN(MimeSystemTest)
+#include "sysmgrtst_MimeSystem.moc"
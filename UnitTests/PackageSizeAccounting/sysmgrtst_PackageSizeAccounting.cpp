@@ -0,0 +1,334 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "PackageSizeAccounting.h"
+
+#define BLOCK_SIZE		4096
+#define INSTALLER		"1.0.0"
+
+// -------------------------------------------------------------------------
+// the nftw() walk ApplicationInstaller used to do, as the reference
+
+static uint64_t s_refBlocks;
+static std::string s_refBaseDir;
+
+static int refCallback(const char* fpath, const struct stat* sb, int typeflag, struct FTW* ftwbuf)
+{
+	if (s_refBaseDir == fpath)
+		return 0;
+
+	if (typeflag == FTW_DP)
+		s_refBlocks += 1;
+	else
+		s_refBlocks += ((uint64_t) sb->st_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	return 0;
+}
+
+static uint64_t referenceSize(const QString& dirPath)
+{
+	s_refBlocks = 0;
+	s_refBaseDir = dirPath.toStdString();
+	nftw(s_refBaseDir.c_str(), refCallback, 20, FTW_PHYS | FTW_DEPTH);
+	return s_refBlocks * BLOCK_SIZE;
+}
+
+// -------------------------------------------------------------------------
+
+class PackageSizeAccountingTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	// a package folder with some nesting, odd file sizes and a symlink
+	void makePackage(const QString& path, int dirs, int filesPerDir);
+	void makePackages(int count, int dirs, int filesPerDir);
+
+	QTemporaryDir* m_dir;
+	QString m_manifestDir;
+	std::vector<PackageSizeAccounting::Package> m_packages;
+
+private Q_SLOTS:
+
+	void init();
+	void cleanup();
+
+	void testWalkMatchesReference();
+	void testMeasureMatchesReference();
+	void testReuse();
+	void testManifestSurvivesRestart();
+	void testChangeInvalidates();
+	void testVersionInvalidates();
+	void testDuplicateIds();
+	void testForget();
+
+	void benchSerialWalks_data();
+	void benchSerialWalks();
+	void benchBatchMeasure_data();
+	void benchBatchMeasure();
+};
+
+void PackageSizeAccountingTest::makePackage(const QString& path, int dirs, int filesPerDir)
+{
+	QDir().mkpath(path);
+	for (int d = 0; d < dirs; d++) {
+		QString dirPath = QString("%1/d%2/sub").arg(path).arg(d);
+		QDir().mkpath(dirPath);
+		for (int f = 0; f < filesPerDir; f++) {
+			QFile file(QString("%1/f%2").arg(d % 2 ? dirPath : dirPath + "/..").arg(f));
+			QVERIFY(file.open(QIODevice::WriteOnly));
+			file.write(QByteArray((f * 373 + d * 17) % 9000, 'x'));
+		}
+	}
+	QVERIFY(symlink("/etc/passwd", QString(path + "/link").toLocal8Bit().constData()) == 0);
+}
+
+void PackageSizeAccountingTest::makePackages(int count, int dirs, int filesPerDir)
+{
+	m_packages.clear();
+	for (int i = 0; i < count; i++) {
+		QString base = QString("%1/pkg%2").arg(m_dir->path()).arg(i);
+		makePackage(base + "/app", dirs, filesPerDir);
+		makePackage(base + "/service", 1, filesPerDir);
+
+		PackageSizeAccounting::Package package;
+		package.id = QString("com.example.pkg%1").arg(i).toStdString();
+		package.version = "1.0.0";
+		package.blockSize = BLOCK_SIZE;
+		package.folders.push_back((base + "/app/").toStdString());
+		package.folders.push_back((base + "/service").toStdString());
+		package.folders.push_back((base + "/notyet").toStdString());
+		m_packages.push_back(package);
+	}
+}
+
+void PackageSizeAccountingTest::init()
+{
+	m_dir = new QTemporaryDir;
+	QVERIFY(m_dir->isValid());
+	m_manifestDir = m_dir->path() + "/manifests";
+	QDir().mkpath(m_manifestDir);
+}
+
+void PackageSizeAccountingTest::cleanup()
+{
+	m_packages.clear();
+	delete m_dir;
+	m_dir = 0;
+}
+
+void PackageSizeAccountingTest::testWalkMatchesReference()
+{
+	QString path = m_dir->path() + "/single";
+	makePackage(path, 6, 40);
+
+	PackageSizeAccounting::Walk walk;
+	QVERIFY(PackageSizeAccounting::walk(path.toStdString(), BLOCK_SIZE, walk));
+	QCOMPARE(walk.blocks * BLOCK_SIZE, referenceSize(path));
+	QVERIFY(walk.files.empty());
+
+	PackageSizeAccounting::Walk missing;
+	QVERIFY(!PackageSizeAccounting::walk((path + "/nothere").toStdString(), BLOCK_SIZE, missing));
+	QCOMPARE(missing.blocks, (uint64_t)0);
+}
+
+void PackageSizeAccountingTest::testMeasureMatchesReference()
+{
+	makePackages(8, 4, 30);
+
+	PackageSizeAccounting accounting(m_manifestDir.toStdString(), INSTALLER);
+	accounting.measure(m_packages, false);
+
+	for (unsigned int i = 0; i < m_packages.size(); i++) {
+		const PackageSizeAccounting::Package& package = m_packages[i];
+		uint64_t expected = referenceSize(QString::fromStdString(package.folders[0]).remove(QRegExp("/$")))
+			+ referenceSize(QString::fromStdString(package.folders[1]));
+		QCOMPARE(package.size, expected);
+		QVERIFY(!package.fromCache);
+		QVERIFY(QFile::exists(QString::fromStdString(accounting.manifestPath(package.id))));
+	}
+	QCOMPARE(accounting.walks(), (unsigned int)m_packages.size());
+}
+
+void PackageSizeAccountingTest::testReuse()
+{
+	makePackages(4, 2, 10);
+
+	PackageSizeAccounting accounting(m_manifestDir.toStdString(), INSTALLER);
+	accounting.measure(m_packages, true);
+	std::vector<PackageSizeAccounting::Package> first = m_packages;
+
+	accounting.measure(m_packages, true);
+	for (unsigned int i = 0; i < m_packages.size(); i++) {
+		QVERIFY(m_packages[i].fromCache);
+		QCOMPARE(m_packages[i].size, first[i].size);
+	}
+	QCOMPARE(accounting.cacheHits(), (unsigned int)m_packages.size());
+	QCOMPARE(accounting.walks(), (unsigned int)m_packages.size());
+}
+
+void PackageSizeAccountingTest::testManifestSurvivesRestart()
+{
+	makePackages(4, 2, 10);
+
+	PackageSizeAccounting before(m_manifestDir.toStdString(), INSTALLER);
+	before.measure(m_packages, false);
+	std::vector<PackageSizeAccounting::Package> first = m_packages;
+
+	PackageSizeAccounting after(m_manifestDir.toStdString(), INSTALLER);
+	after.measure(m_packages, true);
+	for (unsigned int i = 0; i < m_packages.size(); i++) {
+		QVERIFY(m_packages[i].fromCache);
+		QCOMPARE(m_packages[i].size, first[i].size);
+	}
+	QCOMPARE(after.manifestHits(), (unsigned int)m_packages.size());
+	QCOMPARE(after.walks(), 0u);
+
+	// another installer version doesn't trust them
+	PackageSizeAccounting newer(m_manifestDir.toStdString(), "1.0.1");
+	newer.measure(m_packages, true);
+	QCOMPARE(newer.walks(), (unsigned int)m_packages.size());
+}
+
+void PackageSizeAccountingTest::testChangeInvalidates()
+{
+	makePackages(4, 3, 10);
+
+	PackageSizeAccounting accounting(m_manifestDir.toStdString(), INSTALLER);
+	accounting.measure(m_packages, true);
+	std::vector<PackageSizeAccounting::Package> first = m_packages;
+
+	// a file deep inside one package, and a folder that didn't exist for another
+	QFile file(QString::fromStdString(m_packages[1].folders[0]) + "d1/sub/added");
+	QVERIFY(file.open(QIODevice::WriteOnly));
+	file.write("hello");
+	file.close();
+	QVERIFY(QDir().mkpath(QString::fromStdString(m_packages[2].folders[2])));
+
+	accounting.measure(m_packages, true);
+	QVERIFY(m_packages[0].fromCache);
+	QVERIFY(!m_packages[1].fromCache);
+	QVERIFY(!m_packages[2].fromCache);
+	QVERIFY(m_packages[3].fromCache);
+	QCOMPARE(m_packages[1].size, first[1].size + BLOCK_SIZE);
+}
+
+void PackageSizeAccountingTest::testVersionInvalidates()
+{
+	makePackages(2, 1, 5);
+
+	PackageSizeAccounting accounting(m_manifestDir.toStdString(), INSTALLER);
+	accounting.measure(m_packages, true);
+
+	m_packages[0].version = "2.0.0";
+	accounting.measure(m_packages, true);
+	QVERIFY(!m_packages[0].fromCache);
+	QVERIFY(m_packages[1].fromCache);
+}
+
+void PackageSizeAccountingTest::testDuplicateIds()
+{
+	makePackages(2, 2, 5);
+
+	// the same package asked for twice in one batch
+	m_packages.insert(m_packages.begin() + 1, m_packages[0]);
+	m_packages.push_back(m_packages[0]);
+
+	PackageSizeAccounting accounting(m_manifestDir.toStdString(), INSTALLER);
+	accounting.measure(m_packages, true);
+	QCOMPARE(accounting.walks(), 2u);
+	QVERIFY(m_packages[0].size > 0);
+	QCOMPARE(m_packages[1].size, m_packages[0].size);
+	QCOMPARE(m_packages[3].size, m_packages[0].size);
+	QVERIFY(!m_packages[3].fromCache);
+
+	accounting.measure(m_packages, true);
+	QCOMPARE(accounting.walks(), 2u);
+	QCOMPARE(accounting.cacheHits(), 2u);
+	QVERIFY(m_packages[3].fromCache);
+	QCOMPARE(m_packages[3].size, m_packages[0].size);
+}
+
+void PackageSizeAccountingTest::testForget()
+{
+	makePackages(1, 1, 5);
+
+	PackageSizeAccounting accounting(m_manifestDir.toStdString(), INSTALLER);
+	accounting.measure(m_packages, true);
+	QString manifest = QString::fromStdString(accounting.manifestPath(m_packages[0].id));
+	QVERIFY(QFile::exists(manifest));
+
+	accounting.forget(m_packages[0].id);
+	QVERIFY(!QFile::exists(manifest));
+
+	accounting.measure(m_packages, true);
+	QVERIFY(!m_packages[0].fromCache);
+}
+
+void PackageSizeAccountingTest::benchSerialWalks_data()
+{
+	QTest::addColumn<int>("packages");
+	QTest::newRow("8") << 8;
+	QTest::newRow("32") << 32;
+}
+
+// one package after the other, as servicecallback_getSizeOf used to
+void PackageSizeAccountingTest::benchSerialWalks()
+{
+	QFETCH(int, packages);
+	makePackages(packages, 8, 40);
+
+	QBENCHMARK {
+		for (unsigned int i = 0; i < m_packages.size(); i++) {
+			for (unsigned int j = 0; j < m_packages[i].folders.size(); j++) {
+				PackageSizeAccounting::Walk walk(true);
+				PackageSizeAccounting::walk(m_packages[i].folders[j], BLOCK_SIZE, walk);
+			}
+		}
+	}
+}
+
+void PackageSizeAccountingTest::benchBatchMeasure_data()
+{
+	benchSerialWalks_data();
+}
+
+// all of them in one measure(), without the manifests
+void PackageSizeAccountingTest::benchBatchMeasure()
+{
+	QFETCH(int, packages);
+	makePackages(packages, 8, 40);
+
+	PackageSizeAccounting accounting("", INSTALLER);
+	QBENCHMARK {
+		accounting.measure(m_packages, false);
+	}
+}
+
+QTEST_MAIN(PackageSizeAccountingTest)
+
+#include "sysmgrtst_PackageSizeAccounting.moc"
@@ -0,0 +1,150 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include "ReclaimPolicy.h"
+
+static const uint64_t kMinute = 60 * 1000;
+
+static ReclaimPolicy::Candidate candidate(const char* appId, int memoryMb, uint64_t idleMs, bool handlesRelaunch = false)
+{
+	ReclaimPolicy::Candidate c;
+	c.appId = appId;
+	c.pid = 100;
+	c.memoryMb = memoryMb;
+	c.idleMs = idleMs;
+	c.handlesRelaunch = handlesRelaunch;
+	return c;
+}
+
+static ReclaimPolicy::Candidate foreground(const char* appId, int memoryMb, uint64_t idleMs)
+{
+	ReclaimPolicy::Candidate c = candidate(appId, memoryMb, idleMs);
+	c.foreground = true;
+	return c;
+}
+
+static QStringList appIds(const std::vector<ReclaimPolicy::Candidate>& candidates)
+{
+	QStringList ids;
+	for (size_t i = 0; i < candidates.size(); i++)
+		ids << QString::fromStdString(candidates[i].appId);
+	return ids;
+}
+
+class ReclaimPolicyTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testScore();
+	void testNormal();
+	void testForegroundKept();
+	void testMedium();
+	void testLow();
+	void testCritical();
+};
+
+void ReclaimPolicyTest::testScore()
+{
+	// bigger, longer idle and relaunchable all go first
+	QVERIFY(ReclaimPolicy::score(candidate("a", 80, 0)) > ReclaimPolicy::score(candidate("a", 40, 0)));
+	QVERIFY(ReclaimPolicy::score(candidate("a", 40, 10 * kMinute)) > ReclaimPolicy::score(candidate("a", 40, kMinute)));
+	QVERIFY(ReclaimPolicy::score(candidate("a", 40, 0, true)) > ReclaimPolicy::score(candidate("a", 40, 0, false)));
+
+	// idle time stops counting after an hour
+	QCOMPARE(ReclaimPolicy::score(candidate("a", 40, 60 * kMinute)), ReclaimPolicy::score(candidate("a", 40, 600 * kMinute)));
+
+	// unknown memory still ranks
+	QVERIFY(ReclaimPolicy::score(candidate("a", -1, 10 * kMinute)) > 0);
+}
+
+void ReclaimPolicyTest::testNormal()
+{
+	std::vector<ReclaimPolicy::Candidate> candidates;
+	candidates.push_back(foreground("front", 50, 0));
+	candidates.push_back(candidate("back", 200, 60 * kMinute));
+
+	QVERIFY(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureNormal).empty());
+}
+
+void ReclaimPolicyTest::testForegroundKept()
+{
+	std::vector<ReclaimPolicy::Candidate> candidates;
+	candidates.push_back(foreground("front", 400, 60 * kMinute));
+	QVERIFY(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureCritical).empty());
+
+	// the one on screen stays however big and however long it has been there; having just been launched
+	// (in the background, say) doesn't make an app the foreground one
+	candidates.push_back(candidate("launched", 300, 0));
+	QCOMPARE(appIds(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureCritical)), QStringList() << "launched");
+	QVERIFY(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureMedium).empty());
+
+	// nothing on screen is ours
+	candidates.clear();
+	candidates.push_back(candidate("only", 300, 60 * kMinute));
+	QCOMPARE(appIds(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureMedium)), QStringList() << "only");
+}
+
+void ReclaimPolicyTest::testMedium()
+{
+	std::vector<ReclaimPolicy::Candidate> candidates;
+	candidates.push_back(foreground("front", 50, 0));
+	candidates.push_back(candidate("recent", 300, kMinute));
+	candidates.push_back(candidate("old", 40, 10 * kMinute));
+	candidates.push_back(candidate("older", 60, 20 * kMinute));
+
+	// one app, and only from those left alone a while
+	QCOMPARE(appIds(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureMedium)), QStringList() << "older");
+}
+
+void ReclaimPolicyTest::testLow()
+{
+	std::vector<ReclaimPolicy::Candidate> candidates;
+	candidates.push_back(foreground("front", 50, 0));
+	candidates.push_back(candidate("justLeft", 300, 10 * 1000));
+	candidates.push_back(candidate("a", 30, 5 * kMinute));
+	candidates.push_back(candidate("b", 40, 5 * kMinute, true));
+	candidates.push_back(candidate("c", 20, 5 * kMinute));
+
+	// highest score first, until LowReclaimMb is freed: b (relaunchable), a, then enough
+	QCOMPARE(appIds(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureLow)), QStringList() << "b" << "a");
+}
+
+void ReclaimPolicyTest::testCritical()
+{
+	std::vector<ReclaimPolicy::Candidate> candidates;
+	candidates.push_back(foreground("front", 50, 0));
+	candidates.push_back(candidate("justLeft", 100, 10 * 1000));
+	candidates.push_back(candidate("a", 10, 5 * kMinute));
+	candidates.push_back(candidate("b", 10, 5 * kMinute));
+
+	// any app but the foreground one, until CriticalReclaimMb is freed or nothing is left
+	QStringList selected = appIds(ReclaimPolicy::select(candidates, ReclaimPolicy::PressureCritical));
+	QCOMPARE(selected.size(), 3);
+	QVERIFY(!selected.contains("front"));
+	QCOMPARE(selected.first(), QString("justLeft"));
+}
+
+QTEST_MAIN(ReclaimPolicyTest)
+
+#include "sysmgrtst_ReclaimPolicy.moc"
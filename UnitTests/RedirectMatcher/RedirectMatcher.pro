@@ -0,0 +1,76 @@
+# @@@LICENSE
+#
+#      Copyright (c) 2013 LG Electronics, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# LICENSE@@@
+include(../unittest.pri)
+
+LIBS += -lcrypto
+
+TARGET = sysmgrtst_RedirectMatcher
+
+SOURCES += \
+	RedirectMatcher.cpp \
+	ApplicationDescription.cpp \
+	ApplicationStatus.cpp \
+	PackageDescription.cpp \
+	LaunchPoint.cpp \
+	LaunchPointSearchIndex.cpp \
+	ApplicationIndex.cpp \
+	KeywordMap.cpp \
+	CmdResourceHandlers.cpp \
+	MimeSystem.cpp \
+	MimeTableStore.cpp \
+	ApplicationManager.cpp \
+	ApplicationScanner.cpp \
+	ApplicationChangeJournal.cpp \
+	ApplicationManagerService.cpp \
+	ApplicationInstaller.cpp \
+	PackageSizeAccounting.cpp \
+	SignatureVerifier.cpp \
+	ListResponseCache.cpp \
+	LaunchPointChangeBatcher.cpp \
+	ApplicationProcessManager.cpp \
+	ApplicationZygote.cpp \
+	ServiceDescription.cpp \
+	DeviceInfo.cpp \
+	Settings.cpp \
+	LunaConf.cpp \
+	SystemService.cpp \
+	EventReporter.cpp \
+	Logging.cpp \
+	LogRingBuffer.cpp \
+	JSONUtils.cpp
+
+HEADERS += \
+	LogFilter.h \
+	LogRingBuffer.h \
+	RedirectMatcher.h \
+	CmdResourceHandlers.h \
+	MimeSystem.h \
+	ApplicationDescription.h \
+	ApplicationStatus.h \
+	PackageDescription.h \
+	PackageSizeAccounting.h \
+	SignatureVerifier.h \
+	ListResponseCache.h \
+	LaunchPointChangeBatcher.h \
+	InstallerCommandScheduler.h \
+	LaunchPoint.h \
+	ApplicationProcessManager.h \
+	ApplicationZygote.h \
+	ValidatedJsonMessage.h
+
+SOURCES += sysmgrtst_RedirectMatcher.cpp
@@ -0,0 +1,267 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include <glib.h>
+
+#include "RedirectMatcher.h"
+#include "CmdResourceHandlers.h"
+
+// -------------------------------------------------------------------------
+
+typedef std::map<std::string, RedirectHandler*> HandlerTable;
+
+// the pre-matcher lookup, kept here as the baseline
+static RedirectHandler* linearMatchFirst(const HandlerTable& table, const std::string& url, bool schemeForms, bool urlForms)
+{
+	for (HandlerTable::const_iterator it = table.begin(); it != table.end(); ++it) {
+		bool schemeForm = it->second->isSchemeForm();
+		if ((schemeForm && !schemeForms) || (!schemeForm && !urlForms))
+			continue;
+		if (it->second->matches(url))
+			return it->second;
+	}
+	return 0;
+}
+
+static void linearMatchAll(const HandlerTable& table, const std::string& url, std::vector<void*>& r_matches)
+{
+	for (HandlerTable::const_iterator it = table.begin(); it != table.end(); ++it) {
+		if (it->second->matches(url))
+			r_matches.push_back(it->second);
+	}
+}
+
+// -------------------------------------------------------------------------
+
+class RedirectMatcherTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	void addHandler(const std::string& urlRe, bool schemeForm);
+	void populate(int count);
+	void release();
+
+	HandlerTable m_table;
+	RedirectMatcher m_matcher;
+	std::vector<std::string> m_probeUrls;
+
+private Q_SLOTS:
+
+	void testRequiredLiteral_data();
+	void testRequiredLiteral();
+	void testLiteralScheme();
+	void testSharedRegexp();
+	void testConsistency();
+
+	void benchLinearMatch_data();
+	void benchLinearMatch();
+	void benchIndexedMatch_data();
+	void benchIndexedMatch();
+};
+
+void RedirectMatcherTest::addHandler(const std::string& urlRe, bool schemeForm)
+{
+	if (m_table.find(urlRe) != m_table.end())
+		return;
+	m_table[urlRe] = new RedirectHandler(urlRe, "com.example.handler", schemeForm);
+}
+
+void RedirectMatcherTest::populate(int count)
+{
+	release();
+
+	// what a device with a lot of apps installed looks like: mostly schemes, some url patterns
+	addHandler("^tel:", true);
+	addHandler("^mailto:", true);
+	addHandler("^(callto|wtai):", true);
+	addHandler("^https?://(www\\.)?youtube\\.com/watch.*", false);
+	addHandler("^https?://maps\\.google\\.com/", false);
+	addHandler("^file:///.*\\.mp3$", false);
+	addHandler("", false);
+
+	for (int i = 0; i < count; i++) {
+		gchar* re;
+		if (i % 4 == 0)
+			re = g_strdup_printf("^https?://(www\\.)?site%05d\\.example\\.com/.*", i);
+		else if (i % 4 == 1)
+			re = g_strdup_printf("^http://m\\.example\\.com/app%05d/", i);
+		else
+			re = g_strdup_printf("^x-app%05d:", i);
+		addHandler(re, i % 4 > 1);
+		g_free(re);
+	}
+
+	m_matcher.clear();
+	for (HandlerTable::iterator it = m_table.begin(); it != m_table.end(); ++it)
+		m_matcher.add(*(it->second), it->second);
+
+	const char* fixed[] = { "tel:5551212", "TEL:5551212", "callto:someone", "mailto:a@b.c",
+							"https://www.youtube.com/watch?v=1", "HTTP://YOUTUBE.COM/WATCH", "http://youtube.com/user",
+							"http://maps.google.com/?q=x", "file:///media/internal/a.MP3", "nocolon", "" };
+	for (unsigned int i = 0; i < G_N_ELEMENTS(fixed); i++)
+		m_probeUrls.push_back(fixed[i]);
+
+	// a spread of hits and misses across the synthetic handlers
+	for (int i = 0; i < 48; i++) {
+		int n = (i * 7919) % (count + count / 8 + 1);
+		gchar* url;
+		if (i % 3 == 0)
+			url = g_strdup_printf("http://site%05d.example.com/index.html", n);
+		else if (i % 3 == 1)
+			url = g_strdup_printf("http://m.example.com/app%05d/launch", n);
+		else
+			url = g_strdup_printf("x-app%05d:open", n);
+		m_probeUrls.push_back(url);
+		g_free(url);
+	}
+}
+
+void RedirectMatcherTest::release()
+{
+	m_matcher.clear();
+	for (HandlerTable::iterator it = m_table.begin(); it != m_table.end(); ++it)
+		delete it->second;
+	m_table.clear();
+	m_probeUrls.clear();
+}
+
+void RedirectMatcherTest::testRequiredLiteral_data()
+{
+	QTest::addColumn<QString>("urlRe");
+	QTest::addColumn<QString>("literal");
+
+	QTest::newRow("groups") << "^https?://(www\\.)?youtube\\.com/watch.*" << "youtube.com/watch";
+	QTest::newRow("optional") << "ab*c" << "a";
+	QTest::newRow("plus") << "ab+cd" << "ab";
+	QTest::newRow("interval") << "foo{2,3}barbaz" << "barbaz";
+	QTest::newRow("alternation") << "^http://a|bcdef" << "";
+	QTest::newRow("bracket") << "x[]ab]yz" << "yz";
+	QTest::newRow("class") << "[[:alpha:]]qq" << "qq";
+	QTest::newRow("escape class") << "abc\\w+defg" << "defg";
+	QTest::newRow("case") << "^HTTP://Example\\.COM/" << "http://example.com/";
+}
+
+void RedirectMatcherTest::testRequiredLiteral()
+{
+	QFETCH(QString, urlRe);
+	QFETCH(QString, literal);
+
+	QCOMPARE(QString::fromStdString(RedirectMatcher::requiredLiteral(urlRe.toStdString())), literal);
+}
+
+void RedirectMatcherTest::testLiteralScheme()
+{
+	std::string scheme;
+	QVERIFY(RedirectMatcher::literalScheme("^TEL:", scheme));
+	QCOMPARE(scheme, std::string("tel"));
+	QVERIFY(RedirectMatcher::literalScheme("^x-palm-app:", scheme));
+	QVERIFY(!RedirectMatcher::literalScheme("^tel:.*", scheme));
+	QVERIFY(!RedirectMatcher::literalScheme("^(tel|callto):", scheme));
+	QVERIFY(!RedirectMatcher::literalScheme("tel:", scheme));
+}
+
+void RedirectMatcherTest::testSharedRegexp()
+{
+	RedirectHandler* original = new RedirectHandler("^tel:", "com.example.phone", true);
+	RedirectHandler copy(*original);
+	RedirectHandler assigned;
+	assigned = copy;
+	delete original;
+
+	// the copies keep the compiled regexp alive after the original is gone
+	QVERIFY(copy.reValid());
+	QVERIFY(copy.matches("tel:5551212"));
+	QVERIFY(assigned.matches("TEL:5551212"));
+	QVERIFY(!assigned.matches("mailto:a@b.c"));
+
+	RedirectHandler empty("", "com.example.none", false);
+	QVERIFY(!empty.reValid());
+	QVERIFY(!empty.matches("tel:5551212"));
+}
+
+void RedirectMatcherTest::testConsistency()
+{
+	populate(200);
+
+	for (unsigned int i = 0; i < m_probeUrls.size(); i++) {
+		const std::string& url = m_probeUrls[i];
+
+		QCOMPARE(m_matcher.matchFirst(url, true, true), (void*) linearMatchFirst(m_table, url, true, true));
+		QCOMPARE(m_matcher.matchFirst(url, false, true), (void*) linearMatchFirst(m_table, url, false, true));
+		QCOMPARE(m_matcher.matchFirst(url, true, false), (void*) linearMatchFirst(m_table, url, true, false));
+
+		std::vector<void*> indexed, linear;
+		m_matcher.matchAll(url, indexed);
+		linearMatchAll(m_table, url, linear);
+		QVERIFY(indexed == linear);
+	}
+
+	release();
+}
+
+void RedirectMatcherTest::benchLinearMatch_data()
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("100") << 100;
+	QTest::newRow("1k") << 1000;
+	QTest::newRow("10k") << 10000;
+}
+
+void RedirectMatcherTest::benchLinearMatch()
+{
+	QFETCH(int, count);
+	populate(count);
+
+	QBENCHMARK {
+		for (unsigned int i = 0; i < m_probeUrls.size(); i++)
+			linearMatchFirst(m_table, m_probeUrls[i], true, true);
+	}
+
+	release();
+}
+
+void RedirectMatcherTest::benchIndexedMatch_data()
+{
+	benchLinearMatch_data();
+}
+
+void RedirectMatcherTest::benchIndexedMatch()
+{
+	QFETCH(int, count);
+	populate(count);
+
+	QBENCHMARK {
+		for (unsigned int i = 0; i < m_probeUrls.size(); i++)
+			m_matcher.matchFirst(m_probeUrls[i], true, true);
+	}
+
+	release();
+}
+
+QTEST_MAIN(RedirectMatcherTest)
+#include "sysmgrtst_RedirectMatcher.moc"
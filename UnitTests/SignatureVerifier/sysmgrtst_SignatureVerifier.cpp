@@ -0,0 +1,288 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QProcess>
+
+#include "SignatureVerifier.h"
+
+#define FILE_COUNT		16
+
+// the openssl command line is the reference, as ApplicationInstaller used to run it
+static bool runOpenSSL(const QString& dir, const QStringList& args)
+{
+	QProcess process;
+	process.setWorkingDirectory(dir);
+	process.start("openssl", args);
+	if (!process.waitForFinished(30000))
+		return false;
+	return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+}
+
+class SignatureVerifierTest : public QObject
+{
+	Q_OBJECT
+
+private:
+
+	QString path(const QString& name) const { return m_dir->path() + "/" + name; }
+	std::string stdPath(const QString& name) const { return path(name).toStdString(); }
+
+	SignatureVerifier::Request request(const QString& file, const QString& signature, const QString& key,
+									   SignatureVerifier::KeyFormat format = SignatureVerifier::PublicKey);
+
+	QTemporaryDir* m_dir;
+
+private Q_SLOTS:
+
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testSingleFile();
+	void testConcatenatedFiles();
+	void testInMemoryData();
+	void testCertificateKey();
+	void testKeyCache();
+	void testWritePublicKey();
+	void testBatch();
+
+	void benchForkOpenSSL();
+	void benchInProcess();
+	void benchInProcessBatch();
+};
+
+SignatureVerifier::Request SignatureVerifierTest::request(const QString& file, const QString& signature, const QString& key,
+														  SignatureVerifier::KeyFormat format)
+{
+	SignatureVerifier::Request request;
+	if (!file.isEmpty())
+		request.files.push_back(stdPath(file));
+	SignatureVerifier::readFile(stdPath(signature), request.signature);
+	request.keyFile = stdPath(key);
+	request.keyFormat = format;
+	return request;
+}
+
+void SignatureVerifierTest::initTestCase()
+{
+	m_dir = new QTemporaryDir;
+	QVERIFY(m_dir->isValid());
+	QString dir = m_dir->path();
+
+	QVERIFY(runOpenSSL(dir, QStringList() << "req" << "-x509" << "-newkey" << "rsa:2048" << "-nodes"
+					   << "-keyout" << "key.pem" << "-out" << "cert.pem" << "-subj" << "/CN=sysmgrtst" << "-days" << "1"));
+	QVERIFY(runOpenSSL(dir, QStringList() << "x509" << "-in" << "cert.pem" << "-pubkey" << "-noout" << "-out" << "pub.pem"));
+
+	for (int i = 0; i < FILE_COUNT; i++) {
+		QFile file(path(QString("f%1").arg(i)));
+		QVERIFY(file.open(QIODevice::WriteOnly));
+		QByteArray data(256 * 1024 + i * 4099, 0);
+		for (int j = 0; j < data.size(); j++)
+			data[j] = (char)((j * 31 + i) & 0xff);
+		file.write(data);
+		file.close();
+
+		QVERIFY(runOpenSSL(dir, QStringList() << "dgst" << "-sha1" << "-sign" << "key.pem"
+						   << "-out" << QString("f%1.sig").arg(i) << QString("f%1").arg(i)));
+	}
+
+	QFile all(path("all"));
+	QVERIFY(all.open(QIODevice::WriteOnly));
+	for (int i = 0; i < 3; i++) {
+		QFile file(path(QString("f%1").arg(i)));
+		QVERIFY(file.open(QIODevice::ReadOnly));
+		all.write(file.readAll());
+	}
+	all.close();
+	QVERIFY(runOpenSSL(dir, QStringList() << "dgst" << "-sha1" << "-sign" << "key.pem" << "-out" << "all.sig" << "all"));
+
+	QFile glob(path("glob"));
+	QVERIFY(glob.open(QIODevice::WriteOnly));
+	glob.write("com.example.onecom.example.two");
+	glob.close();
+	QVERIFY(runOpenSSL(dir, QStringList() << "dgst" << "-sha1" << "-sign" << "key.pem" << "-out" << "glob.sig" << "glob"));
+}
+
+void SignatureVerifierTest::cleanupTestCase()
+{
+	delete m_dir;
+	m_dir = 0;
+}
+
+void SignatureVerifierTest::testSingleFile()
+{
+	SignatureVerifier verifier;
+
+	SignatureVerifier::Request good = request("f0", "f0.sig", "pub.pem");
+	QCOMPARE(verifier.verify(good), 1);
+
+	SignatureVerifier::Request wrongFile = request("f1", "f0.sig", "pub.pem");
+	QCOMPARE(verifier.verify(wrongFile), 0);
+
+	SignatureVerifier::Request missingFile = request("nothere", "f0.sig", "pub.pem");
+	QVERIFY(verifier.verify(missingFile) < 0);
+
+	SignatureVerifier::Request noKey = request("f0", "f0.sig", "key.pem");
+	QVERIFY(verifier.verify(noKey) < 0);
+
+	SignatureVerifier::Request noSignature = request("f0", "nothere.sig", "pub.pem");
+	QCOMPARE(verifier.verify(noSignature), 0);
+}
+
+void SignatureVerifierTest::testConcatenatedFiles()
+{
+	SignatureVerifier verifier;
+
+	SignatureVerifier::Request req = request("", "all.sig", "pub.pem");
+	for (int i = 0; i < 3; i++)
+		req.files.push_back(stdPath(QString("f%1").arg(i)));
+	QCOMPARE(verifier.verify(req), 1);
+
+	std::swap(req.files[0], req.files[1]);
+	QCOMPARE(verifier.verify(req), 0);
+}
+
+void SignatureVerifierTest::testInMemoryData()
+{
+	SignatureVerifier verifier;
+
+	SignatureVerifier::Request req = request("", "glob.sig", "cert.pem", SignatureVerifier::Certificate);
+	req.data = "com.example.onecom.example.two";
+	QCOMPARE(verifier.verify(req), 1);
+
+	req.data = "com.example.onecom.example.three";
+	QCOMPARE(verifier.verify(req), 0);
+}
+
+void SignatureVerifierTest::testCertificateKey()
+{
+	SignatureVerifier verifier;
+
+	SignatureVerifier::Request req = request("f2", "f2.sig", "cert.pem", SignatureVerifier::Certificate);
+	QCOMPARE(verifier.verify(req), 1);
+
+	// a certificate is not a public key file
+	SignatureVerifier::Request wrongFormat = request("f2", "f2.sig", "cert.pem");
+	QVERIFY(verifier.verify(wrongFormat) < 0);
+}
+
+void SignatureVerifierTest::testKeyCache()
+{
+	SignatureVerifier verifier;
+
+	for (int i = 0; i < 5; i++) {
+		SignatureVerifier::Request req = request("f0", "f0.sig", "pub.pem");
+		QCOMPARE(verifier.verify(req), 1);
+	}
+	QCOMPARE(verifier.keyLoads(), 1u);
+	QCOMPARE(verifier.keyCacheHits(), 4u);
+
+	// a changed key file is parsed again
+	QFile::remove(path("pub2.pem"));
+	QVERIFY(QFile::copy(path("pub.pem"), path("pub2.pem")));
+	SignatureVerifier::Request req = request("f0", "f0.sig", "pub2.pem");
+	QCOMPARE(verifier.verify(req), 1);
+	QCOMPARE(verifier.keyLoads(), 2u);
+
+	QFile key(path("pub2.pem"));
+	QVERIFY(key.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	key.write("not a key\n");
+	key.close();
+	QVERIFY(verifier.verify(req) < 0);
+}
+
+void SignatureVerifierTest::testWritePublicKey()
+{
+	SignatureVerifier verifier;
+
+	QFile::remove(path("extracted.pem"));
+	QVERIFY(verifier.writePublicKey(stdPath("cert.pem"), stdPath("extracted.pem")));
+
+	// never overwrites
+	QVERIFY(!verifier.writePublicKey(stdPath("cert.pem"), stdPath("extracted.pem")));
+
+	QFile extracted(path("extracted.pem"));
+	QFile reference(path("pub.pem"));
+	QVERIFY(extracted.open(QIODevice::ReadOnly));
+	QVERIFY(reference.open(QIODevice::ReadOnly));
+	QCOMPARE(extracted.readAll(), reference.readAll());
+}
+
+void SignatureVerifierTest::testBatch()
+{
+	SignatureVerifier verifier;
+
+	std::vector<SignatureVerifier::Request> requests;
+	for (int i = 0; i < FILE_COUNT; i++)
+		requests.push_back(request(QString("f%1").arg(i), QString("f%1.sig").arg(i), "pub.pem"));
+	requests[3].files[0] = stdPath("f4");
+	requests[7].keyFile = stdPath("nothere.pem");
+
+	verifier.verify(requests);
+	for (int i = 0; i < FILE_COUNT; i++) {
+		if (i == 3)
+			QCOMPARE(requests[i].result, 0);
+		else if (i == 7)
+			QVERIFY(requests[i].result < 0);
+		else
+			QCOMPARE(requests[i].result, 1);
+	}
+}
+
+// what every verification cost before: a fork/exec of openssl that parses the key again
+void SignatureVerifierTest::benchForkOpenSSL()
+{
+	QBENCHMARK {
+		for (int i = 0; i < FILE_COUNT; i++) {
+			runOpenSSL(m_dir->path(), QStringList() << "dgst" << "-sha1" << "-verify" << "pub.pem"
+					   << "-signature" << QString("f%1.sig").arg(i) << QString("f%1").arg(i));
+		}
+	}
+}
+
+void SignatureVerifierTest::benchInProcess()
+{
+	SignatureVerifier verifier;
+
+	QBENCHMARK {
+		for (int i = 0; i < FILE_COUNT; i++) {
+			SignatureVerifier::Request req = request(QString("f%1").arg(i), QString("f%1.sig").arg(i), "pub.pem");
+			verifier.verify(req);
+		}
+	}
+}
+
+void SignatureVerifierTest::benchInProcessBatch()
+{
+	SignatureVerifier verifier;
+
+	std::vector<SignatureVerifier::Request> requests;
+	for (int i = 0; i < FILE_COUNT; i++)
+		requests.push_back(request(QString("f%1").arg(i), QString("f%1.sig").arg(i), "pub.pem"));
+
+	QBENCHMARK {
+		verifier.verify(requests);
+	}
+}
+
+QTEST_MAIN(SignatureVerifierTest)
+
+#include "sysmgrtst_SignatureVerifier.moc"
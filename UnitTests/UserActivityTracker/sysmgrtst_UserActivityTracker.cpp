@@ -0,0 +1,223 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <time.h>
+#include <vector>
+
+#include "UserActivityTracker.h"
+
+static const int kReplayEvents = 1000;
+
+static uint32_t nowMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// the display state touchEdge() looks at; acting on an edge is left to each test
+struct Display {
+	Display() : dim(false), activityRunning(true) {}
+
+	UserActivityTracker::TouchEdge edge() const
+	{
+		return UserActivityTracker::touchEdge(dim, !dim, activityRunning);
+	}
+
+	bool dim;
+	bool activityRunning;
+};
+
+/*
+ * Touchpanel traffic as nyx hands it over: the number of touches of each event, and how many events
+ * each wakeup of the main loop finds queued. Two fingers down for a while, one lifted, all lifted, again.
+ */
+struct Replay {
+	std::vector<int> touches;
+	std::vector<int> batchSizes;
+};
+
+static Replay syntheticReplay()
+{
+	Replay replay;
+	for (int i = 0; i < kReplayEvents; i++) {
+		int phase = i % 100;
+		replay.touches.push_back(phase < 60 ? 2 : (phase < 90 ? 1 : 0));
+	}
+
+	// mostly one report a wakeup, some wakeups late enough to find several
+	static const int sizes[] = { 1, 1, 1, 2, 1, 3, 1, 1, 4, 1 };
+	for (int i = 0, read = 0; read < kReplayEvents; i++) {
+		int size = qMin(sizes[i % G_N_ELEMENTS(sizes)], kReplayEvents - read);
+		replay.batchSizes.push_back(size);
+		read += size;
+	}
+
+	return replay;
+}
+
+class UserActivityTrackerTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void testBatch();
+	void testNoTouches();
+	void testTouchEdge();
+	void testReplay();
+
+	void benchPerEvent();
+	void benchBatched();
+};
+
+void UserActivityTrackerTest::testBatch()
+{
+	UserActivityTracker tracker;
+	tracker.addEvent(1);
+	tracker.addEvent(2);
+	tracker.addEvent(0);
+	QCOMPARE(tracker.pendingEvents(), 2u);
+	QCOMPARE(tracker.lastActivityMs(), 0u);
+
+	tracker.endBatch(1500);
+	QCOMPARE(tracker.pendingEvents(), 0u);
+	QCOMPARE(tracker.lastActivityMs(), 1500u);
+	QCOMPARE(tracker.events(), (uint64_t) 2);
+	QCOMPARE(tracker.batches(), (uint64_t) 1);
+}
+
+void UserActivityTrackerTest::testNoTouches()
+{
+	UserActivityTracker tracker;
+	tracker.addEvent(1);
+	tracker.endBatch(100);
+
+	// lifting the fingers isn't activity, and doesn't move the time
+	tracker.addEvent(0);
+	QCOMPARE(tracker.pendingEvents(), 0u);
+	tracker.endBatch(200);
+	QCOMPARE(tracker.lastActivityMs(), 100u);
+	QCOMPARE(tracker.batches(), (uint64_t) 1);
+}
+
+void UserActivityTrackerTest::testTouchEdge()
+{
+	// dimmed wakes, whatever else holds
+	QCOMPARE(UserActivityTracker::touchEdge(true, false, false), UserActivityTracker::TouchEdgeWake);
+	QCOMPARE(UserActivityTracker::touchEdge(true, false, true), UserActivityTracker::TouchEdgeWake);
+
+	QCOMPARE(UserActivityTracker::touchEdge(false, true, false), UserActivityTracker::TouchEdgeStartActivity);
+	QCOMPARE(UserActivityTracker::touchEdge(false, true, true), UserActivityTracker::TouchEdgeNone);
+
+	// off, locked or docked: touches are not the display's business
+	QCOMPARE(UserActivityTracker::touchEdge(false, false, false), UserActivityTracker::TouchEdgeNone);
+}
+
+void UserActivityTrackerTest::testReplay()
+{
+	Replay replay = syntheticReplay();
+	UserActivityTracker tracker;
+	Display display;
+	display.dim = true;
+	display.activityRunning = false;
+
+	size_t event = 0;
+	int calls = 0;
+	int edges = 0;
+	for (size_t batch = 0; batch < replay.batchSizes.size(); batch++) {
+		for (int i = 0; i < replay.batchSizes[batch]; i++)
+			tracker.addEvent(replay.touches[event++]);
+
+		if (tracker.pendingEvents() > 0) {
+			tracker.endBatch(batch + 1);
+			calls++;
+
+			// as DisplayManager::handleTouchEvent() acts on them
+			UserActivityTracker::TouchEdge edge = display.edge();
+			if (edge == UserActivityTracker::TouchEdgeWake) {
+				edges++;
+				display.dim = false;
+				edge = display.edge();
+			}
+			if (edge == UserActivityTracker::TouchEdgeStartActivity) {
+				edges++;
+				display.activityRunning = true;
+			}
+		}
+	}
+
+	QCOMPARE(event, replay.touches.size());
+	QCOMPARE(tracker.events(), (uint64_t) 900);
+	QCOMPARE((uint64_t) calls, tracker.batches());
+	QVERIFY((uint64_t) calls < tracker.events());
+
+	// the first touch wakes the display and starts the timer; after that, nothing
+	QCOMPARE(edges, 2);
+	QCOMPARE(display.edge(), UserActivityTracker::TouchEdgeNone);
+}
+
+// what readTouchpanelData did: the time and the edge check for every event with touches
+void UserActivityTrackerTest::benchPerEvent()
+{
+	Replay replay = syntheticReplay();
+	Display display;
+
+	QBENCHMARK {
+		int edges = 0;
+		uint32_t lastEvent = 0;
+		for (size_t event = 0; event < replay.touches.size(); event++) {
+			if (replay.touches[event] > 0) {
+				lastEvent = nowMs();
+				edges += display.edge();
+			}
+		}
+		Q_UNUSED(lastEvent);
+		Q_UNUSED(edges);
+	}
+}
+
+void UserActivityTrackerTest::benchBatched()
+{
+	Replay replay = syntheticReplay();
+	UserActivityTracker tracker;
+	Display display;
+
+	QBENCHMARK {
+		int edges = 0;
+		size_t event = 0;
+		for (size_t batch = 0; batch < replay.batchSizes.size(); batch++) {
+			for (int i = 0; i < replay.batchSizes[batch]; i++)
+				tracker.addEvent(replay.touches[event++]);
+
+			if (tracker.pendingEvents() > 0) {
+				tracker.endBatch(nowMs());
+				edges += display.edge();
+			}
+		}
+		Q_UNUSED(edges);
+	}
+}
+
+QTEST_MAIN(UserActivityTrackerTest)
+
+#include "sysmgrtst_UserActivityTracker.moc"
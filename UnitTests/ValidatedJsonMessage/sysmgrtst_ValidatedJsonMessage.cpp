@@ -0,0 +1,249 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+#include <QtTest/QtTest>
+
+#include <cjson/json.h>
+
+#include "ValidatedJsonMessage.h"
+
+// what servicecallback_launch is sent by the launcher
+static const char* s_launchPayload =
+	"{\"id\":\"com.palm.app.email\",\"params\":{\"target\":\"mailto:someone@example.com\",\"account\":\"1\"},"
+	"\"$activity\":{\"activityId\":42,\"name\":\"launch\"}}";
+
+static const char* s_launchSchema =
+	SCHEMA_2(NAKED_OBJECT_REQUIRED_1(id, label, string), REQUIRED_UNION_2(params, object, string));
+
+class ValidatedJsonMessageTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void init();
+
+	void testValid();
+	void testSchemaMismatch();
+	void testNotJson();
+	void testLazyWhenIgnored();
+	void testGetString();
+	void testCounters();
+	void testSchemaCache();
+
+	void benchValidateThenParse();
+	void benchSingleParse();
+};
+
+void ValidatedJsonMessageTest::init()
+{
+	JsonParseStats::reset();
+}
+
+void ValidatedJsonMessageTest::testValid()
+{
+	ValidatedJsonMessage request(s_launchPayload, s_launchSchema);
+	QVERIFY(request.parse("testValid", NULL, EValidateAndError));
+	QVERIFY(request.isValid());
+	QVERIFY(request.root().isObject());
+
+	std::string id;
+	QVERIFY(request.getString("id", id));
+	QCOMPARE(id, std::string("com.palm.app.email"));
+	QVERIFY(request.value("params").isObject());
+	QVERIFY(!request.has("target"));
+
+	// the validating parse is the only one
+	QCOMPARE(JsonParseStats::counters()["testValid"].parses, 1u);
+}
+
+void ValidatedJsonMessageTest::testSchemaMismatch()
+{
+	ValidatedJsonMessage request("{\"id\":7}", SCHEMA_1(REQUIRED(id, string)));
+	QVERIFY(!request.parse("testSchemaMismatch", NULL, EValidateAndError));
+
+	// with validation only logged, the handler goes on with the DOM of the diagnosis parse
+	ValidatedJsonMessage logged("{\"id\":7}", SCHEMA_1(REQUIRED(id, string)));
+	QVERIFY(logged.parse("testSchemaMismatch", NULL, EValidateAndContinue));
+	QVERIFY(logged.isValid());
+	std::string id;
+	QVERIFY(logged.getString("id", id));
+	QCOMPARE(id, std::string("7"));
+
+	JsonParseStats::Counter counter = JsonParseStats::counters()["testSchemaMismatch"];
+	QCOMPARE(counter.calls, 2u);
+	QCOMPARE(counter.parses, 4u);
+	QCOMPARE(counter.failures, 2u);
+}
+
+void ValidatedJsonMessageTest::testNotJson()
+{
+	ValidatedJsonMessage request("{\"id\":", SCHEMA_ANY);
+	QVERIFY(!request.parse("testNotJson", NULL, EValidateAndError));
+
+	ValidatedJsonMessage logged("{\"id\":", SCHEMA_ANY);
+	QVERIFY(logged.parse("testNotJson", NULL, EValidateAndContinue));
+	QVERIFY(!logged.isValid());
+	QVERIFY(!logged.has("id"));
+
+	ValidatedJsonMessage empty((const char*) NULL, SCHEMA_ANY);
+	QVERIFY(empty.parse("testNotJson", NULL, EIgnore));
+	QVERIFY(!empty.isValid());
+}
+
+void ValidatedJsonMessageTest::testLazyWhenIgnored()
+{
+	ValidatedJsonMessage unread(s_launchPayload, s_launchSchema);
+	QVERIFY(unread.parse("testLazyWhenIgnored", NULL, EIgnore));
+	QCOMPARE(JsonParseStats::counters()["testLazyWhenIgnored"].parses, 0u);
+
+	// a schema mismatch goes unnoticed, as it did before
+	ValidatedJsonMessage read("{\"id\":7}", SCHEMA_1(REQUIRED(id, string)));
+	QVERIFY(read.parse("testLazyWhenIgnored", NULL, EIgnore));
+	QVERIFY(read.has("id"));
+	QVERIFY(read.has("id"));
+
+	JsonParseStats::Counter counter = JsonParseStats::counters()["testLazyWhenIgnored"];
+	QCOMPARE(counter.calls, 2u);
+	QCOMPARE(counter.parses, 1u);
+	QCOMPARE(counter.failures, 0u);
+}
+
+void ValidatedJsonMessageTest::testGetString()
+{
+	ValidatedJsonMessage request("{\"s\":\"text\",\"n\":12,\"b\":true,\"o\":{\"a\":[1,2]},\"z\":null}", SCHEMA_ANY);
+	QVERIFY(request.parse("testGetString", NULL, EValidateAndError));
+
+	// the same as json_object_get_string() on the cjson object
+	struct json_object* root = json_tokener_parse(request.payload());
+	const char* keys[] = { "s", "n", "b", "o" };
+	for (unsigned int i = 0; i < G_N_ELEMENTS(keys); i++) {
+		std::string value;
+		QVERIFY(request.getString(keys[i], value));
+
+		// non-strings are json text, compared once cjson has formatted both the same way
+		struct json_object* reference = json_object_object_get(root, keys[i]);
+		if (json_object_is_type(reference, json_type_string)) {
+			QCOMPARE(value, std::string(json_object_get_string(reference)));
+		}
+		else {
+			struct json_object* reparsed = json_tokener_parse(value.c_str());
+			QVERIFY(reparsed && !is_error(reparsed));
+			QCOMPARE(std::string(json_object_get_string(reparsed)), std::string(json_object_get_string(reference)));
+			json_object_put(reparsed);
+		}
+	}
+	json_object_put(root);
+
+	std::string value = "untouched";
+	QVERIFY(!request.getString("z", value));
+	QVERIFY(!request.getString("missing", value));
+	QCOMPARE(value, std::string("untouched"));
+	QVERIFY(request.value("z").isNull());
+}
+
+void ValidatedJsonMessageTest::testCounters()
+{
+	for (int i = 0; i < 3; i++) {
+		ValidatedJsonMessage request(s_launchPayload, s_launchSchema);
+		request.parse("testCounters", NULL, EValidateAndError);
+	}
+
+	JsonParseStats::CounterMap counters = JsonParseStats::counters();
+	QCOMPARE(counters["testCounters"].calls, 3u);
+	QCOMPARE(counters["testCounters"].parses, 3u);
+	QVERIFY(counters["testCounters"].maxUs <= counters["testCounters"].totalUs);
+
+	JsonParseStats::reset();
+	QVERIFY(JsonParseStats::counters().empty());
+}
+
+void ValidatedJsonMessageTest::testSchemaCache()
+{
+	static const char* const s_cacheSchema = SCHEMA_1(REQUIRED(cached, boolean));
+
+	// compiled for the mismatch diagnosis below
+	JsonSchemaCache::schema(SCHEMA_ANY);
+
+	JsonSchemaCache::Counters before = JsonSchemaCache::counters();
+	const pbnjson::JSchema& first = JsonSchemaCache::schema(s_cacheSchema);
+	const pbnjson::JSchema& again = JsonSchemaCache::schema(s_cacheSchema);
+	QCOMPARE(&again, &first);
+
+	// the same text elsewhere is the same schema
+	std::string copy(s_cacheSchema);
+	QCOMPARE(&JsonSchemaCache::schema(copy.c_str()), &first);
+
+	// and other text at that address isn't
+	copy = SCHEMA_1(REQUIRED(other, string));
+	const pbnjson::JSchema& other = JsonSchemaCache::schema(copy.c_str());
+	QVERIFY(&other != &first);
+
+	JsonSchemaCache::Counters after = JsonSchemaCache::counters();
+	QCOMPARE(after.misses - before.misses, 2u);
+	QCOMPARE(after.hits - before.hits, 2u);
+	QCOMPARE(after.schemas - before.schemas, 2u);
+
+	// messages validate against the cached schema, and still tell a mismatch
+	for (int i = 0; i < 3; i++) {
+		ValidatedJsonMessage request("{\"cached\":true}", s_cacheSchema);
+		QVERIFY(request.parse("testSchemaCache", NULL, EValidateAndError));
+	}
+	ValidatedJsonMessage mismatch("{\"cached\":1}", s_cacheSchema);
+	QVERIFY(!mismatch.parse("testSchemaCache", NULL, EValidateAndError));
+
+	QCOMPARE(JsonSchemaCache::counters().schemas, after.schemas);
+}
+
+// what servicecallback_launch did before: validate with pbnjson, then parse again with cjson to read it
+void ValidatedJsonMessageTest::benchValidateThenParse()
+{
+	pbnjson::JSchemaFragment schema(s_launchSchema);
+
+	QBENCHMARK {
+		pbnjson::JDomParser parser(NULL);
+		parser.parse(s_launchPayload, schema);
+
+		struct json_object* root = json_tokener_parse(s_launchPayload);
+		std::string id = json_object_get_string(json_object_object_get(root, "id"));
+		struct json_object* params = json_object_object_get(root, "params");
+		json_object_object_add(params, "$activity", json_object_get(json_object_object_get(root, "$activity")));
+		std::string launchParams = json_object_to_json_string(params);
+		json_object_put(root);
+	}
+}
+
+void ValidatedJsonMessageTest::benchSingleParse()
+{
+	QBENCHMARK {
+		ValidatedJsonMessage request(s_launchPayload, s_launchSchema);
+		request.parse("benchSingleParse", NULL, EValidateAndError);
+
+		std::string id;
+		request.getString("id", id);
+		pbnjson::JValue params = request.value("params");
+		params.put("$activity", request.value("$activity"));
+		std::string launchParams = ValidatedJsonMessage::toString(params);
+	}
+}
+
+QTEST_MAIN(ValidatedJsonMessageTest)
+
+#include "sysmgrtst_ValidatedJsonMessage.moc"
@@ -0,0 +1,58 @@
+# @@@LICENSE
+#
+#      Copyright (c) 2013 LG Electronics, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# LICENSE@@@
+
+# Settings shared by the unit test projects under UnitTests/<Name>/<Name>.pro. A project includes this, then
+# sets TARGET, SOURCES and HEADERS (sources are found through VPATH) and adds whatever else it links.
+
+CONFIG += qt no_keywords
+QT += testlib
+CONFIG += link_pkgconfig
+PKGCONFIG = glib-2.0 gthread-2.0 LunaSysMgrCommon
+
+VPATH = $$PWD/../Src \
+		$$PWD/../Src/base \
+		$$PWD/../Src/base/application \
+		$$PWD/../Src/base/settings \
+		$$PWD/../Src/core \
+		$$PWD/../Src/remote
+
+INCLUDEPATH = $$VPATH
+
+QMAKE_CXXFLAGS += -fno-rtti -fno-exceptions -Wall -Werror
+QMAKE_CXXFLAGS += -DFIX_FOR_QT
+# Override the default (-Wall -W) from g++.conf mkspec (see linux-g++.conf)
+QMAKE_CXXFLAGS_WARN_ON += -Wno-unused-parameter -Wno-unused-variable -Wno-reorder -Wno-missing-field-initializers -Wno-extra
+
+LIBS += -lcjson -lLunaSysMgrIpc -lluna-service2 -lpbnjson_cpp
+
+linux-g++ {
+	include($$PWD/../desktop.pri)
+}
+
+linux-qemux86-g++ {
+	include($$PWD/../device.pri)
+	QMAKE_CXXFLAGS += -fno-strict-aliasing
+}
+
+linux-armv7-g++ {
+	include($$PWD/../device.pri)
+}
+
+DESTDIR = ./$${BUILD_TYPE}-$${MACHINE_NAME}
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
@@ -66,11 +66,16 @@ DEFINES += SHIPPING_VERSION=0
 
 SOURCES = \
     AmbientLightSensor.cpp \
+    AlsRegionEstimator.cpp \
+    AdaptiveBrightness.cpp \
     AnimationSettings.cpp \
+    ApplicationChangeJournal.cpp \
     ApplicationDescription.cpp \
+    ApplicationIndex.cpp \
     ApplicationInstaller.cpp \
     ApplicationManager.cpp \
     ApplicationManagerService.cpp \
+    ApplicationScanner.cpp \
     ApplicationStatus.cpp \
     BackupManager.cpp \
     CmdResourceHandlers.cpp \
@@ -78,36 +83,54 @@ SOURCES = \
     DeviceInfo.cpp \
     DisplayManager.cpp \
     DisplayStates.cpp \
+    DisplayTransitions.cpp \
     EASPolicyManager.cpp \
     EventReporter.cpp \
     HapticsController.cpp \
     JSONUtils.cpp \
     KeywordMap.cpp \
     LaunchPoint.cpp \
+    LaunchPointSearchIndex.cpp \
+    ListResponseCache.cpp \
+    LaunchPointChangeBatcher.cpp \
     Logging.cpp \
+    LogRingBuffer.cpp \
     LsmUtils.cpp \
+    LunaConf.cpp \
     Main.cpp \
     MallocHooks.cpp \
     MemoryMonitor.cpp \
+    MemorySampler.cpp \
+    ReclaimPolicy.cpp \
+    MemoryPressureWatcher.cpp \
     MetaKeyManager.cpp \
     MimeSystem.cpp \
+    MimeTableStore.cpp \
     PackageDescription.cpp \
+    PackageSizeAccounting.cpp \
     Preferences.cpp \
+    RedirectMatcher.cpp \
     Security.cpp \
     ServiceDescription.cpp \
     Settings.cpp \
+    SignatureVerifier.cpp \
     SuspendBlocker.cpp \
     SystemService.cpp \
     WebAppMgrProxy.cpp
 
 HEADERS = \
     AmbientLightSensor.h \
+    AlsRegionEstimator.h \
+    AdaptiveBrightness.h \
     AnimationEquations.h \
     AnimationSettings.h \
+    ApplicationChangeJournal.h \
     ApplicationDescription.h \
+    ApplicationIndex.h \
     ApplicationInstallerErrors.h \
     ApplicationInstaller.h \
     ApplicationManager.h \
+    ApplicationScanner.h \
     ApplicationStatus.h \
     BackupManager.h \
     CircularBuffer.h \
@@ -116,23 +139,39 @@ HEADERS = \
     DeviceInfo.h \
     DisplayManager.h \
     DisplayStates.h \
+    DisplayTransitions.h \
     EASPolicyManager.h \
     EventReporter.h \
     GraphicsDefs.h \
     HapticsController.h \
+    InstallerCommandScheduler.h \
     LaunchPoint.h \
+    LaunchPointSearchIndex.h \
+    ListResponseCache.h \
+    LaunchPointChangeBatcher.h \
+    LogFilter.h \
+    LogRingBuffer.h \
     LsmUtils.h \
+    LunaConf.h \
     MemoryMonitor.h \
+    MemorySampler.h \
+    ReclaimPolicy.h \
+    MemoryPressureWatcher.h \
     MetaKeyManager.h \
     MimeSystem.h \
+    MimeTableStore.h \
     PackageDescription.h \
+    PackageSizeAccounting.h \
     Preferences.h \
     PtrArray.h \
+    RedirectMatcher.h \
     Security.h \
     ServiceDescription.h \
     SharedGlobalProperties.h \
+    SignatureVerifier.h \
     SuspendBlocker.h \
     SystemService.h \
+    ValidatedJsonMessage.h \
     WebAppMgrProxy.h
 
 QMAKE_CXXFLAGS += -fno-rtti -fno-exceptions -fvisibility=hidden -fvisibility-inlines-hidden -Wall -fpermissive